@@ -28,11 +28,20 @@
 #define DEV_PREFIX	"/dev/disk/by-"
 #define DEV_PREFIX_LEN	(sizeof(DEV_PREFIX)-1)
 
+#define DEVICE_SUFFIX	".device"
+#define DEVICE_SUFFIX_LEN	(sizeof(DEVICE_SUFFIX)-1)
+
+#define PROC_VMCORE	"/proc/vmcore"
+#define SAVE_SERVICE	"kdump-save.service"
+
+/* Seconds before a device that no dump target needs stops blocking boot */
+#define OTHER_TIMEOUT	1
+
 #define READ_CHUNK_ADD	1024
 #define READ_CHUNK_MIN	256
 
 typedef int parser_fn(const char *key, const char *val);
-static parser_fn get_timeout;
+static parser_fn get_options;
 
 static const char program_name[] = "device-timeout-generator";
 
@@ -41,6 +50,28 @@ static const char *unitdir;
 static size_t unitdirlen;
 
 static unsigned long timeout;
+static unsigned long device_timeout;
+static int have_device_timeout;
+
+/* rd.kdump.wait=targets: only the dump target devices may block boot */
+static int targets_only;
+
+/* Unit names of the dump target devices */
+static char **targets;
+static size_t ntargets;
+
+/* Extra dump target devices from rd.kdump.device= (raw dumps) */
+static char **extra_devs;
+static size_t nextra_devs;
+
+/* Directories where dracut asks initrd.target to wait for devices */
+static const char *const wants_dirs[] = {
+	"/etc/systemd/system/initrd.target.wants",
+	"/etc/systemd/system/initrd.target.requires",
+	"/run/systemd/system/initrd.target.wants",
+	"/run/systemd/system/initrd.target.requires",
+	NULL
+};
 
 static int
 error(const char *fmt, ...)
@@ -280,15 +311,62 @@ parse_cmdline_files(parser_fn *parse)
 };
 
 static int
-get_timeout(const char *key, const char *val)
+parse_seconds(const char *key, const char *val, unsigned long *num)
 {
-	if (!strcmp(key, "rd.timeout") && val && *val) {
-		char *end;
-		unsigned long num = strtoul(val, &end, 0);
-		if (*end == '\0')
-			timeout = num;
+	char *end;
+
+	*num = strtoul(val, &end, 0);
+	if (*end != '\0') {
+		error("Invalid %s format: %s", key, val);
+		return -1;
+	}
+	return 0;
+}
+
+static int
+add_extra_dev(const char *spec)
+{
+	char **newdevs, *dev;
+
+	dev = strdup(spec);
+	if (!dev) {
+		error("Cannot allocate device '%s': %s",
+		      spec, strerror(errno));
+		return -1;
+	}
+
+	newdevs = realloc(extra_devs, (nextra_devs + 1) * sizeof(char *));
+	if (!newdevs) {
+		error("Cannot allocate device '%s': %s",
+		      spec, strerror(errno));
+		free(dev);
+		return -1;
+	}
+	extra_devs = newdevs;
+	extra_devs[nextra_devs++] = dev;
+	return 0;
+}
+
+static int
+get_options(const char *key, const char *val)
+{
+	if (!val || !*val)
+		return 0;
+
+	if (!strcmp(key, "rd.timeout")) {
+		parse_seconds(key, val, &timeout);
+	} else if (!strcmp(key, "rd.kdump.device_timeout")) {
+		if (!parse_seconds(key, val, &device_timeout))
+			have_device_timeout = 1;
+	} else if (!strcmp(key, "rd.kdump.wait")) {
+		if (!strcmp(val, "targets"))
+			targets_only = 1;
+		else if (!strcmp(val, "all"))
+			targets_only = 0;
 		else
-			error("Invalid rd.timeout format: %s", val);
+			error("Invalid rd.kdump.wait value: %s", val);
+	} else if (!strcmp(key, "rd.kdump.device")) {
+		add_extra_dev(val);
 	}
 	return 0;
 }
@@ -401,9 +479,11 @@ path_escape(char *path)
 }
 
 static int
-write_conf(const char *path)
+write_conf(const char *path, const char *fmt, ...)
 {
 	FILE *f;
+	va_list ap;
+	int ret;
 
 	f = fopen(path, "w");
 	if (!f) {
@@ -411,8 +491,12 @@ write_conf(const char *path)
 		return -1;
 	}
 
-	if (fprintf(f, "[Unit]\nJobTimeoutSec=%lu\n", timeout) < 0) {
+	va_start(ap, fmt);
+	ret = vfprintf(f, fmt, ap);
+	va_end(ap);
+	if (ret < 0) {
 		error("Cannot write to '%s': %s", path, strerror(errno));
+		fclose(f);
 		return -1;
 	}
 
@@ -424,17 +508,65 @@ write_conf(const char *path)
 	return 0;
 }
 
+static char *
+dropin_path(const char *unitname, const char *confname)
+{
+	char *confpath, *p;
+
+	confpath = malloc(unitdirlen + 1 + strlen(unitname) +
+			  sizeof(".d/") + strlen(confname));
+	if (!confpath) {
+		error("Cannot allocate path for '%s': %s",
+		      unitname, strerror(errno));
+		return NULL;
+	}
+	p = stpcpy(confpath, unitdir);
+	*p++ = '/';
+	p = stpcpy(p, unitname);
+	p = stpcpy(p, ".d");
+
+	if (mkdir(confpath, S_IRWXU | S_IRWXG | S_IRWXO) && errno != EEXIST) {
+		error("Cannot create directory '%s': %s",
+		      confpath, strerror(errno));
+		free(confpath);
+		return NULL;
+	}
+
+	*p++ = '/';
+	strcpy(p, confname);
+	return confpath;
+}
+
+/* Sorts after "timeout.conf" from dracut's wait_for_dev, so it wins */
+#define DEVICE_CONF	"zz-kdump.conf"
+
 static int
-create_conf(const char *spec)
+write_device_conf(const char *unitname, unsigned long secs)
 {
-	char *devname, *unitname, *confpath, *p;
+	char *confpath;
 	int ret;
 
+	confpath = dropin_path(unitname, DEVICE_CONF);
+	if (!confpath)
+		return -1;
+
+	ret = write_conf(confpath,
+			 "[Unit]\nJobTimeoutSec=%lu\nJobRunningTimeoutSec=%lu\n",
+			 secs, secs);
+	free(confpath);
+	return ret;
+}
+
+static char *
+device_unit(const char *spec)
+{
+	char *devname, *unitname, *ret;
+
 	devname = evaluate_spec(spec);
 	if (!devname) {
 		error("Cannot convert '%s' to device name: %s",
 		      spec, strerror(errno));
-		return -1;
+		return NULL;
 	}
 
 	unitname = path_escape(devname);
@@ -442,41 +574,144 @@ create_conf(const char *spec)
 		error("Cannot convert '%s' to systemd unit name: %s",
 		      devname, strerror(errno));
 		free(devname);
-		return -1;
+		return NULL;
 	}
 	free(devname);
 
-	confpath = malloc(unitdirlen + 1 + strlen(unitname) +
-			  sizeof(".device.d/timeout.conf"));
-	if (!confpath) {
-		error("Cannot allocate path for '%s': %s",
+	ret = realloc(unitname, strlen(unitname) + sizeof(DEVICE_SUFFIX));
+	if (!ret) {
+		error("Cannot allocate unit name for '%s': %s",
+		      spec, strerror(errno));
+		free(unitname);
+		return NULL;
+	}
+	strcat(ret, DEVICE_SUFFIX);
+	return ret;
+}
+
+static int
+is_target(const char *unitname)
+{
+	size_t i;
+
+	for (i = 0; i < ntargets; ++i)
+		if (!strcmp(targets[i], unitname))
+			return 1;
+	return 0;
+}
+
+static char *
+add_target(const char *spec)
+{
+	char **newtargets, *unitname;
+
+	unitname = device_unit(spec);
+	if (!unitname)
+		return NULL;
+
+	if (is_target(unitname)) {
+		free(unitname);
+		return NULL;
+	}
+
+	newtargets = realloc(targets, (ntargets + 1) * sizeof(char *));
+	if (!newtargets) {
+		error("Cannot allocate target '%s': %s",
 		      unitname, strerror(errno));
 		free(unitname);
+		return NULL;
+	}
+	targets = newtargets;
+	targets[ntargets++] = unitname;
+
+	if (write_device_conf(unitname, have_device_timeout
+			      ? device_timeout : timeout))
+		return NULL;
+	return unitname;
+}
+
+/* Raw dump devices are not mounted, so kdump-save must wait for them */
+static int
+create_save_conf(char **units, size_t nunits)
+{
+	char *confpath, *list, *p;
+	size_t i, len;
+	int ret;
+
+	len = 1;
+	for (i = 0; i < nunits; ++i)
+		len += strlen(units[i]) + 1;
+	list = malloc(len);
+	if (!list) {
+		error("Cannot allocate dependencies of '%s': %s",
+		      SAVE_SERVICE, strerror(errno));
 		return -1;
 	}
-	p = stpcpy(confpath, unitdir);
-	*p++ = '/';
-	p = stpcpy(p, unitname);
-	p = stpcpy(p, ".device.d");
-	free(unitname);
+	p = list;
+	*p = '\0';
+	for (i = 0; i < nunits; ++i) {
+		if (i)
+			*p++ = ' ';
+		p = stpcpy(p, units[i]);
+	}
 
-	if (mkdir(confpath, S_IRWXU | S_IRWXG | S_IRWXO) && errno != EEXIST) {
-		error("Cannot create directory '%s': %s",
-		      confpath, strerror(errno));
-		free(confpath);
+	confpath = dropin_path(SAVE_SERVICE, "devices.conf");
+	if (!confpath) {
+		free(list);
 		return -1;
 	}
 
-	p = stpcpy(p, "/timeout.conf");
-	ret = write_conf(confpath);
+	ret = write_conf(confpath, "[Unit]\nWants=%s\nAfter=%s\n",
+			 list, list);
 	free(confpath);
+	free(list);
 	return ret;
 }
 
+/*
+ * Let initrd.target give up quickly on devices which are not needed by
+ * any dump target, so that they do not hold up the boot.
+ */
+static int
+relax_other_devices(void)
+{
+	const char *const *dname;
+
+	for (dname = wants_dirs; *dname; ++dname) {
+		DIR *dir;
+		struct dirent *e;
+
+		dir = opendir(*dname);
+		if (!dir) {
+			if (errno != ENOENT)
+				error("Cannot open '%s': %s",
+				      *dname, strerror(errno));
+			continue;
+		}
+
+		while ( (e = readdir(dir)) ) {
+			size_t len = strlen(e->d_name);
+			char *endp = e->d_name + len;
+
+			if (len < DEVICE_SUFFIX_LEN ||
+			    strcmp(endp - DEVICE_SUFFIX_LEN, DEVICE_SUFFIX))
+				continue;
+			if (is_target(e->d_name))
+				continue;
+
+			write_device_conf(e->d_name, OTHER_TIMEOUT);
+		}
+		closedir(dir);
+	}
+	return 0;
+}
+
 int
 main(int argc, char **argv)
 {
 	struct fstab *fs;
+	char **rawunits;
+	size_t i, nraw;
 
 	umask(S_IWGRP | S_IWOTH);
 
@@ -487,15 +722,34 @@ main(int argc, char **argv)
 	unitdir = argv[1];
 	unitdirlen = strlen(argv[1]);
 
-	parse_cmdline_files(get_timeout);
+	parse_cmdline_files(get_options);
 
 	while ((fs = getfsent()) != NULL) {
 		if (strncmp(fs->fs_file, KDUMP_DIR, KDUMP_DIR_LEN))
 			continue;
 
 		unescape_fstab(fs->fs_spec);
-		create_conf(fs->fs_spec);
+		add_target(fs->fs_spec);
+	}
+
+	rawunits = calloc(nextra_devs, sizeof(char *));
+	if (nextra_devs && !rawunits) {
+		error("Cannot allocate raw devices: %s", strerror(errno));
+		return EXIT_FAILURE;
 	}
+	nraw = 0;
+	for (i = 0; i < nextra_devs; ++i) {
+		char *unitname = add_target(extra_devs[i]);
+		if (unitname)
+			rawunits[nraw++] = unitname;
+	}
+	if (nraw)
+		create_save_conf(rawunits, nraw);
+	free(rawunits);
+
+	/* never touch the devices of a normal boot (e.g. with fadump) */
+	if (targets_only && ntargets && !access(PROC_VMCORE, F_OK))
+		relax_other_devices();
 
 	return EXIT_SUCCESS;
 }
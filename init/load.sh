@@ -8,6 +8,7 @@ KEXEC=/sbin/kexec
 FADUMP_ENABLED=/sys/kernel/fadump_enabled
 FADUMP_REGISTERED=/sys/kernel/fadump_registered
 UDEV_RULES_DIR=/run/udev/rules.d
+KEXEC_CACHE=/var/cache/kdump/kexec-args
 
 #
 # Remove an option from the kernel command line
@@ -182,6 +183,93 @@ function build_kexec_options()
     echo "$options"
 }
 
+#
+# Computes the key of the cached kexec invocation from everything that
+# the kdump command line and the kexec options are built from
+function kexec_cache_key()
+{
+    {
+        stat -L -c '%n %s %Y %i' \
+            "$kdump_kernel" "$kdump_initrd" "$KEXEC" "${BASH_SOURCE[0]}"
+        uname -r
+        cat /proc/cmdline
+        echo "$kdump_config"
+    } 2>/dev/null | md5sum | cut -d ' ' -f 1
+}
+
+#
+# Reads the cached kexec invocation
+# Parameters: 1) cache key
+# Output variables:
+#   kexec_cached_call     the kexec command without -s
+#   kexec_cached_syscall  "file" for kexec_file_load(2), "load" for kexec_load(2)
+# Returns: 0 if the cache is valid for the key
+function read_kexec_cache()
+{
+    local key="$1"
+    local name value
+    local cached_key=
+
+    kexec_cached_call=
+    kexec_cached_syscall=
+    test -f "$KEXEC_CACHE" || return 1
+
+    while read -r name value ; do
+        case "$name" in
+            KEY) cached_key="$value" ;;
+            SYSCALL) kexec_cached_syscall="$value" ;;
+            CALL) kexec_cached_call="$value" ;;
+        esac
+    done < "$KEXEC_CACHE"
+
+    test "$cached_key" = "$key" -a -n "$kexec_cached_call" || return 1
+    test "$kexec_cached_syscall" = file -o "$kexec_cached_syscall" = load
+}
+
+#
+# Saves the kexec invocation that has worked (errors are ignored, e.g.
+# if /var is not mounted yet)
+# Parameters: 1) cache key, 2) syscall ("file" or "load"), 3) kexec command
+function write_kexec_cache()
+{
+    mkdir -p "${KEXEC_CACHE%/*}" 2>/dev/null || return 0
+    printf "KEY %s\nSYSCALL %s\nCALL %s\n" "$1" "$2" "$3" \
+        2>/dev/null > "$KEXEC_CACHE.new" &&
+        mv -f "$KEXEC_CACHE.new" "$KEXEC_CACHE" 2>/dev/null
+    return 0
+}
+
+#
+# Load kdump with the cached kexec invocation
+# Parameters: 1) cache key
+# Returns: 0 if the kdump kernel has been loaded
+function load_kdump_cached()
+{
+    local result
+    local output
+
+    read_kexec_cache "$1" || return 1
+
+    KEXEC_CALL="$kexec_cached_call"
+    test "$kexec_cached_syscall" = file && KEXEC_CALL="$KEXEC_CALL -s"
+
+    kdump_echo "Starting load kdump kernel with the cached kexec invocation"
+    kdump_echo "kexec cmdline: $KEXEC_CALL"
+
+    output=$(eval "$KEXEC_CALL" 2>&1)
+    result=$?
+    echo "$output"
+
+    if [ $result -eq 0 ] ; then
+        kdump_logger "Loaded kdump kernel: $KEXEC_CALL, Result: $output"
+        return 0
+    fi
+
+    kdump_echo "Cached kexec invocation failed"
+    rm -f "$KEXEC_CACHE"
+    return 1
+}
+
 #
 # Load kdump using kexec
 function load_kdump_kexec()
@@ -194,6 +282,11 @@ function load_kdump_kexec()
 	return 6
     fi
 
+    # skip building the command line and the kexec call that has failed
+    # before, unless the kernel, initrd, command line or config changed
+    local cache_key=$(kexec_cache_key)
+    load_kdump_cached "$cache_key" && return 0
+
     local kdump_commandline=$(build_kdump_commandline "$kdump_kernel")
     local kexec_options=$(build_kexec_options "$kdump_kernel")
 
@@ -212,6 +305,7 @@ function load_kdump_kexec()
 
     if [ $result -eq 0 ] ; then
         kdump_logger "Loaded kdump kernel: $KEXEC_CALL -s, Result: $output"
+        write_kexec_cache "$cache_key" file "$KEXEC_CALL"
         return 0
     fi
 
@@ -226,6 +320,7 @@ function load_kdump_kexec()
 
     if [ $result -eq 0 ] ; then
         kdump_logger "Loaded kdump kernel: $KEXEC_CALL, Result: $output"
+        write_kexec_cache "$cache_key" load "$KEXEC_CALL"
     else
         kdump_logger "FAILED to load kdump kernel: $KEXEC_CALL, Result: $output"
     fi
@@ -344,7 +439,8 @@ function rebuild_kdumprd()
 # MAIN PROGRAM STARTS HERE
 #
 
-eval $($KDUMPTOOL dump_config)
+kdump_config=$($KDUMPTOOL dump_config)
+eval $kdump_config
 
 if [ $((${KDUMP_VERBOSE:-0} & 4)) -gt 0 ] ; then
     function kdump_echo()
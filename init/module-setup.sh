@@ -22,7 +22,8 @@ kdump_check_net() {
         kdump_neednet=y
     else
         for protocol in "${kdump_Protocol[@]}" ; do
-	    if [ "$protocol" != "file" -a "$protocol" != "srcfile" ]; then
+	    if [ "$protocol" != "file" -a "$protocol" != "srcfile" -a \
+		 "$protocol" != "stage" -a "$protocol" != "raw" ]; then
 	        kdump_neednet=y
 	    fi
         done
@@ -103,6 +104,15 @@ check() {
 	    [ -n "${kdump_mnt[_i]}" ] && kdump_add_mnt $_i
 	    _i=$((_i+1))
         done
+
+        # raw dump devices are not mounted, but must be available
+        _i=0
+        while [ $_i -lt ${#kdump_Protocol[@]} ]
+        do
+	    [ "${kdump_Protocol[_i]}" = raw ] &&
+		kdump_add_host_dev "$(readlink -f "${kdump_Path[_i]}")"
+	    _i=$((_i+1))
+        done
     fi
 
     # check if fence_kdump_send is installed and configured
@@ -243,7 +253,36 @@ cmdline_net() {
     kdump_cmdline_ip
 }
 
+# Options for kdump-device-timeout-generator: wait only for the devices
+# of the dump targets (with fadump, the initrd also boots the system)
+kdump_cmdline_devices() {
+    local _i=0
+
+    [ "$KDUMP_FADUMP" != yes ] && echo "rd.kdump.wait=targets"
+    [ "$KDUMP_DEVICE_TIMEOUT" -gt 0 ] 2>/dev/null &&
+        echo "rd.kdump.device_timeout=$KDUMP_DEVICE_TIMEOUT"
+    while [ $_i -lt ${#kdump_Protocol[@]} ]
+    do
+        [ "${kdump_Protocol[_i]}" = raw ] &&
+            echo "rd.kdump.device=${kdump_Path[_i]}"
+        _i=$((_i+1))
+    done
+}
+
+# Congestion control modules requested in KDUMP_NET_TUNING
+kdump_tcp_kmods() {
+    local _word
+    for _word in $KDUMP_NET_TUNING
+    do
+        _word="${_word%%@*}"
+        [ "${_word%%=*}" = cc ] && echo "tcp_${_word#cc=}"
+    done | sort -u
+}
+
 installkernel() {
+    local _tcp_kmods=$(kdump_tcp_kmods)
+    # built-in algorithms (cubic, reno) have no module
+    [ -n "$_tcp_kmods" ] && hostonly='' instmods -o $_tcp_kmods
     [ -n "$kdump_kmods" ] || return 0
     hostonly='' instmods $kdump_kmods
 }
@@ -267,6 +306,8 @@ install() {
     inst_hook cmdline 50 "$moddir/kdump-root.sh"
     inst_hook cmdline 50 "$moddir/kdump-boot.sh"
     if dracut_module_included "systemd" ; then
+        mkdir -p "${initdir}/etc/cmdline.d"
+        kdump_cmdline_devices > "${initdir}/etc/cmdline.d/99kdump-device.conf"
 	inst_binary "$moddir/device-timeout-generator" \
 	    "$systemdutildir"/system-generators/kdump-device-timeout-generator
 
@@ -318,4 +359,28 @@ install() {
 
     inst_simple /usr/share/zoneinfo/UTC
     inst_simple /etc/localtime
+
+    # CA certificates for HTTPS uploads to S3
+    for protocol in "${kdump_Protocol[@]}" ; do
+	if [ "$protocol" = "s3" ]; then
+	    inst_multiple -o /etc/ssl/ca-bundle.pem \
+		/var/lib/ca-certificates/ca-bundle.pem
+	fi
+    done
+
+    # kdump-save loads libcurl and libesmtp only when it needs them, so
+    # dracut does not find them as dependencies
+    local _needcurl=
+    for protocol in "${kdump_Protocol[@]}" ; do
+	case "$protocol" in
+	    ftp|s3) _needcurl=y ;;
+	esac
+    done
+    case " $KDUMP_PROGRESS_REPORT " in
+	*" http://"*|*" https://"*) _needcurl=y ;;
+    esac
+    [ -n "$_needcurl" ] && inst_libdir_file "libcurl.so.*"
+    if [ -n "$KDUMP_SMTP_SERVER" -a -n "$KDUMP_NOTIFICATION_TO" ]; then
+	inst_libdir_file "libesmtp.so.*"
+    fi
 }
@@ -0,0 +1,423 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "global.h"
+#include "debug.h"
+#include "asyncwriter.h"
+
+using std::vector;
+
+// number of submission queue entries of the io_uring instance
+#define IOURING_ENTRIES		64
+
+// maximum number of outstanding POSIX AIO requests
+#define AIO_MAX_REQUESTS	16
+
+//{{{ AsyncWriter --------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+AsyncWriter::AsyncWriter(int fd, size_t bufferSize, unsigned depth,
+                         unsigned maxInflight)
+    : m_fd(fd), m_bufferSize(bufferSize), m_slots(depth),
+      m_nextSlot(0), m_inflight(0), m_maxInflight(maxInflight)
+{
+    Debug::debug()->trace("AsyncWriter::AsyncWriter(%d, %zu, %u)",
+        fd, bufferSize, depth);
+
+    // the pool hands out whole pages, which meets ALIGNMENT
+    for (vector<Slot>::iterator it = m_slots.begin();
+         it != m_slots.end(); ++it) {
+        it->data = BufferPool::pool()->get(bufferSize);
+        it->pending = 0;
+    }
+}
+
+// -----------------------------------------------------------------------------
+AsyncWriter::~AsyncWriter()
+{
+}
+
+// -----------------------------------------------------------------------------
+void AsyncWriter::shutdown()
+{
+    while (m_inflight) {
+        try {
+            complete();
+        } catch (const KError &error) {
+            Debug::debug()->dbg("Ignoring error: %s", error.what());
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+void AsyncWriter::complete(void)
+{
+    ssize_t res;
+    Request *req = reap(&res);
+    Request done = *req;
+    delete req;
+
+    --done.slot->pending;
+    --m_inflight;
+
+    if (res < 0)
+        throw KSystemError("Asynchronous write failed", -res);
+
+    // finish short writes synchronously; the rest may not be aligned
+    // for O_DIRECT, and then the file is written through the page cache
+    size_t pos = res;
+    if (pos < done.len &&
+        (reinterpret_cast<unsigned long>(done.data + pos) |
+         (done.offset + pos) | (done.len - pos)) % ALIGNMENT) {
+        int flags = fcntl(m_fd, F_GETFL);
+        if (flags < 0 || ((flags & O_DIRECT) &&
+                          fcntl(m_fd, F_SETFL, flags & ~O_DIRECT) < 0))
+            throw KSystemError("Cannot clear O_DIRECT", errno);
+    }
+    while (pos < done.len) {
+        ssize_t n = pwrite(m_fd, done.data + pos, done.len - pos,
+                           done.offset + pos);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw KSystemError("pwrite() failed", errno);
+        }
+        if (n == 0)
+            throw KError("pwrite() did not write any data.");
+        pos += n;
+    }
+}
+
+// -----------------------------------------------------------------------------
+char *AsyncWriter::getBuffer()
+{
+    Slot &slot = m_slots[m_nextSlot];
+    if (++m_nextSlot == m_slots.size())
+        m_nextSlot = 0;
+
+    while (slot.pending)
+        complete();
+
+    return slot.data.get();
+}
+
+// -----------------------------------------------------------------------------
+void AsyncWriter::write(const char *data, size_t len, off_t offset)
+{
+    Slot *slot = NULL;
+    for (vector<Slot>::iterator it = m_slots.begin();
+         it != m_slots.end(); ++it) {
+        const char *buf = it->data.get();
+        if (data >= buf && data + len <= buf + m_bufferSize) {
+            slot = &*it;
+            break;
+        }
+    }
+    if (!slot)
+        throw KError("AsyncWriter::write(): data outside of I/O buffers.");
+
+    while (m_inflight >= m_maxInflight)
+        complete();
+
+    Request *req = new Request;
+    req->slot = slot;
+    req->data = data;
+    req->len = len;
+    req->offset = offset;
+    try {
+        submit(req);
+    } catch (...) {
+        delete req;
+        throw;
+    }
+
+    ++slot->pending;
+    ++m_inflight;
+}
+
+// -----------------------------------------------------------------------------
+void AsyncWriter::drain()
+{
+    Debug::debug()->trace("AsyncWriter::drain()");
+
+    while (m_inflight)
+        complete();
+}
+
+//}}}
+//{{{ IoUringWriter ------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+// -----------------------------------------------------------------------------
+static int sys_io_uring_enter(int fd, unsigned to_submit,
+                              unsigned min_complete, unsigned flags)
+{
+    return syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+                   flags, NULL, 0);
+}
+
+// -----------------------------------------------------------------------------
+static int sys_io_uring_register(int fd, unsigned opcode,
+                                 void *arg, unsigned nr_args)
+{
+    return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+// -----------------------------------------------------------------------------
+IoUringWriter::IoUringWriter(int fd, size_t bufferSize, unsigned depth)
+    : AsyncWriter(fd, bufferSize, depth, IOURING_ENTRIES),
+      m_ringfd(-1), m_sqring(MAP_FAILED), m_cqring(MAP_FAILED),
+      m_sqes(static_cast<struct io_uring_sqe *>(MAP_FAILED))
+{
+    Debug::debug()->trace("IoUringWriter::IoUringWriter(%d)", fd);
+
+    struct io_uring_params p;
+    memset(&p, 0, sizeof p);
+    m_ringfd = sys_io_uring_setup(IOURING_ENTRIES, &p);
+    if (m_ringfd < 0)
+        throw KSystemError("io_uring_setup() failed", errno);
+
+    try {
+        // IORING_OP_WRITE needs at least Linux 5.6, probe for it
+        size_t probesz = sizeof(struct io_uring_probe) +
+            (IORING_OP_WRITE + 1) * sizeof(struct io_uring_probe_op);
+        vector<char> probebuf(probesz);
+        struct io_uring_probe *probe =
+            reinterpret_cast<struct io_uring_probe *>(&probebuf[0]);
+        if (sys_io_uring_register(m_ringfd, IORING_REGISTER_PROBE,
+                                  probe, IORING_OP_WRITE + 1) < 0)
+            throw KSystemError("Cannot probe io_uring operations", errno);
+        if (probe->last_op < IORING_OP_WRITE ||
+            !(probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED))
+            throw KError("io_uring does not support IORING_OP_WRITE.");
+
+        m_sqringSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        m_cqringSize = p.cq_off.cqes +
+            p.cq_entries * sizeof(struct io_uring_cqe);
+        if (p.features & IORING_FEAT_SINGLE_MMAP) {
+            if (m_cqringSize > m_sqringSize)
+                m_sqringSize = m_cqringSize;
+            m_cqringSize = m_sqringSize;
+        }
+
+        m_sqring = mmap(NULL, m_sqringSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, m_ringfd,
+                        IORING_OFF_SQ_RING);
+        if (m_sqring == MAP_FAILED)
+            throw KSystemError("Cannot map io_uring submission ring",
+                               errno);
+
+        if (p.features & IORING_FEAT_SINGLE_MMAP)
+            m_cqring = m_sqring;
+        else {
+            m_cqring = mmap(NULL, m_cqringSize, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, m_ringfd,
+                            IORING_OFF_CQ_RING);
+            if (m_cqring == MAP_FAILED)
+                throw KSystemError("Cannot map io_uring completion ring",
+                                   errno);
+        }
+
+        m_sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+        m_sqes = static_cast<struct io_uring_sqe *>(
+            mmap(NULL, m_sqesSize, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, m_ringfd, IORING_OFF_SQES));
+        if (m_sqes == MAP_FAILED)
+            throw KSystemError("Cannot map io_uring submission entries",
+                               errno);
+    } catch (...) {
+        release();
+        throw;
+    }
+
+    char *sq = static_cast<char *>(m_sqring);
+    m_sqtail = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+    m_sqmask = reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+    m_sqarray = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+
+    char *cq = static_cast<char *>(m_cqring);
+    m_cqhead = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+    m_cqtail = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+    m_cqmask = reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+    m_cqes = reinterpret_cast<struct io_uring_cqe *>(cq + p.cq_off.cqes);
+}
+
+// -----------------------------------------------------------------------------
+IoUringWriter::~IoUringWriter()
+{
+    shutdown();
+    release();
+}
+
+// -----------------------------------------------------------------------------
+void IoUringWriter::release(void)
+{
+    if (m_sqes != MAP_FAILED)
+        munmap(m_sqes, m_sqesSize);
+    if (m_cqring != MAP_FAILED && m_cqring != m_sqring)
+        munmap(m_cqring, m_cqringSize);
+    if (m_sqring != MAP_FAILED)
+        munmap(m_sqring, m_sqringSize);
+    if (m_ringfd >= 0)
+        close(m_ringfd);
+}
+
+// -----------------------------------------------------------------------------
+void IoUringWriter::submit(Request *req)
+{
+    // the base class never has more than IOURING_ENTRIES requests
+    // in flight, so there is always a free submission queue entry
+    unsigned tail = *m_sqtail;
+    unsigned idx = tail & *m_sqmask;
+    struct io_uring_sqe *sqe = &m_sqes[idx];
+
+    memset(sqe, 0, sizeof *sqe);
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = m_fd;
+    sqe->addr = reinterpret_cast<unsigned long>(req->data);
+    sqe->len = req->len;
+    sqe->off = req->offset;
+    sqe->user_data = reinterpret_cast<unsigned long>(req);
+    m_sqarray[idx] = idx;
+    __atomic_store_n(m_sqtail, tail + 1, __ATOMIC_RELEASE);
+
+    while (sys_io_uring_enter(m_ringfd, 1, 0, 0) < 0) {
+        if (errno != EINTR && errno != EAGAIN)
+            throw KSystemError("io_uring_enter() failed", errno);
+    }
+}
+
+// -----------------------------------------------------------------------------
+AsyncWriter::Request *IoUringWriter::reap(ssize_t *result)
+{
+    unsigned head = *m_cqhead;
+    while (head == __atomic_load_n(m_cqtail, __ATOMIC_ACQUIRE)) {
+        if (sys_io_uring_enter(m_ringfd, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+            errno != EINTR)
+            throw KSystemError("io_uring_enter() failed", errno);
+    }
+
+    struct io_uring_cqe *cqe = &m_cqes[head & *m_cqmask];
+    Request *req = reinterpret_cast<Request *>(cqe->user_data);
+    *result = cqe->res;
+    __atomic_store_n(m_cqhead, head + 1, __ATOMIC_RELEASE);
+
+    return req;
+}
+
+//}}}
+//{{{ PosixAioWriter -----------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+PosixAioWriter::PosixAioWriter(int fd, size_t bufferSize, unsigned depth)
+    : AsyncWriter(fd, bufferSize, depth, AIO_MAX_REQUESTS),
+      m_cbs(AIO_MAX_REQUESTS), m_reqs(AIO_MAX_REQUESTS, NULL)
+{
+    Debug::debug()->trace("PosixAioWriter::PosixAioWriter(%d)", fd);
+}
+
+// -----------------------------------------------------------------------------
+PosixAioWriter::~PosixAioWriter()
+{
+    shutdown();
+}
+
+// -----------------------------------------------------------------------------
+void PosixAioWriter::submit(Request *req)
+{
+    size_t i = 0;
+    while (m_reqs[i])
+        ++i;
+
+    struct aiocb *cb = &m_cbs[i];
+    memset(cb, 0, sizeof *cb);
+    cb->aio_fildes = m_fd;
+    cb->aio_buf = const_cast<char *>(req->data);
+    cb->aio_nbytes = req->len;
+    cb->aio_offset = req->offset;
+    cb->aio_sigevent.sigev_notify = SIGEV_NONE;
+
+    if (aio_write(cb) != 0)
+        throw KSystemError("aio_write() failed", errno);
+    m_reqs[i] = req;
+}
+
+// -----------------------------------------------------------------------------
+AsyncWriter::Request *PosixAioWriter::reap(ssize_t *result)
+{
+    while (true) {
+        vector<const struct aiocb *> list;
+        for (size_t i = 0; i < m_reqs.size(); ++i) {
+            if (!m_reqs[i])
+                continue;
+
+            int err = aio_error(&m_cbs[i]);
+            if (err == EINPROGRESS) {
+                list.push_back(&m_cbs[i]);
+                continue;
+            }
+
+            ssize_t ret = aio_return(&m_cbs[i]);
+            *result = err ? -err : ret;
+
+            Request *req = m_reqs[i];
+            m_reqs[i] = NULL;
+            return req;
+        }
+
+        if (list.empty())
+            throw KError("PosixAioWriter::reap(): no pending requests.");
+
+        if (aio_suspend(&list[0], list.size(), NULL) != 0 &&
+            errno != EINTR && errno != EAGAIN)
+            throw KSystemError("aio_suspend() failed", errno);
+    }
+}
+
+//}}}
+//{{{ AsyncWriter factory ------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+AsyncWriter *AsyncWriter::create(int fd, size_t bufferSize, unsigned depth)
+{
+    try {
+        return new IoUringWriter(fd, bufferSize, depth);
+    } catch (const KError &error) {
+        Debug::debug()->dbg("io_uring not available: %s", error.what());
+    }
+
+    return new PosixAioWriter(fd, bufferSize, depth);
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef ASYNCWRITER_H
+#define ASYNCWRITER_H
+
+#include <vector>
+#include <sys/types.h>
+#include <aio.h>
+
+#include "bufferpool.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+//{{{ AsyncWriter --------------------------------------------------------------
+
+/**
+ * Writes a file through a ring of aligned buffers, so that several
+ * writes are in flight while the caller fills the next buffer.
+ *
+ * Usage pattern:
+ *
+ *  - get a free buffer with getBuffer(),
+ *  - fill it and queue one or more ranges of it with write(),
+ *  - call drain() to wait for all pending writes.
+ *
+ * All buffers are aligned to alignment(), so they can be used with
+ * O_DIRECT file descriptors. The caller is responsible for keeping
+ * the file offsets and lengths aligned if the file is opened with
+ * O_DIRECT. The rest of a short write is written synchronously; if it
+ * is not aligned, O_DIRECT is cleared on the file descriptor first.
+ */
+class AsyncWriter {
+
+    public:
+
+        /**
+         * Creates the best available writer for a file descriptor.
+         * io_uring is preferred; POSIX AIO is used if the kernel
+         * does not support io_uring.
+         *
+         * @param[in] fd file descriptor open for writing
+         * @param[in] bufferSize size of each buffer in the ring
+         * @param[in] depth number of buffers in the ring
+         * @exception KError if no asynchronous engine can be set up
+         */
+        static AsyncWriter *create(int fd, size_t bufferSize, unsigned depth);
+
+        /**
+         * Waits for all pending writes and frees the buffers.
+         * Errors from pending writes are ignored here; call drain()
+         * before destroying the object to get them reported.
+         */
+        virtual ~AsyncWriter();
+
+        /**
+         * Returns the name of the underlying engine (for debugging).
+         */
+        virtual const char *engineName() const = 0;
+
+        /**
+         * Returns the size of each buffer.
+         */
+        size_t bufferSize() const
+        { return m_bufferSize; }
+
+        /**
+         * Returns the alignment of the buffers.
+         */
+        static size_t alignment()
+        { return ALIGNMENT; }
+
+        /**
+         * Returns the next free buffer, waiting for its previous
+         * writes to complete if necessary.
+         *
+         * @exception KError if a pending write has failed
+         */
+        char *getBuffer();
+
+        /**
+         * Queues a write of a range of a buffer returned by getBuffer().
+         * The buffer must not be modified until it is returned again by
+         * getBuffer().
+         *
+         * @param[in] data start of the data (inside a ring buffer)
+         * @param[in] len number of bytes to write
+         * @param[in] offset target file offset
+         * @exception KError if the write cannot be queued
+         */
+        void write(const char *data, size_t len, off_t offset);
+
+        /**
+         * Waits until all queued writes are finished.
+         *
+         * @exception KError if a pending write has failed
+         */
+        void drain();
+
+    protected:
+
+        static const size_t ALIGNMENT = 4096;
+
+        /**
+         * One buffer of the ring.
+         */
+        struct Slot {
+            BufferPool::Buffer data;
+            unsigned pending;
+        };
+
+        /**
+         * One queued write.
+         */
+        struct Request {
+            Slot *slot;
+            const char *data;
+            size_t len;
+            off_t offset;
+        };
+
+        AsyncWriter(int fd, size_t bufferSize, unsigned depth,
+                    unsigned maxInflight);
+
+        /**
+         * Passes a request to the engine.
+         */
+        virtual void submit(Request *req) = 0;
+
+        /**
+         * Waits for one request to complete.
+         *
+         * @param[out] result number of bytes written, or a negative
+         *             errno value
+         * @return the completed request
+         */
+        virtual Request *reap(ssize_t *result) = 0;
+
+        /**
+         * Called from the destructors of the derived classes to wait
+         * for pending requests while the engine still exists.
+         */
+        void shutdown();
+
+        int m_fd;
+
+    private:
+        void complete(void);
+
+        size_t m_bufferSize;
+        std::vector<Slot> m_slots;
+        unsigned m_nextSlot;
+        unsigned m_inflight;
+        unsigned m_maxInflight;
+};
+
+//}}}
+//{{{ IoUringWriter ------------------------------------------------------------
+
+/**
+ * AsyncWriter implemented with a bare io_uring instance.
+ *
+ * liburing is deliberately not used; only a tiny subset of the interface
+ * is needed, and the dump environment should not need another library.
+ */
+class IoUringWriter : public AsyncWriter {
+
+    public:
+        IoUringWriter(int fd, size_t bufferSize, unsigned depth);
+        ~IoUringWriter();
+
+        const char *engineName() const
+        { return "io_uring"; }
+
+    protected:
+        void submit(Request *req);
+        Request *reap(ssize_t *result);
+
+    private:
+        void release(void);
+
+        int m_ringfd;
+
+        void *m_sqring;
+        size_t m_sqringSize;
+        unsigned *m_sqtail;
+        unsigned *m_sqmask;
+        unsigned *m_sqarray;
+
+        void *m_cqring;
+        size_t m_cqringSize;
+        unsigned *m_cqhead;
+        unsigned *m_cqtail;
+        unsigned *m_cqmask;
+        struct io_uring_cqe *m_cqes;
+
+        struct io_uring_sqe *m_sqes;
+        size_t m_sqesSize;
+};
+
+//}}}
+//{{{ PosixAioWriter -----------------------------------------------------------
+
+/**
+ * AsyncWriter implemented with POSIX AIO, for kernels without io_uring.
+ */
+class PosixAioWriter : public AsyncWriter {
+
+    public:
+        PosixAioWriter(int fd, size_t bufferSize, unsigned depth);
+        ~PosixAioWriter();
+
+        const char *engineName() const
+        { return "POSIX AIO"; }
+
+    protected:
+        void submit(Request *req);
+        Request *reap(ssize_t *result);
+
+    private:
+        std::vector<struct aiocb> m_cbs;
+        std::vector<Request *> m_reqs;
+};
+
+//}}}
+
+#endif /* ASYNCWRITER_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cctype>
+#include <cstring>
+
+#include "global.h"
+#include "debug.h"
+#include "batch.h"
+#include "kdumptool.h"
+
+using std::string;
+using std::vector;
+using std::cin;
+using std::cout;
+using std::cerr;
+using std::endl;
+
+//{{{ Batch --------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+Batch::Batch(const KdumpTool &parent, Registrar registrar)
+    : m_parent(parent), m_registrar(registrar)
+{
+    m_options.push_back(new StringOption("marker", 'm', &m_marker,
+        "Print the marker and the exit status after each command"));
+}
+
+// -----------------------------------------------------------------------------
+const char *Batch::getName() const
+{
+    return "batch";
+}
+
+// -----------------------------------------------------------------------------
+bool Batch::needsConfigfile() const
+{
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+void Batch::parseArgs(const StringVector &args)
+{
+    Debug::debug()->trace("Batch::parseArgs(%s)", args.join(' ').c_str());
+
+    m_commands.clear();
+    StringVector command;
+    for (StringVector::const_iterator it = args.begin();
+         it != args.end(); ++it) {
+        if (*it != ";") {
+            command.push_back(*it);
+        } else if (!command.empty()) {
+            m_commands.push_back(command);
+            command.clear();
+        }
+    }
+    if (!command.empty())
+        m_commands.push_back(command);
+}
+
+// -----------------------------------------------------------------------------
+bool Batch::splitCommand(const string &line, StringVector &words)
+{
+    words.clear();
+
+    string word;
+    bool inWord = false;
+    string::size_type i = 0;
+    while (i < line.size()) {
+        char c = line[i++];
+        if (c == '\'') {
+            string::size_type end = line.find('\'', i);
+            if (end == string::npos)
+                throw KError("Unterminated single quote: " + line);
+            word.append(line, i, end - i);
+            i = end + 1;
+            inWord = true;
+        } else if (c == '"') {
+            for (;;) {
+                if (i >= line.size())
+                    throw KError("Unterminated double quote: " + line);
+                c = line[i++];
+                if (c == '"')
+                    break;
+                // same escapes as in a double-quoted shell word
+                if (c == '\\' && i < line.size() &&
+                    strchr("\\\"$`", line[i]))
+                    c = line[i++];
+                word += c;
+            }
+            inWord = true;
+        } else if (c == '\\') {
+            if (i < line.size())
+                word += line[i++];
+            inWord = true;
+        } else if (isspace((unsigned char)c)) {
+            if (inWord)
+                words.push_back(word);
+            word.clear();
+            inWord = false;
+        } else if (c == '#' && !inWord) {
+            break;
+        } else {
+            word += c;
+            inWord = true;
+        }
+    }
+    if (inWord)
+        words.push_back(word);
+
+    return !words.empty();
+}
+
+// -----------------------------------------------------------------------------
+int Batch::run(const StringVector &command)
+{
+    Debug::debug()->dbg("Batch command: %s", command.join(' ').c_str());
+
+    // the global options of the batch apply to every command
+    vector<string> args;
+    args.push_back("kdumptool");
+    args.push_back("--configfile");
+    args.push_back(m_parent.getConfigfile());
+    args.insert(args.end(), command.begin(), command.end());
+
+    vector<char *> argv;
+    for (vector<string>::iterator it = args.begin(); it != args.end(); ++it)
+        argv.push_back(&(*it)[0]);
+    argv.push_back(NULL);
+
+    KdumpTool kdt;
+    m_registrar(kdt);
+
+    bool exception = false;
+    try {
+        kdt.parseCommandline(argv.size() - 1, &argv[0]);
+        kdt.readConfiguration();
+        kdt.execute();
+    } catch (const KError &ke) {
+        cerr << ke.what() << endl;
+        exception = true;
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        exception = true;
+    }
+
+    // keep the output of each command together
+    cout.flush();
+    fflush(stdout);
+
+    int status = kdt.getErrorCode() & 0xff;
+    if (exception && status == 0)
+        status = 255;
+    return status;
+}
+
+// -----------------------------------------------------------------------------
+void Batch::execute()
+{
+    Debug::debug()->trace("Batch::execute()");
+
+    int result = 0;
+    vector<StringVector>::const_iterator next = m_commands.begin();
+    for (;;) {
+        int status;
+        if (m_commands.empty()) {
+            string line;
+            if (!getline(cin, line))
+                break;
+
+            StringVector words;
+            try {
+                if (!splitCommand(line, words))
+                    continue;
+                status = run(words);
+            } catch (const KError &ke) {
+                cerr << ke.what() << endl;
+                status = 255;
+            }
+        } else if (next != m_commands.end()) {
+            status = run(*next++);
+        } else
+            break;
+
+        if (!m_marker.empty())
+            cout << m_marker << ' ' << status << endl;
+        if (status != 0) {
+            if (result == 0)
+                result = status;
+            // without a marker, the caller cannot tell which one failed
+            if (m_marker.empty())
+                break;
+        }
+    }
+
+    if (result != 0)
+        setErrorCode(result);
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <vector>
+
+#include "global.h"
+#include "subcommand.h"
+#include "stringvector.h"
+
+class KdumpTool;
+
+//{{{ Batch --------------------------------------------------------------------
+
+/**
+ * Subcommand to run several subcommands in one process.
+ *
+ * The commands are taken from the command line, separated by ";"
+ * arguments, or read from stdin, one per line. Each command gets a
+ * fresh KdumpTool and fresh subcommand objects, but the configuration
+ * file is read only once, and the mount tables and the kernel cache
+ * are kept in memory between the commands.
+ */
+class Batch : public Subcommand {
+
+    public:
+        /**
+         * Function that adds all subcommands to a KdumpTool.
+         */
+        typedef void (*Registrar)(KdumpTool &kdt);
+
+        /**
+         * Creates a new Batch object.
+         *
+         * @param[in] parent the KdumpTool that runs the batch, for the
+         *            global options
+         * @param[in] registrar adds the subcommands to the KdumpTool of
+         *            each command
+         */
+        Batch(const KdumpTool &parent, Registrar registrar);
+
+    public:
+        /**
+         * Returns the name of the subcommand (batch).
+         */
+        const char *getName() const;
+
+        /**
+         * The configuration is read by the commands that need it.
+         */
+        bool needsConfigfile() const;
+
+        /**
+         * Splits the arguments into commands at ";".
+         */
+        void parseArgs(const StringVector &args);
+
+        /**
+         * Executes the function.
+         *
+         * @throw KError on any error. No exception indicates success.
+         */
+        void execute();
+
+        /**
+         * Runs one command.
+         *
+         * @param[in] command the subcommand and its options and arguments
+         * @return the exit status of the command
+         */
+        int run(const StringVector &command);
+
+        /**
+         * Splits a command line into words like the shell does: words
+         * are separated by white space, single quotes, double quotes and
+         * backslashes quote, and "#" starts a comment.
+         *
+         * @param[in] line the command line
+         * @param[out] words the words of the line
+         * @return @c false if the line has no words
+         * @exception KError if a quote is not terminated
+         */
+        static bool splitCommand(const std::string &line, StringVector &words);
+
+    private:
+        const KdumpTool &m_parent;
+        Registrar m_registrar;
+        std::string m_marker;
+        std::vector<StringVector> m_commands;
+};
+
+//}}}
+
+#endif /* BATCH_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
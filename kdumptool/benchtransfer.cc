@@ -0,0 +1,383 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <stdint.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "global.h"
+#include "debug.h"
+#include "benchtransfer.h"
+#include "configuration.h"
+#include "flattened.h"
+#include "fileutil.h"
+#include "rootdirurl.h"
+#include "savedump.h"
+#include "stringutil.h"
+#include "stripewriter.h"
+#include "streamrecord.h"
+#include "transfer.h"
+
+using std::string;
+using std::cout;
+using std::endl;
+
+#define BENCH_PAGE_SIZE     4096
+#define BENCH_FILE          "bench"
+#define BENCH_DATETIME      "%Y-%m-%d-%H:%M:%S"
+
+// -----------------------------------------------------------------------------
+/**
+ * Scrambles a 64-bit number (the finalizer of splitmix64).
+ */
+static inline uint64_t mix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// -----------------------------------------------------------------------------
+static void putBE64(char *p, unsigned long long value)
+{
+    for (int i = 7; i >= 0; --i) {
+        p[i] = value & 0xff;
+        value >>= 8;
+    }
+}
+
+//{{{ SyntheticDataProvider ----------------------------------------------------
+
+// -----------------------------------------------------------------------------
+SyntheticDataProvider::SyntheticDataProvider(Pattern pattern,
+                                             unsigned long long size,
+                                             unsigned zeroPercent)
+    : m_pattern(pattern), m_pages(size / BENCH_PAGE_SIZE),
+      m_zeroPercent(std::min(zeroPercent, 100U)), m_page(0),
+      m_header(false), m_end(false), m_segmentPos(0), m_produced(0),
+      m_pending(false)
+{ }
+
+// -----------------------------------------------------------------------------
+SyntheticDataProvider::Pattern
+SyntheticDataProvider::parsePattern(const string &name)
+{
+    if (name == "zero")
+        return SP_ZERO;
+    else if (name == "random")
+        return SP_RANDOM;
+    else if (name == "mixed")
+        return SP_MIXED;
+    else if (name == "flattened")
+        return SP_FLATTENED;
+    else
+        throw KError("Unknown data pattern: " + name + ".");
+}
+
+// -----------------------------------------------------------------------------
+bool SyntheticDataProvider::isZeroPage(unsigned long long page) const
+{
+    switch (m_pattern) {
+        case SP_ZERO:
+            return true;
+        case SP_RANDOM:
+            return false;
+        default:
+            return mix64(page) % 100 < m_zeroPercent;
+    }
+}
+
+// -----------------------------------------------------------------------------
+void SyntheticDataProvider::fillPage(char *buffer,
+                                     unsigned long long page) const
+{
+    if (isZeroPage(page)) {
+        memset(buffer, 0, BENCH_PAGE_SIZE);
+        return;
+    }
+
+    // xorshift is fast enough not to slow down the transfer
+    uint64_t x = mix64(~page) | 1;
+    for (size_t pos = 0; pos < BENCH_PAGE_SIZE; pos += sizeof x) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        memcpy(buffer + pos, &x, sizeof x);
+    }
+}
+
+// -----------------------------------------------------------------------------
+bool SyntheticDataProvider::nextSegment()
+{
+    m_segmentPos = 0;
+
+    if (m_pattern != SP_FLATTENED) {
+        if (m_page >= m_pages) {
+            m_segment.clear();
+            return false;
+        }
+        m_segment.resize(BENCH_PAGE_SIZE);
+        fillPage(&m_segment[0], m_page++);
+        return true;
+    }
+
+    if (!m_header) {
+        m_segment.assign(FLAT_HEADER_SIZE, 0);
+        memcpy(&m_segment[0], FLAT_SIGNATURE, sizeof FLAT_SIGNATURE);
+        putBE64(&m_segment[16], FLAT_TYPE);
+        putBE64(&m_segment[24], FLAT_VERSION);
+        m_header = true;
+        return true;
+    }
+
+    // like excluded pages, zero pages have no record
+    while (m_page < m_pages && isZeroPage(m_page))
+        ++m_page;
+
+    if (m_page < m_pages) {
+        m_segment.resize(FLAT_RECORD_SIZE + BENCH_PAGE_SIZE);
+        putBE64(&m_segment[0], m_page * BENCH_PAGE_SIZE);
+        putBE64(&m_segment[8], BENCH_PAGE_SIZE);
+        fillPage(&m_segment[FLAT_RECORD_SIZE], m_page++);
+        return true;
+    }
+
+    if (m_end) {
+        m_segment.clear();
+        return false;
+    }
+    m_segment.resize(FLAT_RECORD_SIZE);
+    putBE64(&m_segment[0], FLAT_END_FLAG);
+    putBE64(&m_segment[8], FLAT_END_FLAG);
+    m_end = true;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+size_t SyntheticDataProvider::getData(char *buffer, size_t maxread)
+{
+    // the previous chunk has been written
+    Clock::time_point now = Clock::now();
+    if (m_pending)
+        m_latencies.push_back(
+            std::chrono::duration<double>(now - m_last).count());
+
+    size_t ret = 0;
+    while (ret < maxread) {
+        if (m_segmentPos == m_segment.size() && !nextSegment())
+            break;
+        size_t len = std::min(maxread - ret, m_segment.size() - m_segmentPos);
+        memcpy(buffer + ret, &m_segment[m_segmentPos], len);
+        m_segmentPos += len;
+        ret += len;
+    }
+
+    m_produced += ret;
+    m_pending = ret > 0;
+    m_last = Clock::now();
+    return ret;
+}
+
+//}}}
+//{{{ BenchTransfer ------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+BenchTransfer::BenchTransfer()
+    : m_pattern("mixed"), m_size(1024), m_zeroPercent(50), m_streams(1),
+      m_keep(false), m_realtime(false)
+{
+    m_options.push_back(new StringOption("target", 'u', &m_target,
+        "Use this URL instead of KDUMP_SAVEDIR"));
+    m_options.push_back(new StringOption("pattern", 'p', &m_pattern,
+        "Data pattern: zero, random, mixed (default) or flattened"));
+    m_options.push_back(new IntOption("size", 's', &m_size,
+        "Save this many MiB (default 1024)"));
+    m_options.push_back(new IntOption("zero", 'z', &m_zeroPercent,
+        "Percentage of zero pages (default 50)"));
+    m_options.push_back(new IntOption("streams", 'n', &m_streams,
+        "Stripe the data over this many connections or files"));
+    m_options.push_back(new FlagOption("keep", 'k', &m_keep,
+        "Keep the data in a local target"));
+    m_options.push_back(new StringOption("replay", 'r', &m_replay,
+        "Save a recorded makedumpfile stream instead of synthetic data"));
+    m_options.push_back(new FlagOption("realtime", 't', &m_realtime,
+        "Replay the stream with the recorded timing"));
+}
+
+// -----------------------------------------------------------------------------
+const char *BenchTransfer::getName() const
+{
+    return "bench-transfer";
+}
+
+// -----------------------------------------------------------------------------
+static double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0.0;
+    return sorted[size_t(p * (sorted.size() - 1) + 0.5)];
+}
+
+// -----------------------------------------------------------------------------
+static double seconds(const struct timeval &tv)
+{
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+// -----------------------------------------------------------------------------
+void BenchTransfer::execute()
+{
+    KTRACE("BenchTransfer::execute()");
+
+    Configuration *config = Configuration::config();
+
+    SyntheticDataProvider::Pattern pattern =
+        SyntheticDataProvider::parsePattern(m_pattern);
+    if (m_size <= 0)
+        throw KError("Invalid size: " + StringUtil::number2string(m_size));
+    if (m_zeroPercent < 0 || m_zeroPercent > 100)
+        throw KError("Invalid percentage of zero pages: " +
+                     StringUtil::number2string(m_zeroPercent));
+
+    // like a dump, the data goes to a new subdirectory
+    string subdir = "bench-" +
+        StringUtil::formatUnixTime(BENCH_DATETIME, time(NULL));
+    RootDirURLVector urlv;
+    std::istringstream iss(m_target.empty()
+                           ? config->KDUMP_SAVEDIR.value()
+                           : m_target);
+    FilePath elem;
+    string targets;
+    while (iss >> elem) {
+        elem.appendPath(subdir);
+        urlv.push_back(RootDirURL(elem, string()));
+        if (!targets.empty())
+            targets += ' ';
+        targets += urlv.back().getURL();
+    }
+
+    SaveDump saver;
+    std::unique_ptr<Transfer> transfer(saver.getTransfer(urlv));
+    if (m_streams > 1 && !transfer->canStripe())
+        throw KError("The target cannot be striped.");
+
+    // a recording is always the flattened output of makedumpfile
+    std::unique_ptr<SyntheticDataProvider> synth;
+    std::unique_ptr<ReplayDataProvider> replay;
+    std::unique_ptr<FlattenedDataProvider> flattened;
+    DataProvider *provider;
+    if (!m_replay.empty()) {
+        replay.reset(new ReplayDataProvider(m_replay, m_realtime));
+        flattened.reset(new FlattenedDataProvider(replay.get()));
+        provider = flattened.get();
+    } else {
+        synth.reset(new SyntheticDataProvider(
+            pattern, (unsigned long long)m_size << 20, m_zeroPercent));
+        provider = synth.get();
+        if (pattern == SyntheticDataProvider::SP_FLATTENED) {
+            flattened.reset(new FlattenedDataProvider(synth.get()));
+            provider = flattened.get();
+        }
+    }
+
+    struct rusage self0, self1, children0, children1;
+    getrusage(RUSAGE_SELF, &self0);
+    getrusage(RUSAGE_CHILDREN, &children0);
+    SyntheticDataProvider::Clock::time_point start =
+        SyntheticDataProvider::Clock::now();
+
+    if (m_streams > 1)
+        transfer->performStriped(provider, BENCH_FILE, STRIPE_CHUNK_SIZE,
+                                 m_streams);
+    else
+        transfer->perform(provider, BENCH_FILE);
+
+    double elapsed = std::chrono::duration<double>(
+        SyntheticDataProvider::Clock::now() - start).count();
+    getrusage(RUSAGE_SELF, &self1);
+    getrusage(RUSAGE_CHILDREN, &children1);
+
+    std::vector<double> lat(replay ? replay->latencies()
+                            : synth->latencies());
+    std::sort(lat.begin(), lat.end());
+
+    double mib = (replay ? replay->produced() : synth->produced()) /
+        1048576.0;
+    cout << std::fixed << std::setprecision(1);
+    cout << "Target:     " << targets << endl;
+    if (replay) {
+        cout << "Replay:     " << m_replay;
+        if (m_realtime)
+            cout << ", recorded in " << std::setprecision(3)
+                 << replay->duration() << " s" << std::setprecision(1);
+    } else
+        cout << "Pattern:    " << m_pattern;
+    if (!replay && (pattern == SyntheticDataProvider::SP_MIXED ||
+                    pattern == SyntheticDataProvider::SP_FLATTENED))
+        cout << ", " << m_zeroPercent << "% zero pages";
+    if (m_streams > 1)
+        cout << ", " << m_streams << " streams";
+    cout << endl;
+    cout << "Data:       " << mib << " MiB in " << std::setprecision(3)
+         << elapsed << " s, " << std::setprecision(1)
+         << (elapsed > 0 ? mib / elapsed : 0.0) << " MiB/s" << endl;
+    cout << "Chunks:     " << lat.size() << ", latency (ms) p50 "
+         << std::setprecision(3) << percentile(lat, 0.5) * 1000
+         << ", p90 " << percentile(lat, 0.9) * 1000
+         << ", p99 " << percentile(lat, 0.99) * 1000
+         << ", max " << percentile(lat, 1.0) * 1000 << endl;
+    cout << "CPU time:   "
+         << seconds(self1.ru_utime) - seconds(self0.ru_utime) << " s user, "
+         << seconds(self1.ru_stime) - seconds(self0.ru_stime) << " s system"
+         << endl;
+    cout << "Children:   "
+         << seconds(children1.ru_utime) - seconds(children0.ru_utime)
+         << " s user, "
+         << seconds(children1.ru_stime) - seconds(children0.ru_stime)
+         << " s system" << endl;
+
+    if (m_keep)
+        return;
+
+    // remote targets have no way to remove a file
+    RootDirURLVector::const_iterator it;
+    for (it = urlv.begin(); it != urlv.end(); ++it) {
+        if (it->getProtocol() != URLParser::PROT_FILE) {
+            cout << "The data is left in " << it->getURL() << endl;
+            continue;
+        }
+        try {
+            FilePath(it->getRealPath()).rmdir(true);
+        } catch (const KError &error) {
+            cout << "WARNING: " << error.what() << endl;
+        }
+    }
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
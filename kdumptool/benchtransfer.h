@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef BENCHTRANSFER_H
+#define BENCHTRANSFER_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "global.h"
+#include "subcommand.h"
+#include "dataprovider.h"
+
+//{{{ SyntheticDataProvider ----------------------------------------------------
+
+/**
+ * DataProvider that generates a dump-like stream instead of reading one.
+ *
+ * The stream is made of pages. Which pages are zero and what the other
+ * pages contain only depends on the page number, so the same options
+ * always give the same data. The FLATTENED pattern produces the makedumpfile
+ * flattened format, with one record for each page that is not zero; it has
+ * to be read through a FlattenedDataProvider, like the output of
+ * makedumpfile -F.
+ *
+ * The time between two calls to getData() is the time the transfer needed
+ * for the previous chunk. It is recorded for each chunk, see latencies().
+ */
+class SyntheticDataProvider : public AbstractDataProvider {
+
+    public:
+        /**
+         * Contents of the stream.
+         */
+        enum Pattern {
+            SP_ZERO,            // all pages are zero
+            SP_RANDOM,          // no page is zero or compresses
+            SP_MIXED,           // random pages with the given zero ratio
+            SP_FLATTENED        // SP_MIXED in flattened format
+        };
+
+        typedef std::chrono::steady_clock Clock;
+
+        /**
+         * Creates a new stream.
+         *
+         * @param[in] pattern the contents
+         * @param[in] size size of the (unflattened) data in bytes
+         * @param[in] zeroPercent share of zero pages for SP_MIXED and
+         *                        SP_FLATTENED (0 to 100)
+         */
+        SyntheticDataProvider(Pattern pattern, unsigned long long size,
+                              unsigned zeroPercent);
+
+        /**
+         * Parses the name of a pattern ("zero", "random", "mixed" or
+         * "flattened").
+         *
+         * @exception KError if the name is unknown
+         */
+        static Pattern parsePattern(const std::string &name);
+
+        size_t getData(char *buffer, size_t maxread);
+
+        /**
+         * Returns the number of bytes returned by getData() so far.
+         */
+        unsigned long long produced() const
+        { return m_produced; }
+
+        /**
+         * Returns the time in seconds between the chunks, in the order
+         * they have been requested.
+         */
+        const std::vector<double> &latencies() const
+        { return m_latencies; }
+
+    private:
+        bool isZeroPage(unsigned long long page) const;
+        void fillPage(char *buffer, unsigned long long page) const;
+        bool nextSegment();
+
+        Pattern m_pattern;
+        unsigned long long m_pages;
+        unsigned m_zeroPercent;
+
+        unsigned long long m_page;          // next page to generate
+        bool m_header;                      // flattened header is done
+        bool m_end;                         // no more segments
+        std::vector<char> m_segment;        // data for the next reads
+        size_t m_segmentPos;
+
+        unsigned long long m_produced;
+        std::vector<double> m_latencies;
+        Clock::time_point m_last;           // end of the last getData()
+        bool m_pending;                     // a chunk is being written
+};
+
+//}}}
+//{{{ BenchTransfer ------------------------------------------------------------
+
+/**
+ * Subcommand to measure the throughput of a dump target by saving
+ * synthetic data with the same Transfer as a real dump. Instead of
+ * synthetic data, it can also replay a makedumpfile stream recorded
+ * with KDUMP_RECORD_STREAM (see ReplayDataProvider).
+ */
+class BenchTransfer : public Subcommand {
+
+    public:
+        /**
+         * Creates a new BenchTransfer object.
+         */
+        BenchTransfer();
+
+    public:
+        /**
+         * Returns the name of the subcommand (bench-transfer).
+         */
+        const char *getName() const;
+
+        /**
+         * Executes the function.
+         *
+         * @throw KError on any error. No exception indicates success.
+         */
+        void execute();
+
+    private:
+        std::string m_target;
+        std::string m_pattern;
+        int m_size;
+        int m_zeroPercent;
+        int m_streams;
+        bool m_keep;
+        std::string m_replay;
+        bool m_realtime;
+};
+
+//}}}
+
+#endif /* BENCHTRANSFER_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "global.h"
+#include "debug.h"
+#include "configuration.h"
+#include "fileutil.h"
+#include "memorywatch.h"
+#include "stringutil.h"
+#include "vmcorecontext.h"
+#include "bitmapplan.h"
+
+using std::string;
+
+//{{{ BitmapPlan ---------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+static unsigned long long divRoundUp(unsigned long long a,
+                                     unsigned long long b)
+{
+    return (a + b - 1) / b;
+}
+
+// -----------------------------------------------------------------------------
+BitmapPlan::BitmapPlan(unsigned long long maxPfn,
+                       unsigned long long availableKb,
+                       unsigned long processes, unsigned long threads,
+                       const string &workDir, unsigned long long workDirFree)
+    : m_location(DEFAULT), m_bitmapKb(divRoundUp(maxPfn, 8 * 1024)),
+      m_bufferKb(0), m_cycles(0)
+{
+    Debug::debug()->trace("BitmapPlan::BitmapPlan(%llu, %llu, %lu, %lu, "
+                          "%s, %llu)", maxPfn, availableKb, processes,
+                          threads, workDir.c_str(), workDirFree);
+
+    if (!m_bitmapKb)
+        return;
+    if (!processes)
+        processes = 1;
+
+    // each process has both bitmaps for its share of the page frames
+    unsigned long long share = availableKb * MEMORY_PCT / 100;
+    unsigned long long threadKb = (unsigned long long)threads * THREAD_KB;
+    share = share > threadKb ? share - threadKb : 0;
+    unsigned long long fitKb = share / processes / 2;
+    unsigned long long neededKb = divRoundUp(m_bitmapKb, processes);
+
+    if (fitKb >= neededKb) {
+        m_location = MEMORY;
+        m_bufferKb = neededKb;
+        m_cycles = 1;
+    } else if (!workDir.empty() && workDirFree >= 2 * m_bitmapKb << 10) {
+        m_location = DISK;
+        m_workDir = workDir;
+        m_cycles = 1;
+    } else if (fitKb >= MIN_BUFFER_KB) {
+        m_location = MEMORY;
+        m_bufferKb = fitKb;
+        m_cycles = divRoundUp(neededKb, fitKb);
+    }
+}
+
+// -----------------------------------------------------------------------------
+BitmapPlan BitmapPlan::forDump(const string &dump, unsigned long processes,
+                               unsigned long threads, const string &workDir,
+                               unsigned long long expectedSize)
+{
+    Debug::debug()->trace("BitmapPlan::forDump(%s, %lu, %lu, %s, %llu)",
+                          dump.c_str(), processes, threads, workDir.c_str(),
+                          expectedSize);
+
+    std::shared_ptr<const VmcoreContext> ctx = VmcoreContext::get(dump);
+    if (!ctx->isElf())
+        throw KError(dump + " is not an ELF dump.");
+
+    unsigned long pagesize = sysconf(_SC_PAGESIZE);
+    if (ctx->hasVmcoreinfo()) {
+        try {
+            pagesize = ctx->vmcoreinfo().getIntValue("PAGESIZE");
+        } catch (const KError &error) {
+            Debug::debug()->dbg("No PAGESIZE: %s", error.what());
+        }
+    }
+
+    // makedumpfile sizes the bitmaps from the end of the last PT_LOAD
+    unsigned long long end = 0;
+    const std::vector<VmcoreContext::Segment> &segs = ctx->segments();
+    std::vector<VmcoreContext::Segment>::const_iterator it;
+    for (it = segs.begin(); it != segs.end(); ++it)
+        end = std::max(end, it->paddr + it->filesz);
+    unsigned long long maxPfn = divRoundUp(end, pagesize);
+
+    std::ifstream fin("/proc/meminfo");
+    unsigned long long availableKb = MemoryWatch::parseKb(fin,
+                                                          "MemAvailable");
+
+    unsigned long long free = 0;
+    if (!workDir.empty()) {
+        try {
+            free = FilePath(workDir).freeDiskSize();
+        } catch (const KError &error) {
+            Debug::debug()->dbg("%s", error.what());
+        }
+        int reserve = Configuration::config()->KDUMP_FREE_DISK_SIZE.value();
+        unsigned long long keep = expectedSize;
+        if (reserve > 0)
+            keep += (unsigned long long)reserve << 20;
+        free = free > keep ? free - keep : 0;
+    }
+
+    return BitmapPlan(maxPfn, availableKb, processes, threads, workDir, free);
+}
+
+// -----------------------------------------------------------------------------
+bool BitmapPlan::overridden(const string &options)
+{
+    static const char *const words[] = {
+        "--cyclic-buffer", "--non-cyclic", "--work-dir"
+    };
+
+    std::istringstream iss(options);
+    string word;
+    while (iss >> word) {
+        for (size_t i = 0; i < sizeof words / sizeof words[0]; ++i)
+            if (word.compare(0, strlen(words[i]), words[i]) == 0)
+                return true;
+    }
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+StringVector BitmapPlan::options() const
+{
+    StringVector ret;
+    switch (m_location) {
+    case MEMORY:
+        ret.push_back("--cyclic-buffer");
+        ret.push_back(StringUtil::number2string(m_bufferKb));
+        break;
+    case DISK:
+        ret.push_back("--non-cyclic");
+        ret.push_back("--work-dir");
+        ret.push_back(m_workDir);
+        break;
+    case DEFAULT:
+        break;
+    }
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+string BitmapPlan::describe() const
+{
+    std::ostringstream ss;
+    ss << "Bitmap of " << m_bitmapKb << " KiB: ";
+    switch (m_location) {
+    case MEMORY:
+        ss << m_bufferKb << " KiB cyclic buffer, " << m_cycles
+           << (m_cycles == 1 ? " cycle" : " cycles");
+        break;
+    case DISK:
+        ss << "files in " << m_workDir;
+        break;
+    case DEFAULT:
+        ss << "makedumpfile default";
+        break;
+    }
+    return ss.str();
+}
+
+// -----------------------------------------------------------------------------
+const char *BitmapPlan::locationName(Location location)
+{
+    switch (location) {
+    case MEMORY:
+        return "memory";
+    case DISK:
+        return "disk";
+    default:
+        return "default";
+    }
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#ifndef BITMAPPLAN_H
+#define BITMAPPLAN_H
+
+#include <string>
+
+#include "global.h"
+#include "stringvector.h"
+
+//{{{ BitmapPlan ---------------------------------------------------------------
+
+/**
+ * Where makedumpfile keeps its bitmaps and how big they are.
+ *
+ * makedumpfile needs two bitmaps with one bit per page frame. In the
+ * default cyclic mode it allocates both with a fixed size and scans the
+ * memory once per cycle, and its automatic size is a conservative share
+ * of the free memory. With a huge host and a small crash kernel, that
+ * means many passes over the page tables of the crashed kernel.
+ *
+ * The plan is, in this order of preference:
+ *
+ *  - a cyclic buffer large enough for a single cycle, if both bitmaps
+ *    of every makedumpfile process fit into the memory share,
+ *  - bitmap files in the local target directory (non-cyclic mode), if
+ *    they fit into the free space that the dump leaves,
+ *  - the largest cyclic buffer that fits, at least MIN_BUFFER_KB,
+ *  - otherwise the defaults of makedumpfile.
+ *
+ * The TMPDIR of makedumpfile is a tmpfs in the crash kernel, so bitmap
+ * files there would take the same memory and are never chosen.
+ */
+class BitmapPlan {
+
+    public:
+        enum Location {
+            DEFAULT,    ///< makedumpfile decides
+            MEMORY,     ///< cyclic buffers in memory
+            DISK        ///< bitmap files in the work directory
+        };
+
+        /// Percent of MemAvailable for the bitmaps
+        static const unsigned MEMORY_PCT = 50;
+
+        /// Memory (in KiB) needed by each makedumpfile thread
+        static const unsigned long THREAD_KB = 4096;
+
+        /// Smaller cyclic buffers are not better than the default
+        static const unsigned long MIN_BUFFER_KB = 1024;
+
+        /**
+         * Makes the plan.
+         *
+         * @param[in] maxPfn       highest page frame number plus one
+         * @param[in] availableKb  MemAvailable of the crash kernel
+         * @param[in] processes    number of makedumpfile processes
+         *                         (--split), at least 1
+         * @param[in] threads      value of --num-threads
+         * @param[in] workDir      local target directory, or empty
+         * @param[in] workDirFree  bytes that may be used in @p workDir
+         */
+        BitmapPlan(unsigned long long maxPfn,
+                   unsigned long long availableKb,
+                   unsigned long processes, unsigned long threads,
+                   const std::string &workDir = std::string(),
+                   unsigned long long workDirFree = 0);
+
+        /**
+         * Makes the plan for a dump. The memory comes from /proc/meminfo,
+         * the highest page frame from the program headers, and the free
+         * space of @p workDir is reduced by KDUMP_FREE_DISK_SIZE and by
+         * @p expectedSize.
+         *
+         * @param[in] dump          the ELF dump (/proc/vmcore)
+         * @param[in] processes     number of makedumpfile processes
+         * @param[in] threads       value of --num-threads
+         * @param[in] workDir       local target directory, or empty
+         * @param[in] expectedSize  estimated size of the dump, or 0
+         * @exception KError if the dump cannot be read
+         */
+        static BitmapPlan forDump(const std::string &dump,
+                                  unsigned long processes,
+                                  unsigned long threads,
+                                  const std::string &workDir,
+                                  unsigned long long expectedSize);
+
+        /**
+         * Checks whether @p options (MAKEDUMPFILE_OPTIONS) already choose
+         * the bitmap size or location.
+         */
+        static bool overridden(const std::string &options);
+
+        /**
+         * Returns the makedumpfile options for the plan, empty for
+         * DEFAULT.
+         */
+        StringVector options() const;
+
+        /**
+         * Returns a one-line description for the log.
+         */
+        std::string describe() const;
+
+        Location location() const
+        { return m_location; }
+
+        /// size of one full bitmap in KiB
+        unsigned long long bitmapKb() const
+        { return m_bitmapKb; }
+
+        /// value of --cyclic-buffer, or 0
+        unsigned long long bufferKb() const
+        { return m_bufferKb; }
+
+        /// passes over the memory, or 0 if unknown (DEFAULT)
+        unsigned long long cycles() const
+        { return m_cycles; }
+
+        const std::string &workDir() const
+        { return m_workDir; }
+
+        static const char *locationName(Location location);
+
+    private:
+        Location m_location;
+        unsigned long long m_bitmapKb;
+        unsigned long long m_bufferKb;
+        unsigned long long m_cycles;
+        std::string m_workDir;
+};
+
+//}}}
+
+#endif /* BITMAPPLAN_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <utility>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "global.h"
+#include "debug.h"
+#include "bufferpool.h"
+
+//{{{ BufferPool::Buffer -------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+void BufferPool::Buffer::swap(Buffer &other) noexcept
+{
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    std::swap(m_capacity, other.m_capacity);
+}
+
+// -----------------------------------------------------------------------------
+void BufferPool::Buffer::reset()
+{
+    if (!m_data)
+        return;
+    BufferPool::pool()->put(m_data, m_capacity);
+    m_data = NULL;
+    m_size = m_capacity = 0;
+}
+
+//}}}
+//{{{ BufferPool ---------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+BufferPool *BufferPool::pool()
+{
+    static BufferPool *instance = new BufferPool();
+    return instance;
+}
+
+// -----------------------------------------------------------------------------
+BufferPool::BufferPool()
+    : m_pagesize(sysconf(_SC_PAGESIZE)), m_limit(0), m_borrowed(0),
+      m_cached(0), m_peak(0), m_overcommits(0)
+{}
+
+// -----------------------------------------------------------------------------
+unsigned long long BufferPool::defaultLimit()
+{
+    unsigned long long ram = (unsigned long long)sysconf(_SC_PHYS_PAGES) *
+        sysconf(_SC_PAGESIZE);
+    return ram / BUFFER_POOL_SHARE;
+}
+
+// -----------------------------------------------------------------------------
+void BufferPool::setLimit(unsigned long long limit)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Debug::debug()->dbg("Buffer limit %llu KiB", limit >> 10);
+    m_limit = limit;
+    makeRoom(0);
+    m_returned.notify_all();
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long BufferPool::limit() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_limit;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long BufferPool::peak() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_peak;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long BufferPool::overcommits() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_overcommits;
+}
+
+// -----------------------------------------------------------------------------
+bool BufferPool::makeRoom(size_t capacity)
+{
+    if (!m_limit)
+        return true;
+
+    std::multimap<size_t, char *>::iterator it = m_free.begin();
+    while (m_borrowed + m_cached + capacity > m_limit && it != m_free.end()) {
+        // a cached buffer of the right size is taken, not unmapped
+        if (it->first == capacity) {
+            ++it;
+            continue;
+        }
+        munmap(it->second, it->first);
+        m_cached -= it->first;
+        it = m_free.erase(it);
+    }
+
+    // take() reuses a cached buffer of this size
+    std::multimap<size_t, char *>::const_iterator same = m_free.find(capacity);
+    unsigned long long needed = m_borrowed + m_cached +
+        (same != m_free.end() ? 0 : capacity);
+    return needed <= m_limit;
+}
+
+// -----------------------------------------------------------------------------
+BufferPool::Buffer BufferPool::take(size_t size, size_t capacity)
+{
+    Buffer ret;
+    std::multimap<size_t, char *>::iterator it = m_free.find(capacity);
+    if (it != m_free.end()) {
+        ret.m_data = it->second;
+        m_cached -= capacity;
+        m_free.erase(it);
+    } else {
+        void *p = mmap(NULL, capacity, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            throw KSystemError("Cannot allocate an I/O buffer", errno);
+#ifdef MADV_HUGEPAGE
+        if (capacity >= BUFFER_POOL_HUGE_SIZE)
+            madvise(p, capacity, MADV_HUGEPAGE);
+#endif
+        ret.m_data = static_cast<char *>(p);
+    }
+    ret.m_size = size;
+    ret.m_capacity = capacity;
+
+    m_borrowed += capacity;
+    if (m_borrowed + m_cached > m_peak)
+        m_peak = m_borrowed + m_cached;
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+BufferPool::Buffer BufferPool::get(size_t size)
+{
+    size_t capacity = (size + m_pagesize - 1) / m_pagesize * m_pagesize;
+    if (!capacity)
+        capacity = m_pagesize;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    std::chrono::steady_clock::time_point until =
+        std::chrono::steady_clock::now() +
+        std::chrono::seconds(BUFFER_POOL_WAIT);
+    bool fits = makeRoom(capacity);
+    while (!fits && m_borrowed) {
+        bool timeout = m_returned.wait_until(lock, until) ==
+            std::cv_status::timeout;
+        fits = makeRoom(capacity);
+        if (timeout)
+            break;
+    }
+    if (!fits) {
+        ++m_overcommits;
+        Debug::debug()->dbg("Buffer limit exceeded by %zu KiB",
+                            capacity >> 10);
+    }
+    return take(size, capacity);
+}
+
+// -----------------------------------------------------------------------------
+BufferPool::Buffer BufferPool::tryGet(size_t size)
+{
+    size_t capacity = (size + m_pagesize - 1) / m_pagesize * m_pagesize;
+    if (!capacity)
+        capacity = m_pagesize;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!makeRoom(capacity))
+        return Buffer();
+    return take(size, capacity);
+}
+
+// -----------------------------------------------------------------------------
+void BufferPool::put(char *data, size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_borrowed -= capacity;
+    m_free.insert(std::make_pair(capacity, data));
+    m_cached += capacity;
+    m_returned.notify_all();
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+
+#include "global.h"
+
+// buffers of this size and larger are backed by transparent huge pages
+#define BUFFER_POOL_HUGE_SIZE   (2UL << 20)
+
+// seconds get() waits for other buffers before it exceeds the limit
+#define BUFFER_POOL_WAIT        2
+
+// default limit: this fraction of the memory of the (kdump) kernel
+#define BUFFER_POOL_SHARE       4
+
+//{{{ BufferPool ---------------------------------------------------------------
+
+/**
+ * Page-aligned I/O buffers with a common memory limit.
+ *
+ * The transfers and data providers of the dump path borrow their
+ * buffers here, so that their total size in the small memory of the
+ * kdump kernel is known in advance (see KDUMP_BUFFER_MEMORY). Returned
+ * buffers are kept for the next request of the same size; they are
+ * unmapped when other sizes need the room.
+ *
+ * A request that does not fit waits until other buffers are returned.
+ * Because the borrowers of a pipeline may wait for each other, it is
+ * granted anyway after BUFFER_POOL_WAIT seconds, or at once if no other
+ * buffer is borrowed; such requests are counted as overcommits.
+ */
+class BufferPool {
+
+    public:
+        /**
+         * A borrowed buffer. It goes back to the pool when it is
+         * destroyed or reset.
+         */
+        class Buffer {
+
+            public:
+                Buffer()
+                    : m_data(NULL), m_size(0), m_capacity(0)
+                {}
+
+                Buffer(Buffer &&other) noexcept
+                    : Buffer()
+                { swap(other); }
+
+                Buffer &operator=(Buffer &&other) noexcept
+                {
+                    reset();
+                    swap(other);
+                    return *this;
+                }
+
+                ~Buffer()
+                { reset(); }
+
+                /**
+                 * Returns the memory, or @c NULL for an empty buffer.
+                 */
+                char *get() const
+                { return m_data; }
+
+                /**
+                 * Returns the requested size.
+                 */
+                size_t size() const
+                { return m_size; }
+
+                explicit operator bool() const
+                { return m_data != NULL; }
+
+                void swap(Buffer &other) noexcept;
+
+                /**
+                 * Returns the memory to the pool.
+                 */
+                void reset();
+
+            private:
+                friend class BufferPool;
+
+                Buffer(const Buffer &);
+                Buffer &operator=(const Buffer &);
+
+                char *m_data;
+                size_t m_size;
+                size_t m_capacity;      // whole pages
+        };
+
+        /**
+         * Returns the only instance.
+         */
+        static BufferPool *pool();
+
+        /**
+         * Returns the default limit, 1/BUFFER_POOL_SHARE of the RAM.
+         * In the kdump kernel, that is the crashkernel reservation.
+         */
+        static unsigned long long defaultLimit();
+
+        /**
+         * Sets the limit in bytes, 0 for no limit.
+         */
+        void setLimit(unsigned long long limit);
+
+        /**
+         * Returns the limit in bytes, 0 for no limit.
+         */
+        unsigned long long limit() const;
+
+        /**
+         * Borrows a buffer of @p size bytes, waiting for other buffers
+         * if the limit would be exceeded.
+         *
+         * @exception KSystemError if the memory cannot be mapped
+         */
+        Buffer get(size_t size);
+
+        /**
+         * Borrows a buffer if it fits into the limit now.
+         *
+         * @return an empty buffer if it does not fit
+         * @exception KSystemError if the memory cannot be mapped
+         */
+        Buffer tryGet(size_t size);
+
+        /**
+         * Returns the largest number of bytes that were mapped.
+         */
+        unsigned long long peak() const;
+
+        /**
+         * Returns the number of requests that exceeded the limit.
+         */
+        unsigned long long overcommits() const;
+
+    protected:
+        BufferPool();
+
+        /**
+         * Takes a cached buffer or maps a new one. Called with m_mutex
+         * held.
+         */
+        Buffer take(size_t size, size_t capacity);
+
+        /**
+         * Unmaps cached buffers until @p capacity more bytes fit.
+         * Called with m_mutex held.
+         *
+         * @return @c true if they fit
+         */
+        bool makeRoom(size_t capacity);
+
+        /**
+         * Puts a returned buffer into the cache.
+         */
+        void put(char *data, size_t capacity);
+
+    private:
+        size_t m_pagesize;
+        unsigned long long m_limit;
+        unsigned long long m_borrowed;  // bytes of borrowed buffers
+        unsigned long long m_cached;    // bytes of returned buffers
+        unsigned long long m_peak;
+        unsigned long long m_overcommits;
+        std::multimap<size_t, char *> m_free;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_returned;
+};
+
+//}}}
+
+#endif /* BUFFERPOOL_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <algorithm>
+
+#include "global.h"
+#include "debug.h"
+#include "bufferpool.h"
+#include "buffertuner.h"
+
+using std::string;
+
+//{{{ BufferTuner --------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+BufferTuner::BufferTuner(const string &name, size_t granularity,
+                         size_t initial, size_t minimum, size_t maximum)
+    : m_name(name), m_granularity(std::max<size_t>(granularity, 1)),
+      m_bestRate(0), m_bestSlow(false), m_state(TS_FIRST), m_started(false),
+      m_windowBytes(0), m_windowWrites(0),
+      m_windowLatency(Clock::duration::zero())
+{
+    // leave room for the other buffers of the pool
+    unsigned long long limit = BufferPool::pool()->limit();
+    if (limit && limit / TUNER_POOL_SHARE < maximum)
+        maximum = limit / TUNER_POOL_SHARE;
+
+    m_min = align(minimum);
+    m_max = std::max(align(maximum), m_min);
+    m_size = m_first = m_best =
+        std::min(std::max(align(initial), m_min), m_max);
+}
+
+// -----------------------------------------------------------------------------
+size_t BufferTuner::align(size_t size) const
+{
+    size = size / m_granularity * m_granularity;
+    return size ? size : m_granularity;
+}
+
+// -----------------------------------------------------------------------------
+bool BufferTuner::account(size_t bytes, Clock::duration latency)
+{
+    return account(bytes, latency, Clock::now());
+}
+
+// -----------------------------------------------------------------------------
+bool BufferTuner::account(size_t bytes, Clock::duration latency,
+                          Clock::time_point now)
+{
+    if (m_state == TS_SETTLED)
+        return false;
+
+    // the window of the first size starts with its first write
+    if (!m_started) {
+        m_started = true;
+        m_start = m_windowStart = now - latency;
+    }
+
+    m_windowBytes += bytes;
+    ++m_windowWrites;
+    m_windowLatency += latency;
+
+    Clock::duration elapsed = now - m_windowStart;
+    if (elapsed < std::chrono::milliseconds(TUNER_WINDOW_MS) ||
+        m_windowWrites < TUNER_WINDOW_WRITES)
+        return false;
+
+    size_t old = m_size;
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    next(m_windowBytes / seconds, m_windowLatency / m_windowWrites);
+    if (m_state != TS_SETTLED &&
+        now - m_start >= std::chrono::milliseconds(TUNER_PERIOD_MS))
+        settle();
+
+    m_windowStart = now;
+    m_windowBytes = 0;
+    m_windowWrites = 0;
+    m_windowLatency = Clock::duration::zero();
+    return m_size != old;
+}
+
+// -----------------------------------------------------------------------------
+void BufferTuner::next(double rate, Clock::duration latency)
+{
+    bool slow = latency >= std::chrono::milliseconds(TUNER_MAX_LATENCY_MS);
+    bool better = rate > m_bestRate * (100 + TUNER_GAIN_PERCENT) / 100;
+
+    Debug::debug()->dbg("%s: %zu KiB buffers: %.1f MiB/s, %.1f ms per write",
+        m_name.c_str(), m_size >> 10, rate / (1 << 20),
+        std::chrono::duration<double, std::milli>(latency).count());
+
+    switch (m_state) {
+        case TS_FIRST:
+            m_best = m_size;
+            m_bestRate = rate;
+            m_bestSlow = slow;
+            if (!slow && m_size * 2 <= m_max) {
+                m_state = TS_UP;
+                m_size = align(m_size * 2);
+            } else if (m_size / 2 >= m_min) {
+                m_state = TS_DOWN;
+                m_size = align(m_size / 2);
+            } else
+                settle();
+            break;
+
+        case TS_UP:
+            if (better && !slow) {
+                m_best = m_size;
+                m_bestRate = rate;
+                m_bestSlow = false;
+                if (m_size * 2 <= m_max)
+                    m_size = align(m_size * 2);
+                else
+                    settle();
+            } else if (m_best == m_first && m_best / 2 >= m_min) {
+                // larger did not help, maybe smaller does
+                m_state = TS_DOWN;
+                m_size = align(m_best / 2);
+            } else
+                settle();
+            break;
+
+        case TS_DOWN:
+            // a smaller size wins if the best one is too slow anyway
+            if (better || m_bestSlow) {
+                m_best = m_size;
+                m_bestRate = rate;
+                m_bestSlow = slow;
+                if (m_size / 2 >= m_min)
+                    m_size = align(m_size / 2);
+                else
+                    settle();
+            } else
+                settle();
+            break;
+
+        case TS_SETTLED:
+            break;
+    }
+}
+
+// -----------------------------------------------------------------------------
+void BufferTuner::settle()
+{
+    m_state = TS_SETTLED;
+    m_size = m_best;
+    Debug::debug()->dbg("%s: using %zu KiB buffers", m_name.c_str(),
+                        m_size >> 10);
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
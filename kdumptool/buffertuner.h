@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef BUFFERTUNER_H
+#define BUFFERTUNER_H
+
+#include <string>
+
+#include "global.h"
+#include "savestats.h"
+
+// first buffer size, and the memory cap of one buffer
+#define TUNER_INITIAL_SIZE      (1024*1024)
+#define TUNER_MIN_SIZE          (64*1024)
+#define TUNER_MAX_SIZE          (4*1024*1024)
+
+// a buffer may use at most this fraction of the BufferPool limit
+#define TUNER_POOL_SHARE        4
+
+// each size is measured for at least this long and this many writes
+#define TUNER_WINDOW_MS         250
+#define TUNER_WINDOW_WRITES     8
+
+// the tuning ends after this time with the best size so far
+#define TUNER_PERIOD_MS         3000
+
+// a size must be this many percent faster to be preferred
+#define TUNER_GAIN_PERCENT      5
+
+// sizes with a longer average write latency are too large
+#define TUNER_MAX_LATENCY_MS    100
+
+//{{{ BufferTuner --------------------------------------------------------------
+
+/**
+ * Chooses the size of the writes of a transfer while it is running.
+ *
+ * The best size depends on the target: some disks and links want
+ * megabytes per write, while a pipe to ssh is full after 64 KiB. The
+ * tuner starts with TUNER_INITIAL_SIZE and measures the throughput
+ * (bytes per second of wall time, including the source) and the
+ * average write latency over a window. Then it doubles the size as
+ * long as that is faster by TUNER_GAIN_PERCENT, or halves it if the
+ * first step up did not help or the writes take longer than
+ * TUNER_MAX_LATENCY_MS, and stays with the best size. The
+ * tuning ends after TUNER_PERIOD_MS in any case.
+ *
+ * The buffers come from the BufferPool, so the largest size is also
+ * limited to 1/TUNER_POOL_SHARE of its limit.
+ *
+ * Each transfer object has its own tuner, so the size found for the
+ * first file is used for the following ones.
+ */
+class BufferTuner {
+
+    public:
+        typedef SaveStats::Clock Clock;
+
+        /**
+         * @param[in] name name of the transfer (for the log)
+         * @param[in] granularity the sizes are multiples of this
+         * @param[in] initial the first size
+         * @param[in] minimum the smallest size
+         * @param[in] maximum the largest size
+         */
+        BufferTuner(const std::string &name, size_t granularity = 1,
+                    size_t initial = TUNER_INITIAL_SIZE,
+                    size_t minimum = TUNER_MIN_SIZE,
+                    size_t maximum = TUNER_MAX_SIZE);
+
+        /**
+         * Returns the size for the next write.
+         */
+        size_t size() const
+        { return m_size; }
+
+        /**
+         * Returns the largest size that size() may return.
+         */
+        size_t maximum() const
+        { return m_max; }
+
+        /**
+         * Returns @c true when the tuning has ended.
+         */
+        bool settled() const
+        { return m_state == TS_SETTLED; }
+
+        /**
+         * Accounts a write.
+         *
+         * @param[in] bytes the number of bytes written
+         * @param[in] latency how long the write has taken
+         * @return @c true if size() has changed
+         */
+        bool account(size_t bytes, Clock::duration latency);
+
+    protected:
+        /**
+         * Accounts a write at the time @p now.
+         *
+         * @see account()
+         */
+        bool account(size_t bytes, Clock::duration latency,
+                     Clock::time_point now);
+
+    private:
+        enum State {
+            TS_FIRST,           // measuring the initial size
+            TS_UP,              // trying larger sizes
+            TS_DOWN,            // trying smaller sizes
+            TS_SETTLED
+        };
+
+        size_t align(size_t size) const;
+        void next(double rate, Clock::duration latency);
+        void settle();
+
+        std::string m_name;
+        size_t m_granularity;
+        size_t m_min;
+        size_t m_max;
+        size_t m_size;
+        size_t m_first;
+        size_t m_best;
+        double m_bestRate;
+        bool m_bestSlow;
+        State m_state;
+
+        bool m_started;
+        Clock::time_point m_start;
+        Clock::time_point m_windowStart;
+        unsigned long long m_windowBytes;
+        unsigned m_windowWrites;
+        Clock::duration m_windowLatency;
+};
+
+//}}}
+
+#endif /* BUFFERTUNER_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -21,9 +21,16 @@
 #include <cerrno>
 #include <cstring>
 #include <cstdlib>
+#include <sstream>
 #include <limits>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <set>
+#include <exception>
 #include <unistd.h>
 #include <dirent.h>
+#include <sys/stat.h>
 
 #include "subcommand.h"
 #include "debug.h"
@@ -35,12 +42,39 @@
 #include "process.h"
 #include "rootdirurl.h"
 #include "stringvector.h"
+#include "stringutil.h"
+#include "taskgraph.h"
+#include "checksum.h"
+#include "kernelcache.h"
+#include "luksheader.h"
+#include "memoryhistory.h"
+#include "sshtransfer.h"
+#include "s3transfer.h"
+#include "stripewriter.h"
+#include "writeback.h"
 
 // All calculations are in KiB
 
 // This macro converts MiB to KiB
 #define MB(x)	((x)*1024)
 
+// Maximum number of concurrent hardware probes
+#define PROBE_THREADS	6
+
+// Maximum number of concurrent cryptsetup processes
+#define CRYPTINFO_THREADS	4
+
+// Cached result of the last calculation
+#define CALIBRATE_CACHE		KERNEL_CACHE_DIR "/calibrate"
+#define CALIBRATE_CACHE_MAGIC	"KDUMP-CALIBRATE-CACHE 1"
+
+// Size of the kdump initrd, measured by mkdumprd
+#define INITRD_SIZE_FILE	KERNEL_CACHE_DIR "/initrd-size"
+
+// Number of bytes of a LUKS header that are part of the fingerprint
+// (the LUKS2 binary header with the checksum of its metadata)
+#define LUKS_HEADER_SIZE	4096
+
 // Shift right by an amount, rounding the result up
 #define shr_round_up(n,amt)	(((n) + (1UL << (amt)) - 1) >> (amt))
 
@@ -228,16 +262,65 @@ static inline unsigned long s390x_align_memmap(unsigned long maxpfn)
 // TOTAL:		56 M
 #define USER_BASE_KB	MB(56)
 
+// The part of USER_BASE_KB that MemoryWatch measures as the RSS of
+// kdump-save and makedumpfile
+#define USER_KDUMP_KB	MB(4 + 1)
+
 // Additional requirements when network is configured
 //   dhclient		10 M
 #define USER_NET_KB	MB(10)
 
+// Transfer requirements, see transferMemory():
+//   ssh process (cipher state, channel window)	 4 M	per connection
+//   libcurl (FTP)				 1 M	per connection
+//   FTP: FTP_REWIND_SIZE to resume a single upload (KDUMP_TRANSFER_RETRIES)
+//   NFS or CIFS client (RPC or SMB state)	 2 M
+//   NFS socket buffers: 2 requests of wsize in flight	per connection
+//   CIFS socket buffers: 2 requests of wsize in flight	per channel
+//   SFTP: KDUMP_SFTP_WINDOW requests of KDUMP_SFTP_CHUNK_SIZE, sent
+//         and queued
+//   kdump (collector): STREAM_CHUNK_SIZE buffer and socket buffers	 2 M
+//   S3: libcurl and a part of KDUMP_S3_PART_SIZE	per connection
+//   STRIPE: STRIPE_BUFFERS chunks for each stream
+//   several protocols: KDUMP_TARGET_LAG of buffered data
+//   DEDUP: KDUMP_DEDUP_INDEX for the chunk index, plus buffers	 2 M
+#define SSH_CONN_KB	MB(4)
+#define CURL_CONN_KB	MB(1)
+#define NETFS_BASE_KB	MB(2)
+#define NETFS_INFLIGHT	2
+#define STREAM_CONN_KB	MB(2)
+#define DEDUP_BASE_KB	MB(2)
+
 // Maximum size of the page bitmap
 // 32 MiB is 32*1024*1024*8 = 268435456 bits
 // makedumpfile uses two bitmaps, so each has 134217728 bits
 // with 4-KiB pages this covers 0.5 TiB of RAM in one cycle
 #define MAX_BITMAP_KB	MB(32)
 
+// Dump settings model for "calibrate --optimize":
+//
+//   makedumpfile	 1 M	base size of each makedumpfile process
+//   copy buffer	 1 M	per worker for ELF dumps without makedumpfile
+//   target		 500 MiB/s assumed write speed of the dump target
+//   cycle		 5 %	slow-down for each extra bitmap cycle
+//
+// The dump size is assumed to be the whole RAM (worst case).
+#define MAKEDUMPFILE_KB		MB(1)
+#define COPY_BUFFER_KB		MB(1)
+#define TARGET_MBPS		500
+#define CYCLE_PENALTY_PCT	5
+#define MIN_BUFFER_KB		MB(1)
+#define MAX_OPTIMIZE_CPUS	64
+
+// Correction with the memory usage of earlier dumps (MemoryHistory):
+//
+//   margin	25 %	added to the measured peaks, because they are
+//			sampled only once a second
+//   headroom	 5 %	of MemTotal that MemAvailable should not fall below;
+//			if it has, the model is only ever made safer
+#define HISTORY_MARGIN_PCT	25
+#define HISTORY_HEADROOM_PCT	5
+
 // Minimum lowmem allocation. This is 64M for swiotlb and 8M
 // for overflow, DMA buffers, etc.
 #define MINLOW_KB	MB(64 + 8)
@@ -252,6 +335,8 @@ static inline unsigned long s390x_align_memmap(unsigned long maxpfn)
 using std::cout;
 using std::endl;
 using std::ifstream;
+using std::ofstream;
+using std::string;
 
 //{{{ SystemCPU ----------------------------------------------------------------
 
@@ -792,6 +877,12 @@ class MemMap {
 	 */
 	unsigned long long find(unsigned long size, unsigned long align) const;
 
+	/**
+	 * Get the System RAM ranges.
+	 */
+	const List& ranges(void) const
+	{ return m_ranges; }
+
     private:
 
 	List m_ranges;
@@ -908,12 +999,15 @@ unsigned long long MemMap::find(unsigned long size, unsigned long align) const
 //{{{ CryptInfo ----------------------------------------------------------------
 
 /**
- * Given a LUKS crypto device, dump the header using 'cryptinfo' and
- * parse the output looking for maximum memory requirements.
+ * Given a LUKS crypto device, get the maximum memory requirements of its
+ * key slots. The header is read directly (see LuksHeader); if it cannot
+ * be parsed, the header is dumped using 'cryptsetup' instead.
  */
 class CryptInfo {
         unsigned long m_memory;
 
+        void luksDump(std::string const& device);
+
     public:
         CryptInfo(std::string const& device);
 
@@ -932,6 +1026,19 @@ CryptInfo::CryptInfo(std::string const& device)
 {
     Debug::debug()->trace("CryptInfo::CryptInfo(%s)", device.c_str());
 
+    try {
+        LuksHeader header(device);
+        m_memory = header.memory();
+        return;
+    } catch (KError &e) {
+        Debug::debug()->dbg("Falling back to cryptsetup: %s", e.what());
+    }
+    luksDump(device);
+}
+
+// -----------------------------------------------------------------------------
+void CryptInfo::luksDump(std::string const& device)
+{
     ProcessFilter p;
 
     StringVector args;
@@ -967,12 +1074,717 @@ CryptInfo::CryptInfo(std::string const& device)
     }
 }
 
+// -----------------------------------------------------------------------------
+/**
+ * How the dump targets use the page cache.
+ */
+enum PageCacheUse {
+    PAGECACHE_NONE,		// raw targets only, written with O_DIRECT
+    PAGECACHE_WINDOW,		// WRITEBACK: two WRITEBACK_WINDOWs
+    PAGECACHE_DIRTY,		// up to DIRTY_RATIO of the memory
+};
+
+// -----------------------------------------------------------------------------
+/**
+ * Checks how the dump targets write through the page cache. Raw
+ * targets use O_DIRECT, everything else is buffered by the kernel.
+ *
+ * @param[in] config the kdump configuration
+ * @return the page cache usage
+ */
+static PageCacheUse pageCacheUse(Configuration *config)
+{
+    std::istringstream iss(config->KDUMP_SAVEDIR.value());
+    std::string elem;
+    bool buffered = false;
+    while (iss >> elem)
+	if (URLParser(elem).getProtocol() != URLParser::PROT_RAW)
+	    buffered = true;
+    if (!buffered)
+	return PAGECACHE_NONE;
+
+    // split dumps and stripes are not written back early
+    if (config->kdumptoolContainsFlag(Configuration::FLAG_WRITEBACK) &&
+	!config->kdumptoolContainsFlag(Configuration::FLAG_SPLIT) &&
+	!config->kdumptoolContainsFlag(Configuration::FLAG_STRIPE))
+	return PAGECACHE_WINDOW;
+    return PAGECACHE_DIRTY;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Get the LUKS devices which hold the kernel or a local dump target.
+ *
+ * @param[in] config the kdump configuration
+ * @return device paths
+ * @exception KError if the devices cannot be listed
+ */
+static StringVector luksDevices(Configuration *config)
+{
+    FilesystemTypeMap map;
+
+    if (config->KDUMP_COPY_KERNEL.value()) {
+	try {
+	    map.addPath("/boot");
+	} catch (KError&) {
+	    // ignore device resolution failures
+	}
+    }
+
+    std::istringstream iss(config->KDUMP_SAVEDIR.value());
+    std::string elem;
+    while (iss >> elem) {
+	RootDirURL url(elem, std::string());
+	if (url.getProtocol() == RootDirURL::PROT_FILE) {
+	    try {
+		map.addPath(url.getRealPath());
+	    } catch (KError&) {
+		// ignore device resolution failures
+	    }
+	}
+    }
+
+    StringVector luks;
+    StringStringMap devices = map.devices();
+    for (StringStringMap::iterator it = devices.begin();
+	 it != devices.end();
+	 ++it) {
+	if (it->second == "crypto_LUKS")
+	    luks.push_back(it->first);
+    }
+    return luks;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Get the maximum memory needed to open any of the given LUKS devices.
+ * The devices are queried concurrently, because cryptsetup may take
+ * a while for each of them.
+ *
+ * @param[in] luks device paths
+ * @return memory in KiB
+ * @exception KError if a device cannot be queried
+ */
+static unsigned long cryptoMemory(const StringVector &luks)
+{
+    if (luks.empty())
+	return 0;
+
+    std::vector<unsigned long> memory(luks.size());
+    TaskGraph graph(std::min<size_t>(luks.size(), CRYPTINFO_THREADS));
+    for (size_t i = 0; i < luks.size(); ++i) {
+	graph.add(luks[i], [&luks, &memory, i]() {
+		CryptInfo info(luks[i]);
+		memory[i] = info.memory();
+	    });
+    }
+    graph.run();
+
+    unsigned long crypto_mem = 0;
+    for (size_t i = 0; i < memory.size(); ++i)
+	if (crypto_mem < memory[i])
+	    crypto_mem = memory[i];
+    return crypto_mem;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Add the memory which the kdump kernel allocates in proportion to the
+ * memory that it uses: page cache, hashes and memmap.
+ *
+ * @param[in] required kernel and user-space requirements in KiB
+ * @param[in] pagesize page size in bytes
+ * @param[in] pagecache how the dump targets use the page cache
+ * @param[in] measured_kb dirty page cache measured by earlier dumps
+ *                        instead of DIRTY_RATIO, or 0
+ * @param[in] verbose log the individual parts
+ * @return the total run-time requirements in KiB
+ */
+static unsigned long addKernelOverhead(unsigned long required,
+				       unsigned long pagesize,
+				       PageCacheUse pagecache,
+				       unsigned long measured_kb, bool verbose)
+{
+    unsigned long prev;
+
+    // Make room for dirty pages and in-flight I/O:
+    //
+    //   required = prev + dirty + io
+    //      dirty = total * (DIRTY_RATIO / 100)
+    //	   io = dirty * (BUF_PER_DIRTY_MB / 1024)
+    //
+    // solve the above using integer math:
+    if (pagecache == PAGECACHE_WINDOW) {
+	// the writer keeps at most two windows dirty
+	unsigned long dirty = 2 * (WRITEBACK_WINDOW / 1024);
+	unsigned long io = dirty * BUF_PER_DIRTY_MB / MB(1);
+	required += dirty + io;
+	if (verbose) {
+	    Debug::debug()->dbg("Dirty pagecache: %lu KiB (write-back)",
+				dirty);
+	    Debug::debug()->dbg("In-flight I/O: %lu KiB", io);
+	}
+    } else if (pagecache == PAGECACHE_DIRTY && measured_kb) {
+	unsigned long dirty = measured_kb;
+	unsigned long io = dirty * BUF_PER_DIRTY_MB / MB(1);
+	required += dirty + io;
+	if (verbose) {
+	    Debug::debug()->dbg("Dirty pagecache: %lu KiB (measured)", dirty);
+	    Debug::debug()->dbg("In-flight I/O: %lu KiB", io);
+	}
+    } else if (pagecache == PAGECACHE_DIRTY) {
+	unsigned long dirty;
+	prev = required;
+	required = required * MB(100) /
+	    (MB(100) - MB(DIRTY_RATIO) - DIRTY_RATIO * BUF_PER_DIRTY_MB);
+	dirty = (required - prev) * MB(1) / (MB(1) + BUF_PER_DIRTY_MB);
+	if (verbose) {
+	    Debug::debug()->dbg("Dirty pagecache: %lu KiB", dirty);
+	    Debug::debug()->dbg("In-flight I/O: %lu KiB",
+				required - prev - dirty);
+	}
+    } else if (verbose)
+	Debug::debug()->dbg("Dirty pagecache: none (raw targets only)");
+
+    // Account for memory between 0 and KDUMP_PHYS_LOAD
+    required += KDUMP_PHYS_LOAD;
+    if (verbose)
+	Debug::debug()->dbg("Assumed load offset: %lu KiB", KDUMP_PHYS_LOAD);
+
+    // Account for "large hashes"
+    prev = required;
+    required = required * MB(1024) / (MB(1024) - KERNEL_HASH_PER_MB);
+    if (verbose)
+	Debug::debug()->dbg("Large kernel hashes: %lu KiB", required - prev);
+
+    // Add space for memmap
+    prev = required;
+    required = required * pagesize / (pagesize - SIZE_STRUCT_PAGE);
+    unsigned long maxpfn = (required - prev) / SIZE_STRUCT_PAGE;
+    required = prev + align_memmap(maxpfn) * SIZE_STRUCT_PAGE;
+    if (verbose)
+	Debug::debug()->dbg("Maximum memmap size: %lu KiB", required - prev);
+
+    // Memory between 0 and KDUMP_PHYS_LOAD is not really allocated,
+    // so subtract it again after memmap has been sized.
+    required -= KDUMP_PHYS_LOAD;
+
+    return required;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Estimate the size of the makedumpfile page bitmaps.
+ *
+ * @param[in] memtotal total RAM in KiB
+ * @param[in] pagesize page size in bytes
+ * @return bitmap size in KiB
+ */
+static unsigned long bitmapSize(unsigned long memtotal, unsigned long pagesize)
+{
+    // 1 bit for every RAM page in each of the two bitmaps
+    unsigned long bitmapsz = shr_round_up(memtotal / pagesize, 2);
+    if (bitmapsz > MAX_BITMAP_KB)
+	bitmapsz = MAX_BITMAP_KB;
+    return bitmapsz;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Get the numeric value of a mount option.
+ *
+ * @param[in] options comma-separated mount options
+ * @param[in] name option name
+ * @param[in] def value if the option is not present
+ * @return the option value
+ */
+static unsigned long mountOption(const string &options, const string &name,
+				 unsigned long def)
+{
+    std::istringstream iss(options);
+    string opt;
+    while (std::getline(iss, opt, ',')) {
+	if (opt.compare(0, name.size() + 1, name + "=") == 0)
+	    return strtoul(opt.c_str() + name.size() + 1, NULL, 0);
+    }
+    return def;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Estimate the user-space and kernel memory needed by the transfers that
+ * SaveDump::getTransfer() creates for KDUMP_SAVEDIR, including their
+ * buffers and the number of parallel connections.
+ *
+ * @param[in] config the kdump configuration
+ * @return memory in KiB
+ */
+static unsigned long transferMemory(Configuration *config)
+{
+    std::set<int> protocols;
+    std::istringstream iss(config->KDUMP_SAVEDIR.value());
+    string elem;
+    while (iss >> elem)
+	protocols.insert(RootDirURL(elem, string()).getProtocol());
+
+    // STRIPE, or SPLIT to a remote target, uses KDUMP_CPUS connections
+    unsigned long streams = 1;
+    unsigned long cpus = config->KDUMP_CPUS.value();
+    bool stripe =
+	config->kdumptoolContainsFlag(Configuration::FLAG_STRIPE) ||
+	(config->kdumptoolContainsFlag(Configuration::FLAG_SPLIT) &&
+	 !config->kdumptoolContainsFlag(Configuration::FLAG_NOSPLIT));
+    if (stripe && cpus > 1 &&
+	!config->kdumptoolContainsFlag(Configuration::FLAG_SINGLE))
+	streams = cpus;
+    unsigned long stripe_kb = streams > 1
+	? streams * STRIPE_BUFFERS * (STRIPE_CHUNK_SIZE / 1024)
+	: 0;
+
+    unsigned long ret = 0;
+    std::set<int>::const_iterator it;
+    for (it = protocols.begin(); it != protocols.end(); ++it) {
+	unsigned long mem = 0;
+	switch (*it) {
+	    case URLParser::PROT_SSH:
+		mem = streams * SSH_CONN_KB + stripe_kb;
+		break;
+
+	    case URLParser::PROT_FTP:
+		mem = streams * CURL_CONN_KB + stripe_kb;
+		if (streams == 1 && config->KDUMP_TRANSFER_RETRIES.value() > 0)
+		    mem += FTP_REWIND_SIZE / 1024;
+		break;
+
+	    case URLParser::PROT_SFTP: {
+		long window = config->KDUMP_SFTP_WINDOW.value();
+		long chunk = config->KDUMP_SFTP_CHUNK_SIZE.value();
+		if (window <= 0)
+		    window = 1;
+		if (chunk <= 0)
+		    chunk = 1;
+		else if (chunk > SFTP_MAX_CHUNK_KB)
+		    chunk = SFTP_MAX_CHUNK_KB;
+		mem = SSH_CONN_KB + 2 * window * chunk;
+		break;
+	    }
+
+	    case URLParser::PROT_KDUMP:
+		mem = STREAM_CONN_KB;
+		break;
+
+	    case URLParser::PROT_S3: {
+		long part = std::max(config->KDUMP_S3_PART_SIZE.value(),
+				     int(S3_MIN_PART_SIZE >> 20));
+		long conns = std::max(config->KDUMP_S3_CONNECTIONS.value(), 1);
+		mem = conns * (CURL_CONN_KB + MB(part));
+		break;
+	    }
+
+	    case URLParser::PROT_NFS: {
+		const string &opts = config->KDUMP_NFS_MOUNT_OPTIONS.value();
+		unsigned long conns = mountOption(opts, "nconnect", 1);
+		unsigned long wsize = mountOption(opts, "wsize", 1024 * 1024);
+		mem = NETFS_BASE_KB + conns * NETFS_INFLIGHT * (wsize / 1024);
+		break;
+	    }
+
+	    case URLParser::PROT_CIFS: {
+		const string &opts = config->KDUMP_CIFS_MOUNT_OPTIONS.value();
+		unsigned long chans = mountOption(opts, "max_channels", 1);
+		unsigned long wsize = mountOption(opts, "wsize", 1024 * 1024);
+		mem = NETFS_BASE_KB + chans * NETFS_INFLIGHT * (wsize / 1024);
+		break;
+	    }
+
+	    default:
+		break;
+	}
+	Debug::debug()->dbg("Transfer to %s: %lu KiB",
+			    URLParser::protocol2string(
+				URLParser::Protocol(*it)).c_str(), mem);
+	ret += mem;
+    }
+
+    // TeeTransfer lets a leg fall behind by up to KDUMP_TARGET_LAG
+    if (protocols.size() > 1) {
+	long lag = config->KDUMP_TARGET_LAG.value();
+	if (lag > 0)
+	    ret += MB(lag);
+    }
+
+    // DEDUP keeps the index of the chunk store in memory
+    if (config->kdumptoolContainsFlag(Configuration::FLAG_DEDUP)) {
+	long index = config->KDUMP_DEDUP_INDEX.value();
+	ret += DEDUP_BASE_KB + (index > 0 ? MB(index) : 0);
+    }
+
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Get a checksum of a LUKS header. The header changes when a key slot
+ * is added or changed, and so may the memory requirements.
+ *
+ * @param[in] device the LUKS device
+ * @return the checksum, or an empty string if the header cannot be read
+ */
+static string luksHeaderSum(const string &device)
+{
+    ifstream f(device.c_str(), std::ios::binary);
+    char buf[LUKS_HEADER_SIZE];
+    if (!f || !f.read(buf, sizeof buf)) {
+	Debug::debug()->dbg("Cannot read LUKS header of %s", device.c_str());
+	return string();
+    }
+
+    Crc32c crc;
+    crc.update(buf, sizeof buf);
+    return crc.hex();
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Get the size of the kdump initrd as measured by mkdumprd. The file
+ * has a "KEY value" line for the initrd (INITRD), its size (PACKED_KB)
+ * and the size of its unpacked contents (UNPACKED_KB). The result is
+ * used only while the initrd still has the recorded size.
+ *
+ * @param[out] unpacked_kb size of the initramfs in KiB
+ * @param[out] packed_kb size of the (compressed) initrd in KiB
+ * @return @c true if the measured size is valid
+ */
+static bool readInitrdSize(unsigned long &unpacked_kb,
+			   unsigned long &packed_kb)
+{
+    ifstream f(INITRD_SIZE_FILE);
+    if (!f)
+	return false;
+
+    string key, initrd;
+    unpacked_kb = packed_kb = 0;
+    while (f >> key) {
+	if (key == "INITRD")
+	    f >> initrd;
+	else if (key == "UNPACKED_KB")
+	    f >> unpacked_kb;
+	else if (key == "PACKED_KB")
+	    f >> packed_kb;
+	else
+	    f.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+
+    struct stat st;
+    if (initrd.empty() || !unpacked_kb || !packed_kb ||
+	stat(initrd.c_str(), &st) != 0 ||
+	shr_round_up(st.st_size, 10) != packed_kb) {
+	Debug::debug()->dbg("Ignoring stale %s", INITRD_SIZE_FILE);
+	return false;
+    }
+
+    Debug::debug()->dbg("Initrd %s: %lu KiB, %lu KiB unpacked",
+			initrd.c_str(), packed_kb, unpacked_kb);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Get the cached result if it was calculated for the same inputs.
+ *
+ * @param[in] fingerprint description of all inputs
+ * @param[out] result the cached result
+ * @return @c true if a matching result was found
+ */
+static bool readCache(const string &fingerprint, string &result)
+{
+    ifstream f(CALIBRATE_CACHE, std::ios::binary);
+    if (!f)
+	return false;
+
+    std::ostringstream ss;
+    ss << f.rdbuf();
+    string data = ss.str();
+
+    string head = CALIBRATE_CACHE_MAGIC "\n" + fingerprint + "--\n";
+    if (data.compare(0, head.size(), head) != 0) {
+	Debug::debug()->dbg("Ignoring stale %s", CALIBRATE_CACHE);
+	return false;
+    }
+
+    result = data.substr(head.size());
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Store a result. Errors are logged and otherwise ignored.
+ *
+ * @param[in] fingerprint description of all inputs
+ * @param[in] result the calculated result
+ */
+static void writeCache(const string &fingerprint, const string &result)
+{
+    if (mkdir(KERNEL_CACHE_DIR, 0755) != 0 && errno != EEXIST) {
+	Debug::debug()->dbg("Cannot create %s: %s", KERNEL_CACHE_DIR,
+			    strerror(errno));
+	return;
+    }
+
+    // write a new file and rename it, so that readers never see
+    // a partial result
+    string tmp = CALIBRATE_CACHE ".tmp" + StringUtil::number2string(getpid());
+    {
+	ofstream fout(tmp.c_str(), std::ios::binary | std::ios::trunc);
+	fout << CALIBRATE_CACHE_MAGIC "\n" << fingerprint << "--\n" << result;
+	fout.close();
+	if (!fout) {
+	    Debug::debug()->dbg("Cannot write %s", tmp.c_str());
+	    unlink(tmp.c_str());
+	    return;
+	}
+    }
+
+    if (rename(tmp.c_str(), CALIBRATE_CACHE) != 0) {
+	Debug::debug()->dbg("Cannot rename %s: %s", tmp.c_str(),
+			    strerror(errno));
+	unlink(tmp.c_str());
+    }
+}
+
+//}}}
+//{{{ DumpPlan -----------------------------------------------------------------
+
+/**
+ * Costs of a dump format: memory of each compression thread (state,
+ * input and output buffers), compression speed of one CPU and the
+ * size of the output relative to the input.
+ */
+struct DumpFormatCost {
+    const char *name;
+    unsigned long thread_kb;
+    unsigned long mbps;
+    unsigned long ratio_pct;
+};
+
+static const DumpFormatCost dump_formats[] = {
+    { "ELF",         COPY_BUFFER_KB, 2000, 100 },
+    { "compressed",  384,              40,  30 },
+    { "lzo",         192,             250,  40 },
+    { "snappy",      128,             350,  40 },
+};
+
+/**
+ * A combination of dump settings with its memory requirements and
+ * expected speed.
+ */
+struct DumpPlan {
+    unsigned long cpus;
+    const DumpFormatCost *format;
+    unsigned long buffer_kb;	// makedumpfile --cyclic-buffer, 0 if unused
+    unsigned long required_kb;	// run-time requirements
+    unsigned long mbps;		// expected throughput
+    unsigned long seconds;	// expected dump time
+};
+
+/**
+ * Inputs of the model which do not depend on the dump settings.
+ */
+struct DumpModel {
+    unsigned long base_kb;	// kernel, initramfs and probed sizes
+    unsigned long user_kb;	// user space without makedumpfile
+    unsigned long memtotal;	// total RAM in KiB
+    unsigned long pagesize;
+    unsigned long bootsize;
+    unsigned long syscpus;	// CPUs of the system
+    bool split;			// KDUMPTOOL_FLAGS contains SPLIT
+    bool filter;		// KDUMP_DUMPLEVEL is non-zero
+    PageCacheUse pagecache;	// how the dump targets use the page cache
+};
+
+// -----------------------------------------------------------------------------
+/**
+ * Evaluate one combination of dump settings.
+ */
+static DumpPlan evaluatePlan(const DumpModel &model, unsigned long cpus,
+			     const DumpFormatCost *format,
+			     unsigned long buffer_kb)
+{
+    DumpPlan plan;
+    plan.cpus = cpus;
+    plan.format = format;
+    plan.buffer_kb = buffer_kb;
+
+    unsigned long user = model.user_kb;
+    unsigned long workers = cpus;
+    bool elf = format->ratio_pct >= 100;
+    if (!buffer_kb) {
+	// ELF dump copied by kdumptool
+	user += cpus * format->thread_kb;
+    } else if (model.split && !elf) {
+	// --split starts a makedumpfile process for each CPU
+	user += cpus * (MAKEDUMPFILE_KB + buffer_kb + format->thread_kb);
+    } else {
+	// --num-threads shares the bitmaps; filtered ELF dumps are
+	// neither split nor multi-threaded
+	if (elf)
+	    workers = 1;
+	user += buffer_kb + workers * format->thread_kb;
+    }
+    if (buffer_kb)
+	user += 96 * shr_round_up(model.memtotal, 20 + 7);
+
+    unsigned long required = model.base_kb + user;
+    if (CAN_REDUCE_CPUS)
+	required += (cpus - 1) * PERCPU_KB;
+    required = addKernelOverhead(required, model.pagesize, model.pagecache,
+				 0, false);
+    if (required < model.bootsize)
+	required = model.bootsize;
+    plan.required_kb = required;
+
+    // limited by the CPUs or by the target, whichever is slower
+    unsigned long mbps = workers * format->mbps;
+    unsigned long target = TARGET_MBPS * 100 / format->ratio_pct;
+    if (mbps > target)
+	mbps = target;
+
+    // a bitmap buffer smaller than the bitmaps needs several cycles
+    if (buffer_kb) {
+	unsigned long full = shr_round_up(model.memtotal / model.pagesize, 2);
+	unsigned long cycles = (full + buffer_kb - 1) / buffer_kb;
+	if (cycles > 1)
+	    mbps = mbps * 100 / (100 + (cycles - 1) * CYCLE_PENALTY_PCT);
+    }
+    plan.mbps = mbps ? mbps : 1;
+    plan.seconds = (shr_round_up(model.memtotal, 10) + plan.mbps - 1) /
+	plan.mbps;
+
+    return plan;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Evaluate all combinations of CPU count, dump format and bitmap
+ * buffer size.
+ */
+static std::vector<DumpPlan> evaluatePlans(const DumpModel &model)
+{
+    std::vector<DumpPlan> plans;
+
+    unsigned long maxcpus = std::min<unsigned long>(
+	std::max<unsigned long>(model.syscpus, 1), MAX_OPTIMIZE_CPUS);
+    const size_t nformats = sizeof dump_formats / sizeof dump_formats[0];
+    unsigned long largest = bitmapSize(model.memtotal, model.pagesize);
+
+    for (unsigned long cpus = 1; cpus <= maxcpus; ++cpus) {
+	for (size_t i = 0; i < nformats; ++i) {
+	    const DumpFormatCost *format = &dump_formats[i];
+
+	    // ELF without filtering does not use makedumpfile
+	    if (format->ratio_pct >= 100 && !model.filter) {
+		plans.push_back(evaluatePlan(model, cpus, format, 0));
+		continue;
+	    }
+
+	    unsigned long buffer = largest;
+	    while (true) {
+		plans.push_back(evaluatePlan(model, cpus, format, buffer));
+		if (buffer <= MIN_BUFFER_KB)
+		    break;
+		buffer = std::max<unsigned long>(buffer / 2, MIN_BUFFER_KB);
+	    }
+	}
+    }
+
+    return plans;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Print a plan.
+ */
+static void printPlan(std::ostream &out, const char *prefix,
+		      const DumpPlan &plan)
+{
+    out << prefix << "CPUs: " << plan.cpus << endl;
+    out << prefix << "Format: " << plan.format->name << endl;
+    out << prefix << "Buffer: " << plan.buffer_kb << endl;
+    out << prefix << "Required: " << shr_round_up(plan.required_kb, 10)
+	<< endl;
+    out << prefix << "Throughput: " << plan.mbps << endl;
+    out << prefix << "Time: " << plan.seconds << endl;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Print the fastest plan that fits into a budget and the smallest plan
+ * that meets a target dump time.
+ *
+ * @param[out] out output stream
+ * @param[in] model the model inputs
+ * @param[in] budget reservation size in MiB (0 to skip)
+ * @param[in] seconds target dump time (0 to skip)
+ */
+static void printOptimum(std::ostream &out, const DumpModel &model,
+			 unsigned long budget, unsigned long seconds)
+{
+    std::vector<DumpPlan> plans = evaluatePlans(model);
+
+    if (budget) {
+	const DumpPlan *best = NULL;
+	std::vector<DumpPlan>::const_iterator it;
+	for (it = plans.begin(); it != plans.end(); ++it) {
+	    if (shr_round_up(it->required_kb, 10) > budget)
+		continue;
+	    if (!best || it->mbps > best->mbps ||
+		(it->mbps == best->mbps && it->required_kb < best->required_kb))
+		best = &*it;
+	}
+
+	out << "Budget: " << budget << endl;
+	if (best)
+	    printPlan(out, "", *best);
+	else
+	    out << "Fits: no" << endl;
+    }
+
+    if (seconds) {
+	const DumpPlan *best = NULL;
+	std::vector<DumpPlan>::const_iterator it;
+	for (it = plans.begin(); it != plans.end(); ++it) {
+	    if (it->seconds > seconds)
+		continue;
+	    if (!best || it->required_kb < best->required_kb ||
+		(it->required_kb == best->required_kb && it->mbps > best->mbps))
+		best = &*it;
+	}
+
+	out << "TargetTime: " << seconds << endl;
+	if (best)
+	    printPlan(out, "Target", *best);
+	else
+	    out << "TargetReachable: no" << endl;
+    }
+}
+
 //}}}
 //{{{ Calibrate ----------------------------------------------------------------
 
 // -----------------------------------------------------------------------------
 Calibrate::Calibrate()
-{}
+    : m_force(false), m_budget(0), m_targetTime(0)
+{
+    m_options.push_back(new FlagOption("force", 'f', &m_force,
+        "Recalculate even if a cached result matches the system"));
+    m_options.push_back(new IntOption("optimize", 'o', &m_budget,
+        "Recommend the fastest dump settings for a reservation of "
+        "<NUMBER> MiB"));
+    m_options.push_back(new IntOption("time", 't', &m_targetTime,
+        "Print the smallest reservation for a dump in <NUMBER> seconds"));
+    m_options.push_back(new StringOption("history", 'H', &m_history,
+        "Also learn from the stats.json files of the dumps in <STRING>"));
+}
 
 // -----------------------------------------------------------------------------
 const char *Calibrate::getName() const
@@ -1001,174 +1813,316 @@ void Calibrate::execute()
         return;
     }
 
-    MemMap mm;
-    unsigned long required, prev;
-    unsigned long minlow = MINLOW_KB;
+    // The probes below are independent of each other, so run them
+    // concurrently. Each of them handles its own errors like before;
+    // errors that are fatal are re-thrown where the result is used.
+    Configuration *config = Configuration::config();
     unsigned long pagesize = sysconf(_SC_PAGESIZE);
+
+    std::unique_ptr<MemMap> memmap;
+    std::exception_ptr memmap_error;
+    unsigned long fb_kb = 0;
+    StringVector luks;
+    StringVector luks_sums;
+    bool luks_ok = true;
+    unsigned long slab_kb = 0;
+    unsigned long cpus = 0;
+    std::exception_ptr cpus_error;
+    std::unique_ptr<MemoryHistory> history;
+
+    TaskGraph probes(PROBE_THREADS);
+    probes.add("memmap", [&memmap, &memmap_error]() {
+	    try {
+		memmap.reset(new MemMap());
+	    } catch (...) {
+		memmap_error = std::current_exception();
+	    }
+	});
+
+    // Double the size, because fbcon allocates its own
+    // framebuffer, and many DRM drivers allocate the hw
+    // framebuffer in system RAM
+    probes.add("framebuffers", [&fb_kb]() {
+	    try {
+		Framebuffers fb;
+		fb_kb = 2 * fb.size() / 1024UL;
+	    } catch(KError &e) {
+		Debug::debug()->dbg("Cannot get framebuffer size: %s",
+				    e.what());
+		fb_kb = 2 * DEF_FRAMEBUFFER_KB;
+	    }
+	});
+
+    // LUKS Argon2 hash requires a lot of memory
+    probes.add("luks", [config, &luks, &luks_sums, &luks_ok]() {
+	    try {
+		luks = luksDevices(config);
+		for (size_t i = 0; i < luks.size(); ++i)
+		    luks_sums.push_back(luksHeaderSum(luks[i]));
+	    } catch (KError &e) {
+		Debug::debug()->dbg("Cannot check encrypted volumes: %s",
+				    e.what());
+		luks_ok = false;
+	    }
+	});
+
+    // Add space for constant slabs
+    probes.add("slabs", [pagesize, &slab_kb]() {
+	    try {
+		SlabInfos slab;
+		SlabInfos::Map info = slab.getInfo();
+		SlabInfos::Map::iterator it;
+		for (it = info.begin(); it != info.end(); ++it) {
+		    if (it->first.startsWith("Acpi-") ||
+			it->first.startsWith("ftrace_") ) {
+			unsigned long slabsize = it->second->numSlabs() *
+			    it->second->pagesPerSlab() * pagesize / 1024;
+			slab_kb += slabsize;
+
+			Debug::debug()->dbg("Adding %ld KiB for %s slab cache",
+					    slabsize,
+					    it->second->name().c_str());
+		    }
+		}
+	    } catch (KError &e) {
+		Debug::debug()->dbg("Cannot get slab sizes: %s", e.what());
+	    }
+	});
+
+    // Add memory based on CPU count
+    probes.add("cpus", [config, &cpus, &cpus_error]() {
+	    try {
+		if (CAN_REDUCE_CPUS)
+		    cpus = config->KDUMP_CPUS.value();
+		if (!cpus) {
+		    SystemCPU syscpu;
+		    unsigned long online = syscpu.numOnline();
+		    unsigned long offline = syscpu.numOffline();
+		    Debug::debug()->dbg("CPUs online: %lu, offline: %lu",
+					online, offline);
+		    cpus = online + offline;
+		}
+	    } catch (...) {
+		cpus_error = std::current_exception();
+	    }
+	});
+
+    // Memory usage of earlier dumps in the local dump directories and
+    // in the directory given with --history (e.g. copied from the
+    // collector)
+    probes.add("history", [this, config, &history]() {
+	    try {
+		history.reset(new MemoryHistory(Util::getHostDomain(),
+						config->KDUMP_DUMPFORMAT.value(),
+						config->KDUMP_DUMPLEVEL.value()));
+		std::istringstream iss(config->KDUMP_SAVEDIR.value());
+		std::string elem;
+		while (iss >> elem) {
+		    RootDirURL url(elem, std::string());
+		    if (url.getProtocol() == RootDirURL::PROT_FILE)
+			history->addDir(url.getRealPath());
+		}
+		if (!m_history.empty())
+		    history->addDir(m_history);
+	    } catch (KError &e) {
+		Debug::debug()->dbg("Cannot read earlier dumps: %s", e.what());
+		history.reset();
+	    }
+	});
+
+    probes.run();
+
+    if (memmap_error)
+	std::rethrow_exception(memmap_error);
+    MemMap &mm = *memmap;
+
+    // All inputs of the calculation except the memory needed for the
+    // LUKS devices, which takes a cryptsetup run for each of them
+    std::ostringstream fp;
+    fp << "version " PACKAGE_VERSION "\n";
+    MemMap::List::const_iterator rit;
+    for (rit = mm.ranges().begin(); rit != mm.ranges().end(); ++rit)
+	fp << "ram " << std::hex << (*rit)->start() << "-"
+	   << (*rit)->end() << std::dec << "\n";
+    fp << "pagesize " << pagesize << "\n";
+    fp << "framebuffers " << fb_kb << "\n";
+    fp << "slabs " << slab_kb << "\n";
+    if (luks_ok) {
+	for (size_t i = 0; i < luks.size(); ++i)
+	    fp << "luks " << luks[i] << " " << luks_sums[i] << "\n";
+    } else
+	fp << "luks unknown\n";
+    if (cpus_error)
+	fp << "cpus unknown\n";
+    else
+	fp << "cpus " << cpus << "\n";
+    unsigned long initrd_unpacked_kb, initrd_packed_kb;
+    bool initrd_known = readInitrdSize(initrd_unpacked_kb, initrd_packed_kb);
+    if (initrd_known)
+	fp << "initrd " << initrd_packed_kb << " " << initrd_unpacked_kb
+	   << "\n";
+    if (history)
+	fp << history->fingerprint();
+    string fingerprint;
+    try {
+	fp << "KDUMP_SAVEDIR " << config->KDUMP_SAVEDIR.value() << "\n";
+	fp << "KDUMP_COPY_KERNEL " << config->KDUMP_COPY_KERNEL.value() << "\n";
+	fp << "network " << config->needsNetwork() << "\n";
+	fp << "KDUMPTOOL_FLAGS " << config->KDUMPTOOL_FLAGS.value() << "\n";
+	fp << "KDUMP_CPUS " << config->KDUMP_CPUS.value() << "\n";
+	fp << "KDUMP_SFTP_WINDOW " << config->KDUMP_SFTP_WINDOW.value() << "\n";
+	fp << "KDUMP_SFTP_CHUNK_SIZE " << config->KDUMP_SFTP_CHUNK_SIZE.value()
+	   << "\n";
+	fp << "KDUMP_NFS_MOUNT_OPTIONS "
+	   << config->KDUMP_NFS_MOUNT_OPTIONS.value() << "\n";
+	fp << "KDUMP_CIFS_MOUNT_OPTIONS "
+	   << config->KDUMP_CIFS_MOUNT_OPTIONS.value() << "\n";
+	fp << "KDUMP_TARGET_LAG " << config->KDUMP_TARGET_LAG.value() << "\n";
+	fp << "KDUMP_DEDUP_INDEX " << config->KDUMP_DEDUP_INDEX.value() << "\n";
+	fp << "makedumpfile " << config->needsMakedumpfile() << "\n";
+#if HAVE_FADUMP
+	fp << "KDUMP_FADUMP " << config->KDUMP_FADUMP.value() << "\n";
+#endif
+	fingerprint = fp.str();
+    } catch (KError &e) {
+	Debug::debug()->dbg("Cannot get the configuration: %s", e.what());
+    }
+
+    // recommendations are not cached
+    bool optimize = m_budget > 0 || m_targetTime > 0;
+    if (optimize)
+	fingerprint.clear();
+
+    string cached;
+    if (!m_force && !fingerprint.empty() && readCache(fingerprint, cached)) {
+	Debug::debug()->dbg("Using the cached result from %s",
+			    CALIBRATE_CACHE);
+	cout << cached;
+	return;
+    }
+
+    unsigned long crypto_kb = 0;
+    if (luks_ok) {
+	try {
+	    crypto_kb = cryptoMemory(luks);
+	    Debug::debug()->dbg("Adding %lu KiB for crypto devices",
+				crypto_kb);
+	} catch (KError &e) {
+	    Debug::debug()->dbg("Cannot check encrypted volumes: %s",
+				e.what());
+	    // Fall back to no allocation
+	}
+    }
+
+    unsigned long required;
+    unsigned long minlow = MINLOW_KB;
     unsigned long memtotal = shr_round_up(mm.total(), 10);
     unsigned long bootsize = DEF_BOOTSIZE;
 
     try {
-	Configuration *config = Configuration::config();
 	bool needsnet = config->needsNetwork();
 
 	// Get total RAM size
         Debug::debug()->dbg("Expected total RAM: %lu KiB", memtotal);
 
 	// Calculate boot requirements
-	unsigned long ramfs = INIT_KB;
-	if (needsnet)
-	    ramfs += INIT_NET_KB;
-	unsigned long initrd = (ramfs * INITRD_COMPRESS) / 100;
+	unsigned long ramfs, initrd;
+	if (initrd_known) {
+	    ramfs = initrd_unpacked_kb;
+	    initrd = initrd_packed_kb;
+	} else {
+	    ramfs = INIT_KB;
+	    if (needsnet)
+		ramfs += INIT_NET_KB;
+	    initrd = (ramfs * INITRD_COMPRESS) / 100;
+	}
 	bootsize = KERNEL_KB + KERNEL_INIT_KB + initrd + ramfs;
         Debug::debug()->dbg("Memory needed at boot: %lu KiB", bootsize);
 
 	// Run-time kernel requirements
 	required = KERNEL_KB + ramfs + KERNEL_DYNAMIC_KB;
 
-        // Double the size, because fbcon allocates its own
-        // framebuffer, and many DRM drivers allocate the hw
-        // framebuffer in system RAM
-	try {
-	    Framebuffers fb;
-	    required += 2 * fb.size() / 1024UL;
-	} catch(KError &e) {
-	    Debug::debug()->dbg("Cannot get framebuffer size: %s", e.what());
-	    required += 2 * DEF_FRAMEBUFFER_KB;
-	}
-
-        // LUKS Argon2 hash requires a lot of memory
-        try {
-            FilesystemTypeMap map;
-
-            if (config->KDUMP_COPY_KERNEL.value()) {
-                try {
-                    map.addPath("/boot");
-                } catch (KError&) {
-                    // ignore device resolution failures
-                }
-            }
-
-            std::istringstream iss(config->KDUMP_SAVEDIR.value());
-            std::string elem;
-            while (iss >> elem) {
-                RootDirURL url(elem, std::string());
-                if (url.getProtocol() == RootDirURL::PROT_FILE) {
-                    try {
-                        map.addPath(url.getRealPath());
-                    } catch (KError&) {
-                        // ignore device resolution failures
-                    }
-                }
-            }
-
-            unsigned long crypto_mem = 0;
-            StringStringMap devices = map.devices();
-            for (StringStringMap::iterator it = devices.begin();
-                 it != devices.end();
-                 ++it) {
-                if (it->second == "crypto_LUKS") {
-                    CryptInfo info(it->first);
-                    if (crypto_mem < info.memory())
-                        crypto_mem = info.memory();
-                }
-            }
-            required += crypto_mem;
-
-            Debug::debug()->dbg("Adding %lu KiB for crypto devices",
-                                crypto_mem);
-        } catch (KError &e) {
-	    Debug::debug()->dbg("Cannot check encrypted volumes: %s", e.what());
-            // Fall back to no allocation
-        }
+	required += fb_kb;
+	required += crypto_kb;
+	required += slab_kb;
 
-	// Add space for constant slabs
-	try {
-	    SlabInfos slab;
-	    SlabInfos::Map info = slab.getInfo();
-	    SlabInfos::Map::iterator it;
-	    for (it = info.begin(); it != info.end(); ++it) {
-		if (it->first.startsWith("Acpi-") ||
-		    it->first.startsWith("ftrace_") ) {
-		    unsigned long slabsize = it->second->numSlabs() *
-			it->second->pagesPerSlab() * pagesize / 1024;
-		    required += slabsize;
-
-		    Debug::debug()->dbg("Adding %ld KiB for %s slab cache",
-					slabsize, it->second->name().c_str());
-		}
-	    }
-	} catch (KError &e) {
-	    Debug::debug()->dbg("Cannot get slab sizes: %s", e.what());
-	}
-
-	// Add memory based on CPU count
-	unsigned long cpus = 0;
-	if (CAN_REDUCE_CPUS)
-	    cpus = config->KDUMP_CPUS.value();
-        if (!cpus) {
-	    SystemCPU syscpu;
-	    unsigned long online = syscpu.numOnline();
-	    unsigned long offline = syscpu.numOffline();
-	    Debug::debug()->dbg("CPUs online: %lu, offline: %lu",
-				online, offline);
-	    cpus = online + offline;
-	}
+	if (cpus_error)
+	    std::rethrow_exception(cpus_error);
 	Debug::debug()->dbg("Total assumed CPUs: %lu", cpus);
 
 	// User-space requirements
 	unsigned long user = USER_BASE_KB;
 	if (needsnet)
 	    user += USER_NET_KB;
+	user += transferMemory(config);
 
+	if (optimize) {
+	    SystemCPU syscpu;
+	    DumpModel model;
+	    model.base_kb = required;
+	    model.user_kb = user;
+	    model.memtotal = memtotal;
+	    model.pagesize = pagesize;
+	    model.bootsize = bootsize;
+	    model.syscpus = syscpu.numOnline() + syscpu.numOffline();
+	    model.split =
+		config->kdumptoolContainsFlag(Configuration::FLAG_SPLIT) &&
+		!config->kdumptoolContainsFlag(Configuration::FLAG_NOSPLIT);
+	    model.filter = config->KDUMP_DUMPLEVEL.value() != 0;
+	    model.pagecache = pageCacheUse(config);
+
+	    std::ostringstream out;
+	    printOptimum(out, model, m_budget, m_targetTime);
+	    cout << out.str();
+	    return;
+	}
+
+	// the part of user space that MemoryWatch measures
+	unsigned long kdump_kb = USER_KDUMP_KB;
 	if (config->needsMakedumpfile()) {
-	    // Estimate bitmap size (1 bit for every RAM page)
-	    unsigned long bitmapsz = shr_round_up(memtotal / pagesize, 2);
-	    if (bitmapsz > MAX_BITMAP_KB)
-		bitmapsz = MAX_BITMAP_KB;
+	    // Estimate bitmap size
+	    unsigned long bitmapsz = bitmapSize(memtotal, pagesize);
 	    Debug::debug()->dbg("Estimated bitmap size: %lu KiB", bitmapsz);
-	    user += bitmapsz;
+	    kdump_kb += bitmapsz;
 
 	    // Makedumpfile needs additional 96 B for every 128 MiB of RAM
-	    user += 96 * shr_round_up(memtotal, 20 + 7);
+	    kdump_kb += 96 * shr_round_up(memtotal, 20 + 7);
+	}
+	user += kdump_kb - USER_KDUMP_KB;
+
+	// Replace the model with the peaks of earlier dumps where they
+	// have been measured
+	PageCacheUse pagecache = pageCacheUse(config);
+	unsigned long pagecache_kb = 0;
+	if (history && !history->empty()) {
+	    unsigned long rss = history->rss() * (100 + HISTORY_MARGIN_PCT) / 100;
+	    unsigned long shortfall = history->shortfall(HISTORY_HEADROOM_PCT);
+	    Debug::debug()->dbg("Earlier dumps: %zu", history->size());
+	    Debug::debug()->dbg("Measured kdump-save and makedumpfile: "
+				"%llu KiB, model %lu KiB",
+				history->rss(), kdump_kb);
+	    Debug::debug()->dbg("Measured dirty pagecache: %llu KiB",
+				history->pageCache());
+	    if (shortfall) {
+		// the dump has come close to OOM, so nothing is tightened
+		shortfall = shortfall * (100 + HISTORY_MARGIN_PCT) / 100;
+		Debug::debug()->dbg("MemAvailable below %d%% of MemTotal, "
+				    "adding %lu KiB", HISTORY_HEADROOM_PCT,
+				    shortfall);
+		user += shortfall;
+		if (rss > kdump_kb)
+		    user += rss - kdump_kb;
+	    } else {
+		user = user - kdump_kb + rss;
+		pagecache_kb = history->pageCache() *
+		    (100 + HISTORY_MARGIN_PCT) / 100;
+	    }
 	}
         Debug::debug()->dbg("Total userspace: %lu KiB", user);
 	required += user;
 
-	// Make room for dirty pages and in-flight I/O:
-	//
-	//   required = prev + dirty + io
-	//      dirty = total * (DIRTY_RATIO / 100)
-	//	   io = dirty * (BUF_PER_DIRTY_MB / 1024)
-	//
-	// solve the above using integer math:
-	unsigned long dirty;
-	prev = required;
-	required = required * MB(100) /
-	    (MB(100) - MB(DIRTY_RATIO) - DIRTY_RATIO * BUF_PER_DIRTY_MB);
-	dirty = (required - prev) * MB(1) / (MB(1) + BUF_PER_DIRTY_MB);
-        Debug::debug()->dbg("Dirty pagecache: %lu KiB", dirty);
-        Debug::debug()->dbg("In-flight I/O: %lu KiB", required - prev - dirty);
-
-	// Account for memory between 0 and KDUMP_PHYS_LOAD
-	required += KDUMP_PHYS_LOAD;
-	Debug::debug()->dbg("Assumed load offset: %lu KiB", KDUMP_PHYS_LOAD);
-
-	// Account for "large hashes"
-	prev = required;
-	required = required * MB(1024) / (MB(1024) - KERNEL_HASH_PER_MB);
-        Debug::debug()->dbg("Large kernel hashes: %lu KiB", required - prev);
-
-	// Add space for memmap
-	prev = required;
-	required = required * pagesize / (pagesize - SIZE_STRUCT_PAGE);
-	unsigned long maxpfn = (required - prev) / SIZE_STRUCT_PAGE;
-	required = prev + align_memmap(maxpfn) * SIZE_STRUCT_PAGE;
-        Debug::debug()->dbg("Maximum memmap size: %lu KiB", required - prev);
-
-        // Memory between 0 and KDUMP_PHYS_LOAD is not really allocated,
-        // so subtract it again after memmap has been sized.
-	required -= KDUMP_PHYS_LOAD;
+	required = addKernelOverhead(required, pagesize, pagecache,
+				     pagecache_kb, true);
 
 	// Make sure there is enough space at boot
 	Debug::debug()->dbg("Total run-time size: %lu KiB", required);
@@ -1205,11 +2159,17 @@ void Calibrate::execute()
         }
 #endif
     } catch(KError &e) {
+	// there is no default for a recommendation
+	if (optimize)
+	    throw;
 	Debug::debug()->info(e.what());
 	required = DEF_RESERVE_KB;
+	// do not cache the fallback
+	fingerprint.clear();
     }
 
-    cout << "Total: " << (memtotal >> 10) << endl;
+    std::ostringstream out;
+    out << "Total: " << (memtotal >> 10) << endl;
 
 #if defined(__x86_64__)
     unsigned long long base = mm.find(required << 10, 16UL << 20);
@@ -1232,24 +2192,28 @@ void Calibrate::execute()
 	if (high < bootsize)
 	    high = bootsize;
     }
-    cout << "Low: " << shr_round_up(low, 10) << endl;
-    cout << "High: " << shr_round_up(high, 10) << endl;
-    cout << "MinLow: " << shr_round_up(low, 10) << endl;
-    cout << "MaxLow: " << (mm.largest(1ULL<<32) >> 20) << endl;
-    cout << "MinHigh: 0" << endl;
-    cout << "MaxHigh: " << (mm.largest() >> 20) << endl;
+    out << "Low: " << shr_round_up(low, 10) << endl;
+    out << "High: " << shr_round_up(high, 10) << endl;
+    out << "MinLow: " << shr_round_up(low, 10) << endl;
+    out << "MaxLow: " << (mm.largest(1ULL<<32) >> 20) << endl;
+    out << "MinHigh: 0" << endl;
+    out << "MaxHigh: " << (mm.largest() >> 20) << endl;
 #else
-    cout << "Low: " << shr_round_up(required, 10) << endl;
-    cout << "High: 0" << endl;
-    cout << "MinLow: " << shr_round_up(minlow, 10) << endl;
+    out << "Low: " << shr_round_up(required, 10) << endl;
+    out << "High: 0" << endl;
+    out << "MinLow: " << shr_round_up(minlow, 10) << endl;
 # if defined(__i386__)
-    cout << "MaxLow: " << (mm.largest(512ULL<<20) >> 20) << endl;
+    out << "MaxLow: " << (mm.largest(512ULL<<20) >> 20) << endl;
 # else
-    cout << "MaxLow: " << (mm.largest() >> 20) << endl;
+    out << "MaxLow: " << (mm.largest() >> 20) << endl;
 # endif
-    cout << "MinHigh: 0 " << endl;
-    cout << "MaxHigh: 0 " << endl;
+    out << "MinHigh: 0 " << endl;
+    out << "MaxHigh: 0 " << endl;
 #endif
+
+    cout << out.str();
+    if (!fingerprint.empty())
+	writeCache(fingerprint, out.str());
 }
 
 //}}}
@@ -49,6 +49,10 @@ class Calibrate : public Subcommand {
         void execute();
 
     private:
+        bool m_force;
+        int m_budget;
+        int m_targetTime;
+        std::string m_history;
 };
 
 //}}}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#if defined(__x86_64__)
+#  include <immintrin.h>
+#elif defined(__aarch64__)
+#  include <arm_acle.h>
+#  include <sys/auxv.h>
+#  include <asm/hwcap.h>
+#endif
+
+#include "checksum.h"
+
+using std::string;
+
+//{{{ Crc32c -------------------------------------------------------------------
+
+// reflected Castagnoli polynomial
+#define CRC32C_POLY	0x82f63b78
+
+typedef uint32_t (*Crc32cFunc)(uint32_t crc, const char *data, size_t len);
+
+// tables for slicing-by-8
+static uint32_t crcTable[8][256];
+
+// -----------------------------------------------------------------------------
+static void initTable(void)
+{
+    for (unsigned i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int k = 0; k < 8; ++k)
+            crc = crc & 1 ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+        crcTable[0][i] = crc;
+    }
+    for (unsigned i = 0; i < 256; ++i)
+        for (int t = 1; t < 8; ++t)
+            crcTable[t][i] = (crcTable[t - 1][i] >> 8) ^
+                crcTable[0][crcTable[t - 1][i] & 0xff];
+}
+
+// Portable version, eight bytes at a time
+static uint32_t crc32cGeneric(uint32_t crc, const char *data, size_t len)
+{
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+
+    crc = ~crc;
+    for (; len >= 8; len -= 8, p += 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        lo = __builtin_bswap32(lo);
+        hi = __builtin_bswap32(hi);
+#endif
+        lo ^= crc;
+        crc = crcTable[7][lo & 0xff] ^ crcTable[6][(lo >> 8) & 0xff] ^
+            crcTable[5][(lo >> 16) & 0xff] ^ crcTable[4][lo >> 24] ^
+            crcTable[3][hi & 0xff] ^ crcTable[2][(hi >> 8) & 0xff] ^
+            crcTable[1][(hi >> 16) & 0xff] ^ crcTable[0][hi >> 24];
+    }
+    while (len--)
+        crc = (crc >> 8) ^ crcTable[0][(crc ^ *p++) & 0xff];
+    return ~crc;
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32cSSE42(uint32_t crc, const char *data, size_t len)
+{
+    uint64_t c = ~crc;
+
+    for (; len >= 8; len -= 8, data += 8) {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        c = _mm_crc32_u64(c, word);
+    }
+    uint32_t c32 = c;
+    while (len--)
+        c32 = _mm_crc32_u8(c32, *data++);
+    return ~c32;
+}
+
+#elif defined(__aarch64__)
+
+__attribute__((target("+crc")))
+static uint32_t crc32cARMv8(uint32_t crc, const char *data, size_t len)
+{
+    crc = ~crc;
+    for (; len >= 8; len -= 8, data += 8) {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        crc = __crc32cd(crc, word);
+    }
+    while (len--)
+        crc = __crc32cb(crc, *data++);
+    return ~crc;
+}
+
+#endif
+
+static const char *crc32cName;
+
+// Choose the best implementation for the running CPU
+static Crc32cFunc selectCrc32c(void)
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        crc32cName = "SSE4.2";
+        return crc32cSSE42;
+    }
+#elif defined(__aarch64__)
+    if (getauxval(AT_HWCAP) & HWCAP_CRC32) {
+        crc32cName = "ARMv8 CRC32";
+        return crc32cARMv8;
+    }
+#endif
+    initTable();
+    crc32cName = "slicing-by-8";
+    return crc32cGeneric;
+}
+
+// -----------------------------------------------------------------------------
+static Crc32cFunc crc32cFunc(void)
+{
+    static const Crc32cFunc func = selectCrc32c();
+    return func;
+}
+
+// -----------------------------------------------------------------------------
+void Crc32c::update(const char *data, size_t len)
+{
+    m_crc = crc32cFunc()(m_crc, data, len);
+}
+
+// -----------------------------------------------------------------------------
+string Crc32c::hex() const
+{
+    char buf[9];
+    snprintf(buf, sizeof buf, "%08x", (unsigned)m_crc);
+    return string(buf);
+}
+
+// -----------------------------------------------------------------------------
+const char *Crc32c::implementation()
+{
+    crc32cFunc();
+    return crc32cName;
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <string>
+#include <stdint.h>
+#include <sys/types.h>
+
+//{{{ Crc32c -------------------------------------------------------------------
+
+/**
+ * CRC-32C (Castagnoli) as used by iSCSI, ext4 and btrfs.
+ *
+ * The SSE4.2 crc32 instruction or the ARMv8 CRC32 extension is used if
+ * the CPU supports it; a table-driven implementation otherwise.
+ */
+class Crc32c {
+
+    public:
+
+        Crc32c()
+            : m_crc(0)
+        { }
+
+        /**
+         * Adds data to the checksum.
+         */
+        void update(const char *data, size_t len);
+
+        /**
+         * Returns the checksum of all data so far.
+         */
+        uint32_t value() const
+        { return m_crc; }
+
+        /**
+         * Returns the checksum as eight hexadecimal digits.
+         */
+        std::string hex() const;
+
+        /**
+         * Starts over with an empty checksum.
+         */
+        void reset()
+        { m_crc = 0; }
+
+        /**
+         * Returns the name of the implementation used on this CPU.
+         */
+        static const char *implementation();
+
+    private:
+        uint32_t m_crc;
+};
+
+//}}}
+
+#endif /* CHECKSUM_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
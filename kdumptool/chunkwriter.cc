@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <unistd.h>
+
+#include "global.h"
+#include "debug.h"
+#include "stringutil.h"
+#include "util.h"
+#include "probes.h"
+#include "spaceguard.h"
+#include "writeback.h"
+#include "chunkwriter.h"
+
+//{{{ ChunkWriter --------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+ChunkWriter::ChunkWriter(int fd, unsigned depth, size_t blockSize,
+                         SpaceGuard *guard, WritebackWindow *window)
+    : m_fd(fd), m_depth(std::max(depth, 1U)), m_blockSize(blockSize),
+      m_guard(guard), m_window(window), m_end(0),
+      m_busy(false), m_stop(false), m_sparse(0), m_written(0)
+{
+    m_thread = std::thread(&ChunkWriter::run, this);
+}
+
+// -----------------------------------------------------------------------------
+ChunkWriter::~ChunkWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    m_thread.join();
+}
+
+// -----------------------------------------------------------------------------
+void ChunkWriter::rethrow()
+{
+    if (m_error) {
+        std::exception_ptr error = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+// -----------------------------------------------------------------------------
+void ChunkWriter::write(DataChunk &&chunk)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait(lock, [this]() {
+            return m_queue.size() < m_depth || m_error;
+        });
+    rethrow();
+
+    Item item;
+    item.end = m_end;
+    m_end = std::max(m_end, chunk.offset() + (off_t)chunk.length());
+    item.chunk = std::move(chunk);
+    m_queue.push_back(std::move(item));
+    m_cond.notify_all();
+}
+
+// -----------------------------------------------------------------------------
+void ChunkWriter::drain()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait(lock, [this]() {
+            return (m_queue.empty() && !m_busy) || m_error;
+        });
+    rethrow();
+}
+
+// -----------------------------------------------------------------------------
+void ChunkWriter::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_cond.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+        if (m_stop)
+            break;
+
+        Item item = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_busy = true;
+        lock.unlock();
+
+        std::exception_ptr error;
+        try {
+            writeChunk(item);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        // give the buffer back before anybody waits for it
+        item.chunk.reset();
+
+        lock.lock();
+        m_busy = false;
+        if (error) {
+            m_error = error;
+            m_queue.clear();
+        }
+        m_cond.notify_all();
+    }
+}
+
+// -----------------------------------------------------------------------------
+void ChunkWriter::writeChunk(const Item &item)
+{
+    const char *data = item.chunk.data();
+    size_t length = item.chunk.length();
+    off_t offset = item.chunk.offset();
+
+    // nothing has been written beyond the end yet, so zero blocks
+    // there can be left as holes
+    size_t run = 0;
+    for (size_t pos = 0; m_blockSize && pos < length; pos += m_blockSize) {
+        size_t len = std::min(m_blockSize, length - pos);
+        if (len != m_blockSize || offset + (off_t)pos < item.end ||
+                !Util::isZero(data + pos, len))
+            continue;
+
+        writeAt(m_fd, data + run, pos - run, offset + run, m_guard);
+        m_sparse += len;
+        KDUMP_PROBE1(file_skip, len);
+        run = pos + len;
+    }
+    writeAt(m_fd, data + run, length - run, offset + run, m_guard);
+
+    // pieces arrive mostly in order, so the end is a good guess
+    m_written = std::max(m_written, offset + (off_t)length);
+    if (m_window)
+        m_window->advance(m_written);
+}
+
+// -----------------------------------------------------------------------------
+void ChunkWriter::writeAt(int fd, const char *data, size_t len, off_t offset,
+                          SpaceGuard *guard)
+{
+    // write what fits, so that the file ends where it was stopped
+    size_t allowed = guard ? guard->allow(len) : len;
+    if (allowed < len) {
+        writeAt(fd, data, allowed, offset, NULL);
+        guard->check();
+    }
+
+    KDUMP_PROBE1(file_write, len);
+    while (len) {
+        ssize_t ret = pwrite(fd, data, len, offset);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret < 0)
+            throw KSystemError("FileTransfer::perform: pwrite() failed"
+                " at " + StringUtil::number2string(offset) + ".", errno);
+        data += ret;
+        len -= ret;
+        offset += ret;
+    }
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef CHUNKWRITER_H
+#define CHUNKWRITER_H
+
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <sys/types.h>
+
+#include "datachunk.h"
+
+class SpaceGuard;
+class WritebackWindow;
+
+//{{{ ChunkWriter --------------------------------------------------------------
+
+/**
+ * Writes DataChunk objects at their offsets in a file from a separate
+ * thread, so that the next chunk can be read while the previous ones
+ * are written. Each chunk is released (and its buffer goes back to the
+ * pool) as soon as it has been written.
+ *
+ * Zero blocks beyond the end of the data written so far are skipped,
+ * so that the file gets holes. Errors of the writer thread are thrown
+ * by the next call to write() or drain().
+ */
+class ChunkWriter {
+
+    public:
+        /**
+         * Starts the writer thread.
+         *
+         * @param[in] fd file descriptor open for writing
+         * @param[in] depth maximum number of queued chunks
+         * @param[in] blockSize size of the holes, 0 for no holes
+         * @param[in] guard the free space watch, or @c NULL
+         * @param[in] window the write-back window, or @c NULL
+         */
+        ChunkWriter(int fd, unsigned depth, size_t blockSize,
+                    SpaceGuard *guard = NULL, WritebackWindow *window = NULL);
+
+        /**
+         * Stops the writer thread. Queued chunks are dropped; call
+         * drain() first to get them written.
+         */
+        ~ChunkWriter();
+
+        /**
+         * Queues a chunk, waiting while the queue is full.
+         *
+         * @param[in] chunk the chunk, empty after the call
+         * @exception KError if an earlier write has failed
+         */
+        void write(DataChunk &&chunk);
+
+        /**
+         * Waits until all queued chunks are written.
+         *
+         * @exception KError if a write has failed
+         */
+        void drain();
+
+        /**
+         * Returns the end of the data queued so far.
+         */
+        off_t end() const
+        { return m_end; }
+
+        /**
+         * Returns the number of bytes skipped as holes. Only complete
+         * after drain().
+         */
+        unsigned long long sparse() const
+        { return m_sparse; }
+
+        /**
+         * Writes data at an offset with pwrite().
+         *
+         * @param[in] fd the target file
+         * @param[in] data the data to be written
+         * @param[in] len length of the data in bytes
+         * @param[in] offset the offset in the target file
+         * @param[in] guard the free space watch, or @c NULL
+         * @exception KNoSpaceError if @p guard stops the write
+         * @exception KError on any other error
+         */
+        static void writeAt(int fd, const char *data, size_t len,
+                            off_t offset, SpaceGuard *guard);
+
+    private:
+        ChunkWriter(const ChunkWriter &);
+        ChunkWriter &operator=(const ChunkWriter &);
+
+        struct Item {
+            DataChunk chunk;
+            off_t end;          // end of the data written before
+        };
+
+        void run();
+        void writeChunk(const Item &item);
+        void rethrow();
+
+        int m_fd;
+        unsigned m_depth;
+        size_t m_blockSize;
+        SpaceGuard *m_guard;
+        WritebackWindow *m_window;
+        off_t m_end;
+
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::deque<Item> m_queue;
+        bool m_busy;
+        bool m_stop;
+        std::exception_ptr m_error;
+        unsigned long long m_sparse;    // writer thread only
+        off_t m_written;                // writer thread only
+        std::thread m_thread;
+};
+
+//}}}
+
+#endif /* CHUNKWRITER_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <strings.h>
+#include <zlib.h>
+
+#include "global.h"
+#include "debug.h"
+#include "codecbench.h"
+#include "estimate.h"
+#include "process.h"
+#include "stringutil.h"
+#include "util.h"
+#include "vmcorecontext.h"
+
+#if HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+using std::string;
+using std::vector;
+
+/**
+ * Codecs that are not measured, relative to zlib. The factors are
+ * those of the format models in estimate.cc.
+ */
+struct CodecFactor {
+    const char *format;
+    double ratio;
+    double rate;
+};
+
+static const CodecFactor codec_factors[] = {
+    { "lzo",        40.0 / 30,  250.0 / 40 },
+    { "snappy",     40.0 / 30,  350.0 / 40 },
+    { "zstd",        1.0,       300.0 / 40 },
+};
+
+//{{{ CodecBenchmark -----------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+CodecBenchmark::CodecBenchmark(unsigned long workers)
+    : m_workers(workers ? workers : 1), m_pagesize(4096)
+{}
+
+// -----------------------------------------------------------------------------
+StringVector CodecBenchmark::supportedFormats()
+{
+    Debug::debug()->trace("CodecBenchmark::supportedFormats()");
+
+    std::ostringstream stdoutStream, stderrStream;
+    ProcessFilter p;
+    p.setStdout(&stdoutStream);
+    p.setStderr(&stderrStream);
+    try {
+        p.execute("makedumpfile", StringVector(1, "-v"));
+    } catch (const KError &error) {
+        Debug::debug()->dbg("Cannot run makedumpfile: %s", error.what());
+    }
+    return parseVersion(stdoutStream.str() + stderrStream.str());
+}
+
+// -----------------------------------------------------------------------------
+StringVector CodecBenchmark::parseVersion(const string &output)
+{
+    // "lzo\tenabled" etc.; makedumpfile always has zlib
+    StringVector ret(1, "compressed");
+    std::istringstream iss(output);
+    string line;
+    while (getline(iss, line)) {
+        string name, state;
+        std::istringstream(line) >> name >> state;
+        if (state == "enabled" &&
+            (name == "lzo" || name == "snappy" || name == "zstd"))
+            ret.push_back(name);
+    }
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+size_t CodecBenchmark::sample(const string &dump, size_t pages)
+{
+    Debug::debug()->trace("CodecBenchmark::sample(%s, %zu)",
+                          dump.c_str(), pages);
+
+    std::shared_ptr<const VmcoreContext> ctx = VmcoreContext::get(dump);
+    if (!ctx->isElf())
+        throw KError(dump + " is not an ELF dump.");
+    m_pagesize = DumpEstimator::fromVmcore(dump).pagesize();
+
+    const vector<VmcoreContext::Segment> &segments = ctx->segments();
+    unsigned long long total = 0;
+    for (size_t i = 0; i < segments.size(); ++i)
+        total += segments[i].filesz / m_pagesize;
+    if (!total || !pages)
+        return 0;
+    unsigned long long stride = std::max<unsigned long long>(total / pages, 1);
+
+    int fd = open(dump.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw KSystemError("Cannot open " + dump, errno);
+
+    m_sample.clear();
+    string page(m_pagesize, '\0');
+    unsigned long long next = 0, first = 0;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        unsigned long long count = segments[i].filesz / m_pagesize;
+        for (; next < first + count; next += stride) {
+            off_t offset = segments[i].offset +
+                (off_t)((next - first) * m_pagesize);
+            ssize_t ret = pread(fd, &page[0], m_pagesize, offset);
+            if (ret < 0) {
+                int err = errno;
+                close(fd);
+                throw KSystemError("Cannot read " + dump, err);
+            }
+            if ((size_t)ret == m_pagesize &&
+                !Util::isZero(page.data(), m_pagesize))
+                m_sample += page;
+        }
+        first += count;
+    }
+    close(fd);
+
+    size_t ret = m_sample.size() / m_pagesize;
+    Debug::debug()->dbg("Sampled %zu of %llu pages", ret, total);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void CodecBenchmark::setSample(const string &data, unsigned long pagesize)
+{
+    m_pagesize = pagesize;
+    m_sample = data.substr(0, data.size() / pagesize * pagesize);
+}
+
+// -----------------------------------------------------------------------------
+void CodecBenchmark::measure(Result &result) const
+{
+    size_t pages = m_sample.size() / m_pagesize;
+    unsigned long threads = std::min<unsigned long>(m_workers, pages);
+    bool zstd = result.format == "zstd";
+    vector<unsigned long long> out(threads, 0);
+
+    // every thread takes every n-th page, like the compression threads
+    // of makedumpfile
+    auto work = [&](unsigned long t) {
+        vector<unsigned char> buf(compressBound(m_pagesize) + 512);
+#if HAVE_ZSTD
+        ZSTD_CCtx *cctx = zstd ? ZSTD_createCCtx() : NULL;
+#endif
+        for (size_t i = t; i < pages; i += threads) {
+            const char *src = m_sample.data() + i * m_pagesize;
+            size_t len = m_pagesize;
+            if (!zstd) {
+                uLongf outlen = buf.size();
+                if (compress2(&buf[0], &outlen, (const Bytef *)src,
+                              m_pagesize, Z_BEST_SPEED) == Z_OK)
+                    len = outlen;
+            }
+#if HAVE_ZSTD
+            else if (cctx) {
+                size_t ret = ZSTD_compressCCtx(cctx, &buf[0], buf.size(),
+                                               src, m_pagesize, 1);
+                if (!ZSTD_isError(ret))
+                    len = ret;
+            }
+#endif
+            // incompressible pages are stored as they are
+            out[t] += std::min<size_t>(len, m_pagesize);
+        }
+#if HAVE_ZSTD
+        ZSTD_freeCCtx(cctx);
+#endif
+    };
+
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    vector<std::thread> pool;
+    for (unsigned long t = 1; t < threads; ++t)
+        pool.emplace_back(work, t);
+    if (threads)
+        work(0);
+    for (size_t t = 0; t < pool.size(); ++t)
+        pool[t].join();
+    double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+
+    unsigned long long total = 0;
+    for (size_t t = 0; t < out.size(); ++t)
+        total += out[t];
+    result.measured = true;
+    result.ratio = m_sample.empty() ? 1.0 : (double)total / m_sample.size();
+    result.rate = seconds > 0 ? m_sample.size() / seconds : 0;
+}
+
+// -----------------------------------------------------------------------------
+vector<CodecBenchmark::Result> CodecBenchmark::run(
+    const StringVector &formats) const
+{
+    Debug::debug()->trace("CodecBenchmark::run()");
+
+    Result zlib;
+    zlib.format = "compressed";
+    measure(zlib);
+
+    vector<Result> ret;
+    for (size_t i = 0; i < formats.size(); ++i) {
+        Result r = zlib;
+        r.format = formats[i];
+        if (strcasecmp(r.format.c_str(), "compressed") == 0) {
+            ret.push_back(zlib);
+            continue;
+        }
+#if HAVE_ZSTD
+        if (r.format == "zstd") {
+            measure(r);
+            ret.push_back(r);
+            continue;
+        }
+#endif
+        bool known = false;
+        for (size_t j = 0; j < sizeof codec_factors / sizeof codec_factors[0];
+             ++j) {
+            if (r.format != codec_factors[j].format)
+                continue;
+            r.measured = false;
+            r.ratio = std::min(zlib.ratio * codec_factors[j].ratio, 1.0);
+            r.rate = zlib.rate * codec_factors[j].rate;
+            known = true;
+        }
+        if (known)
+            ret.push_back(r);
+    }
+
+    for (size_t i = 0; i < ret.size(); ++i)
+        Debug::debug()->dbg("%s: %.0f%% at %llu MiB/s%s",
+                            ret[i].format.c_str(), ret[i].ratio * 100,
+                            (unsigned long long)ret[i].rate >> 20,
+                            ret[i].measured ? "" : " (derived)");
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+double CodecBenchmark::cost(const Result &result, unsigned long long target)
+{
+    double cpu = result.rate > 0 ? 1.0 / result.rate : 1.0;
+    double io = target ? result.ratio / target : 0.0;
+    return std::max(cpu, io);
+}
+
+// -----------------------------------------------------------------------------
+size_t CodecBenchmark::choose(const vector<Result> &results,
+                              unsigned long long target)
+{
+    size_t best = 0;
+    for (size_t i = 1; i < results.size(); ++i) {
+        double c = cost(results[i], target), b = cost(results[best], target);
+        // a tie goes to the smaller dump
+        if (c < b || (c == b && results[i].ratio < results[best].ratio))
+            best = i;
+    }
+    return best;
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef CODECBENCH_H
+#define CODECBENCH_H
+
+#include <string>
+#include <vector>
+
+#include "global.h"
+#include "stringvector.h"
+
+/**
+ * Number of pages compressed by the benchmark (16 MiB with 4 KiB pages).
+ */
+#define CODEC_SAMPLE_PAGES      4096
+
+//{{{ CodecBenchmark -----------------------------------------------------------
+
+/**
+ * Picks the makedumpfile compression for KDUMP_DUMPFORMAT=auto.
+ *
+ * A sample of pages from the dump is compressed page by page, as
+ * makedumpfile does, on the CPUs that the dump will use. zlib
+ * ("compressed") and, if kdumptool is built with it, zstd are measured;
+ * lzo and snappy are not linked into kdumptool, so their results are
+ * derived from the zlib measurement with fixed factors. The codec that
+ * finishes first wins: a fast codec is limited by the target, a strong
+ * one by the CPUs.
+ */
+class CodecBenchmark {
+
+    public:
+        /**
+         * Result of one codec.
+         */
+        struct Result {
+            std::string format;         // KDUMP_DUMPFORMAT value
+            bool measured;              // @c false if derived from zlib
+            double ratio;               // output bytes per input byte
+            double rate;                // input bytes per second
+        };
+
+        /**
+         * Creates a benchmark that uses @p workers threads.
+         */
+        CodecBenchmark(unsigned long workers);
+
+        /**
+         * Returns the formats that makedumpfile supports, according to
+         * "makedumpfile -v". "compressed" is always supported.
+         */
+        static StringVector supportedFormats();
+
+        /**
+         * Parses the output of "makedumpfile -v".
+         */
+        static StringVector parseVersion(const std::string &output);
+
+        /**
+         * Reads up to @p pages pages from the PT_LOAD segments of a dump.
+         * The pages are spread evenly over the memory; pages filled with
+         * zero are skipped, because makedumpfile excludes them anyway.
+         *
+         * @return the number of pages in the sample
+         * @exception KError if the dump cannot be read
+         */
+        size_t sample(const std::string &dump,
+                      size_t pages = CODEC_SAMPLE_PAGES);
+
+        /**
+         * Uses @p data as the sample.
+         */
+        void setSample(const std::string &data, unsigned long pagesize);
+
+        /**
+         * Compresses the sample with each of @p formats.
+         */
+        std::vector<Result> run(const StringVector &formats) const;
+
+        /**
+         * Returns the seconds per input byte of a result if the target
+         * writes @p target bytes per second (0 if unknown).
+         */
+        static double cost(const Result &result, unsigned long long target);
+
+        /**
+         * Returns the index of the result with the lowest cost().
+         */
+        static size_t choose(const std::vector<Result> &results,
+                             unsigned long long target);
+
+    protected:
+        /**
+         * Compresses the sample with zlib or zstd and fills in @p result.
+         */
+        void measure(Result &result) const;
+
+    private:
+        unsigned long m_workers;
+        unsigned long m_pagesize;
+        std::string m_sample;
+};
+
+//}}}
+
+#endif /* CODECBENCH_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -64,9 +64,98 @@ ShellConfigParser::ShellConfigParser(const string &filename)
     : ConfigParser(filename)
 {}
 
+// -----------------------------------------------------------------------------
+static bool is_name_char(char c, bool first)
+{
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_' ||
+        (!first && c >= '0' && c <= '9');
+}
+
+// -----------------------------------------------------------------------------
+// Apply the field splitting of the unquoted $NAME in the shell snippet,
+// i.e. fold white space.
+static bool shell_echo(const string &value, string &result)
+{
+    // globs and the escapes of some echo implementations need a shell
+    if (value.find_first_of("*?[\\") != string::npos)
+        return false;
+
+    static const char ifs[] = " \t\n";
+    string ret;
+    string::size_type pos = value.find_first_not_of(ifs);
+    if (pos != string::npos && pos > 0)
+        ret.push_back(' ');
+    bool first = true;
+    while (pos != string::npos) {
+        string::size_type end = value.find_first_of(ifs, pos);
+        if (!first)
+            ret.push_back(' ');
+        first = false;
+        ret.append(value, pos, end == string::npos ? end : end - pos);
+        pos = value.find_first_not_of(ifs, end);
+    }
+
+    result.swap(ret);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+bool ShellConfigParser::parseNative()
+{
+    ifstream fin(m_configFile.c_str());
+    if (!fin)
+        throw KSystemError("Cannot open config file " + m_configFile, errno);
+
+    StringStringMap variables = m_variables;
+    string s;
+    int no = 0;
+    while (getline(fin, s)) {
+        ++no;
+        string::size_type pos = s.find_first_not_of(" \t");
+        if (pos == string::npos || s[pos] == '#')
+            continue;
+
+        string::size_type end = pos;
+        while (end < s.size() && is_name_char(s[end], end == pos))
+            ++end;
+        string value;
+        if (end == pos || end >= s.size() || s[end] != '=' ||
+            !ShellQuotedString::unquote(s.substr(end + 1), value)) {
+            Debug::debug()->dbg("%s:%d needs a shell", m_configFile.c_str(),
+                                no);
+            return false;
+        }
+
+        // other variables are not printed by the shell snippet either
+        string name = s.substr(pos, end - pos);
+        StringStringMap::iterator it = variables.find(name);
+        if (it != variables.end())
+            it->second = value;
+    }
+    if (fin.bad())
+        throw KSystemError("Cannot read config file " + m_configFile, errno);
+
+    for (StringStringMap::iterator it = variables.begin();
+            it != variables.end(); ++it) {
+        if (!shell_echo(it->second, it->second)) {
+            Debug::debug()->dbg("Value of %s needs a shell",
+                                it->first.c_str());
+            return false;
+        }
+        Debug::debug()->trace("ShellConfigParser: Setting %s to %s",
+            it->first.c_str(), it->second.c_str());
+    }
+
+    m_variables.swap(variables);
+    return true;
+}
+
 // -----------------------------------------------------------------------------
 void ShellConfigParser::parse()
 {
+    if (parseNative())
+        return;
+
     // check if the configuration file does exist
     ifstream fin(m_configFile.c_str());
     if (!fin)
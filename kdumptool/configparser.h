@@ -101,6 +101,10 @@ class ConfigParser {
  *
  * This mechanism is necessary for the /etc/sysconfig files to be parsed
  * according to the standard.
+ *
+ * Most files contain only comments and simple assignments, though, so
+ * these are parsed directly, and the shell is only started for files
+ * that use any other shell syntax.
  */
 class ShellConfigParser : public ConfigParser {
 
@@ -122,6 +126,15 @@ class ShellConfigParser : public ConfigParser {
          *            shell that actually parses the configuration file fails
          */
         virtual void parse();
+
+    protected:
+        /**
+         * Parses the file without a shell.
+         *
+         * @return @c true on success, @c false if the file needs a shell
+         * @exception KError if opening of the file failed
+         */
+        bool parseNative();
 };
 
 //}}}
@@ -18,15 +18,82 @@
  */
 #include <string>
 #include <sstream>
+#include <fstream>
+#include <cstring>
+#include <cerrno>
 #include <strings.h>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include "configuration.h"
 #include "configparser.h"
 #include "stringutil.h"
 #include "rootdirurl.h"
+#include "checksum.h"
+#include "debug.h"
 
 using std::string;
 
+#define SNAPSHOT_MAGIC      "KDUMPCFG"
+#define SNAPSHOT_VERSION    1
+
+// the config file is small; anything bigger is not worth a snapshot
+#define SNAPSHOT_MAX_SOURCE (1024*1024)
+
+/*
+ * Header of a configuration snapshot. It is followed by one record for
+ * each option in define_opt.h order: the 32-bit length of the value
+ * and the value written by ConfigOption::serialize(). All numbers are
+ * in host byte order, because the snapshot is read by the kdump initrd
+ * that is built on the same system.
+ */
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint32_t layout;            // Configuration::snapshotLayout()
+    uint32_t flags;             // KDUMPTOOL_FLAGS as a bitset
+    uint32_t source_crc;        // CRC-32C of the config file
+    uint32_t source_size;
+};
+
+// names and types of all options, so that a snapshot made by another
+// kdumptool version is rejected (together with the flag names)
+static const char snapshot_layout[] =
+#define DEFINE_OPT(name, type, defval, usage) #name ":" #type "\n"
+#include "define_opt.h"
+#undef DEFINE_OPT
+    ;
+
+// -----------------------------------------------------------------------------
+static uint32_t crc32c(const char *data, size_t len)
+{
+    Crc32c crc;
+    crc.update(data, len);
+    return crc.value();
+}
+
+// -----------------------------------------------------------------------------
+static bool sourceChecksum(const string &filename, uint32_t *crc,
+                           uint32_t *size)
+{
+    std::ifstream fin(filename.c_str(), std::ios::binary);
+    if (!fin)
+        return false;
+
+    string data(SNAPSHOT_MAX_SOURCE + 1, '\0');
+    fin.read(&data[0], data.size());
+    if (fin.bad() || fin.gcount() > SNAPSHOT_MAX_SOURCE)
+        return false;
+
+    *size = fin.gcount();
+    *crc = crc32c(data.data(), *size);
+    return true;
+}
+
 //{{{ StringConfigOption -------------------------------------------------------
 string StringConfigOption::valueAsString() const
 {
@@ -39,6 +106,19 @@ void StringConfigOption::update(const string &value)
     m_value = value;
 }
 
+// -----------------------------------------------------------------------------
+void StringConfigOption::serialize(string &out) const
+{
+    out += m_value;
+}
+
+// -----------------------------------------------------------------------------
+bool StringConfigOption::deserialize(const char *data, size_t len)
+{
+    m_value.assign(data, len);
+    return true;
+}
+
 //}}}
 
 //{{{ IntConfigOption ----------------------------------------------------------
@@ -55,6 +135,24 @@ void IntConfigOption::update(const string &value)
     ss >> m_value;
 }
 
+// -----------------------------------------------------------------------------
+void IntConfigOption::serialize(string &out) const
+{
+    int32_t value = m_value;
+    out.append(reinterpret_cast<const char *>(&value), sizeof value);
+}
+
+// -----------------------------------------------------------------------------
+bool IntConfigOption::deserialize(const char *data, size_t len)
+{
+    int32_t value;
+    if (len != sizeof value)
+        return false;
+    memcpy(&value, data, sizeof value);
+    m_value = value;
+    return true;
+}
+
 //}}}
 
 //{{{ BoolConfigOption -------------------------------------------------------
@@ -72,12 +170,48 @@ void BoolConfigOption::update(const string &value)
     m_value = !(val == "0" || val == "false" || val == "no");
 }
 
+// -----------------------------------------------------------------------------
+void BoolConfigOption::serialize(string &out) const
+{
+    out += m_value ? '\1' : '\0';
+}
+
+// -----------------------------------------------------------------------------
+bool BoolConfigOption::deserialize(const char *data, size_t len)
+{
+    if (len != 1)
+        return false;
+    m_value = *data != 0;
+    return true;
+}
+
 //}}}
 
 //{{{ Configuration ------------------------------------------------------------
 
 Configuration *Configuration::m_instance = NULL;
 
+// indexed by KdumptoolFlag
+const char *const Configuration::flag_names[FLAG_MAX] = {
+    "NOSPARSE",
+    "SPLIT",
+    "NOSPLIT",
+    "SINGLE",
+    "XENALLDOMAINS",
+    "STRIPE",
+    "CHECKSUM",
+    "ASYNCIO",
+    "TRUNCATE",
+    "WRITEBACK",
+    "DEDUP",
+    "NONUMA",
+    "PRIORITY",
+    "MAKEDUMPFILE",
+    "FASTEST",
+    "PERF",
+    "DISKDUMP",
+};
+
 // -----------------------------------------------------------------------------
 Configuration *Configuration::config()
 {
@@ -99,41 +233,176 @@ Configuration::Configuration()
 #undef KEXEC
 #undef DUMP
 #undef DEFINE_OPT
-    m_readConfig(false)
-{
-    m_options.reserve(optionCount);
+    m_readConfig(false), m_flags(0),
+    m_options{{
 #define DEFINE_OPT(name, type, defval, usage)				\
-    m_options.push_back(&name);
+    &name,
 #include "define_opt.h"
 #undef DEFINE_OPT
-}
+    }}
+{ }
 
 /* -------------------------------------------------------------------------- */
 void Configuration::readFile(const string &filename)
 {
     ShellConfigParser cp(filename);
 
-    std::vector<ConfigOption*>::iterator it;
-    for (it = m_options.begin(); it != m_options.end(); ++it) {
+    ConfigOptionIterator it;
+    for (it = optionsBegin(); it != optionsEnd(); ++it) {
         ConfigOption *opt = *it;
         cp.addVariable(opt->name(), opt->valueAsString());
     }
 
     cp.parse();
 
-    for (it = m_options.begin(); it != m_options.end(); ++it) {
+    for (it = optionsBegin(); it != optionsEnd(); ++it) {
         ConfigOption *opt = *it;
         opt->update(cp.getValue(opt->name()));
     }
 
+    updateFlags();
+    m_filename = filename;
     m_readConfig = true;
 }
 
 // -----------------------------------------------------------------------------
-bool Configuration::kdumptoolContainsFlag(const std::string &flag)
+void Configuration::updateFlags()
+{
+    m_flags = 0;
+
+    std::istringstream iss(KDUMPTOOL_FLAGS.value());
+    string flag;
+    while (iss >> flag) {
+        int i;
+        for (i = 0; i < FLAG_MAX; ++i)
+            if (flag == flag_names[i])
+                break;
+        if (i < FLAG_MAX)
+            m_flags |= 1U << i;
+        else
+            Debug::debug()->info("Unknown flag in KDUMPTOOL_FLAGS: %s",
+                                 flag.c_str());
+    }
+}
+
+// -----------------------------------------------------------------------------
+uint32_t Configuration::snapshotLayout()
+{
+    Crc32c crc;
+    crc.update(snapshot_layout, sizeof(snapshot_layout) - 1);
+    for (int i = 0; i < FLAG_MAX; ++i)
+        crc.update(flag_names[i], strlen(flag_names[i]) + 1);
+    return crc.value();
+}
+
+// -----------------------------------------------------------------------------
+void Configuration::writeSnapshot(std::ostream &out) const
 {
-    string::size_type pos = KDUMPTOOL_FLAGS.value().find(flag);
-    return pos != string::npos;
+    if (!m_readConfig)
+        throw KError("No configuration file has been read.");
+
+    SnapshotHeader hdr;
+    memset(&hdr, 0, sizeof hdr);
+    memcpy(hdr.magic, SNAPSHOT_MAGIC, sizeof hdr.magic);
+    hdr.version = SNAPSHOT_VERSION;
+    hdr.count = m_options.size();
+    hdr.layout = snapshotLayout();
+    hdr.flags = m_flags;
+    if (!sourceChecksum(m_filename, &hdr.source_crc, &hdr.source_size))
+        throw KError("Cannot read " + m_filename + ".");
+
+    string data(reinterpret_cast<const char *>(&hdr), sizeof hdr);
+    string value;
+    for (ConfigOptionIterator it = optionsBegin(); it != optionsEnd(); ++it) {
+        value.clear();
+        (*it)->serialize(value);
+        uint32_t len = value.size();
+        data.append(reinterpret_cast<const char *>(&len), sizeof len);
+        data += value;
+    }
+
+    out.write(data.data(), data.size());
+    if (!out)
+        throw KError("Cannot write the configuration snapshot.");
+}
+
+// -----------------------------------------------------------------------------
+bool Configuration::readSnapshot(const string &snapshot,
+                                 const string &filename)
+{
+    Debug::debug()->trace("Configuration::readSnapshot(%s, %s)",
+                          snapshot.c_str(), filename.c_str());
+
+    int fd = open(snapshot.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        Debug::debug()->dbg("Cannot open %s: %s", snapshot.c_str(),
+                            strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(SnapshotHeader))
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        Debug::debug()->dbg("Cannot map %s", snapshot.c_str());
+        return false;
+    }
+
+    const char *p = static_cast<const char *>(map);
+    const char *end = p + st.st_size;
+    SnapshotHeader hdr;
+    memcpy(&hdr, p, sizeof hdr);
+    p += sizeof hdr;
+
+    uint32_t crc, size;
+    bool ok = memcmp(hdr.magic, SNAPSHOT_MAGIC, sizeof hdr.magic) == 0 &&
+        hdr.version == SNAPSHOT_VERSION &&
+        hdr.count == m_options.size() &&
+        hdr.layout == snapshotLayout() &&
+        sourceChecksum(filename, &crc, &size) &&
+        hdr.source_crc == crc && hdr.source_size == size;
+    if (!ok) {
+        Debug::debug()->dbg("Ignoring stale snapshot %s", snapshot.c_str());
+        munmap(map, st.st_size);
+        return false;
+    }
+
+    // decode into copies, so that a truncated snapshot changes nothing
+    std::vector<string> values;
+    values.reserve(m_options.size());
+    for (size_t i = 0; i < m_options.size(); ++i) {
+        uint32_t len;
+        if (size_t(end - p) < sizeof len) {
+            ok = false;
+            break;
+        }
+        memcpy(&len, p, sizeof len);
+        p += sizeof len;
+        if (size_t(end - p) < len) {
+            ok = false;
+            break;
+        }
+        values.push_back(string(p, len));
+        p += len;
+    }
+    munmap(map, st.st_size);
+
+    if (ok) {
+        for (size_t i = 0; ok && i < m_options.size(); ++i)
+            ok = m_options[i]->deserialize(values[i].data(),
+                                           values[i].size());
+    }
+    if (!ok) {
+        Debug::debug()->dbg("Invalid snapshot %s", snapshot.c_str());
+        return false;
+    }
+
+    m_flags = hdr.flags;
+    m_filename = filename;
+    m_readConfig = true;
+    return true;
 }
 
 // -----------------------------------------------------------------------------
@@ -148,11 +417,13 @@ bool Configuration::needsNetwork()
     if (netconfig != "auto")
 	return true;
 
-    std::istringstream iss(KDUMP_SAVEDIR.value());
+    std::istringstream iss(KDUMP_SAVEDIR.value() + " " +
+                           KDUMP_TRIAGE_URL.value());
     string elem;
     while (iss >> elem) {
         URLParser url(elem);
-        if (url.getProtocol() != URLParser::PROT_FILE)
+        if (url.getProtocol() != URLParser::PROT_FILE &&
+            url.getProtocol() != URLParser::PROT_RAW)
 	    return true;
     }
 
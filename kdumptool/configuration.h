@@ -19,7 +19,9 @@
 #ifndef CONFIGURATION_H
 #define CONFIGURATION_H
 
-#include <vector>
+#include <string>
+#include <array>
+#include <stdint.h>
 #include <typeinfo>
 
 #include "global.h"
@@ -75,6 +77,22 @@ class ConfigOption {
 	 */
 	virtual bool isDefault(void) = 0;
 
+	/**
+	 * Append the binary representation of the value (for a snapshot).
+	 *
+	 * @param[out] out the string to append to
+	 */
+	virtual void serialize(std::string &out) const = 0;
+
+	/**
+	 * Set the value from its binary representation.
+	 *
+	 * @param[in] data the representation written by serialize()
+	 * @param[in] len the length of @p data
+	 * @return @c false if @p data is not valid
+	 */
+	virtual bool deserialize(const char *data, size_t len) = 0;
+
     protected:
 	const char *const m_name;
 	const unsigned m_usage;
@@ -120,6 +138,9 @@ class StringConfigOption : public ConfigOption {
 	virtual bool isDefault(void)
 	{ return m_value == m_defvalue; }
 
+	virtual void serialize(std::string &out) const;
+	virtual bool deserialize(const char *data, size_t len);
+
     protected:
 	const char *const m_defvalue;
 	std::string m_value;
@@ -162,6 +183,9 @@ class IntConfigOption : public ConfigOption {
 	virtual bool isDefault(void)
 	{ return m_value == m_defvalue; }
 
+	virtual void serialize(std::string &out) const;
+	virtual bool deserialize(const char *data, size_t len);
+
     protected:
 	const int m_defvalue;
 	int m_value;
@@ -204,6 +228,9 @@ class BoolConfigOption : public ConfigOption {
 	virtual bool isDefault(void)
 	{ return m_value == m_defvalue; }
 
+	virtual void serialize(std::string &out) const;
+	virtual bool deserialize(const char *data, size_t len);
+
     protected:
 	const bool m_defvalue;
 	bool m_value;
@@ -213,7 +240,7 @@ class BoolConfigOption : public ConfigOption {
 
 //{{{ Configuration ------------------------------------------------------------
 
-typedef std::vector<ConfigOption*>::const_iterator ConfigOptionIterator;
+typedef ConfigOption *const *ConfigOptionIterator;
 
 /**
  * Configuration. This is a singleton object. To use it, call
@@ -247,17 +274,44 @@ class Configuration {
 #undef DEFINE_OPT
 
         /**
-         * Total number of configuration options.
+         * Flags in KDUMPTOOL_FLAGS that are tested by kdumptool.
          */
-        static const int optionCount = sizeof(
-/* Since the include file does not contain anything beyond tokens removed
- * or interpreted by the preprocessor, we can use string concatenation to
- * create a dummy string with as many characters as there are options.
- */
-#define DEFINE_OPT(name, type, defval, usage) "."
+        enum KdumptoolFlag {
+            FLAG_NOSPARSE,
+            FLAG_SPLIT,
+            FLAG_NOSPLIT,
+            FLAG_SINGLE,
+            FLAG_XENALLDOMAINS,
+            FLAG_STRIPE,
+            FLAG_CHECKSUM,
+            FLAG_ASYNCIO,
+            FLAG_TRUNCATE,
+            FLAG_WRITEBACK,
+            FLAG_DEDUP,
+            FLAG_NONUMA,
+            FLAG_PRIORITY,
+            FLAG_MAKEDUMPFILE,
+            FLAG_FASTEST,
+            FLAG_PERF,
+            FLAG_DISKDUMP,
+            FLAG_MAX
+        };
+
+        /**
+         * Index of each option in define_opt.h order, e.g. OPT_KDUMP_CPUS.
+         */
+        enum OptionIndex {
+#define DEFINE_OPT(name, type, defval, usage)		\
+            OPT_ ## name,
 #include "define_opt.h"
 #undef DEFINE_OPT
-            ) - 1;           /* for the NUL character */
+            OPT_MAX
+        };
+
+        /**
+         * Total number of configuration options.
+         */
+        static const int optionCount = OPT_MAX;
 
     public:
         /**
@@ -278,13 +332,52 @@ class Configuration {
         void readFile(const std::string &filename);
 
         /**
-	 * Checks if KDUMPTOOL_FLAGS contains @p flag.
+         * Writes a binary snapshot of all option values, which can be
+         * read by readSnapshot() without a shell or any parsing.
+         *
+         * @param[out] out the output stream
+         * @exception KError if no configuration file has been read
+         */
+        void writeSnapshot(std::ostream &out) const;
+
+        /**
+         * Reads a snapshot written by writeSnapshot(). The snapshot is
+         * used only if it was made by the same kdumptool layout from
+         * the current contents of @p filename.
+         *
+         * @param[in] snapshot the snapshot file
+         * @param[in] filename the configuration file
+         * @return @c true if the snapshot was read, @c false if the
+         *         configuration file must be read instead
+         */
+        bool readSnapshot(const std::string &snapshot,
+                          const std::string &filename);
+
+        /**
+         * Checks if the configuration has been read from @p filename.
+         *
+         * @param[in] filename the configuration file
+         * @return @c true if readFile() or readSnapshot() has succeeded
+         *         for @p filename
+         */
+        bool hasRead(const std::string &filename) const
+        { return m_readConfig && m_filename == filename; }
+
+        /**
+	 * Checks if KDUMPTOOL_FLAGS contains @p flag. The flags are split
+	 * when the configuration is read, so this is a bit test.
 	 *
 	 * @return @c true if KDUMPTOOL_FLAGS contains the flag and @c false
 	 *         otherwise
-	 * @exception see Configuration::getStringValue()
 	 */
-	bool kdumptoolContainsFlag(const std::string &flag);
+	bool kdumptoolContainsFlag(KdumptoolFlag flag) const
+	{ return m_flags & (1U << flag); }
+
+	/**
+	 * Returns an option by its index.
+	 */
+	ConfigOption *option(OptionIndex index) const
+	{ return m_options[index]; }
 
 	/*
 	 * Checks whether this configuration needs network.
@@ -304,10 +397,10 @@ class Configuration {
 	bool needsMakedumpfile();
 
 	ConfigOptionIterator optionsBegin() const
-	{ return m_options.begin(); }
+	{ return m_options.data(); }
 
 	ConfigOptionIterator optionsEnd() const
-	{ return m_options.end(); }
+	{ return m_options.data() + m_options.size(); }
 
     protected:
         Configuration();
@@ -315,11 +408,25 @@ class Configuration {
         virtual ~Configuration()
         { }
 
+        /**
+         * Sets m_flags from KDUMPTOOL_FLAGS and warns about unknown flags.
+         */
+        void updateFlags();
+
+        /**
+         * Returns a checksum of the option and flag tables, which must
+         * match between writeSnapshot() and readSnapshot().
+         */
+        static uint32_t snapshotLayout();
+
     private:
         static Configuration *m_instance;
+        static const char *const flag_names[FLAG_MAX];
         bool m_readConfig;
+        std::string m_filename;
+        unsigned m_flags;
 
-	std::vector<ConfigOption*> m_options;
+	std::array<ConfigOption*, OPT_MAX> m_options;
 };
 
 //}}}
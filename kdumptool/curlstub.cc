@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+// the stubs take the arguments of curl_easy_setopt() as they are
+#define CURL_DISABLE_TYPECHECK 1
+
+#include <cstdarg>
+
+#include <curl/curl.h>
+
+#include "config.h"
+#include "global.h"
+#include "dynlib.h"
+
+// added in curl 7.71
+#ifndef CURLOPTTYPE_BLOB
+#   define CURLOPTTYPE_BLOB     40000
+#endif
+
+//{{{ libcurl ------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+static DynamicLibrary &libcurl()
+{
+    static DynamicLibrary lib(CURL_SONAME);
+    return lib;
+}
+
+DYNLIB_STUB(libcurl(), CURLcode, curl_global_init,
+            (long flags), (flags))
+DYNLIB_CLEANUP_STUB(libcurl(), void, curl_global_cleanup,
+                    (void), (), )
+
+DYNLIB_STUB(libcurl(), CURL *, curl_easy_init,
+            (void), ())
+DYNLIB_STUB(libcurl(), CURLcode, curl_easy_perform,
+            (CURL *curl), (curl))
+DYNLIB_STUB(libcurl(), CURLcode, curl_easy_pause,
+            (CURL *curl, int bitmask), (curl, bitmask))
+DYNLIB_STUB(libcurl(), const char *, curl_easy_strerror,
+            (CURLcode code), (code))
+DYNLIB_CLEANUP_STUB(libcurl(), void, curl_easy_cleanup,
+                    (CURL *curl), (curl), )
+
+DYNLIB_STUB(libcurl(), CURLM *, curl_multi_init,
+            (void), ())
+DYNLIB_STUB(libcurl(), CURLMcode, curl_multi_add_handle,
+            (CURLM *multi, CURL *curl), (multi, curl))
+DYNLIB_STUB(libcurl(), CURLMcode, curl_multi_perform,
+            (CURLM *multi, int *running), (multi, running))
+DYNLIB_STUB(libcurl(), CURLMcode, curl_multi_wait,
+            (CURLM *multi, struct curl_waitfd extra_fds[],
+             unsigned int extra_nfds, int timeout_ms, int *numfds),
+            (multi, extra_fds, extra_nfds, timeout_ms, numfds))
+DYNLIB_STUB(libcurl(), CURLMsg *, curl_multi_info_read,
+            (CURLM *multi, int *msgs), (multi, msgs))
+DYNLIB_STUB(libcurl(), const char *, curl_multi_strerror,
+            (CURLMcode code), (code))
+DYNLIB_CLEANUP_STUB(libcurl(), CURLMcode, curl_multi_remove_handle,
+                    (CURLM *multi, CURL *curl), (multi, curl), CURLM_OK)
+DYNLIB_CLEANUP_STUB(libcurl(), CURLMcode, curl_multi_cleanup,
+                    (CURLM *multi), (multi), CURLM_OK)
+
+DYNLIB_STUB(libcurl(), struct curl_slist *, curl_slist_append,
+            (struct curl_slist *list, const char *data), (list, data))
+DYNLIB_CLEANUP_STUB(libcurl(), void, curl_slist_free_all,
+                    (struct curl_slist *list), (list), )
+
+// -----------------------------------------------------------------------------
+extern "C" CURLcode curl_easy_setopt(CURL *curl, CURLoption option, ...)
+{
+    typedef CURLcode (*fn_t)(CURL *, CURLoption, ...);
+    static fn_t fn = reinterpret_cast<fn_t>(
+        libcurl().symbol("curl_easy_setopt"));
+
+    // the type of the argument follows from the number of the option
+    va_list ap;
+    va_start(ap, option);
+    CURLcode ret;
+    if (option < CURLOPTTYPE_OBJECTPOINT)
+        ret = fn(curl, option, va_arg(ap, long));
+    else if (option < CURLOPTTYPE_OFF_T)
+        ret = fn(curl, option, va_arg(ap, void *));
+    else if (option < CURLOPTTYPE_BLOB)
+        ret = fn(curl, option, va_arg(ap, curl_off_t));
+    else
+        ret = fn(curl, option, va_arg(ap, void *));
+    va_end(ap);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+extern "C" CURLcode curl_easy_getinfo(CURL *curl, CURLINFO info, ...)
+{
+    typedef CURLcode (*fn_t)(CURL *, CURLINFO, ...);
+    static fn_t fn = reinterpret_cast<fn_t>(
+        libcurl().symbol("curl_easy_getinfo"));
+
+    // all information is returned through a pointer
+    va_list ap;
+    va_start(ap, info);
+    CURLcode ret = fn(curl, info, va_arg(ap, void *));
+    va_end(ap);
+    return ret;
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
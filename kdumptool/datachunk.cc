@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include "global.h"
+#include "dataprovider.h"
+#include "datachunk.h"
+
+//{{{ DataChunk ----------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+void DataChunk::assign(BufferPool::Buffer &&buffer, size_t length,
+                       off_t offset)
+{
+    m_keep.reset();
+    m_buffer = std::move(buffer);
+    m_data = m_buffer.get();
+    m_length = length;
+    m_offset = offset;
+}
+
+// -----------------------------------------------------------------------------
+void DataChunk::assign(const std::shared_ptr<const char> &keep,
+                       const char *data, size_t length, off_t offset)
+{
+    m_buffer.reset();
+    m_keep = keep;
+    m_data = data;
+    m_length = length;
+    m_offset = offset;
+}
+
+// -----------------------------------------------------------------------------
+void DataChunk::reset()
+{
+    m_buffer.reset();
+    m_keep.reset();
+    m_data = NULL;
+    m_length = 0;
+    m_offset = 0;
+}
+
+//}}}
+//{{{ ChunkAdapter -------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+size_t ChunkAdapter::get(DataProvider *provider, DataChunk &chunk,
+                         size_t maxread)
+{
+    BufferPool::Buffer buffer = BufferPool::pool()->get(maxread);
+    off_t offset = m_offset;
+    size_t ret;
+    if (provider->canPlaceData())
+        ret = provider->getPlacedData(buffer.get(), maxread, &offset);
+    else {
+        ret = provider->getData(buffer.get(), maxread);
+        m_offset += ret;
+    }
+
+    if (ret == 0)
+        chunk.reset();
+    else
+        chunk.assign(std::move(buffer), ret, offset);
+    return ret;
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
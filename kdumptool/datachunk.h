@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef DATACHUNK_H
+#define DATACHUNK_H
+
+#include <memory>
+#include <sys/types.h>
+
+#include "bufferpool.h"
+
+class DataProvider;
+
+//{{{ DataChunk ----------------------------------------------------------------
+
+/**
+ * A piece of data returned by DataProvider::getChunk(), together with
+ * its offset in the target file.
+ *
+ * Unlike the buffer passed to DataProvider::getData(), the chunk owns
+ * the memory behind the data: either a buffer from the BufferPool or a
+ * reference to memory of the DataProvider (e.g. a mapped window of a
+ * file). A consumer may therefore keep several chunks, for example
+ * until their writes complete, while it asks for the next one. The
+ * memory is given back when the chunk is reset or destroyed.
+ */
+class DataChunk {
+
+    public:
+        DataChunk()
+            : m_data(NULL), m_length(0), m_offset(0)
+        {}
+
+        DataChunk(DataChunk &&other) = default;
+        DataChunk &operator=(DataChunk &&other) = default;
+
+        /**
+         * Makes the chunk own a buffer from the pool.
+         *
+         * @param[in] buffer the buffer with the data at its start
+         * @param[in] length number of bytes of data
+         * @param[in] offset offset of the data in the target file
+         */
+        void assign(BufferPool::Buffer &&buffer, size_t length, off_t offset);
+
+        /**
+         * Makes the chunk refer to memory that is kept alive by @p keep.
+         *
+         * @param[in] keep reference to the memory block
+         * @param[in] data start of the data (inside the block)
+         * @param[in] length number of bytes of data
+         * @param[in] offset offset of the data in the target file
+         */
+        void assign(const std::shared_ptr<const char> &keep,
+                    const char *data, size_t length, off_t offset);
+
+        /**
+         * Gives the memory back and leaves an empty chunk.
+         */
+        void reset();
+
+        /**
+         * Returns the start of the data.
+         */
+        const char *data() const
+        { return m_data; }
+
+        /**
+         * Returns the number of bytes of data.
+         */
+        size_t length() const
+        { return m_length; }
+
+        /**
+         * Returns the offset of the data in the target file.
+         */
+        off_t offset() const
+        { return m_offset; }
+
+    private:
+        DataChunk(const DataChunk &);
+        DataChunk &operator=(const DataChunk &);
+
+        BufferPool::Buffer m_buffer;
+        std::shared_ptr<const char> m_keep;
+        const char *m_data;
+        size_t m_length;
+        off_t m_offset;
+};
+
+//}}}
+//{{{ ChunkAdapter -------------------------------------------------------------
+
+/**
+ * Implements DataProvider::getChunk() on top of the older interface:
+ * the data is read with DataProvider::getPlacedData() if possible and
+ * with DataProvider::getData() otherwise, into a buffer from the pool.
+ * Sequential data gets consecutive offsets.
+ */
+class ChunkAdapter {
+
+    public:
+        ChunkAdapter()
+            : m_offset(0)
+        {}
+
+        /**
+         * Starts again at offset zero. Called from
+         * DataProvider::prepare().
+         */
+        void reset()
+        { m_offset = 0; }
+
+        /**
+         * Reads the next chunk.
+         *
+         * @param[in] provider the DataProvider that has the data
+         * @param[out] chunk the chunk
+         * @param[in] maxread the maximum number of bytes
+         * @return the number of bytes in @p chunk, 0 at the end of data
+         * @exception KError if reading from @p provider fails
+         */
+        size_t get(DataProvider *provider, DataChunk &chunk, size_t maxread);
+
+    private:
+        off_t m_offset;
+};
+
+//}}}
+
+#endif /* DATACHUNK_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
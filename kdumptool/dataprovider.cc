@@ -21,8 +21,19 @@
 #include <cstring>
 #include <cerrno>
 #include <algorithm>
+#include <iostream>
+#include <csignal>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <linux/fs.h>
+#include <linux/magic.h>
 
 #include "dataprovider.h"
 #include "global.h"
@@ -30,6 +41,8 @@
 #include "debug.h"
 #include "stringutil.h"
 #include "fileutil.h"
+#include "process.h"
+#include "probes.h"
 
 using std::fopen;
 using std::fread;
@@ -38,6 +51,11 @@ using std::min;
 using std::copy;
 using std::string;
 
+// requested size of the pipe from a child process
+#define PROCESS_PIPE_SIZE	(1024*1024)
+#define PROGRESS_COPYING	"Copying data"
+#define PROGRESS_OVERLAP	64
+
 //{{{ AbstractDataProvider -----------------------------------------------------
 
 // -----------------------------------------------------------------------------
@@ -57,10 +75,54 @@ void AbstractDataProvider::saveToFile(const StringVector &targets)
     throw KError("That DataProvider cannot save to a file.");
 }
 
+// -----------------------------------------------------------------------------
+bool AbstractDataProvider::canSplice() const
+{
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+size_t AbstractDataProvider::spliceData(int fd)
+{
+    throw KError("That DataProvider cannot splice data.");
+}
+
+// -----------------------------------------------------------------------------
+bool AbstractDataProvider::canMapData() const
+{
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+size_t AbstractDataProvider::mapData(const char **data, size_t maxread)
+{
+    throw KError("That DataProvider cannot map data.");
+}
+
+// -----------------------------------------------------------------------------
+bool AbstractDataProvider::canPlaceData() const
+{
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+size_t AbstractDataProvider::getPlacedData(char *buffer, size_t maxread,
+                                           off_t *offset)
+{
+    throw KError("That DataProvider cannot place data.");
+}
+
+// -----------------------------------------------------------------------------
+size_t AbstractDataProvider::getChunk(DataChunk &chunk, size_t maxread)
+{
+    return m_chunks.get(this, chunk, maxread);
+}
+
 // -----------------------------------------------------------------------------
 void AbstractDataProvider::prepare()
 {
     Debug::debug()->trace("AbstractDataProvider::prepare");
+    m_chunks.reset();
     if (m_progress)
         m_progress->start();
 }
@@ -98,74 +160,345 @@ bool AbstractDataProvider::getError() const
     return m_error;
 }
 
+// -----------------------------------------------------------------------------
+bool AbstractDataProvider::canRestart() const
+{
+    return false;
+}
+
 //}}}
 //{{{ FileDataProvider ---------------------------------------------------------
 
+// size of the mapped part of the file
+#define FILE_MAP_WINDOW		(32*1024*1024)
+
+// bytes copied by one system call in FileDataProvider::saveToFile(), and
+// the buffer size if the data has to be read and written
+#define FILE_COPY_CHUNK		(64*1024*1024)
+#define FILE_COPY_BUFFER	(1024*1024)
+
 // -----------------------------------------------------------------------------
 FileDataProvider::FileDataProvider(const char *filename)
     : m_filename(filename)
-    , m_file(NULL)
+    , m_fd(-1)
     , m_currentPos(0)
+    , m_mappable(false)
+    , m_window(NULL)
+    , m_windowPos(0)
+    , m_windowSize(0)
 {}
 
+// -----------------------------------------------------------------------------
+FileDataProvider::~FileDataProvider()
+{
+    unmapWindow();
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
 // -----------------------------------------------------------------------------
 void FileDataProvider::prepare()
 {
     Debug::debug()->trace("FileDataProvider::prepare");
 
-    m_file = fopen(m_filename.c_str(), "r");
-    if (!m_file)
+    m_fd = ::open(m_filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0)
         throw KSystemError("Cannot open file " + m_filename, errno);
 
-    // get the file size, we need to use the raw Unix interface
-    // because the ftell() function does not support large files on i386
-    int fd = fileno(m_file);
-    if (fd < 0)
-        throw KSystemError("fileno() failed with " + m_filename + ".", errno);
-
-    m_fileSize = lseek(fd, 0, SEEK_END);
+    m_fileSize = lseek(m_fd, 0, SEEK_END);
     if (m_fileSize == (off_t)-1)
         throw KSystemError("lseek() failed with " + m_filename + ".", errno);
+    m_currentPos = 0;
 
-    // and back to the beginning
-    int ret = lseek(fd, 0, SEEK_SET);
-    if (ret == (off_t)-1)
-        throw KSystemError("lseek() failed with " + m_filename + ".", errno);
+    // the data is read only once, from start to end
+    posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    m_mappable = true;
+    if (m_fileSize && !mapWindow()) {
+        Debug::debug()->dbg("Cannot map %s (%s), using pread()",
+                            m_filename.c_str(), strerror(errno));
+        m_mappable = false;
+    }
 
     AbstractDataProvider::prepare();
 }
 
 // -----------------------------------------------------------------------------
-size_t FileDataProvider::getData(char *buffer, size_t maxread)
+bool FileDataProvider::mapWindow()
 {
-    if (!m_file)
+    unmapWindow();
+
+    // FILE_MAP_WINDOW is a multiple of the page size
+    m_windowPos = m_currentPos - m_currentPos % FILE_MAP_WINDOW;
+    size_t size = std::min<loff_t>(FILE_MAP_WINDOW, m_fileSize - m_windowPos);
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, m_fd, m_windowPos);
+    if (map == MAP_FAILED)
+        return false;
+
+    madvise(map, size, MADV_SEQUENTIAL);
+    madvise(map, size, MADV_WILLNEED);
+    m_window = static_cast<char *>(map);
+    m_windowSize = size;
+
+    // chunks returned by getChunk() may outlive the window
+    m_windowRef.reset(m_window, [size](const char *p) {
+            munmap(const_cast<char *>(p), size);
+        });
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+void FileDataProvider::unmapWindow()
+{
+    if (m_window) {
+        m_windowRef.reset();
+        m_window = NULL;
+        m_windowSize = 0;
+    }
+}
+
+// -----------------------------------------------------------------------------
+size_t FileDataProvider::mapData(const char **data, size_t maxread)
+{
+    if (m_fd < 0)
         throw KError("File " + m_filename + " not opened.");
+    if (!m_mappable)
+        throw KError("File " + m_filename + " cannot be mapped.");
+
+    *data = NULL;
+    if (m_currentPos >= m_fileSize)
+        return 0;
 
-    errno = 0;
-    size_t ret = fread(buffer, 1, maxread, m_file);
-    if (ret == 0 && errno != 0) {
+    if (m_currentPos >= m_windowPos + (loff_t)m_windowSize &&
+        !mapWindow()) {
         setError(true);
-        throw KSystemError("Error reading from " + m_filename + " at " +
+        throw KSystemError("Cannot map " + m_filename + " at " +
             StringUtil::number2hex(m_currentPos), errno);
     }
 
+    size_t offset = m_currentPos - m_windowPos;
+    size_t ret = std::min(maxread, m_windowSize - offset);
+    *data = m_window + offset;
+    KDUMP_PROBE2(file_read, m_currentPos, ret);
+    m_currentPos += ret;
+
     Progress *p = getProgress();
     if (p)
-        p->progressed(lseek(fileno(m_file), 0, SEEK_CUR), m_fileSize);
+        p->progressed(m_currentPos, m_fileSize);
+
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+bool FileDataProvider::canMapData() const
+{
+    return m_mappable;
+}
+
+// -----------------------------------------------------------------------------
+size_t FileDataProvider::getChunk(DataChunk &chunk, size_t maxread)
+{
+    if (!m_mappable)
+        return AbstractDataProvider::getChunk(chunk, maxread);
+
+    const char *data;
+    off_t offset = m_currentPos;
+    size_t ret = mapData(&data, maxread);
+    if (ret)
+        chunk.assign(m_windowRef, data, ret, offset);
+    else
+        chunk.reset();
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+size_t FileDataProvider::getData(char *buffer, size_t maxread)
+{
+    if (m_fd < 0)
+        throw KError("File " + m_filename + " not opened.");
+
+    size_t ret;
+    if (m_mappable) {
+        const char *data;
+        ret = mapData(&data, maxread);
+        if (ret)
+            memcpy(buffer, data, ret);
+        return ret;
+    }
 
+    ssize_t len;
+    do {
+        len = pread(m_fd, buffer, maxread, m_currentPos);
+    } while (len < 0 && errno == EINTR);
+    if (len < 0) {
+        setError(true);
+        throw KSystemError("Error reading from " + m_filename + " at " +
+            StringUtil::number2hex(m_currentPos), errno);
+    }
+    ret = len;
+    KDUMP_PROBE2(file_read, m_currentPos, ret);
     m_currentPos += ret;
 
+    Progress *p = getProgress();
+    if (p)
+        p->progressed(m_currentPos, m_fileSize);
+
     return ret;
 }
 
+// -----------------------------------------------------------------------------
+bool FileDataProvider::canSaveToFile() const
+{
+    struct stat st;
+    struct statfs sfs;
+    return stat(m_filename.c_str(), &st) == 0 && S_ISREG(st.st_mode) &&
+        statfs(m_filename.c_str(), &sfs) == 0 &&
+        sfs.f_type != PROC_SUPER_MAGIC;
+}
+
+// -----------------------------------------------------------------------------
+void FileDataProvider::saveToFile(const StringVector &targets)
+{
+    Debug::debug()->trace("FileDataProvider::saveToFile(%s)",
+                          targets.front().c_str());
+
+    if (targets.size() > 1)
+        std::cerr << "WARNING: First dump target used; rest ignored."
+                  << std::endl;
+    const string &target = targets.front();
+
+    int in = ::open(m_filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0)
+        throw KSystemError("Cannot open file " + m_filename, errno);
+    int out = ::open(target.c_str(),
+                     O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (out < 0) {
+        int err = errno;
+        ::close(in);
+        throw KSystemError("Cannot create " + target, err);
+    }
+
+    try {
+        copyData(in, out);
+    } catch (...) {
+        ::close(out);
+        ::close(in);
+        throw;
+    }
+
+    ::close(in);
+    if (::close(out) != 0)
+        throw KSystemError("Error writing " + target, errno);
+}
+
+// -----------------------------------------------------------------------------
+void FileDataProvider::copyData(int in, int out)
+{
+    struct stat st;
+    if (fstat(in, &st) != 0)
+        throw KSystemError("Cannot stat " + m_filename, errno);
+    loff_t size = st.st_size;
+    Progress *p = getProgress();
+
+#ifdef FICLONE
+    // a reflink shares the extents, so nothing is copied at all
+    if (ioctl(out, FICLONE, in) == 0) {
+        Debug::debug()->dbg("Cloned %s", m_filename.c_str());
+        if (p)
+            p->progressed(size, size);
+        return;
+    }
+#endif
+
+    // fall back to the next method if the kernel or the file system
+    // does not support one
+    enum { CM_COPY_FILE_RANGE, CM_SENDFILE, CM_READ_WRITE } method =
+        CM_COPY_FILE_RANGE;
+    std::unique_ptr<char[]> buffer;
+
+    loff_t pos = 0;
+    while (pos < size) {
+        loff_t end = size;
+        loff_t data = lseek(in, pos, SEEK_DATA);
+        if (data < 0 && errno == ENXIO)
+            break;              // only a hole is left
+        if (data < 0)
+            data = pos;         // no SEEK_DATA on this file system
+        else {
+            end = lseek(in, data, SEEK_HOLE);
+            if (end < 0 || end > size)
+                end = size;
+        }
+
+        while (data < end) {
+            size_t len = std::min<loff_t>(end - data, FILE_COPY_CHUNK);
+            ssize_t done = -1;
+
+            if (method == CM_COPY_FILE_RANGE) {
+                loff_t inpos = data, outpos = data;
+                done = copy_file_range(in, &inpos, out, &outpos, len, 0);
+                if (done < 0 && (errno == EXDEV || errno == EINVAL ||
+                                 errno == ENOSYS || errno == EOPNOTSUPP)) {
+                    Debug::debug()->dbg("copy_file_range() failed (%s), "
+                                        "using sendfile()", strerror(errno));
+                    method = CM_SENDFILE;
+                    continue;
+                }
+            } else if (method == CM_SENDFILE) {
+                off_t inpos = data;
+                if (lseek(out, data, SEEK_SET) != data)
+                    throw KSystemError("Cannot seek in the target of " +
+                                       m_filename, errno);
+                done = sendfile(out, in, &inpos, len);
+                if (done < 0 && (errno == EINVAL || errno == ENOSYS)) {
+                    Debug::debug()->dbg("sendfile() failed (%s), "
+                                        "using read()", strerror(errno));
+                    method = CM_READ_WRITE;
+                    buffer.reset(new char[FILE_COPY_BUFFER]);
+                    continue;
+                }
+            } else {
+                len = std::min<size_t>(len, FILE_COPY_BUFFER);
+                done = pread(in, buffer.get(), len, data);
+                if (done > 0 && pwrite(out, buffer.get(), done, data) != done)
+                    throw KSystemError("Error writing the copy of " +
+                                       m_filename, errno ? errno : ENOSPC);
+            }
+
+            if (done < 0 && errno == EINTR)
+                continue;
+            if (done < 0)
+                throw KSystemError("Error copying " + m_filename + " at " +
+                    StringUtil::number2hex(data), errno);
+            if (done == 0)
+                throw KError("File " + m_filename + " shrank while it "
+                             "was copied.");
+
+            KDUMP_PROBE2(file_read, data, done);
+            data += done;
+            if (p)
+                p->progressed(data, size);
+        }
+        pos = end;
+    }
+
+    // the file may end with a hole
+    if (ftruncate(out, size) != 0)
+        throw KSystemError("Cannot set the size of the copy of " +
+                           m_filename, errno);
+    if (p)
+        p->progressed(size, size);
+}
+
 // -----------------------------------------------------------------------------
 void FileDataProvider::finish()
 {
     Debug::debug()->trace("FileDataProvider::finish");
 
-    if (m_file) {
-        fclose(m_file);
-        m_file = NULL;
+    unmapWindow();
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
     }
     AbstractDataProvider::finish();
 }
@@ -198,13 +531,38 @@ size_t BufferDataProvider::getData(char *buffer, size_t maxread)
 //{{{ ProcessDataProvider ------------------------------------------------------
 
 // -----------------------------------------------------------------------------
-ProcessDataProvider::ProcessDataProvider(const char *pipe_cmdline,
-                                         const char *direct_cmdline)
-    : m_pipeCmdline(pipe_cmdline), m_directCmdline(direct_cmdline),
-      m_processFile(NULL)
+ProcessDataProvider::ProcessDataProvider(const StringVector &pipe_args,
+                                         const StringVector &direct_args)
+    : m_pipeArgs(pipe_args), m_directArgs(direct_args), m_pipeSize(0),
+      m_permille(-1)
 {
     Debug::debug()->trace("ProcessDataProvider::ProcessDataProvider(%s, %s)",
-        pipe_cmdline, direct_cmdline);
+        pipe_args.join(' ').c_str(), direct_args.join(' ').c_str());
+}
+
+// -----------------------------------------------------------------------------
+ProcessDataProvider::~ProcessDataProvider()
+{
+    try {
+        kill();
+    } catch (const KError &error) {
+        Debug::debug()->dbg("%s", error.what());
+    }
+}
+
+// -----------------------------------------------------------------------------
+static int maxPipeSize()
+{
+    // the limit for unprivileged processes, which root may exceed;
+    // use it anyway, because it is the size the admin considers sane
+    int size = 0;
+    FILE *fp = fopen("/proc/sys/fs/pipe-max-size", "r");
+    if (fp) {
+        if (fscanf(fp, "%d", &size) != 1)
+            size = 0;
+        fclose(fp);
+    }
+    return std::max(size, PROCESS_PIPE_SIZE);
 }
 
 // -----------------------------------------------------------------------------
@@ -212,44 +570,207 @@ void ProcessDataProvider::prepare()
 {
     Debug::debug()->trace("ProcessDataProvider::prepare");
 
-    m_processFile = popen(m_pipeCmdline.c_str(), "r");
-    if (!m_processFile)
-        throw KSystemError("Could not start process " + m_pipeCmdline, errno);
+    m_errors.clear();
+    m_permille = -1;
+    m_stdout = std::make_shared<ChildToParentPipe>();
+    m_stderr = std::make_shared<ChildToParentPipe>();
+    m_process.reset(new SubProcess());
+    m_process->setChildFD(STDOUT_FILENO,
+                          std::shared_ptr<SubProcessFD>(m_stdout));
+    m_process->setChildFD(STDERR_FILENO,
+                          std::shared_ptr<SubProcessFD>(m_stderr));
+
+    StringVector args(m_pipeArgs.begin() + 1, m_pipeArgs.end());
+    m_process->spawn(m_pipeArgs.front(), args);
+
+    // a bigger pipe means less context switches with the child
+    int fd = m_stdout->readEnd();
+    int pipesz = fcntl(fd, F_SETPIPE_SZ, maxPipeSize());
+    if (pipesz < 0)
+        pipesz = fcntl(fd, F_SETPIPE_SZ, PROCESS_PIPE_SIZE);
+    if (pipesz < 0) {
+        Debug::debug()->dbg("Cannot set pipe size: %s", strerror(errno));
+        pipesz = fcntl(fd, F_GETPIPE_SZ);
+    }
+    m_pipeSize = pipesz > 0 ? pipesz : PROCESS_PIPE_SIZE;
+    Debug::debug()->dbg("Pipe size is %lu bytes", (unsigned long)m_pipeSize);
+
+    m_errorThread = std::thread(&ProcessDataProvider::readErrors, this,
+                                m_stderr->readEnd());
+}
+
+// -----------------------------------------------------------------------------
+void ProcessDataProvider::readErrors(int fd)
+{
+    char buffer[BUFSIZ];
+    ssize_t ret;
+
+    while ((ret = read(fd, buffer, sizeof buffer)) != 0) {
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        // a progress update may be split over two reads
+        string::size_type from = m_errors.size();
+        from = from > PROGRESS_OVERLAP ? from - PROGRESS_OVERLAP : 0;
+        m_errors.append(buffer, ret);
+        int permille = parsePermille(m_errors, from);
+        if (permille >= 0)
+            m_permille.store(permille, std::memory_order_relaxed);
+    }
+}
+
+// -----------------------------------------------------------------------------
+int ProcessDataProvider::parsePermille(const string &text,
+                                       string::size_type from)
+{
+    // e.g. "Copying data                      : [ 45.3 %] /  eta: 5s"
+    int ret = -1;
+    string::size_type pos = from;
+    while ((pos = text.find(PROGRESS_COPYING, pos)) != string::npos) {
+        pos += sizeof(PROGRESS_COPYING) - 1;
+        string::size_type bracket = text.find_first_not_of(" :", pos);
+        if (bracket == string::npos || text[bracket] != '[')
+            continue;
+        char *end;
+        double percent = strtod(text.c_str() + bracket + 1, &end);
+        while (*end == ' ')
+            ++end;
+        if (*end == '%' && percent >= 0 && percent <= 100)
+            ret = int(percent * 10 + 0.5);
+    }
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void ProcessDataProvider::printErrors()
+{
+    if (m_errors.empty())
+        return;
+
+    // keep only the last state of lines that are updated with '\r'
+    KString errors(m_errors);
+    StringVector lines = errors.split('\n');
+    StringVector::iterator it;
+    for (it = lines.begin(); it != lines.end(); ++it) {
+        while (!it->empty() && (*it)[it->size() - 1] == '\r')
+            it->erase(it->size() - 1);
+        string::size_type pos = it->rfind('\r');
+        if (pos != string::npos)
+            it->erase(0, pos + 1);
+        if (it->empty())
+            continue;
+        Debug::debug()->dbg("%s: %s", m_pipeArgs.front().c_str(),
+                            it->c_str());
+        std::cerr << *it << std::endl;
+    }
+    m_errors.clear();
 }
 
 // -----------------------------------------------------------------------------
 size_t ProcessDataProvider::getData(char *buffer, size_t maxread)
 {
-    if (!m_processFile)
-        throw KError("Process " + m_pipeCmdline + " not started.");
+    if (!m_process)
+        throw KError("Process " + m_pipeArgs.front() + " not started.");
+
+    ssize_t ret;
+    do {
+        ret = read(m_stdout->readEnd(), buffer, maxread);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret < 0) {
+        setError(true);
+        throw KSystemError("Error reading from " + m_pipeArgs.front(), errno);
+    }
+
+    KDUMP_PROBE1(process_read, ret);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+bool ProcessDataProvider::canSplice() const
+{
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+size_t ProcessDataProvider::spliceData(int fd)
+{
+    if (!m_process)
+        throw KError("Process " + m_pipeArgs.front() + " not started.");
 
-    errno = 0;
-    size_t ret = fread(buffer, 1, maxread, m_processFile);
-    if (ret == 0 && errno != 0) {
+    ssize_t ret;
+    do {
+        ret = splice(m_stdout->readEnd(), NULL, fd, NULL,
+                     m_pipeSize, SPLICE_F_MOVE | SPLICE_F_MORE);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret < 0) {
         setError(true);
-        throw KSystemError("Error reading from " + m_pipeCmdline, errno);
+        throw KSystemError("Error splicing from " + m_pipeArgs.front(), errno);
     }
 
+    KDUMP_PROBE1(process_read, ret);
     return ret;
 }
 
+// -----------------------------------------------------------------------------
+static string exitStatus(int status)
+{
+    if (WIFSIGNALED(status))
+        return "signal " + StringUtil::number2string(WTERMSIG(status));
+    return StringUtil::number2string(WEXITSTATUS(status));
+}
+
+// -----------------------------------------------------------------------------
+void ProcessDataProvider::kill()
+{
+    if (!m_process)
+        return;
+
+    // the child may wait for the pipe to become writable
+    m_stdout->close();
+    if (m_process->getChildPID() != -1) {
+        m_process->kill(SIGTERM);
+        m_process->wait();
+    }
+    if (m_errorThread.joinable())
+        m_errorThread.join();
+    m_process.reset();
+}
+
 // -----------------------------------------------------------------------------
 void ProcessDataProvider::finish()
 {
     Debug::debug()->trace("ProcessDataProvider::finish");
 
-    int err = pclose(m_processFile);
-    m_processFile = NULL;
+    if (!m_process)
+        return;
 
-    if (WEXITSTATUS(err) != 0)
-        throw KError(m_pipeCmdline + " failed (" +
-            StringUtil::number2string(WEXITSTATUS(err)) +").");
+    // an error of the reader: the output is not needed any more
+    if (getError()) {
+        kill();
+        printErrors();
+        return;
+    }
+
+    m_stdout->close();
+    int status = m_process->wait();
+    m_errorThread.join();
+    m_process.reset();
+    printErrors();
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        throw KError(m_pipeArgs.front() + " failed (" + exitStatus(status) +
+                     ").");
 }
 
 // -----------------------------------------------------------------------------
 bool ProcessDataProvider::canSaveToFile() const
 {
-    return true;
+    return !m_directArgs.empty();
 }
 
 // -----------------------------------------------------------------------------
@@ -258,22 +779,470 @@ void ProcessDataProvider::saveToFile(const StringVector &targets)
     Debug::debug()->trace("ProcessDataProvider::saveToFile([ \"%s\"%s ])",
 	targets.front().c_str(), targets.size() > 1 ? ", ...": "");
 
-    string cmdline = m_directCmdline;
-    StringVector::const_iterator it;
-    for (it = targets.begin(); it != targets.end(); ++it) {
-	cmdline += ' ';
-	cmdline += *it;
+    if (m_directArgs.empty())
+        throw KError("No command to save " + targets.front() + " directly.");
+
+    StringVector args(m_directArgs.begin() + 1, m_directArgs.end());
+    args.insert(args.end(), targets.begin(), targets.end());
+
+    // output goes to the terminal, because nothing else is printed
+    SubProcess p;
+    p.spawn(m_directArgs.front(), args);
+    int status = p.wait();
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        throw KError("Running " + m_directArgs.front() + " failed (" +
+                     exitStatus(status) + ").");
+}
+
+//}}}
+//{{{ ChecksumDataProvider -----------------------------------------------------
+
+// -----------------------------------------------------------------------------
+ChecksumDataProvider::ChecksumDataProvider(DataProvider *forward,
+                                           size_t chunkSize)
+    : m_forward(forward), m_chunkSize(chunkSize), m_prepared(false),
+      m_direct(false), m_size(0)
+{}
+
+// -----------------------------------------------------------------------------
+void ChecksumDataProvider::prepare()
+{
+    Debug::debug()->trace("ChecksumDataProvider::prepare");
+
+    m_crc.reset();
+    m_chunks.clear();
+    m_size = 0;
+    m_forward->prepare();
+    m_prepared = true;
+}
+
+// -----------------------------------------------------------------------------
+bool ChecksumDataProvider::canSaveToFile() const
+{
+    return m_forward->canSaveToFile();
+}
+
+// -----------------------------------------------------------------------------
+void ChecksumDataProvider::saveToFile(const StringVector &targets)
+{
+    m_direct = true;
+    m_forward->saveToFile(targets);
+}
+
+// -----------------------------------------------------------------------------
+size_t ChecksumDataProvider::getData(char *buffer, size_t maxread)
+{
+    size_t ret = m_forward->getData(buffer, maxread);
+    update(buffer, ret);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+bool ChecksumDataProvider::canMapData() const
+{
+    return m_forward->canMapData();
+}
+
+// -----------------------------------------------------------------------------
+size_t ChecksumDataProvider::mapData(const char **data, size_t maxread)
+{
+    size_t ret = m_forward->mapData(data, maxread);
+    update(*data, ret);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+bool ChecksumDataProvider::canPlaceData() const
+{
+    return m_forward->canPlaceData();
+}
+
+// -----------------------------------------------------------------------------
+size_t ChecksumDataProvider::getPlacedData(char *buffer, size_t maxread,
+                                           off_t *offset)
+{
+    // the pieces may come in any order
+    m_direct = true;
+    return m_forward->getPlacedData(buffer, maxread, offset);
+}
+
+// -----------------------------------------------------------------------------
+size_t ChecksumDataProvider::getChunk(DataChunk &chunk, size_t maxread)
+{
+    size_t ret = m_forward->getChunk(chunk, maxread);
+    if (m_forward->canPlaceData())
+        m_direct = true;
+    else
+        update(chunk.data(), ret);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void ChecksumDataProvider::update(const char *data, size_t len)
+{
+    m_crc.update(data, len);
+    if (m_chunkSize) {
+        const char *p = data;
+        while (len) {
+            size_t used = m_size % m_chunkSize;
+            if (used == 0)
+                m_chunks.push_back(Crc32c());
+            size_t n = min(len, m_chunkSize - used);
+            m_chunks.back().update(p, n);
+            p += n;
+            len -= n;
+            m_size += n;
+        }
+    } else
+        m_size += len;
+}
+
+// -----------------------------------------------------------------------------
+bool ChecksumDataProvider::canSplice() const
+{
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+size_t ChecksumDataProvider::spliceData(int fd)
+{
+    throw KError("ChecksumDataProvider cannot splice data.");
+}
+
+// -----------------------------------------------------------------------------
+void ChecksumDataProvider::finish()
+{
+    m_forward->finish();
+}
+
+// -----------------------------------------------------------------------------
+void ChecksumDataProvider::setError(bool error)
+{
+    m_forward->setError(error);
+}
+
+// -----------------------------------------------------------------------------
+void ChecksumDataProvider::setProgress(Progress *progress)
+{
+    m_forward->setProgress(progress);
+}
+
+// -----------------------------------------------------------------------------
+bool ChecksumDataProvider::canRestart() const
+{
+    return m_forward->canRestart();
+}
+
+//}}}
+
+
+//{{{ CountingDataProvider -----------------------------------------------------
+
+// -----------------------------------------------------------------------------
+void CountingDataProvider::prepare()
+{
+    m_bytes = 0;
+    m_forward->prepare();
+}
+
+// -----------------------------------------------------------------------------
+bool CountingDataProvider::canSaveToFile() const
+{
+    return m_forward->canSaveToFile();
+}
+
+// -----------------------------------------------------------------------------
+void CountingDataProvider::saveToFile(const StringVector &targets)
+{
+    m_forward->saveToFile(targets);
+
+    unsigned long long total = 0;
+    for (StringVector::const_iterator it = targets.begin();
+         it != targets.end(); ++it) {
+        struct stat st;
+        if (stat(it->c_str(), &st) == 0)
+            total += st.st_size;
     }
+    m_bytes = total;
+}
+
+// -----------------------------------------------------------------------------
+size_t CountingDataProvider::getData(char *buffer, size_t maxread)
+{
+    size_t ret = m_forward->getData(buffer, maxread);
+    m_bytes.fetch_add(ret, std::memory_order_relaxed);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+bool CountingDataProvider::canSplice() const
+{
+    return m_forward->canSplice();
+}
+
+// -----------------------------------------------------------------------------
+size_t CountingDataProvider::spliceData(int fd)
+{
+    size_t ret = m_forward->spliceData(fd);
+    m_bytes.fetch_add(ret, std::memory_order_relaxed);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+bool CountingDataProvider::canMapData() const
+{
+    return m_forward->canMapData();
+}
 
-    Debug::debug()->trace("Executing '%s'", cmdline.c_str());
+// -----------------------------------------------------------------------------
+size_t CountingDataProvider::mapData(const char **data, size_t maxread)
+{
+    size_t ret = m_forward->mapData(data, maxread);
+    m_bytes.fetch_add(ret, std::memory_order_relaxed);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+bool CountingDataProvider::canPlaceData() const
+{
+    return m_forward->canPlaceData();
+}
 
-    int err = system(cmdline.c_str());
-    if (WEXITSTATUS(err) != 0)
-        throw KError("Running " + m_directCmdline + " failed (" +
-            StringUtil::number2string(WEXITSTATUS(err)) +").");
+// -----------------------------------------------------------------------------
+size_t CountingDataProvider::getPlacedData(char *buffer, size_t maxread,
+                                           off_t *offset)
+{
+    size_t ret = m_forward->getPlacedData(buffer, maxread, offset);
+    m_bytes.fetch_add(ret, std::memory_order_relaxed);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+size_t CountingDataProvider::getChunk(DataChunk &chunk, size_t maxread)
+{
+    size_t ret = m_forward->getChunk(chunk, maxread);
+    m_bytes.fetch_add(ret, std::memory_order_relaxed);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void CountingDataProvider::finish()
+{
+    m_forward->finish();
+}
+
+// -----------------------------------------------------------------------------
+void CountingDataProvider::setError(bool error)
+{
+    m_forward->setError(error);
+}
+
+// -----------------------------------------------------------------------------
+void CountingDataProvider::setProgress(Progress *progress)
+{
+    m_forward->setProgress(progress);
+}
+
+// -----------------------------------------------------------------------------
+bool CountingDataProvider::canRestart() const
+{
+    return m_forward->canRestart();
+}
+
+//}}}
+//{{{ ThrottledDataProvider ----------------------------------------------------
+
+// -----------------------------------------------------------------------------
+void ThrottledDataProvider::prepare()
+{
+    m_bytes = 0;
+    m_start = std::chrono::steady_clock::now();
+    m_forward->prepare();
+}
+
+// -----------------------------------------------------------------------------
+bool ThrottledDataProvider::canSaveToFile() const
+{
+    return m_rate == 0 && m_forward->canSaveToFile();
+}
+
+// -----------------------------------------------------------------------------
+void ThrottledDataProvider::saveToFile(const StringVector &targets)
+{
+    m_forward->saveToFile(targets);
+}
+
+// -----------------------------------------------------------------------------
+size_t ThrottledDataProvider::getData(char *buffer, size_t maxread)
+{
+    return throttle(m_forward->getData(buffer, limit(maxread)));
+}
+
+// -----------------------------------------------------------------------------
+bool ThrottledDataProvider::canSplice() const
+{
+    return m_forward->canSplice();
+}
+
+// -----------------------------------------------------------------------------
+size_t ThrottledDataProvider::spliceData(int fd)
+{
+    return throttle(m_forward->spliceData(fd));
+}
+
+// -----------------------------------------------------------------------------
+bool ThrottledDataProvider::canMapData() const
+{
+    return m_forward->canMapData();
+}
+
+// -----------------------------------------------------------------------------
+size_t ThrottledDataProvider::mapData(const char **data, size_t maxread)
+{
+    return throttle(m_forward->mapData(data, limit(maxread)));
+}
+
+// -----------------------------------------------------------------------------
+bool ThrottledDataProvider::canPlaceData() const
+{
+    return m_forward->canPlaceData();
+}
+
+// -----------------------------------------------------------------------------
+size_t ThrottledDataProvider::getPlacedData(char *buffer, size_t maxread,
+                                            off_t *offset)
+{
+    return throttle(m_forward->getPlacedData(buffer, limit(maxread), offset));
+}
+
+// -----------------------------------------------------------------------------
+size_t ThrottledDataProvider::getChunk(DataChunk &chunk, size_t maxread)
+{
+    return throttle(m_forward->getChunk(chunk, limit(maxread)));
+}
+
+// -----------------------------------------------------------------------------
+size_t ThrottledDataProvider::limit(size_t maxread) const
+{
+    if (m_rate == 0)
+        return maxread;
+    size_t slice = std::max<unsigned long long>(m_rate / 10, 4096);
+    return std::min(maxread, slice);
+}
+
+// -----------------------------------------------------------------------------
+size_t ThrottledDataProvider::throttle(size_t bytes)
+{
+    if (m_rate == 0)
+        return bytes;
+
+    m_bytes += bytes;
+    std::chrono::steady_clock::time_point due = m_start +
+        std::chrono::microseconds(m_bytes * 1000000 / m_rate);
+    std::chrono::steady_clock::time_point now =
+        std::chrono::steady_clock::now();
+    if (due > now)
+        std::this_thread::sleep_for(due - now);
+    return bytes;
+}
+
+// -----------------------------------------------------------------------------
+void ThrottledDataProvider::finish()
+{
+    m_forward->finish();
+}
+
+// -----------------------------------------------------------------------------
+void ThrottledDataProvider::setError(bool error)
+{
+    m_forward->setError(error);
+}
+
+// -----------------------------------------------------------------------------
+void ThrottledDataProvider::setProgress(Progress *progress)
+{
+    m_forward->setProgress(progress);
+}
+
+// -----------------------------------------------------------------------------
+bool ThrottledDataProvider::canRestart() const
+{
+    return m_forward->canRestart();
 }
 
 //}}}
 
+//{{{ RewindDataProvider -------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+void RewindDataProvider::prepare()
+{
+    m_pos = m_end = 0;
+    m_forward->prepare();
+}
+
+// -----------------------------------------------------------------------------
+size_t RewindDataProvider::getData(char *buffer, size_t maxread)
+{
+    size_t size = m_ring.size();
+
+    // data that is sent again comes from the ring
+    if (m_pos < m_end) {
+        size_t start = m_pos % size;
+        size_t len = min<unsigned long long>(maxread, m_end - m_pos);
+        len = min(len, size - start);
+        memcpy(buffer, m_ring.data() + start, len);
+        m_pos += len;
+        return len;
+    }
+
+    size_t len = m_forward->getData(buffer, maxread);
+    const char *data = buffer;
+    size_t left = len;
+    if (left > size) {
+        data += left - size;
+        left = size;
+    }
+    size_t start = (m_end + len - left) % size;
+    while (left) {
+        size_t chunk = min(left, size - start);
+        memcpy(m_ring.data() + start, data, chunk);
+        data += chunk;
+        left -= chunk;
+        start = 0;
+    }
+    m_pos = m_end += len;
+    return len;
+}
+
+// -----------------------------------------------------------------------------
+bool RewindDataProvider::rewind(unsigned long long pos)
+{
+    if (pos > m_end || m_end - pos > m_ring.size())
+        return false;
+    Debug::debug()->dbg("Rewinding from %llu to %llu", m_pos, pos);
+    m_pos = pos;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+void RewindDataProvider::finish()
+{
+    m_forward->finish();
+}
+
+// -----------------------------------------------------------------------------
+void RewindDataProvider::setError(bool error)
+{
+    m_forward->setError(error);
+}
+
+// -----------------------------------------------------------------------------
+void RewindDataProvider::setProgress(Progress *progress)
+{
+    m_forward->setProgress(progress);
+}
+
+//}}}
 
 // vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
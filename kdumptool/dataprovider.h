@@ -21,12 +21,21 @@
 
 #include <cstdio>
 #include <cstdarg>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
 
 #include "global.h"
 #include "rootdirurl.h"
 #include "stringvector.h"
+#include "checksum.h"
+#include "datachunk.h"
 
 class Progress;
+class SubProcess;
+class ChildToParentPipe;
 
 //{{{ DataProvider -------------------------------------------------------------
 
@@ -86,6 +95,99 @@ class DataProvider {
          */
         virtual size_t getData(char *buffer, size_t maxread) = 0;
 
+        /**
+         * Checks whether the data can be moved directly to a file
+         * descriptor with DataProvider::spliceData(), without copying
+         * it through a user-space buffer.
+         *
+         * @return @c true if DataProvider::spliceData() can be used
+         */
+        virtual bool canSplice() const = 0;
+
+        /**
+         * Alternative to DataProvider::getData() which moves the data
+         * directly to a file descriptor. Both methods must not be mixed
+         * between DataProvider::prepare() and DataProvider::finish().
+         *
+         * @param[in] fd the target file descriptor
+         * @return the number of bytes moved, 0 at the end of data
+         *
+         * @exception KError when something goes wrong or if
+         *            DataProvider::canSplice() returns @c false
+         */
+        virtual size_t spliceData(int fd) = 0;
+
+        /**
+         * Checks whether DataProvider::mapData() can be used. The result
+         * is only valid after DataProvider::prepare().
+         *
+         * @return @c true if DataProvider::mapData() can be used
+         */
+        virtual bool canMapData() const = 0;
+
+        /**
+         * Alternative to DataProvider::getData() which returns a pointer
+         * to the next data instead of copying it to a buffer. The data is
+         * valid until the next call. Both methods must not be mixed
+         * between DataProvider::prepare() and DataProvider::finish().
+         *
+         * @param[out] data set to the start of the data
+         * @param[in] maxread the maximum number of bytes
+         * @return the number of bytes at @p data, 0 at the end of data
+         *
+         * @exception KError when something goes wrong or if
+         *            DataProvider::canMapData() returns @c false
+         */
+        virtual size_t mapData(const char **data, size_t maxread) = 0;
+
+        /**
+         * Checks whether DataProvider::getPlacedData() can be used. Unlike
+         * DataProvider::canMapData(), the result does not depend on
+         * DataProvider::prepare().
+         *
+         * @return @c true if DataProvider::getPlacedData() can be used
+         */
+        virtual bool canPlaceData() const = 0;
+
+        /**
+         * Alternative to DataProvider::getData() for data that is not
+         * written sequentially: it returns the next piece of the data
+         * together with its offset in the target file. The target is
+         * complete when all pieces have been written at their offsets.
+         * If DataProvider::getData() is used instead, it returns the
+         * stream that contains the offsets. Both methods must not be
+         * mixed between DataProvider::prepare() and DataProvider::finish().
+         *
+         * @param[in] buffer the buffer where the data should be written to
+         * @param[in] maxread the size of the buffer
+         * @param[out] offset the offset of the data in the target file
+         * @return the number of bytes in @p buffer, 0 at the end of data
+         *
+         * @exception KError when something goes wrong or if
+         *            DataProvider::canPlaceData() returns @c false
+         */
+        virtual size_t getPlacedData(char *buffer, size_t maxread,
+                                     off_t *offset) = 0;
+
+        /**
+         * Alternative to DataProvider::getData() which returns the data
+         * in a DataChunk that owns its memory, together with its offset
+         * in the target file. The chunk stays valid after the next call,
+         * so the caller may consume it asynchronously; the memory goes
+         * back to the BufferPool (or to the DataProvider) when the chunk
+         * is reset. Chunks may arrive out of order if
+         * DataProvider::canPlaceData() returns @c true. This method must
+         * not be mixed with the other ones between DataProvider::prepare()
+         * and DataProvider::finish().
+         *
+         * @param[out] chunk the next chunk, empty at the end of data
+         * @param[in] maxread the maximum number of bytes
+         * @return the number of bytes in @p chunk, 0 at the end of data
+         *
+         * @exception KError when something goes wrong
+         */
+        virtual size_t getChunk(DataChunk &chunk, size_t maxread) = 0;
+
         /**
          * This method gets called after the last DataProvider::getData()
          * call. This can be used to do some cleanup, like closing the file
@@ -109,6 +211,13 @@ class DataProvider {
          * @param[in] progress the progress notifier.
          */
         virtual void setProgress(Progress *progress) = 0;
+        /**
+         * Checks whether the same data can be provided once more from
+         * the start, i.e. whether prepare() may be called again after
+         * finish(), for example to save the data to another target
+         * after a failed transfer.
+         */
+        virtual bool canRestart() const = 0;
 };
 
 //}}}
@@ -171,6 +280,66 @@ class AbstractDataProvider : public DataProvider {
          */
         void saveToFile(const StringVector &targets);
 
+        /**
+         * Returns @c false as default implementation.
+         *
+         * @return @c false
+         * @see DataProvider::canSplice()
+         */
+        bool canSplice() const;
+
+        /**
+         * Throws a KError.
+         *
+         * @param[in] fd the target file descriptor (does not matter)
+         * @exception KError always because DataProvider::canSplice()
+         *            returns @c false in AbstractDataProvider.
+         * @see DataProvider::spliceData().
+         */
+        size_t spliceData(int fd);
+
+        /**
+         * Returns @c false as default implementation.
+         *
+         * @return @c false
+         * @see DataProvider::canMapData()
+         */
+        bool canMapData() const;
+
+        /**
+         * Throws a KError.
+         *
+         * @exception KError always because DataProvider::canMapData()
+         *            returns @c false in AbstractDataProvider.
+         * @see DataProvider::mapData().
+         */
+        size_t mapData(const char **data, size_t maxread);
+
+        /**
+         * Returns @c false as default implementation.
+         *
+         * @return @c false
+         * @see DataProvider::canPlaceData()
+         */
+        bool canPlaceData() const;
+
+        /**
+         * Throws a KError.
+         *
+         * @exception KError always because DataProvider::canPlaceData()
+         *            returns @c false in AbstractDataProvider.
+         * @see DataProvider::getPlacedData().
+         */
+        size_t getPlacedData(char *buffer, size_t maxread, off_t *offset);
+
+        /**
+         * Reads the data into buffers from the pool with getPlacedData()
+         * or getData() (see ChunkAdapter).
+         *
+         * @see DataProvider::getChunk()
+         */
+        size_t getChunk(DataChunk &chunk, size_t maxread);
+
         /**
          * Sets the error flag
          *
@@ -185,9 +354,18 @@ class AbstractDataProvider : public DataProvider {
          */
         bool getError() const;
 
+        /**
+         * Returns @c false as default implementation.
+         *
+         * @return @c false
+         * @see DataProvider::canRestart()
+         */
+        bool canRestart() const;
+
     private:
         Progress *m_progress;
         bool m_error;
+        ChunkAdapter m_chunks;
 };
 
 //}}}
@@ -195,6 +373,13 @@ class AbstractDataProvider : public DataProvider {
 
 /**
  * DataProvider that gets the data from file.
+ *
+ * The file is mapped into memory in windows of FILE_MAP_WINDOW bytes,
+ * so that the data can be passed on without copying. If the file cannot
+ * be mapped (e.g. /proc/vmcore on old kernels), it is read with pread().
+ *
+ * A regular file can also be copied to a local file by the kernel (see
+ * saveToFile()), without passing the data through kdumptool.
  */
 class FileDataProvider : public AbstractDataProvider {
 
@@ -207,6 +392,11 @@ class FileDataProvider : public AbstractDataProvider {
          */
         FileDataProvider(const char *filename);
 
+        /**
+         * Closes the file if it is still open.
+         */
+        ~FileDataProvider();
+
         /**
          * Actually opens the file.
          *
@@ -214,6 +404,28 @@ class FileDataProvider : public AbstractDataProvider {
          */
         void prepare();
 
+        /**
+         * Returns @c true for a regular file outside of /proc. Files
+         * in /proc (like /proc/vmcore) have no holes to preserve and
+         * cannot be copied by the kernel, and piping them through
+         * kdumptool makes sparse files from their zero pages.
+         *
+         * @see DataProvider::canSaveToFile()
+         */
+        bool canSaveToFile() const;
+
+        /**
+         * Copies the file to the first of @p targets. The copy is a
+         * reflink (FICLONE) if the file system can share the extents.
+         * Otherwise only the data between the holes (SEEK_DATA and
+         * SEEK_HOLE) is copied with copy_file_range(), or with
+         * sendfile() or read()/write() where that is not available, so
+         * the holes are preserved.
+         *
+         * @see DataProvider::saveToFile()
+         */
+        void saveToFile(const StringVector &targets);
+
         /**
          * Provides the data.
          *
@@ -221,6 +433,28 @@ class FileDataProvider : public AbstractDataProvider {
          */
         size_t getData(char *buffer, size_t maxread);
 
+        /**
+         * Returns @c true if the file could be mapped.
+         *
+         * @see DataProvider::canMapData()
+         */
+        bool canMapData() const;
+
+        /**
+         * Returns a pointer into the mapped window.
+         *
+         * @see DataProvider::mapData()
+         */
+        size_t mapData(const char **data, size_t maxread);
+
+        /**
+         * Returns chunks that refer to the mapped window, which is only
+         * unmapped when the last of them is released.
+         *
+         * @see DataProvider::getChunk()
+         */
+        size_t getChunk(DataChunk &chunk, size_t maxread);
+
         /**
          * Closes the file.
          *
@@ -228,11 +462,28 @@ class FileDataProvider : public AbstractDataProvider {
          */
         virtual void finish();
 
+        /**
+         * Returns @c true, because prepare() opens the file again.
+         *
+         * @see DataProvider::canRestart()
+         */
+        bool canRestart() const
+        { return true; }
+
     private:
+        bool mapWindow();
+        void unmapWindow();
+        void copyData(int in, int out);
+
         std::string m_filename;
-        FILE *m_file;
+        int m_fd;
         loff_t m_fileSize;
         loff_t m_currentPos;
+        bool m_mappable;
+        char *m_window;
+        std::shared_ptr<const char> m_windowRef;
+        loff_t m_windowPos;
+        size_t m_windowSize;
 };
 
 //}}}
@@ -271,24 +522,36 @@ class BufferDataProvider : public AbstractDataProvider {
  * ProcessDataProvider is a DataProvider that gets the data from stdout from
  * a process. It does not make sense to set a Progress notifier for that type
  * of DataProvider because we don't know when the data stream ends.
+ *
+ * The process is executed directly (without a shell), and its output is
+ * read from the pipe without any stdio buffering. Messages on stderr are
+ * collected and printed when the process has finished.
  */
 class ProcessDataProvider : public AbstractDataProvider {
 
     public:
 
         /**
-         * Creates a new BufferDataProvider object.
+         * Creates a new ProcessDataProvider object.
          *
-         * @param[in] data the buffer
-         * @param[in] add_cmdline additional parameters when the
-         *            ProcessDataProvider::saveToFile() shortcut is used
+         * @param[in] pipe_args the program and its arguments to produce
+         *            the data on stdout
+         * @param[in] direct_args the program and its arguments when the
+         *            ProcessDataProvider::saveToFile() shortcut is used;
+         *            the target files are appended
          */
-        ProcessDataProvider(const char *cmdline, const char *add_cmdline="");
+        ProcessDataProvider(const StringVector &pipe_args,
+                            const StringVector &direct_args = StringVector());
 
         /**
-         * Returns @c true.
+         * Kills the process if it is still running.
+         */
+        ~ProcessDataProvider();
+
+        /**
+         * Returns @c true if there are @c direct_args.
          *
-         * @return @c true
+         * @return @c true if the process can save the data itself
          */
         bool canSaveToFile() const;
 
@@ -315,6 +578,20 @@ class ProcessDataProvider : public AbstractDataProvider {
          */
         size_t getData(char *buffer, size_t maxread);
 
+        /**
+         * Returns @c true.
+         *
+         * @return @c true
+         */
+        bool canSplice() const;
+
+        /**
+         * Moves the process output with splice().
+         *
+         * @see DataProvider::spliceData()
+         */
+        size_t spliceData(int fd);
+
         /**
          * Terminates the process.
          *
@@ -322,10 +599,286 @@ class ProcessDataProvider : public AbstractDataProvider {
          */
         virtual void finish();
 
+        /**
+         * Returns the progress that makedumpfile has printed for the
+         * "Copying data" step on stderr.
+         *
+         * @return the progress in per mille, -1 if it is not known
+         */
+        int progressPermille() const
+        { return m_permille.load(std::memory_order_relaxed); }
+
+        /**
+         * Finds the last "Copying data" progress of makedumpfile.
+         *
+         * @param[in] text the messages of makedumpfile
+         * @param[in] from where to start looking in @p text
+         * @return the progress in per mille, -1 if @p text has none
+         */
+        static int parsePermille(const std::string &text,
+                                 std::string::size_type from = 0);
+
+    private:
+        void readErrors(int fd);
+        void printErrors();
+        void kill();
+
+        StringVector m_pipeArgs;
+        StringVector m_directArgs;
+        std::unique_ptr<SubProcess> m_process;
+        std::shared_ptr<ChildToParentPipe> m_stdout;
+        std::shared_ptr<ChildToParentPipe> m_stderr;
+        size_t m_pipeSize;
+        std::thread m_errorThread;
+        std::string m_errors;
+        std::atomic<int> m_permille;
+};
+
+//}}}
+//{{{ ChecksumDataProvider -----------------------------------------------------
+
+/**
+ * Decorator that computes the CRC-32C checksum of the data while it is
+ * read from another DataProvider, optionally also for each chunk.
+ * If the data is saved with DataProvider::saveToFile() or placed with
+ * DataProvider::getPlacedData(), no checksum is available.
+ */
+class ChecksumDataProvider : public DataProvider {
+
+    public:
+
+        /**
+         * Wraps a DataProvider.
+         *
+         * @param[in] forward the DataProvider that provides the data
+         * @param[in] chunkSize size of the chunks that get their own
+         *            checksum, or 0 for the whole data only
+         */
+        ChecksumDataProvider(DataProvider *forward, size_t chunkSize = 0);
+
+        void prepare();
+        bool canSaveToFile() const;
+        void saveToFile(const StringVector &targets);
+        size_t getData(char *buffer, size_t maxread);
+
+        /**
+         * Returns @c false, because the data must pass through getData().
+         */
+        bool canSplice() const;
+        size_t spliceData(int fd);
+
+        bool canMapData() const;
+        size_t mapData(const char **data, size_t maxread);
+
+        /**
+         * Placed data does not give the checksum of the target file, so
+         * valid() returns @c false when it is used.
+         */
+        bool canPlaceData() const;
+        size_t getPlacedData(char *buffer, size_t maxread, off_t *offset);
+        size_t getChunk(DataChunk &chunk, size_t maxread);
+
+        void finish();
+        void setError(bool error);
+        void setProgress(Progress *progress);
+        bool canRestart() const;
+
+        /**
+         * Returns @c true if all data has been checksummed.
+         */
+        bool valid() const
+        { return m_prepared && !m_direct; }
+
+        /**
+         * Returns the checksum of the whole data.
+         */
+        const Crc32c &checksum() const
+        { return m_crc; }
+
+        /**
+         * Returns the number of bytes that have been read.
+         */
+        unsigned long long size() const
+        { return m_size; }
+
+        /**
+         * Returns the size of the chunks (0 if disabled).
+         */
+        size_t chunkSize() const
+        { return m_chunkSize; }
+
+        /**
+         * Returns the checksums of all chunks. The last chunk may be
+         * shorter than chunkSize().
+         */
+        const std::vector<Crc32c> &chunkChecksums() const
+        { return m_chunks; }
+
+    private:
+        void update(const char *data, size_t len);
+
+        DataProvider *m_forward;
+        size_t m_chunkSize;
+        bool m_prepared;
+        bool m_direct;
+        Crc32c m_crc;
+        unsigned long long m_size;
+        std::vector<Crc32c> m_chunks;
+};
+
+//}}}
+//{{{ CountingDataProvider -----------------------------------------------------
+
+/**
+ * DataProvider that forwards everything to another DataProvider and
+ * counts the bytes. Unlike ChecksumDataProvider it keeps all fast
+ * paths; data saved directly with saveToFile() is counted by the size
+ * of the target files when it is complete.
+ */
+class CountingDataProvider : public DataProvider {
+
+    public:
+
+        /**
+         * Wraps a DataProvider.
+         *
+         * @param[in] forward the DataProvider that provides the data
+         */
+        CountingDataProvider(DataProvider *forward)
+            : m_forward(forward), m_bytes(0)
+        {}
+
+        void prepare();
+        bool canSaveToFile() const;
+        void saveToFile(const StringVector &targets);
+        size_t getData(char *buffer, size_t maxread);
+        bool canSplice() const;
+        size_t spliceData(int fd);
+        bool canMapData() const;
+        size_t mapData(const char **data, size_t maxread);
+        bool canPlaceData() const;
+        size_t getPlacedData(char *buffer, size_t maxread, off_t *offset);
+        size_t getChunk(DataChunk &chunk, size_t maxread);
+        void finish();
+        void setError(bool error);
+        void setProgress(Progress *progress);
+        bool canRestart() const;
+
+        /**
+         * Returns the number of bytes that have been passed on.
+         */
+        unsigned long long bytes() const
+        { return m_bytes.load(std::memory_order_relaxed); }
+
+    private:
+        DataProvider *m_forward;
+        std::atomic<unsigned long long> m_bytes;
+};
+
+//}}}
+//{{{ ThrottledDataProvider ----------------------------------------------------
+
+/**
+ * DataProvider that forwards everything to another DataProvider, but
+ * not faster than a given rate. The data must pass through kdumptool
+ * for that, so saveToFile() is not available.
+ */
+class ThrottledDataProvider : public DataProvider {
+
+    public:
+
+        /**
+         * Wraps a DataProvider.
+         *
+         * @param[in] forward the DataProvider that provides the data
+         * @param[in] rate maximum bytes per second (0 for no limit)
+         */
+        ThrottledDataProvider(DataProvider *forward, unsigned long long rate)
+            : m_forward(forward), m_rate(rate), m_bytes(0)
+        {}
+
+        void prepare();
+        bool canSaveToFile() const;
+        void saveToFile(const StringVector &targets);
+        size_t getData(char *buffer, size_t maxread);
+        bool canSplice() const;
+        size_t spliceData(int fd);
+        bool canMapData() const;
+        size_t mapData(const char **data, size_t maxread);
+        bool canPlaceData() const;
+        size_t getPlacedData(char *buffer, size_t maxread, off_t *offset);
+        size_t getChunk(DataChunk &chunk, size_t maxread);
+        void finish();
+        void setError(bool error);
+        void setProgress(Progress *progress);
+        bool canRestart() const;
+
+    protected:
+        /**
+         * Limits a read to a tenth of a second worth of data, so that
+         * the pauses stay short.
+         */
+        size_t limit(size_t maxread) const;
+
+        /**
+         * Accounts @p bytes and sleeps until they are due.
+         */
+        size_t throttle(size_t bytes);
+
+    private:
+        DataProvider *m_forward;
+        unsigned long long m_rate;
+        unsigned long long m_bytes;
+        std::chrono::steady_clock::time_point m_start;
+};
+
+//}}}
+//{{{ RewindDataProvider -------------------------------------------------------
+
+/**
+ * DataProvider that keeps the last bytes read from another DataProvider,
+ * so that a transfer can go back and send them again after a network
+ * failure. Only getData() is available.
+ */
+class RewindDataProvider : public AbstractDataProvider {
+
+    public:
+
+        /**
+         * Wraps a DataProvider.
+         *
+         * @param[in] forward the DataProvider that provides the data
+         * @param[in] window how many bytes can be sent again
+         */
+        RewindDataProvider(DataProvider *forward, size_t window)
+            : m_forward(forward), m_ring(window), m_pos(0), m_end(0)
+        {}
+
+        void prepare();
+        size_t getData(char *buffer, size_t maxread);
+        void finish();
+        void setError(bool error);
+        void setProgress(Progress *progress);
+
+        /**
+         * Returns the offset of the next byte returned by getData().
+         */
+        unsigned long long position() const
+        { return m_pos; }
+
+        /**
+         * Continues at an earlier offset.
+         *
+         * @param[in] pos the new position
+         * @return @c false if @p pos is not within the window
+         */
+        bool rewind(unsigned long long pos);
+
     private:
-        std::string m_pipeCmdline;
-        std::string m_directCmdline;
-        FILE *m_processFile;
+        DataProvider *m_forward;
+        std::vector<char> m_ring;
+        unsigned long long m_pos;       // next byte returned
+        unsigned long long m_end;       // bytes read from m_forward
 };
 
 //}}}
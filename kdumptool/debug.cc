@@ -24,6 +24,7 @@
 #include <string>
 #include <sstream>
 #include <unistd.h>
+#include <time.h>
 
 #include "debug.h"
 
@@ -57,7 +58,7 @@ Debug *Debug::debug()
 // -----------------------------------------------------------------------------
 Debug::Debug()
     : m_stderrLevel(DL_INFO), m_handle(NULL), m_useColor(false),
-      m_useColorAuto(true)
+      m_useColorAuto(true), m_nextEvent(0)
 {
     cerr.sync_with_stdio(true);
 }
@@ -199,6 +200,43 @@ void Debug::vmsg(Debug::Level level, const char *msg, va_list list)
     }
 }
 
+// -----------------------------------------------------------------------------
+void Debug::event(const char *fmt, unsigned long long a, unsigned long long b)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    unsigned long idx = m_nextEvent.fetch_add(1, std::memory_order_relaxed);
+    Event &e = m_events[idx % DEBUG_EVENTS];
+    e.nsec = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    e.fmt = fmt;
+    e.a = a;
+    e.b = b;
+}
+
+// -----------------------------------------------------------------------------
+void Debug::dumpEvents(Debug::Level level)
+{
+    unsigned long count = m_nextEvent.exchange(0);
+    if (!count)
+        return;
+
+    unsigned long first = count > DEBUG_EVENTS ? count - DEBUG_EVENTS : 0;
+    msg(level, "Last %lu of %lu trace events:", count - first, count);
+
+    unsigned long long last = m_events[(count - 1) % DEBUG_EVENTS].nsec;
+    for (unsigned long i = first; i < count; ++i) {
+        const Event &e = m_events[i % DEBUG_EVENTS];
+        char text[256];
+        snprintf(text, sizeof text, e.fmt, e.a, e.b);
+
+        // times are relative to the last event
+        unsigned long long ago = last - e.nsec;
+        msg(level, "  -%llu.%06llu %s", ago / 1000000000ULL,
+            ago % 1000000000ULL / 1000, text);
+    }
+}
+
 // -----------------------------------------------------------------------------
 Debug::Level Debug::getStderrLevel() const
 {
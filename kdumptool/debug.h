@@ -21,7 +21,49 @@
 
 #include <cstdio>
 #include <cstdarg>
+#include <string>
+#include <atomic>
 
+//{{{ Compile-time levels ------------------------------------------------------
+
+/*
+ * Messages below KDUMP_LOG_LEVEL are compiled out of the whole program.
+ * KDUMP_MODULE_LOG_LEVEL overrides it for a single module; define it
+ * before the first #include or in the COMPILE_DEFINITIONS of the file.
+ */
+#ifndef KDUMP_LOG_LEVEL
+#   define KDUMP_LOG_LEVEL          0
+#endif
+#ifndef KDUMP_MODULE_LOG_LEVEL
+#   define KDUMP_MODULE_LOG_LEVEL   KDUMP_LOG_LEVEL
+#endif
+
+/*
+ * Logging macros. Unlike calling Debug::trace() and friends directly, the
+ * arguments are not evaluated unless the message is actually printed.
+ */
+#define KDUMP_LOG(level, fn, ...)                                       \
+    do {                                                                \
+        if ((level) >= KDUMP_MODULE_LOG_LEVEL &&                        \
+            Debug::debug()->enabled(level))                             \
+            Debug::debug()->fn(__VA_ARGS__);                            \
+    } while (0)
+
+#define KTRACE(...)     KDUMP_LOG(Debug::DL_TRACE, trace, __VA_ARGS__)
+#define KDBG(...)       KDUMP_LOG(Debug::DL_DEBUG, dbg, __VA_ARGS__)
+#define KINFO(...)      KDUMP_LOG(Debug::DL_INFO, info, __VA_ARGS__)
+
+/*
+ * Records a trace event in the ring buffer (see Debug::event()). The
+ * format must be a string literal.
+ */
+#define KEVENT(fmt, a, b)                                               \
+    do {                                                                \
+        if (Debug::DL_TRACE >= KDUMP_MODULE_LOG_LEVEL)                  \
+            Debug::debug()->event("" fmt, (a), (b));                    \
+    } while (0)
+
+//}}}
 //{{{ Debugging ----------------------------------------------------------------
 
 class Debug {
@@ -50,6 +92,32 @@ class Debug {
 
         bool isDebugEnabled() const;
 
+        /**
+         * Returns @c true if a message of the given level goes anywhere.
+         */
+        bool enabled(Debug::Level level) const
+        { return level >= m_stderrLevel || m_handle; }
+
+        /**
+         * Records a trace event in a ring buffer, which keeps the last
+         * DEBUG_EVENTS events. Nothing is formatted until the events are
+         * printed with dumpEvents(), so this is cheap enough to be called
+         * for every block of a dump.
+         *
+         * @param[in] fmt a printf format with up to two %llu conversions;
+         *                only the pointer is stored, so it must be static
+         * @param[in] a first argument
+         * @param[in] b second argument
+         */
+        void event(const char *fmt, unsigned long long a,
+                   unsigned long long b);
+
+        /**
+         * Prints the events recorded with event() at the given level and
+         * empties the ring buffer. Use this after an error.
+         */
+        void dumpEvents(Debug::Level level = DL_INFO);
+
         void setFileHandle(FILE *handle);
         FILE *getFileHandle() const;
 
@@ -62,11 +130,22 @@ class Debug {
     private:
         static Debug *m_instance;
 
+        static const unsigned DEBUG_EVENTS = 256;
+
+        struct Event {
+            unsigned long long nsec;
+            const char *fmt;
+            unsigned long long a, b;
+        };
+
     private:
         Level m_stderrLevel;
         FILE *m_handle;
         bool m_useColor;
         bool m_useColorAuto;
+
+        Event m_events[DEBUG_EVENTS];
+        std::atomic<unsigned long> m_nextEvent;
 };
 
 //}}}
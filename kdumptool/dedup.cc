@@ -0,0 +1,780 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "global.h"
+#include "debug.h"
+#include "dedup.h"
+#include "checksum.h"
+#include "fileutil.h"
+#include "stringutil.h"
+#include "writeback.h"
+#include "util.h"
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::ifstream;
+using std::ostringstream;
+using std::min;
+
+// empty slot of the chunk index
+#define DEDUP_EMPTY             UINT32_MAX
+
+// size of an entry in an index file
+#define DEDUP_INDEX_ENTRY       16
+
+// how much data DedupDataProvider and Reconstruct handle at a time
+#define DEDUP_BUFFER_SIZE       (1024 * 1024)
+
+// -----------------------------------------------------------------------------
+static void putBE(unsigned char *buf, unsigned long long val, int bytes)
+{
+    for (int i = bytes - 1; i >= 0; --i) {
+        buf[i] = val & 0xff;
+        val >>= 8;
+    }
+}
+
+// -----------------------------------------------------------------------------
+static unsigned long long getBE(const unsigned char *buf, int bytes)
+{
+    unsigned long long val = 0;
+    for (int i = 0; i < bytes; ++i)
+        val = (val << 8) | buf[i];
+    return val;
+}
+
+// -----------------------------------------------------------------------------
+static void writeFully(int fd, const char *data, size_t len, off_t offset,
+                       const string &name)
+{
+    while (len) {
+        ssize_t ret = pwrite(fd, data, len, offset);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            throw KSystemError("Cannot write " + name, errno);
+        }
+        data += ret;
+        len -= ret;
+        offset += ret;
+    }
+}
+
+// -----------------------------------------------------------------------------
+static size_t readFully(int fd, char *data, size_t len, off_t offset,
+                        const string &name)
+{
+    size_t done = 0;
+    while (done < len) {
+        ssize_t ret = pread(fd, data + done, len - done, offset + done);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            throw KSystemError("Cannot read " + name, errno);
+        }
+        if (ret == 0)
+            break;
+        done += ret;
+    }
+    return done;
+}
+
+//{{{ DedupRecord --------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+void DedupRecord::encode(unsigned char *buf) const
+{
+    putBE(buf, offset, 8);
+    putBE(buf + 8, length, 4);
+    putBE(buf + 12, type, 4);
+}
+
+// -----------------------------------------------------------------------------
+void DedupRecord::decode(const unsigned char *buf)
+{
+    offset = getBE(buf, 8);
+    length = getBE(buf + 8, 4);
+    type = getBE(buf + 12, 4);
+}
+
+//}}}
+//{{{ ChunkStore ---------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+ChunkStore::ChunkStore(const string &dir, const string &name, size_t memory)
+    : m_dir(dir), m_own(0), m_ownFd(-1), m_indexFd(-1), m_end(0),
+      m_table(4096), m_used(0), m_memory(memory),
+      m_buffer(DEDUP_CHUNK_SIZE), m_found(0), m_added(0)
+{
+    Debug::debug()->trace("ChunkStore::ChunkStore(%s, %s, %zu)",
+                          dir.c_str(), name.c_str(), memory);
+
+    Entry empty = { 0, DEDUP_EMPTY, 0 };
+    std::fill(m_table.begin(), m_table.end(), empty);
+
+    FilePath(dir).mkdir(true);
+
+    // newest packs first, so that a full index keeps the recent chunks
+    std::vector<std::pair<time_t, string> > indexes;
+    DIR *d = opendir(dir.c_str());
+    if (!d)
+        throw KSystemError("Cannot open " + dir, errno);
+    struct dirent *de;
+    while ((de = readdir(d))) {
+        KString file(de->d_name);
+        if (!file.endsWith(".index"))
+            continue;
+        struct stat st;
+        if (stat((dir + "/" + file).c_str(), &st) != 0)
+            continue;
+        indexes.push_back(std::make_pair(st.st_mtime,
+            file.substr(0, file.size() - 6)));
+    }
+    closedir(d);
+    std::sort(indexes.rbegin(), indexes.rend());
+
+    for (size_t i = 0; i < indexes.size(); ++i)
+        m_packs.push_back(indexes[i].second);
+    StringVector::iterator it =
+        std::find(m_packs.begin(), m_packs.end(), name);
+    if (it == m_packs.end())
+        it = m_packs.insert(m_packs.end(), name);
+    m_own = it - m_packs.begin();
+    m_fds.assign(m_packs.size(), -1);
+
+    for (unsigned long i = 0; i < m_packs.size(); ++i)
+        load(m_packs[i]);
+    Debug::debug()->dbg("%zu chunks in %zu packs, index of %zu entries",
+                        m_used, m_packs.size(), m_table.size());
+}
+
+// -----------------------------------------------------------------------------
+ChunkStore::~ChunkStore()
+{
+    for (size_t i = 0; i < m_fds.size(); ++i)
+        if (m_fds[i] >= 0)
+            close(m_fds[i]);
+    if (m_ownFd >= 0)
+        close(m_ownFd);
+    if (m_indexFd >= 0)
+        close(m_indexFd);
+}
+
+// -----------------------------------------------------------------------------
+string ChunkStore::location(const string &dumpdir, const string &release)
+{
+    string name(release);
+    std::replace(name.begin(), name.end(), '/', '_');
+    FilePath fp(FilePath(dumpdir).dirName());
+    fp.appendPath(DEDUP_STORE).appendPath(name);
+    return fp;
+}
+
+// -----------------------------------------------------------------------------
+void ChunkStore::load(const string &name)
+{
+    unsigned long pack = std::find(m_packs.begin(), m_packs.end(), name) -
+        m_packs.begin();
+
+    // entries beyond the end of the pack are from a broken file system
+    struct stat st;
+    if (stat((m_dir + "/" + name + ".chunks").c_str(), &st) != 0)
+        return;
+    unsigned long long size = st.st_size;
+
+    ifstream fin((m_dir + "/" + name + ".index").c_str(), std::ios::binary);
+    unsigned char entry[DEDUP_INDEX_ENTRY];
+    while (fin.read(reinterpret_cast<char *>(entry), sizeof entry)) {
+        unsigned long long offset = getBE(entry + 8, 8);
+        if (offset % DEDUP_CHUNK_SIZE || offset + DEDUP_CHUNK_SIZE > size)
+            continue;
+        if (!insert(getBE(entry, 4), pack, offset)) {
+            Debug::debug()->dbg("Chunk index is full");
+            return;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+bool ChunkStore::insert(uint32_t crc, unsigned long pack,
+                        unsigned long long offset)
+{
+    // keep the table at most half full
+    if ((m_used + 1) * 2 > m_table.size()) {
+        if (m_table.size() * 2 * sizeof(Entry) > m_memory)
+            return false;
+
+        std::vector<Entry> old(m_table.size() * 2);
+        old.swap(m_table);
+        Entry empty = { 0, DEDUP_EMPTY, 0 };
+        std::fill(m_table.begin(), m_table.end(), empty);
+        size_t mask = m_table.size() - 1;
+        for (size_t i = 0; i < old.size(); ++i) {
+            if (old[i].pack == DEDUP_EMPTY)
+                continue;
+            size_t slot = old[i].crc & mask;
+            while (m_table[slot].pack != DEDUP_EMPTY)
+                slot = (slot + 1) & mask;
+            m_table[slot] = old[i];
+        }
+    }
+
+    size_t mask = m_table.size() - 1;
+    size_t slot = crc & mask;
+    while (m_table[slot].pack != DEDUP_EMPTY)
+        slot = (slot + 1) & mask;
+    m_table[slot].crc = crc;
+    m_table[slot].pack = pack;
+    m_table[slot].chunk = offset / DEDUP_CHUNK_SIZE;
+    ++m_used;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+int ChunkStore::packFd(unsigned long pack)
+{
+    if (pack == m_own) {
+        if (m_ownFd < 0) {
+            string file = m_dir + "/" + m_packs[m_own];
+            m_ownFd = open((file + ".chunks").c_str(),
+                           O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            if (m_ownFd < 0)
+                throw KSystemError("Cannot open " + file + ".chunks", errno);
+            m_indexFd = open((file + ".index").c_str(),
+                             O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            if (m_indexFd < 0)
+                throw KSystemError("Cannot open " + file + ".index", errno);
+
+            // a partial chunk at the end is overwritten
+            struct stat st;
+            if (fstat(m_ownFd, &st) != 0)
+                throw KSystemError("Cannot stat " + file + ".chunks", errno);
+            m_end = st.st_size - st.st_size % DEDUP_CHUNK_SIZE;
+            m_writeback.reset(new WritebackWindow(m_ownFd));
+        }
+        return m_ownFd;
+    }
+
+    if (m_fds[pack] < 0) {
+        string file = m_dir + "/" + m_packs[pack] + ".chunks";
+        m_fds[pack] = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (m_fds[pack] < 0)
+            throw KSystemError("Cannot open " + file, errno);
+    }
+    return m_fds[pack];
+}
+
+// -----------------------------------------------------------------------------
+bool ChunkStore::find(const char *chunk, Ref *ref)
+{
+    Crc32c crc;
+    crc.update(chunk, DEDUP_CHUNK_SIZE);
+    uint32_t key = crc.value();
+
+    size_t mask = m_table.size() - 1;
+    for (size_t slot = key & mask; m_table[slot].pack != DEDUP_EMPTY;
+         slot = (slot + 1) & mask) {
+        const Entry &e = m_table[slot];
+        if (e.crc != key)
+            continue;
+
+        // the CRC only selects candidates
+        unsigned long long offset =
+            (unsigned long long)e.chunk * DEDUP_CHUNK_SIZE;
+        if (readFully(packFd(e.pack), m_buffer.data(), DEDUP_CHUNK_SIZE,
+                      offset, m_packs[e.pack]) != DEDUP_CHUNK_SIZE ||
+            memcmp(m_buffer.data(), chunk, DEDUP_CHUNK_SIZE) != 0)
+            continue;
+
+        ref->pack = e.pack;
+        ref->offset = offset;
+        ++m_found;
+        return true;
+    }
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+ChunkStore::Ref ChunkStore::add(const char *chunk)
+{
+    int fd = packFd(m_own);
+
+    Ref ref;
+    ref.pack = m_own;
+    ref.offset = m_end;
+    writeFully(fd, chunk, DEDUP_CHUNK_SIZE, m_end, m_packs[m_own] + ".chunks");
+    m_end += DEDUP_CHUNK_SIZE;
+    m_writeback->advance(m_end);
+
+    // the index file gets all chunks, even if the table is full
+    Crc32c crc;
+    crc.update(chunk, DEDUP_CHUNK_SIZE);
+    insert(crc.value(), ref.pack, ref.offset);
+
+    unsigned char entry[DEDUP_INDEX_ENTRY];
+    putBE(entry, crc.value(), 4);
+    putBE(entry + 4, 0, 4);
+    putBE(entry + 8, ref.offset, 8);
+    m_pending.append(reinterpret_cast<char *>(entry), sizeof entry);
+
+    ++m_added;
+    return ref;
+}
+
+// -----------------------------------------------------------------------------
+void ChunkStore::commit()
+{
+    if (m_ownFd < 0 || m_pending.empty())
+        return;
+
+    string file = m_dir + "/" + m_packs[m_own];
+    if (fdatasync(m_ownFd) != 0)
+        throw KSystemError("Cannot sync " + file + ".chunks", errno);
+
+    const char *p = m_pending.data();
+    size_t left = m_pending.size();
+    while (left) {
+        ssize_t ret = write(m_indexFd, p, left);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            throw KSystemError("Cannot write " + file + ".index", errno);
+        }
+        p += ret;
+        left -= ret;
+    }
+    if (fdatasync(m_indexFd) != 0)
+        throw KSystemError("Cannot sync " + file + ".index", errno);
+    m_pending.clear();
+}
+
+//}}}
+//{{{ DedupDataProvider --------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+DedupDataProvider::DedupDataProvider(DataProvider *forward, ChunkStore *store,
+                                     const string &release)
+    : m_forward(forward), m_store(store), m_release(release),
+      m_in(DEDUP_BUFFER_SIZE), m_outPos(0), m_pos(0), m_size(0),
+      m_partialOffset(0), m_eof(false), m_runType(0), m_runOffset(0),
+      m_runLength(0)
+{
+    m_runRef.pack = 0;
+    m_runRef.offset = 0;
+}
+
+// -----------------------------------------------------------------------------
+void DedupDataProvider::prepare()
+{
+    m_forward->prepare();
+
+    m_pos = m_size = 0;
+    m_partial.clear();
+    m_eof = false;
+    m_runLength = 0;
+
+    ostringstream header;
+    header << DEDUP_MAGIC << '\n'
+           << "release " << m_release << '\n'
+           << "chunk " << DEDUP_CHUNK_SIZE << '\n';
+    const StringVector &packs = m_store->packs();
+    for (size_t i = 0; i < packs.size(); ++i)
+        header << "pack " << i << ' ' << packs[i] << '\n';
+    header << '\n';
+    m_out = header.str();
+    m_outPos = 0;
+}
+
+// -----------------------------------------------------------------------------
+size_t DedupDataProvider::getData(char *buffer, size_t maxread)
+{
+    // most of the dump shrinks to a few records, so collect them
+    while (m_out.size() - m_outPos < maxread && !m_eof)
+        fill();
+
+    size_t len = min(maxread, m_out.size() - m_outPos);
+    memcpy(buffer, m_out.data() + m_outPos, len);
+    m_outPos += len;
+    if (m_outPos == m_out.size()) {
+        m_out.clear();
+        m_outPos = 0;
+    } else if (m_outPos > DEDUP_BUFFER_SIZE) {
+        m_out.erase(0, m_outPos);
+        m_outPos = 0;
+    }
+    return len;
+}
+
+// -----------------------------------------------------------------------------
+void DedupDataProvider::fill()
+{
+    off_t offset = m_pos;
+    size_t len;
+    if (m_forward->canPlaceData())
+        len = m_forward->getPlacedData(m_in.data(), m_in.size(), &offset);
+    else
+        len = m_forward->getData(m_in.data(), m_in.size());
+
+    if (len == 0) {
+        flushPartial();
+        flushRun();
+        // the map must not refer to chunks that may still be lost
+        m_store->commit();
+        record(m_size, 0, DedupRecord::DR_END);
+        m_eof = true;
+        Debug::debug()->dbg("%llu chunks found, %llu added",
+                            m_store->found(), m_store->added());
+        return;
+    }
+
+    m_pos = offset + len;
+    m_size = std::max(m_size, m_pos);
+    process(offset, m_in.data(), len);
+}
+
+// -----------------------------------------------------------------------------
+void DedupDataProvider::process(off_t offset, const char *data, size_t len)
+{
+    while (len) {
+        if (!m_partial.empty() &&
+            offset != m_partialOffset + (off_t)m_partial.size())
+            flushPartial();
+
+        if (m_partial.empty() && offset % DEDUP_CHUNK_SIZE == 0 &&
+            len >= DEDUP_CHUNK_SIZE) {
+            page(offset, data);
+            offset += DEDUP_CHUNK_SIZE;
+            data += DEDUP_CHUNK_SIZE;
+            len -= DEDUP_CHUNK_SIZE;
+            continue;
+        }
+
+        // collect the data up to the next page boundary
+        if (m_partial.empty())
+            m_partialOffset = offset;
+        size_t room = DEDUP_CHUNK_SIZE - offset % DEDUP_CHUNK_SIZE;
+        size_t n = min(room, len);
+        m_partial.append(data, n);
+        offset += n;
+        data += n;
+        len -= n;
+
+        if (offset % DEDUP_CHUNK_SIZE == 0) {
+            if (m_partial.size() == DEDUP_CHUNK_SIZE) {
+                page(m_partialOffset, m_partial.data());
+                m_partial.clear();
+            } else
+                flushPartial();
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+void DedupDataProvider::page(off_t offset, const char *data)
+{
+    ChunkStore::Ref ref = { 0, 0 };
+    unsigned long type = DedupRecord::DR_ZERO;
+    if (!Util::isZero(data, DEDUP_CHUNK_SIZE)) {
+        type = DedupRecord::DR_CHUNK;
+        if (!m_store->find(data, &ref))
+            ref = m_store->add(data);
+    }
+
+    bool extends = m_runLength && m_runType == type &&
+        offset == m_runOffset + (off_t)m_runLength &&
+        m_runLength < DEDUP_MAX_RUN &&
+        (type == DedupRecord::DR_ZERO ||
+         (ref.pack == m_runRef.pack &&
+          ref.offset == m_runRef.offset + m_runLength));
+    if (!extends) {
+        flushRun();
+        m_runType = type;
+        m_runOffset = offset;
+        m_runRef = ref;
+    }
+    m_runLength += DEDUP_CHUNK_SIZE;
+}
+
+// -----------------------------------------------------------------------------
+void DedupDataProvider::literal(off_t offset, const char *data, size_t len)
+{
+    record(offset, len, DedupRecord::DR_LITERAL);
+    m_out.append(data, len);
+}
+
+// -----------------------------------------------------------------------------
+void DedupDataProvider::flushPartial()
+{
+    if (m_partial.empty())
+        return;
+    literal(m_partialOffset, m_partial.data(), m_partial.size());
+    m_partial.clear();
+}
+
+// -----------------------------------------------------------------------------
+void DedupDataProvider::flushRun()
+{
+    if (!m_runLength)
+        return;
+
+    record(m_runOffset, m_runLength, m_runType);
+    if (m_runType == DedupRecord::DR_CHUNK) {
+        unsigned char ref[DEDUP_REF_SIZE];
+        putBE(ref, m_runRef.pack, 4);
+        putBE(ref + 4, 0, 4);
+        putBE(ref + 8, m_runRef.offset, 8);
+        m_out.append(reinterpret_cast<char *>(ref), sizeof ref);
+    }
+    m_runLength = 0;
+}
+
+// -----------------------------------------------------------------------------
+void DedupDataProvider::record(unsigned long long offset,
+                               unsigned long length, unsigned long type)
+{
+    DedupRecord rec;
+    rec.offset = offset;
+    rec.length = length;
+    rec.type = type;
+
+    unsigned char buf[DEDUP_RECORD_SIZE];
+    rec.encode(buf);
+    m_out.append(reinterpret_cast<char *>(buf), sizeof buf);
+}
+
+// -----------------------------------------------------------------------------
+void DedupDataProvider::finish()
+{
+    m_forward->finish();
+}
+
+// -----------------------------------------------------------------------------
+void DedupDataProvider::setError(bool error)
+{
+    m_forward->setError(error);
+}
+
+// -----------------------------------------------------------------------------
+void DedupDataProvider::setProgress(Progress *progress)
+{
+    m_forward->setProgress(progress);
+}
+
+//}}}
+//{{{ Reconstruct --------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+Reconstruct::Reconstruct()
+{
+    m_options.push_back(new StringOption("store", 's', &m_store,
+        "Chunk store directory (default: next to the dump directory)"));
+}
+
+// -----------------------------------------------------------------------------
+const char *Reconstruct::getName() const
+{
+    return "reconstruct";
+}
+
+// -----------------------------------------------------------------------------
+bool Reconstruct::needsConfigfile() const
+{
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+void Reconstruct::parseArgs(const StringVector &args)
+{
+    Debug::debug()->trace(__FUNCTION__);
+
+    if (args.size() < 1 || args.size() > 2)
+        throw KError("dedup map and optional output file required.");
+
+    m_map = args[0];
+    if (args.size() > 1)
+        m_output = args[1];
+    else {
+        FilePath fp(FilePath(m_map).dirName());
+        m_output = fp.appendPath("vmcore");
+    }
+    Debug::debug()->dbg("map=%s, output=%s",
+                        m_map.c_str(), m_output.c_str());
+}
+
+// -----------------------------------------------------------------------------
+void Reconstruct::execute()
+{
+    Debug::debug()->trace(__FUNCTION__);
+
+    ifstream fin(m_map.c_str(), std::ios::binary);
+    if (!fin)
+        throw KSystemError("Cannot open " + m_map, errno);
+
+    string line, release;
+    StringVector packs;
+    if (!getline(fin, line) || line != DEDUP_MAGIC)
+        throw KError(m_map + " is not a dedup map.");
+    while (getline(fin, line) && !line.empty()) {
+        string::size_type space = line.find(' ');
+        string key = line.substr(0, space);
+        string value = space == string::npos ? "" : line.substr(space + 1);
+        if (key == "release")
+            release = value;
+        else if (key == "chunk") {
+            if (strtoul(value.c_str(), NULL, 10) != DEDUP_CHUNK_SIZE)
+                throw KError("Unsupported chunk size " + value + ".");
+        } else if (key == "pack") {
+            space = value.find(' ');
+            unsigned long n = strtoul(value.c_str(), NULL, 10);
+            if (space == string::npos || n > 0xffff)
+                throw KError("Invalid line in " + m_map + ": " + line);
+            if (n >= packs.size())
+                packs.resize(n + 1);
+            packs[n] = value.substr(space + 1);
+        }
+    }
+
+    string store = m_store;
+    if (store.empty())
+        store = ChunkStore::location(FilePath(m_map).dirName(), release);
+    Debug::debug()->dbg("Chunk store %s", store.c_str());
+
+    int out = open(m_output.c_str(),
+                   O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0)
+        throw KSystemError("Cannot create " + m_output, errno);
+    std::vector<int> fds(packs.size(), -1);
+    auto closeAll = [&]() {
+        for (size_t i = 0; i < fds.size(); ++i)
+            if (fds[i] >= 0)
+                close(fds[i]);
+        if (out >= 0)
+            close(out);
+    };
+
+    try {
+        std::vector<char> buffer(DEDUP_BUFFER_SIZE);
+        unsigned long long written = 0;     // end of the written data
+        unsigned char buf[DEDUP_RECORD_SIZE];
+        DedupRecord rec;
+        do {
+            if (!fin.read(reinterpret_cast<char *>(buf), sizeof buf))
+                throw KError("The dedup map has no end record.");
+            rec.decode(buf);
+
+            unsigned long long offset = rec.offset;
+            unsigned long long left = rec.length;
+            switch (rec.type) {
+            case DedupRecord::DR_LITERAL:
+                while (left) {
+                    size_t n = min<unsigned long long>(left, buffer.size());
+                    if (!fin.read(buffer.data(), n))
+                        throw KError("Truncated dedup map " + m_map + ".");
+                    writeFully(out, buffer.data(), n, offset, m_output);
+                    offset += n;
+                    left -= n;
+                }
+                break;
+
+            case DedupRecord::DR_CHUNK: {
+                unsigned char ref[DEDUP_REF_SIZE];
+                if (!fin.read(reinterpret_cast<char *>(ref), sizeof ref))
+                    throw KError("Truncated dedup map " + m_map + ".");
+                unsigned long pack = getBE(ref, 4);
+                unsigned long long pos = getBE(ref + 8, 8);
+                if (pack >= packs.size() || packs[pack].empty())
+                    throw KError("Unknown pack " +
+                                 StringUtil::number2string(pack) + ".");
+
+                string file = store + "/" + packs[pack] + ".chunks";
+                if (fds[pack] < 0) {
+                    fds[pack] = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+                    if (fds[pack] < 0)
+                        throw KSystemError("Cannot open " + file, errno);
+                }
+                while (left) {
+                    size_t n = min<unsigned long long>(left, buffer.size());
+                    if (readFully(fds[pack], buffer.data(), n, pos, file) != n)
+                        throw KError(file + " is truncated.");
+                    writeFully(out, buffer.data(), n, offset, m_output);
+                    offset += n;
+                    pos += n;
+                    left -= n;
+                }
+                break;
+            }
+
+            case DedupRecord::DR_ZERO:
+                // the file is new, so only data written before must be
+                // cleared
+                if (offset < written) {
+                    std::fill(buffer.begin(), buffer.end(), 0);
+                    unsigned long long end = min(written, offset + left);
+                    while (offset < end) {
+                        size_t n = min<unsigned long long>(end - offset,
+                                                           buffer.size());
+                        writeFully(out, buffer.data(), n, offset, m_output);
+                        offset += n;
+                    }
+                }
+                offset = rec.offset + rec.length;
+                break;
+
+            case DedupRecord::DR_END:
+                if (ftruncate(out, rec.offset) != 0)
+                    throw KSystemError("Cannot truncate " + m_output, errno);
+                break;
+
+            default:
+                throw KError("Unknown record type " +
+                             StringUtil::number2string(rec.type) + " in " +
+                             m_map + ".");
+            }
+            written = std::max(written, offset);
+        } while (rec.type != DedupRecord::DR_END);
+
+        if (fsync(out) != 0)
+            throw KSystemError("Cannot sync " + m_output, errno);
+        int fd = out;
+        out = -1;
+        if (close(fd) != 0)
+            throw KSystemError("Cannot close " + m_output, errno);
+    } catch (...) {
+        closeAll();
+        throw;
+    }
+    closeAll();
+
+    cout << "Reconstructed " << m_output << endl;
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,320 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "global.h"
+#include "dataprovider.h"
+#include "subcommand.h"
+
+class WritebackWindow;
+
+// size of the deduplicated chunks (one page on most architectures)
+#define DEDUP_CHUNK_SIZE        4096
+
+// first line of a dedup map
+#define DEDUP_MAGIC             "KDUMP-DEDUP 1"
+
+// name of the chunk store directory next to the dump directories
+#define DEDUP_STORE             ".kdump-chunks"
+
+// size of a map record header and of a chunk reference
+#define DEDUP_RECORD_SIZE       16
+#define DEDUP_REF_SIZE          16
+
+// longest run of chunks or zero pages in one record
+#define DEDUP_MAX_RUN           (1UL << 30)
+
+//{{{ DedupRecord --------------------------------------------------------------
+
+/**
+ * Record of a dedup map. All numbers are big-endian:
+ *
+ *     offset  8 bytes  offset in the dump
+ *     length  4 bytes  bytes covered by the record
+ *     type    4 bytes  one of the types below
+ *
+ * A DR_LITERAL record is followed by the @c length bytes of data, a
+ * DR_CHUNK record by a reference to the first chunk:
+ *
+ *     pack    4 bytes  number of the pack in the map header
+ *     (zero)  4 bytes
+ *     offset  8 bytes  offset in the pack
+ *
+ * The following chunks of the record are the following chunks of the
+ * pack. DR_ZERO records have no data. The DR_END record is the last
+ * one, and its offset is the size of the dump.
+ */
+struct DedupRecord {
+    enum Type {
+        DR_LITERAL = 1,
+        DR_CHUNK,
+        DR_ZERO,
+        DR_END
+    };
+
+    unsigned long long offset;
+    unsigned long length;
+    unsigned long type;
+
+    void encode(unsigned char *buf) const;
+    void decode(const unsigned char *buf);
+};
+
+//}}}
+//{{{ ChunkStore ---------------------------------------------------------------
+
+/**
+ * Pages of all dumps of one kernel release.
+ *
+ * The store is a directory with one pack of chunks (<name>.chunks) and
+ * one index (<name>.index) for each dump that added chunks to it, so
+ * that dumps never write to the same file. An index has 16 bytes per
+ * chunk: the big-endian CRC-32C of the chunk, four zero bytes and the
+ * big-endian offset of the chunk in the pack. The index is written
+ * after the pack has reached the disk, so it never refers to missing
+ * data; indexes of dumps that were interrupted are simply shorter.
+ *
+ * All indexes are loaded into a hash table. A CRC-32C is only a hint,
+ * so every match is compared with the stored chunk before it is used.
+ */
+class ChunkStore {
+
+    public:
+        /**
+         * Reference to a stored chunk.
+         */
+        struct Ref {
+            unsigned long pack;         // number of the pack
+            unsigned long long offset;  // offset in the pack
+        };
+
+        /**
+         * Opens (or creates) a chunk store.
+         *
+         * @param[in] dir the store directory
+         * @param[in] name the name of the own pack
+         * @param[in] memory bytes available for the index
+         * @exception KError if the directory cannot be created
+         */
+        ChunkStore(const std::string &dir, const std::string &name,
+                   size_t memory);
+
+        /**
+         * Closes all packs. Chunks added after the last commit() are
+         * not in the index.
+         */
+        ~ChunkStore();
+
+        /**
+         * Returns the location of the store for a kernel release.
+         *
+         * @param[in] dumpdir a dump directory, e.g. /var/crash/2026-10-14-12:00
+         * @param[in] release the kernel release
+         */
+        static std::string location(const std::string &dumpdir,
+                                    const std::string &release);
+
+        /**
+         * Returns the names of the packs, in the order of their numbers.
+         */
+        const StringVector &packs() const
+        { return m_packs; }
+
+        /**
+         * Looks up a chunk.
+         *
+         * @param[in] chunk DEDUP_CHUNK_SIZE bytes
+         * @param[out] ref where the chunk is stored
+         * @return @c true if the chunk has been found
+         * @exception KError if a pack cannot be read
+         */
+        bool find(const char *chunk, Ref *ref);
+
+        /**
+         * Appends a chunk to the own pack and indexes it.
+         *
+         * @param[in] chunk DEDUP_CHUNK_SIZE bytes
+         * @return where the chunk is stored
+         * @exception KError if the pack cannot be written
+         */
+        Ref add(const char *chunk);
+
+        /**
+         * Makes the chunks added so far durable and writes their index
+         * entries.
+         *
+         * @exception KError if the pack or the index cannot be written
+         */
+        void commit();
+
+        /**
+         * Returns the number of chunks found and added.
+         */
+        unsigned long long found() const
+        { return m_found; }
+        unsigned long long added() const
+        { return m_added; }
+
+    protected:
+        void load(const std::string &name);
+        int packFd(unsigned long pack);
+        bool insert(uint32_t crc, unsigned long pack,
+                    unsigned long long offset);
+
+    private:
+        // pack UINT32_MAX marks an empty slot
+        struct Entry {
+            uint32_t crc;
+            uint32_t pack;
+            uint32_t chunk;             // offset / DEDUP_CHUNK_SIZE
+        };
+
+        std::string m_dir;
+        StringVector m_packs;
+        std::vector<int> m_fds;
+        unsigned long m_own;
+        int m_ownFd;
+        int m_indexFd;
+        unsigned long long m_end;       // size of the own pack
+        std::string m_pending;          // index entries not yet written
+        std::unique_ptr<WritebackWindow> m_writeback;
+        std::vector<Entry> m_table;
+        size_t m_used;
+        size_t m_memory;
+        std::vector<char> m_buffer;
+        unsigned long long m_found;
+        unsigned long long m_added;
+};
+
+//}}}
+//{{{ DedupDataProvider --------------------------------------------------------
+
+/**
+ * DataProvider that turns a dump into a dedup map.
+ *
+ * Every aligned page of the dump that is not zero is looked up in the
+ * ChunkStore and added to it if it is new, so the map only refers to
+ * it. Data that does not fill an aligned page (e.g. the ELF headers)
+ * is copied to the map. If the other DataProvider can place its data,
+ * the offsets are taken from there, so the holes of a flattened dump
+ * stay holes. Only getData() is available.
+ */
+class DedupDataProvider : public AbstractDataProvider {
+
+    public:
+
+        /**
+         * Wraps a DataProvider.
+         *
+         * @param[in] forward the DataProvider with the dump
+         * @param[in] store the chunk store
+         * @param[in] release the kernel release, recorded in the map
+         */
+        DedupDataProvider(DataProvider *forward, ChunkStore *store,
+                          const std::string &release);
+
+        void prepare();
+        size_t getData(char *buffer, size_t maxread);
+        void finish();
+        void setError(bool error);
+        void setProgress(Progress *progress);
+
+    protected:
+        void fill();
+        void process(off_t offset, const char *data, size_t len);
+        void page(off_t offset, const char *data);
+        void literal(off_t offset, const char *data, size_t len);
+        void flushPartial();
+        void flushRun();
+        void record(unsigned long long offset, unsigned long length,
+                    unsigned long type);
+
+    private:
+        DataProvider *m_forward;
+        ChunkStore *m_store;
+        std::string m_release;
+        std::vector<char> m_in;
+        std::string m_out;
+        size_t m_outPos;
+        off_t m_pos;                    // next offset of getData() data
+        off_t m_size;                   // end of the dump so far
+        std::string m_partial;          // start of an incomplete page
+        off_t m_partialOffset;
+        bool m_eof;
+
+        // run of zero pages or consecutive chunks not yet in the map
+        unsigned long m_runType;
+        off_t m_runOffset;
+        unsigned long m_runLength;
+        ChunkStore::Ref m_runRef;
+};
+
+//}}}
+//{{{ Reconstruct --------------------------------------------------------------
+
+/**
+ * Subcommand to rebuild a dump from a dedup map and its chunk store.
+ */
+class Reconstruct : public Subcommand {
+
+    public:
+        /**
+         * Creates a new Reconstruct object.
+         */
+        Reconstruct();
+
+    public:
+        /**
+         * Returns the name of the subcommand (reconstruct).
+         */
+        const char *getName() const;
+
+        /**
+         * Parses the non-option arguments from the command line.
+         */
+        virtual void parseArgs(const StringVector &args);
+
+        /**
+         * Returns @c false.
+         */
+        bool needsConfigfile() const;
+
+        /**
+         * Executes the function.
+         *
+         * @throw KError on any error. No exception indicates success.
+         */
+        void execute();
+
+    private:
+        std::string m_map;
+        std::string m_output;
+        std::string m_store;
+};
+
+//}}}
+
+#endif /* DEDUP_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -22,23 +22,52 @@ DEFINE_OPT(MAKEDUMPFILE_OPTIONS, String, "", DUMP)
 DEFINE_OPT(KDUMP_IMMEDIATE_REBOOT, Bool, true, DUMP)
 DEFINE_OPT(KDUMP_TRANSFER, String, "", DUMP)
 DEFINE_OPT(KDUMP_SAVEDIR, String, "/var/log/dump", MKINITRD | DUMP)
+DEFINE_OPT(KDUMP_STAGING_DIR, String, "", MKINITRD | DUMP)
+DEFINE_OPT(KDUMP_UPLOAD_BANDWIDTH, Int, 0, DUMP)
+DEFINE_OPT(KDUMP_TRIAGE_URL, String, "", MKINITRD | DUMP)
 DEFINE_OPT(KDUMP_KEEP_OLD_DUMPS, Int, 0, DUMP)
+DEFINE_OPT(KDUMP_OLD_DUMPS_MAX_AGE, Int, 0, DUMP)
+DEFINE_OPT(KDUMP_OLD_DUMPS_MAX_SIZE, Int, 0, DUMP)
 DEFINE_OPT(KDUMP_FREE_DISK_SIZE, Int, 64, DUMP)
 DEFINE_OPT(KDUMP_VERBOSE, Int, 0, KEXEC | DUMP)
 DEFINE_OPT(KDUMP_DUMPLEVEL, Int, 31, DUMP)
 DEFINE_OPT(KDUMP_DUMPFORMAT, String, "compressed", DUMP)
+DEFINE_OPT(KDUMP_TIME_BUDGET, Int, 0, DUMP)
 DEFINE_OPT(KDUMP_CONTINUE_ON_ERROR, Bool, true, DUMP)
 DEFINE_OPT(KDUMP_REQUIRED_PROGRAMS, String, "", MKINITRD)
+DEFINE_OPT(KDUMP_INITRD_PROFILE, String, "default", MKINITRD)
+DEFINE_OPT(KDUMP_DEVICE_TIMEOUT, Int, 0, MKINITRD)
 DEFINE_OPT(KDUMP_PRESCRIPT, String, "", DUMP)
 DEFINE_OPT(KDUMP_POSTSCRIPT, String, "", DUMP)
 DEFINE_OPT(KDUMP_COPY_KERNEL, Bool, "", DUMP)
 DEFINE_OPT(KDUMPTOOL_FLAGS, String, "", DUMP)
 DEFINE_OPT(KDUMP_NETCONFIG, String, "auto", MKINITRD)
 DEFINE_OPT(KDUMP_NET_TIMEOUT, Int, 30, DUMP)
+DEFINE_OPT(KDUMP_NET_TUNING, String, "", MKINITRD | DUMP)
 DEFINE_OPT(KDUMP_SMTP_SERVER, String, "", DUMP)
 DEFINE_OPT(KDUMP_SMTP_USER, String, "", DUMP)
 DEFINE_OPT(KDUMP_SMTP_PASSWORD, String, "", DUMP)
 DEFINE_OPT(KDUMP_NOTIFICATION_TO, String, "", DUMP)
 DEFINE_OPT(KDUMP_NOTIFICATION_CC, String, "", DUMP)
+DEFINE_OPT(KDUMP_NOTIFICATION_START, Bool, false, DUMP)
+DEFINE_OPT(KDUMP_NOTIFICATION_TIMEOUT, Int, 60, DUMP)
 DEFINE_OPT(KDUMP_HOST_KEY, String, "", DUMP)
 DEFINE_OPT(KDUMP_SSH_IDENTITY, String, "", MKINITRD)
+DEFINE_OPT(KDUMP_SSH_CIPHER, String, "auto", MKINITRD)
+DEFINE_OPT(KDUMP_SFTP_WINDOW, Int, 16, DUMP)
+DEFINE_OPT(KDUMP_SFTP_CHUNK_SIZE, Int, 64, DUMP)
+DEFINE_OPT(KDUMP_TRANSFER_RETRIES, Int, 3, DUMP)
+DEFINE_OPT(KDUMP_S3_REGION, String, "us-east-1", DUMP)
+DEFINE_OPT(KDUMP_S3_PART_SIZE, Int, 16, DUMP)
+DEFINE_OPT(KDUMP_S3_CONNECTIONS, Int, 4, DUMP)
+DEFINE_OPT(KDUMP_NFS_MOUNT_OPTIONS, String, "nconnect=8,rsize=1048576,wsize=1048576,hard,nocto", DUMP)
+DEFINE_OPT(KDUMP_CIFS_MOUNT_OPTIONS, String, "multichannel,max_channels=4,wsize=4194304", DUMP)
+DEFINE_OPT(KDUMP_CHECKSUM_CHUNK_SIZE, Int, 0, DUMP)
+DEFINE_OPT(KDUMP_ELF_ZSTD_LEVEL, Int, 0, DUMP)
+DEFINE_OPT(KDUMP_DEDUP_INDEX, Int, 64, DUMP)
+DEFINE_OPT(KDUMP_TARGET_LAG, Int, 16, DUMP)
+DEFINE_OPT(KDUMP_BUFFER_MEMORY, Int, 0, DUMP)
+DEFINE_OPT(KDUMP_PREFETCH_DEPTH, Int, 4, DUMP)
+DEFINE_OPT(KDUMP_RECORD_STREAM, String, "", DUMP)
+DEFINE_OPT(KDUMP_PROGRESS_REPORT, String, "", DUMP)
+DEFINE_OPT(KDUMP_PROGRESS_INTERVAL, Int, 10, DUMP)
@@ -23,6 +23,12 @@
 #include <sstream>
 #include <algorithm>
 #include <ext/algorithm>
+#include <fstream>
+#include <ctime>
+#include <cstring>
+#include <system_error>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "subcommand.h"
 #include "debug.h"
@@ -37,6 +43,7 @@
 #include "stringutil.h"
 #include "vmcoreinfo.h"
 #include "deletedumps.h"
+#include "dumpcatalog.h"
 #include "stringvector.h"
 
 using std::string;
@@ -46,6 +53,127 @@ using std::stringstream;
 using std::cerr;
 using std::back_inserter;
 
+#define SIZE_INDEX_FILE     ".kdump-index"
+#define SIZE_INDEX_MAGIC    "KDUMP-SIZE-INDEX 1"
+
+//{{{ DumpSizeIndex ------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+DumpSizeIndex::DumpSizeIndex(const FilePath &dir)
+    : m_dir(dir), m_dirty(false)
+{
+    FilePath file = m_dir;
+    file.appendPath(SIZE_INDEX_FILE);
+    std::ifstream fin(file.c_str());
+    if (!fin)
+        return;
+
+    string line;
+    if (!getline(fin, line) || line != SIZE_INDEX_MAGIC) {
+        Debug::debug()->dbg("Ignoring invalid %s", file.c_str());
+        return;
+    }
+
+    // <name> <stamp> <bytes>, the name cannot contain spaces
+    string name;
+    Entry entry;
+    while (fin >> name >> entry.stamp >> entry.size)
+        m_entries[name] = entry;
+    Debug::debug()->dbg("Loaded %zu sizes from %s", m_entries.size(),
+                        file.c_str());
+}
+
+// -----------------------------------------------------------------------------
+string DumpSizeIndex::stamp(const string &name) const
+{
+    FilePath path = m_dir;
+    path.appendPath(name);
+
+    struct stat mystat;
+    if (stat(path.c_str(), &mystat) != 0)
+        throw KSystemError("stat() on " + path + " failed.", errno);
+
+    stringstream ss;
+    ss << mystat.st_ino << ':' << mystat.st_mtim.tv_sec << '.'
+       << mystat.st_mtim.tv_nsec;
+    return ss.str();
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long DumpSizeIndex::size(const string &name)
+{
+    string current = stamp(name);
+    std::map<string, Entry>::const_iterator it = m_entries.find(name);
+    if (it != m_entries.end() && it->second.stamp == current)
+        return it->second.size;
+
+    FilePath path = m_dir;
+    path.appendPath(name);
+    Entry entry;
+    entry.stamp = current;
+    entry.size = path.diskUsage();
+    Debug::debug()->dbg("%s uses %llu MiB", path.c_str(),
+                        bytes_to_megabytes(entry.size));
+
+    m_entries[name] = entry;
+    m_dirty = true;
+    return entry.size;
+}
+
+// -----------------------------------------------------------------------------
+void DumpSizeIndex::remove(const string &name)
+{
+    if (m_entries.erase(name))
+        m_dirty = true;
+}
+
+// -----------------------------------------------------------------------------
+void DumpSizeIndex::prune(const StringVector &names)
+{
+    std::map<string, Entry>::iterator it = m_entries.begin();
+    while (it != m_entries.end()) {
+        if (std::find(names.begin(), names.end(), it->first) == names.end()) {
+            it = m_entries.erase(it);
+            m_dirty = true;
+        } else
+            ++it;
+    }
+}
+
+// -----------------------------------------------------------------------------
+void DumpSizeIndex::save()
+{
+    if (!m_dirty)
+        return;
+    m_dirty = false;
+
+    FilePath file = m_dir;
+    file.appendPath(SIZE_INDEX_FILE);
+    string tmp = file + ".tmp";
+    {
+        std::ofstream fout(tmp.c_str(), std::ios::trunc);
+        fout << SIZE_INDEX_MAGIC << endl;
+        std::map<string, Entry>::const_iterator it;
+        for (it = m_entries.begin(); it != m_entries.end(); ++it)
+            fout << it->first << ' ' << it->second.stamp << ' '
+                 << it->second.size << endl;
+        fout.close();
+        if (!fout) {
+            Debug::debug()->dbg("Cannot write %s", tmp.c_str());
+            unlink(tmp.c_str());
+            return;
+        }
+    }
+
+    // the index is only a cache, so errors are not fatal
+    if (rename(tmp.c_str(), file.c_str()) != 0) {
+        Debug::debug()->dbg("Cannot rename %s: %s", tmp.c_str(),
+                            strerror(errno));
+        unlink(tmp.c_str());
+    }
+}
+
+//}}}
 //{{{ DeleteDumps --------------------------------------------------------------
 
 // -----------------------------------------------------------------------------
@@ -70,7 +198,7 @@ void DeleteDumps::deleteAll()
 
     std::istringstream iss(config->KDUMP_SAVEDIR.value());
     string elem;
-    while (iss >> elem) {
+    while (iss >> elem && !cancelled()) {
         RootDirURL url(elem, m_rootdir);
         deleteOne(url, oldDumps);
     }
@@ -92,30 +220,218 @@ void DeleteDumps::deleteOne(const RootDirURL &url, int oldDumps)
         return;
     }
 
-    StringVector contents = dir.listDir(FilterKdumpDirs());
-    int deleteItems;
+    Configuration *config = Configuration::config();
+    DumpCatalog catalog(dir);
+    if (!catalog.current())
+        catalog.rebuild();
+    StringVector contents = catalog.dumps();
+    size_t first = 0;
+
+    // KDUMP_KEEP_OLD_DUMPS
+    size_t deleteItems = 0;
     if (oldDumps == -1)
         deleteItems = contents.size();
-    else if (oldDumps > int(contents.size())) {
-        Debug::debug()->dbg("Nothing to delete.");
-        return;
-    } else
+    else if (oldDumps < int(contents.size()))
         deleteItems = contents.size() - oldDumps;
+    Debug::debug()->dbg("Deleting the oldest %zu entries.", deleteItems);
+    for (; first < deleteItems; ++first)
+        deleteDump(dir, contents[first], catalog);
 
-    Debug::debug()->dbg("Deleting the oldest %d entries.", deleteItems);
-
-    StringVector toDelete;
-    std::copy_n(contents.begin(), deleteItems, back_inserter(toDelete));
+    // KDUMP_OLD_DUMPS_MAX_AGE, in days
+    int maxAge = config->KDUMP_OLD_DUMPS_MAX_AGE.value();
+    if (maxAge > 0) {
+        time_t limit = time(NULL) - (time_t)maxAge * 24 * 60 * 60;
+        for (; first < contents.size(); ++first) {
+            if (catalog.find(contents[first])->crashTime >= limit)
+                break;
+            Debug::debug()->dbg("%s is older than %d days.",
+                                contents[first].c_str(), maxAge);
+            deleteDump(dir, contents[first], catalog);
+        }
+    }
 
-    for (StringVector::const_iterator it = toDelete.begin();
-            it != toDelete.end(); ++it) {
-        Debug::debug()->info("Deleting %s.", (*it).c_str());
-        if (!m_dryRun) {
-            FilePath fp = dir;
-            fp.appendPath(*it);
-            fp.rmdir(true);
+    // KDUMP_OLD_DUMPS_MAX_SIZE, in MiB
+    int maxSize = config->KDUMP_OLD_DUMPS_MAX_SIZE.value();
+    if (maxSize > 0) {
+        unsigned long long total = 0;
+        for (size_t i = first; i < contents.size(); ++i)
+            total += catalog.size(contents[i]);
+        Debug::debug()->dbg("Old dumps use %llu MiB.",
+                            bytes_to_megabytes(total));
+        unsigned long long limit = (unsigned long long)maxSize << 20;
+        for (; first < contents.size() && total > limit; ++first) {
+            total -= catalog.size(contents[first]);
+            deleteDump(dir, contents[first], catalog);
         }
     }
+
+    if (!m_dryRun)
+        catalog.save();
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long DeleteDumps::makeRoom(const FilePath &dir,
+                                         unsigned long long bytes,
+                                         const string &keep)
+{
+    Debug::debug()->trace("DeleteDumps::makeRoom(%s, %llu, %s)",
+                          dir.c_str(), bytes, keep.c_str());
+
+    Configuration *config = Configuration::config();
+    if (config->KDUMP_KEEP_OLD_DUMPS.value() == 0 || !dir.exists())
+        return 0;
+
+    DumpCatalog catalog(dir);
+    if (!catalog.current())
+        catalog.rebuild();
+    StringVector contents = catalog.dumps();
+    Debug::debug()->info("%llu MiB more are needed for the new dump in %s.",
+                         bytes_to_megabytes(bytes + (1 << 20) - 1),
+                         dir.c_str());
+
+    unsigned long long freed = 0;
+    for (StringVector::const_iterator it = contents.begin();
+         it != contents.end() && freed < bytes; ++it) {
+        if (*it == keep)
+            continue;
+        freed += catalog.size(*it);
+        deleteDump(dir, *it, catalog);
+    }
+
+    if (!m_dryRun)
+        catalog.save();
+    return freed;
+}
+
+// -----------------------------------------------------------------------------
+void DeleteDumps::deleteDump(const FilePath &dir, const string &name,
+                             DumpCatalog &catalog)
+{
+    if (cancelled())
+        return;
+
+    Debug::debug()->info("Deleting %s.", name.c_str());
+    if (m_dryRun)
+        return;
+
+    FilePath fp = dir;
+    fp.appendPath(name);
+    fp.rmdir(true);
+    catalog.remove(name);
+    deleted(dir, name);
+}
+
+//}}}
+//{{{ DeleteDumpsThread --------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+DeleteDumpsThread::DeleteDumpsThread(const string &rootdir)
+    : m_running(false), m_deleted(0), m_cancel(false)
+{
+    rootDir(rootdir);
+}
+
+// -----------------------------------------------------------------------------
+DeleteDumpsThread::~DeleteDumpsThread()
+{
+    abandon();
+}
+
+// -----------------------------------------------------------------------------
+void DeleteDumpsThread::start()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = true;
+    }
+    try {
+        m_thread = std::thread(&DeleteDumpsThread::run, this);
+    } catch (const std::system_error &e) {
+        // delete before the dump is saved, as without a thread
+        Debug::debug()->dbg("Cannot start a thread: %s", e.what());
+        run();
+    }
+}
+
+// -----------------------------------------------------------------------------
+void DeleteDumpsThread::run()
+{
+    try {
+        deleteAll();
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_error = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running = false;
+    m_cond.notify_all();
+}
+
+// -----------------------------------------------------------------------------
+bool DeleteDumpsThread::cancelled()
+{
+    return m_cancel;
+}
+
+// -----------------------------------------------------------------------------
+void DeleteDumpsThread::deleted(const FilePath &dir, const string &name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_deleted;
+    m_cond.notify_all();
+}
+
+// -----------------------------------------------------------------------------
+bool DeleteDumpsThread::waitUntil(const std::function<bool()> &enough)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        bool running = m_running;
+        unsigned long count = m_deleted;
+
+        // the check looks at the file system, so do it without the lock
+        lock.unlock();
+        bool ok = enough();
+        lock.lock();
+        if (ok || !running)
+            return ok;
+
+        m_cond.wait(lock, [this, count]() {
+                return m_deleted != count || !m_running;
+            });
+    }
+}
+
+// -----------------------------------------------------------------------------
+bool DeleteDumpsThread::running() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_running;
+}
+
+// -----------------------------------------------------------------------------
+void DeleteDumpsThread::finish()
+{
+    if (m_thread.joinable())
+        m_thread.join();
+
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        error = m_error;
+        m_error = std::exception_ptr();
+    }
+    if (error)
+        std::rethrow_exception(error);
+}
+
+// -----------------------------------------------------------------------------
+void DeleteDumpsThread::abandon()
+{
+    m_cancel = true;
+    if (m_thread.joinable())
+        m_thread.join();
 }
 
 //}}}
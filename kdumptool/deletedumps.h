@@ -19,15 +19,84 @@
 #ifndef DELETE_DUMP_H
 #define DELETE_DUMP_H
 
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <functional>
+
 #include "subcommand.h"
 #include "rootdirurl.h"
+#include "fileutil.h"
 
 class Transfer;
+class DumpCatalog;
+
+//{{{ DumpSizeIndex ------------------------------------------------------------
+
+/**
+ * Disk usage of the dumps in a KDUMP_SAVEDIR directory.
+ *
+ * The sizes are stored in the file .kdump-index in that directory. An
+ * entry is valid as long as the modification time of its dump directory
+ * does not change, so only new dumps have to be walked when the
+ * DumpCatalog is rebuilt.
+ */
+class DumpSizeIndex {
+
+    public:
+        /**
+         * Loads the index of @p dir, if there is one.
+         */
+        DumpSizeIndex(const FilePath &dir);
+
+        /**
+         * Returns the disk usage of the dump @p name in bytes.
+         *
+         * @exception KError if the size is not in the index and the
+         *            dump cannot be walked
+         */
+        unsigned long long size(const std::string &name);
+
+        /**
+         * Removes a deleted dump from the index.
+         */
+        void remove(const std::string &name);
+
+        /**
+         * Removes all dumps that are not in @p names, i.e. that have
+         * been deleted by somebody else.
+         */
+        void prune(const StringVector &names);
+
+        /**
+         * Writes the index back if it has been changed.
+         */
+        void save();
+
+    private:
+        struct Entry {
+            std::string stamp;
+            unsigned long long size;
+        };
+
+        std::string stamp(const std::string &name) const;
 
+        FilePath m_dir;
+        std::map<std::string, Entry> m_entries;
+        bool m_dirty;
+};
+
+//}}}
 //{{{ DeleteDumps --------------------------------------------------------------
 
 /**
  * Delete old dumps from disk.
+ *
+ * The dumps and their sizes are taken from the DumpCatalog of each
+ * directory, which is rebuilt if it is not current.
  */
 class DeleteDumps {
     protected:
@@ -37,8 +106,32 @@ class DeleteDumps {
     public:
         DeleteDumps();
 
+        virtual ~DeleteDumps()
+        {}
+
+        /**
+         * Applies KDUMP_KEEP_OLD_DUMPS, KDUMP_OLD_DUMPS_MAX_AGE and
+         * KDUMP_OLD_DUMPS_MAX_SIZE to all local KDUMP_SAVEDIR targets.
+         *
+         * @throw KError on any error.
+         */
         void deleteAll();
 
+        /**
+         * Deletes the oldest dumps in @p dir until at least @p bytes
+         * have been freed. Nothing is deleted if KDUMP_KEEP_OLD_DUMPS
+         * is 0.
+         *
+         * @param[in] dir the KDUMP_SAVEDIR directory (real path)
+         * @param[in] bytes the space that is needed
+         * @param[in] keep a dump that must not be deleted
+         * @return the disk usage of the deleted dumps
+         * @throw KError on any error.
+         */
+        unsigned long long makeRoom(const FilePath &dir,
+                                    unsigned long long bytes,
+                                    const std::string &keep);
+
         const std::string& rootDir() const
         { return m_rootdir; }
         void rootDir(const std::string& rootdir)
@@ -49,6 +142,20 @@ class DeleteDumps {
         void dryRun(bool dryRun)
         { m_dryRun = dryRun; }
 
+    protected:
+	/**
+	 * Called before each dump is deleted. Nothing more is deleted
+	 * once it returns @c true.
+	 */
+	virtual bool cancelled()
+	{ return false; }
+
+	/**
+	 * Called after the dump @p name in @p dir has been deleted.
+	 */
+	virtual void deleted(const FilePath &dir, const std::string &name)
+	{}
+
     private:
 	/**
 	 * Helper function to delete one dump target directory.
@@ -56,6 +163,84 @@ class DeleteDumps {
 	 * @throw KError on any error.
 	 */
 	void deleteOne(const RootDirURL &url, int oldDumps);
+
+	/**
+	 * Deletes the dump @p name in @p dir (unless this is a dry run).
+	 */
+	void deleteDump(const FilePath &dir, const std::string &name,
+			DumpCatalog &catalog);
+};
+
+//}}}
+//{{{ DeleteDumpsThread --------------------------------------------------------
+
+/**
+ * Deletes old dumps (DeleteDumps::deleteAll()) in the background while
+ * the new dump is saved.
+ *
+ * The save waits with waitUntil() only until there is enough space for
+ * the new dump; the rest is deleted concurrently. The deletion must be
+ * over before the system reboots: finish() waits for it, and the
+ * destructor abandons it after the dump that is being deleted.
+ */
+class DeleteDumpsThread : protected DeleteDumps {
+
+    public:
+        /**
+         * @param[in] rootdir the root directory of the dump targets
+         */
+        DeleteDumpsThread(const std::string &rootdir);
+
+        /**
+         * Abandons the deletion (see abandon()).
+         */
+        ~DeleteDumpsThread();
+
+        /**
+         * Starts deleting.
+         */
+        void start();
+
+        /**
+         * Waits until @p enough returns @c true or nothing more is
+         * deleted. @p enough is evaluated again after each deleted dump.
+         *
+         * @return the last result of @p enough
+         */
+        bool waitUntil(const std::function<bool()> &enough);
+
+        /**
+         * Returns @c true while dumps are being deleted.
+         */
+        bool running() const;
+
+        /**
+         * Waits until all dumps have been deleted.
+         *
+         * @throw KError if the deletion has failed
+         */
+        void finish();
+
+        /**
+         * Stops after the dump that is being deleted and waits for it.
+         * The size index is saved.
+         */
+        void abandon();
+
+    protected:
+        bool cancelled();
+        void deleted(const FilePath &dir, const std::string &name);
+
+    private:
+        void run();
+
+        std::thread m_thread;
+        bool m_running;
+        unsigned long m_deleted;        // counts deleted dumps
+        std::atomic<bool> m_cancel;
+        std::exception_ptr m_error;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cond;
 };
 
 //}}}
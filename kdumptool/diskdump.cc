@@ -0,0 +1,794 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include <elf.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/utsname.h>
+#include <zlib.h>
+
+#include "global.h"
+#include "debug.h"
+#include "progress.h"
+#include "stringutil.h"
+#include "vmcoreinfo.h"
+#include "flattened.h"
+#include "diskdump.h"
+
+#if HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+using std::string;
+using std::min;
+
+// pages that a worker thread reads and compresses at a time
+#define DISKDUMP_BATCH_PAGES        512
+
+// batches that may be compressed ahead of the consumer, per thread
+#define DISKDUMP_BATCHES_PER_THREAD 2
+
+// the header is block 0, the sub header starts block 1
+#define DISKDUMP_HEADER_BLOCKS      1
+
+static_assert(sizeof(DiskdumpDataProvider::Header) == 464,
+              "layout of disk_dump_header");
+static_assert(sizeof(DiskdumpDataProvider::SubHeader) == 104,
+              "layout of kdump_sub_header");
+static_assert(sizeof(DiskdumpDataProvider::PageDesc) == 24,
+              "layout of page_desc_t");
+
+//{{{ Helpers ------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+static void readAt(int fd, void *buffer, size_t size, loff_t offset,
+                   const string &file)
+{
+    char *p = static_cast<char *>(buffer);
+
+    while (size) {
+        ssize_t ret = pread(fd, p, size, offset);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret < 0)
+            throw KSystemError("Cannot read " + file + " at " +
+                               StringUtil::number2hex(offset), errno);
+        if (ret == 0)
+            throw KError("Unexpected end of " + file + ".");
+        p += ret;
+        offset += ret;
+        size -= ret;
+    }
+}
+
+// -----------------------------------------------------------------------------
+static bool isZero(const char *data, size_t len)
+{
+    const uint64_t *p = reinterpret_cast<const uint64_t *>(data);
+    for (size_t i = 0; i < len / sizeof *p; ++i)
+        if (p[i])
+            return false;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+static void putBE64(unsigned char *p, int64_t value)
+{
+    uint64_t val = value;
+    for (int i = 7; i >= 0; --i) {
+        p[i] = val & 0xff;
+        val >>= 8;
+    }
+}
+
+// -----------------------------------------------------------------------------
+static unsigned long long roundUp(unsigned long long value,
+                                  unsigned long long align)
+{
+    return (value + align - 1) / align * align;
+}
+
+//}}}
+//{{{ DiskdumpDataProvider -----------------------------------------------------
+
+// -----------------------------------------------------------------------------
+DiskdumpDataProvider::DiskdumpDataProvider(const PageFilter &filter,
+                                           unsigned compression,
+                                           unsigned threads,
+                                           const string &nodename)
+    : m_filter(filter), m_compression(compression),
+      m_threadCount(std::max(threads, 1U)), m_nodename(nodename),
+      m_fd(filter.context().path(), O_RDONLY | O_CLOEXEC),
+      m_pageSize(filter.pageSize()), m_totalPages(0), m_bitmapOffset(0),
+      m_bitmapLength(0), m_descOffset(0), m_zeroOffset(0),
+      m_stage(STAGE_HEADER), m_bitmapPos(0), m_piece(NULL),
+      m_pieceLength(0), m_pieceDone(0), m_pieceOffset(0), m_dataPos(0),
+      m_donePages(0), m_placed(false), m_index(NULL), m_streamPos(0),
+      m_recordPos(-1), m_flatStarted(false),
+      m_flatEnd(false), m_prefixDone(0), m_next(0), m_consumed(0),
+      m_stop(false)
+{
+    if (!supported(compression))
+        throw KError("Unsupported compression of the dump.");
+    m_current.length = 0;
+}
+
+// -----------------------------------------------------------------------------
+DiskdumpDataProvider::~DiskdumpDataProvider()
+{
+    stop();
+}
+
+// -----------------------------------------------------------------------------
+bool DiskdumpDataProvider::supported(unsigned compression)
+{
+    if (compression == DUMP_DH_COMPRESSED_ZLIB)
+        return true;
+#if HAVE_ZSTD
+    if (compression == DUMP_DH_COMPRESSED_ZSTD)
+        return true;
+#endif
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+void DiskdumpDataProvider::mergeExtents(std::vector<Extent> &extents,
+                                        unsigned long pagesize)
+{
+    std::stable_sort(extents.begin(), extents.end(),
+                     [](const Extent &a, const Extent &b) {
+                         return a.pfn < b.pfn;
+                     });
+
+    std::vector<Extent> ret;
+    unsigned long long end = 0;
+    std::vector<Extent>::const_iterator it;
+    for (it = extents.begin(); it != extents.end(); ++it) {
+        Extent ext = *it;
+        if (!ext.pages || ext.pfn + ext.pages <= end)
+            continue;
+        if (ext.pfn < end) {
+            unsigned long long skip = end - ext.pfn;
+            ext.pfn += skip;
+            ext.pages -= skip;
+            ext.offset += skip * pagesize;
+        }
+        ret.push_back(ext);
+        end = ext.pfn + ext.pages;
+    }
+    extents.swap(ret);
+}
+
+// -----------------------------------------------------------------------------
+void DiskdumpDataProvider::setBits(unsigned char *bitmap, size_t len,
+                                   unsigned long long first,
+                                   const std::vector<Extent> &extents)
+{
+    unsigned long long last = first + 8ULL * len;
+
+    // the first extent that ends after the start of the bitmap
+    std::vector<Extent>::const_iterator it = std::upper_bound(
+        extents.begin(), extents.end(), first,
+        [](unsigned long long pfn, const Extent &ext) {
+            return pfn < ext.pfn + ext.pages;
+        });
+    for (; it != extents.end() && it->pfn < last; ++it) {
+        unsigned long long pfn = std::max(it->pfn, first);
+        unsigned long long end = min(it->pfn + it->pages, last);
+        for (; pfn < end; ++pfn)
+            bitmap[(pfn - first) / 8] |= 1 << ((pfn - first) % 8);
+    }
+}
+
+// -----------------------------------------------------------------------------
+void DiskdumpDataProvider::readNotes(std::vector<char> &notes,
+                                     SubHeader &sub, int32_t *cpus)
+{
+    const VmcoreContext &ctx = m_filter.context();
+    const string &path = ctx.path();
+
+    Elf64_Ehdr ehdr;
+    readAt(m_fd, &ehdr, sizeof ehdr, 0, path);
+    size_t phnum = ehdr.e_phnum;
+    if (phnum == PN_XNUM) {
+        Elf64_Shdr shdr;
+        readAt(m_fd, &shdr, sizeof shdr, ehdr.e_shoff, path);
+        phnum = shdr.sh_info;
+    }
+    std::vector<Elf64_Phdr> phdrs(phnum);
+    readAt(m_fd, phdrs.data(), phnum * sizeof(Elf64_Phdr), ehdr.e_phoff,
+           path);
+
+    // all notes in one block, as in the PT_NOTE of /proc/vmcore
+    std::vector<Elf64_Phdr>::const_iterator it;
+    for (it = phdrs.begin(); it != phdrs.end(); ++it) {
+        if (it->p_type != PT_NOTE || !it->p_filesz)
+            continue;
+        size_t pos = notes.size();
+        notes.resize(pos + it->p_filesz);
+        readAt(m_fd, &notes[pos], it->p_filesz, it->p_offset, path);
+
+        std::vector<VmcoreContext::Note>::const_iterator note;
+        for (note = ctx.notes().begin(); note != ctx.notes().end(); ++note) {
+            if (note->offset < (off_t)it->p_offset ||
+                note->offset - it->p_offset >= it->p_filesz)
+                continue;
+            if (note->name == "VMCOREINFO") {
+                sub.offset_vmcoreinfo = sub.offset_note + pos +
+                    (note->offset - it->p_offset);
+                sub.size_vmcoreinfo = note->size;
+            } else if (note->name == "CORE" && note->type == NT_PRSTATUS)
+                ++*cpus;
+        }
+    }
+    sub.size_note = notes.size();
+}
+
+// -----------------------------------------------------------------------------
+void DiskdumpDataProvider::readUtsname(Header &header)
+{
+    const Vmcoreinfo &info = m_filter.context().vmcoreinfo();
+    string release;
+    try {
+        release = info.getStringValue("OSRELEASE");
+    } catch (const KError &) {
+        Debug::debug()->dbg("No OSRELEASE in VMCOREINFO");
+    }
+
+    // older kernels have a reference count before the name
+    try {
+        unsigned long long addr = strtoull(
+            info.getStringValue("SYMBOL(init_uts_ns)").c_str(), NULL, 16);
+        std::vector<unsigned long> offsets;
+        try {
+            offsets.push_back(strtoul(info.getStringValue(
+                    "OFFSET(uts_namespace.name)").c_str(), NULL, 10));
+        } catch (const KError &) {
+            offsets.push_back(0);
+            offsets.push_back(4);
+        }
+
+        std::vector<unsigned long>::const_iterator it;
+        for (it = offsets.begin(); it != offsets.end(); ++it) {
+            char uts[6][65];
+            m_filter.readVirtual(addr + *it, uts[0], sizeof uts);
+            if (strncmp(uts[0], "Linux", sizeof uts[0]) == 0 &&
+                release == string(uts[2], strnlen(uts[2], sizeof uts[2]))) {
+                memcpy(header.utsname, uts, sizeof uts);
+                return;
+            }
+        }
+        Debug::debug()->dbg("init_uts_ns does not match OSRELEASE");
+    } catch (const KError &error) {
+        Debug::debug()->dbg("Cannot read init_uts_ns: %s", error.what());
+    }
+
+    // the crash kernel runs on the same machine
+    struct utsname own;
+    if (uname(&own) != 0)
+        memset(&own, 0, sizeof own);
+    strncpy(header.utsname[0], "Linux", sizeof header.utsname[0] - 1);
+    strncpy(header.utsname[1], m_nodename.c_str(),
+            sizeof header.utsname[1] - 1);
+    strncpy(header.utsname[2], release.c_str(), sizeof header.utsname[2] - 1);
+    strncpy(header.utsname[4], own.machine, sizeof header.utsname[4] - 1);
+}
+
+// -----------------------------------------------------------------------------
+void DiskdumpDataProvider::buildHeader()
+{
+    const VmcoreContext &ctx = m_filter.context();
+    const std::vector<VmcoreContext::Segment> &segs = ctx.segments();
+    const unsigned long bs = m_pageSize;
+
+    m_valid.clear();
+    m_extents.clear();
+    for (size_t i = 0; i < segs.size(); ++i) {
+        const VmcoreContext::Segment &s = segs[i];
+        if ((s.paddr | s.filesz) & (bs - 1))
+            throw KError("The PT_LOAD segment at " +
+                         StringUtil::number2hex(s.paddr) +
+                         " is not page aligned.");
+
+        Extent all = { s.paddr / bs, s.filesz / bs, s.offset };
+        m_valid.push_back(all);
+
+        std::vector<PageFilter::Run> runs = m_filter.keptRuns(i);
+        std::vector<PageFilter::Run>::const_iterator it;
+        for (it = runs.begin(); it != runs.end(); ++it) {
+            Extent ext = { all.pfn + it->first, it->count,
+                           (loff_t)(s.offset + it->first * bs) };
+            m_extents.push_back(ext);
+        }
+    }
+    mergeExtents(m_valid, bs);
+    mergeExtents(m_extents, bs);
+
+    unsigned long long maxPfn = 0;
+    std::vector<Extent>::const_iterator it;
+    for (it = m_valid.begin(); it != m_valid.end(); ++it)
+        maxPfn = std::max(maxPfn, it->pfn + it->pages);
+    m_totalPages = 0;
+    for (it = m_extents.begin(); it != m_extents.end(); ++it)
+        m_totalPages += it->pages;
+
+    // the notes follow the sub header
+    SubHeader sub = SubHeader();
+    int32_t cpus = 0;
+    std::vector<char> notes;
+    sub.offset_note = DISKDUMP_HEADER_BLOCKS * bs + sizeof sub;
+    readNotes(notes, sub, &cpus);
+    try {
+        sub.phys_base = strtoll(ctx.vmcoreinfo().getStringValue(
+                "NUMBER(phys_base)").c_str(), NULL, 10);
+    } catch (const KError &) {
+        Debug::debug()->dbg("No phys_base in VMCOREINFO");
+    }
+    sub.dump_level = m_filter.dumpLevel();
+    sub.max_mapnr_64 = maxPfn;
+
+    unsigned long long subBlocks = roundUp(sizeof sub + notes.size(), bs) / bs;
+    m_bitmapLength = roundUp((maxPfn + 7) / 8, bs);
+    m_bitmapOffset = (DISKDUMP_HEADER_BLOCKS + subBlocks) * bs;
+    m_descOffset = m_bitmapOffset + 2 * m_bitmapLength;
+    m_zeroOffset = m_descOffset + m_totalPages * sizeof(PageDesc);
+
+    Header header = Header();
+    memcpy(header.signature, DISKDUMP_SIGNATURE, sizeof header.signature);
+    header.header_version = DISKDUMP_HEADER_VERSION;
+    readUtsname(header);
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    header.tv_sec = now.tv_sec;
+    header.tv_usec = now.tv_usec;
+    header.status = m_compression;
+    header.block_size = bs;
+    header.sub_hdr_size = subBlocks;
+    header.bitmap_blocks = 2 * m_bitmapLength / bs;
+    header.max_mapnr = min<unsigned long long>(maxPfn, UINT32_MAX);
+    header.nr_cpus = cpus;
+
+    m_header.assign(m_bitmapOffset, 0);
+    memcpy(&m_header[0], &header, sizeof header);
+    memcpy(&m_header[DISKDUMP_HEADER_BLOCKS * bs], &sub, sizeof sub);
+    if (!notes.empty())
+        memcpy(&m_header[sub.offset_note], notes.data(), notes.size());
+
+    Debug::debug()->dbg("%llu of %llu pages in %zu extents, "
+                        "page descriptors at %s", m_totalPages, maxPfn,
+                        m_extents.size(),
+                        StringUtil::number2hex(m_descOffset).c_str());
+}
+
+// -----------------------------------------------------------------------------
+void DiskdumpDataProvider::planBatches()
+{
+    // no extent crosses a batch
+    std::vector<Extent> split;
+    std::vector<Extent>::const_iterator it;
+    for (it = m_extents.begin(); it != m_extents.end(); ++it) {
+        Extent ext = *it;
+        while (ext.pages) {
+            Extent part = ext;
+            part.pages = min<unsigned long long>(ext.pages,
+                                                 DISKDUMP_BATCH_PAGES);
+            split.push_back(part);
+            ext.pfn += part.pages;
+            ext.offset += part.pages * m_pageSize;
+            ext.pages -= part.pages;
+        }
+    }
+    m_extents.swap(split);
+
+    m_batches.clear();
+    Batch batch = Batch();
+    for (size_t i = 0; i < m_extents.size(); ++i) {
+        if (batch.pages + m_extents[i].pages > DISKDUMP_BATCH_PAGES) {
+            m_batches.push_back(batch);
+            batch.first = i;
+            batch.index += batch.pages;
+            batch.pages = 0;
+        }
+        batch.last = i + 1;
+        batch.pages += m_extents[i].pages;
+    }
+    if (batch.pages)
+        m_batches.push_back(batch);
+}
+
+// -----------------------------------------------------------------------------
+void DiskdumpDataProvider::prepare()
+{
+    Debug::debug()->trace("DiskdumpDataProvider::prepare, %u threads",
+                          m_threadCount);
+
+    buildHeader();
+    planBatches();
+    m_zeroPage.assign(m_pageSize, 0);
+
+    m_stage = STAGE_HEADER;
+    m_bitmapPos = 0;
+    m_current.data.reset();
+    m_current.length = 0;
+    m_piece = NULL;
+    m_pieceLength = m_pieceDone = 0;
+    m_dataPos = 0;
+    m_donePages = 0;
+    m_placed = m_flatStarted = m_flatEnd = false;
+    m_streamPos = 0;
+    m_recordPos = -1;
+    if (m_index)
+        m_index->reset(m_pageSize, m_descOffset);
+    m_prefix.clear();
+    m_prefixDone = 0;
+    m_next = m_consumed = 0;
+    m_ready.clear();
+    m_stop = false;
+    for (unsigned i = 0; i < m_threadCount; ++i)
+        m_threads.emplace_back(&DiskdumpDataProvider::run, this);
+
+    AbstractDataProvider::prepare();
+}
+
+// -----------------------------------------------------------------------------
+size_t DiskdumpDataProvider::compressPage(const char *page, char *out,
+                                          void *cctx) const
+{
+    // a page that does not get smaller is saved as it is
+    if (m_compression == DUMP_DH_COMPRESSED_ZLIB) {
+        uLongf len = m_pageSize;
+        if (compress2(reinterpret_cast<Bytef *>(out), &len,
+                      reinterpret_cast<const Bytef *>(page), m_pageSize,
+                      Z_BEST_SPEED) == Z_OK && len < m_pageSize)
+            return len;
+    }
+#if HAVE_ZSTD
+    else if (cctx) {
+        size_t len = ZSTD_compressCCtx(static_cast<ZSTD_CCtx *>(cctx), out,
+                                       m_pageSize, page, m_pageSize, 1);
+        if (!ZSTD_isError(len) && len < m_pageSize)
+            return len;
+    }
+#endif
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+void DiskdumpDataProvider::compressBatch(const Batch &batch, char *in,
+                                         Result &result, void *cctx)
+{
+    char *p = in;
+    for (size_t i = batch.first; i < batch.last; ++i) {
+        const Extent &ext = m_extents[i];
+        readAt(m_fd, p, ext.pages * m_pageSize, ext.offset,
+               m_filter.context().path());
+        p += ext.pages * m_pageSize;
+    }
+
+    // the offsets are relative to the batch, see nextPiece()
+    char *out = result.data.get();
+    size_t pos = 0;
+    result.descs.resize(batch.pages);
+    for (unsigned long long i = 0; i < batch.pages; ++i) {
+        const char *page = in + i * m_pageSize;
+        PageDesc &desc = result.descs[i];
+        desc.page_flags = 0;
+        if (isZero(page, m_pageSize)) {
+            desc.offset = -1;
+            desc.size = 0;
+            desc.flags = 0;
+            continue;
+        }
+
+        size_t len = compressPage(page, out + pos, cctx);
+        if (len)
+            desc.flags = m_compression;
+        else {
+            memcpy(out + pos, page, m_pageSize);
+            len = m_pageSize;
+            desc.flags = 0;
+        }
+        desc.offset = pos;
+        desc.size = len;
+        pos += len;
+    }
+    result.length = pos;
+}
+
+// -----------------------------------------------------------------------------
+void DiskdumpDataProvider::run()
+{
+    const size_t window = m_threadCount * DISKDUMP_BATCHES_PER_THREAD;
+    const size_t size = DISKDUMP_BATCH_PAGES * m_pageSize;
+
+    BufferPool::Buffer in;
+    void *cctx = NULL;
+#if HAVE_ZSTD
+    if (m_compression == DUMP_DH_COMPRESSED_ZSTD)
+        cctx = ZSTD_createCCtx();
+#endif
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_cond.wait(lock, [this, window]{
+                return m_stop || m_next >= m_batches.size() ||
+                    m_next < m_consumed + window;
+            });
+        if (m_stop || m_next >= m_batches.size())
+            break;
+
+        size_t index = m_next++;
+        Result result;
+        if (!m_free.empty()) {
+            result.data = std::move(m_free.back());
+            m_free.pop_back();
+        }
+        lock.unlock();
+
+        result.length = 0;
+        try {
+            if (!in)
+                in = BufferPool::pool()->get(size);
+            if (!result.data)
+                result.data = BufferPool::pool()->get(size);
+            compressBatch(m_batches[index], in.get(), result, cctx);
+        } catch (...) {
+            result.error = std::current_exception();
+        }
+
+        lock.lock();
+        m_ready[index] = std::move(result);
+        m_cond.notify_all();
+    }
+    lock.unlock();
+
+#if HAVE_ZSTD
+    ZSTD_freeCCtx(static_cast<ZSTD_CCtx *>(cctx));
+#endif
+}
+
+// -----------------------------------------------------------------------------
+bool DiskdumpDataProvider::nextPiece()
+{
+    m_pieceLength = m_pieceDone = 0;
+    while (true) {
+        switch (m_stage) {
+        case STAGE_HEADER:
+            m_piece = m_header.data();
+            m_pieceLength = m_header.size();
+            m_pieceOffset = 0;
+            m_stage = STAGE_BITMAP;
+            return true;
+
+        case STAGE_BITMAP: {
+            // the pages in the dump, then the pages that are saved
+            if (m_bitmapPos >= 2 * m_bitmapLength) {
+                m_stage = STAGE_ZERO;
+                break;
+            }
+            bool saved = m_bitmapPos >= m_bitmapLength;
+            size_t pos = m_bitmapPos - (saved ? m_bitmapLength : 0);
+            size_t len = min<size_t>(DISKDUMP_BATCH_PAGES * m_pageSize,
+                                     m_bitmapLength - pos);
+            m_bitmap.assign(len, 0);
+            setBits(m_bitmap.data(), len, 8ULL * pos,
+                    saved ? m_extents : m_valid);
+            m_piece = reinterpret_cast<const char *>(m_bitmap.data());
+            m_pieceLength = len;
+            m_pieceOffset = m_bitmapOffset + m_bitmapPos;
+            m_bitmapPos += len;
+            return true;
+        }
+
+        case STAGE_ZERO:
+            m_piece = m_zeroPage.data();
+            m_pieceLength = m_pageSize;
+            m_pieceOffset = m_zeroOffset;
+            m_dataPos = m_zeroOffset + m_pageSize;
+            m_stage = STAGE_DESC;
+            return true;
+
+        case STAGE_DESC: {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_current.data)
+                m_free.push_back(std::move(m_current.data));
+            m_current.length = 0;
+            if (m_consumed >= m_batches.size()) {
+                m_stage = STAGE_END;
+                return false;
+            }
+
+            m_cond.wait(lock, [this]{
+                    return m_ready.count(m_consumed) != 0;
+                });
+            std::map<size_t, Result>::iterator it = m_ready.find(m_consumed);
+            m_current = std::move(it->second);
+            m_ready.erase(it);
+            const Batch &batch = m_batches[m_consumed++];
+            m_cond.notify_all();
+            lock.unlock();
+
+            if (m_current.error) {
+                setError(true);
+                std::rethrow_exception(m_current.error);
+            }
+
+            std::vector<PageDesc>::iterator desc;
+            for (desc = m_current.descs.begin();
+                 desc != m_current.descs.end(); ++desc) {
+                if (desc->offset < 0) {
+                    desc->offset = m_zeroOffset;
+                    desc->size = m_pageSize;
+                } else
+                    desc->offset += m_dataPos;
+            }
+            if (m_index)
+                indexBatch(batch);
+            m_piece = reinterpret_cast<const char *>(m_current.descs.data());
+            m_pieceLength = m_current.descs.size() * sizeof(PageDesc);
+            m_pieceOffset = m_descOffset + batch.index * sizeof(PageDesc);
+            m_stage = STAGE_DATA;
+
+            m_donePages += batch.pages;
+            Progress *p = getProgress();
+            if (p)
+                p->progressed(m_donePages, m_totalPages);
+            return true;
+        }
+
+        case STAGE_DATA:
+            m_stage = STAGE_DESC;
+            if (!m_current.length)
+                break;
+            m_piece = m_current.data.get();
+            m_pieceLength = m_current.length;
+            m_pieceOffset = m_dataPos;
+            m_dataPos += m_current.length;
+            return true;
+
+        case STAGE_END:
+            return false;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+void DiskdumpDataProvider::indexBatch(const Batch &batch)
+{
+    // the page descriptors are final, see nextPiece()
+    unsigned state = 0;
+    std::vector<PageDesc>::const_iterator desc = m_current.descs.begin();
+    for (size_t i = batch.first; i < batch.last; ++i) {
+        const Extent &ext = m_extents[i];
+        for (unsigned long long pfn = ext.pfn; pfn < ext.pfn + ext.pages;
+             ++pfn, ++desc) {
+            if (desc->offset == m_zeroOffset) {
+                state |= PageIndex::STATE_ZERO;
+                m_index->addZero(pfn);
+            } else if (desc->flags & DUMP_DH_COMPRESSED_ZLIB)
+                state |= PageIndex::STATE_ZLIB;
+            else if (desc->flags & DUMP_DH_COMPRESSED_ZSTD)
+                state |= PageIndex::STATE_ZSTD;
+            else
+                state |= PageIndex::STATE_RAW;
+        }
+    }
+    m_index->addBatch(m_extents[batch.first].pfn, batch.index, m_recordPos,
+                      state);
+}
+
+// -----------------------------------------------------------------------------
+bool DiskdumpDataProvider::canPlaceData() const
+{
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+size_t DiskdumpDataProvider::getPlacedData(char *buffer, size_t maxread,
+                                           off_t *offset)
+{
+    m_placed = true;
+    while (m_pieceDone == m_pieceLength)
+        if (!nextPiece())
+            return 0;
+
+    size_t ret = min(maxread, m_pieceLength - m_pieceDone);
+    memcpy(buffer, m_piece + m_pieceDone, ret);
+    *offset = m_pieceOffset + m_pieceDone;
+    m_pieceDone += ret;
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+size_t DiskdumpDataProvider::getData(char *buffer, size_t maxread)
+{
+    while (true) {
+        if (m_prefixDone < m_prefix.size()) {
+            size_t ret = min(maxread, m_prefix.size() - m_prefixDone);
+            memcpy(buffer, &m_prefix[m_prefixDone], ret);
+            m_prefixDone += ret;
+            m_streamPos += ret;
+            return ret;
+        }
+        if (m_pieceDone < m_pieceLength) {
+            size_t ret = min(maxread, m_pieceLength - m_pieceDone);
+            memcpy(buffer, m_piece + m_pieceDone, ret);
+            m_pieceDone += ret;
+            m_streamPos += ret;
+            return ret;
+        }
+        if (m_flatEnd)
+            return 0;
+
+        m_prefixDone = 0;
+        if (!m_flatStarted) {
+            m_prefix.assign(FLAT_HEADER_SIZE, 0);
+            memcpy(&m_prefix[0], FLAT_SIGNATURE, sizeof FLAT_SIGNATURE);
+            putBE64(&m_prefix[16], FLAT_TYPE);
+            putBE64(&m_prefix[24], FLAT_VERSION);
+            m_flatStarted = true;
+            continue;
+        }
+
+        m_prefix.assign(FLAT_RECORD_SIZE, 0);
+        m_recordPos = m_streamPos;
+        if (nextPiece()) {
+            putBE64(&m_prefix[0], m_pieceOffset);
+            putBE64(&m_prefix[8], m_pieceLength);
+        } else {
+            putBE64(&m_prefix[0], FLAT_END_FLAG);
+            putBE64(&m_prefix[8], FLAT_END_FLAG);
+            m_flatEnd = true;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+void DiskdumpDataProvider::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+
+    std::vector<std::thread>::iterator it;
+    for (it = m_threads.begin(); it != m_threads.end(); ++it)
+        it->join();
+    m_threads.clear();
+    m_ready.clear();
+}
+
+// -----------------------------------------------------------------------------
+void DiskdumpDataProvider::finish()
+{
+    Debug::debug()->trace("DiskdumpDataProvider::finish");
+
+    stop();
+    AbstractDataProvider::finish();
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
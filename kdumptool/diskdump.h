@@ -0,0 +1,316 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#ifndef DISKDUMP_H
+#define DISKDUMP_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <thread>
+#include <exception>
+#include <condition_variable>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "global.h"
+#include "dataprovider.h"
+#include "bufferpool.h"
+#include "fileutil.h"
+#include "pagefilter.h"
+#include "pageindex.h"
+
+// see makedumpfile/diskdump_mod.h
+#define DISKDUMP_SIGNATURE          "KDUMP   "
+#define DISKDUMP_HEADER_VERSION     6
+
+// compression of a page (page_desc_t.flags and disk_dump_header.status)
+#define DUMP_DH_COMPRESSED_ZLIB     0x1
+#define DUMP_DH_COMPRESSED_ZSTD     0x20
+
+//{{{ DiskdumpDataProvider -----------------------------------------------------
+
+/**
+ * DataProvider for a dump in the kdump-compressed format of
+ * makedumpfile (-c and -z), made from the pages that a PageFilter keeps.
+ *
+ * The file starts with the headers, the notes and two bitmaps (the
+ * pages in the dump and the pages that are saved, one bit per page
+ * frame), followed by one page descriptor per saved page and the page
+ * data. Pages filled with zeros share one copy of a zero page. Worker
+ * threads read and compress batches of pages into buffers from the
+ * BufferPool; the consumer hands each batch out as its page
+ * descriptors and its data.
+ *
+ * DataProvider::getPlacedData() returns the pieces with their offsets
+ * in the dump file. DataProvider::getData() returns the same pieces in
+ * the makedumpfile flattened format, for targets that can only write
+ * sequentially.
+ */
+class DiskdumpDataProvider : public AbstractDataProvider {
+
+    public:
+        /**
+         * disk_dump_header
+         */
+        struct Header {
+            char signature[8];
+            int32_t header_version;
+            char utsname[6][65];
+            int64_t tv_sec;
+            int64_t tv_usec;
+            uint32_t status;
+            int32_t block_size;
+            int32_t sub_hdr_size;       // blocks
+            uint32_t bitmap_blocks;
+            uint32_t max_mapnr;         // obsolete
+            uint32_t total_ram_blocks;
+            uint32_t device_blocks;
+            uint32_t written_blocks;
+            uint32_t current_cpu;
+            int32_t nr_cpus;
+        };
+
+        /**
+         * kdump_sub_header (64-bit)
+         */
+        struct SubHeader {
+            uint64_t phys_base;
+            int32_t dump_level;
+            int32_t split;
+            uint64_t start_pfn;         // obsolete
+            uint64_t end_pfn;           // obsolete
+            int64_t offset_vmcoreinfo;
+            uint64_t size_vmcoreinfo;
+            int64_t offset_note;
+            uint64_t size_note;
+            int64_t offset_eraseinfo;
+            uint64_t size_eraseinfo;
+            uint64_t start_pfn_64;
+            uint64_t end_pfn_64;
+            uint64_t max_mapnr_64;
+        };
+
+        /**
+         * page_desc_t
+         */
+        struct PageDesc {
+            int64_t offset;
+            uint32_t size;
+            uint32_t flags;
+            uint64_t page_flags;
+        };
+
+        /**
+         * Pages at consecutive page frames and file offsets.
+         */
+        struct Extent {
+            unsigned long long pfn;
+            unsigned long long pages;
+            loff_t offset;              // in the ELF dump
+        };
+
+        /**
+         * Creates the provider. The PageFilter must have classified the
+         * pages (see PageFilter::run()), unless only zero pages are
+         * excluded.
+         *
+         * @param[in] filter the pages that are kept
+         * @param[in] compression DUMP_DH_COMPRESSED_ZLIB or
+         *            DUMP_DH_COMPRESSED_ZSTD
+         * @param[in] threads number of compression threads
+         * @param[in] nodename the host name, used only if the utsname
+         *            of the crashed kernel cannot be read
+         */
+        DiskdumpDataProvider(const PageFilter &filter, unsigned compression,
+                             unsigned threads, const std::string &nodename);
+
+        /**
+         * Stops the threads.
+         */
+        ~DiskdumpDataProvider();
+
+        /**
+         * Builds the headers and starts the threads.
+         *
+         * @see DataProvider::prepare()
+         * @exception KError if the dump cannot be read
+         */
+        void prepare();
+
+        /**
+         * Returns the dump in flattened format.
+         *
+         * @see DataProvider::getData()
+         */
+        size_t getData(char *buffer, size_t maxread);
+
+        /**
+         * Returns @c true.
+         *
+         * @see DataProvider::canPlaceData()
+         */
+        bool canPlaceData() const;
+
+        /**
+         * Returns the next piece of the dump file.
+         *
+         * @see DataProvider::getPlacedData()
+         */
+        size_t getPlacedData(char *buffer, size_t maxread, off_t *offset);
+
+        /**
+         * Stops the threads.
+         *
+         * @see DataProvider::finish()
+         */
+        void finish();
+
+        /**
+         * Returns @c true if the data has been placed, i.e. the target
+         * is not in flattened format.
+         */
+        bool placed() const
+        { return m_placed; }
+
+        /**
+         * Fills @p index while the dump is read. The index is reset by
+         * prepare() and complete when all data has been read.
+         *
+         * @param[in] index the index, or @c NULL
+         */
+        void setIndex(PageIndex *index)
+        { m_index = index; }
+
+        /**
+         * Checks whether pages can be compressed with @p compression in
+         * this build.
+         */
+        static bool supported(unsigned compression);
+
+        /**
+         * Sorts @p extents by page frame number and removes the pages
+         * that are already in an earlier extent (the kernel image is in
+         * two PT_LOAD segments on some architectures).
+         *
+         * @param[in,out] extents the extents
+         * @param[in] pagesize the page size
+         */
+        static void mergeExtents(std::vector<Extent> &extents,
+                                 unsigned long pagesize);
+
+        /**
+         * Sets the bits of the pages in @p extents in a part of a bitmap
+         * of the dump file. Bit n of byte m is page frame 8 * m + n.
+         *
+         * @param[out] bitmap @p len bytes, cleared by the caller
+         * @param[in] len the size of @p bitmap
+         * @param[in] first the page frame of bit 0 of @p bitmap, a
+         *            multiple of 8
+         * @param[in] extents sorted extents that do not overlap
+         */
+        static void setBits(unsigned char *bitmap, size_t len,
+                            unsigned long long first,
+                            const std::vector<Extent> &extents);
+
+    private:
+        struct Batch {
+            size_t first, last;         // extents
+            unsigned long long index;   // of the first page descriptor
+            unsigned long long pages;
+        };
+
+        struct Result {
+            BufferPool::Buffer data;
+            size_t length;
+            std::vector<PageDesc> descs;
+            std::exception_ptr error;
+        };
+
+        void buildHeader();
+        void readNotes(std::vector<char> &notes, SubHeader &sub,
+                       int32_t *cpus);
+        void readUtsname(Header &header);
+        void planBatches();
+        void run();
+        void compressBatch(const Batch &batch, char *in, Result &result,
+                           void *cctx);
+        size_t compressPage(const char *page, char *out, void *cctx) const;
+        bool nextPiece();
+        void indexBatch(const Batch &batch);
+        void stop();
+
+        const PageFilter &m_filter;
+        unsigned m_compression;
+        unsigned m_threadCount;
+        std::string m_nodename;
+        FileDescriptor m_fd;
+        unsigned long m_pageSize;
+
+        std::vector<char> m_header;     // up to the bitmaps
+        std::vector<char> m_zeroPage;
+        std::vector<Extent> m_valid;    // pages in the dump
+        std::vector<Extent> m_extents;  // pages that are saved
+        std::vector<Batch> m_batches;
+        unsigned long long m_totalPages;
+        loff_t m_bitmapOffset;
+        size_t m_bitmapLength;          // of each bitmap
+        loff_t m_descOffset;
+        loff_t m_zeroOffset;
+
+        // accessed by the consumer only
+        enum {
+            STAGE_HEADER, STAGE_BITMAP, STAGE_ZERO, STAGE_DESC, STAGE_DATA,
+            STAGE_END
+        } m_stage;
+        size_t m_bitmapPos;
+        std::vector<unsigned char> m_bitmap;
+        Result m_current;
+        const char *m_piece;
+        size_t m_pieceLength;
+        size_t m_pieceDone;
+        loff_t m_pieceOffset;
+        loff_t m_dataPos;
+        unsigned long long m_donePages;
+        bool m_placed;
+        PageIndex *m_index;
+        off_t m_streamPos;      // of the flattened data returned so far
+        off_t m_recordPos;      // of the record of the current piece
+
+        // flattened format: the file header or the header of a record
+        bool m_flatStarted;
+        bool m_flatEnd;
+        std::vector<unsigned char> m_prefix;
+        size_t m_prefixDone;
+
+        // shared with the worker threads
+        size_t m_next;          // next batch to compress
+        size_t m_consumed;      // next batch to hand out
+        std::map<size_t, Result> m_ready;
+        std::vector<BufferPool::Buffer> m_free;
+        bool m_stop;
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::vector<std::thread> m_threads;
+};
+
+//}}}
+
+#endif /* DISKDUMP_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
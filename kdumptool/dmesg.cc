@@ -0,0 +1,490 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+#include <vector>
+#include <stdint.h>
+
+#include <elf.h>
+#include <endian.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "global.h"
+#include "debug.h"
+#include "progress.h"
+#include "stringutil.h"
+#include "fileutil.h"
+#include "vmcoreinfo.h"
+#include "vmcorecontext.h"
+#include "dmesg.h"
+
+using std::string;
+using std::vector;
+
+// descriptor states of the lockless ring buffer (kernel/printk/printk_ringbuffer.h)
+#define DESC_COMMITTED		1
+#define DESC_FINALIZED		2
+
+// upper limit for the ring buffer sizes, to catch garbage in the dump
+#define DMESG_MAX_BITS		30
+
+//{{{ KernelMemory -------------------------------------------------------------
+
+/**
+ * Reads the memory of the crashed kernel at virtual addresses, using the
+ * PT_LOAD program headers of an ELF dump.
+ */
+class KernelMemory {
+
+    public:
+        KernelMemory(const VmcoreContext &ctx);
+
+        unsigned pointerSize() const
+        { return m_ctx.pointerSize(); }
+
+        void read(unsigned long long addr, void *buffer, size_t length);
+        unsigned long long readLong(unsigned long long addr);
+        uint32_t readU32(unsigned long long addr);
+
+        /**
+         * Converts a kernel "long" (the size of a pointer) in a buffer.
+         */
+        unsigned long long toLong(const char *p) const;
+
+    private:
+        const VmcoreContext &m_ctx;
+        const string &m_dump;
+        FileDescriptor m_fd;
+};
+
+// -----------------------------------------------------------------------------
+KernelMemory::KernelMemory(const VmcoreContext &ctx)
+    : m_ctx(ctx), m_dump(ctx.path()), m_fd(ctx.path(), O_RDONLY | O_CLOEXEC)
+{
+    if (!ctx.isElf())
+        throw KError(m_dump + " is not an ELF file.");
+    if (ctx.segments().empty())
+        throw KError(m_dump + " has no usable PT_LOAD segments.");
+}
+
+// -----------------------------------------------------------------------------
+void KernelMemory::read(unsigned long long addr, void *buffer, size_t length)
+{
+    char *p = static_cast<char *>(buffer);
+
+    while (length) {
+        const vector<VmcoreContext::Segment> &segments = m_ctx.segments();
+        vector<VmcoreContext::Segment>::const_iterator it;
+        for (it = segments.begin(); it != segments.end(); ++it)
+            if (addr >= it->vaddr && addr - it->vaddr < it->filesz)
+                break;
+        if (it == segments.end())
+            throw KError("Address " + StringUtil::number2hex(addr) +
+                         " is not in " + m_dump + ".");
+
+        size_t chunk = std::min<unsigned long long>(length,
+                                                    it->vaddr + it->filesz - addr);
+        off_t offset = it->offset + (addr - it->vaddr);
+        ssize_t ret = pread(m_fd, p, chunk, offset);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret < 0)
+            throw KSystemError("Error reading from " + m_dump + " at " +
+                               StringUtil::number2hex(offset), errno);
+        if (ret == 0)
+            throw KError("Unexpected end of " + m_dump + ".");
+
+        p += ret;
+        addr += ret;
+        length -= ret;
+    }
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long KernelMemory::toLong(const char *p) const
+{
+    if (pointerSize() == 4) {
+        uint32_t val;
+        memcpy(&val, p, sizeof val);
+        return val;
+    } else {
+        uint64_t val;
+        memcpy(&val, p, sizeof val);
+        return val;
+    }
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long KernelMemory::readLong(unsigned long long addr)
+{
+    char buf[8];
+    read(addr, buf, pointerSize());
+    return toLong(buf);
+}
+
+// -----------------------------------------------------------------------------
+uint32_t KernelMemory::readU32(unsigned long long addr)
+{
+    uint32_t val;
+    read(addr, &val, sizeof val);
+    return val;
+}
+
+//}}}
+//{{{ Helpers ------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+static bool hasKey(const Vmcoreinfo &vm, const string &key)
+{
+    try {
+        vm.getStringValue(key.c_str());
+        return true;
+    } catch (const KError &) {
+        return false;
+    }
+}
+
+// -----------------------------------------------------------------------------
+static unsigned long long symbol(const Vmcoreinfo &vm, const char *name)
+{
+    string key = string("SYMBOL(") + name + ")";
+    return strtoull(vm.getStringValue(key.c_str()).c_str(), NULL, 16);
+}
+
+// -----------------------------------------------------------------------------
+static size_t offsetOf(const Vmcoreinfo &vm, const string &member)
+{
+    string key = "OFFSET(" + member + ")";
+    return strtoul(vm.getStringValue(key.c_str()).c_str(), NULL, 10);
+}
+
+// -----------------------------------------------------------------------------
+static size_t sizeOf(const Vmcoreinfo &vm, const string &type)
+{
+    string key = "SIZE(" + type + ")";
+    return strtoul(vm.getStringValue(key.c_str()).c_str(), NULL, 10);
+}
+
+// -----------------------------------------------------------------------------
+template<typename T>
+static T getValue(const char *p)
+{
+    T val;
+    memcpy(&val, p, sizeof val);
+    return val;
+}
+
+// -----------------------------------------------------------------------------
+static void checkLayout(size_t offset, size_t length, size_t size,
+                        const char *type)
+{
+    if (offset + length > size)
+        throw KError(string("Unexpected layout of struct ") + type + ".");
+}
+
+// -----------------------------------------------------------------------------
+static void appendRecord(string &out, unsigned long long ts_nsec,
+                         const char *text, size_t length)
+{
+    char buf[64];
+
+    snprintf(buf, sizeof buf, "[%5llu.%06llu] ",
+             ts_nsec / 1000000000ULL, ts_nsec % 1000000000ULL / 1000);
+    out += buf;
+
+    // same escaping as makedumpfile --dump-dmesg
+    for (size_t i = 0; i < length; ++i) {
+        unsigned char c = text[i];
+        if (c == '\n')
+            out += '.';
+        else if (isprint(c) || isspace(c))
+            out += c;
+        else {
+            snprintf(buf, sizeof buf, "\\x%02x", c);
+            out += buf;
+        }
+    }
+    out += '\n';
+}
+
+//}}}
+//{{{ Lockless ring buffer -----------------------------------------------------
+
+// -----------------------------------------------------------------------------
+static void readLockless(KernelMemory &mem, const Vmcoreinfo &vm, string &out)
+{
+    const unsigned ptrSize = mem.pointerSize();
+    const size_t counter = hasKey(vm, "OFFSET(atomic_long_t.counter)")
+        ? offsetOf(vm, "atomic_long_t.counter")
+        : 0;
+
+    unsigned long long prb = mem.readLong(symbol(vm, "prb"));
+    unsigned long long descRing =
+        prb + offsetOf(vm, "printk_ringbuffer.desc_ring");
+    unsigned long long textRing =
+        prb + offsetOf(vm, "printk_ringbuffer.text_data_ring");
+
+    unsigned countBits =
+        mem.readU32(descRing + offsetOf(vm, "prb_desc_ring.count_bits"));
+    unsigned long long descs =
+        mem.readLong(descRing + offsetOf(vm, "prb_desc_ring.descs"));
+    unsigned long long infos =
+        mem.readLong(descRing + offsetOf(vm, "prb_desc_ring.infos"));
+    unsigned long long headId =
+        mem.readLong(descRing + offsetOf(vm, "prb_desc_ring.head_id") + counter);
+    unsigned long long tailId =
+        mem.readLong(descRing + offsetOf(vm, "prb_desc_ring.tail_id") + counter);
+    unsigned sizeBits =
+        mem.readU32(textRing + offsetOf(vm, "prb_data_ring.size_bits"));
+    unsigned long long data =
+        mem.readLong(textRing + offsetOf(vm, "prb_data_ring.data"));
+
+    if (countBits > DMESG_MAX_BITS || sizeBits > DMESG_MAX_BITS)
+        throw KError("Invalid size of the printk ring buffer.");
+
+    const size_t descCount = size_t(1) << countBits;
+    const size_t dataSize = size_t(1) << sizeBits;
+    const size_t descSize = sizeOf(vm, "prb_desc");
+    const size_t infoSize = sizeOf(vm, "printk_info");
+
+    const size_t svOff = offsetOf(vm, "prb_desc.state_var") + counter;
+    const size_t lposOff = offsetOf(vm, "prb_desc.text_blk_lpos");
+    const size_t beginOff = lposOff + offsetOf(vm, "prb_data_blk_lpos.begin");
+    const size_t nextOff = lposOff + offsetOf(vm, "prb_data_blk_lpos.next");
+    const size_t tsOff = offsetOf(vm, "printk_info.ts_nsec");
+    const size_t lenOff = offsetOf(vm, "printk_info.text_len");
+    checkLayout(svOff, ptrSize, descSize, "prb_desc");
+    checkLayout(beginOff, ptrSize, descSize, "prb_desc");
+    checkLayout(nextOff, ptrSize, descSize, "prb_desc");
+    checkLayout(tsOff, sizeof(uint64_t), infoSize, "printk_info");
+    checkLayout(lenOff, sizeof(uint16_t), infoSize, "printk_info");
+
+    // the whole buffer is a few MiB at most, so read it in one go
+    vector<char> descBuf(descCount * descSize);
+    vector<char> infoBuf(descCount * infoSize);
+    vector<char> dataBuf(dataSize);
+    mem.read(descs, descBuf.data(), descBuf.size());
+    mem.read(infos, infoBuf.data(), infoBuf.size());
+    mem.read(data, dataBuf.data(), dataBuf.size());
+
+    // the two top bits of the state variable hold the state, the rest
+    // is the descriptor ID; logical positions wrap at the size of a long
+    const unsigned bits = ptrSize * 8;
+    const unsigned long long longMask = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+    const unsigned long long idMask = longMask >> 2;
+
+    headId &= idMask;
+    unsigned long long id = tailId & idMask;
+    for (size_t n = 0; n < descCount; ++n, id = (id + 1) & idMask) {
+        size_t idx = id & (descCount - 1);
+        const char *desc = &descBuf[idx * descSize];
+        const char *info = &infoBuf[idx * infoSize];
+
+        unsigned long long sv = mem.toLong(desc + svOff);
+        unsigned state = (sv >> (bits - 2)) & 3;
+        if ((sv & idMask) == id &&
+            (state == DESC_COMMITTED || state == DESC_FINALIZED)) {
+            unsigned long long begin = mem.toLong(desc + beginOff);
+            unsigned long long next = mem.toLong(desc + nextOff);
+            size_t textLen = getValue<uint16_t>(info + lenOff);
+            uint64_t ts = getValue<uint64_t>(info + tsOff);
+
+            if ((begin & 1) && (next & 1)) {
+                // data-less record
+                appendRecord(out, ts, "", 0);
+            } else {
+                size_t offset, length;
+                bool valid = true;
+                if ((begin >> sizeBits) == (next >> sizeBits) && begin < next) {
+                    offset = begin & (dataSize - 1);
+                    length = next - begin;
+                } else if ((((begin + dataSize) & longMask) >> sizeBits) ==
+                           (next >> sizeBits)) {
+                    // the block wraps to the start of the data ring
+                    offset = 0;
+                    length = next & (dataSize - 1);
+                } else
+                    valid = false;
+
+                // each data block starts with the descriptor ID
+                if (valid && length >= ptrSize && offset + length <= dataSize)
+                    appendRecord(out, ts, &dataBuf[offset + ptrSize],
+                                 std::min(textLen, length - ptrSize));
+            }
+        }
+
+        if (id == headId)
+            break;
+    }
+}
+
+//}}}
+//{{{ Structured log buffer ----------------------------------------------------
+
+// -----------------------------------------------------------------------------
+static void readStructured(KernelMemory &mem, const Vmcoreinfo &vm,
+                           string &out)
+{
+    // the structure was called "log" before Linux 3.11
+    const string type = hasKey(vm, "SIZE(printk_log)") ? "printk_log" : "log";
+
+    unsigned long long buf = mem.readLong(symbol(vm, "log_buf"));
+    uint32_t bufLen = mem.readU32(symbol(vm, "log_buf_len"));
+    uint32_t first = mem.readU32(symbol(vm, "log_first_idx"));
+    uint32_t next = mem.readU32(symbol(vm, "log_next_idx"));
+
+    const size_t hdrSize = sizeOf(vm, type);
+    const size_t tsOff = offsetOf(vm, type + ".ts_nsec");
+    const size_t lenOff = offsetOf(vm, type + ".len");
+    const size_t textLenOff = offsetOf(vm, type + ".text_len");
+    checkLayout(tsOff, sizeof(uint64_t), hdrSize, type.c_str());
+    checkLayout(lenOff, sizeof(uint16_t), hdrSize, type.c_str());
+    checkLayout(textLenOff, sizeof(uint16_t), hdrSize, type.c_str());
+
+    if (bufLen == 0 || bufLen > (1U << DMESG_MAX_BITS))
+        throw KError("Invalid size of the kernel log buffer.");
+
+    vector<char> logBuf(bufLen);
+    mem.read(buf, logBuf.data(), logBuf.size());
+
+    uint32_t idx = first;
+    for (size_t n = 0; idx != next && n < bufLen; ++n) {
+        if (idx + hdrSize > bufLen)
+            throw KError("Corrupted kernel log buffer.");
+
+        const char *rec = &logBuf[idx];
+        size_t len = getValue<uint16_t>(rec + lenOff);
+        if (len == 0) {
+            // an empty header marks the wrap-around
+            idx = 0;
+            continue;
+        }
+
+        size_t textLen = getValue<uint16_t>(rec + textLenOff);
+        if (idx + len > bufLen || hdrSize + textLen > len)
+            throw KError("Corrupted kernel log buffer.");
+
+        appendRecord(out, getValue<uint64_t>(rec + tsOff),
+                     rec + hdrSize, textLen);
+        idx += len;
+    }
+}
+
+//}}}
+//{{{ DmesgDataProvider --------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+DmesgDataProvider::DmesgDataProvider(const char *dump)
+    : m_dump(dump), m_started(false), m_done(false), m_pos(0)
+{}
+
+// -----------------------------------------------------------------------------
+DmesgDataProvider::~DmesgDataProvider()
+{
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+// -----------------------------------------------------------------------------
+void DmesgDataProvider::start()
+{
+    m_started = true;
+    m_thread = std::thread(&DmesgDataProvider::run, this);
+}
+
+// -----------------------------------------------------------------------------
+bool DmesgDataProvider::wait()
+{
+    if (!m_started) {
+        m_started = true;
+        run();
+    } else if (m_thread.joinable())
+        m_thread.join();
+    else
+        return m_done;
+
+    if (m_done)
+        Debug::debug()->dbg("Extracted %zu bytes of kernel log from %s",
+                            m_text.size(), m_dump.c_str());
+    else
+        Debug::debug()->dbg("Cannot extract the kernel log from %s: %s",
+                            m_dump.c_str(), m_error.c_str());
+    return m_done;
+}
+
+// -----------------------------------------------------------------------------
+void DmesgDataProvider::run()
+{
+    try {
+        std::shared_ptr<const VmcoreContext> ctx = VmcoreContext::get(m_dump);
+        const Vmcoreinfo &vm = ctx->vmcoreinfo();
+        if (vm.isXenVmcoreinfo())
+            throw KError("The kernel log of Xen dumps is not supported.");
+
+        KernelMemory mem(*ctx);
+        string text;
+        if (hasKey(vm, "SYMBOL(prb)"))
+            readLockless(mem, vm, text);
+        else if (hasKey(vm, "SYMBOL(log_buf)"))
+            readStructured(mem, vm, text);
+        else
+            throw KError("VMCOREINFO does not describe the kernel log.");
+
+        if (text.empty())
+            throw KError("The kernel log is empty.");
+        m_text.swap(text);
+        m_done = true;
+    } catch (const std::exception &ex) {
+        m_error = ex.what();
+    }
+}
+
+// -----------------------------------------------------------------------------
+void DmesgDataProvider::prepare()
+{
+    Debug::debug()->trace("DmesgDataProvider::prepare");
+
+    if (!wait())
+        throw KError("Cannot extract the kernel log: " + m_error);
+
+    m_pos = 0;
+    AbstractDataProvider::prepare();
+}
+
+// -----------------------------------------------------------------------------
+size_t DmesgDataProvider::getData(char *buffer, size_t maxread)
+{
+    size_t len = std::min(maxread, m_text.size() - m_pos);
+    memcpy(buffer, m_text.data() + m_pos, len);
+    m_pos += len;
+
+    Progress *p = getProgress();
+    if (p)
+        p->progressed(m_pos, m_text.size());
+
+    return len;
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
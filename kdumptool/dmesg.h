@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef DMESG_H
+#define DMESG_H
+
+#include <string>
+#include <thread>
+
+#include "global.h"
+#include "dataprovider.h"
+
+//{{{ DmesgDataProvider --------------------------------------------------------
+
+/**
+ * DataProvider for the kernel log of a crashed kernel.
+ *
+ * The log is read directly from an ELF dump (like /proc/vmcore): the
+ * VMCOREINFO note gives the address of the printk ring buffer and the
+ * layout of its structures, and the kernel virtual addresses are
+ * translated with the PT_LOAD program headers. Both the lockless ring
+ * buffer (Linux 5.10 and later) and the older structured log buffer are
+ * supported. The lines are formatted like makedumpfile --dump-dmesg.
+ *
+ * start() extracts the log in a separate thread, so that it overlaps
+ * with other work. prepare() waits for the result.
+ */
+class DmesgDataProvider : public AbstractDataProvider {
+
+    public:
+
+        /**
+         * Creates a new DmesgDataProvider object.
+         *
+         * @param[in] dump the ELF dump file
+         */
+        DmesgDataProvider(const char *dump);
+
+        /**
+         * Waits for the extraction thread.
+         */
+        ~DmesgDataProvider();
+
+        /**
+         * Starts the extraction in a new thread.
+         */
+        void start();
+
+        /**
+         * Waits for the extraction. If start() has not been called,
+         * the log is extracted in the calling thread.
+         *
+         * @return @c true if the log has been extracted, @c false if
+         *         the dump does not provide it (see error())
+         */
+        bool wait();
+
+        /**
+         * Returns the reason why the extraction failed.
+         */
+        const std::string &error() const
+        { return m_error; }
+
+        /**
+         * Returns the extracted log.
+         */
+        const std::string &text() const
+        { return m_text; }
+
+        /**
+         * Waits for the extraction.
+         *
+         * @exception KError if the log cannot be extracted
+         * @see DataProvider::prepare()
+         */
+        void prepare();
+
+        /**
+         * Provides the formatted log.
+         *
+         * @see DataProvider::getData()
+         */
+        size_t getData(char *buffer, size_t maxread);
+
+    private:
+        void run();
+
+        std::string m_dump;
+        std::string m_text;
+        std::string m_error;
+        bool m_started;
+        bool m_done;
+        size_t m_pos;
+        std::thread m_thread;
+};
+
+//}}}
+
+#endif /* DMESG_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
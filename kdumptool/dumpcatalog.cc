@@ -0,0 +1,424 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <string>
+#include <sstream>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+#include "global.h"
+#include "debug.h"
+#include "fileutil.h"
+#include "stringutil.h"
+#include "deletedumps.h"
+#include "dumpcatalog.h"
+
+using std::string;
+
+#define CATALOG_MAGIC       "KDUMP-CATALOG 1"
+
+// obsolete records that are tolerated before the catalog is rewritten
+#define CATALOG_SLACK       64
+
+// how long settle() waits for the next time stamp, in milliseconds
+#define CATALOG_SETTLE_MS   50
+
+//{{{ DumpCatalog --------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+static bool newer(const struct timespec &a, const struct timespec &b)
+{
+    return a.tv_sec > b.tv_sec ||
+        (a.tv_sec == b.tv_sec && a.tv_nsec > b.tv_nsec);
+}
+
+// -----------------------------------------------------------------------------
+static void writeAll(int fd, const string &data, const string &file)
+{
+    const char *p = data.data();
+    size_t left = data.size();
+    while (left) {
+        ssize_t n = write(fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw KSystemError("Cannot write " + file + ".", errno);
+        }
+        p += n;
+        left -= n;
+    }
+}
+
+// -----------------------------------------------------------------------------
+static string record(const DumpCatalog::Entry &entry)
+{
+    std::ostringstream ss;
+    ss << "dump " << entry.name << ' ' << entry.crashTime << ' '
+       << entry.size << ' ' << entry.format << ' ' << entry.parts << ' '
+       << entry.checksum << ' ' << entry.status;
+    return ss.str();
+}
+
+// -----------------------------------------------------------------------------
+static long long dumpTime(const FilePath &dir, const string &name)
+{
+    // the directory is named after the crash time
+    struct tm tm;
+    memset(&tm, 0, sizeof tm);
+    const char *end = strptime(name.c_str(), ISO_DATETIME, &tm);
+    if (end && *end == '\0') {
+        tm.tm_isdst = -1;
+        return mktime(&tm);
+    }
+
+    FilePath path = dir;
+    path.appendPath(name);
+    struct stat mystat;
+    if (stat(path.c_str(), &mystat) != 0)
+        throw KSystemError("stat() on " + path + " failed.", errno);
+    return mystat.st_mtime;
+}
+
+// -----------------------------------------------------------------------------
+DumpCatalog::DumpCatalog(const FilePath &dir)
+    : m_dir(dir), m_file(dir), m_exists(false), m_current(false),
+      m_dirty(false), m_inode(0), m_offset(0), m_records(0)
+{
+    m_file.appendPath(DUMP_CATALOG_FILE);
+
+    int fd = open(m_file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno != ENOENT)
+            Debug::debug()->dbg("Cannot open %s: %s", m_file.c_str(),
+                                strerror(errno));
+        return;
+    }
+
+    struct stat filestat, dirstat;
+    try {
+        if (fstat(fd, &filestat) != 0)
+            throw KSystemError("Cannot stat " + m_file + ".", errno);
+        m_inode = filestat.st_ino;
+        m_exists = apply(fd, 0);
+    } catch (const KError &error) {
+        Debug::debug()->dbg("%s", error.what());
+    }
+    close(fd);
+    if (!m_exists) {
+        Debug::debug()->dbg("Ignoring invalid %s", m_file.c_str());
+        m_entries.clear();
+        return;
+    }
+
+    // every change of the directory by kdumptool is followed by a record
+    m_current = stat(m_dir.c_str(), &dirstat) == 0 &&
+        newer(filestat.st_mtim, dirstat.st_mtim);
+    Debug::debug()->dbg("Loaded %zu dumps from %s%s", m_entries.size(),
+                        m_file.c_str(), m_current ? "" : " (outdated)");
+}
+
+// -----------------------------------------------------------------------------
+DumpCatalog::~DumpCatalog()
+{}
+
+// -----------------------------------------------------------------------------
+bool DumpCatalog::parse(const string &line)
+{
+    std::istringstream iss(line);
+    string key;
+    iss >> key;
+    if (key == "dump") {
+        Entry entry;
+        if (!(iss >> entry.name >> entry.crashTime >> entry.size
+              >> entry.format >> entry.parts >> entry.checksum
+              >> entry.status))
+            return false;
+        m_entries[entry.name] = entry;
+    } else if (key == "delete") {
+        string name;
+        if (!(iss >> name))
+            return false;
+        m_entries.erase(name);
+    } else
+        return false;
+
+    ++m_records;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+bool DumpCatalog::apply(int fd, off_t offset)
+{
+    string data;
+    char buf[BUFSIZ];
+    ssize_t n;
+    while ((n = pread(fd, buf, sizeof buf, offset + data.size())) != 0) {
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw KSystemError("Cannot read " + m_file + ".", errno);
+        }
+        data.append(buf, n);
+    }
+
+    // a record without its newline has been torn by a crash
+    string::size_type pos = 0, eol;
+    while ((eol = data.find('\n', pos)) != string::npos) {
+        string line(data, pos, eol - pos);
+        if (offset == 0 && pos == 0) {
+            if (line != CATALOG_MAGIC)
+                return false;
+        } else if (!parse(line))
+            Debug::debug()->dbg("Ignoring record \"%s\" in %s",
+                                line.c_str(), m_file.c_str());
+        pos = eol + 1;
+    }
+    m_offset = offset + pos;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+int DumpCatalog::openLocked(const FilePath &file)
+{
+    for (;;) {
+        int fd = open(file.c_str(), O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC,
+                      0644);
+        if (fd < 0)
+            throw KSystemError("Cannot open " + file + ".", errno);
+        if (flock(fd, LOCK_EX) != 0) {
+            int err = errno;
+            close(fd);
+            throw KSystemError("Cannot lock " + file + ".", err);
+        }
+
+        // save() may have replaced the file while we were waiting
+        struct stat fdstat, pathstat;
+        if (fstat(fd, &fdstat) == 0 && stat(file.c_str(), &pathstat) == 0 &&
+            fdstat.st_dev == pathstat.st_dev &&
+            fdstat.st_ino == pathstat.st_ino)
+            return fd;
+        close(fd);
+    }
+}
+
+// -----------------------------------------------------------------------------
+void DumpCatalog::append(const string &line)
+{
+    int fd = openLocked(m_file);
+    try {
+        // one write, so that readers see the whole record or nothing
+        string data = line + '\n';
+        struct stat mystat;
+        if (fstat(fd, &mystat) != 0)
+            throw KSystemError("Cannot stat " + m_file + ".", errno);
+        char last = '\n';
+        if (mystat.st_size == 0)
+            data = CATALOG_MAGIC "\n" + data;
+        else if (pread(fd, &last, 1, mystat.st_size - 1) == 1 &&
+                 last != '\n')
+            data = '\n' + data;    // terminate a torn record
+        writeAll(fd, data, m_file);
+        if (fdatasync(fd) != 0)
+            throw KSystemError("Cannot sync " + m_file + ".", errno);
+        settle(fd);
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+    ++m_records;
+}
+
+// -----------------------------------------------------------------------------
+void DumpCatalog::settle(int fd)
+{
+    // a change of the directory in the same clock tick as the catalog
+    // could not be told apart, so the catalog must be strictly newer to
+    // be current(); on coarse file systems, it is simply rebuilt
+    for (int i = 0; i < CATALOG_SETTLE_MS; ++i) {
+        struct stat filestat, dirstat;
+        if (fstat(fd, &filestat) != 0 || stat(m_dir.c_str(), &dirstat) != 0)
+            return;
+        if (newer(filestat.st_mtim, dirstat.st_mtim))
+            return;
+        usleep(1000);
+        futimens(fd, NULL);
+    }
+    Debug::debug()->dbg("%s is not newer than its directory", m_file.c_str());
+}
+
+// -----------------------------------------------------------------------------
+void DumpCatalog::rebuild()
+{
+    Debug::debug()->trace("DumpCatalog::rebuild(%s)", m_dir.c_str());
+
+    StringVector names = m_dir.listDir(FilterKdumpDirs());
+    m_sizes.reset(new DumpSizeIndex(m_dir));
+    m_sizes->prune(names);
+
+    std::map<string, Entry> entries;
+    StringVector::const_iterator it;
+    for (it = names.begin(); it != names.end(); ++it) {
+        Entry entry;
+        const Entry *known = find(*it);
+        if (known)
+            entry = *known;
+        entry.name = *it;
+        entry.size = m_sizes->size(*it);
+        if (!entry.crashTime)
+            entry.crashTime = dumpTime(m_dir, *it);
+        entries[*it] = entry;
+    }
+
+    m_entries.swap(entries);
+    m_dirty = true;
+    m_current = true;
+}
+
+// -----------------------------------------------------------------------------
+StringVector DumpCatalog::dumps() const
+{
+    StringVector ret;
+    std::map<string, Entry>::const_iterator it;
+    for (it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (it->second.status == "saving" &&
+            !FilterKdumpDirs::isDump(AT_FDCWD,
+                                     FilePath(m_dir).appendPath(it->first)
+                                     .c_str()))
+            continue;
+        ret.push_back(it->first);
+    }
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+const DumpCatalog::Entry *DumpCatalog::find(const string &name) const
+{
+    std::map<string, Entry>::const_iterator it = m_entries.find(name);
+    return it != m_entries.end() ? &it->second : NULL;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long DumpCatalog::size(const string &name)
+{
+    const Entry *entry = find(name);
+    if (entry && entry->size && entry->status != "saving")
+        return entry->size;
+
+    FilePath path = m_dir;
+    path.appendPath(name);
+    return path.diskUsage();
+}
+
+// -----------------------------------------------------------------------------
+void DumpCatalog::add(const Entry &entry)
+{
+    Debug::debug()->trace("DumpCatalog::add(%s, %s)", m_dir.c_str(),
+                          entry.name.c_str());
+
+    if (!m_exists) {
+        rebuild();
+        save();
+    }
+    m_entries[entry.name] = entry;
+    append(record(entry));
+}
+
+// -----------------------------------------------------------------------------
+void DumpCatalog::remove(const string &name)
+{
+    Debug::debug()->trace("DumpCatalog::remove(%s, %s)", m_dir.c_str(),
+                          name.c_str());
+
+    if (!m_exists) {
+        rebuild();
+        save();
+    }
+    m_entries.erase(name);
+    append("delete " + name);
+}
+
+// -----------------------------------------------------------------------------
+void DumpCatalog::save()
+{
+    if (!m_dirty && m_records <= 2 * m_entries.size() + CATALOG_SLACK)
+        return;
+
+    // the index is only a cache for rebuild()
+    if (m_sizes)
+        m_sizes->save();
+
+    int lock = openLocked(m_file);
+    string tmp = m_file + ".tmp" + StringUtil::number2string(getpid());
+    string data;
+    int fd = -1;
+    try {
+        // keep the records of others since the catalog has been read
+        struct stat mystat;
+        if (fstat(lock, &mystat) != 0)
+            throw KSystemError("Cannot stat " + m_file + ".", errno);
+        if (!apply(lock, mystat.st_ino == m_inode ? m_offset : 0))
+            Debug::debug()->dbg("Replacing invalid %s", m_file.c_str());
+
+        data = CATALOG_MAGIC "\n";
+        std::map<string, Entry>::const_iterator it;
+        for (it = m_entries.begin(); it != m_entries.end(); ++it)
+            data += record(it->second) + '\n';
+
+        fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                  0644);
+        if (fd < 0)
+            throw KSystemError("Cannot create " + tmp + ".", errno);
+        writeAll(fd, data, tmp);
+        if (fsync(fd) != 0)
+            throw KSystemError("Cannot sync " + tmp + ".", errno);
+        if (rename(tmp.c_str(), m_file.c_str()) != 0)
+            throw KSystemError("Cannot rename " + tmp + ".", errno);
+
+        // the rename has modified the directory
+        settle(fd);
+        if (fstat(fd, &mystat) != 0)
+            throw KSystemError("Cannot stat " + m_file + ".", errno);
+        m_inode = mystat.st_ino;
+    } catch (...) {
+        if (fd >= 0) {
+            close(fd);
+            unlink(tmp.c_str());
+        }
+        close(lock);
+        throw;
+    }
+    close(fd);
+    close(lock);
+
+    Debug::debug()->dbg("Saved %zu dumps to %s", m_entries.size(),
+                        m_file.c_str());
+    m_offset = data.size();
+    m_records = m_entries.size();
+    m_dirty = false;
+    m_exists = m_current = true;
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
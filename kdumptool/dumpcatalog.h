@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#ifndef DUMPCATALOG_H
+#define DUMPCATALOG_H
+
+#include <string>
+#include <map>
+#include <memory>
+
+#include <sys/types.h>
+
+#include "global.h"
+#include "fileutil.h"
+#include "stringvector.h"
+
+#define DUMP_CATALOG_FILE   ".kdump-catalog"
+
+class DumpSizeIndex;
+
+//{{{ DumpCatalog --------------------------------------------------------------
+
+/**
+ * The catalog of the dumps in a KDUMP_SAVEDIR directory.
+ *
+ * The catalog is the file .kdump-catalog in that directory. After a
+ * header line, it is a log of records, which are appended with a single
+ * write while the file is locked:
+ *
+ *   dump <name> <crash time> <bytes> <format> <parts> <checksum> <status>
+ *   delete <name>
+ *
+ * where a later record of a dump replaces the earlier ones. Unknown
+ * fields are "-". The checksum is "crc32c" (all files), "partial" (the
+ * dump file was saved directly, so only the other files) or "none", and
+ * the status is "saving" while the dump is saved, then "ok", "truncated"
+ * or "failed". A torn last record is ignored.
+ *
+ * The catalog is only trusted while it is newer than the directory, i.e.
+ * nobody else has modified the directory after the last record (e.g.
+ * deleted a dump by hand); otherwise it is rebuilt from the directory.
+ * Obsolete records are dropped when the catalog is rewritten.
+ */
+class DumpCatalog {
+
+    public:
+        /**
+         * A dump in the catalog.
+         */
+        struct Entry {
+            Entry()
+                : crashTime(0), size(0), parts(0),
+                  format("-"), checksum("-"), status("-")
+            {}
+
+            std::string name;           // directory in KDUMP_SAVEDIR
+            long long crashTime;        // 0 if unknown
+            unsigned long long size;    // disk usage, 0 if unknown
+            unsigned long parts;        // split parts, 0 if not split
+            std::string format;
+            std::string checksum;
+            std::string status;
+        };
+
+        /**
+         * Loads the catalog of @p dir, if there is one.
+         *
+         * @param[in] dir the KDUMP_SAVEDIR directory (real path)
+         */
+        DumpCatalog(const FilePath &dir);
+
+        ~DumpCatalog();
+
+        /**
+         * Returns @c true if there is a catalog file.
+         */
+        bool exists() const
+        { return m_exists; }
+
+        /**
+         * Returns @c true if the catalog can be trusted, i.e. it exists
+         * and the directory has not been modified after it.
+         */
+        bool current() const
+        { return m_current; }
+
+        /**
+         * Replaces the entries with the dumps in the directory. The
+         * sizes are taken from DumpSizeIndex, and the other fields of
+         * known dumps are kept. Nothing is written before save().
+         *
+         * @exception KError if the directory cannot be read
+         */
+        void rebuild();
+
+        /**
+         * Returns the names of all dumps, oldest first. A dump that is
+         * still being saved is only included once it has a dump file,
+         * like in FilterKdumpDirs.
+         */
+        StringVector dumps() const;
+
+        /**
+         * Returns the entry of @p name or @c NULL.
+         */
+        const Entry *find(const std::string &name) const;
+
+        /**
+         * Returns the disk usage of the dump @p name in bytes. Dumps of
+         * unknown size are walked.
+         *
+         * @exception KError if the dump cannot be walked
+         */
+        unsigned long long size(const std::string &name);
+
+        /**
+         * Appends a record for @p entry. The first record builds the
+         * catalog from the directory.
+         *
+         * @exception KError if the record cannot be written
+         */
+        void add(const Entry &entry);
+
+        /**
+         * Appends a record for the deletion of the dump @p name.
+         *
+         * @exception KError if the record cannot be written
+         */
+        void remove(const std::string &name);
+
+        /**
+         * Rewrites the catalog after rebuild() or if most records are
+         * obsolete. Records that others have appended in the meantime
+         * are kept.
+         *
+         * @exception KError if the catalog cannot be written
+         */
+        void save();
+
+    private:
+        static int openLocked(const FilePath &file);
+        void append(const std::string &record);
+        void settle(int fd);
+        bool apply(int fd, off_t offset);
+        bool parse(const std::string &line);
+
+        FilePath m_dir;
+        FilePath m_file;
+        std::map<std::string, Entry> m_entries;
+        std::unique_ptr<DumpSizeIndex> m_sizes;
+        bool m_exists;
+        bool m_current;
+        bool m_dirty;
+        ino_t m_inode;
+        off_t m_offset;
+        size_t m_records;
+};
+
+//}}}
+
+#endif /* DUMPCATALOG_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -30,6 +30,7 @@ using std::cout;
 
 const char *DumpConfig::format_names[] = {
     "shell",			// DumpConfig::FMT_SHELL
+    "binary",			// DumpConfig::FMT_BINARY
 };
 
 const char *DumpConfig::usage_names[] = {
@@ -131,6 +132,13 @@ void DumpConfig::execute()
 
     Configuration *config = Configuration::config();
 
+    // a snapshot always contains all options
+    if (m_format == FMT_BINARY) {
+        config->writeSnapshot(cout);
+        cout.flush();
+        return;
+    }
+
     ConfigOptionIterator it,
 	begin = config->optionsBegin(),
 	end = config->optionsEnd();
@@ -55,6 +55,7 @@ class DumpConfig : public Subcommand {
     private:
 	enum Format {
 	    FMT_SHELL,
+	    FMT_BINARY,
 	};
 	enum Format m_format;
 	std::string m_formatString;
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <string>
+#include <mutex>
+
+#include <dlfcn.h>
+
+#include "global.h"
+#include "debug.h"
+#include "dynlib.h"
+
+using std::string;
+
+//{{{ DynamicLibrary -----------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+DynamicLibrary::DynamicLibrary(const char *soname)
+    : m_soname(soname), m_handle(NULL), m_tried(false)
+{}
+
+// -----------------------------------------------------------------------------
+bool DynamicLibrary::available()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_tried) {
+        m_tried = true;
+        Debug::debug()->dbg("Loading %s", m_soname);
+        m_handle = dlopen(m_soname, RTLD_NOW | RTLD_LOCAL);
+        if (!m_handle) {
+            const char *err = dlerror();
+            m_error = err ? err : "unknown error";
+            Debug::debug()->dbg("Cannot load %s: %s", m_soname,
+                                m_error.c_str());
+        }
+    }
+    return m_handle != NULL;
+}
+
+// -----------------------------------------------------------------------------
+void *DynamicLibrary::symbol(const char *name)
+{
+    if (!available())
+        throw KError(string("Cannot load ") + m_soname + ": " + m_error);
+
+    void *ret = dlsym(m_handle, name);
+    if (!ret)
+        throw KError(string(name) + " not found in " + m_soname + ".");
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void *DynamicLibrary::find(const char *name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return m_handle ? dlsym(m_handle, name) : NULL;
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
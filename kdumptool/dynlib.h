@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef DYNLIB_H
+#define DYNLIB_H
+
+#include <string>
+#include <mutex>
+
+#include "global.h"
+
+//{{{ DynamicLibrary -----------------------------------------------------------
+
+/**
+ * A shared library that is loaded with dlopen() on first use.
+ *
+ * kdumptool does not link the libraries that only some targets need
+ * (libcurl for FTP, S3 and HTTP progress reports, libesmtp for the
+ * notification mail). Instead, their functions are defined by stubs
+ * (see DYNLIB_STUB) that look up the real function when it is first
+ * called. This keeps the libraries out of the start-up of every
+ * kdump-save and kdumptool process, and out of the kdump initrd if
+ * the configuration never uses them.
+ *
+ * The library is never unloaded.
+ */
+class DynamicLibrary {
+
+    public:
+        /**
+         * Creates the object. Nothing is loaded yet.
+         *
+         * @param[in] soname the name of the library, e.g. "libcurl.so.4"
+         */
+        DynamicLibrary(const char *soname);
+
+        /**
+         * Returns the name of the library.
+         */
+        const char *soname() const
+        { return m_soname; }
+
+        /**
+         * Loads the library if it is not loaded yet.
+         *
+         * @return @c true if the library is available
+         */
+        bool available();
+
+        /**
+         * Returns a symbol of the library, which is loaded if necessary.
+         *
+         * @param[in] name the name of the symbol
+         * @exception KError if the library or the symbol cannot be found
+         */
+        void *symbol(const char *name);
+
+        /**
+         * Returns a symbol if the library has been loaded.
+         *
+         * This is meant for cleanup functions: if the library has not
+         * been loaded, there is nothing to clean up.
+         *
+         * @param[in] name the name of the symbol
+         * @return the symbol, or @c NULL
+         */
+        void *find(const char *name);
+
+    private:
+        const char *m_soname;
+        void *m_handle;
+        bool m_tried;
+        std::string m_error;
+        std::mutex m_mutex;
+};
+
+//}}}
+
+/**
+ * Defines a stub for the function @p name of @p lib (an expression that
+ * gives a DynamicLibrary). The stub has the same prototype as the real
+ * function and calls it; the first call looks the function up and
+ * throws KError if it is missing.
+ *
+ *     DYNLIB_STUB(libcurl(), CURL *, curl_easy_init, (void), ())
+ */
+#define DYNLIB_STUB(lib, ret, name, params, args)                        \
+    extern "C" ret name params                                          \
+    {                                                                   \
+        typedef ret (*fn_t) params;                                     \
+        static fn_t fn = reinterpret_cast<fn_t>((lib).symbol(#name));   \
+        return fn args;                                                 \
+    }
+
+/**
+ * Like DYNLIB_STUB, but for a cleanup function that may be called from
+ * a destructor: if the library has not been loaded, the stub returns
+ * @p none instead of loading it.
+ */
+#define DYNLIB_CLEANUP_STUB(lib, ret, name, params, args, none)          \
+    extern "C" ret name params                                          \
+    {                                                                   \
+        typedef ret (*fn_t) params;                                     \
+        fn_t fn = reinterpret_cast<fn_t>((lib).find(#name));            \
+        if (!fn)                                                        \
+            return none;                                                \
+        return fn args;                                                 \
+    }
+
+#endif /* DYNLIB_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
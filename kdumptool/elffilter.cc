@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <elf.h>
+
+#include "global.h"
+#include "debug.h"
+#include "elffilter.h"
+
+using std::min;
+
+// shorter runs of excluded pages are written as zeros
+#define ELF_FILTER_MIN_GAP      256
+
+// offsets of the blocks that are not read from the dump
+static const loff_t BLOCK_ZERO = -1;
+static const loff_t BLOCK_HEADER = -2;
+
+//{{{ FilteredElfDataProvider --------------------------------------------------
+
+// -----------------------------------------------------------------------------
+FilteredElfDataProvider::FilteredElfDataProvider(const char *filename,
+                                                 const PageFilter &filter,
+                                                 unsigned threads,
+                                                 bool priority)
+    : SegmentDataProvider(filename, threads, priority), m_filter(filter)
+{
+}
+
+// -----------------------------------------------------------------------------
+std::vector<FilteredElfDataProvider::Load> FilteredElfDataProvider::planLoads(
+    const std::vector<PageFilter::Run> &runs, unsigned long long filesz,
+    unsigned long long memsz, unsigned long pagesize)
+{
+    const unsigned long long gap = ELF_FILTER_MIN_GAP * pagesize;
+
+    std::vector<Load> ret;
+    Load cur = Load();
+    std::vector<PageFilter::Run>::const_iterator it;
+    for (it = runs.begin(); it != runs.end(); ++it) {
+        unsigned long long start = it->first * pagesize;
+        unsigned long long end = min(start + it->count * pagesize, filesz);
+        if (end <= start)
+            continue;
+
+        if (start - (cur.offset + cur.filesz) < gap)
+            cur.filesz = end - cur.offset;
+        else {
+            cur.memsz = start - cur.offset;
+            ret.push_back(cur);
+            cur.offset = start;
+            cur.filesz = end - start;
+        }
+    }
+    cur.memsz = std::max(memsz, filesz) - cur.offset;
+    ret.push_back(cur);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void FilteredElfDataProvider::planBlocks()
+{
+    const VmcoreContext &ctx = m_filter.context();
+    const std::vector<VmcoreContext::Segment> &segs = ctx.segments();
+    const unsigned long pagesize = m_filter.pageSize();
+
+    Elf64_Ehdr ehdr;
+    Range range = { 0, sizeof ehdr, 0 };
+    SegmentDataProvider::readBlock(range, reinterpret_cast<char *>(&ehdr));
+    size_t phnum = ehdr.e_phnum;
+    if (phnum == PN_XNUM) {
+        Elf64_Shdr shdr;
+        Range r = { (loff_t)ehdr.e_shoff, sizeof shdr, 0 };
+        SegmentDataProvider::readBlock(r, reinterpret_cast<char *>(&shdr));
+        phnum = shdr.sh_info;
+    }
+    std::vector<Elf64_Phdr> in(phnum);
+    range.offset = ehdr.e_phoff;
+    range.length = phnum * sizeof(Elf64_Phdr);
+    SegmentDataProvider::readBlock(range, reinterpret_cast<char *>(in.data()));
+
+    // the notes first, then the loads in the order of the dump
+    struct Piece {
+        size_t phdr;            // index into out
+        size_t seg;
+        Load load;
+    };
+    std::vector<Elf64_Phdr> out;
+    std::vector<const Elf64_Phdr *> notes;
+    std::vector<Piece> pieces;
+    std::vector<std::vector<PageFilter::Run> > runs(segs.size());
+    std::vector<Elf64_Phdr>::const_iterator it;
+    for (it = in.begin(); it != in.end(); ++it)
+        if (it->p_type == PT_NOTE) {
+            out.push_back(*it);
+            notes.push_back(&*it);
+        }
+    size_t seg = 0;
+    for (it = in.begin(); it != in.end(); ++it) {
+        if (it->p_type != PT_LOAD)
+            continue;
+        if (!it->p_filesz) {
+            out.push_back(*it);
+            out.back().p_offset = 0;
+            continue;
+        }
+        if (seg >= segs.size() || segs[seg].offset != (off_t)it->p_offset)
+            throw KError("The program headers of " + m_filename +
+                         " have changed.");
+
+        runs[seg] = m_filter.keptRuns(seg);
+        std::vector<Load> loads = planLoads(runs[seg], it->p_filesz,
+                                            it->p_memsz, pagesize);
+        std::vector<Load>::const_iterator l;
+        for (l = loads.begin(); l != loads.end(); ++l) {
+            Elf64_Phdr phdr = *it;
+            phdr.p_vaddr += l->offset;
+            phdr.p_paddr += l->offset;
+            phdr.p_filesz = l->filesz;
+            phdr.p_memsz = l->memsz;
+            Piece piece = { out.size(), seg, *l };
+            out.push_back(phdr);
+            pieces.push_back(piece);
+        }
+        ++seg;
+    }
+
+    // more than 65534 headers need extended numbering
+    bool xnum = out.size() >= PN_XNUM;
+    const size_t headerSize = sizeof(Elf64_Ehdr) +
+        out.size() * sizeof(Elf64_Phdr) + (xnum ? sizeof(Elf64_Shdr) : 0);
+    loff_t pos = headerSize;
+    m_blocks.clear();
+    addBlocks(BLOCK_HEADER, 0, pos);
+
+    for (size_t i = 0; i < notes.size(); ++i) {
+        out[i].p_offset = pos;
+        addBlocks(notes[i]->p_offset, pos, notes[i]->p_filesz);
+        pos += notes[i]->p_filesz;
+    }
+
+    loff_t aligned = (pos + pagesize - 1) & ~(loff_t)(pagesize - 1);
+    addBlocks(BLOCK_ZERO, pos, aligned - pos);
+    pos = aligned;
+
+    // the pages of each load; the excluded pages inside are zeros
+    size_t run = 0;
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        if (i == 0 || pieces[i].seg != pieces[i - 1].seg)
+            run = 0;
+
+        const VmcoreContext::Segment &s = segs[pieces[i].seg];
+        const std::vector<PageFilter::Run> &kept = runs[pieces[i].seg];
+        const Load &load = pieces[i].load;
+        out[pieces[i].phdr].p_offset = pos;
+
+        unsigned long long cur = load.offset;
+        unsigned long long end = load.offset + load.filesz;
+        while (cur < end) {
+            unsigned long long start = end, stop = end;
+            if (run < kept.size()) {
+                start = min(kept[run].first * pagesize, end);
+                stop = min((kept[run].first + kept[run].count) * pagesize,
+                           (unsigned long long)s.filesz);
+            }
+            if (cur < start) {
+                addBlocks(BLOCK_ZERO, pos + (cur - load.offset),
+                          start - cur);
+                cur = start;
+            }
+            if (cur >= end)
+                break;
+            unsigned long long len = min(stop, end) - cur;
+            addBlocks(s.offset + cur, pos + (cur - load.offset), len);
+            cur += len;
+            if (cur >= stop)
+                ++run;
+        }
+        pos += load.filesz;
+    }
+
+    Elf64_Ehdr header = ehdr;
+    header.e_phoff = sizeof(Elf64_Ehdr);
+    header.e_phentsize = sizeof(Elf64_Phdr);
+    header.e_phnum = xnum ? PN_XNUM : out.size();
+    header.e_shoff = xnum ? header.e_phoff + out.size() * sizeof(Elf64_Phdr)
+        : 0;
+    header.e_shentsize = xnum ? sizeof(Elf64_Shdr) : 0;
+    header.e_shnum = xnum ? 1 : 0;
+    header.e_shstrndx = SHN_UNDEF;
+
+    m_header.assign(headerSize, 0);
+    memcpy(m_header.data(), &header, sizeof header);
+    memcpy(m_header.data() + sizeof header, out.data(),
+           out.size() * sizeof(Elf64_Phdr));
+    if (xnum) {
+        Elf64_Shdr shdr = Elf64_Shdr();
+        shdr.sh_info = out.size();
+        memcpy(m_header.data() + header.e_shoff, &shdr, sizeof shdr);
+    }
+    m_fileSize = pos;
+
+    Debug::debug()->dbg("Filtered ELF dump: %zu program headers, %lld bytes",
+                        out.size(), (long long)pos);
+
+    if (m_priority) {
+        unsigned long long kernel = 0;
+        try {
+            kernel = strtoull(ctx.vmcoreinfo().getStringValue(
+                    "SYMBOL(_stext)").c_str(), NULL, 16);
+        } catch (const KError &e) {
+            Debug::debug()->dbg("No _stext in VMCOREINFO");
+        }
+        prioritize(m_blocks, segs, kernel);
+    }
+}
+
+// -----------------------------------------------------------------------------
+void FilteredElfDataProvider::readBlock(const Range &range, char *buffer)
+{
+    if (range.offset == BLOCK_ZERO)
+        memset(buffer, 0, range.length);
+    else if (range.offset == BLOCK_HEADER)
+        memcpy(buffer, &m_header[range.target], range.length);
+    else
+        SegmentDataProvider::readBlock(range, buffer);
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#ifndef ELFFILTER_H
+#define ELFFILTER_H
+
+#include <vector>
+
+#include "global.h"
+#include "pagefilter.h"
+#include "segmentreader.h"
+
+//{{{ FilteredElfDataProvider --------------------------------------------------
+
+/**
+ * DataProvider for an ELF dump without the pages that a PageFilter has
+ * excluded, like "makedumpfile -E".
+ *
+ * Each PT_LOAD segment is cut into segments that contain only kept
+ * pages; the excluded memory at the end of a segment is only in its
+ * memory size, so it reads as zeros. Shorter runs of excluded pages are
+ * written as zeros, to keep the number of program headers low. The new
+ * headers, the notes and the kept pages are blocks of a
+ * SegmentDataProvider, so the dump is read by several threads and
+ * can be written in priority order, too.
+ */
+class FilteredElfDataProvider : public SegmentDataProvider {
+
+    public:
+        /**
+         * A PT_LOAD segment of the output, relative to the segment of
+         * the dump that it is cut from.
+         */
+        struct Load {
+            unsigned long long offset;
+            unsigned long long filesz;
+            unsigned long long memsz;
+        };
+
+        /**
+         * Creates a new FilteredElfDataProvider object.
+         *
+         * @param[in] filename the dump file
+         * @param[in] filter the classified pages of the dump; must live
+         *            as long as this object
+         * @param[in] threads number of reader threads
+         * @param[in] priority hand out the blocks in priority order
+         */
+        FilteredElfDataProvider(const char *filename,
+                                const PageFilter &filter, unsigned threads,
+                                bool priority = false);
+
+        /**
+         * Cuts a segment with the kept pages @p runs into output segments.
+         *
+         * @param[in] runs the kept pages (see PageFilter::keptRuns())
+         * @param[in] filesz size of the segment in the dump
+         * @param[in] memsz memory size of the segment
+         * @param[in] pagesize page size
+         * @return the output segments, which cover the whole memory size
+         */
+        static std::vector<Load> planLoads(
+            const std::vector<PageFilter::Run> &runs,
+            unsigned long long filesz, unsigned long long memsz,
+            unsigned long pagesize);
+
+    protected:
+        /**
+         * Builds the headers and plans the blocks of the output.
+         */
+        void planBlocks();
+
+        /**
+         * Reads a block of the dump, the headers or zeros.
+         */
+        void readBlock(const Range &range, char *buffer);
+
+    private:
+        const PageFilter &m_filter;
+        ByteVector m_header;
+};
+
+//}}}
+
+#endif /* ELFFILTER_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdarg>
+#include <strings.h>
+
+#include "global.h"
+
+#if HAVE_LIBESMTP
+#   include <auth-client.h>
+#   include <libesmtp.h>
+
+#include "dynlib.h"
+
+//{{{ libesmtp -----------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+static DynamicLibrary &libesmtp()
+{
+    static DynamicLibrary lib(ESMTP_SONAME);
+    return lib;
+}
+
+DYNLIB_STUB(libesmtp(), int, smtp_errno,
+            (void), ())
+DYNLIB_STUB(libesmtp(), char *, smtp_strerror,
+            (int error, char buf[], size_t buflen), (error, buf, buflen))
+
+DYNLIB_STUB(libesmtp(), smtp_session_t, smtp_create_session,
+            (void), ())
+DYNLIB_STUB(libesmtp(), int, smtp_set_server,
+            (smtp_session_t session, const char *hostport),
+            (session, hostport))
+DYNLIB_STUB(libesmtp(), int, smtp_set_hostname,
+            (smtp_session_t session, const char *hostname),
+            (session, hostname))
+DYNLIB_STUB(libesmtp(), int, smtp_set_monitorcb,
+            (smtp_session_t session, smtp_monitorcb_t cb, void *arg,
+             int headers),
+            (session, cb, arg, headers))
+DYNLIB_STUB(libesmtp(), int, smtp_auth_set_context,
+            (smtp_session_t session, auth_context_t context),
+            (session, context))
+DYNLIB_STUB(libesmtp(), int, smtp_start_session,
+            (smtp_session_t session), (session))
+DYNLIB_CLEANUP_STUB(libesmtp(), int, smtp_destroy_session,
+                    (smtp_session_t session), (session), 0)
+
+DYNLIB_STUB(libesmtp(), smtp_message_t, smtp_add_message,
+            (smtp_session_t session), (session))
+DYNLIB_STUB(libesmtp(), smtp_recipient_t, smtp_add_recipient,
+            (smtp_message_t message, const char *mailbox),
+            (message, mailbox))
+DYNLIB_STUB(libesmtp(), int, smtp_set_messagecb,
+            (smtp_message_t message, smtp_messagecb_t cb, void *arg),
+            (message, cb, arg))
+DYNLIB_STUB(libesmtp(), const smtp_status_t *, smtp_message_transfer_status,
+            (smtp_message_t message), (message))
+
+DYNLIB_STUB(libesmtp(), auth_context_t, auth_create_context,
+            (void), ())
+DYNLIB_STUB(libesmtp(), int, auth_set_mechanism_flags,
+            (auth_context_t context, unsigned set, unsigned clear),
+            (context, set, clear))
+DYNLIB_STUB(libesmtp(), int, auth_set_interact_cb,
+            (auth_context_t context, auth_interact_t interact, void *arg),
+            (context, interact, arg))
+DYNLIB_CLEANUP_STUB(libesmtp(), int, auth_destroy_context,
+                    (auth_context_t context), (context), 0)
+DYNLIB_CLEANUP_STUB(libesmtp(), void, auth_client_exit,
+                    (void), (), )
+
+// -----------------------------------------------------------------------------
+extern "C" int smtp_set_header(smtp_message_t message, const char *header, ...)
+{
+    typedef int (*fn_t)(smtp_message_t, const char *, ...);
+    static fn_t fn = reinterpret_cast<fn_t>(
+        libesmtp().symbol("smtp_set_header"));
+
+    // address headers take a phrase and a mailbox, all others one value
+    static const char *const address_headers[] = {
+        "From", "Sender", "To", "Cc", "Bcc", "Reply-To",
+        "Disposition-Notification-To", NULL
+    };
+    bool address = false;
+    for (const char *const *p = address_headers; *p; ++p)
+        if (strcasecmp(header, *p) == 0)
+            address = true;
+
+    va_list ap;
+    va_start(ap, header);
+    int ret;
+    if (address) {
+        const char *phrase = va_arg(ap, const char *);
+        const char *mailbox = va_arg(ap, const char *);
+        ret = fn(message, header, phrase, mailbox);
+    } else
+        ret = fn(message, header, va_arg(ap, void *));
+    va_end(ap);
+    return ret;
+}
+
+//}}}
+
+#endif // HAVE_LIBESMTP
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
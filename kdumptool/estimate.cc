@@ -0,0 +1,392 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <strings.h>
+#include <unistd.h>
+
+#include "global.h"
+#include "debug.h"
+#include "estimate.h"
+#include "configuration.h"
+#include "vmcorecontext.h"
+#include "process.h"
+#include "fileutil.h"
+#include "stringutil.h"
+
+using std::string;
+using std::cout;
+using std::endl;
+
+#define DEFAULT_DUMP        "/proc/vmcore"
+#define LIVE_CORE           "/proc/kcore"
+
+/**
+ * Output size and speed of a dump format. The ratios are typical for
+ * filtered dumps; the minimum ratio is what very compressible memory
+ * gives, so a dump that does not fit with it cannot fit at all.
+ */
+struct FormatModel {
+    const char *name;
+    unsigned long ratio_pct;
+    unsigned long min_ratio_pct;
+    unsigned long mbps;             // per CPU, of the filtered input
+    bool bitmap;                    // kdump-compressed format
+};
+
+static const FormatModel format_models[] = {
+    { "ELF",        100, 100, 2000, false },
+    { "compressed",  30,   5,   40, true },
+    { "lzo",         40,  10,  250, true },
+    { "snappy",      40,  10,  350, true },
+    { "zstd",        30,   5,  300, true },
+    // one of the above, see CodecBenchmark; as large as lzo and as
+    // slow as zlib in the worst case
+    { "auto",        40,   5,   40, true },
+};
+
+// ELF with KDUMP_ELF_ZSTD_LEVEL
+static const FormatModel zstd_model = { "ELF", 30, 5, 200, false };
+
+// page types in makedumpfile output
+struct StatLabel {
+    const char *label;
+    DumpEstimator::PageClass pc;
+};
+
+static const StatLabel stat_labels[] = {
+    // --mem-usage table
+    { "ZERO",                       DumpEstimator::PC_ZERO },
+    { "NON_PRI_CACHE",              DumpEstimator::PC_CACHE },
+    { "PRI_CACHE",                  DumpEstimator::PC_CACHE_PRIVATE },
+    { "USER",                       DumpEstimator::PC_USER },
+    { "FREE",                       DumpEstimator::PC_FREE },
+    // --show-stats report
+    { "Pages filled with zero",     DumpEstimator::PC_ZERO },
+    { "Non-private cache pages",    DumpEstimator::PC_CACHE },
+    { "Private cache pages",        DumpEstimator::PC_CACHE_PRIVATE },
+    { "User process data pages",    DumpEstimator::PC_USER },
+    { "Free pages",                 DumpEstimator::PC_FREE },
+};
+
+//{{{ DumpEstimator ------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+DumpEstimator::DumpEstimator(unsigned long long memory,
+                             unsigned long pagesize)
+    : m_memory(memory), m_pagesize(pagesize), m_hasStats(false),
+      m_source("none")
+{
+    for (int i = 0; i < PC_MAX; ++i)
+        m_pages[i] = 0;
+}
+
+// -----------------------------------------------------------------------------
+DumpEstimator DumpEstimator::fromVmcore(const string &dump)
+{
+    Debug::debug()->trace("DumpEstimator::fromVmcore(%s)", dump.c_str());
+
+    std::shared_ptr<const VmcoreContext> ctx = VmcoreContext::get(dump);
+    if (!ctx->isElf())
+        throw KError(dump + " is not an ELF dump.");
+
+    unsigned long pagesize = sysconf(_SC_PAGESIZE);
+    if (ctx->hasVmcoreinfo()) {
+        try {
+            pagesize = ctx->vmcoreinfo().getIntValue("PAGESIZE");
+        } catch (const KError &error) {
+            Debug::debug()->dbg("No PAGESIZE: %s", error.what());
+        }
+    }
+
+    return DumpEstimator(ctx->memorySize(), pagesize);
+}
+
+// -----------------------------------------------------------------------------
+DumpEstimator DumpEstimator::fromLiveSystem()
+{
+    Debug::debug()->trace("DumpEstimator::fromLiveSystem()");
+
+    unsigned long pagesize = sysconf(_SC_PAGESIZE);
+    DumpEstimator ret((unsigned long long)sysconf(_SC_PHYS_PAGES) * pagesize,
+                      pagesize);
+
+    // values in KiB
+    std::ifstream fin("/proc/meminfo");
+    unsigned long long memfree = 0, cached = 0, buffers = 0, anon = 0;
+    string line;
+    while (getline(fin, line)) {
+        std::istringstream iss(line);
+        string key;
+        unsigned long long value;
+        if (!(iss >> key >> value))
+            continue;
+        if (key == "MemFree:")
+            memfree = value;
+        else if (key == "Cached:")
+            cached = value;
+        else if (key == "Buffers:")
+            buffers = value;
+        else if (key == "AnonPages:")
+            anon = value;
+    }
+    if (!memfree)
+        return ret;
+
+    unsigned long long kb_per_page = pagesize / 1024;
+    ret.setPages(PC_FREE, memfree / kb_per_page);
+    ret.setPages(PC_CACHE, (cached + buffers) / kb_per_page);
+    ret.setPages(PC_USER, anon / kb_per_page);
+    ret.m_source = "meminfo";
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+bool DumpEstimator::analyze(const string &core, bool live)
+{
+    Debug::debug()->trace("DumpEstimator::analyze(%s, %d)",
+                          core.c_str(), live);
+
+    StringVector args;
+    if (live) {
+        args.push_back("--mem-usage");
+    } else {
+        // -F writes to stdout, so no output file is needed; the
+        // statistics go to stderr
+        args.push_back("-F");
+        args.push_back("--dry-run");
+        args.push_back("--show-stats");
+        args.push_back("-d");
+        args.push_back("31");
+    }
+    args.push_back(core);
+
+    std::ostringstream stdoutStream, stderrStream;
+    ProcessFilter p;
+    p.setStdout(&stdoutStream);
+    p.setStderr(&stderrStream);
+    int ret;
+    try {
+        ret = p.execute("makedumpfile", args);
+    } catch (const KError &error) {
+        Debug::debug()->dbg("Cannot run makedumpfile: %s", error.what());
+        return false;
+    }
+    if (ret != 0) {
+        KString error = stderrStream.str();
+        Debug::debug()->dbg("makedumpfile failed: %s", error.trim().c_str());
+        return false;
+    }
+
+    if (!parseStats(stdoutStream.str() + stderrStream.str()))
+        return false;
+    m_source = "makedumpfile";
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+bool DumpEstimator::parseStats(const string &output)
+{
+    bool found = false;
+    std::istringstream iss(output);
+    string line;
+
+    while (getline(iss, line)) {
+        // "LABEL : value" in the report, "TYPE PAGES ..." in the table
+        string label, value;
+        string::size_type colon = line.find(':');
+        if (colon != string::npos) {
+            label = KString(line.substr(0, colon)).trim();
+            std::istringstream(line.substr(colon + 1)) >> value;
+        } else
+            std::istringstream(line) >> label >> value;
+
+        if (label == "page size") {
+            unsigned long pagesize = strtoul(value.c_str(), NULL, 0);
+            if (pagesize)
+                m_pagesize = pagesize;
+            continue;
+        }
+
+        for (size_t i = 0; i < sizeof(stat_labels)/sizeof(stat_labels[0]);
+             ++i) {
+            if (label != stat_labels[i].label)
+                continue;
+            char *end;
+            unsigned long long pages = strtoull(value.c_str(), &end, 0);
+            if (end != value.c_str() && *end == '\0') {
+                setPages(stat_labels[i].pc, pages);
+                found = true;
+            }
+            break;
+        }
+    }
+
+    return found;
+}
+
+// -----------------------------------------------------------------------------
+void DumpEstimator::setPages(PageClass pc, unsigned long long pages)
+{
+    m_pages[pc] = pages;
+    m_hasStats = true;
+}
+
+// -----------------------------------------------------------------------------
+DumpEstimator::Result DumpEstimator::estimate(int dumplevel,
+                                              const string &format,
+                                              int zstdLevel,
+                                              unsigned long workers,
+                                              bool sparse) const
+{
+    Result ret;
+    memset(&ret, 0, sizeof ret);
+    if (strcasecmp(format.c_str(), "none") == 0)
+        return ret;
+
+    const FormatModel *model = NULL;
+    for (size_t i = 0; i < sizeof(format_models)/sizeof(format_models[0]);
+         ++i)
+        if (strcasecmp(format.c_str(), format_models[i].name) == 0)
+            model = &format_models[i];
+    if (!model)
+        throw KError("Unknown dump format: " + format);
+
+    bool elf = model == &format_models[0];
+    if (elf && dumplevel == 0 && zstdLevel > 0)
+        model = &zstd_model;
+
+    unsigned long long excluded = 0;
+    for (int i = 0; i < PC_MAX; ++i)
+        if (dumplevel & (1 << i))
+            excluded += m_pages[i] * m_pagesize;
+    if (excluded > m_memory)
+        excluded = m_memory;
+
+    ret.input = m_memory - excluded;
+    ret.size = ret.input * model->ratio_pct / 100;
+    ret.minimum = ret.input * model->min_ratio_pct / 100;
+
+    // compression does not make the pages larger
+    ret.maximum = ret.input;
+    if (model->ratio_pct >= 100 && sparse && !(dumplevel & 1)) {
+        // zero blocks become holes; any block may be zero
+        unsigned long long zero = m_hasStats
+            ? m_pages[PC_ZERO] * m_pagesize
+            : ret.minimum;
+        ret.minimum -= std::min(zero, ret.minimum);
+    }
+
+    if (model->bitmap) {
+        // two bitmaps with one bit per page, and the page descriptors
+        unsigned long long pages = m_memory / m_pagesize;
+        unsigned long long header = pages / 4 + ret.input / m_pagesize * 24;
+        ret.minimum += header;
+        ret.size += header;
+        ret.maximum += header;
+    }
+
+    if (!workers)
+        workers = 1;
+    unsigned long long bps = (unsigned long long)model->mbps * workers << 20;
+    ret.seconds = (ret.input + bps - 1) / bps;
+
+    return ret;
+}
+
+//}}}
+//{{{ Estimate -----------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+Estimate::Estimate()
+    : m_analyze(false), m_level(-1)
+{
+    m_options.push_back(new StringOption("dump", 'u', &m_dump,
+        "Use the specified dump file instead of the running system"));
+    m_options.push_back(new FlagOption("analyze", 'a', &m_analyze,
+        "Count the excluded pages with makedumpfile"));
+    m_options.push_back(new IntOption("level", 'd', &m_level,
+        "Use this dump level instead of KDUMP_DUMPLEVEL"));
+    m_options.push_back(new StringOption("format", 'f', &m_format,
+        "Use this format instead of KDUMP_DUMPFORMAT"));
+}
+
+// -----------------------------------------------------------------------------
+const char *Estimate::getName() const
+{
+    return "estimate";
+}
+
+// -----------------------------------------------------------------------------
+static void printSize(const char *label, unsigned long long bytes)
+{
+    cout << label << bytes_to_megabytes(bytes) << " MiB" << endl;
+}
+
+// -----------------------------------------------------------------------------
+void Estimate::execute()
+{
+    Debug::debug()->trace("Estimate::execute()");
+
+    Configuration *config = Configuration::config();
+
+    // in the kdump environment, the default is the dump
+    if (m_dump.empty() && FilePath(DEFAULT_DUMP).exists())
+        m_dump = DEFAULT_DUMP;
+    bool live = m_dump.empty();
+
+    DumpEstimator estimator = live
+        ? DumpEstimator::fromLiveSystem()
+        : DumpEstimator::fromVmcore(m_dump);
+    if (m_analyze && !estimator.analyze(live ? LIVE_CORE : m_dump, live))
+        cout << "WARNING: makedumpfile cannot count the pages." << endl;
+
+    int level = m_level >= 0 ? m_level : config->KDUMP_DUMPLEVEL.value();
+    if (level < 0 || level > 31)
+        throw KError("Invalid dump level: " + StringUtil::number2string(level));
+    string format = m_format.empty()
+        ? config->KDUMP_DUMPFORMAT.value()
+        : m_format;
+
+    unsigned long workers = 1;
+    if (!config->kdumptoolContainsFlag(Configuration::FLAG_SINGLE) &&
+        config->KDUMP_CPUS.value() > 1)
+        workers = config->KDUMP_CPUS.value();
+
+    DumpEstimator::Result est = estimator.estimate(
+        level, format, config->KDUMP_ELF_ZSTD_LEVEL.value(), workers,
+        !config->kdumptoolContainsFlag(Configuration::FLAG_NOSPARSE));
+
+    cout << "Source:     " << (live ? "running system" : m_dump) << endl;
+    cout << "Statistics: " << estimator.source() << endl;
+    cout << "Format:     " << format << ", level " << level << endl;
+    printSize("Memory:     ", estimator.memory());
+    printSize("Filtered:   ", est.input);
+    printSize("Minimum:    ", est.minimum);
+    printSize("Expected:   ", est.size);
+    printSize("Maximum:    ", est.maximum);
+    cout << "Time:       " << est.seconds << " s" << endl;
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef ESTIMATE_H
+#define ESTIMATE_H
+
+#include <string>
+
+#include "global.h"
+#include "subcommand.h"
+
+//{{{ DumpEstimator ------------------------------------------------------------
+
+/**
+ * Predicts the size of a dump before it is written.
+ *
+ * The amount of memory is taken from the PT_LOAD segments of the dump
+ * (or from the running system). How much of it the dump level excludes
+ * is only known after an analysis: makedumpfile counts the pages of
+ * each type, and on a live system /proc/meminfo gives a rough idea.
+ * Compression is modelled with a fixed ratio per format, so the result
+ * is a range rather than a number.
+ */
+class DumpEstimator {
+
+    public:
+        /**
+         * Page types that are excluded by the dump level bits.
+         */
+        enum PageClass {
+            PC_ZERO,                // 1: pages filled with zero
+            PC_CACHE,               // 2: cache pages without private flag
+            PC_CACHE_PRIVATE,       // 4: cache pages with private flag
+            PC_USER,                // 8: user process data pages
+            PC_FREE,                // 16: free pages
+            PC_MAX
+        };
+
+        /**
+         * Result of estimate(). All sizes are in bytes.
+         */
+        struct Result {
+            unsigned long long input;   // memory left after filtering
+            unsigned long long minimum; // the dump cannot be smaller
+            unsigned long long size;    // expected size
+            unsigned long long maximum; // the dump should not be larger
+            unsigned long seconds;      // expected processing time
+        };
+
+        /**
+         * Creates an estimator without page statistics.
+         *
+         * @param[in] memory bytes of memory in the dump
+         * @param[in] pagesize page size of the crashed system
+         */
+        DumpEstimator(unsigned long long memory, unsigned long pagesize);
+
+        /**
+         * Creates an estimator from the headers of an ELF dump.
+         *
+         * @param[in] dump the dump file, e.g. /proc/vmcore
+         * @exception KError if the dump cannot be read
+         */
+        static DumpEstimator fromVmcore(const std::string &dump);
+
+        /**
+         * Creates an estimator for a crash of the running system, with
+         * the page statistics approximated from /proc/meminfo.
+         */
+        static DumpEstimator fromLiveSystem();
+
+        /**
+         * Counts the pages of each type with makedumpfile.
+         *
+         * For a dump this runs "makedumpfile --dry-run", which reads the
+         * page descriptors but writes nothing; on a live system it uses
+         * "makedumpfile --mem-usage /proc/kcore".
+         *
+         * @param[in] core the dump file or /proc/kcore
+         * @param[in] live @c true for /proc/kcore
+         * @return @c true if the statistics have been updated
+         */
+        bool analyze(const std::string &core, bool live);
+
+        /**
+         * Reads the page statistics printed by makedumpfile.
+         *
+         * @param[in] output the output of makedumpfile
+         * @return @c true if at least one page type was found
+         */
+        bool parseStats(const std::string &output);
+
+        /**
+         * Sets the number of pages of one type.
+         */
+        void setPages(PageClass pc, unsigned long long pages);
+
+        /**
+         * Estimates the dump.
+         *
+         * @param[in] dumplevel makedumpfile dump level (0 to 31)
+         * @param[in] format KDUMP_DUMPFORMAT
+         * @param[in] zstdLevel KDUMP_ELF_ZSTD_LEVEL
+         * @param[in] workers number of CPUs used for the dump
+         * @param[in] sparse @c true if zero blocks are written as holes
+         */
+        Result estimate(int dumplevel, const std::string &format,
+                        int zstdLevel, unsigned long workers,
+                        bool sparse) const;
+
+        /**
+         * Returns the bytes of memory in the dump.
+         */
+        unsigned long long memory() const
+        { return m_memory; }
+
+        /**
+         * Returns the page size.
+         */
+        unsigned long pagesize() const
+        { return m_pagesize; }
+
+        /**
+         * Returns @c true if page statistics are available.
+         */
+        bool hasStats() const
+        { return m_hasStats; }
+
+        /**
+         * Returns where the page statistics come from ("makedumpfile",
+         * "meminfo" or "none").
+         */
+        const std::string &source() const
+        { return m_source; }
+
+    private:
+        unsigned long long m_memory;
+        unsigned long m_pagesize;
+        unsigned long long m_pages[PC_MAX];
+        bool m_hasStats;
+        std::string m_source;
+};
+
+//}}}
+//{{{ Estimate -----------------------------------------------------------------
+
+/**
+ * Subcommand to estimate the dump size and duration.
+ */
+class Estimate : public Subcommand {
+
+    public:
+        /**
+         * Creates a new Estimate object.
+         */
+        Estimate();
+
+    public:
+        /**
+         * Returns the name of the subcommand (estimate).
+         */
+        const char *getName() const;
+
+        /**
+         * Executes the function.
+         *
+         * @throw KError on any error. No exception indicates success.
+         */
+        void execute();
+
+    private:
+        std::string m_dump;
+        bool m_analyze;
+        int m_level;
+        std::string m_format;
+};
+
+//}}}
+
+#endif /* ESTIMATE_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+
+#include <iostream>
+#include <algorithm>
+
+#include "global.h"
+#include "debug.h"
+#include "dataprovider.h"
+#include "timebudget.h"
+#include "failovertransfer.h"
+
+using std::string;
+using std::cerr;
+using std::endl;
+
+//{{{ TargetProbe --------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+std::vector<size_t> TargetProbe::rank(const std::vector<TargetProbe> &probes)
+{
+    std::vector<size_t> ret;
+    for (size_t i = 0; i < probes.size(); ++i)
+        if (probes[i].ok)
+            ret.push_back(i);
+
+    std::stable_sort(ret.begin(), ret.end(), [&probes](size_t a, size_t b) {
+        return probes[a].connectSeconds + probes[a].burstSeconds <
+            probes[b].connectSeconds + probes[b].burstSeconds;
+    });
+    return ret;
+}
+
+//}}}
+//{{{ FailoverTransfer ---------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+FailoverTransfer::FailoverTransfer()
+    : m_current(0)
+{
+    Debug::debug()->trace("FailoverTransfer::FailoverTransfer()");
+}
+
+// -----------------------------------------------------------------------------
+FailoverTransfer::~FailoverTransfer()
+{
+    Debug::debug()->trace("FailoverTransfer::~FailoverTransfer()");
+}
+
+// -----------------------------------------------------------------------------
+void FailoverTransfer::addLeg(Transfer *transfer, const string &name)
+{
+    Debug::debug()->trace("FailoverTransfer::addLeg(%p, %s)",
+                          transfer, name.c_str());
+
+    Leg leg;
+    leg.transfer.reset(transfer);
+    leg.name = name;
+    m_legs.push_back(std::move(leg));
+}
+
+// -----------------------------------------------------------------------------
+void FailoverTransfer::perform(DataProvider *dataprovider,
+                               const StringVector &target_files,
+                               bool *directSave)
+{
+    Debug::debug()->trace("FailoverTransfer::perform(%p, [ \"%s\"%s ])",
+                          dataprovider, target_files.front().c_str(),
+                          target_files.size() > 1 ? ", ..." : "");
+
+    if (m_current >= m_legs.size())
+        throw KError("No dump target left.");
+
+    for (;;) {
+        Leg &leg = m_legs[m_current];
+
+        // tells whether the failed leg has consumed any data
+        CountingDataProvider counting(dataprovider);
+        try {
+            leg.transfer->perform(&counting, target_files, directSave);
+            return;
+        } catch (const KDeadlineError &) {
+            throw;
+        } catch (const KError &error) {
+            if (m_current + 1 >= m_legs.size())
+                throw;
+            if (counting.bytes() && !dataprovider->canRestart()) {
+                cerr << "WARNING: Saving " << target_files.front()
+                     << " cannot be repeated on another target." << endl;
+                throw;
+            }
+
+            ++m_current;
+            cerr << "WARNING: Saving " << target_files.front() << " to "
+                 << leg.name << " failed: " << error.what() << endl;
+            cerr << "Continuing with " << m_legs[m_current].name << endl;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+void FailoverTransfer::performBatch(const ArtifactBatch &artifacts)
+{
+    Debug::debug()->trace("FailoverTransfer::performBatch([%zu files])",
+                          artifacts.size());
+
+    if (artifacts.empty())
+        return;
+    if (m_current >= m_legs.size())
+        throw KError("No dump target left.");
+
+    for (;;) {
+        Leg &leg = m_legs[m_current];
+        try {
+            leg.transfer->performBatch(artifacts);
+            return;
+        } catch (const KDeadlineError &) {
+            throw;
+        } catch (const KError &error) {
+            if (m_current + 1 >= m_legs.size())
+                throw;
+
+            ++m_current;
+            cerr << "WARNING: Saving " << artifacts.front().first
+                 << " and other files to " << leg.name << " failed: "
+                 << error.what() << endl;
+            cerr << "Continuing with " << m_legs[m_current].name << endl;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+string FailoverTransfer::localDirectory()
+{
+    if (m_current >= m_legs.size())
+        return string();
+    return m_legs[m_current].transfer->localDirectory();
+}
+
+// -----------------------------------------------------------------------------
+void FailoverTransfer::setFreeSpaceReserve(unsigned long long bytes)
+{
+    for (size_t i = 0; i < m_legs.size(); ++i)
+        m_legs[i].transfer->setFreeSpaceReserve(bytes);
+}
+
+// -----------------------------------------------------------------------------
+void FailoverTransfer::setExpectedSize(unsigned long long bytes)
+{
+    for (size_t i = 0; i < m_legs.size(); ++i)
+        m_legs[i].transfer->setExpectedSize(bytes);
+}
+
+// -----------------------------------------------------------------------------
+const string &FailoverTransfer::currentLeg() const
+{
+    if (m_current >= m_legs.size())
+        throw KError("No dump target left.");
+    return m_legs[m_current].name;
+}
+
+// -----------------------------------------------------------------------------
+StringVector FailoverTransfer::failedLegs() const
+{
+    StringVector ret;
+    for (size_t i = 0; i < m_current && i < m_legs.size(); ++i)
+        ret.push_back(m_legs[i].name);
+    return ret;
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#ifndef FAILOVERTRANSFER_H
+#define FAILOVERTRANSFER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "global.h"
+#include "transfer.h"
+
+//{{{ TargetProbe --------------------------------------------------------------
+
+/**
+ * Result of probing one dump target before the dump: the time to set up
+ * the Transfer (connect, log in, mount) and the time to save a short
+ * burst of data. A target that is not reachable or fails either step is
+ * not used.
+ */
+struct TargetProbe {
+
+    TargetProbe()
+        : index(0), ok(false), connectSeconds(0), burstBytes(0),
+          burstSeconds(0)
+    {}
+
+    size_t index;                       // position in KDUMP_SAVEDIR
+    std::string name;
+    bool ok;
+    std::string error;                  // why it is not used
+    double connectSeconds;
+    unsigned long long burstBytes;
+    double burstSeconds;
+
+    /**
+     * Returns the burst rate in bytes per second.
+     */
+    unsigned long long rate() const
+    { return burstSeconds > 0 ? burstBytes / burstSeconds : 0; }
+
+    /**
+     * Orders the usable targets by the total time of the probe, i.e. a
+     * slow connection setup counts as much as a slow link. Targets that
+     * take equally long keep their order.
+     *
+     * @param[in] probes the probes of all targets
+     * @return the indices into @p probes of the usable targets, fastest
+     *         first
+     */
+    static std::vector<size_t> rank(const std::vector<TargetProbe> &probes);
+};
+
+//}}}
+//{{{ FailoverTransfer ---------------------------------------------------------
+
+/**
+ * Transfer that saves every file to one of several other transfers (the
+ * "legs"), which are given in the order of preference.
+ *
+ * All files go to the first leg until it fails. Then a warning is
+ * printed, and the file is saved again to the next leg, which is used
+ * for all following files. That is possible only if the leg failed
+ * before it read any data, or if the DataProvider can start over (see
+ * DataProvider::canRestart()); otherwise the error is passed on.
+ *
+ * A KDeadlineError is always passed on, because another target would
+ * not be faster.
+ */
+class FailoverTransfer : public Transfer {
+
+    public:
+
+        /**
+         * Creates a new FailoverTransfer object without any legs.
+         */
+        FailoverTransfer();
+
+        /**
+         * Destroys the FailoverTransfer object and all child transfers.
+         */
+        ~FailoverTransfer();
+
+        /**
+         * Adds a child transfer after the existing ones. The object
+         * takes ownership of @p transfer.
+         *
+         * @param[in] transfer the child transfer
+         * @param[in] name name of the leg (for messages)
+         */
+        void addLeg(Transfer *transfer, const std::string &name);
+
+        /**
+         * Transfers the file to the current leg, and to the following
+         * legs if it fails.
+         *
+         * @exception KError if there are no legs, if the last leg
+         *            fails, or if the data cannot be read again for the
+         *            next leg
+         * @see Transfer::perform()
+         */
+        void perform(DataProvider *dataprovider,
+                     const StringVector &target_files,
+                     bool *directSave);
+
+        /**
+         * Saves the files to the current leg, and to the following legs
+         * if it fails. The files are kept in memory, so they can always
+         * be saved again.
+         *
+         * @exception KError if there are no legs or if the last leg fails
+         * @see Transfer::performBatch()
+         */
+        void performBatch(const ArtifactBatch &artifacts);
+
+        /**
+         * Returns the local directory of the current leg.
+         *
+         * @see Transfer::localDirectory()
+         */
+        std::string localDirectory();
+
+        /**
+         * Sets the reserve for all legs.
+         *
+         * @see Transfer::setFreeSpaceReserve()
+         */
+        void setFreeSpaceReserve(unsigned long long bytes);
+
+        /**
+         * Sets the expected size for all legs.
+         *
+         * @see Transfer::setExpectedSize()
+         */
+        void setExpectedSize(unsigned long long bytes);
+
+        /**
+         * Returns the name of the leg that gets the next file.
+         *
+         * @exception KError if there are no legs
+         */
+        const std::string &currentLeg() const;
+
+        /**
+         * Returns the names of the legs that have failed.
+         */
+        StringVector failedLegs() const;
+
+    private:
+        struct Leg {
+            std::unique_ptr<Transfer> transfer;
+            std::string name;
+        };
+
+        std::vector<Leg> m_legs;
+        size_t m_current;
+};
+
+//}}}
+
+#endif /* FAILOVERTRANSFER_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -31,6 +31,14 @@
 
 #include <sys/vfs.h>
 #include <sys/param.h>
+#include <sys/syscall.h>
+#include <cstddef>
+#include <vector>
+#include <map>
+#include <mutex>
+
+#include <poll.h>
+#include <linux/openat2.h>
 
 #include "dataprovider.h"
 #include "global.h"
@@ -64,6 +72,37 @@ FileDescriptor::~FileDescriptor()
         close(m_fd);
 }
 
+//}}}
+//{{{ MountWatch ---------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+MountWatch::~MountWatch()
+{
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+// -----------------------------------------------------------------------------
+bool MountWatch::changed()
+{
+    if (m_fd >= 0) {
+        struct pollfd pfd;
+        pfd.fd = m_fd;
+        pfd.events = POLLPRI;
+        pfd.revents = 0;
+        int ret = poll(&pfd, 1, 0);
+        if (ret == 0 || (ret > 0 && !(pfd.revents & (POLLPRI | POLLERR))))
+            return false;
+        close(m_fd);
+    }
+
+    // open before the caller reads the table, so that no change is missed
+    m_fd = open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0)
+        m_fd = open("/proc/mounts", O_RDONLY | O_CLOEXEC);
+    return true;
+}
+
 //}}}
 //{{{ FileUtil -----------------------------------------------------------------
 
@@ -136,6 +175,90 @@ void FileUtil::umount(const std::string &mountpoint)
 
 //}}}
 
+//{{{ DirStream ----------------------------------------------------------------
+
+// the Linux struct linux_dirent64 is laid out like the glibc struct dirent
+static_assert(offsetof(struct dirent, d_reclen) == 16 &&
+              offsetof(struct dirent, d_type) == 18 &&
+              offsetof(struct dirent, d_name) == 19,
+              "struct dirent does not match getdents64()");
+
+#define DIRSTREAM_BUFSIZE       (256 * 1024)
+
+/**
+ * Reads directory entries with getdents64() into a large buffer.
+ *
+ * readdir() fetches 32 KiB at a time, which takes many system calls
+ * for a dump directory with thousands of split files. The entries
+ * carry d_type, so callers need no stat() for most of them.
+ */
+class DirStream {
+
+    public:
+        /**
+         * Takes ownership of an open directory file descriptor.
+         *
+         * @param[in] fd the directory
+         * @param[in] path the directory name for error messages
+         */
+        DirStream(int fd, const string &path)
+            : m_fd(fd), m_path(path), m_buf(DIRSTREAM_BUFSIZE),
+              m_pos(0), m_end(0)
+        { }
+
+        ~DirStream()
+        { ::close(m_fd); }
+
+        /**
+         * Returns the directory file descriptor.
+         */
+        int fd() const
+        { return m_fd; }
+
+        /**
+         * Returns the next entry, or @c NULL at the end of the directory.
+         *
+         * @exception KSystemError if the directory cannot be read
+         */
+        const struct dirent *next();
+
+    private:
+        DirStream(const DirStream &);
+        DirStream &operator=(const DirStream &);
+
+        int m_fd;
+        string m_path;
+        std::vector<char> m_buf;
+        size_t m_pos, m_end;
+};
+
+// -----------------------------------------------------------------------------
+const struct dirent *DirStream::next()
+{
+    if (m_pos >= m_end) {
+        long ret = syscall(SYS_getdents64, m_fd, &m_buf[0], m_buf.size());
+        if (ret < 0)
+            throw KSystemError("Cannot read directory " + m_path + ".", errno);
+        if (ret == 0)
+            return NULL;
+        m_pos = 0;
+        m_end = ret;
+    }
+
+    const struct dirent *d =
+        reinterpret_cast<const struct dirent *>(&m_buf[m_pos]);
+    m_pos += d->d_reclen;
+    return d;
+}
+
+// -----------------------------------------------------------------------------
+static inline bool isDotEntry(const struct dirent *d)
+{
+    return d->d_name[0] == '.' && (d->d_name[1] == '\0' ||
+        (d->d_name[1] == '.' && d->d_name[2] == '\0'));
+}
+
+//}}}
 //{{{ FilePath -----------------------------------------------------------------
 
 const string FilePath::m_slash("/");
@@ -227,6 +350,120 @@ string FilePath::readLink() const
     return string(buffer);
 }
 
+// maximum number of cached directories and symbolic links
+#define CANONICAL_CACHE_SIZE    4096
+
+/**
+ * What getCanonicalPath() has found at a path: a directory, or a symbolic
+ * link to @c target. Missing paths are not cached, because they are
+ * usually created soon.
+ */
+struct CanonicalEntry {
+    bool link;
+    string target;
+};
+
+static std::mutex canonicalMutex;
+static std::map<string, CanonicalEntry> canonicalCache;
+static MountWatch canonicalWatch;
+
+// -----------------------------------------------------------------------------
+/**
+ * Returns the path of an open file descriptor.
+ */
+static bool fdPath(int fd, string &path)
+{
+    char link[32], buffer[PATH_MAX];
+    snprintf(link, sizeof link, "/proc/self/fd/%d", fd);
+    ssize_t ret = readlink(link, buffer, sizeof buffer);
+    if (ret <= 0 || ret == sizeof buffer || buffer[0] != '/')
+        return false;
+    path.assign(buffer, ret);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Resolves an absolute @p path in @p root with a single openat2().
+ *
+ * @return @c false if the path cannot be resolved this way, e.g. because
+ *         it does not exist or the kernel is too old
+ */
+static bool resolveInRoot(const string &root, const string &path,
+                          string &result)
+{
+    int rootfd = open(root.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (rootfd < 0)
+        return false;
+
+    struct open_how how;
+    memset(&how, 0, sizeof how);
+    how.flags = O_PATH | O_CLOEXEC;
+    how.resolve = RESOLVE_IN_ROOT | RESOLVE_NO_MAGICLINKS;
+    int fd = syscall(__NR_openat2, rootfd, path.c_str(), &how, sizeof how);
+
+    string realroot, real;
+    bool ok = fd >= 0 && fdPath(rootfd, realroot) && fdPath(fd, real);
+    if (fd >= 0)
+        close(fd);
+    close(rootfd);
+    if (!ok)
+        return false;
+
+    // the kernel returns the path from the real root; keep the
+    // caller's spelling of the root directory
+    if (realroot == "/")
+        realroot.clear();
+    if (real.compare(0, realroot.size(), realroot) != 0 ||
+        (real.size() > realroot.size() && real[realroot.size()] != '/'))
+        return false;
+
+    result = root;
+    string rest = real.substr(realroot.size());
+    if (rest.size() > 1) {
+        if (*result.rbegin() == '/')
+            result.erase(result.size() - 1);
+        result += rest;
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Directory file descriptor for the fd-relative walk.
+ */
+class WalkDir {
+        int m_fd;
+        string m_path;
+
+    public:
+        WalkDir()
+            : m_fd(-1)
+        { }
+
+        ~WalkDir()
+        { reset(); }
+
+        void reset(int fd = -1, const string &path = string())
+        {
+            if (m_fd >= 0)
+                close(m_fd);
+            m_fd = fd;
+            m_path = path;
+        }
+
+        /**
+         * Returns a descriptor of the directory @p path, or -1.
+         */
+        int get(const string &path)
+        {
+            if (m_fd < 0 || m_path != path)
+                reset(open(path.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC),
+                      path);
+            return m_fd;
+        }
+};
+
 // -----------------------------------------------------------------------------
 FilePath FilePath::getCanonicalPath(const string &root) const
 {
@@ -238,9 +475,19 @@ FilePath FilePath::getCanonicalPath(const string &root) const
 
     const string *rootp = root.empty() ? &m_slash : &root;
 
-    // Use the current directory for relative paths
+    // Resolve existing absolute paths in one step
     FilePath ret;
     const_iterator p = begin();
+    if (*p == '/' && resolveInRoot(*rootp, *this, ret))
+        return ret;
+
+    {
+        std::lock_guard<std::mutex> lock(canonicalMutex);
+        if (canonicalWatch.changed())
+            canonicalCache.clear();
+    }
+
+    // Use the current directory for relative paths
     if (*p != '/') {
         ret = getcwd();
 
@@ -253,6 +500,8 @@ FilePath FilePath::getCanonicalPath(const string &root) const
     string extra;
     int num_links = 0;
     const string *rpath = this;
+    WalkDir dir_fd;
+    bool exists = true;
     while (p != rpath->end()) {
         // Skip sequence of multiple path-separators.
         while (p != rpath->end() && *p == '/')
@@ -272,23 +521,78 @@ FilePath FilePath::getCanonicalPath(const string &root) const
         else if (dir == "..") {
             // Back up to previous component
             if (ret.size() > rootp->size())
-                ret.resize(ret.rfind('/'));
+                ret.resize(std::max(ret.rfind('/'), rootp->size()));
+            exists = true;
         } else {
+            string parent = ret;
             if (*ret.rbegin() != '/')
                 ret += '/';
             ret += dir;
 
-            struct stat st;
-            if (lstat(ret.c_str(), &st) < 0) {
-                if (errno == ENOENT)
-                    ;           // non-existent elements will be created
-                else
-                    throw KSystemError("Stat failed on " + ret, errno);
-            } else if (S_ISLNK(st.st_mode)) {
+            // non-existent elements will be created
+            if (!exists)
+                continue;
+
+            CanonicalEntry entry;
+            bool cached;
+            {
+                std::lock_guard<std::mutex> lock(canonicalMutex);
+                std::map<string, CanonicalEntry>::const_iterator it =
+                    canonicalCache.find(ret);
+                cached = it != canonicalCache.end();
+                if (cached)
+                    entry = it->second;
+            }
+
+            if (!cached) {
+                int dirfd = dir_fd.get(parent);
+                int fd = dirfd < 0 ? -1 : openat(dirfd, dir.c_str(),
+                    O_PATH | O_NOFOLLOW | O_CLOEXEC);
+                if (fd < 0) {
+                    if (dirfd >= 0 && errno != ENOENT)
+                        throw KSystemError("Stat failed on " + ret, errno);
+                    exists = false;
+                    continue;
+                }
+
+                struct stat st;
+                if (fstat(fd, &st) < 0) {
+                    int err = errno;
+                    close(fd);
+                    throw KSystemError("Stat failed on " + ret, err);
+                }
+
+                if (S_ISLNK(st.st_mode)) {
+                    char buffer[BUFSIZ];
+                    int len = readlinkat(fd, "", buffer, BUFSIZ-1);
+                    int err = errno;
+                    close(fd);
+                    if (len < 0)
+                        throw KSystemError("readlink() failed", err);
+                    entry.link = true;
+                    entry.target.assign(buffer, len);
+                } else if (S_ISDIR(st.st_mode)) {
+                    dir_fd.reset(fd, ret);
+                    entry.link = false;
+                } else {
+                    close(fd);
+                    if (p != rpath->end())
+                        throw KSystemError("getCanonicalPath() failed",
+                                           ENOTDIR);
+                    continue;
+                }
+
+                std::lock_guard<std::mutex> lock(canonicalMutex);
+                if (canonicalCache.size() >= CANONICAL_CACHE_SIZE)
+                    canonicalCache.clear();
+                canonicalCache[ret] = entry;
+            }
+
+            if (entry.link) {
                 if (rpath == &extra) {
-                    extra.replace(0, p - extra.begin(), ret.readLink());
+                    extra.replace(0, p - extra.begin(), entry.target);
                 } else {
-                    extra = ret.readLink();
+                    extra = entry.target;
                     extra.append(p, rpath->end());
                     rpath = &extra;
                 }
@@ -297,9 +601,8 @@ FilePath FilePath::getCanonicalPath(const string &root) const
                     throw KSystemError("getCanonicalPath() failed", ELOOP);
 
                 p = rpath->begin();
-                ret.resize(*p == '/' ? rootp->size() : ret.rfind('/'));
-            } else if (!S_ISDIR(st.st_mode) && p != rpath->end()) {
-                throw KSystemError("getCanonicalPath() failed", ENOTDIR);
+                ret.resize(*p == '/' ? rootp->size() :
+                           std::max(ret.rfind('/'), rootp->size()));
             }
         }
     }
@@ -307,6 +610,13 @@ FilePath FilePath::getCanonicalPath(const string &root) const
     return ret;
 }
 
+// -----------------------------------------------------------------------------
+void FilePath::clearCanonicalCache()
+{
+    std::lock_guard<std::mutex> lock(canonicalMutex);
+    canonicalCache.clear();
+}
+
 // -----------------------------------------------------------------------------
 StringVector FilePath::listDir(const ListDirFilter &filter) const
 {
@@ -315,26 +625,15 @@ StringVector FilePath::listDir(const ListDirFilter &filter) const
     Debug::debug()->trace("FileUtil::listdir(%s,%s)",
 			  c_str(), typeid(filter).name());
 
-    DIR *dirp = opendir(c_str());
-    if (!dirp)
+    int fd = open(c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
 	throw KSystemError("Cannot open directory " + *this + ".", errno);
 
-    try {
-	struct dirent *d;
-
-	errno = 0;
-	while ( (d = readdir(dirp)) ) {
-	    if (filter.test(dirfd(dirp), d))
-		v.push_back(d->d_name);
-	    errno = 0;
-	}
-	if (errno)
-	    throw KSystemError("Cannot read directory " + *this + ".", errno);
-    } catch(...) {
-	closedir(dirp);
-	throw;
-    }
-    closedir(dirp);
+    DirStream dir(fd, *this);
+    const struct dirent *d;
+    while ( (d = dir.next()) )
+	if (filter.test(dir.fd(), d))
+	    v.push_back(d->d_name);
 
     sort(v.begin(), v.end());
     return v;
@@ -353,6 +652,43 @@ unsigned long long FilePath::freeDiskSize() const
     return (unsigned long long)mystatfs.f_bfree * mystatfs.f_bsize;
 }
 
+// -----------------------------------------------------------------------------
+static unsigned long long diskUsageAt(int parent, const char *name,
+                                      const string &path)
+{
+    struct stat mystat;
+    if (fstatat(parent, name, &mystat, AT_SYMLINK_NOFOLLOW) != 0)
+        throw KSystemError("stat() on " + path + " failed.", errno);
+
+    // st_blocks is always in 512-byte units
+    unsigned long long ret = (unsigned long long)mystat.st_blocks * 512;
+    if (!S_ISDIR(mystat.st_mode))
+        return ret;
+
+    int fd = openat(parent, name,
+                    O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+        throw KSystemError("Cannot open directory " + path + ".", errno);
+
+    DirStream dir(fd, path);
+    const struct dirent *d;
+    while ((d = dir.next()) != NULL) {
+        if (isDotEntry(d))
+            continue;
+        ret += diskUsageAt(fd, d->d_name, path + "/" + d->d_name);
+    }
+
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long FilePath::diskUsage() const
+{
+    Debug::debug()->trace("FileUtil::diskUsage(%s)", c_str());
+
+    return diskUsageAt(AT_FDCWD, c_str(), *this);
+}
+
 // -----------------------------------------------------------------------------
 unsigned long long FilePath::fileSize() const
 {
@@ -399,38 +735,54 @@ void FilePath::mkdir(bool recursive)
     }
 }
 
+// -----------------------------------------------------------------------------
+static void removeTreeAt(int parent, const char *name, const string &path)
+{
+    int fd = openat(parent, name,
+                    O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+        throw KSystemError("Cannot open directory " + path + ".", errno);
+
+    {
+        DirStream dir(fd, path);
+        const struct dirent *d;
+        while ((d = dir.next()) != NULL) {
+            if (isDotEntry(d))
+                continue;
+
+            string sub = path + "/" + d->d_name;
+            bool isdir = d->d_type == DT_DIR;
+            if (d->d_type == DT_UNKNOWN) {
+                struct stat mystat;
+                if (fstatat(fd, d->d_name, &mystat, AT_SYMLINK_NOFOLLOW) != 0)
+                    throw KSystemError("stat() on " + sub + " failed.", errno);
+                isdir = S_ISDIR(mystat.st_mode);
+            }
+
+            if (isdir)
+                removeTreeAt(fd, d->d_name, sub);
+            else {
+                Debug::debug()->trace("Calling unlinkat(%s)", sub.c_str());
+                if (unlinkat(fd, d->d_name, 0) != 0)
+                    throw KSystemError("Cannot remove " + sub + ".", errno);
+            }
+        }
+    }
+
+    if (unlinkat(parent, name, AT_REMOVEDIR) != 0)
+        throw KSystemError("Cannot rmdir(" + path + ").", errno);
+}
+
 // -----------------------------------------------------------------------------
 void FilePath::rmdir(bool recursive)
 {
     Debug::debug()->trace("FileUtil::rmdir(%s, %d)", c_str(), recursive);
 
     if (recursive) {
-        DIR *dirptr = opendir(c_str());
-        if (!dirptr)
-            throw KSystemError("Cannot opendir(" + *this + ").", errno);
-        struct dirent *ptr;
-        try {
-            while ((ptr = readdir(dirptr)) != NULL) {
-                FilePath fn = *this;
-                if (strcmp(ptr->d_name, ".") == 0 ||
-                        strcmp(ptr->d_name, "..") == 0)
-                    continue;
-                if (ptr->d_type == DT_DIR)
-                    fn.appendPath(ptr->d_name).rmdir(true);
-                else {
-                    Debug::debug()->trace("Calling remove(%s)", ptr->d_name);
-                    int ret = ::remove(fn.appendPath(ptr->d_name).c_str());
-                    if (ret != 0)
-                        throw KSystemError("Cannot remove " +
-                            string(ptr->d_name) + ".", errno);
-                }
-            }
-        } catch (...) {
-            closedir(dirptr);
-            throw;
-        }
-        closedir(dirptr);
+        removeTreeAt(AT_FDCWD, c_str(), *this);
+        return;
     }
+
     int ret = ::rmdir(c_str());
     if (ret != 0)
         throw KSystemError("Cannot rmdir(" + *this + ").", errno);
@@ -479,10 +831,25 @@ bool FilterKdumpDirs::test(int dirfd, const struct dirent *d) const
     if (!FilterDotsAndNondirs::test(dirfd, d))
 	return false;
 
+    return isDump(dirfd, d->d_name);
+}
+
+// -----------------------------------------------------------------------------
+bool FilterKdumpDirs::isDump(int dirfd, const char *name)
+{
+    // deduplicated dumps have a map instead of the dump file, and split
+    // dumps have numbered parts until they are reassembled
+    static const char *const names[] = {
+        "vmcore", "vmcore.dedup", "vmcore.zst", "vmcore1"
+    };
     struct stat mystat;
-    FilePath vmcore(d->d_name);
-    vmcore.appendPath("vmcore");
-    return fstatat(dirfd, vmcore.c_str(), &mystat, 0) == 0;
+    for (size_t i = 0; i < sizeof names / sizeof names[0]; ++i) {
+        FilePath vmcore(name);
+        vmcore.appendPath(names[i]);
+        if (fstatat(dirfd, vmcore.c_str(), &mystat, 0) == 0)
+            return true;
+    }
+    return false;
 }
 //}}}
 
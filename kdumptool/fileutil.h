@@ -40,6 +40,38 @@ class FileDescriptor {
 	{ return m_fd; }
 };
 
+//}}}
+//{{{ MountWatch ---------------------------------------------------------------
+
+/**
+ * Notices changes of the mount table of the process.
+ *
+ * The kernel flags an open /proc/self/mountinfo with POLLPRI after each
+ * mount, unmount or remount in the mount namespace.
+ */
+class MountWatch {
+        int m_fd;
+
+    public:
+        MountWatch()
+            : m_fd(-1)
+        { }
+
+        ~MountWatch();
+
+        /**
+         * Checks for changes since the previous call.
+         *
+         * @return @c true if the mount table may have changed, always for
+         *         the first call and if changes cannot be detected
+         */
+        bool changed();
+
+    private:
+        MountWatch(const MountWatch &);
+        MountWatch &operator=(const MountWatch &);
+};
+
 //}}}
 //{{{ FileUtil -----------------------------------------------------------------
 
@@ -213,6 +245,12 @@ class FilePath : public KString {
          * This means that all symbolic links are resolved. It does that
          * as if the root directory was @p root.
          *
+         * An absolute path is resolved with openat2(RESOLVE_IN_ROOT). If
+         * that fails, e.g. because the path does not exist yet, the
+         * components are walked one by one relative to their directory.
+         * The directories and symbolic links seen by the walk are cached
+         * until the mount table changes (see clearCanonicalCache()).
+         *
          * @param[in] root the new root where the function should chroot to
          * @return the canonical representation of the path
          *
@@ -220,6 +258,12 @@ class FilePath : public KString {
          */
         FilePath getCanonicalPath(const std::string &root = m_slash) const;
 
+        /**
+         * Forgets the directories and symbolic links that have been seen
+         * by getCanonicalPath(), e.g. after a symbolic link is replaced.
+         */
+        static void clearCanonicalCache();
+
         /**
          * Returns the size of a given file.
          *
@@ -248,6 +292,15 @@ class FilePath : public KString {
          */
         unsigned long long freeDiskSize() const;
 
+        /**
+         * Gets the disk space used by a file or a directory tree, like
+         * <tt>du -s</tt>. Holes of sparse files are not counted.
+         *
+         * @return the allocated size in bytes
+         * @exception KError if a file cannot be accessed
+         */
+        unsigned long long diskUsage() const;
+
         /**
          * Creates a new directory in the specified path.
          *
@@ -298,6 +351,12 @@ class FilterKdumpDirs : public FilterDotsAndNondirs {
 	{}
 
 	bool test(int dirfd, const struct dirent *d) const;
+
+	/**
+	 * Returns @c true if the directory @p name (relative to @p dirfd)
+	 * contains a dump file.
+	 */
+	static bool isDump(int dirfd, const char *name);
 };
 //}}}
 //{{{ Functions ----------------------------------------------------------------
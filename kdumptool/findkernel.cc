@@ -18,6 +18,11 @@
  */
 #include <iostream>
 #include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <algorithm>
+#include <exception>
 #include <zlib.h>
 #include <libelf.h>
 #include <gelf.h>
@@ -35,6 +40,7 @@
 #include "kconfig.h"
 #include "stringvector.h"
 #include "kernelpath.h"
+#include "taskgraph.h"
 
 using std::string;
 using std::cout;
@@ -54,6 +60,11 @@ using std::list;
  */
 #define MAXCPUS_KDUMP 1024
 
+/**
+ * Number of kernel images that are checked at once.
+ */
+#define FINDKERNEL_THREADS 4
+
 //{{{ FindKernel ---------------------------------------------------------------
 
 // -----------------------------------------------------------------------------
@@ -132,6 +143,16 @@ void FindKernel::execute()
 // -----------------------------------------------------------------------------
 bool FindKernel::suitableForKdump(const string &kernelImage, bool strict)
 {
+    ImageCheck check = checkImage(kernelImage);
+    return strict ? check.strict : check.suitable;
+}
+
+// -----------------------------------------------------------------------------
+FindKernel::ImageCheck FindKernel::checkImage(const string &kernelImage)
+{
+    ImageCheck ret;
+    ret.suitable = ret.strict = false;
+
     KernelTool kt(kernelImage);
 
     // if that's not a special kdump kernel, it must be relocatable
@@ -144,59 +165,58 @@ bool FindKernel::suitableForKdump(const string &kernelImage, bool strict)
         Debug::debug()->dbg("%s is %s", kernelImage.c_str(),
             relocatable ? "relocatable" : "not relocatable");
         if (!relocatable) {
-            return false;
+            return ret;
         }
     }
 
-    Kconfig *kconfig = kt.retrieveKernelConfig();
+    KconfigQuery kconfig(StringVector {
+            "CONFIG_X86_64_XEN", "CONFIG_X86_XEN",
+            "CONFIG_NR_CPUS", "CONFIG_PREEMPT_RT"
+        });
+    kt.queryKernelConfig(kconfig);
     KconfigValue kv;
     bool isxen;
 
     // Avoid Xenlinux kernels, because they do not run on bare metal
-    kv = kconfig->get("CONFIG_X86_64_XEN");
+    kv = kconfig.get("CONFIG_X86_64_XEN");
     isxen = (kv.getType() == KconfigValue::T_TRISTATE &&
              kv.getTristateValue() == KconfigValue::ON);
     if (!isxen) {
-        kv = kconfig->get("CONFIG_X86_XEN");
+        kv = kconfig.get("CONFIG_X86_XEN");
         isxen = (kv.getType() == KconfigValue::T_TRISTATE &&
                  kv.getTristateValue() == KconfigValue::ON);
     }
     if (isxen) {
         Debug::debug()->dbg("%s is a Xen kernel. Avoid.",
             kernelImage.c_str());
-	delete kconfig;
-	return false;
+        return ret;
     }
-
-    if (strict) {
-        string arch = Util::getArch();
-
-        // avoid large number of CPUs on x86 since that increases
-        // memory size constraints of the capture kernel
-        if (arch == "i386" || arch == "x86_64") {
-            kv = kconfig->get("CONFIG_NR_CPUS");
-            if (kv.getType() == KconfigValue::T_INTEGER &&
-                    kv.getIntValue() > MAXCPUS_KDUMP) {
-                Debug::debug()->dbg("NR_CPUS of %s is %d >= %d. Avoid.",
-                    kernelImage.c_str(), kv.getIntValue(), MAXCPUS_KDUMP);
-                delete kconfig;
-                return false;
-            }
-        }
-
-        // avoid realtime kernels
-        kv = kconfig->get("CONFIG_PREEMPT_RT");
-        if (kv.getType() != KconfigValue::T_INVALID) {
-            Debug::debug()->dbg("%s is realtime kernel. Avoid.",
-                kernelImage.c_str());
-            delete kconfig;
-            return false;
+    ret.suitable = true;
+
+    string arch = Util::getArch();
+
+    // avoid large number of CPUs on x86 since that increases
+    // memory size constraints of the capture kernel
+    if (arch == "i386" || arch == "x86_64") {
+        kv = kconfig.get("CONFIG_NR_CPUS");
+        if (kv.getType() == KconfigValue::T_INTEGER &&
+                kv.getIntValue() > MAXCPUS_KDUMP) {
+            Debug::debug()->dbg("NR_CPUS of %s is %d >= %d. Avoid.",
+                kernelImage.c_str(), kv.getIntValue(), MAXCPUS_KDUMP);
+            return ret;
         }
     }
 
-    delete kconfig;
+    // avoid realtime kernels
+    kv = kconfig.get("CONFIG_PREEMPT_RT");
+    if (kv.getType() != KconfigValue::T_INVALID) {
+        Debug::debug()->dbg("%s is realtime kernel. Avoid.",
+            kernelImage.c_str());
+        return ret;
+    }
 
-    return true;
+    ret.strict = true;
+    return ret;
 }
 
 // -----------------------------------------------------------------------------
@@ -229,86 +249,95 @@ FilePath FindKernel::findKernelAuto()
 
     KString runningkernel = Util::getKernelRelease();
     Debug::debug()->trace("Running kernel: %s", runningkernel.c_str());
-    
+
     // $(uname -r) == KERNELVERSION
     // KERNELVERSION := BASEVERSION + '-' + FLAVOUR
-
-    // 1. Use BASEVERSION-kdump
     StringVector elements = runningkernel.split('-');
     elements[elements.size()-1] = "kdump";
-    string testkernel = elements.join('-');
-    Debug::debug()->dbg("---------------");
-    Debug::debug()->dbg("findKernelAuto: Trying %s", testkernel.c_str());
-    FilePath testkernelimage = findForVersion(testkernel);
-    if (testkernelimage.size() > 0 && suitableForKdump(testkernelimage, true)) {
-        return testkernelimage;
-    }
-
-    // 2. Use kdump
-    testkernel = "kdump";
-    Debug::debug()->dbg("---------------");
-    Debug::debug()->dbg("findKernelAuto: Trying %s", testkernel.c_str());
-    testkernelimage = findForVersion(testkernel);
-    if (testkernelimage.size() > 0 && suitableForKdump(testkernelimage, true)) {
-        return testkernelimage;
-    }
-
-    // 3. Use KERNELVERSION
-    testkernel = runningkernel;
-    Debug::debug()->dbg("---------------");
-    Debug::debug()->dbg("findKernelAuto: Trying %s", testkernel.c_str());
-    testkernelimage = findForVersion(testkernel);
-    if (testkernelimage.size() > 0 && suitableForKdump(testkernelimage, true)) {
-        return testkernelimage;
-    }
-
-    // 4. Use BASEVERSION-default
-    elements = runningkernel.split('-');
+    string basekdump = elements.join('-');
     elements[elements.size()-1] = "default";
-    testkernel = elements.join('-');
-    Debug::debug()->dbg("---------------");
-    Debug::debug()->dbg("findKernelAuto: Trying %s", testkernel.c_str());
-    testkernelimage = findForVersion(testkernel);
-    if (testkernelimage.size() > 0 && suitableForKdump(testkernelimage, true)) {
-        return testkernelimage;
-    }
-
-    // 5. Use ""
-    testkernel = "";
-    Debug::debug()->dbg("---------------");
-    Debug::debug()->dbg("findKernelAuto: Trying %s", testkernel.c_str());
-    testkernelimage = findForVersion(testkernel);
-    if (testkernelimage.size() > 0 && suitableForKdump(testkernelimage, true)) {
-        return testkernelimage;
-    }
+    string basedefault = elements.join('-');
+
+    // the candidates in the order of preference; the strict checks
+    // apply to the first pass only
+    struct Candidate {
+        string version;
+        bool strict;
+    } const candidates[] = {
+        { basekdump, true },        // 1. Use BASEVERSION-kdump
+        { "kdump", true },          // 2. Use kdump
+        { runningkernel, true },    // 3. Use KERNELVERSION
+        { basedefault, true },      // 4. Use BASEVERSION-default
+        { "", true },               // 5. Use ""
+        { runningkernel, false },   // 6. Use KERNELVERSION unstrict
+        { basedefault, false },     // 7. Use BASEVERSION-default unstrict
+        { "", false },              // 8. Use "" unstrict
+    };
+    const size_t count = sizeof candidates / sizeof candidates[0];
+
+    // each image is checked only once, even if several candidates (or
+    // both passes) lead to it, e.g. through the /boot/vmlinuz symlink;
+    // the kdump kernel check depends on the name, so it is part of the key
+    struct Result {
+        FilePath image;
+        ImageCheck check;
+        std::exception_ptr error;
+    };
+    typedef std::map<std::pair<string, bool>, Result> ResultMap;
+    ResultMap results;
+    std::vector<FilePath> images;
+    std::vector<ResultMap::iterator> found;
+    for (size_t i = 0; i < count; ++i) {
+        FilePath image = findForVersion(candidates[i].version);
+        images.push_back(image);
+        if (image.size() == 0) {
+            found.push_back(results.end());
+            continue;
+        }
 
-    // 6. Use KERNELVERSION unstrict
-    testkernel = runningkernel;
-    Debug::debug()->dbg("---------------");
-    Debug::debug()->dbg("findKernelAuto: Trying %s", testkernel.c_str());
-    testkernelimage = findForVersion(testkernel);
-    if (testkernelimage.size() > 0 && suitableForKdump(testkernelimage, false)) {
-        return testkernelimage;
+        string key;
+        try {
+            key = image.getCanonicalPath();
+        } catch (const KError &) {
+            key = image;
+        }
+        ResultMap::iterator it = results.insert(std::make_pair(
+            std::make_pair(key, isKdumpKernel(image)), Result())).first;
+        if (it->second.image.size() == 0)
+            it->second.image = image;
+        found.push_back(it);
     }
 
-    // 7. Use BASEVERSION-default unstrict
-    elements = runningkernel.split('-');
-    elements[elements.size()-1] = "default";
-    testkernel = elements.join('-');
-    Debug::debug()->dbg("---------------");
-    Debug::debug()->dbg("findKernelAuto: Trying %s", testkernel.c_str());
-    testkernelimage = findForVersion(testkernel);
-    if (testkernelimage.size() > 0 && suitableForKdump(testkernelimage, false)) {
-        return testkernelimage;
+    // check all images concurrently; errors are only reported if the
+    // image is reached in the order of preference below
+    TaskGraph graph(std::min<size_t>(results.size(), FINDKERNEL_THREADS));
+    ResultMap::iterator it;
+    for (it = results.begin(); it != results.end(); ++it) {
+        Result &result = it->second;
+        graph.add(result.image, [this, &result]() {
+                try {
+                    result.check = checkImage(result.image);
+                } catch (...) {
+                    result.error = std::current_exception();
+                }
+            });
     }
-
-    // 8. Use "" unstrict
-    testkernel = "";
-    Debug::debug()->dbg("---------------");
-    Debug::debug()->dbg("findKernelAuto: Trying %s", testkernel.c_str());
-    testkernelimage = findForVersion(testkernel);
-    if (testkernelimage.size() > 0 && suitableForKdump(testkernelimage, false)) {
-        return testkernelimage;
+    graph.run();
+
+    for (size_t i = 0; i < count; ++i) {
+        Debug::debug()->dbg("---------------");
+        Debug::debug()->dbg("findKernelAuto: Trying %s%s",
+                            candidates[i].version.c_str(),
+                            candidates[i].strict ? "" : " (unstrict)");
+        if (found[i] == results.end())
+            continue;
+
+        const Result &result = found[i]->second;
+        if (result.error)
+            std::rethrow_exception(result.error);
+        if (candidates[i].strict ? result.check.strict
+                                 : result.check.suitable)
+            return images[i];
     }
 
     return "";
@@ -76,6 +76,24 @@ class FindKernel : public Subcommand {
          */
         bool suitableForKdump(const std::string &kernelImage, bool strict);
 
+        /**
+         * Result of checkImage().
+         */
+        struct ImageCheck {
+            bool suitable;      // suitableForKdump(image, false)
+            bool strict;        // suitableForKdump(image, true)
+        };
+
+        /**
+         * Runs the checks of suitableForKdump() for both values of
+         * @c strict at once. May be called from several threads.
+         *
+         * @param[in] kernelImage full path to the kernel image
+         * @return the results of the checks
+         * @exception KError see suitableForKdump()
+         */
+        ImageCheck checkImage(const std::string &kernelImage);
+
         /**
          * Checks if the given kernel image is a kdump kernel. Currently
          * only name matching is done.
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstring>
+#include <algorithm>
+#include <stdint.h>
+
+#include "global.h"
+#include "debug.h"
+#include "stringutil.h"
+#include "flattened.h"
+#include "probes.h"
+
+using std::string;
+
+//{{{ FlattenedDataProvider ----------------------------------------------------
+
+// -----------------------------------------------------------------------------
+FlattenedDataProvider::FlattenedDataProvider(DataProvider *forward)
+    : m_forward(forward), m_placed(false), m_started(false), m_end(false),
+      m_offset(0), m_remaining(0)
+{}
+
+// -----------------------------------------------------------------------------
+void FlattenedDataProvider::prepare()
+{
+    m_started = m_end = false;
+    m_offset = 0;
+    m_remaining = 0;
+    m_chunks.reset();
+    m_forward->prepare();
+}
+
+// -----------------------------------------------------------------------------
+bool FlattenedDataProvider::canSaveToFile() const
+{
+    return m_forward->canSaveToFile();
+}
+
+// -----------------------------------------------------------------------------
+void FlattenedDataProvider::saveToFile(const StringVector &targets)
+{
+    m_forward->saveToFile(targets);
+}
+
+// -----------------------------------------------------------------------------
+size_t FlattenedDataProvider::getData(char *buffer, size_t maxread)
+{
+    return m_forward->getData(buffer, maxread);
+}
+
+// -----------------------------------------------------------------------------
+bool FlattenedDataProvider::canSplice() const
+{
+    return m_forward->canSplice();
+}
+
+// -----------------------------------------------------------------------------
+size_t FlattenedDataProvider::spliceData(int fd)
+{
+    return m_forward->spliceData(fd);
+}
+
+// -----------------------------------------------------------------------------
+bool FlattenedDataProvider::canMapData() const
+{
+    return m_forward->canMapData();
+}
+
+// -----------------------------------------------------------------------------
+size_t FlattenedDataProvider::mapData(const char **data, size_t maxread)
+{
+    return m_forward->mapData(data, maxread);
+}
+
+// -----------------------------------------------------------------------------
+bool FlattenedDataProvider::canPlaceData() const
+{
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+static int64_t getBE64(const unsigned char *p)
+{
+    uint64_t val = 0;
+    for (int i = 0; i < 8; ++i)
+        val = (val << 8) | p[i];
+    return val;
+}
+
+// -----------------------------------------------------------------------------
+void FlattenedDataProvider::readFully(char *buffer, size_t len, bool *eof)
+{
+    size_t done = 0;
+    while (done < len) {
+        size_t ret = m_forward->getData(buffer + done, len - done);
+        if (ret == 0) {
+            // the end is only allowed before a record
+            if (eof && done == 0) {
+                *eof = true;
+                return;
+            }
+            throw KError("Unexpected end of the flattened dump.");
+        }
+        done += ret;
+    }
+}
+
+// -----------------------------------------------------------------------------
+bool FlattenedDataProvider::validHeader(const unsigned char *header)
+{
+    return memcmp(header, FLAT_SIGNATURE, sizeof FLAT_SIGNATURE) == 0 &&
+        getBE64(header + 16) == FLAT_TYPE &&
+        getBE64(header + 24) == FLAT_VERSION;
+}
+
+// -----------------------------------------------------------------------------
+bool FlattenedDataProvider::parseRecord(const unsigned char *record,
+                                        off_t *offset, off_t *size)
+{
+    int64_t recOffset = getBE64(record);
+    int64_t recSize = getBE64(record + 8);
+    if (recOffset == FLAT_END_FLAG && recSize == FLAT_END_FLAG)
+        return false;
+    if (recOffset < 0 || recSize < 0)
+        throw KError("Invalid record in the flattened dump at offset " +
+                     StringUtil::number2hex(recOffset) + ".");
+
+    *offset = recOffset;
+    *size = recSize;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+void FlattenedDataProvider::readHeader()
+{
+    unsigned char header[FLAT_HEADER_SIZE];
+    readFully(reinterpret_cast<char *>(header), sizeof header, NULL);
+    if (!validHeader(header))
+        throw KError("The dump is not in makedumpfile flattened format.");
+
+    m_started = true;
+}
+
+// -----------------------------------------------------------------------------
+size_t FlattenedDataProvider::getPlacedData(char *buffer, size_t maxread,
+                                            off_t *offset)
+{
+    m_placed = true;
+    if (!m_started)
+        readHeader();
+
+    while (m_remaining == 0) {
+        if (m_end)
+            return 0;
+
+        unsigned char record[FLAT_RECORD_SIZE];
+        bool eof = false;
+        readFully(reinterpret_cast<char *>(record), sizeof record, &eof);
+        if (eof)
+            throw KError("The flattened dump has no end record.");
+
+        if (!parseRecord(record, &m_offset, &m_remaining)) {
+            m_end = true;
+            return 0;
+        }
+        KDUMP_PROBE2(flattened_record, m_offset, m_remaining);
+    }
+
+    size_t len = std::min<off_t>(maxread, m_remaining);
+    size_t ret = m_forward->getData(buffer, len);
+    if (ret == 0)
+        throw KError("Unexpected end of the flattened dump.");
+
+    *offset = m_offset;
+    m_offset += ret;
+    m_remaining -= ret;
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+size_t FlattenedDataProvider::getChunk(DataChunk &chunk, size_t maxread)
+{
+    return m_chunks.get(this, chunk, maxread);
+}
+
+// -----------------------------------------------------------------------------
+void FlattenedDataProvider::finish()
+{
+    m_forward->finish();
+}
+
+// -----------------------------------------------------------------------------
+void FlattenedDataProvider::setError(bool error)
+{
+    m_forward->setError(error);
+}
+
+// -----------------------------------------------------------------------------
+void FlattenedDataProvider::setProgress(Progress *progress)
+{
+    m_forward->setProgress(progress);
+}
+
+// -----------------------------------------------------------------------------
+bool FlattenedDataProvider::canRestart() const
+{
+    return m_forward->canRestart();
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
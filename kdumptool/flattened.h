@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef FLATTENED_H
+#define FLATTENED_H
+
+#include <sys/types.h>
+
+#include "global.h"
+#include "dataprovider.h"
+
+// see makedumpfile.h: the file header is padded to this size
+#define FLAT_HEADER_SIZE	4096
+
+// size of the header of each record
+#define FLAT_RECORD_SIZE	16
+
+// contents of the file header (big endian, like the records)
+#define FLAT_SIGNATURE		"makedumpfile"
+#define FLAT_TYPE		1
+#define FLAT_VERSION		1
+
+// offset and size of the end record
+#define FLAT_END_FLAG		(-1LL)
+
+//{{{ FlattenedDataProvider ----------------------------------------------------
+
+/**
+ * Decorator for a DataProvider that produces the makedumpfile flattened
+ * format (makedumpfile -F). That format is a sequence of records, each
+ * with the offset and size of the data that follows.
+ *
+ * DataProvider::getData() returns the flattened stream unchanged, which
+ * must be rearranged later with makedumpfile -R. A Transfer that can
+ * write at any offset uses DataProvider::getPlacedData() instead, which
+ * parses the records, so that the target is a normal dump file.
+ */
+class FlattenedDataProvider : public DataProvider {
+
+    public:
+
+        /**
+         * Wraps a DataProvider.
+         *
+         * @param[in] forward the DataProvider that provides the
+         *            flattened data
+         */
+        FlattenedDataProvider(DataProvider *forward);
+
+        void prepare();
+        bool canSaveToFile() const;
+        void saveToFile(const StringVector &targets);
+        size_t getData(char *buffer, size_t maxread);
+        bool canSplice() const;
+        size_t spliceData(int fd);
+        bool canMapData() const;
+        size_t mapData(const char **data, size_t maxread);
+
+        /**
+         * Returns @c true.
+         */
+        bool canPlaceData() const;
+
+        /**
+         * Returns the data of the next record (or a part of it).
+         *
+         * @see DataProvider::getPlacedData()
+         * @exception KError if the data is not in flattened format
+         */
+        size_t getPlacedData(char *buffer, size_t maxread, off_t *offset);
+
+        /**
+         * Reads placed data into chunks from the pool.
+         *
+         * @see DataProvider::getChunk()
+         */
+        size_t getChunk(DataChunk &chunk, size_t maxread);
+
+        void finish();
+        void setError(bool error);
+        void setProgress(Progress *progress);
+        bool canRestart() const;
+
+        /**
+         * Returns @c true if the data has been placed, i.e. the target
+         * file does not need to be rearranged.
+         */
+        bool placed() const
+        { return m_placed; }
+
+        /**
+         * Checks the file header of the flattened format.
+         *
+         * @param[in] header the first FLAT_HEADER_SIZE bytes
+         * @return @c true if the header is valid
+         */
+        static bool validHeader(const unsigned char *header);
+
+        /**
+         * Parses the header of a record.
+         *
+         * @param[in] record FLAT_RECORD_SIZE bytes
+         * @param[out] offset the offset of the data in the target file
+         * @param[out] size the size of the data after the record header
+         * @return @c false for the end record
+         * @exception KError if the record header is invalid
+         */
+        static bool parseRecord(const unsigned char *record,
+                                off_t *offset, off_t *size);
+
+    private:
+        void readFully(char *buffer, size_t len, bool *eof);
+        void readHeader();
+
+        DataProvider *m_forward;
+        bool m_placed;
+        bool m_started;
+        bool m_end;
+        off_t m_offset;
+        off_t m_remaining;
+        ChunkAdapter m_chunks;
+};
+
+//}}}
+
+#endif /* FLATTENED_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
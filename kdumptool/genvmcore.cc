@@ -0,0 +1,416 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <stdint.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+
+#include "global.h"
+
+using std::cerr;
+using std::endl;
+using std::string;
+using std::vector;
+
+#define PAGE_SIZE           4096ULL
+#define MiB                 (1ULL << 20)
+#define GiB                 (1ULL << 30)
+
+// x86_64 layout: the direct mapping and the kernel text
+#define DIRECT_MAP_BASE     0xffff888000000000ULL
+#define KERNEL_TEXT_BASE    0xffffffff81000000ULL
+#define KERNEL_TEXT_PHYS    0x1000000ULL
+#define KERNEL_TEXT_SIZE    (32 * MiB)
+
+// the PCI hole below 4 GiB
+#define LOW_MEM_END         (3 * GiB)
+#define HIGH_MEM_START      (4 * GiB)
+
+// struct elf_prstatus on x86_64
+#define PRSTATUS_SIZE       336
+
+#define WRITE_CHUNK         (4 * MiB)
+
+#if defined(__x86_64__)
+#   define ELF_MACHINE      EM_X86_64
+#elif defined(__aarch64__)
+#   define ELF_MACHINE      EM_AARCH64
+#elif defined(__powerpc64__)
+#   define ELF_MACHINE      EM_PPC64
+#elif defined(__s390x__)
+#   define ELF_MACHINE      EM_S390
+#else
+#   define ELF_MACHINE      EM_X86_64
+#endif
+
+/**
+ * Page contents. A fixed share of the pages is zero (these are holes in
+ * the file) and another share is text-like and compresses well; the rest
+ * is random. The type and the contents of a page only depend on its
+ * physical address, so the same options give the same file.
+ */
+struct ContentMix {
+    unsigned zero_pct;
+    unsigned text_pct;
+};
+
+struct Segment {
+    unsigned long long vaddr;
+    unsigned long long paddr;
+    unsigned long long size;
+    unsigned long long offset;
+};
+
+// -----------------------------------------------------------------------------
+static inline uint64_t mix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Fills one page and returns @c false if it is a zero page.
+ */
+static bool fillPage(char *page, unsigned long long paddr,
+                     const ContentMix &mix)
+{
+    static const char words[] =
+        "task_struct mm_struct inode dentry page slab kmalloc-64 "
+        "sched_entity rq cfs_rq vm_area_struct file pipe_inode_info ";
+    uint64_t h = mix64(paddr / PAGE_SIZE);
+    unsigned pct = h % 100;
+
+    if (pct < mix.zero_pct)
+        return false;
+
+    if (pct < mix.zero_pct + mix.text_pct) {
+        size_t start = (h >> 8) % (sizeof words - 1);
+        for (size_t pos = 0; pos < PAGE_SIZE; ++pos)
+            page[pos] = words[(start + pos) % (sizeof words - 1)];
+        return true;
+    }
+
+    uint64_t x = h | 1;
+    for (size_t pos = 0; pos < PAGE_SIZE; pos += sizeof x) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        memcpy(page + pos, &x, sizeof x);
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+static void addNote(string &notes, const char *name, Elf64_Word type,
+                    const string &desc)
+{
+    Elf64_Nhdr nhdr;
+    nhdr.n_namesz = strlen(name) + 1;
+    nhdr.n_descsz = desc.size();
+    nhdr.n_type = type;
+
+    notes.append(reinterpret_cast<const char *>(&nhdr), sizeof nhdr);
+    notes.append(name, nhdr.n_namesz);
+    notes.append((4 - nhdr.n_namesz % 4) % 4, '\0');
+    notes.append(desc);
+    notes.append((4 - desc.size() % 4) % 4, '\0');
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Returns a VMCOREINFO like the one of a real kernel. The addresses
+ * are not meaningful; they only need to be there.
+ */
+static string vmcoreinfo(const string &release, unsigned long long memory)
+{
+    std::ostringstream ss;
+    ss << "OSRELEASE=" << release << '\n'
+       << "BUILD-ID=" << std::hex << mix64(memory) << mix64(~memory)
+       << std::dec << '\n'
+       << "PAGESIZE=" << PAGE_SIZE << '\n'
+       << "SYMBOL(init_uts_ns)=ffffffff82a16fa0\n"
+       << "OFFSET(uts_namespace.name)=0\n"
+       << "SYMBOL(node_online_map)=ffffffff82b1e0c8\n"
+       << "SYMBOL(swapper_pg_dir)=ffffffff82a0a000\n"
+       << "SYMBOL(_stext)=ffffffff81000000\n"
+       << "SYMBOL(vmap_area_list)=ffffffff82a77a50\n"
+       << "SYMBOL(mem_section)=ffff88813fff9000\n"
+       << "LENGTH(mem_section)=2048\n"
+       << "SIZE(mem_section)=16\n"
+       << "OFFSET(mem_section.section_mem_map)=0\n"
+       << "NUMBER(SECTION_SIZE_BITS)=27\n"
+       << "NUMBER(MAX_PHYSMEM_BITS)=46\n"
+       << "SIZE(page)=64\n"
+       << "SIZE(pglist_data)=174400\n"
+       << "SIZE(zone)=1600\n"
+       << "SIZE(free_area)=88\n"
+       << "SIZE(list_head)=16\n"
+       << "SIZE(nodemask_t)=128\n"
+       << "OFFSET(page.flags)=0\n"
+       << "OFFSET(page._refcount)=52\n"
+       << "OFFSET(page.mapping)=24\n"
+       << "OFFSET(page.lru)=8\n"
+       << "OFFSET(page._mapcount)=48\n"
+       << "OFFSET(page.private)=40\n"
+       << "OFFSET(page.compound_head)=8\n"
+       << "LENGTH(zone.free_area)=11\n"
+       << "NUMBER(PG_lru)=4\n"
+       << "NUMBER(PG_private)=13\n"
+       << "NUMBER(PG_swapcache)=10\n"
+       << "NUMBER(PG_swapbacked)=19\n"
+       << "NUMBER(PG_slab)=9\n"
+       << "NUMBER(PG_hwpoison)=23\n"
+       << "NUMBER(PAGE_BUDDY_MAPCOUNT_VALUE)=-129\n"
+       << "NUMBER(phys_base)=0\n"
+       << "SYMBOL(init_top_pgt)=ffffffff82a0a000\n"
+       << "NUMBER(pgtable_l5_enabled)=0\n"
+       << "NUMBER(KERNELOFFSET)=0\n"
+       << "KERNELOFFSET=0\n"
+       << "CRASHTIME=" << time(NULL) << '\n';
+    return ss.str();
+}
+
+// -----------------------------------------------------------------------------
+static void writeAll(int fd, const void *buf, size_t len, off_t offset)
+{
+    const char *p = static_cast<const char *>(buf);
+    while (len > 0) {
+        ssize_t n = pwrite(fd, p, len, offset);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw KSystemError("Cannot write the dump", errno);
+        }
+        p += n;
+        len -= n;
+        offset += n;
+    }
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Writes the pages of a segment. Zero pages are left out, so they are
+ * holes in a sparse file.
+ */
+static void writeSegment(int fd, const Segment &seg, const ContentMix &mix)
+{
+    vector<char> buf(WRITE_CHUNK);
+
+    for (unsigned long long done = 0; done < seg.size; ) {
+        unsigned long long len = std::min(WRITE_CHUNK, seg.size - done);
+        size_t run = 0;         // bytes of non-zero pages in buf
+        off_t runStart = seg.offset + done;
+
+        for (unsigned long long pos = 0; pos < len; pos += PAGE_SIZE) {
+            if (fillPage(&buf[run], seg.paddr + done + pos, mix)) {
+                run += PAGE_SIZE;
+                continue;
+            }
+            if (run)
+                writeAll(fd, &buf[0], run, runStart);
+            run = 0;
+            runStart = seg.offset + done + pos + PAGE_SIZE;
+        }
+        if (run)
+            writeAll(fd, &buf[0], run, runStart);
+        done += len;
+    }
+}
+
+// -----------------------------------------------------------------------------
+static void usage(const char *prog)
+{
+    cerr << "Usage: " << prog << " [options] file" << endl
+         << endl
+         << "  -s, --size MiB       memory of the crashed system (1024)" << endl
+         << "  -z, --zero PERCENT   share of zero pages (50)" << endl
+         << "  -t, --text PERCENT   share of compressible pages (25)" << endl
+         << "  -c, --cpus N         number of CPUs (4)" << endl
+         << "  -r, --release REL    kernel release (the running one)" << endl;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Generates a synthetic ELF dump like /proc/vmcore for benchmarks of
+ * save_dump: the notes of each CPU, a VMCOREINFO note, PT_LOAD segments
+ * for the RAM (with the usual holes below 1 MiB and 4 GiB) and the kernel
+ * text, and a mix of zero, compressible and random pages.
+ */
+int main(int argc, char *argv[])
+{
+    unsigned long long size = 1024;
+    ContentMix mix = { 50, 25 };
+    unsigned cpus = 4;
+    string release;
+
+    static const struct option opts[] = {
+        { "size",    required_argument, NULL, 's' },
+        { "zero",    required_argument, NULL, 'z' },
+        { "text",    required_argument, NULL, 't' },
+        { "cpus",    required_argument, NULL, 'c' },
+        { "release", required_argument, NULL, 'r' },
+        { "help",    no_argument,       NULL, 'h' },
+        { NULL,      0,                 NULL, 0 }
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "s:z:t:c:r:h", opts, NULL)) != -1) {
+        switch (c) {
+            case 's': size = strtoull(optarg, NULL, 0); break;
+            case 'z': mix.zero_pct = strtoul(optarg, NULL, 0); break;
+            case 't': mix.text_pct = strtoul(optarg, NULL, 0); break;
+            case 'c': cpus = strtoul(optarg, NULL, 0); break;
+            case 'r': release = optarg; break;
+            default:
+                usage(argv[0]);
+                return c == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (optind != argc - 1 || size < 64 ||
+        mix.zero_pct + mix.text_pct > 100 || cpus < 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (release.empty()) {
+        struct utsname uts;
+        uname(&uts);
+        release = uts.release;
+    }
+
+    try {
+        unsigned long long memory = size * MiB;
+
+        // notes
+        string notes, prstatus(PRSTATUS_SIZE, '\0');
+        for (unsigned cpu = 0; cpu < cpus; ++cpu) {
+            // pr_pid is at offset 32
+            uint32_t pid = cpu + 1;
+            memcpy(&prstatus[32], &pid, sizeof pid);
+            addNote(notes, "CORE", NT_PRSTATUS, prstatus);
+        }
+        addNote(notes, "VMCOREINFO", 0, vmcoreinfo(release, memory));
+
+        // RAM below 640 KiB, up to the PCI hole and above 4 GiB
+        vector<Segment> segs;
+        Segment seg;
+        seg.vaddr = KERNEL_TEXT_BASE;
+        seg.paddr = KERNEL_TEXT_PHYS;
+        seg.size = KERNEL_TEXT_SIZE;
+        segs.push_back(seg);
+
+        unsigned long long low = std::min(memory, LOW_MEM_END);
+        unsigned long long ranges[][2] = {
+            { PAGE_SIZE, 0x9f000 },
+            { 0x100000, low },
+            { HIGH_MEM_START, HIGH_MEM_START + memory - low },
+        };
+        for (size_t i = 0; i < sizeof ranges / sizeof ranges[0]; ++i) {
+            if (ranges[i][1] <= ranges[i][0])
+                continue;
+            seg.paddr = ranges[i][0];
+            seg.vaddr = DIRECT_MAP_BASE + seg.paddr;
+            seg.size = ranges[i][1] - ranges[i][0];
+            segs.push_back(seg);
+        }
+
+        // headers, notes, then the page-aligned segments
+        unsigned long long offset = sizeof(Elf64_Ehdr) +
+            (segs.size() + 1) * sizeof(Elf64_Phdr);
+        unsigned long long notesOffset = offset;
+        offset += notes.size();
+        for (size_t i = 0; i < segs.size(); ++i) {
+            offset = (offset + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+            segs[i].offset = offset;
+            offset += segs[i].size;
+        }
+
+        Elf64_Ehdr ehdr;
+        memset(&ehdr, 0, sizeof ehdr);
+        memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+        ehdr.e_ident[EI_CLASS] = ELFCLASS64;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        ehdr.e_ident[EI_DATA] = ELFDATA2MSB;
+#else
+        ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+#endif
+        ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+        ehdr.e_type = ET_CORE;
+        ehdr.e_machine = ELF_MACHINE;
+        ehdr.e_version = EV_CURRENT;
+        ehdr.e_phoff = sizeof ehdr;
+        ehdr.e_ehsize = sizeof ehdr;
+        ehdr.e_phentsize = sizeof(Elf64_Phdr);
+        ehdr.e_phnum = segs.size() + 1;
+
+        vector<Elf64_Phdr> phdrs(segs.size() + 1);
+        memset(&phdrs[0], 0, phdrs.size() * sizeof phdrs[0]);
+        phdrs[0].p_type = PT_NOTE;
+        phdrs[0].p_offset = notesOffset;
+        phdrs[0].p_filesz = phdrs[0].p_memsz = notes.size();
+        for (size_t i = 0; i < segs.size(); ++i) {
+            Elf64_Phdr &ph = phdrs[i + 1];
+            ph.p_type = PT_LOAD;
+            ph.p_flags = PF_R | PF_W | PF_X;
+            ph.p_offset = segs[i].offset;
+            ph.p_vaddr = segs[i].vaddr;
+            ph.p_paddr = segs[i].paddr;
+            ph.p_filesz = ph.p_memsz = segs[i].size;
+        }
+
+        int fd = open(argv[optind], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            throw KSystemError(string("Cannot create ") + argv[optind],
+                               errno);
+        try {
+            writeAll(fd, &ehdr, sizeof ehdr, 0);
+            writeAll(fd, &phdrs[0], phdrs.size() * sizeof phdrs[0],
+                     ehdr.e_phoff);
+            writeAll(fd, notes.data(), notes.size(), notesOffset);
+            for (size_t i = 0; i < segs.size(); ++i)
+                writeSegment(fd, segs[i], mix);
+
+            // a hole at the end is not written
+            if (ftruncate(fd, offset) != 0)
+                throw KSystemError("Cannot set the size of the dump", errno);
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+        if (close(fd) != 0)
+            throw KSystemError("Cannot write the dump", errno);
+    } catch (const std::exception &ex) {
+        cerr << ex.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <string>
+#include <cstring>
+#include <climits>
+#include <memory>
+#include <algorithm>
+
+#include <zlib.h>
+
+#include "global.h"
+#include "debug.h"
+#include "ikconfig.h"
+
+#if HAVE_LZMA
+#  include <lzma.h>
+#endif
+#if HAVE_ZSTD
+#  include <zstd.h>
+#endif
+
+using std::string;
+using std::min;
+
+#define IKCFG_START         "IKCFG_ST"
+#define IKCFG_END           "IKCFG_ED"
+#define IKCFG_MAGIC_LEN     8
+
+// the compressed configuration is some 40 KiB; anything much bigger
+// means that the markers were found in garbage
+#define IKCFG_MAX_SIZE      (4*1024*1024)
+
+// size of the decompression buffer
+#define DECODE_CHUNK        (64*1024)
+
+struct StreamMagic {
+    const char *name;
+    const char *magic;
+    size_t length;
+};
+
+// indexed by IkconfigReader::Format
+static const StreamMagic stream_magic[] = {
+    { "gzip", "\x1f\x8b\x08\x00", 4 },
+    { "xz",   "\xfd" "7zXZ\x00", 6 },
+    { "zstd", "\x28\xb5\x2f\xfd", 4 },
+};
+
+//{{{ IkconfigReader -----------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+IkconfigReader::IkconfigReader(const unsigned char *image, size_t length)
+    : m_image(image), m_length(length)
+{
+    reset();
+}
+
+// -----------------------------------------------------------------------------
+void IkconfigReader::reset()
+{
+    m_started = m_done = m_overflow = false;
+    m_tail.clear();
+    m_data.clear();
+}
+
+// -----------------------------------------------------------------------------
+bool IkconfigReader::readImage()
+{
+    Debug::debug()->trace("IkconfigReader::readImage(%zu)", m_length);
+
+    // vmlinux.gz may have a file name in the header, so only the ID
+    // bytes are checked for gzip
+    for (int i = 0; i < FMT_COUNT; ++i) {
+        size_t len = i == FMT_GZIP ? 2 : stream_magic[i].length;
+        if (m_length >= len &&
+            memcmp(m_image, stream_magic[i].magic, len) == 0) {
+            size_t consumed;
+            return decompress(Format(i), 0, &consumed);
+        }
+    }
+
+    reset();
+    feed(reinterpret_cast<const char *>(m_image), m_length);
+    return m_done;
+}
+
+// -----------------------------------------------------------------------------
+bool IkconfigReader::readEmbedded()
+{
+    Debug::debug()->trace("IkconfigReader::readEmbedded(%zu)", m_length);
+
+    // next candidate offset for each format
+    size_t next[FMT_COUNT];
+    size_t start = 0;
+    for (int i = 0; i < FMT_COUNT; ++i)
+        next[i] = start;
+
+    while (true) {
+        int format = -1;
+        for (int i = 0; i < FMT_COUNT; ++i) {
+            const StreamMagic &magic = stream_magic[i];
+            if (next[i] < start)
+                next[i] = start;
+            if (next[i] < m_length) {
+                const void *hit = memmem(m_image + next[i],
+                                         m_length - next[i],
+                                         magic.magic, magic.length);
+                next[i] = hit
+                    ? static_cast<const unsigned char *>(hit) - m_image
+                    : m_length;
+            }
+            if (next[i] < m_length && (format < 0 || next[i] < next[format]))
+                format = i;
+        }
+        if (format < 0)
+            return false;
+
+        size_t offset = next[format];
+        size_t consumed = 0;
+        Debug::debug()->dbg("Trying %s stream at 0x%zx",
+                            stream_magic[format].name, offset);
+        if (decompress(Format(format), offset, &consumed))
+            return true;
+
+        // a complete stream cannot contain the start of another one
+        if (consumed)
+            start = offset + consumed;
+        else
+            next[format] = offset + 1;
+    }
+}
+
+// -----------------------------------------------------------------------------
+bool IkconfigReader::feed(const char *p, size_t len)
+{
+    while (len && !m_started) {
+        // a marker may cross the boundary of two chunks
+        string edge = m_tail +
+            string(p, min<size_t>(len, IKCFG_MAGIC_LEN - 1));
+        size_t skip = 0;
+        string::size_type pos = edge.find(IKCFG_START);
+        if (pos != string::npos) {
+            skip = pos + IKCFG_MAGIC_LEN - m_tail.size();
+        } else {
+            const char *hit = static_cast<const char *>(
+                memmem(p, len, IKCFG_START, IKCFG_MAGIC_LEN));
+            if (!hit) {
+                if (len >= IKCFG_MAGIC_LEN - 1)
+                    m_tail.assign(p + len - (IKCFG_MAGIC_LEN - 1),
+                                  IKCFG_MAGIC_LEN - 1);
+                else {
+                    m_tail.append(p, len);
+                    if (m_tail.size() > IKCFG_MAGIC_LEN - 1)
+                        m_tail.erase(0, m_tail.size() -
+                                     (IKCFG_MAGIC_LEN - 1));
+                }
+                return false;
+            }
+            skip = hit - p + IKCFG_MAGIC_LEN;
+        }
+        m_started = true;
+        p += skip;
+        len -= skip;
+    }
+
+    if (len) {
+        size_t old = m_data.size();
+        m_data.append(p, len);
+        string::size_type pos = m_data.find(IKCFG_END,
+            old >= IKCFG_MAGIC_LEN - 1 ? old - (IKCFG_MAGIC_LEN - 1) : 0);
+        if (pos != string::npos) {
+            m_data.resize(pos);
+            m_done = true;
+        } else if (m_data.size() > IKCFG_MAX_SIZE) {
+            Debug::debug()->dbg("No IKCFG_ED within %d bytes",
+                                IKCFG_MAX_SIZE);
+            m_overflow = true;
+        }
+    }
+
+    return m_done || m_overflow;
+}
+
+// -----------------------------------------------------------------------------
+bool IkconfigReader::decompress(Format format, size_t offset, size_t *consumed)
+{
+    reset();
+    *consumed = 0;
+
+    switch (format) {
+        case FMT_GZIP:
+            return inflateGzip(offset, consumed);
+        case FMT_XZ:
+            return decodeXz(offset, consumed);
+        case FMT_ZSTD:
+            return decodeZstd(offset, consumed);
+        default:
+            return false;
+    }
+}
+
+// -----------------------------------------------------------------------------
+bool IkconfigReader::inflateGzip(size_t offset, size_t *consumed)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof stream);
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+        throw KError("inflateInit2() failed");
+
+    std::unique_ptr<unsigned char[]> out(new unsigned char[DECODE_CHUNK]);
+    stream.next_in = const_cast<Bytef *>(m_image + offset);
+    stream.avail_in = min<size_t>(m_length - offset, UINT_MAX);
+
+    int ret;
+    do {
+        stream.next_out = out.get();
+        stream.avail_out = DECODE_CHUNK;
+        ret = inflate(&stream, Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END)
+            break;
+        if (feed(reinterpret_cast<char *>(out.get()),
+                 DECODE_CHUNK - stream.avail_out))
+            break;
+    } while (ret != Z_STREAM_END);
+
+    if (ret == Z_STREAM_END)
+        *consumed = stream.total_in;
+    inflateEnd(&stream);
+    return m_done;
+}
+
+// -----------------------------------------------------------------------------
+bool IkconfigReader::decodeXz(size_t offset, size_t *consumed)
+{
+#if HAVE_LZMA
+    lzma_stream stream = LZMA_STREAM_INIT;
+    if (lzma_stream_decoder(&stream, UINT64_MAX, 0) != LZMA_OK)
+        throw KError("lzma_stream_decoder() failed");
+
+    std::unique_ptr<unsigned char[]> out(new unsigned char[DECODE_CHUNK]);
+    stream.next_in = m_image + offset;
+    stream.avail_in = m_length - offset;
+
+    lzma_ret ret;
+    do {
+        stream.next_out = out.get();
+        stream.avail_out = DECODE_CHUNK;
+        ret = lzma_code(&stream, LZMA_RUN);
+        if (ret != LZMA_OK && ret != LZMA_STREAM_END)
+            break;
+        if (feed(reinterpret_cast<char *>(out.get()),
+                 DECODE_CHUNK - stream.avail_out))
+            break;
+    } while (ret != LZMA_STREAM_END);
+
+    if (ret == LZMA_STREAM_END)
+        *consumed = stream.total_in;
+    lzma_end(&stream);
+    return m_done;
+#else
+    Debug::debug()->dbg("Built without liblzma, cannot read xz streams");
+    return false;
+#endif
+}
+
+// -----------------------------------------------------------------------------
+bool IkconfigReader::decodeZstd(size_t offset, size_t *consumed)
+{
+#if HAVE_ZSTD
+    ZSTD_DStream *stream = ZSTD_createDStream();
+    if (!stream)
+        throw KError("ZSTD_createDStream() failed");
+    ZSTD_initDStream(stream);
+
+    std::unique_ptr<char[]> out(new char[DECODE_CHUNK]);
+    ZSTD_inBuffer in = { m_image + offset, m_length - offset, 0 };
+
+    size_t ret;
+    do {
+        ZSTD_outBuffer output = { out.get(), DECODE_CHUNK, 0 };
+        ret = ZSTD_decompressStream(stream, &output, &in);
+        if (ZSTD_isError(ret))
+            break;
+        if (feed(out.get(), output.pos))
+            break;
+        // truncated frame
+        if (in.pos == in.size && output.pos < DECODE_CHUNK)
+            break;
+    } while (ret != 0);
+
+    if (ret == 0)
+        *consumed = in.pos;
+    ZSTD_freeDStream(stream);
+    return m_done;
+#else
+    Debug::debug()->dbg("Built without libzstd, cannot read zstd streams");
+    return false;
+#endif
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef IKCONFIG_H
+#define IKCONFIG_H
+
+#include <string>
+
+#include "global.h"
+
+//{{{ IkconfigReader -----------------------------------------------------------
+
+/**
+ * Finds the embedded kernel configuration (CONFIG_IKCONFIG) in a kernel
+ * image in memory, usually a mapped file.
+ *
+ * The configuration is a gzip stream between the markers IKCFG_ST and
+ * IKCFG_ED in the uncompressed kernel. Compressed kernels (gzip, and xz
+ * or zstd if kdumptool has been built with these libraries) are
+ * decompressed only until IKCFG_ED.
+ */
+class IkconfigReader {
+
+    public:
+        /**
+         * Creates a reader for an image.
+         *
+         * @param[in] image the image data; must stay valid
+         * @param[in] length the size of @p image in bytes
+         */
+        IkconfigReader(const unsigned char *image, size_t length);
+
+        /**
+         * Searches an uncompressed image, or an image that is a single
+         * compressed stream (like vmlinux.gz).
+         *
+         * @return @c true if the configuration has been found
+         */
+        bool readImage();
+
+        /**
+         * Searches the compressed streams inside the image (like the
+         * payload of a bzImage), in the order of their offsets.
+         *
+         * @return @c true if the configuration has been found
+         */
+        bool readEmbedded();
+
+        /**
+         * Returns the data between IKCFG_ST and IKCFG_ED.
+         */
+        const std::string &data() const
+        { return m_data; }
+
+    protected:
+        enum Format {
+            FMT_GZIP,
+            FMT_XZ,
+            FMT_ZSTD,
+            FMT_COUNT
+        };
+
+        void reset();
+        bool feed(const char *p, size_t len);
+        bool decompress(Format format, size_t offset, size_t *consumed);
+
+        bool inflateGzip(size_t offset, size_t *consumed);
+        bool decodeXz(size_t offset, size_t *consumed);
+        bool decodeZstd(size_t offset, size_t *consumed);
+
+    private:
+        const unsigned char *m_image;
+        size_t m_length;
+        bool m_started;
+        bool m_done;
+        bool m_overflow;
+        std::string m_tail;
+        std::string m_data;
+};
+
+//}}}
+
+#endif /* IKCONFIG_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -282,6 +282,220 @@ KconfigValue Kconfig::get(const string &option)
     return m_configs[option];
 }
 
+//}}}
+//{{{ KconfigQuery -------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+KconfigQuery::KconfigQuery(const StringVector &options)
+    : m_seed(0), m_missing(0)
+{
+    StringVector::const_iterator it;
+    for (it = options.begin(); it != options.end(); ++it) {
+        bool dup = false;
+        for (size_t i = 0; i < m_entries.size(); ++i)
+            dup = dup || m_entries[i].name == *it;
+        if (dup)
+            continue;
+        Entry entry;
+        entry.name = *it;
+        entry.found = false;
+        m_entries.push_back(entry);
+    }
+    m_missing = m_entries.size();
+
+    // find a seed without collisions; with a table twice as large as
+    // the number of options, a few tries are enough
+    size_t size = 1;
+    while (size < 2 * m_entries.size())
+        size <<= 1;
+    for (;;) {
+        for (m_seed = 0; m_seed < 64; ++m_seed) {
+            m_table.assign(size, -1);
+            size_t i;
+            for (i = 0; i < m_entries.size(); ++i) {
+                const string &name = m_entries[i].name;
+                size_t slot = hash(m_seed, name.data(), name.size()) &
+                    (size - 1);
+                if (m_table[slot] >= 0)
+                    break;
+                m_table[slot] = i;
+            }
+            if (i == m_entries.size())
+                return;
+        }
+        size <<= 1;
+    }
+}
+
+// -----------------------------------------------------------------------------
+unsigned long KconfigQuery::hash(unsigned long seed, const char *s, size_t len)
+{
+    // FNV-1a
+    unsigned long h = 2166136261UL ^ (seed * 16777619UL);
+    while (len--) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619UL;
+    }
+    return h ^ (h >> 15);
+}
+
+// -----------------------------------------------------------------------------
+int KconfigQuery::lookup(const char *name, size_t len) const
+{
+    if (m_table.empty())
+        return -1;
+
+    int idx = m_table[hash(m_seed, name, len) & (m_table.size() - 1)];
+    if (idx < 0)
+        return -1;
+    const string &entry = m_entries[idx].name;
+    if (entry.size() != len || memcmp(entry.data(), name, len) != 0)
+        return -1;
+    return idx;
+}
+
+// -----------------------------------------------------------------------------
+bool KconfigQuery::feed(const char *line, size_t len)
+{
+    static const char prefix[] = "CONFIG_";
+    static const char notSet[] = "# CONFIG_";
+
+    // extract the name without parsing the line
+    const char *name, *end = line + len;
+    if (len > sizeof(notSet) - 1 &&
+        memcmp(line, notSet, sizeof(notSet) - 1) == 0) {
+        name = line + 2;
+        end = (const char *)memchr(name, ' ', end - name);
+    } else if (len > sizeof(prefix) - 1 &&
+               memcmp(line, prefix, sizeof(prefix) - 1) == 0) {
+        name = line;
+        end = (const char *)memchr(name, '=', end - name);
+    } else
+        return complete();
+    if (!end)
+        return complete();
+
+    int idx = lookup(name, end - name);
+    if (idx < 0 || m_entries[idx].found)
+        return complete();
+
+    Entry &entry = m_entries[idx];
+    string parsed;
+    entry.value = KconfigValue::fromString(string(line, len), parsed);
+    entry.found = true;
+    --m_missing;
+    return complete();
+}
+
+// -----------------------------------------------------------------------------
+KconfigValue KconfigQuery::get(const string &option) const
+{
+    int idx = lookup(option.data(), option.size());
+    return idx < 0 ? KconfigValue() : m_entries[idx].value;
+}
+
+// -----------------------------------------------------------------------------
+void KconfigQuery::readFromConfig(const string &configFile)
+{
+    Debug::debug()->trace("KconfigQuery::readFromConfig(%s)",
+                          configFile.c_str());
+
+    gzFile fp;
+    char line[BUFSIZ];
+
+    fp = gzopen(configFile.c_str(), "r");
+    if (!fp) {
+        throw KError(string("Opening '") + configFile + string("' failed."));
+    }
+
+    try {
+        while (!complete() && gzgets(fp, line, BUFSIZ) != NULL) {
+            size_t len = strlen(line);
+            if (len && line[len - 1] == '\n')
+                --len;
+            feed(line, len);
+        }
+    } catch (...) {
+        gzclose(fp);
+        throw;
+    }
+
+    gzclose(fp);
+}
+
+// -----------------------------------------------------------------------------
+void KconfigQuery::readFromString(const string &config)
+{
+    const char *p = config.data();
+    const char *end = p + config.size();
+    while (p < end && !complete()) {
+        const char *eol = (const char *)memchr(p, '\n', end - p);
+        if (!eol)
+            eol = end;
+        feed(p, eol - p);
+        p = eol + 1;
+    }
+}
+
+// -----------------------------------------------------------------------------
+void KconfigQuery::readFromDeflate(const char *buffer, size_t buflen)
+{
+    Debug::debug()->trace("KconfigQuery::readFromDeflate(%p, %lu)",
+                          buffer, (unsigned long)buflen);
+
+    z_stream stream;
+    memset(&stream, 0, sizeof stream);
+    stream.next_in = (Bytef *)buffer;
+    stream.avail_in = buflen;
+
+    int ret = inflateInit2(&stream, -MAX_WBITS);
+    if (ret != Z_OK)
+        throw KError("inflateInit2() failed");
+
+    // the lines are checked chunk by chunk; an incomplete last line is
+    // moved to the start of the buffer
+    char out[16384];
+    size_t have = 0;
+    unsigned long long total = 0;
+    do {
+        stream.next_out = (Bytef *)out + have;
+        stream.avail_out = sizeof out - have;
+        ret = inflate(&stream, Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END) {
+            inflateEnd(&stream);
+            throw KError("inflate() failed");
+        }
+        have = sizeof out - stream.avail_out;
+
+        const char *p = out, *end = out + have;
+        const char *eol;
+        try {
+            while (!complete() &&
+                   (eol = (const char *)memchr(p, '\n', end - p))) {
+                feed(p, eol - p);
+                p = eol + 1;
+            }
+            if (ret == Z_STREAM_END && !complete() && p < end)
+                feed(p, end - p);
+        } catch (...) {
+            inflateEnd(&stream);
+            throw;
+        }
+
+        total += p - out;
+        have = end - p;
+        memmove(out, p, have);
+        if (have == sizeof out) {
+            inflateEnd(&stream);
+            throw KError("Line too long in the kernel configuration.");
+        }
+    } while (ret != Z_STREAM_END && !complete());
+
+    Debug::debug()->dbg("Checked %llu bytes of the kernel configuration",
+                        total);
+    inflateEnd(&stream);
+}
+
 //}}}
 
 // vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
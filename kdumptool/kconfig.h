@@ -24,6 +24,7 @@
 
 #include "global.h"
 #include "kerneltool.h"
+#include "stringvector.h"
 
 //{{{ KconfigValue -------------------------------------------------------------
 
@@ -196,6 +197,90 @@ class Kconfig {
         std::map<std::string, KconfigValue> m_configs;
 };
 
+//}}}
+//{{{ KconfigQuery -------------------------------------------------------------
+
+/**
+ * Looks up a few options in the kernel configuration without parsing
+ * all of it. The names of the wanted options are put in a perfect hash
+ * table, so that a line is only parsed if it sets one of them, and
+ * reading stops as soon as all of them have been seen. An option that
+ * is missing (as opposed to "is not set") can only be known at the end.
+ */
+class KconfigQuery {
+
+    public:
+
+        /**
+         * Creates a query.
+         *
+         * @param[in] options the wanted options, with the "CONFIG_" prefix
+         */
+        KconfigQuery(const StringVector &options);
+
+        /**
+         * Reads a normal or a .gz config file until all options are found.
+         *
+         * @param[in] configFile the full path to the configuration file
+         * @exception KError if reading of the configuration file fails
+         */
+        void readFromConfig(const std::string &configFile);
+
+        /**
+         * Reads the configuration text until all options are found.
+         */
+        void readFromString(const std::string &config);
+
+        /**
+         * Inflates a raw deflate stream (the IKCONFIG data after the gzip
+         * header) only until all options are found.
+         *
+         * @param[in] buffer the compressed data
+         * @param[in] buflen the size of @p buffer
+         * @exception KError if the data cannot be decompressed
+         */
+        void readFromDeflate(const char *buffer, size_t buflen);
+
+        /**
+         * Checks one line of the configuration.
+         *
+         * @param[in] line the line, without the trailing newline
+         * @param[in] len the length of @p line
+         * @return @c true if all options have been found
+         * @exception KError if a wanted option has an invalid line
+         */
+        bool feed(const char *line, size_t len);
+
+        /**
+         * Returns @c true if all options have been found.
+         */
+        bool complete() const
+        { return m_missing == 0; }
+
+        /**
+         * Returns the value of a wanted option, or a KconfigValue with
+         * type T_INVALID if the option has not been found (or it is not
+         * one of the wanted options).
+         */
+        KconfigValue get(const std::string &option) const;
+
+    private:
+        struct Entry {
+            std::string name;
+            KconfigValue value;
+            bool found;
+        };
+
+        static unsigned long hash(unsigned long seed,
+                                  const char *s, size_t len);
+        int lookup(const char *name, size_t len) const;
+
+        std::vector<Entry> m_entries;
+        std::vector<int> m_table;       // index into m_entries or -1
+        unsigned long m_seed;
+        size_t m_missing;
+};
+
 //}}}
 
 #endif /* KCONFIG_H */
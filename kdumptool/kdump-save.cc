@@ -15,14 +15,24 @@
  * along with this program; if not, see <https://www.gnu.org/licenses>.
  */
 
+#include <algorithm>
+#include <atomic>
 #include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include <signal.h>
+#include <sys/mount.h>
 #include <sys/resource.h>
+#include <sys/statvfs.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -30,12 +40,20 @@
 #include "config.h"
 #include "global.h"
 #include "configuration.h"
+#include "debug.h"
 #include "deletedumps.h"
 #include "fileutil.h"
 #include "ledblink.h"
+#include "memorywatch.h"
 #include "mounts.h"
+#include "nettuning.h"
+#include "perfcounters.h"
+#include "notification.h"
 #include "process.h"
+#include "rootdirurl.h"
 #include "savedump.h"
+#include "savestats.h"
+#include "urlparser.h"
 
 using std::cerr;
 using std::cout;
@@ -55,12 +73,16 @@ static const char KDUMP_DIR[] = "/kdump";
 static const char MNT_DIR[] = "/mnt";
 
 static const char CONFIG_FILE[] = "/etc/sysconfig/kdump";
+static const char CONFIG_SNAPSHOT[] = "/etc/sysconfig/kdump.bin";
 static const char KERNEL_CMDLINE[] = "/proc/cmdline";
 
 static const char CORE_PATTERN[] = "/proc/sys/kernel/core_pattern";
 
 static const char HOSTNAME[] = "/etc/hostname.kdump";
 
+// the "kdumptool calibrate" cache at the time the initrd was built
+static const char CALIBRATE_FILE[] = "/kdump/calibrate";
+
 static int runCommand(const string &command)
 {
     cout << "Running " << command << endl;
@@ -77,10 +99,28 @@ static void runShell()
         ProcessFilter().execute(BIN_SH, StringVector());
 }
 
+// Give the notifications that are still being sent a last chance, but
+// do not let an unreachable mail relay delay the reboot for long.
+static void waitForNotifications()
+{
+    NotificationQueue *queue = NotificationQueue::queue();
+    if (queue->idle())
+        return;
+
+    Configuration *config = Configuration::config();
+    int timeout = config->KDUMP_NOTIFICATION_TIMEOUT.value();
+    cout << "Waiting up to " << timeout << " seconds for the notification."
+         << endl;
+    if (!queue->wait(std::chrono::seconds(std::max(timeout, 0))))
+        cerr << "WARNING: Notification not sent within "
+             << timeout << " seconds" << endl;
+}
+
 static void maybeReboot()
 {
     Configuration *config = Configuration::config();
     if (config->KDUMP_IMMEDIATE_REBOOT.value()) {
+        waitForNotifications();
         ProcessFilter().execute("umount", StringVector { "-a" });
         ProcessFilter().execute("reboot", StringVector { "-f" });
     }
@@ -103,7 +143,7 @@ static bool fadumpEnabled()
     if (!fp.exists())
         return false;
 
-    ifstream fin;
+    ifstream fin(fp);
     if (!fin)
         throw KSystemError(fp, errno);
 
@@ -112,20 +152,37 @@ static bool fadumpEnabled()
     return enabled;
 }
 
-static bool handleExitFadump()
+/**
+ * Give the preserved memory back to the system (once). This also removes
+ * /proc/vmcore, so it must not be read any more.
+ */
+static void releaseFadumpMemory()
 {
-    if (!fadumpEnabled())
-        return false;
+    static std::atomic<bool> released(false);
+    if (released.exchange(true))
+        return;
 
     Configuration *config = Configuration::config();
 
     // release memory if possible
     FilePath fp(FADUMP_RELEASE_MEM);
     if (fp.exists() && !config->KDUMP_IMMEDIATE_REBOOT.value()) {
+        cout << "Releasing the fadump memory" << endl;
         ofstream fout(fp);
         fout << "1" << endl;
         fout.close();
     }
+}
+
+static bool handleExitFadump()
+{
+    if (!fadumpEnabled())
+        return false;
+
+    Configuration *config = Configuration::config();
+
+    // if the dump has not been saved, the memory is released only now
+    releaseFadumpMemory();
 
     if (config->KDUMP_FADUMP_SHELL.value()) {
         cout << endl
@@ -134,6 +191,7 @@ static bool handleExitFadump()
     }
 
     maybeReboot();
+    waitForNotifications();
 
     // unmount kdump directories
     StringVector dirs;
@@ -152,6 +210,15 @@ static bool handleExitFadump()
 
 #else
 
+static inline bool fadumpEnabled()
+{
+    return false;
+}
+
+static inline void releaseFadumpMemory()
+{
+}
+
 static inline bool handleExitFadump()
 {
     return false;
@@ -168,6 +235,7 @@ static void handleExit()
 
         cout << endl << "Dump saving completed." << endl;
         runShell();
+        waitForNotifications();
     }
 }
 
@@ -317,65 +385,266 @@ int EnvironmentOverride::set(const char *value)
 
 // handle remounting existing readonly mounts readwrite
 // mount -a works only for not yet mounted filesystems
-void rwFixup()
+//
+// The mounts are remounted with mount(2) in parallel, because a remount
+// may replay a journal, and wait() blocks only until the mounts that
+// overlap the given paths are done, including the sources of bind mounts
+// among them. The rest is finished in the background; the destructor
+// waits for it.
+class RwFixup
+{
+    public:
+        RwFixup();
+        ~RwFixup();
+
+        void wait(const StringVector &paths);
+        void waitAll();
+
+    private:
+        struct Remount {
+            string target;
+            string source;      // bind mounts only
+            std::future<void> done;
+        };
+        std::vector<Remount> m_remounts;
+
+        static void remount(const string &target, const string &fsopts);
+        static void finish(Remount &r);
+};
+
+// mount flags that MS_REMOUNT would clear; statvfs() reports them with
+// the same values as the MS_* constants
+static const unsigned long KEEP_MOUNT_FLAGS =
+    ST_NOSUID | ST_NODEV | ST_NOEXEC | ST_SYNCHRONOUS | ST_MANDLOCK |
+    ST_NOATIME | ST_NODIRATIME | ST_RELATIME;
+
+RwFixup::RwFixup()
 {
     FstabMountTable tbl;
     MountTable::iterator it(tbl, MNT_ITER_FORWARD);
     while (++it) {
-        if (it->hasOption("bind") ||
-            it->hasOption("rbind")) {
-            FilePath mpt(it->target());
-            if (string(it->fstype()) == "none" && !mpt.isWritable()) {
-                // remounting bind mounts needs special incantation
-                StringVector args { "none", mpt, "-o", "remount,rw" };
-                ProcessFilter().execute("mount", args);
-            }
-        } else if (it->hasOption("ro")) {
+        bool bind = it->hasOption("bind") || it->hasOption("rbind");
+        if (bind ? string(it->fstype()) != "none" : it->hasOption("ro"))
+            continue;
+
+        const char *fsopts = mnt_fs_get_fs_options(it->fs());
+        Remount r;
+        r.target = it->canonicalTarget();
+        if (bind)
+            r.source = FilePath(it->source()).getCanonicalPath();
+        r.done = std::async(std::launch::async, remount, r.target,
+                            string(bind || !fsopts ? "" : fsopts));
+        m_remounts.push_back(std::move(r));
+    }
+}
+
+RwFixup::~RwFixup()
+{
+    waitAll();
+}
+
+void RwFixup::remount(const string &target, const string &fsopts)
+{
+    if (FilePath(target).isWritable())
+        return;
+
+    struct statvfs vfs;
+    if (statvfs(target.c_str(), &vfs))
+        throw KSystemError("Cannot stat " + target, errno);
+
+    // like mount none <target> -o remount,rw; without MS_BIND, a bind
+    // mount also makes the filesystem behind it read-write
+    unsigned long flags = MS_REMOUNT | (vfs.f_flag & KEEP_MOUNT_FLAGS);
+    const char *data = fsopts.empty() ? NULL : fsopts.c_str();
+
+    if (mount(NULL, target.c_str(), NULL, flags, data))
+        throw KSystemError("Cannot remount " + target + " read-write", errno);
+}
+
+void RwFixup::finish(Remount &r)
+{
+    if (!r.done.valid())
+        return;
+    try {
+        r.done.get();
+    } catch (KError &err) {
+        cerr << "WARNING: " << err.what() << endl;
+    }
+}
+
+// a mount matters if a path is on it, or if it is mounted under a path
+static bool overlaps(const string &a, const string &b)
+{
+    const string &shorter = a.size() < b.size() ? a : b;
+    const string &longer = a.size() < b.size() ? b : a;
+    if (longer.compare(0, shorter.size(), shorter) != 0)
+        return false;
+    return longer.size() == shorter.size() || shorter == "/" ||
+        longer[shorter.size()] == '/';
+}
+
+void RwFixup::wait(const StringVector &paths)
+{
+    // a bind mount is writable only when its source has been remounted
+    StringVector wanted(paths);
+    size_t count;
+    do {
+        count = wanted.size();
+        for (std::vector<Remount>::iterator it = m_remounts.begin();
+             it != m_remounts.end(); ++it) {
+            if (it->source.empty() ||
+                std::find(wanted.begin(), wanted.end(), it->source) !=
+                wanted.end())
                 continue;
-        } else {
-            FilePath mpt(it->target());
-            if (!mpt.isWritable()) {
-                StringVector args { mpt, "-o", "remount,rw" };
-                ProcessFilter().execute("mount", args);
+            for (size_t i = 0; i < count; ++i) {
+                if (overlaps(it->target, wanted[i])) {
+                    wanted.push_back(it->source);
+                    break;
+                }
+            }
+        }
+    } while (wanted.size() != count);
+
+    for (std::vector<Remount>::iterator it = m_remounts.begin();
+         it != m_remounts.end(); ++it) {
+        for (StringVector::const_iterator p = wanted.begin();
+             p != wanted.end(); ++p) {
+            if (overlaps(it->target, *p)) {
+                finish(*it);
+                break;
             }
         }
     }
 }
 
-static void deleteDumps()
+void RwFixup::waitAll()
+{
+    for (std::vector<Remount>::iterator it = m_remounts.begin();
+         it != m_remounts.end(); ++it)
+        finish(*it);
+}
+
+// Returns the local directories that are written by the dump.
+static StringVector localTargets()
+{
+    Configuration *config = Configuration::config();
+
+    // TMPDIR of makedumpfile
+    FilePath tmpdir(KDUMP_DIR);
+    tmpdir.appendPath("tmp");
+    StringVector ret { tmpdir };
+
+    istringstream iss(config->KDUMP_SAVEDIR.value() + " " +
+                      config->KDUMP_TRIAGE_URL.value());
+    string elem;
+    while (iss >> elem) {
+        try {
+            RootDirURL url(elem, KDUMP_DIR);
+            if (url.getProtocol() == URLParser::PROT_FILE)
+                ret.push_back(url.getRealPath());
+        } catch (KError &err) {
+            // the dump reports the error; wait for everything
+            ret.push_back("/");
+        }
+    }
+    return ret;
+}
+
+static void tuneNetwork()
+{
+    Configuration *config = Configuration::config();
+    if (config->KDUMP_NET_TUNING.value().empty())
+        return;
+
+    SaveStats::Timer timer("nettune");
+    StringVector hosts;
+    istringstream iss(config->KDUMP_SAVEDIR.value() + " " +
+                      config->KDUMP_TRIAGE_URL.value());
+    string elem;
+    while (iss >> elem) {
+        URLParser url(elem);
+        if (url.getProtocol() != URLParser::PROT_FILE &&
+            url.getProtocol() != URLParser::PROT_RAW)
+            hosts.push_back(url.getHostname());
+    }
+    if (!hosts.empty())
+        NetTuning::applySystem(hosts);
+}
+
+// Waits for the deletion of old dumps that has been started before the
+// dump was saved.
+static void finishDeleteDumps(DeleteDumpsThread &oldDumps)
 {
+    SaveStats::Timer timer("delete");
     try {
-        DeleteDumps deleter;
-        deleter.rootDir(KDUMP_DIR);
-        deleter.deleteAll();
+        oldDumps.finish();
     } catch (KError &err) {
         handleError(string("Cannot delete old dumps: ") + err.what());
     }
 }
 
-static void saveDump()
+// Records the inputs and the result of "kdumptool calibrate" in
+// stats.json, so that the peak memory usage of the dump can be compared
+// with them.
+static void recordCalibration()
+{
+    ifstream fin(CALIBRATE_FILE);
+    string line;
+    if (!std::getline(fin, line))
+        return;
+
+    SaveStats *stats = SaveStats::stats();
+    string inputs;
+    while (std::getline(fin, line) && line != "--")
+        inputs += line + "\n";
+    stats->setField("calibrate_inputs", inputs);
+
+    static const char *const keys[][2] = {
+        { "Total: ", "calibrate_total_mb" },
+        { "Low: ", "calibrate_low_mb" },
+        { "High: ", "calibrate_high_mb" },
+    };
+    while (std::getline(fin, line)) {
+        for (size_t i = 0; i < ARRAY_SIZE(keys); ++i) {
+            size_t len = strlen(keys[i][0]);
+            if (line.compare(0, len, keys[i][0]) == 0)
+                stats->setField(keys[i][1],
+                                strtoull(line.c_str() + len, NULL, 10));
+        }
+    }
+}
+
+static string readHostname()
 {
     string hostname;
     ifstream fin(HOSTNAME);
     if (!fin)
         throw KSystemError(HOSTNAME, errno);
     fin >> hostname;
-    fin.close();
-
-    // set HOME to find the public/private key
-    EnvironmentOverride HomeEnv("HOME", KDUMP_DIR);
+    return hostname;
+}
 
-    // set TMPDIR for makedumpfile temporary bitmap
-    FilePath tmpdir(KDUMP_DIR);
-    tmpdir.appendPath("tmp");
-    EnvironmentOverride TmpdirEnv("TMPDIR", tmpdir.c_str());
+static void prepareDump(SaveDump &saver)
+{
+    try {
+        saver.prepare();
+    } catch (KError &err) {
+        // create() tries again
+        Debug::debug()->dbg("Cannot prepare the dump: %s", err.what());
+    }
+}
 
+static void saveDump(SaveDump &saver, DeleteDumpsThread *oldDumps)
+{
     try {
-        SaveDump saver;
-        saver.rootDir(KDUMP_DIR);
-        saver.hostName(hostname);
+        saver.oldDumps(oldDumps);
+        // the production kernel gets its memory back while the rest of
+        // the files is saved
+        if (fadumpEnabled())
+            saver.dumpDurable(releaseFadumpMemory);
         saver.create();
     } catch (KError &err) {
+        Debug::debug()->dumpEvents();
         Configuration *config = Configuration::config();
         if (!config->KDUMP_CONTINUE_ON_ERROR.value())
             throw KError(string("Cannot save dump: ") + err.what());
@@ -400,24 +669,66 @@ static void execute()
         if (code)
             cerr << "Transfer exit code is " << code << endl;
     } else {
-        rwFixup();
+        // before any connection to the dump targets
+        tuneNetwork();
+
+        // mount and connect the network targets in the background,
+        // while the system is prepared; the pre-script may be needed
+        // by the targets, so it runs first
+        std::unique_ptr<EnvironmentOverride> homeEnv, tmpdirEnv;
+        std::unique_ptr<SaveDump> saver;
+        auto startDump = [&]() {
+            // set HOME to find the public/private key
+            homeEnv.reset(new EnvironmentOverride("HOME", KDUMP_DIR));
+
+            // set TMPDIR for makedumpfile temporary bitmap
+            FilePath tmpdir(KDUMP_DIR);
+            tmpdir.appendPath("tmp");
+            tmpdirEnv.reset(new EnvironmentOverride("TMPDIR", tmpdir.c_str()));
+
+            saver.reset(new SaveDump);
+            saver->rootDir(KDUMP_DIR);
+            saver->hostName(readHostname());
+            prepareDump(*saver);
+        };
 
-        // pre-script
         const string &prescript = config->KDUMP_PRESCRIPT.value();
+        if (prescript.empty())
+            startDump();
+
+        // the dump waits only for the mounts of its local targets
+        RwFixup rwFixup;
+        {
+            SaveStats::Timer timer("remount");
+            rwFixup.wait(localTargets());
+        }
+
+        // pre-script
         if (!prescript.empty()) {
+            rwFixup.waitAll();
             int code = runCommand(prescript);
             if (code != 0 && !config->KDUMP_CONTINUE_ON_ERROR.value()) {
                 ostringstream msg;
                 msg << "Pre-script failed (" << code << ")";
                 throw KError(msg.str());
             }
+            startDump();
         }
 
-        // delete old dumps
-        deleteDumps();
-
-        // save the dump
-        saveDump();
+        // delete old dumps while the dump is saved; the save waits
+        // only until the dump fits, and a failed save abandons the
+        // deletion after the current dump
+        DeleteDumpsThread oldDumps(KDUMP_DIR);
+        oldDumps.start();
+
+        // save the dump; the targets are unmounted before the
+        // post-script runs
+        saveDump(*saver, &oldDumps);
+        saver.reset();
+        tmpdirEnv.reset();
+        homeEnv.reset();
+        finishDeleteDumps(oldDumps);
+        rwFixup.waitAll();
 
         // post-script
         const string &postscript = config->KDUMP_POSTSCRIPT.value();
@@ -447,8 +758,22 @@ int main(int argc, char **argv)
         CorePatternOverride pattern_override(core_pattern);
         CoreLimitOverride limit_override(RLIM_INFINITY);
 
+        // the peaks of each phase go to stats.json
+        MemoryWatch memoryWatch;
+        memoryWatch.start();
+        recordCalibration();
+
         Configuration *config = Configuration::config();
-        config->readFile(CONFIG_FILE);
+        {
+            SaveStats::Timer timer("config");
+            if (!config->readSnapshot(CONFIG_SNAPSHOT, CONFIG_FILE))
+                config->readFile(CONFIG_FILE);
+        }
+
+        // before any thread or child process that is to be counted
+        if (config->kdumptoolContainsFlag(Configuration::FLAG_PERF) &&
+            !PerfCounters::counters()->open())
+            cerr << "WARNING: No performance counters available" << endl;
 
         execute();
     } catch(std::exception &e) {
@@ -30,6 +30,7 @@
 #include "util.h"
 #include "configuration.h"
 #include "optionparser.h"
+#include "savestats.h"
 #include "config.h"
 
 using std::list;
@@ -65,7 +66,9 @@ KdumpTool::KdumpTool()
 KdumpTool::~KdumpTool()
 {
     Debug::debug()->trace("KdumpTool::~KdumpTool()");
-    delete m_subcommand;
+    for (list<Subcommand *>::iterator it = m_subcommandList.begin();
+         it != m_subcommandList.end(); ++it)
+        delete *it;
 }
 
 // -----------------------------------------------------------------------------
@@ -145,6 +148,13 @@ void KdumpTool::readConfiguration()
 
     if (m_subcommand->needsConfigfile()) {
         Configuration *config = Configuration::config();
+        if (config->hasRead(m_configfile)) {
+            Debug::debug()->dbg("%s has already been read",
+                                m_configfile.c_str());
+            return;
+        }
+
+        SaveStats::Timer timer("config");
         config->readFile(m_configfile);
     }
 }
@@ -56,7 +56,8 @@ class KdumpTool {
         void parseCommandline(int argc, char *argv[]);
 
         /**
-         * Reads the configuration.
+         * Reads the configuration. Nothing is read if the same file has
+         * already been read by this process (see the batch subcommand).
          *
          * @exception KError if reading the configuration failed
          */
@@ -76,6 +77,12 @@ class KdumpTool {
          */
         int getErrorCode() const;
 
+        /**
+         * Returns the configuration file (see the --configfile option).
+         */
+        const std::string &getConfigfile() const
+        { return m_configfile; }
+
     protected:
         void printVersion();
 
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <atomic>
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "global.h"
+#include "debug.h"
+#include "stringutil.h"
+#include "kernelcache.h"
+
+using std::string;
+using std::ifstream;
+using std::ofstream;
+using std::ostringstream;
+
+#define KERNEL_CACHE_MAGIC      "KDUMP-KERNEL-CACHE 1"
+
+//{{{ KernelCache --------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+KernelCache::KernelCache(const string &image, const string &dir)
+    : m_dirty(false)
+{
+    Debug::debug()->trace("KernelCache::KernelCache(%s, %s)",
+                          image.c_str(), dir.c_str());
+
+    struct stat st;
+    if (stat(image.c_str(), &st) != 0) {
+        Debug::debug()->dbg("Cannot stat %s: %s", image.c_str(),
+                            strerror(errno));
+        return;
+    }
+
+    ostringstream id;
+    id << st.st_dev << ' ' << st.st_ino << ' ' << st.st_size << ' '
+       << st.st_mtim.tv_sec << ' ' << st.st_mtim.tv_nsec;
+    m_id = id.str();
+    m_file = dir + "/kernel-" + StringUtil::number2hex(st.st_dev) + "-" +
+        StringUtil::number2hex(st.st_ino);
+
+    load();
+}
+
+// -----------------------------------------------------------------------------
+void KernelCache::load()
+{
+    ifstream fin(m_file.c_str(), std::ios::binary);
+    if (!fin)
+        return;
+
+    string line;
+    if (!getline(fin, line) || line != KERNEL_CACHE_MAGIC ||
+        !getline(fin, line) || line != "ID " + m_id) {
+        Debug::debug()->dbg("Ignoring stale cache file %s", m_file.c_str());
+        return;
+    }
+
+    // each value is preceded by a line with its key and length
+    std::map<string, string> values;
+    while (getline(fin, line)) {
+        string::size_type space = line.rfind(' ');
+        if (space == string::npos)
+            break;
+        string key = line.substr(0, space);
+        size_t length = strtoul(line.c_str() + space + 1, NULL, 10);
+
+        string value(length, '\0');
+        if (!fin.read(&value[0], length) || fin.get() != '\n') {
+            Debug::debug()->dbg("Truncated cache file %s", m_file.c_str());
+            return;
+        }
+        values[key].swap(value);
+    }
+
+    Debug::debug()->dbg("Loaded %zu values from %s", values.size(),
+                        m_file.c_str());
+    m_values.swap(values);
+}
+
+// -----------------------------------------------------------------------------
+bool KernelCache::get(const string &key, string &value) const
+{
+    std::map<string, string>::const_iterator it = m_values.find(key);
+    if (it == m_values.end())
+        return false;
+
+    value = it->second;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+void KernelCache::set(const string &key, const string &value)
+{
+    m_values[key] = value;
+    m_dirty = true;
+}
+
+// -----------------------------------------------------------------------------
+void KernelCache::save()
+{
+    if (!m_dirty || m_file.empty())
+        return;
+    m_dirty = false;
+
+    string dir = m_file.substr(0, m_file.rfind('/'));
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        Debug::debug()->dbg("Cannot create %s: %s", dir.c_str(),
+                            strerror(errno));
+        return;
+    }
+
+    // write a new file and rename it, so that readers never see a
+    // partial entry; the name is unique for each process and thread
+    static std::atomic<unsigned> serial(0);
+    string tmp = m_file + ".tmp" + StringUtil::number2string(getpid()) +
+        "." + StringUtil::number2string(serial++);
+    {
+        ofstream fout(tmp.c_str(), std::ios::binary | std::ios::trunc);
+        fout << KERNEL_CACHE_MAGIC << '\n' << "ID " << m_id << '\n';
+        std::map<string, string>::const_iterator it;
+        for (it = m_values.begin(); it != m_values.end(); ++it)
+            fout << it->first << ' ' << it->second.size() << '\n'
+                 << it->second << '\n';
+        fout.close();
+        if (!fout) {
+            Debug::debug()->dbg("Cannot write %s", tmp.c_str());
+            unlink(tmp.c_str());
+            return;
+        }
+    }
+
+    if (rename(tmp.c_str(), m_file.c_str()) != 0) {
+        Debug::debug()->dbg("Cannot rename %s: %s", tmp.c_str(),
+                            strerror(errno));
+        unlink(tmp.c_str());
+        return;
+    }
+    Debug::debug()->dbg("Saved %s", m_file.c_str());
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef KERNELCACHE_H
+#define KERNELCACHE_H
+
+#include <string>
+#include <map>
+
+#include "global.h"
+
+// directory of the cache files
+#define KERNEL_CACHE_DIR        "/var/cache/kdump"
+
+//{{{ KernelCache --------------------------------------------------------------
+
+/**
+ * On-disk cache of the information that has been extracted from a
+ * kernel image, like its type or the embedded kernel configuration.
+ *
+ * There is one cache file per image, named after the device and the
+ * inode of the image. An entry is only used while the size and the
+ * modification time of the image are unchanged, so a kernel update
+ * invalidates it.
+ *
+ * The cache is an optimisation only: errors are logged and otherwise
+ * ignored.
+ */
+class KernelCache {
+
+    public:
+        /**
+         * Loads the cache entry of an image.
+         *
+         * @param[in] image the kernel image
+         * @param[in] dir the cache directory
+         */
+        KernelCache(const std::string &image,
+                    const std::string &dir = KERNEL_CACHE_DIR);
+
+        /**
+         * Returns a cached value.
+         *
+         * @param[in] key the key
+         * @param[out] value the value if it has been cached
+         * @return @c true if the value has been cached
+         */
+        bool get(const std::string &key, std::string &value) const;
+
+        /**
+         * Sets a value. The value is stored by save().
+         *
+         * @param[in] key the key (without white space)
+         * @param[in] value the value (may contain any data)
+         */
+        void set(const std::string &key, const std::string &value);
+
+        /**
+         * Writes the entry to disk if a value has changed.
+         */
+        void save();
+
+    protected:
+        void load();
+
+    private:
+        std::string m_file;
+        std::string m_id;
+        std::map<std::string, std::string> m_values;
+        bool m_dirty;
+};
+
+//}}}
+
+#endif /* KERNELCACHE_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
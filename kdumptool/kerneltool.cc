@@ -27,6 +27,8 @@
 #include <sys/types.h>
 #include <fcntl.h>
 #include <endian.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 #include <zlib.h>
 #include <libelf.h>
@@ -40,6 +42,8 @@
 #include "fileutil.h"
 #include "kconfig.h"
 #include "kernelpath.h"
+#include "ikconfig.h"
+#include "kernelcache.h"
 
 using std::string;
 using std::memset;
@@ -90,16 +94,59 @@ static const unsigned char S390_HEADER[] = {
   0x02, 0x00, 0x06, 0xe0, 0x20, 0x00, 0x00, 0x50,
 };
 
-#define MAGIC_START         "IKCFG_ST"
-#define MAGIC_END           "IKCFG_ED"
-#define MAGIC_LEN           8
+/* gzip header in front of the IKCONFIG deflate data */
+#define IKCONFIG_GZIP_HEADER_LEN    10
 
-const static unsigned char magic_start[] = MAGIC_START;
-const static unsigned char magic_end[] = MAGIC_END;
+//{{{ MappedImage --------------------------------------------------------------
+
+/**
+ * A kernel image mapped into memory (read-only).
+ */
+class MappedImage {
+
+    public:
+        MappedImage(int fd, const string &name);
+        ~MappedImage();
+
+        const unsigned char *data() const
+        { return static_cast<const unsigned char *>(m_map); }
+
+        size_t size() const
+        { return m_size; }
+
+    private:
+        void *m_map;
+        size_t m_size;
+};
+
+// -----------------------------------------------------------------------------
+MappedImage::MappedImage(int fd, const string &name)
+    : m_map(MAP_FAILED), m_size(0)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        throw KSystemError("Cannot stat " + name, errno);
+    if (st.st_size == 0)
+        throw KError(name + " is empty.");
+
+    m_size = st.st_size;
+    m_map = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (m_map == MAP_FAILED)
+        throw KSystemError("Cannot map " + name, errno);
+    madvise(m_map, m_size, MADV_SEQUENTIAL);
+}
+
+// -----------------------------------------------------------------------------
+MappedImage::~MappedImage()
+{
+    munmap(m_map, m_size);
+}
+
+//}}}
 
 // -----------------------------------------------------------------------------
 KernelTool::KernelTool(const std::string &image)
-    : m_kernel(image), m_fd(-1)
+    : m_kernel(image), m_fd(-1), m_cache(image)
 {
     Debug::debug()->trace("KernelTool::KernelTool(%s)", image.c_str());
 
@@ -112,12 +159,25 @@ KernelTool::KernelTool(const std::string &image)
 // -----------------------------------------------------------------------------
 KernelTool::~KernelTool()
 {
+    m_cache.save();
     close(m_fd);
     m_fd = -1;
 }
 
 // -----------------------------------------------------------------------------
 KernelTool::KernelType KernelTool::getKernelType() const
+{
+    string value;
+    if (m_cache.get("type", value))
+        return KernelType(KString(value).asInt());
+
+    KernelType type = detectKernelType();
+    m_cache.set("type", StringUtil::number2string(int(type)));
+    return type;
+}
+
+// -----------------------------------------------------------------------------
+KernelTool::KernelType KernelTool::detectKernelType() const
 {
     if (Util::isElfFile(m_fd)) {
         if (Util::isGzipFile(m_fd))
@@ -145,6 +205,18 @@ KernelTool::KernelType KernelTool::getKernelType() const
 
 // -----------------------------------------------------------------------------
 bool KernelTool::isRelocatable() const
+{
+    string value;
+    if (m_cache.get("relocatable", value))
+        return value == "1";
+
+    bool relocatable = detectRelocatable();
+    m_cache.set("relocatable", relocatable ? "1" : "0");
+    return relocatable;
+}
+
+// -----------------------------------------------------------------------------
+bool KernelTool::detectRelocatable() const
 {
     switch (getKernelType()) {
         case KernelTool::KT_ELF:
@@ -390,8 +462,9 @@ bool KernelTool::hasConfigRelocatable(const string &machine) const
 bool KernelTool::isConfigRelocatable() const
 {
     try {
-    Kconfig *kconfig = retrieveKernelConfig();
-    KconfigValue kv = kconfig->get("CONFIG_RELOCATABLE");
+    KconfigQuery query(StringVector { "CONFIG_RELOCATABLE" });
+    queryKernelConfig(query);
+    KconfigValue kv = query.get("CONFIG_RELOCATABLE");
     return (kv.getType() == KconfigValue::T_TRISTATE &&
 	    kv.getTristateValue() == KconfigValue::ON);
     } catch (KError &e) {
@@ -488,181 +561,122 @@ string KernelTool::extractFromIKconfigBuffer(const char *buffer, size_t buflen)
 }
 
 // -----------------------------------------------------------------------------
-string KernelTool::extractKernelConfigELF() const
+string KernelTool::ikconfigDataELF() const
 {
-    Debug::debug()->trace("Kconfig::extractKernelConfigELF()");
+    Debug::debug()->trace("Kconfig::ikconfigDataELF()");
 
-    off_t oret = lseek(m_fd, 0, SEEK_SET);
-    if (oret == off_t(-1)) {
-        throw KSystemError("lseek() failed", errno);
-    }
+    MappedImage image(m_fd, m_kernel);
+    IkconfigReader reader(image.data(), image.size());
+    if (!reader.readImage())
+        throw KError("Cannot read configuration from " + m_kernel + ".");
 
-    gzFile fp = gzdopen(dup(m_fd), "r");
-    if (!fp) {
-        throw KError(string("Opening '") + m_kernel + string("' failed."));
-    }
+    return reader.data();
+}
 
-    // we overlap the reads, that way searching for the pattern is easier
-    unsigned char buffer[BUFSIZ];
-    memset(buffer, 0, BUFSIZ);
-
-    // search for the begin and end offests first
-    off_t fileoffset = 0;
-    ssize_t chars_read;
-    off_t begin_offset = -1, end_offset = -1;
-    while ((chars_read = gzread(fp, buffer+MAGIC_LEN, BUFSIZ-MAGIC_LEN)) > 0) {
-        if (begin_offset < 0) {
-            ssize_t pos = Util::findBytes(buffer, BUFSIZ, magic_start, MAGIC_LEN);
-            if (pos > 0) {
-                begin_offset = fileoffset + pos - MAGIC_LEN;
-            }
-        } else if (end_offset < 0) {
-            ssize_t pos = Util::findBytes(buffer, BUFSIZ, magic_end, MAGIC_LEN);
-            if (pos > 0) {
-                end_offset = fileoffset + pos - MAGIC_LEN;
-            }
-        } else {
-            break;
-        }
-        fileoffset += chars_read;
-        memmove(buffer, buffer+BUFSIZ-MAGIC_LEN, MAGIC_LEN);
-    }
+// -----------------------------------------------------------------------------
+string KernelTool::ikconfigDatabzImage() const
+{
+    Debug::debug()->trace("Kconfig::ikconfigDatabzImage()");
 
-    if (begin_offset < 0 || end_offset < 0) {
-        gzclose(fp);
+    // the compressed vmlinux follows the setup code; only the stream
+    // that contains IKCONFIG is decompressed, up to its end marker
+    MappedImage image(m_fd, m_kernel);
+    IkconfigReader reader(image.data(), image.size());
+    if (!reader.readEmbedded())
         throw KError("Cannot read configuration from " + m_kernel + ".");
-    }
 
-    // we need to read after the MAGIC_START and the gzip header
-    begin_offset += MAGIC_LEN + 10;
-
-    // read the configuration to a buffer
-    if (gzseek(fp, begin_offset, SEEK_SET) == -1) {
-        throw KError("gzseek() failed.");
-    }
-    ssize_t kernelconfig_len = end_offset - begin_offset;
-    unique_ptr<char[]> kernelconfig(new char[kernelconfig_len]);
+    return reader.data();
+}
 
-    chars_read = gzread(fp, kernelconfig.get(), kernelconfig_len);
-    gzclose(fp);
-    if (chars_read != kernelconfig_len) {
+// -----------------------------------------------------------------------------
+string KernelTool::extractFromIkconfigData(const string &data) const
+{
+    // skip the gzip header
+    if (data.size() <= IKCONFIG_GZIP_HEADER_LEN)
         throw KError("Cannot read IKCONFIG.");
-    }
 
-    return extractFromIKconfigBuffer(kernelconfig.get(), kernelconfig_len);
+    return extractFromIKconfigBuffer(data.data() + IKCONFIG_GZIP_HEADER_LEN,
+                                     data.size() - IKCONFIG_GZIP_HEADER_LEN);
 }
 
 // -----------------------------------------------------------------------------
-string KernelTool::extractKernelConfigbzImage() const
+string KernelTool::extractKernelConfig() const
 {
-    Debug::debug()->trace("Kconfig::extractKernelConfigbzImage()");
-
-    // that script helped me a lot
-    // http://www.cs.caltech.edu/~weixl/research/fast-mon/scripts/extract-ikconfig
-
-    unsigned char searchfor[4] = { 0x1f, 0x8b, 0x08, 0x0 };
-    unsigned char buffer[BUFSIZ];
-    ssize_t chars_read;
-
-    off_t oret = lseek(m_fd, 0, SEEK_SET);
-    if (oret == (off_t)-1) {
-        throw KSystemError("lseek() failed", errno);
-    }
-
-    // because of overlapping
-    memset(buffer, 0, BUFSIZ);
-
-    off_t fileoffset = 0;
-    off_t begin_offset = 0;
-    while ((chars_read = read(m_fd, buffer+4, BUFSIZ-4)) > 0) {
-        ssize_t pos = Util::findBytes(buffer, BUFSIZ, searchfor, 4);
-        if (pos > 0) {
-            begin_offset = fileoffset + pos - MAGIC_LEN;
-            break;
-        }
-        memmove(buffer, buffer+BUFSIZ-MAGIC_LEN, MAGIC_LEN);
-        fileoffset += chars_read;
-    }
-
-    if (begin_offset == 0) {
-        throw KError("Magic 0x1f 0x8b 0x08 0x0 not found.");
-    }
-
-    begin_offset += 4;
+    Debug::debug()->trace("Kconfig::extractKernelConfig()");
 
-    off_t ret = lseek(m_fd, begin_offset, SEEK_SET);
-    if (ret == (off_t)-1) {
-        throw KSystemError("lseek() failed", errno);
-    }
+    // a kernel without IKCONFIG is slow to search, too
+    string value;
+    if (m_cache.get("config", value))
+        return value;
+    if (m_cache.get("config-error", value))
+        throw KError(value);
 
-    gzFile fp = gzdopen(dup(m_fd), "r");
-    if (!fp) {
-        throw KError("gzdopen() failed");
+    try {
+        string config = readKernelConfig();
+        m_cache.set("config", config);
+        return config;
+    } catch (const KError &e) {
+        m_cache.set("config-error", e.what());
+        throw;
     }
+}
 
-    // we overlap the reads, that way searching for the pattern is easier
-    memset(buffer, 0, BUFSIZ);
-
-    // search for the begin and end offests first
-    off_t end_offset = 0;
-    begin_offset = 0;
-    fileoffset = 0;
-    while ((chars_read = gzread(fp, buffer+MAGIC_LEN, BUFSIZ-MAGIC_LEN)) > 0) {
-        if (begin_offset == 0) {
-            ssize_t pos = Util::findBytes(buffer, BUFSIZ, magic_start, MAGIC_LEN);
-            if (pos > 0) {
-                begin_offset = fileoffset + pos - MAGIC_LEN;
-            }
-        } else if (end_offset == 0) {
-            ssize_t pos = Util::findBytes(buffer, BUFSIZ, magic_end, MAGIC_LEN);
-            if (pos > 0) {
-                end_offset = fileoffset + pos - MAGIC_LEN;
-            }
-        } else {
-            break;
+// -----------------------------------------------------------------------------
+void KernelTool::queryKernelConfig(KconfigQuery &query) const
+{
+    Debug::debug()->trace("Kconfig::queryKernelConfig()");
+
+    // the config file on disk is faster, see retrieveKernelConfig()
+    KernelPath kpath(m_kernel);
+    if (!kpath.version().empty()) {
+        FilePath config = kpath.configPath();
+        if (config.exists()) {
+            query.readFromConfig(config);
+            return;
         }
-        fileoffset += chars_read;
-        memmove(buffer, buffer+BUFSIZ-MAGIC_LEN, MAGIC_LEN);
     }
 
-    if (begin_offset < 0 || end_offset < 0) {
-        gzclose(fp);
-        throw KError("Cannot read configuration from " + m_kernel + ".");
+    string value;
+    if (m_cache.get("config", value)) {
+        query.readFromString(value);
+        return;
     }
+    if (m_cache.get("config-error", value))
+        throw KError(value);
 
-    // we need to read after the MAGIC_START and the gzip header
-    begin_offset += MAGIC_LEN + 10;
-
-    // read the configuration to a buffer
-    if (gzseek(fp, begin_offset, SEEK_SET) == -1) {
-        throw KError("gzseek() failed.");
+    string data;
+    try {
+        data = readIkconfigData();
+    } catch (const KError &e) {
+        m_cache.set("config-error", e.what());
+        throw;
     }
-    ssize_t kernelconfig_len = end_offset - begin_offset;
-    unique_ptr<char[]> kernelconfig(new char[kernelconfig_len]);
 
-    chars_read = gzread(fp, kernelconfig.get(), kernelconfig_len);
-    gzclose(fp);
-    if (chars_read != kernelconfig_len) {
+    // skip the gzip header
+    if (data.size() <= IKCONFIG_GZIP_HEADER_LEN)
         throw KError("Cannot read IKCONFIG.");
-    }
-
-    return extractFromIKconfigBuffer(kernelconfig.get(), kernelconfig_len);
+    query.readFromDeflate(data.data() + IKCONFIG_GZIP_HEADER_LEN,
+                          data.size() - IKCONFIG_GZIP_HEADER_LEN);
 }
 
 // -----------------------------------------------------------------------------
-string KernelTool::extractKernelConfig() const
+string KernelTool::readKernelConfig() const
 {
-    Debug::debug()->trace("Kconfig::extractKernelConfig()");
+    return extractFromIkconfigData(readIkconfigData());
+}
 
+// -----------------------------------------------------------------------------
+string KernelTool::readIkconfigData() const
+{
     switch (getKernelType()) {
         case KernelTool::KT_ELF:
         case KernelTool::KT_ELF_GZ:
         case KernelTool::KT_S390:
         case KernelTool::KT_AARCH64:
-            return extractKernelConfigELF();
+            return ikconfigDataELF();
 
         case KernelTool::KT_X86:
-            return extractKernelConfigbzImage();
+            return ikconfigDatabzImage();
 
         default:
             throw KError("Invalid kernel image: " + m_kernel);
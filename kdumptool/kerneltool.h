@@ -23,13 +23,19 @@
 
 #include "global.h"
 #include "fileutil.h"
+#include "kernelcache.h"
 
 class Kconfig;
+class KconfigQuery;
 
 //{{{ KernelTool ---------------------------------------------------------------
 
 /**
  * Helper functions to work with kernel images.
+ *
+ * The kernel type, the relocatability and the embedded configuration
+ * are cached on disk (see KernelCache), because extracting the
+ * configuration means decompressing the kernel.
  */
 class KernelTool {
 
@@ -104,6 +110,17 @@ class KernelTool {
          */
         Kconfig *retrieveKernelConfig() const;
 
+        /**
+         * Looks up the options of @p query in the configuration of the
+         * kernel, from the same places as retrieveKernelConfig(). The
+         * embedded configuration is only decompressed until all options
+         * have been found.
+         *
+         * @param[in,out] query the wanted options
+         * @exception KError if the configuration cannot be read
+         */
+        void queryKernelConfig(KconfigQuery &query) const;
+
         /**
          * String representation of kerneltool.
          *
@@ -183,24 +200,39 @@ class KernelTool {
         std::string archFromElfMachine(unsigned long long et_machine) const;
 
         /**
-         * Extracts the kernel configuration from a ELF kernel image.
+         * Finds the IKCONFIG data (a gzip stream) in a ELF kernel image.
          * The image may be compressed.
          *
-         * @param[in] kernelImage full path to the kernel image
-         * @return the embedded kernel configuration
+         * @return the data between the IKCONFIG markers
          * @exception KError if reading of the kernel image failed
          */
-        std::string extractKernelConfigELF() const;
+        std::string ikconfigDataELF() const;
 
         /**
-         * Extracts the kernel configuration from a bzImage. The
+         * Finds the IKCONFIG data (a gzip stream) in a bzImage. The
          * image may be compressed.
          *
-         * @param[in] image full path to the kernel image
-         * @return the kernel configuration
+         * @return the data between the IKCONFIG markers
          * @exception KError if reading of the kernel image failed
          */
-        std::string extractKernelConfigbzImage() const;
+        std::string ikconfigDatabzImage() const;
+
+        /**
+         * Finds the IKCONFIG data for the type of the kernel.
+         *
+         * @exception KError if the kernel has no IKCONFIG
+         */
+        std::string readIkconfigData() const;
+
+        /**
+         * Extracts the kernel configuration from the data between the
+         * IKCONFIG markers (a gzip stream).
+         *
+         * @param[in] data the data after IKCFG_ST, up to IKCFG_ED
+         * @return the configuration string
+         * @exception KError if the data cannot be decompressed
+         */
+        std::string extractFromIkconfigData(const std::string &data) const;
 
         /**
          * Extracts the kernel configuration from a IKCONFIG buffer.
@@ -212,9 +244,18 @@ class KernelTool {
          */
         std::string extractFromIKconfigBuffer(const char *buffer, size_t buflen) const;
 
+        /**
+         * Uncached implementations of getKernelType(), isRelocatable()
+         * and extractKernelConfig().
+         */
+        KernelType detectKernelType() const;
+        bool detectRelocatable() const;
+        std::string readKernelConfig() const;
+
     private:
         FilePath m_kernel;
         int m_fd;
+        mutable KernelCache m_cache;
 };
 
 //}}}
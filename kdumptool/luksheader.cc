@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <string>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <endian.h>
+
+#include "global.h"
+#include "debug.h"
+#include "fileutil.h"
+#include "luksheader.h"
+
+using std::string;
+
+// size of the binary header, and where the JSON area starts
+#define LUKS2_BINARY_SIZE       4096
+
+// limits of hdr_size (binary header and JSON area)
+#define LUKS2_HDR_MIN           (16*1024)
+#define LUKS2_HDR_MAX           (4*1024*1024)
+
+static const char luksMagic[] = { 'L', 'U', 'K', 'S', '\xba', '\xbe' };
+
+//{{{ LuksHeader ---------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+LuksHeader::LuksHeader(const string &device)
+    : m_version(0), m_memory(0)
+{
+    Debug::debug()->trace("LuksHeader::LuksHeader(%s)", device.c_str());
+
+    FileDescriptor fd(device, O_RDONLY | O_CLOEXEC);
+
+    // magic[6], version (be16), hdr_size (be64)
+    unsigned char bin[16];
+    ssize_t ret = pread(fd, bin, sizeof bin, 0);
+    if (ret < 0)
+        throw KSystemError("Cannot read " + device, errno);
+    if (ret != sizeof bin || memcmp(bin, luksMagic, sizeof luksMagic) != 0)
+        throw KError(device + " has no LUKS header");
+
+    m_version = (bin[6] << 8) | bin[7];
+    if (m_version == 1)
+        return;
+    if (m_version != 2)
+        throw KError(device + ": unsupported LUKS version " +
+                     StringUtil::number2string(m_version));
+
+    unsigned long long hdr_size;
+    memcpy(&hdr_size, bin + 8, sizeof hdr_size);
+    hdr_size = be64toh(hdr_size);
+    if (hdr_size < LUKS2_HDR_MIN || hdr_size > LUKS2_HDR_MAX)
+        throw KError(device + ": invalid LUKS2 header size");
+
+    string json(hdr_size - LUKS2_BINARY_SIZE, '\0');
+    ret = pread(fd, &json[0], json.size(), LUKS2_BINARY_SIZE);
+    if (ret < 0)
+        throw KSystemError("Cannot read " + device, errno);
+    if ((size_t)ret != json.size())
+        throw KError(device + ": truncated LUKS2 header");
+    json.resize(strnlen(json.data(), json.size()));
+
+    m_memory = keyslotMemory(json);
+    Debug::debug()->dbg("LUKS2 device %s needs %lu KiB", device.c_str(),
+                        m_memory);
+}
+
+// -----------------------------------------------------------------------------
+unsigned long LuksHeader::keyslotMemory(const string &json)
+{
+    string::size_type pos = json.find("\"keyslots\"");
+    if (pos == string::npos)
+        throw KError("LUKS2 metadata without keyslots");
+    pos = json.find('{', pos);
+    if (pos == string::npos)
+        throw KError("LUKS2 keyslots are not an object");
+
+    // look at all "memory" keys until the keyslots object ends;
+    // other objects do not use the key
+    unsigned long memory = 0;
+    int depth = 0;
+    bool key = false;      // the last token was "memory"
+    for (; pos < json.size(); ++pos) {
+        char c = json[pos];
+        if (c == '"') {
+            string::size_type end = pos + 1;
+            while (end < json.size() && json[end] != '"')
+                end += json[end] == '\\' ? 2 : 1;
+            if (end >= json.size())
+                break;
+            key = json.compare(pos, end - pos + 1, "\"memory\"") == 0;
+            pos = end;
+        } else if (c == ':' && key) {
+            string::size_type num = json.find_first_not_of(" \t\r\n",
+                                                          pos + 1);
+            if (num != string::npos && isdigit((unsigned char)json[num])) {
+                unsigned long value = strtoul(json.c_str() + num, NULL, 10);
+                if (value > memory)
+                    memory = value;
+            }
+            key = false;
+        } else if (c == '{') {
+            ++depth;
+        } else if (c == '}') {
+            if (--depth == 0)
+                return memory;
+        } else if (!isspace((unsigned char)c)) {
+            key = false;
+        }
+    }
+    throw KError("Truncated LUKS2 keyslots");
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
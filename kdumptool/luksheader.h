@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef LUKSHEADER_H
+#define LUKSHEADER_H
+
+#include <string>
+
+#include "global.h"
+
+//{{{ LuksHeader ---------------------------------------------------------------
+
+/**
+ * Reads the key derivation parameters from a LUKS header.
+ *
+ * LUKS1 key slots use PBKDF2, which needs no memory. LUKS2 keeps its
+ * metadata as JSON after the 4 KiB binary header, and the keyslots with
+ * an Argon2 KDF store its memory cost (in KiB) there. Reading it directly
+ * is much cheaper than running "cryptsetup luksDump" for every device.
+ */
+class LuksHeader {
+
+    public:
+        /**
+         * Reads the header of a device.
+         *
+         * @param[in] device the block device (or an image file)
+         * @exception KError if the device cannot be read or does not
+         *            contain a LUKS header that can be parsed
+         */
+        LuksHeader(const std::string &device);
+
+        /**
+         * Returns the LUKS version (1 or 2).
+         */
+        int version() const
+        { return m_version; }
+
+        /**
+         * Returns the largest memory cost of all key slots in KiB.
+         */
+        unsigned long memory() const
+        { return m_memory; }
+
+        /**
+         * Returns the largest "memory" value of the KDFs in the
+         * "keyslots" object of a LUKS2 JSON area.
+         *
+         * @exception KError if the keyslots object is missing or truncated
+         */
+        static unsigned long keyslotMemory(const std::string &json);
+
+    private:
+        int m_version;
+        unsigned long m_memory;
+};
+
+//}}}
+
+#endif /* LUKSHEADER_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -21,6 +21,7 @@
 #include <stdexcept>
 
 #include "global.h"
+#include "debug.h"
 #include "kdumptool.h"
 #include "transfer.h"
 #include "dataprovider.h"
@@ -39,12 +40,45 @@
 #include "read_vmcoreinfo.h"
 #include "savedump.h"
 #include "calibrate.h"
+#include "rearrange.h"
+#include "estimate.h"
+#include "benchtransfer.h"
+#include "uploaddumps.h"
+#include "reassemble.h"
+#include "rawdump.h"
+#include "receive.h"
+#include "dedup.h"
+#include "batch.h"
 
 using std::cerr;
 using std::cout;
 using std::endl;
 using std::list;
 
+// -----------------------------------------------------------------------------
+static void addSubcommands(KdumpTool &kdt)
+{
+    kdt.addSubcommand(new DeleteDumpsCommand);
+    kdt.addSubcommand(new DumpConfig);
+    kdt.addSubcommand(new FindKernel);
+    kdt.addSubcommand(new IdentifyKernel);
+    kdt.addSubcommand(new LedBlink);
+    kdt.addSubcommand(new Multipath);
+    kdt.addSubcommand(new PrintTarget);
+    kdt.addSubcommand(new ReadIKConfig);
+    kdt.addSubcommand(new ReadVmcoreinfo);
+    kdt.addSubcommand(new SaveDumpCommand);
+    kdt.addSubcommand(new Calibrate);
+    kdt.addSubcommand(new Rearrange);
+    kdt.addSubcommand(new Estimate);
+    kdt.addSubcommand(new BenchTransfer);
+    kdt.addSubcommand(new UploadDumps);
+    kdt.addSubcommand(new ReassembleDumps);
+    kdt.addSubcommand(new ExtractRaw);
+    kdt.addSubcommand(new Receive);
+    kdt.addSubcommand(new Reconstruct);
+}
+
 // -----------------------------------------------------------------------------
 int main(int argc, char *argv[])
 {
@@ -52,17 +86,9 @@ int main(int argc, char *argv[])
     bool exception = false;
 
     try {
-        kdt.addSubcommand(new DeleteDumpsCommand);
-        kdt.addSubcommand(new DumpConfig);
-        kdt.addSubcommand(new FindKernel);
-        kdt.addSubcommand(new IdentifyKernel);
-        kdt.addSubcommand(new LedBlink);
-        kdt.addSubcommand(new Multipath);
-        kdt.addSubcommand(new PrintTarget);
-        kdt.addSubcommand(new ReadIKConfig);
-        kdt.addSubcommand(new ReadVmcoreinfo);
-        kdt.addSubcommand(new SaveDumpCommand);
-        kdt.addSubcommand(new Calibrate);
+        // the commands of a batch cannot start another batch
+        addSubcommands(kdt);
+        kdt.addSubcommand(new Batch(kdt, addSubcommands));
 
         kdt.parseCommandline(argc, argv);
         kdt.readConfiguration();
@@ -75,6 +101,9 @@ int main(int argc, char *argv[])
         exception = true;
     }
 
+    if (exception)
+        Debug::debug()->dumpEvents();
+
     if (exception && kdt.getErrorCode() == 0)
         return -1;
     else
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "global.h"
+#include "debug.h"
+#include "fileutil.h"
+#include "stringvector.h"
+#include "memoryhistory.h"
+
+using std::string;
+
+#define STATS_FILE      "stats.json"
+
+//{{{ MemoryHistory ------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+MemoryHistory::MemoryHistory(const string &host, const string &format,
+                             int level)
+    : m_host(host), m_format(format == "auto" ? string() : format),
+      m_level(level)
+{}
+
+// -----------------------------------------------------------------------------
+/**
+ * Returns the number after "key": in @p object, or 0 if there is none.
+ */
+static unsigned long long jsonNumber(const string &object, const string &key)
+{
+    string::size_type pos = object.find("\"" + key + "\": ");
+    if (pos == string::npos)
+        return 0;
+    return strtoull(object.c_str() + pos + key.size() + 4, NULL, 10);
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Returns the contents of a JSON string (SaveStats escapes only quotes,
+ * backslashes and control characters).
+ */
+static string jsonString(const string &value)
+{
+    string ret;
+    for (string::size_type i = 1; i < value.size() && value[i] != '"'; ++i) {
+        if (value[i] == '\\' && i + 1 < value.size())
+            ++i;
+        ret += value[i];
+    }
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+bool MemoryHistory::parse(const string &json, Dump &dump)
+{
+    dump = Dump();
+    bool memory = false;
+
+    // SaveStats writes one top-level field per line, indented by two
+    // spaces; the phases have their own "memory" objects further in
+    std::istringstream iss(json);
+    string line;
+    while (std::getline(iss, line)) {
+        if (line.compare(0, 3, "  \"") != 0)
+            continue;
+        string::size_type end = line.find("\": ", 3);
+        if (end == string::npos)
+            continue;
+        string key(line, 3, end - 3);
+        string value(line, end + 3);
+
+        if (key == "host")
+            dump.host = jsonString(value);
+        else if (key == "dump_format")
+            dump.format = jsonString(value);
+        else if (key == "status")
+            dump.status = jsonString(value);
+        else if (key == "dump_level")
+            dump.level = atoi(value.c_str());
+        else if (key == "mem_total_kb")
+            dump.memTotal = strtoull(value.c_str(), NULL, 10);
+        else if (key == "memory") {
+            dump.minAvailable = jsonNumber(value, "min_available_kb");
+            dump.pageCache = jsonNumber(value, "max_dirty_kb") +
+                jsonNumber(value, "max_writeback_kb");
+            dump.rss = jsonNumber(value, "max_rss_kb") +
+                jsonNumber(value, "max_makedumpfile_rss_kb");
+            memory = true;
+        }
+    }
+    return memory && dump.memTotal;
+}
+
+// -----------------------------------------------------------------------------
+void MemoryHistory::addDir(const FilePath &dir)
+{
+    Debug::debug()->trace("MemoryHistory::addDir(%s)", dir.c_str());
+
+    StringVector contents;
+    try {
+        contents = dir.listDir(FilterDotsAndNondirs());
+    } catch (const KError &error) {
+        Debug::debug()->dbg("%s", error.what());
+        return;
+    }
+
+    StringVector::const_iterator it;
+    for (it = contents.begin(); it != contents.end(); ++it) {
+        FilePath path(dir);
+        path.appendPath(*it).appendPath(STATS_FILE);
+        std::ifstream fin(path.c_str());
+        if (!fin)
+            continue;
+        std::ostringstream ss;
+        ss << fin.rdbuf();
+
+        Dump dump;
+        if (parse(ss.str(), dump))
+            add(dump, path);
+    }
+}
+
+// -----------------------------------------------------------------------------
+static string shortName(const string &host)
+{
+    return host.substr(0, host.find('.'));
+}
+
+// -----------------------------------------------------------------------------
+bool MemoryHistory::add(const Dump &dump, const string &source)
+{
+    // kdump-save may know the host with or without its domain
+    if (shortName(dump.host) != shortName(m_host)) {
+        Debug::debug()->dbg("%s: dump of %s", source.c_str(),
+                            dump.host.c_str());
+        return false;
+    }
+    if (dump.status == "failed") {
+        Debug::debug()->dbg("%s: failed dump", source.c_str());
+        return false;
+    }
+    if ((!m_format.empty() && dump.format != m_format) ||
+        dump.level != m_level) {
+        Debug::debug()->dbg("%s: %s dump at level %d", source.c_str(),
+                            dump.format.c_str(), dump.level);
+        return false;
+    }
+
+    Debug::debug()->dbg("%s: MemTotal %llu KiB, MemAvailable down to "
+                        "%llu KiB, page cache %llu KiB, RSS %llu KiB",
+                        source.c_str(), dump.memTotal, dump.minAvailable,
+                        dump.pageCache, dump.rss);
+    m_dumps.push_back(dump);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long MemoryHistory::rss() const
+{
+    unsigned long long ret = 0;
+    std::vector<Dump>::const_iterator it;
+    for (it = m_dumps.begin(); it != m_dumps.end(); ++it)
+        ret = std::max(ret, it->rss);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long MemoryHistory::pageCache() const
+{
+    unsigned long long ret = 0;
+    std::vector<Dump>::const_iterator it;
+    for (it = m_dumps.begin(); it != m_dumps.end(); ++it)
+        ret = std::max(ret, it->pageCache);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long MemoryHistory::shortfall(unsigned pct) const
+{
+    unsigned long long ret = 0;
+    std::vector<Dump>::const_iterator it;
+    for (it = m_dumps.begin(); it != m_dumps.end(); ++it) {
+        unsigned long long headroom = it->memTotal * pct / 100;
+        if (it->minAvailable < headroom)
+            ret = std::max(ret, headroom - it->minAvailable);
+    }
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+string MemoryHistory::fingerprint() const
+{
+    std::ostringstream ss;
+    std::vector<Dump>::const_iterator it;
+    for (it = m_dumps.begin(); it != m_dumps.end(); ++it)
+        ss << "history " << it->memTotal << " " << it->minAvailable << " "
+           << it->pageCache << " " << it->rss << "\n";
+    return ss.str();
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
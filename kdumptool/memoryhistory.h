@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#ifndef MEMORYHISTORY_H
+#define MEMORYHISTORY_H
+
+#include <string>
+#include <vector>
+
+#include "global.h"
+#include "fileutil.h"
+
+//{{{ MemoryHistory ------------------------------------------------------------
+
+/**
+ * The memory usage of earlier dumps of this host, as recorded by
+ * kdump-save in stats.json (see MemoryWatch). "kdumptool calibrate"
+ * corrects its model with the peaks.
+ *
+ * Only dumps with the same dump format and level as the current
+ * configuration are comparable, so the others are skipped, like the
+ * dumps of other hosts (a collector keeps the dumps of many hosts in
+ * one directory) and dumps without memory samples.
+ */
+class MemoryHistory {
+
+    public:
+        /**
+         * The memory peaks of one dump. All sizes are in KiB.
+         */
+        struct Dump {
+            std::string host;
+            std::string format;
+            std::string status;
+            int level;
+            unsigned long long memTotal;
+            unsigned long long minAvailable;
+            unsigned long long pageCache;   // dirty and writeback
+            unsigned long long rss;         // kdump-save and makedumpfile
+        };
+
+        /**
+         * Creates an empty history.
+         *
+         * @param[in] host the host name (with or without the domain)
+         * @param[in] format the dump format, any format if empty or "auto"
+         * @param[in] level the dump level
+         */
+        MemoryHistory(const std::string &host, const std::string &format,
+                      int level);
+
+        /**
+         * Parses a stats.json file.
+         *
+         * @param[in] json the contents of the file
+         * @param[out] dump the memory peaks
+         * @return @c true if the file has memory peaks
+         */
+        static bool parse(const std::string &json, Dump &dump);
+
+        /**
+         * Adds the stats.json files of all dump directories in @p dir.
+         * Files that cannot be read are skipped.
+         */
+        void addDir(const FilePath &dir);
+
+        /**
+         * Adds a dump if it is comparable with the current configuration.
+         *
+         * @param[in] dump the memory peaks
+         * @param[in] source where the peaks come from, for the debug log
+         * @return @c true if the dump has been added
+         */
+        bool add(const Dump &dump, const std::string &source);
+
+        /**
+         * Returns the number of dumps.
+         */
+        size_t size() const
+        { return m_dumps.size(); }
+
+        bool empty() const
+        { return m_dumps.empty(); }
+
+        /**
+         * Returns the highest RSS of kdump-save and makedumpfile.
+         */
+        unsigned long long rss() const;
+
+        /**
+         * Returns the highest amount of dirty and writeback pages.
+         */
+        unsigned long long pageCache() const;
+
+        /**
+         * Returns how much MemAvailable has fallen below @p pct percent
+         * of MemTotal in the worst dump, or 0 if it never has.
+         */
+        unsigned long long shortfall(unsigned pct) const;
+
+        /**
+         * Returns a line for each dump, for the calibrate cache.
+         */
+        std::string fingerprint() const;
+
+    private:
+        std::string m_host;
+        std::string m_format;
+        int m_level;
+        std::vector<Dump> m_dumps;
+};
+
+//}}}
+
+#endif /* MEMORYHISTORY_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <dirent.h>
+
+#include "global.h"
+#include "debug.h"
+#include "fileutil.h"
+#include "savestats.h"
+#include "memorywatch.h"
+
+using std::string;
+using std::ifstream;
+
+// Name of the helper whose memory is sampled along with kdump-save
+#define MEMORYWATCH_HELPER      "makedumpfile"
+
+//{{{ MemoryWatch --------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+MemoryWatch::MemoryWatch(const string &procdir)
+    : m_procdir(procdir), m_interval(1000), m_running(false)
+{}
+
+// -----------------------------------------------------------------------------
+MemoryWatch::~MemoryWatch()
+{
+    stop();
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long MemoryWatch::parseKb(std::istream &in, const string &key)
+{
+    string line;
+    while (std::getline(in, line)) {
+        if (line.size() <= key.size() || line[key.size()] != ':' ||
+            line.compare(0, key.size(), key) != 0)
+            continue;
+        return strtoull(line.c_str() + key.size() + 1, NULL, 10);
+    }
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+static unsigned long long meminfoKb(const string &meminfo, const string &key)
+{
+    std::istringstream iss(meminfo);
+    return MemoryWatch::parseKb(iss, key);
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long MemoryWatch::readKb(const string &file,
+                                       const string &key) const
+{
+    FilePath path(m_procdir);
+    path.appendPath(file);
+    ifstream fin(path.c_str());
+    return parseKb(fin, key);
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long MemoryWatch::helperRss() const
+{
+    DIR *dirp = opendir(m_procdir.c_str());
+    if (!dirp)
+        return 0;
+
+    unsigned long long ret = 0;
+    struct dirent *d;
+    while ((d = readdir(dirp)) != NULL) {
+        if (!isdigit((unsigned char)d->d_name[0]))
+            continue;
+
+        FilePath comm(m_procdir);
+        comm.appendPath(d->d_name).appendPath("comm");
+        ifstream fin(comm.c_str());
+        string name;
+        if (!std::getline(fin, name) || name != MEMORYWATCH_HELPER)
+            continue;
+
+        ret += readKb(string(d->d_name) + "/status", "VmRSS");
+    }
+    closedir(dirp);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+SaveStats::Memory MemoryWatch::sample() const
+{
+    SaveStats::Memory ret;
+    ret.time = SaveStats::Clock::now();
+
+    FilePath path(m_procdir);
+    path.appendPath("meminfo");
+    ifstream fin(path.c_str());
+    std::ostringstream meminfo;
+    meminfo << fin.rdbuf();
+
+    ret.available = meminfoKb(meminfo.str(), "MemAvailable");
+    ret.dirty = meminfoKb(meminfo.str(), "Dirty");
+    ret.writeback = meminfoKb(meminfo.str(), "Writeback");
+    ret.slab = meminfoKb(meminfo.str(), "Slab");
+
+    ret.rss = readKb("self/status", "VmRSS");
+    ret.helperRss = helperRss();
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void MemoryWatch::start()
+{
+    stop();
+
+    SaveStats *stats = SaveStats::stats();
+    stats->setField("mem_total_kb", readKb("meminfo", "MemTotal"));
+    stats->addMemory(sample());
+    try {
+        m_running = true;
+        m_thread = std::thread(&MemoryWatch::run, this);
+    } catch (...) {
+        // the dump does not need the samples
+        m_running = false;
+        Debug::debug()->dbg("Cannot start the memory watch");
+    }
+}
+
+// -----------------------------------------------------------------------------
+void MemoryWatch::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_cond.wait_for(lock, m_interval,
+                            [this]{ return !m_running; })) {
+        lock.unlock();
+        SaveStats::stats()->addMemory(sample());
+        lock.lock();
+    }
+}
+
+// -----------------------------------------------------------------------------
+void MemoryWatch::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_cond.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+        SaveStats::stats()->addMemory(sample());
+    }
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
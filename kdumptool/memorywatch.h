@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#ifndef MEMORYWATCH_H
+#define MEMORYWATCH_H
+
+#include <string>
+#include <istream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include "global.h"
+#include "savestats.h"
+
+//{{{ MemoryWatch --------------------------------------------------------------
+
+/**
+ * Samples the memory usage of the crash kernel while the dump is saved:
+ * MemAvailable, dirty and writeback pages, the slab caches, and the RSS
+ * of kdump-save and of makedumpfile. The samples go to SaveStats, which
+ * reports the peaks of each phase in stats.json, so that the reservation
+ * can be checked against what a real dump has needed.
+ *
+ * The sampling thread reads a few files in /proc once per interval,
+ * which is cheap enough to run during the whole save.
+ */
+class MemoryWatch {
+
+    public:
+        /**
+         * Creates a watch that does not sample yet.
+         *
+         * @param[in] procdir mount point of procfs
+         */
+        MemoryWatch(const std::string &procdir = "/proc");
+
+        /**
+         * Stops the sampling thread.
+         */
+        ~MemoryWatch();
+
+        /**
+         * Sets the time between two samples (default 1 second).
+         */
+        void setInterval(std::chrono::milliseconds interval)
+        { m_interval = interval; }
+
+        /**
+         * Records MemTotal and starts the sampling thread. The first
+         * sample is taken immediately. If the thread cannot be created,
+         * nothing is sampled.
+         */
+        void start();
+
+        /**
+         * Takes a last sample and stops the sampling thread.
+         */
+        void stop();
+
+        /**
+         * Takes one sample.
+         */
+        SaveStats::Memory sample() const;
+
+        /**
+         * Returns the value (in KiB) of @p key in a /proc/meminfo or
+         * /proc/PID/status file, or 0 if it is not there.
+         *
+         * @param[in] in the contents of the file
+         * @param[in] key the name of the value, e.g. "MemAvailable"
+         */
+        static unsigned long long parseKb(std::istream &in,
+                                          const std::string &key);
+
+    private:
+        MemoryWatch(const MemoryWatch &);
+        MemoryWatch &operator=(const MemoryWatch &);
+
+        void run();
+        unsigned long long readKb(const std::string &file,
+                                  const std::string &key) const;
+        unsigned long long helperRss() const;
+
+        std::string m_procdir;
+        std::chrono::milliseconds m_interval;
+        bool m_running;
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::thread m_thread;
+};
+
+//}}}
+
+#endif /* MEMORYWATCH_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
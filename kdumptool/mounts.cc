@@ -23,6 +23,7 @@
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <sstream>
 #include <string>
 
@@ -41,6 +42,8 @@
 
 #include <linux/btrfs.h>
 
+#include <blkid.h>
+
 #include "global.h"
 #include "debug.h"
 #include "mounts.h"
@@ -143,29 +146,6 @@ MountTable::MountTable(void)
         throw KError("Failed to initialize libmount table");
 }
 
-// -----------------------------------------------------------------------------
-MountTable::iterator MountTable::find_mount(FilePath const& path)
-{
-    Debug::debug()->trace("MountTable::find_mount(%s)", path.c_str());
-
-    FilePath cpath = path.getCanonicalPath();
-    size_t bestlen = 0;
-    iterator it(*this, MNT_ITER_FORWARD);
-    iterator best = it;
-    while (++it) {
-        if (it->isPseudoFS() || it->isSwapArea())
-            continue;
-
-        FilePath const& ctarget = it->canonicalTarget();
-        if (ctarget.length() >= bestlen &&
-            cpath.compare(0, ctarget.length(), ctarget) == 0) {
-            best = it;
-            bestlen = ctarget.length();
-        }
-    }
-    return best;
-}
-
 //}}}
 //{{{ KernelMountTable ---------------------------------------------------------
 
@@ -195,6 +175,137 @@ FstabMountTable::FstabMountTable(void)
         throw KError("Can't read fstab");
 }
 
+//}}}
+//{{{ MountIndex ---------------------------------------------------------------
+
+// the shared indexes and what they have been built from
+static std::mutex indexMutex;
+static std::shared_ptr<const MountIndex> kernelIndex;
+static MountWatch kernelIndexWatch;
+static std::shared_ptr<const MountIndex> fstabIndex;
+static struct stat fstabIndexStat;
+
+// -----------------------------------------------------------------------------
+/**
+ * Splits a canonical path into its components.
+ */
+static StringVector pathComponents(FilePath const& path)
+{
+    StringVector ret;
+    string::size_type pos = 0;
+    while (pos < path.length()) {
+        string::size_type end = path.find('/', pos);
+        if (end == string::npos)
+            end = path.length();
+        if (end > pos)
+            ret.push_back(path.substr(pos, end - pos));
+        pos = end + 1;
+    }
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+MountIndex::MountIndex(MountTable const& table)
+    : m_nodes(1), m_size(0)
+{
+    MountTable::iterator it(table, MNT_ITER_FORWARD);
+    while (++it) {
+        if (it->isPseudoFS() || it->isSwapArea())
+            continue;
+
+        StringVector components = pathComponents(it->canonicalTarget());
+        size_t node = 0;
+        StringVector::const_iterator comp;
+        for (comp = components.begin(); comp != components.end(); ++comp) {
+            std::map<string, size_t>::const_iterator child =
+                m_nodes[node].children.find(*comp);
+            if (child != m_nodes[node].children.end()) {
+                node = child->second;
+            } else {
+                m_nodes.emplace_back();
+                m_nodes[node].children[*comp] = m_nodes.size() - 1;
+                node = m_nodes.size() - 1;
+            }
+        }
+
+        if (!m_nodes[node].mp)
+            ++m_size;
+        m_nodes[node].mp = *it;
+    }
+}
+
+// -----------------------------------------------------------------------------
+MountPoint MountIndex::find(FilePath const& path) const
+{
+    Debug::debug()->trace("MountIndex::find(%s)", path.c_str());
+
+    StringVector components = pathComponents(path);
+    size_t node = 0, best = 0;
+    StringVector::const_iterator comp;
+    for (comp = components.begin(); comp != components.end(); ++comp) {
+        std::map<string, size_t>::const_iterator child =
+            m_nodes[node].children.find(*comp);
+        if (child == m_nodes[node].children.end())
+            break;
+        node = child->second;
+        if (m_nodes[node].mp)
+            best = node;
+    }
+    return m_nodes[best].mp;
+}
+
+// -----------------------------------------------------------------------------
+std::shared_ptr<const MountIndex> MountIndex::kernel(void)
+{
+    std::lock_guard<std::mutex> lock(indexMutex);
+
+    // checking also arms the watch before the table is read
+    if (kernelIndexWatch.changed() && kernelIndex) {
+        Debug::debug()->dbg("Kernel mount table has changed");
+        kernelIndex.reset();
+    }
+
+    if (!kernelIndex) {
+        kernelIndex = std::make_shared<const MountIndex>(KernelMountTable());
+        Debug::debug()->dbg("Indexed %zu kernel mounts", kernelIndex->size());
+    }
+    return kernelIndex;
+}
+
+// -----------------------------------------------------------------------------
+std::shared_ptr<const MountIndex> MountIndex::fstab(void)
+{
+    std::lock_guard<std::mutex> lock(indexMutex);
+
+    struct stat st;
+    if (stat("/etc/fstab", &st) != 0)
+        memset(&st, 0, sizeof st);
+    if (fstabIndex &&
+        (st.st_dev != fstabIndexStat.st_dev ||
+         st.st_ino != fstabIndexStat.st_ino ||
+         st.st_size != fstabIndexStat.st_size ||
+         st.st_mtim.tv_sec != fstabIndexStat.st_mtim.tv_sec ||
+         st.st_mtim.tv_nsec != fstabIndexStat.st_mtim.tv_nsec)) {
+        Debug::debug()->dbg("fstab has changed");
+        fstabIndex.reset();
+    }
+
+    if (!fstabIndex) {
+        fstabIndex = std::make_shared<const MountIndex>(FstabMountTable());
+        fstabIndexStat = st;
+        Debug::debug()->dbg("Indexed %zu fstab entries", fstabIndex->size());
+    }
+    return fstabIndex;
+}
+
+// -----------------------------------------------------------------------------
+void MountIndex::invalidate(void)
+{
+    std::lock_guard<std::mutex> lock(indexMutex);
+    kernelIndex.reset();
+    fstabIndex.reset();
+}
+
 //}}}
 //{{{ PathMountPoint -----------------------------------------------------------
 
@@ -204,11 +315,10 @@ PathMountPoint::PathMountPoint(FilePath const& path)
 {
     Debug::debug()->trace("PathMountPoint::PathMountPoint(%s)", path.c_str());
 
-    MountTable::iterator mp_kernel =
-        KernelMountTable().find_mount(path);
-    MountTable::iterator mp_fstab =
-        FstabMountTable().find_mount(path);
-    MountTable::iterator *best;
+    FilePath cpath = path.getCanonicalPath();
+    MountPoint mp_kernel = MountIndex::kernel()->find(cpath);
+    MountPoint mp_fstab = MountIndex::fstab()->find(cpath);
+    MountPoint *best;
 
     if (!mp_fstab) {
         Debug::debug()->dbg("%s: No fstab entry", path.c_str());
@@ -219,18 +329,18 @@ PathMountPoint::PathMountPoint(FilePath const& path)
     } else {
         Debug::debug()->dbg("%s: Kernel entry: %s, fstab entry: %s",
                             path.c_str(),
-                            mp_kernel->canonicalTarget().c_str(),
-                            mp_fstab->canonicalTarget().c_str());
+                            mp_kernel.canonicalTarget().c_str(),
+                            mp_fstab.canonicalTarget().c_str());
 
         // both exist: choose the longer one, or fstab if same length
-        if (mp_kernel->canonicalTarget().length() >
-            mp_fstab->canonicalTarget().length()) {
+        if (mp_kernel.canonicalTarget().length() >
+            mp_fstab.canonicalTarget().length()) {
             best = &mp_kernel;
         } else {
             best = &mp_fstab;
         }
     }
-    MountPoint::operator=(**best);
+    MountPoint::operator=(*best);
 
     if (*best) {
         Debug::debug()->dbg("Filesystem on %s mounted at %s",
@@ -490,6 +600,123 @@ StringStringMap& FilesystemTypeMap::devices(void)
     if (m_sources.empty())
         return m_devices;
 
+    if (!probeDevices())
+        runLsblk();
+    return m_devices;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Reads a "major:minor" device number from a sysfs file.
+ */
+static bool readDevno(const string &path, dev_t &devno)
+{
+    ifstream f(path.c_str());
+    unsigned int major, minor;
+    char sep;
+    if (!(f >> major >> sep >> minor) || sep != ':')
+        return false;
+    devno = makedev(major, minor);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Gets the superblock type of a device with libblkid.
+ *
+ * @return @c false if the device cannot be probed
+ */
+static bool probeType(const string &path, string &type)
+{
+    blkid_probe pr = blkid_new_probe_from_filename(path.c_str());
+    if (!pr) {
+        Debug::debug()->dbg("Cannot probe %s: %s", path.c_str(),
+                            strerror(errno));
+        return false;
+    }
+
+    blkid_probe_enable_superblocks(pr, 1);
+    blkid_probe_set_superblocks_flags(pr, BLKID_SUBLKS_TYPE);
+    int rc = blkid_do_safeprobe(pr);
+
+    // nothing found (1) and ambivalent results (-2) have no type
+    const char *value;
+    if (rc == 0 && blkid_probe_lookup_value(pr, "TYPE", &value, NULL) == 0)
+        type = value;
+    else
+        type.clear();
+    blkid_free_probe(pr);
+    return rc != -1;
+}
+
+// -----------------------------------------------------------------------------
+bool FilesystemTypeMap::probeDevices(void)
+{
+    std::vector<dev_t> todo;
+    for (std::set<string>::const_iterator it = m_sources.begin();
+         it != m_sources.end(); ++it) {
+        struct stat st;
+        if (stat(it->c_str(), &st) != 0 || !S_ISBLK(st.st_mode)) {
+            Debug::debug()->dbg("%s is not a block device", it->c_str());
+            return false;
+        }
+        todo.push_back(st.st_rdev);
+    }
+
+    // walk up the device tree like lsblk --inverse
+    StringStringMap found;
+    std::set<dev_t> seen;
+    while (!todo.empty()) {
+        dev_t devno = todo.back();
+        todo.pop_back();
+        if (!seen.insert(devno).second)
+            continue;
+
+        ostringstream ss;
+        ss << "/sys/dev/block/" << major(devno) << ':' << minor(devno);
+        FilePath sys = ss.str();
+        if (!sys.isSymlink())
+            return false;
+
+        // name it like lsblk: /dev/mapper/<name> for device mapper
+        string path;
+        ifstream dmname((sys + "/dm/name").c_str());
+        string name;
+        if (dmname >> name)
+            path = "/dev/mapper/" + name;
+        else
+            path = "/dev/" + FilePath(sys.readLink()).baseName();
+
+        string type;
+        if (!probeType(path, type))
+            return false;
+        found[path] = type;
+        Debug::debug()->dbg("Device %s type %s", path.c_str(), type.c_str());
+
+        // a partition belongs to the whole disk
+        dev_t parent;
+        if (access((sys + "/partition").c_str(), F_OK) == 0 &&
+            readDevno(sys + "/../dev", parent))
+            todo.push_back(parent);
+
+        // device mapper and RAID devices are built from their slaves
+        FilePath slaves = sys + "/slaves";
+        if (slaves.exists()) {
+            StringVector list = slaves.listDir(FilterDots());
+            for (StringVector::const_iterator it = list.begin();
+                 it != list.end(); ++it)
+                if (readDevno(slaves + "/" + *it + "/dev", parent))
+                    todo.push_back(parent);
+        }
+    }
+
+    m_devices.insert(found.begin(), found.end());
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+void FilesystemTypeMap::runLsblk(void)
+{
     ProcessFilter p;
 
     StringVector args;
@@ -526,8 +753,6 @@ StringStringMap& FilesystemTypeMap::devices(void)
         }
         pos = out.find_first_not_of("\r\n", end);
     }
-
-    return m_devices;
 }
 
 //}}}
@@ -19,7 +19,11 @@
 #ifndef MOUNTS_H
 #define MOUNTS_H
 
+#include <map>
+#include <memory>
 #include <set>
+#include <string>
+#include <vector>
 
 #include "global.h"
 #include "fileutil.h"
@@ -197,8 +201,6 @@ class MountTable {
         };
 
         MountTable(void);
-
-        iterator find_mount(FilePath const& path);
 };
 
 //}}}
@@ -221,6 +223,78 @@ class FstabMountTable : public MountTable {
         FstabMountTable(void);
 };
 
+//}}}
+//{{{ MountIndex ---------------------------------------------------------------
+
+/**
+ * Longest-prefix index of a mount table.
+ *
+ * The canonical targets are computed once when the index is built, and
+ * the mounts are kept in a trie of path components, so that a lookup
+ * takes one step per component of the path. Pseudo filesystems and swap
+ * areas are left out. If several mounts have the same target, the last
+ * one wins, like the kernel's view of over-mounted directories.
+ *
+ * The kernel and fstab indexes are shared by the whole process. The
+ * kernel index is rebuilt only after the mount table has changed (the
+ * kernel signals that with poll() on /proc/self/mountinfo), the fstab
+ * index only after /etc/fstab has changed.
+ */
+class MountIndex {
+    public:
+        /**
+         * Builds the index of @p table.
+         */
+        MountIndex(MountTable const& table);
+
+        /**
+         * Finds the mount that contains a path.
+         *
+         * @param[in] path a canonical path
+         * @return the mount point, or an empty one if none matches
+         */
+        MountPoint find(FilePath const& path) const;
+
+        /**
+         * Returns the number of indexed mounts.
+         */
+        size_t size(void) const
+        { return m_size; }
+
+        /**
+         * Returns the index of the kernel mount table.
+         *
+         * @exception KError if the mount table cannot be read
+         */
+        static std::shared_ptr<const MountIndex> kernel(void);
+
+        /**
+         * Returns the index of /etc/fstab.
+         *
+         * @exception KError if fstab cannot be read
+         */
+        static std::shared_ptr<const MountIndex> fstab(void);
+
+        /**
+         * Drops both shared indexes, e.g. after a mount that the
+         * change detection cannot see.
+         */
+        static void invalidate(void);
+
+    private:
+        struct Node {
+            std::map<std::string, size_t> children;
+            MountPoint mp;
+
+            Node()
+                : mp(MntFS(NULL))
+            { }
+        };
+
+        std::vector<Node> m_nodes;
+        size_t m_size;
+};
+
 //}}}
 //{{{ PathMountPoint -----------------------------------------------------------
 
@@ -259,6 +333,13 @@ class PathResolver {
 //}}}
 //{{{ FilesystemTypeMap --------------------------------------------------------
 
+/**
+ * Filesystem types of the block devices below a set of paths.
+ *
+ * The devices and their parents (whole disks, and the slaves of device
+ * mapper or RAID devices) are found in sysfs and probed with libblkid.
+ * If that is not possible, "lsblk --inverse" is used instead.
+ */
 class FilesystemTypeMap {
     protected:
         PathResolver m_resolver;
@@ -268,6 +349,10 @@ class FilesystemTypeMap {
     public:
         void addPath(FilePath const& path);
         StringStringMap& devices(void);
+
+    private:
+        bool probeDevices(void);
+        void runLsblk(void);
 };
 
 //}}}
@@ -16,8 +16,13 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
  * 02110-1301, USA.
  */
-#include <iostream>
 #include <string>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "subcommand.h"
 #include "debug.h"
@@ -25,47 +30,107 @@
 #include "configuration.h"
 
 using std::string;
-using std::cin;
-using std::cout;
+using std::string_view;
+
+// output is collected and written in blocks of this size
+#define MULTIPATH_OUTPUT_BUFFER (64*1024)
 
 //{{{ MultipathConf -----------------------------------------------------------
 
 // -----------------------------------------------------------------------------
-MultipathConf::MultipathConf(std::istream &input)
-    : m_input(input)
+MultipathConf::MultipathConf(int fd)
+    : m_fd(fd), m_loaded(false), m_map(MAP_FAILED), m_mapSize(0)
+{ }
+
+// -----------------------------------------------------------------------------
+MultipathConf::MultipathConf(string_view data)
+    : m_fd(-1), m_loaded(true), m_map(MAP_FAILED), m_mapSize(0),
+      m_data(data)
 { }
 
+// -----------------------------------------------------------------------------
+MultipathConf::~MultipathConf()
+{
+    if (m_map != MAP_FAILED)
+        munmap(m_map, m_mapSize);
+}
+
+// -----------------------------------------------------------------------------
+void MultipathConf::load(void)
+{
+    if (m_loaded)
+        return;
+    m_loaded = true;
+
+    // a regular file (the usual redirect from /etc/multipath.conf)
+    // can be mapped
+    struct stat st;
+    if (fstat(m_fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        off_t offset = lseek(m_fd, 0, SEEK_CUR);
+        if (offset >= 0 && offset < st.st_size) {
+            m_mapSize = st.st_size;
+            m_map = mmap(NULL, m_mapSize, PROT_READ, MAP_PRIVATE, m_fd, 0);
+            if (m_map != MAP_FAILED) {
+                madvise(m_map, m_mapSize, MADV_SEQUENTIAL);
+                m_data = string_view(static_cast<const char *>(m_map) + offset,
+                                     m_mapSize - offset);
+                return;
+            }
+            Debug::debug()->dbg("Cannot map input: %s", strerror(errno));
+        }
+    }
+
+    // anything else is read at once
+    char buf[MULTIPATH_OUTPUT_BUFFER];
+    ssize_t ret;
+    while ((ret = read(m_fd, buf, sizeof buf)) != 0) {
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            throw KSystemError("Cannot read multipath.conf", errno);
+        }
+        m_buffer.append(buf, ret);
+    }
+    m_data = m_buffer;
+}
+
 // -----------------------------------------------------------------------------
 void MultipathConf::process(class Handler &handler)
 {
-    while (readline()) {
-	StringVector tokens;
-	string::const_iterator it = m_line.begin();
+    load();
+
+    TokenVector tokens;
+    string_view line;
+    size_t pos = 0;
+    while (readline(pos, line)) {
+	tokens.clear();
+	const char *it = line.data();
+	const char *const end = line.data() + line.size();
 	bool stringmode = false;
 	while (1) {
 
 	    // skip whitespace
-	    while (it != m_line.end() && *it &&
+	    while (it != end && *it &&
 		   (isspace(*it) || *it < 0))
 		++it;
 
 	    // end of line or comment?
-	    if (it == m_line.end() || *it == '\0' || *it == '#' || *it == '!')
+	    if (it == end || *it == '\0' || *it == '#' || *it == '!')
 		break;
 
 	    // get a token
 	    if (*it == '"') {
 		// double quotes toggle string mode
 		stringmode = !stringmode;
-		tokens.push_back(string(1, *it));
+		tokens.push_back(string_view(it, 1));
 		++it;
 	    } else if (!stringmode && (*it == '{' || *it == '}')) {
 		// group start/end
-		tokens.push_back(string(1, *it));
+		tokens.push_back(string_view(it, 1));
 		++it;
 	    } else {
-		string::const_iterator itr(it);
-		while (itr != m_line.end() && *itr != '\0' &&
+		const char *itr = it;
+		while (itr != end && *itr != '\0' &&
 		       // quote terminates a token
 		       *itr != '"' &&
 		       // any special character is accepted in string mode
@@ -78,31 +143,87 @@ void MultipathConf::process(class Handler &handler)
 			  // * group start/end
 			  *itr == '{' || *itr == '}')))
 		    ++itr;
-		tokens.push_back(string(it, itr));
+		tokens.push_back(string_view(it, itr - it));
 		it = itr;
 	    }
 	}
 
-	handler.process(m_line, tokens);
+	handler.process(line, tokens);
     }
 
-    StringVector empty;
-    handler.process(m_line, empty);
+    // the unterminated rest is passed on, but not parsed
+    tokens.clear();
+    handler.process(line, tokens);
 }
 
 // -----------------------------------------------------------------------------
-bool MultipathConf::readline(void)
+bool MultipathConf::readline(size_t &pos, string_view &line) const
 {
-    char c;
-    m_line.clear();
-    do {
-	if (!m_input.get(c))
-	    break;
-	m_line += c;
-    } while (c != '\n' && c != '\r');
-    return !m_input.fail();
+    size_t end = m_data.find_first_of("\r\n", pos);
+    if (end == string_view::npos) {
+        line = m_data.substr(pos);
+        pos = m_data.size();
+        return false;
+    }
+    line = m_data.substr(pos, end + 1 - pos);
+    pos = end + 1;
+    return true;
 }
 
+//{{{ OutputBuffer ------------------------------------------------------------
+
+/**
+ * Collects output and writes it to a file descriptor in large blocks.
+ */
+class OutputBuffer {
+    public:
+        OutputBuffer(int fd)
+            : m_fd(fd)
+        { m_buffer.reserve(MULTIPATH_OUTPUT_BUFFER); }
+
+        void write(string_view data)
+        {
+            if (m_buffer.size() + data.size() > MULTIPATH_OUTPUT_BUFFER)
+                flush();
+            if (data.size() >= MULTIPATH_OUTPUT_BUFFER)
+                writeAll(data);
+            else
+                m_buffer.append(data);
+        }
+
+        /**
+         * Writes the collected data.
+         *
+         * @exception KSystemError if writing fails
+         */
+        void flush(void)
+        {
+            writeAll(m_buffer);
+            m_buffer.clear();
+        }
+
+    private:
+        int m_fd;
+        string m_buffer;
+
+        void writeAll(string_view data);
+};
+
+// -----------------------------------------------------------------------------
+void OutputBuffer::writeAll(string_view data)
+{
+    while (!data.empty()) {
+        ssize_t ret = ::write(m_fd, data.data(), data.size());
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            throw KSystemError("Cannot write multipath.conf", errno);
+        }
+        data.remove_prefix(ret);
+    }
+}
+
+//}}}
 //{{{ AddBlacklistHandler -----------------------------------------------------
 
 /**
@@ -119,65 +240,81 @@ bool MultipathConf::readline(void)
  * which is known (to multipath!) to start a subsection. As a result, the
  * state of the multipath parser at the end of the file cannot be reliably
  * known. Unlike the state at the beginning of the file.
+ *
+ * The lines are kept as views of the input until finish() writes them.
  */
 class AddBlacklistHandler : public MultipathConf::Handler
 {
     public:
-        AddBlacklistHandler(std::ostream &output,
+        AddBlacklistHandler(OutputBuffer &output,
 			    const StringVector &exceptions);
-        ~AddBlacklistHandler();
 
-        virtual void process(const std::string &raw, StringVector &tokens);
+        virtual void process(string_view raw,
+                             const MultipathConf::TokenVector &tokens);
+
+        /**
+         * Writes the modified file.
+         */
+        void finish(void);
 
     protected:
-	std::ostream &m_output;
-        const StringVector &m_exceptions;
+	OutputBuffer &m_output;
 
     private:
-        void addLine(const std::string &raw);
-        void outputLine(const std::string &raw);
-        typedef void (AddBlacklistHandler::*lineHandler)(const std::string&);
+        void addLine(string_view raw);
+        void outputLine(string_view raw);
+        typedef void (AddBlacklistHandler::*lineHandler)(string_view);
         void doBlacklist(lineHandler handler);
         void doExceptions(lineHandler handler);
 
+        /**
+         * Lines to be added to blacklist_exceptions, formatted once
+         */
+        StringVector m_exceptions;
+
         /**
 	 * Raw lines read from the input config file
 	 */
-        StringVector m_lines;
+        std::vector<string_view> m_lines;
 
         bool m_blacklist_done;
         bool m_exceptions_done;
 };
 
 // -----------------------------------------------------------------------------
-AddBlacklistHandler::AddBlacklistHandler(std::ostream &output,
+AddBlacklistHandler::AddBlacklistHandler(OutputBuffer &output,
                                          const StringVector &exceptions)
-    : m_output(output), m_exceptions(exceptions),
+    : m_output(output),
       m_blacklist_done(false), m_exceptions_done(false)
-{ }
-
-// -----------------------------------------------------------------------------
-AddBlacklistHandler::~AddBlacklistHandler()
 {
     StringVector::const_iterator it;
+    for (it = exceptions.begin(); it != exceptions.end(); ++it)
+	m_exceptions.push_back("\t" + *it + "\n");
+}
 
+// -----------------------------------------------------------------------------
+void AddBlacklistHandler::finish(void)
+{
     if (!m_blacklist_done) {
-        m_output << "blacklist {\n";
+        m_output.write("blacklist {\n");
         doBlacklist(&AddBlacklistHandler::outputLine);
-        m_output << "}\n";
+        m_output.write("}\n");
     }
     if (!m_exceptions_done) {
-        m_output << "blacklist_exceptions {\n";
+        m_output.write("blacklist_exceptions {\n");
         doExceptions(&AddBlacklistHandler::outputLine);
-        m_output << "}\n";
+        m_output.write("}\n");
     }
 
+    std::vector<string_view>::const_iterator it;
     for (it = m_lines.begin(); it != m_lines.end(); ++it)
-        m_output << *it;
+        m_output.write(*it);
+    m_output.flush();
 }
 
 // -----------------------------------------------------------------------------
-void AddBlacklistHandler::process(const string &raw, StringVector &tokens)
+void AddBlacklistHandler::process(string_view raw,
+                                  const MultipathConf::TokenVector &tokens)
 {
     m_lines.push_back(raw);
     if (tokens.size() > 0) {
@@ -189,15 +326,15 @@ void AddBlacklistHandler::process(const string &raw, StringVector &tokens)
 }
 
 // -----------------------------------------------------------------------------
-void AddBlacklistHandler::addLine(const string &raw)
+void AddBlacklistHandler::addLine(string_view raw)
 {
     m_lines.push_back(raw);
 }
 
 // -----------------------------------------------------------------------------
-void AddBlacklistHandler::outputLine(const string &raw)
+void AddBlacklistHandler::outputLine(string_view raw)
 {
-    m_output << raw;
+    m_output.write(raw);
 }
 
 // -----------------------------------------------------------------------------
@@ -211,7 +348,7 @@ void AddBlacklistHandler::doExceptions(lineHandler handler)
 {
     StringVector::const_iterator it;
     for (it = m_exceptions.begin(); it != m_exceptions.end(); ++it)
-	(this->*handler)("\t" + *it + "\n");
+	(this->*handler)(*it);
     m_exceptions_done = true;
 }
 
@@ -219,7 +356,7 @@ void AddBlacklistHandler::doExceptions(lineHandler handler)
 
 // -----------------------------------------------------------------------------
 Multipath::Multipath()
-    : m_parser(cin)
+    : m_parser(STDIN_FILENO)
 { }
 
 // -----------------------------------------------------------------------------
@@ -246,8 +383,10 @@ void Multipath::parseArgs(const StringVector &args)
 void Multipath::execute()
 {
     Debug::debug()->trace("Multipath::execute()");
-    AddBlacklistHandler handler(cout, m_exceptions);
+    OutputBuffer output(STDOUT_FILENO);
+    AddBlacklistHandler handler(output, m_exceptions);
     m_parser.process(handler);
+    handler.finish();
 }
 
 //}}}
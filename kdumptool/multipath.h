@@ -19,6 +19,10 @@
 #ifndef MULTIPATH_H
 #define MULTIPATH_H
 
+#include <string>
+#include <string_view>
+#include <vector>
+
 #include "subcommand.h"
 #include "stringvector.h"
 
@@ -34,36 +38,66 @@
 // * Keywords which are recognized as group-openers don't need an opening
 //   '{' character. However, if it is present, it must be on the same line.
 // * Closing brace may be followed by any garbage
+//
+// The input is mapped (or read at once if it is not a regular file), and
+// lines and tokens are views of it, so that large files with many WWIDs
+// are parsed without copying.
 
 class MultipathConf {
     public:
+        typedef std::vector<std::string_view> TokenVector;
+
         class Handler {
 	    public:
+	        virtual ~Handler()
+	        { }
+
 	        /**
 		 * Process a parsed input line.
 		 *
 		 * @param[in] raw    raw line data, including the end-of-line
-		 *                   marker (CR or LF)
-		 * @param[in] tokens parsed tokens (one string per token)
+		 *                   marker (CR or LF); valid until the
+		 *                   MultipathConf object is destroyed
+		 * @param[in] tokens parsed tokens (one view per token)
 		 */
-	        virtual void process(const std::string &raw,
-				     StringVector &tokens)
+	        virtual void process(std::string_view raw,
+				     const TokenVector &tokens)
 		= 0;
         };
 
     public:
-        MultipathConf(std::istream &input);
+        /**
+         * Creates a parser for the data read from @p fd.
+         */
+        MultipathConf(int fd);
+
+        /**
+         * Creates a parser for @p data, which must stay valid.
+         */
+        MultipathConf(std::string_view data);
+
+        ~MultipathConf();
 
         /**
          * Process input with a given handler
+         *
+         * @exception KError if the input cannot be read
          */
         void process(class Handler &handler);
 
     private:
-        std::istream &m_input;
-        std::string m_line;
-
-        bool readline(void);
+        int m_fd;
+        bool m_loaded;
+        void *m_map;
+        size_t m_mapSize;
+        std::string m_buffer;
+        std::string_view m_data;
+
+        MultipathConf(const MultipathConf &);
+        MultipathConf &operator=(const MultipathConf &);
+
+        void load(void);
+        bool readline(size_t &pos, std::string_view &line) const;
 };
 
 //{{{ Multipath ---------------------------------------------------------------
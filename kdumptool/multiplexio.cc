@@ -19,45 +19,108 @@
 
 #include <cerrno>
 #include <poll.h>
+#include <unistd.h>
+#include <sys/epoll.h>
 
 #include "global.h"
 #include "multiplexio.h"
 
+// the event bits are passed through unchanged
+static_assert(POLLIN == EPOLLIN && POLLOUT == EPOLLOUT &&
+              POLLPRI == EPOLLPRI && POLLERR == EPOLLERR &&
+              POLLHUP == EPOLLHUP, "poll and epoll event bits differ");
+
+// maximum number of events returned by one epoll_wait()
+#define MAX_EVENTS      16
+
 //{{{ MultiplexIO --------------------------------------------------------------
 
+// -----------------------------------------------------------------------------
+MultiplexIO::MultiplexIO(void)
+    : m_active(0)
+{
+    m_epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epfd < 0)
+	throw KSystemError("epoll_create1() failed", errno);
+}
+
+// -----------------------------------------------------------------------------
+MultiplexIO::~MultiplexIO()
+{
+    close(m_epfd);
+}
+
 // -----------------------------------------------------------------------------
 int MultiplexIO::add(int fd, short events)
 {
-    if (fd >= 0)
+    int idx = m_fds.size();
+    bool always = false;
+
+    if (fd >= 0) {
+	struct epoll_event ev;
+	ev.events = events;
+	ev.data.u32 = idx;
+	if (epoll_ctl(m_epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+	    if (errno != EPERM)
+		throw KSystemError("epoll_ctl() failed", errno);
+	    always = true;
+	}
 	++m_active;
+    }
 
     struct pollfd poll;
     poll.fd = fd;
     poll.events = events;
+    poll.revents = 0;
     m_fds.push_back(poll);
+    m_always.push_back(always);
 
-    return m_fds.size() - 1;
+    return idx;
 }
 
 // -----------------------------------------------------------------------------
 void MultiplexIO::deactivate(int idx)
 {
-    if (m_fds[idx].fd >= 0)
+    if (m_fds[idx].fd >= 0) {
 	--m_active;
+	if (!m_always[idx])
+	    epoll_ctl(m_epfd, EPOLL_CTL_DEL, m_fds[idx].fd, NULL);
+    }
     m_fds[idx].fd = -1;
+    m_fds[idx].revents = 0;
 }
 
 // -----------------------------------------------------------------------------
 int MultiplexIO::monitor(int timeout)
 {
-    int ret;
+    int ret = 0;
+
+    for (size_t i = 0; i < m_fds.size(); ++i) {
+	m_fds[i].revents = 0;
+	if (m_always[i] && m_fds[i].fd >= 0) {
+	    m_fds[i].revents = m_fds[i].events & (POLLIN | POLLOUT);
+	    ++ret;
+	}
+    }
+    if (ret)
+	timeout = 0;
 
+    struct epoll_event ev[MAX_EVENTS];
+    int n;
     do {
-	ret = poll(m_fds.data(), m_fds.size(), timeout);
-    } while (ret < 0 && errno == EINTR);
+	n = epoll_wait(m_epfd, ev, MAX_EVENTS, timeout);
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0)
+	throw KSystemError("epoll_wait() failed", errno);
 
-    if (ret < 0)
-	throw KSystemError("poll() failed", errno);
+    for (int i = 0; i < n; ++i) {
+	struct pollfd &poll = m_fds[ev[i].data.u32];
+	if (poll.fd >= 0) {
+	    poll.revents = ev[i].events;
+	    ++ret;
+	}
+    }
 
     return ret;
 }
@@ -26,18 +26,36 @@
 
 //{{{ MultiplexIO --------------------------------------------------------------
 
+/**
+ * Wait for events on a set of file descriptors.
+ *
+ * The interface uses struct pollfd and the POLL* event bits, but the
+ * descriptors are watched with epoll(7), so the cost of monitor() does
+ * not grow with the number of deactivated entries. Descriptors that
+ * epoll cannot watch (regular files) are always ready, like with poll().
+ */
 class MultiplexIO {
 
 	std::vector<struct pollfd> m_fds;
+	std::vector<bool> m_always;
 	int m_active;
+	int m_epfd;
 
     public:
 	/**
-	 * Trivial constructor.
+	 * Create the epoll instance.
+	 *
+	 * @exception KSystemError if epoll_create1() fails
 	 */
-	MultiplexIO(void)
-            : m_active(0)
-        {}
+	MultiplexIO(void);
+
+	/**
+	 * Close the epoll instance.
+	 */
+	~MultiplexIO();
+
+	MultiplexIO(const MultiplexIO &) = delete;
+	MultiplexIO &operator=(const MultiplexIO &) = delete;
 
 	/**
 	 * Add a file descriptor to monitor.
@@ -55,7 +73,8 @@ class MultiplexIO {
         { return m_fds.at(idx); }
 
 	/**
-	 * Remove a monitored file descriptor.
+	 * Remove a monitored file descriptor. Call this before the file
+	 * descriptor is closed.
 	 *
 	 * @param[in] idx index in the poll vector
 	 */
@@ -71,7 +90,8 @@ class MultiplexIO {
 	 * Wait for a monitored event.
 	 *
 	 * @param[in] timeout max time to wait (in milliseconds)
-	 * @returns the number of events
+	 * @returns the number of file descriptors with events; the events
+	 *          are stored in the @c revents field (see at())
 	 */
 	int monitor(int timeout = -1);
 };
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "global.h"
+#include "debug.h"
+#include "configuration.h"
+#include "stringutil.h"
+#include "nettuning.h"
+
+using std::string;
+
+#ifndef TCP_NOTSENT_LOWAT
+#define TCP_NOTSENT_LOWAT       25
+#endif
+
+static const char SYSCTL_CONGESTION[] =
+    "/proc/sys/net/ipv4/tcp_congestion_control";
+static const char SYSCTL_NOTSENT_LOWAT[] =
+    "/proc/sys/net/ipv4/tcp_notsent_lowat";
+static const char SYSCTL_WMEM_MAX[] = "/proc/sys/net/core/wmem_max";
+static const char SYSCTL_TCP_WMEM[] = "/proc/sys/net/ipv4/tcp_wmem";
+
+//{{{ NetTuning ----------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+static unsigned long parseSize(const string &key, const string &value)
+{
+    char *end;
+    errno = 0;
+    unsigned long ret = strtoul(value.c_str(), &end, 0);
+    if (end == value.c_str() || errno)
+        throw KError("Invalid " + key + " size: " + value);
+
+    switch (*end) {
+    case 'G': case 'g':
+        ret <<= 10;
+        /* fall through */
+    case 'M': case 'm':
+        ret <<= 10;
+        /* fall through */
+    case 'K': case 'k':
+        ret <<= 10;
+        ++end;
+        break;
+    }
+    if (*end)
+        throw KError("Invalid " + key + " size: " + value);
+
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+NetTuning::NetTuning(const string &spec, const string &host)
+    : m_sndbuf(0), m_notsentLowat(0)
+{
+    std::istringstream iss(spec);
+    string word;
+    while (iss >> word) {
+        string::size_type at = word.rfind('@');
+        if (at != string::npos) {
+            if (word.compare(at + 1, string::npos, host) != 0)
+                continue;
+            word.erase(at);
+        }
+
+        string::size_type eq = word.find('=');
+        if (eq == string::npos)
+            throw KError("Invalid KDUMP_NET_TUNING setting: " + word);
+        string key(word, 0, eq);
+        string value(word, eq + 1);
+
+        if (key == "cc")
+            m_congestion = value;
+        else if (key == "sndbuf")
+            m_sndbuf = parseSize(key, value);
+        else if (key == "lowat")
+            m_notsentLowat = parseSize(key, value);
+        else
+            throw KError("Unknown KDUMP_NET_TUNING setting: " + key);
+    }
+}
+
+// -----------------------------------------------------------------------------
+NetTuning NetTuning::forHost(const string &host)
+{
+    Configuration *config = Configuration::config();
+    try {
+        return NetTuning(config->KDUMP_NET_TUNING.value(), host);
+    } catch (const KError &error) {
+        // a typo should not cost the dump
+        std::cerr << "WARNING: " << error.what() << std::endl;
+        return NetTuning();
+    }
+}
+
+// -----------------------------------------------------------------------------
+void NetTuning::apply(int fd) const
+{
+    Debug::debug()->trace("NetTuning::apply(%d)", fd);
+
+    if (m_sndbuf) {
+        int val = m_sndbuf;
+        if (setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &val, sizeof val))
+            Debug::debug()->dbg("Cannot set SO_SNDBUF: %s", strerror(errno));
+    }
+
+    if (m_notsentLowat) {
+        int val = m_notsentLowat;
+        if (setsockopt(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &val, sizeof val))
+            Debug::debug()->dbg("Cannot set TCP_NOTSENT_LOWAT: %s",
+                                strerror(errno));
+    }
+
+    // the kernel loads the module if needed
+    if (!m_congestion.empty() &&
+        setsockopt(fd, IPPROTO_TCP, TCP_CONGESTION,
+                   m_congestion.c_str(), m_congestion.size()))
+        Debug::debug()->dbg("Cannot set TCP congestion control %s: %s",
+                            m_congestion.c_str(), strerror(errno));
+}
+
+// -----------------------------------------------------------------------------
+static string readSysctl(const char *path)
+{
+    std::ifstream fin(path);
+    string ret;
+    std::getline(fin, ret);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+static void writeSysctl(const char *path, const string &value)
+{
+    Debug::debug()->dbg("Setting %s to %s", path, value.c_str());
+
+    std::ofstream fout(path);
+    fout << value << std::endl;
+    if (!fout)
+        Debug::debug()->info("Cannot write %s to %s", value.c_str(), path);
+}
+
+// -----------------------------------------------------------------------------
+void NetTuning::applySystem(const StringVector &hosts)
+{
+    Debug::debug()->trace("NetTuning::applySystem([%zd hosts])",
+                          hosts.size());
+
+    NetTuning all;
+    for (StringVector::const_iterator it = hosts.begin();
+         it != hosts.end(); ++it) {
+        NetTuning t = forHost(*it);
+        if (all.m_congestion.empty())
+            all.m_congestion = t.m_congestion;
+        if (t.m_sndbuf > all.m_sndbuf)
+            all.m_sndbuf = t.m_sndbuf;
+        if (t.m_notsentLowat > all.m_notsentLowat)
+            all.m_notsentLowat = t.m_notsentLowat;
+    }
+
+    if (!all.m_congestion.empty())
+        writeSysctl(SYSCTL_CONGESTION, all.m_congestion);
+
+    if (all.m_notsentLowat)
+        writeSysctl(SYSCTL_NOTSENT_LOWAT,
+                    StringUtil::number2string(all.m_notsentLowat));
+
+    // SO_SNDBUF is capped by wmem_max, autotuning by tcp_wmem
+    if (all.m_sndbuf) {
+        unsigned long cur = strtoul(readSysctl(SYSCTL_WMEM_MAX).c_str(),
+                                    NULL, 10);
+        if (cur < all.m_sndbuf)
+            writeSysctl(SYSCTL_WMEM_MAX,
+                        StringUtil::number2string(all.m_sndbuf));
+
+        unsigned long min, def, max;
+        std::istringstream iss(readSysctl(SYSCTL_TCP_WMEM));
+        if (iss >> min >> def >> max && max < all.m_sndbuf) {
+            std::ostringstream oss;
+            oss << min << ' ' << def << ' ' << all.m_sndbuf;
+            writeSysctl(SYSCTL_TCP_WMEM, oss.str());
+        }
+    }
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef NETTUNING_H
+#define NETTUNING_H
+
+#include <string>
+
+#include "global.h"
+#include "stringvector.h"
+
+//{{{ NetTuning ----------------------------------------------------------------
+
+/**
+ * TCP settings for the connections to one dump target.
+ *
+ * The settings are given in KDUMP_NET_TUNING as words of the form
+ * <tt>key=value</tt> or <tt>key=value\@host</tt>, where the second form
+ * applies only to the connections to @c host. Later words override
+ * earlier ones. The keys are:
+ *
+ *  - @c cc: TCP congestion control algorithm (e.g. "bbr"),
+ *  - @c sndbuf: socket send buffer size,
+ *  - @c lowat: limit of unsent data in the socket (TCP_NOTSENT_LOWAT).
+ *
+ * Sizes may have a K, M or G suffix.
+ *
+ * The crash kernel runs with default sysctls, so apply() tunes the
+ * sockets that kdumptool creates itself, and applySystem() changes the
+ * defaults for the connections of child processes (ssh).
+ */
+class NetTuning {
+
+    public:
+        /**
+         * No tuning at all.
+         */
+        NetTuning()
+            : m_sndbuf(0), m_notsentLowat(0)
+        {}
+
+        /**
+         * Parses a tuning specification.
+         *
+         * @param[in] spec the specification (see above)
+         * @param[in] host the target host name
+         * @exception KError if @p spec cannot be parsed
+         */
+        NetTuning(const std::string &spec, const std::string &host);
+
+        /**
+         * Returns the tuning for @p host from KDUMP_NET_TUNING. If the
+         * option cannot be parsed, a warning is printed and nothing is
+         * tuned.
+         */
+        static NetTuning forHost(const std::string &host);
+
+        /**
+         * Changes the system defaults so that they suit all @p hosts:
+         * the congestion control algorithm of the first host that sets
+         * one, and the largest buffer sizes. Errors are only logged.
+         *
+         * @param[in] hosts the host names of the network targets
+         */
+        static void applySystem(const StringVector &hosts);
+
+        /**
+         * Sets the socket options. This should be done before connect(),
+         * because the window scale is negotiated in the handshake.
+         * Errors are only logged.
+         *
+         * @param[in] fd a TCP socket
+         */
+        void apply(int fd) const;
+
+        bool empty() const
+        { return m_congestion.empty() && !m_sndbuf && !m_notsentLowat; }
+
+        const std::string &congestion() const
+        { return m_congestion; }
+
+        unsigned long sndbuf() const
+        { return m_sndbuf; }
+
+        unsigned long notsentLowat() const
+        { return m_notsentLowat; }
+
+    private:
+        std::string m_congestion;
+        unsigned long m_sndbuf;
+        unsigned long m_notsentLowat;
+};
+
+//}}}
+
+#endif /* NETTUNING_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
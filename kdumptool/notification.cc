@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <string>
+#include <thread>
+#include <exception>
+#include <system_error>
+
+#include "global.h"
+#include "debug.h"
+#include "notification.h"
+
+using std::string;
+
+//{{{ NotificationQueue --------------------------------------------------------
+
+NotificationQueue *NotificationQueue::m_instance = NULL;
+
+// -----------------------------------------------------------------------------
+NotificationQueue *NotificationQueue::queue()
+{
+    static std::once_flag once;
+    std::call_once(once, []() { m_instance = new NotificationQueue(); });
+    return m_instance;
+}
+
+// -----------------------------------------------------------------------------
+NotificationQueue::NotificationQueue()
+    : m_busy(false), m_started(false), m_closed(false)
+{}
+
+// -----------------------------------------------------------------------------
+void NotificationQueue::post(const string &name, const Job &job)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_closed) {
+        KINFO("Not sending %s after the deadline", name.c_str());
+        return;
+    }
+
+    m_jobs.push_back(std::make_pair(name, job));
+    if (!m_started) {
+        try {
+            std::thread(&NotificationQueue::worker, this).detach();
+            m_started = true;
+        } catch (const std::system_error &e) {
+            // no thread, send it here
+            m_jobs.pop_back();
+            KDBG("Cannot start the notification thread: %s", e.what());
+            try {
+                job();
+            } catch (const std::exception &e) {
+                KINFO("Cannot send %s: %s", name.c_str(), e.what());
+            }
+            return;
+        }
+    }
+    m_cond.notify_all();
+}
+
+// -----------------------------------------------------------------------------
+void NotificationQueue::worker()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_cond.wait(lock, [this]{ return !m_jobs.empty(); });
+        std::pair<string, Job> next = m_jobs.front();
+        m_jobs.pop_front();
+        m_busy = true;
+        lock.unlock();
+
+        KDBG("Sending %s", next.first.c_str());
+        try {
+            next.second();
+        } catch (const std::exception &e) {
+            KINFO("Cannot send %s: %s", next.first.c_str(), e.what());
+        }
+
+        lock.lock();
+        m_busy = false;
+        m_cond.notify_all();
+    }
+}
+
+// -----------------------------------------------------------------------------
+bool NotificationQueue::wait(std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_cond.wait_for(lock, timeout,
+                        [this]{ return m_jobs.empty() && !m_busy; }))
+        return true;
+
+    KINFO("Giving up on %zu notification(s) after the deadline",
+          m_jobs.size() + (m_busy ? 1 : 0));
+    m_jobs.clear();
+    m_closed = true;
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+bool NotificationQueue::idle() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_jobs.empty() && !m_busy;
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
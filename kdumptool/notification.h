@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef NOTIFICATION_H
+#define NOTIFICATION_H
+
+#include <string>
+#include <deque>
+#include <utility>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include "global.h"
+
+//{{{ NotificationQueue --------------------------------------------------------
+
+/**
+ * Sends notifications (i.e. emails) in the background, one after the
+ * other, so that a slow or unreachable mail relay cannot hold up the
+ * dump.
+ *
+ * The worker thread is detached and the queue is never destroyed, so a
+ * notification that hangs does not keep the process alive: before the
+ * system reboots, wait() gives the pending notifications a deadline and
+ * drops what is left after it.
+ */
+class NotificationQueue {
+
+    public:
+        typedef std::function<void()> Job;
+
+        /**
+         * Returns the queue of the process.
+         */
+        static NotificationQueue *queue();
+
+        /**
+         * Queues a notification. Returns immediately.
+         *
+         * @param[in] name what is sent (for the log)
+         * @param[in] job sends the notification; an exception is logged
+         *            and otherwise ignored
+         */
+        void post(const std::string &name, const Job &job);
+
+        /**
+         * Waits until all notifications have been sent. If that takes
+         * longer than @p timeout, the queue is closed: the pending
+         * notifications are dropped and new ones are ignored.
+         *
+         * @param[in] timeout the deadline
+         * @return @c true if all notifications have been sent
+         */
+        bool wait(std::chrono::milliseconds timeout);
+
+        /**
+         * Returns @c true if nothing is queued or being sent.
+         */
+        bool idle() const;
+
+    private:
+        NotificationQueue();
+
+        void worker();
+
+        static NotificationQueue *m_instance;
+
+        std::deque<std::pair<std::string, Job> > m_jobs;
+        bool m_busy;
+        bool m_started;
+        bool m_closed;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cond;
+};
+
+//}}}
+
+#endif /* NOTIFICATION_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <sched.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <ifaddrs.h>
+#include <netdb.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <linux/mempolicy.h>
+
+#include "global.h"
+#include "debug.h"
+#include "numa.h"
+#include "stringutil.h"
+
+using std::string;
+using std::vector;
+using std::ifstream;
+
+// devices are stacked (dm on md on partitions) only a few levels deep
+#define NUMA_MAX_DEPTH      8
+
+//{{{ NumaPlacement ------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+NumaPlacement::NumaPlacement(const char *sysdir)
+    : m_sysdir(sysdir)
+{}
+
+// -----------------------------------------------------------------------------
+vector<int> NumaPlacement::parseList(const string &list)
+{
+    vector<int> ret;
+    std::istringstream iss(list);
+    string range;
+
+    while (getline(iss, range, ',')) {
+        range = KString(range).trim();
+        if (range.empty())
+            continue;
+
+        char *end;
+        long first = strtol(range.c_str(), &end, 10);
+        long last = first;
+        if (*end == '-')
+            last = strtol(end + 1, &end, 10);
+        if (*end || first < 0 || last < first || last > INT_MAX)
+            throw KError("Invalid CPU list: " + list);
+        for (long i = first; i <= last; ++i)
+            ret.push_back(i);
+    }
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long NumaPlacement::nodes() const
+{
+    FilePath path(m_sysdir);
+    path.appendPath("devices/system/node/online");
+    ifstream fin(path.c_str());
+    string line;
+    if (!getline(fin, line))
+        return 1;
+    try {
+        return std::max<size_t>(parseList(line).size(), 1);
+    } catch (const KError &error) {
+        Debug::debug()->dbg("%s", error.what());
+        return 1;
+    }
+}
+
+// -----------------------------------------------------------------------------
+int NumaPlacement::sysfsNode(const FilePath &dir, int depth) const
+{
+    if (depth > NUMA_MAX_DEPTH)
+        return -1;
+
+    // the block device itself has no node, its controller has
+    char *real = realpath(dir.c_str(), NULL);
+    if (!real) {
+        Debug::debug()->dbg("Cannot resolve %s: %s", dir.c_str(),
+                            strerror(errno));
+        return -1;
+    }
+    FilePath path(real);
+    free(real);
+
+    FilePath slaves(path);
+    slaves.appendPath("slaves");
+
+    FilePath top = FilePath(m_sysdir).appendPath("devices");
+    for (; path.size() > top.size(); path = path.dirName()) {
+        FilePath attr(path);
+        attr.appendPath("numa_node");
+        ifstream fin(attr.c_str());
+        int node;
+        if (fin >> node) {
+            Debug::debug()->dbg("%s: node %d", attr.c_str(), node);
+            return node;
+        }
+    }
+
+    // device mapper and MD have no parent device, but slaves
+    DIR *dirp = opendir(slaves.c_str());
+    if (!dirp)
+        return -1;
+    int node = -1;
+    struct dirent *d;
+    while (node < 0 && (d = readdir(dirp)) != NULL) {
+        if (d->d_name[0] == '.')
+            continue;
+        FilePath slave(slaves);
+        slave.appendPath(d->d_name);
+        node = sysfsNode(slave, depth + 1);
+    }
+    closedir(dirp);
+    return node;
+}
+
+// -----------------------------------------------------------------------------
+int NumaPlacement::blockDeviceNode(dev_t dev) const
+{
+    FilePath dir(m_sysdir);
+    dir.appendPath("dev/block/" + StringUtil::number2string(major(dev)) +
+                   ":" + StringUtil::number2string(minor(dev)));
+    return sysfsNode(dir, 0);
+}
+
+// -----------------------------------------------------------------------------
+int NumaPlacement::pathNode(const string &path) const
+{
+    FilePath dir(path);
+    struct stat st;
+    while (stat(dir.c_str(), &st) != 0) {
+        if (dir.size() <= 1)
+            return -1;
+        dir = dir.dirName();
+    }
+
+    // a raw target is the device itself; NFS, CIFS and tmpfs have an
+    // anonymous device without a node
+    dev_t dev = S_ISBLK(st.st_mode) ? st.st_rdev : st.st_dev;
+    if (major(dev) == 0)
+        return -1;
+    return blockDeviceNode(dev);
+}
+
+// -----------------------------------------------------------------------------
+int NumaPlacement::interfaceNode(const string &ifname) const
+{
+    FilePath dir(m_sysdir);
+    dir.appendPath("class/net/" + ifname + "/device");
+    return sysfsNode(dir, 0);
+}
+
+// -----------------------------------------------------------------------------
+string NumaPlacement::interfaceOf(const string &addr)
+{
+    struct ifaddrs *ifap;
+    if (getifaddrs(&ifap) != 0) {
+        Debug::debug()->dbg("getifaddrs failed: %s", strerror(errno));
+        return string();
+    }
+
+    string ret;
+    for (struct ifaddrs *ifa = ifap; ifa && ret.empty(); ifa = ifa->ifa_next) {
+        if (!ifa->ifa_addr || (ifa->ifa_addr->sa_family != AF_INET &&
+                               ifa->ifa_addr->sa_family != AF_INET6))
+            continue;
+        char host[NI_MAXHOST];
+        socklen_t len = ifa->ifa_addr->sa_family == AF_INET
+            ? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6);
+        if (getnameinfo(ifa->ifa_addr, len, host, sizeof host, NULL, 0,
+                        NI_NUMERICHOST) != 0)
+            continue;
+        // IPv6 link-local addresses carry the zone ("fe80::1%eth0")
+        string name(host);
+        string::size_type zone = name.find('%');
+        if (zone != string::npos)
+            name.erase(zone);
+        if (name == addr)
+            ret = ifa->ifa_name;
+    }
+    freeifaddrs(ifap);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+vector<int> NumaPlacement::nodeCPUs(int node) const
+{
+    FilePath path(m_sysdir);
+    path.appendPath("devices/system/node/node" +
+                    StringUtil::number2string(node) + "/cpulist");
+    ifstream fin(path.c_str());
+    string line;
+    if (!getline(fin, line))
+        throw KSystemError("Cannot read " + path, errno);
+    return parseList(line);
+}
+
+// -----------------------------------------------------------------------------
+void NumaPlacement::bind(const vector<int> &cpus, int node)
+{
+    if (!cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (size_t i = 0; i < cpus.size(); ++i)
+            if (cpus[i] < CPU_SETSIZE)
+                CPU_SET(cpus[i], &set);
+        if (sched_setaffinity(0, sizeof set, &set) != 0)
+            throw KSystemError("Cannot set the CPU affinity", errno);
+    }
+
+    // MPOL_PREFERRED falls back to other nodes when the node is full,
+    // which matters with the small memory of the kdump kernel
+    if (node < 0 || node >= (int)(sizeof(unsigned long) * 8))
+        return;
+    unsigned long mask = 1UL << node;
+    if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, &mask,
+                sizeof(mask) * 8) != 0)
+        throw KSystemError("Cannot set the memory policy", errno);
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
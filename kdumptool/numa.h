@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+#include "global.h"
+#include "fileutil.h"
+
+//{{{ NumaPlacement ------------------------------------------------------------
+
+/**
+ * Finds the NUMA node of a dump target and binds kdumptool to it.
+ *
+ * The node of a block device is read from the "numa_node" attribute of
+ * the first ancestor in sysfs that has one (usually the PCI function of
+ * the HBA); device mapper and MD devices are followed to their first
+ * slave. The node of a network target is that of the interface which
+ * owns the source address of the route to the host.
+ *
+ * bind() restricts the calling thread to the CPUs of the node and
+ * prefers the memory of the node. Threads and processes started later
+ * inherit both, so it must be called before the dump threads and
+ * makedumpfile are started.
+ */
+class NumaPlacement {
+
+    public:
+        /**
+         * Creates a new NumaPlacement object.
+         *
+         * @param[in] sysdir mount point for sysfs
+         */
+        NumaPlacement(const char *sysdir = "/sys");
+
+        /**
+         * Parses a CPU list like "0-3,8".
+         *
+         * @exception KError if the list is malformed
+         */
+        static std::vector<int> parseList(const std::string &list);
+
+        /**
+         * Returns the number of online NUMA nodes, 1 if the system has no
+         * NUMA support.
+         */
+        unsigned long nodes() const;
+
+        /**
+         * Returns the node of a block device, -1 if it is not known.
+         */
+        int blockDeviceNode(dev_t dev) const;
+
+        /**
+         * Returns the node of the block device that holds @p path (or its
+         * nearest existing parent), -1 if not known or not a block device.
+         */
+        int pathNode(const std::string &path) const;
+
+        /**
+         * Returns the node of a network interface, -1 if not known.
+         */
+        int interfaceNode(const std::string &ifname) const;
+
+        /**
+         * Returns the name of the interface that has the address @p addr,
+         * or an empty string.
+         */
+        static std::string interfaceOf(const std::string &addr);
+
+        /**
+         * Returns the online CPUs of a node.
+         *
+         * @exception KError if the node does not exist
+         */
+        std::vector<int> nodeCPUs(int node) const;
+
+        /**
+         * Binds the calling thread to @p cpus (unless it is empty) and
+         * prefers the memory of @p node.
+         *
+         * @exception KSystemError if the kernel refuses
+         */
+        static void bind(const std::vector<int> &cpus, int node);
+
+    protected:
+        /**
+         * Reads the "numa_node" attribute above a sysfs directory.
+         */
+        int sysfsNode(const FilePath &dir, int depth) const;
+
+    private:
+        const FilePath m_sysdir;
+};
+
+//}}}
+
+#endif /* NUMA_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
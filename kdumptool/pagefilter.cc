@@ -0,0 +1,701 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <elf.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "global.h"
+#include "debug.h"
+#include "stringutil.h"
+#include "vmcoreinfo.h"
+#include "util.h"
+#include "pagefilter.h"
+
+using std::string;
+using std::min;
+
+// pages that a thread classifies at a time; a multiple of 64 (one word
+// of the bitmap) and of the largest free block, so that neither is
+// shared between two threads
+#define FILTER_CHUNK_PAGES      32768ULL
+
+// page descriptors that are read at a time
+#define FILTER_DESC_BATCH       512
+
+// larger orders in page.private are garbage
+#define FILTER_MAX_ORDER        20
+
+// number of pages read at once to find the zero pages
+#define FILTER_ZERO_BATCH       64
+
+// low bits of section_mem_map; the kernel keeps up to 6 flags there
+#define SECTION_HAS_MEM_MAP     (1ULL << 1)
+#define SECTION_MAP_MASK        (~((1ULL << 6) - 1))
+
+// bit 0 of page.mapping marks anonymous memory
+#define PAGE_MAPPING_ANON       1ULL
+
+// x86_64 page tables
+#define X86_START_KERNEL_MAP    0xffffffff80000000ULL
+#define X86_PTE_PRESENT         (1ULL << 0)
+#define X86_PTE_PSE             (1ULL << 7)
+#define X86_PTE_PFN_MASK        0x000ffffffffff000ULL
+#define X86_SECTION_SIZE_BITS   27
+#define X86_MAX_PHYSMEM_BITS    46
+#define X86_MAX_PHYSMEM_BITS_L5 52
+
+//{{{ Helpers ------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+static void readAt(int fd, void *buffer, size_t size, off_t offset,
+                   const string &file)
+{
+    char *p = static_cast<char *>(buffer);
+
+    while (size) {
+        ssize_t ret = pread(fd, p, size, offset);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret < 0)
+            throw KSystemError("Cannot read " + file + " at " +
+                               StringUtil::number2hex(offset), errno);
+        if (ret == 0)
+            throw KError("Unexpected end of " + file + ".");
+        p += ret;
+        offset += ret;
+        size -= ret;
+    }
+}
+
+// -----------------------------------------------------------------------------
+static bool hasKey(const Vmcoreinfo &info, const char *key)
+{
+    try {
+        info.getStringValue(key);
+        return true;
+    } catch (const KError &) {
+        return false;
+    }
+}
+
+// -----------------------------------------------------------------------------
+static long long infoNumber(const Vmcoreinfo &info, const char *key)
+{
+    string value = info.getStringValue(key);
+    char *end;
+    errno = 0;
+    long long ret = strtoll(value.c_str(), &end, 10);
+    if (end == value.c_str() || *end || errno)
+        throw KError("Invalid VMCOREINFO value " + string(key) + "=" +
+                     value + ".");
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+static long long infoNumber(const Vmcoreinfo &info, const char *key,
+                            long long dflt)
+{
+    return hasKey(info, key) ? infoNumber(info, key) : dflt;
+}
+
+// -----------------------------------------------------------------------------
+static unsigned long long infoAddress(const Vmcoreinfo &info, const char *key)
+{
+    string value = info.getStringValue(key);
+    char *end;
+    errno = 0;
+    unsigned long long ret = strtoull(value.c_str(), &end, 16);
+    if (end == value.c_str() || *end || errno)
+        throw KError("Invalid VMCOREINFO value " + string(key) + "=" +
+                     value + ".");
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+static uint64_t infoFlag(const Vmcoreinfo &info, const char *key,
+                         bool required = true)
+{
+    if (!required && !hasKey(info, key))
+        return 0;
+    long long bit = infoNumber(info, key);
+    if (bit < 0 || bit > 63)
+        throw KError("Invalid page flag " + string(key) + ".");
+    return 1ULL << bit;
+}
+
+//}}}
+//{{{ PageFilter::Reader -------------------------------------------------------
+
+/**
+ * Reads kernel memory from the dump. Each thread has its own reader,
+ * which remembers the last mapping found in the page tables.
+ */
+class PageFilter::Reader {
+
+    public:
+        Reader(const PageFilter &filter)
+            : m_filter(filter), m_vstart(0), m_vend(0), m_pstart(0)
+        { }
+
+        void readVirtual(unsigned long long vaddr, char *buffer, size_t len);
+        void readPhysical(unsigned long long paddr, char *buffer, size_t len);
+
+    private:
+        unsigned long long walk(unsigned long long vaddr,
+                                unsigned long long *size);
+
+        const PageFilter &m_filter;
+        unsigned long long m_vstart, m_vend, m_pstart;
+};
+
+// -----------------------------------------------------------------------------
+void PageFilter::Reader::readPhysical(unsigned long long paddr, char *buffer,
+                                      size_t len)
+{
+    while (len) {
+        const VmcoreContext::Segment *seg = m_filter.segmentByPaddr(paddr);
+        if (!seg)
+            throw KError("Physical address " + StringUtil::number2hex(paddr) +
+                         " is not in the dump.");
+        unsigned long long delta = paddr - seg->paddr;
+        size_t n = min<unsigned long long>(len, seg->filesz - delta);
+        readAt(m_filter.m_fd, buffer, n, seg->offset + delta,
+               m_filter.m_ctx->path());
+        paddr += n;
+        buffer += n;
+        len -= n;
+    }
+}
+
+// -----------------------------------------------------------------------------
+void PageFilter::Reader::readVirtual(unsigned long long vaddr, char *buffer,
+                                     size_t len)
+{
+    while (len) {
+        size_t n;
+        const VmcoreContext::Segment *seg = m_filter.segmentByVaddr(vaddr);
+        if (seg) {
+            unsigned long long delta = vaddr - seg->vaddr;
+            n = min<unsigned long long>(len, seg->filesz - delta);
+            readAt(m_filter.m_fd, buffer, n, seg->offset + delta,
+                   m_filter.m_ctx->path());
+        } else {
+            if (vaddr < m_vstart || vaddr >= m_vend) {
+                unsigned long long size;
+                m_pstart = walk(vaddr, &size);
+                m_vstart = vaddr;
+                m_vend = vaddr + size;
+            }
+            n = min<unsigned long long>(len, m_vend - vaddr);
+            readPhysical(m_pstart + (vaddr - m_vstart), buffer, n);
+        }
+        vaddr += n;
+        buffer += n;
+        len -= n;
+    }
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long PageFilter::Reader::walk(unsigned long long vaddr,
+                                            unsigned long long *size)
+{
+    if (!m_filter.m_pgtable)
+        throw KError("Cannot translate " + StringUtil::number2hex(vaddr) +
+                     " without the kernel page tables.");
+
+    unsigned long long table = m_filter.m_pgtable;
+    unsigned shift = m_filter.m_levels == 5 ? 48 : 39;
+    while (true) {
+        uint64_t entry;
+        readPhysical(table + ((vaddr >> shift) & 511) * sizeof entry,
+                     reinterpret_cast<char *>(&entry), sizeof entry);
+        entry &= ~m_filter.m_smeMask;
+        if (!(entry & X86_PTE_PRESENT))
+            throw KError("Address " + StringUtil::number2hex(vaddr) +
+                         " is not mapped.");
+
+        unsigned long long addr = entry & X86_PTE_PFN_MASK;
+        if (shift == 12 || ((shift == 21 || shift == 30) &&
+                            (entry & X86_PTE_PSE))) {
+            unsigned long long mask = (1ULL << shift) - 1;
+            *size = mask + 1 - (vaddr & mask);
+            return (addr & ~mask) | (vaddr & mask);
+        }
+        table = addr;
+        shift -= 9;
+    }
+}
+
+//}}}
+//{{{ PageFilter ---------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+PageFilter::PageFilter(const string &dump, int dumplevel)
+    : m_ctx(VmcoreContext::get(dump)), m_fd(dump, O_RDONLY | O_CLOEXEC),
+      m_dumpLevel(dumplevel), m_pageSize(0), m_pageShift(0),
+      m_pgtable(0), m_levels(4), m_smeMask(0), m_sectionShift(0)
+{
+    Debug::debug()->trace("PageFilter::PageFilter(%s, %d)",
+                          dump.c_str(), dumplevel);
+
+    if (m_ctx->pointerSize() != 8)
+        throw KError("Only 64-bit dumps can be filtered.");
+    const Vmcoreinfo &info = m_ctx->vmcoreinfo();
+
+    m_pageSize = infoNumber(info, "PAGESIZE");
+    if (!m_pageSize || (m_pageSize & (m_pageSize - 1)))
+        throw KError("Invalid page size " +
+                     StringUtil::number2string(m_pageSize) + ".");
+    while ((1UL << m_pageShift) < m_pageSize)
+        ++m_pageShift;
+    m_layout = pageLayout(info, dumplevel);
+
+    Elf64_Ehdr ehdr;
+    readAt(m_fd, &ehdr, sizeof ehdr, 0, dump);
+    if (ehdr.e_machine == EM_X86_64) {
+        unsigned long long pgd = 0;
+        static const char *const roots[] = {
+            "SYMBOL(init_top_pgt)",         // since 4.13
+            "SYMBOL(init_level4_pgt)",
+            "SYMBOL(swapper_pg_dir)",
+        };
+        for (size_t i = 0; !pgd && i < sizeof roots / sizeof roots[0]; ++i)
+            if (hasKey(info, roots[i]))
+                pgd = infoAddress(info, roots[i]);
+
+        const VmcoreContext::Segment *seg = segmentByVaddr(pgd);
+        if (seg)
+            m_pgtable = seg->paddr + (pgd - seg->vaddr);
+        else if (pgd && hasKey(info, "NUMBER(phys_base)"))
+            m_pgtable = pgd - X86_START_KERNEL_MAP +
+                infoNumber(info, "NUMBER(phys_base)");
+
+        if (infoNumber(info, "NUMBER(pgtable_l5_enabled)", 0))
+            m_levels = 5;
+        m_smeMask = infoNumber(info, "NUMBER(sme_mask)", 0);
+    }
+
+    readSections(ehdr.e_machine == EM_X86_64);
+
+    const std::vector<VmcoreContext::Segment> &segs = m_ctx->segments();
+    m_excluded.resize(segs.size());
+    m_basePfn.resize(segs.size());
+    for (size_t i = 0; i < segs.size(); ++i) {
+        unsigned long long start = segs[i].paddr >> m_pageShift;
+        unsigned long long end = (segs[i].paddr + segs[i].filesz +
+                                  m_pageSize - 1) >> m_pageShift;
+        m_basePfn[i] = start & ~63ULL;
+        m_excluded[i].assign((end - m_basePfn[i] + 63) / 64, 0);
+    }
+}
+
+// -----------------------------------------------------------------------------
+PageFilter::PageLayout PageFilter::pageLayout(const Vmcoreinfo &info,
+                                              int dumplevel)
+{
+    PageLayout ret = PageLayout();
+    ret.size = infoNumber(info, "SIZE(page)");
+
+    if (dumplevel & (DL_CACHE | DL_CACHE_PRIVATE | DL_USER)) {
+        ret.flags = infoNumber(info, "OFFSET(page.flags)");
+        ret.mapping = infoNumber(info, "OFFSET(page.mapping)");
+        ret.lru = infoFlag(info, "NUMBER(PG_lru)");
+        ret.priv_flag = infoFlag(info, "NUMBER(PG_private)");
+        ret.swapcache = infoFlag(info, "NUMBER(PG_swapcache)");
+        // PG_swapbacked since 4.10, PG_slab until 6.9
+        ret.swapbacked = infoFlag(info, "NUMBER(PG_swapbacked)", false);
+        ret.slab = infoFlag(info, "NUMBER(PG_slab)", false);
+        if (ret.flags + 8 > ret.size || ret.mapping + 8 > ret.size)
+            throw KError("Invalid layout of struct page.");
+    }
+
+    if (dumplevel & DL_FREE) {
+        ret.priv = infoNumber(info, "OFFSET(page.private)");
+        ret.mapcount = infoNumber(info, "OFFSET(page._mapcount)");
+        ret.buddy_value = infoNumber(info, "NUMBER(PAGE_BUDDY_MAPCOUNT_VALUE)");
+        ret.buddy = true;
+        if (ret.priv + 8 > ret.size || ret.mapcount + 4 > ret.size)
+            throw KError("Invalid layout of struct page.");
+    }
+
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+bool PageFilter::isBuddy(uint32_t mapcount, uint32_t value)
+{
+    // one cleared bit below PAGE_TYPE_BASE, which always has the top
+    // bit set; -1 is an unmapped page
+    uint32_t bit = ~value;
+    if (bit && !(bit & (bit - 1)))
+        return (mapcount & 0x80000000U) && !(mapcount & bit);
+
+    // the type in the top byte
+    if (!(value & 0xffffffU))
+        return (mapcount >> 24) == (value >> 24);
+
+    return mapcount == value;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long PageFilter::classify(const char *desc, const PageLayout &layout,
+                                   int dumplevel)
+{
+    if ((dumplevel & DL_FREE) && layout.buddy) {
+        uint32_t mapcount;
+        memcpy(&mapcount, desc + layout.mapcount, sizeof mapcount);
+        if (isBuddy(mapcount, layout.buddy_value)) {
+            uint64_t order;
+            memcpy(&order, desc + layout.priv, sizeof order);
+            return order <= FILTER_MAX_ORDER ? 1UL << order : 1;
+        }
+    }
+
+    if (!(dumplevel & (DL_CACHE | DL_CACHE_PRIVATE | DL_USER)))
+        return 0;
+
+    uint64_t flags, mapping;
+    memcpy(&flags, desc + layout.flags, sizeof flags);
+    memcpy(&mapping, desc + layout.mapping, sizeof mapping);
+    if (flags & layout.slab)
+        return 0;
+
+    if (mapping & PAGE_MAPPING_ANON)
+        return (dumplevel & DL_USER) ? 1 : 0;
+
+    // PG_swapcache is only valid together with PG_swapbacked
+    bool cache = (flags & layout.lru) ||
+        ((flags & layout.swapcache) &&
+         (!layout.swapbacked || (flags & layout.swapbacked)));
+    if (!cache)
+        return 0;
+    if (dumplevel & DL_CACHE_PRIVATE)
+        return 1;
+    if ((dumplevel & DL_CACHE) && !(flags & layout.priv_flag))
+        return 1;
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+void PageFilter::readSections(bool x86)
+{
+    const Vmcoreinfo &info = m_ctx->vmcoreinfo();
+    if (!hasKey(info, "SYMBOL(mem_section)"))
+        throw KError("Only SPARSEMEM kernels can be filtered.");
+
+    unsigned long long addr = infoAddress(info, "SYMBOL(mem_section)");
+    unsigned long long length = infoNumber(info, "LENGTH(mem_section)");
+    unsigned long size = infoNumber(info, "SIZE(mem_section)");
+    unsigned long offset = infoNumber(info,
+                                      "OFFSET(mem_section.section_mem_map)");
+
+    // both numbers are in VMCOREINFO since 5.11
+    long long sectionBits = x86 ? X86_SECTION_SIZE_BITS : -1;
+    long long physBits = x86 ? (m_levels == 5 ? X86_MAX_PHYSMEM_BITS_L5 :
+                                X86_MAX_PHYSMEM_BITS) : -1;
+    sectionBits = infoNumber(info, "NUMBER(SECTION_SIZE_BITS)", sectionBits);
+    physBits = infoNumber(info, "NUMBER(MAX_PHYSMEM_BITS)", physBits);
+    if (sectionBits <= m_pageShift || physBits <= sectionBits ||
+        physBits > 64 || size < offset + 8)
+        throw KError("Unknown memory model of the crashed kernel.");
+    m_sectionShift = sectionBits - m_pageShift;
+
+    // SPARSEMEM_EXTREME has a page of sections per root
+    unsigned long long sections = 1ULL << (physBits - sectionBits);
+    unsigned long long perRoot;
+    if (length == sections)
+        perRoot = 1;
+    else if (length * (m_pageSize / size) == sections)
+        perRoot = m_pageSize / size;
+    else
+        throw KError("Unknown layout of mem_section.");
+
+    // only the sections of the memory in the dump
+    unsigned long long maxPfn = 0;
+    const std::vector<VmcoreContext::Segment> &segs = m_ctx->segments();
+    std::vector<VmcoreContext::Segment>::const_iterator it;
+    for (it = segs.begin(); it != segs.end(); ++it)
+        maxPfn = std::max(maxPfn, (it->paddr + it->filesz) >> m_pageShift);
+    sections = min(sections, (maxPfn >> m_sectionShift) + 1);
+    m_memMap.assign(sections, 0);
+
+    Reader reader(*this);
+    std::vector<char> buf(perRoot * size);
+    for (unsigned long long root = 0; root * perRoot < sections; ++root) {
+        unsigned long long base = addr + root * size;
+        if (perRoot > 1) {
+            uint64_t ptr;
+            reader.readVirtual(addr + root * sizeof ptr,
+                               reinterpret_cast<char *>(&ptr), sizeof ptr);
+            if (!ptr)
+                continue;
+            base = ptr;
+        }
+
+        unsigned long long n = min(perRoot, sections - root * perRoot);
+        reader.readVirtual(base, buf.data(), n * size);
+        for (unsigned long long i = 0; i < n; ++i) {
+            uint64_t coded;
+            memcpy(&coded, &buf[i * size + offset], sizeof coded);
+            if (coded & SECTION_HAS_MEM_MAP)
+                m_memMap[root * perRoot + i] = coded & SECTION_MAP_MASK;
+        }
+    }
+
+    Debug::debug()->dbg("%llu memory sections, %llu per root",
+                        sections, perRoot);
+}
+
+// -----------------------------------------------------------------------------
+void PageFilter::readVirtual(unsigned long long vaddr, char *buffer,
+                             size_t len) const
+{
+    Reader reader(*this);
+    reader.readVirtual(vaddr, buffer, len);
+}
+
+// -----------------------------------------------------------------------------
+const VmcoreContext::Segment *PageFilter::segmentByVaddr(
+    unsigned long long vaddr) const
+{
+    const std::vector<VmcoreContext::Segment> &segs = m_ctx->segments();
+    std::vector<VmcoreContext::Segment>::const_iterator it;
+    for (it = segs.begin(); it != segs.end(); ++it)
+        if (vaddr >= it->vaddr && vaddr - it->vaddr < it->filesz)
+            return &*it;
+    return NULL;
+}
+
+// -----------------------------------------------------------------------------
+const VmcoreContext::Segment *PageFilter::segmentByPaddr(
+    unsigned long long paddr) const
+{
+    const std::vector<VmcoreContext::Segment> &segs = m_ctx->segments();
+    std::vector<VmcoreContext::Segment>::const_iterator it;
+    for (it = segs.begin(); it != segs.end(); ++it)
+        if (paddr >= it->paddr && paddr - it->paddr < it->filesz)
+            return &*it;
+    return NULL;
+}
+
+// -----------------------------------------------------------------------------
+void PageFilter::run(unsigned threads, bool zeroPages)
+{
+    Debug::debug()->trace("PageFilter::run(%u, %d)", threads, zeroPages);
+
+    bool descriptors = m_dumpLevel & ~DL_ZERO;
+    bool zeros = zeroPages && (m_dumpLevel & DL_ZERO);
+
+    // chunks start at multiples of FILTER_CHUNK_PAGES; a segment that
+    // is not page aligned is kept
+    struct Chunk {
+        size_t seg;
+        unsigned long long start, end;
+    };
+    std::vector<Chunk> chunks;
+    const std::vector<VmcoreContext::Segment> &segs = m_ctx->segments();
+    for (size_t i = 0; i < segs.size(); ++i) {
+        if ((segs[i].paddr | segs[i].filesz) & (m_pageSize - 1))
+            continue;
+        unsigned long long pfn = segs[i].paddr >> m_pageShift;
+        unsigned long long end = pfn + (segs[i].filesz >> m_pageShift);
+        while (pfn < end) {
+            Chunk chunk;
+            chunk.seg = i;
+            chunk.start = pfn;
+            chunk.end = min(end, (pfn / FILTER_CHUNK_PAGES + 1) *
+                            FILTER_CHUNK_PAGES);
+            chunks.push_back(chunk);
+            pfn = chunk.end;
+        }
+    }
+
+    std::atomic<size_t> next(0);
+    std::exception_ptr error;
+    std::mutex mutex;
+    auto worker = [&]() {
+        Reader reader(*this);
+        size_t i;
+        while ((i = next++) < chunks.size()) {
+            try {
+                if (descriptors)
+                    classifyRange(reader, chunks[i].seg, chunks[i].start,
+                                  chunks[i].end);
+                if (zeros)
+                    excludeZeros(chunks[i].seg, chunks[i].start,
+                                 chunks[i].end);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error)
+                    error = std::current_exception();
+                next = chunks.size();
+            }
+        }
+    };
+
+    threads = std::max(1U, min<unsigned>(threads, chunks.size()));
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; ++i)
+        pool.emplace_back(worker);
+    worker();
+    for (std::vector<std::thread>::iterator it = pool.begin();
+         it != pool.end(); ++it)
+        it->join();
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+// -----------------------------------------------------------------------------
+void PageFilter::classifyRange(Reader &reader, size_t seg,
+                               unsigned long long start,
+                               unsigned long long end)
+{
+    const size_t size = m_layout.size;
+    std::vector<char> buf(FILTER_DESC_BATCH * size);
+
+    unsigned long long pfn = start;
+    while (pfn < end) {
+        unsigned long long section = pfn >> m_sectionShift;
+        unsigned long long n = min<unsigned long long>(
+            min(end, (section + 1) << m_sectionShift) - pfn,
+            FILTER_DESC_BATCH);
+
+        // memory without page descriptors is kept
+        if (section >= m_memMap.size() || !m_memMap[section]) {
+            pfn += n;
+            continue;
+        }
+
+        reader.readVirtual(m_memMap[section] + pfn * size, buf.data(),
+                           n * size);
+        unsigned long long i = 0;
+        while (i < n) {
+            unsigned long long count = classify(&buf[i * size], m_layout,
+                                                m_dumpLevel);
+            if (!count) {
+                ++i;
+                continue;
+            }
+            count = min(count, end - (pfn + i));
+            exclude(seg, pfn + i, count);
+            i += count;
+        }
+        pfn += i;
+    }
+}
+
+// -----------------------------------------------------------------------------
+void PageFilter::excludeZeros(size_t seg, unsigned long long start,
+                              unsigned long long end)
+{
+    const VmcoreContext::Segment &s = m_ctx->segments()[seg];
+    const unsigned long long first = s.paddr >> m_pageShift;
+    std::vector<char> buf(FILTER_ZERO_BATCH * m_pageSize);
+
+    unsigned long long pfn = start;
+    while (pfn < end) {
+        // pages excluded by their descriptor need not be read
+        if (isExcluded(seg, pfn)) {
+            ++pfn;
+            continue;
+        }
+        unsigned long long n = 1;
+        while (n < FILTER_ZERO_BATCH && pfn + n < end &&
+               !isExcluded(seg, pfn + n))
+            ++n;
+
+        readAt(m_fd, buf.data(), n * m_pageSize,
+               s.offset + ((pfn - first) << m_pageShift), m_ctx->path());
+        for (unsigned long long i = 0; i < n; ++i)
+            if (Util::isZero(&buf[i * m_pageSize], m_pageSize))
+                exclude(seg, pfn + i, 1);
+        pfn += n;
+    }
+}
+
+// -----------------------------------------------------------------------------
+void PageFilter::exclude(size_t seg, unsigned long long pfn,
+                         unsigned long long count)
+{
+    std::vector<uint64_t> &bits = m_excluded[seg];
+    for (unsigned long long i = pfn - m_basePfn[seg];
+         i < pfn - m_basePfn[seg] + count; ++i)
+        bits[i / 64] |= 1ULL << (i % 64);
+}
+
+// -----------------------------------------------------------------------------
+bool PageFilter::isExcluded(size_t seg, unsigned long long pfn) const
+{
+    unsigned long long i = pfn - m_basePfn[seg];
+    return m_excluded[seg][i / 64] & (1ULL << (i % 64));
+}
+
+// -----------------------------------------------------------------------------
+std::vector<PageFilter::Run> PageFilter::keptRuns(size_t seg) const
+{
+    const VmcoreContext::Segment &s = m_ctx->segments().at(seg);
+    unsigned long long first = s.paddr >> m_pageShift;
+    unsigned long long pages = (s.filesz + m_pageSize - 1) >> m_pageShift;
+
+    std::vector<Run> ret;
+    Run run = Run();
+    if ((s.paddr | s.filesz) & (m_pageSize - 1)) {
+        run.count = pages;
+        ret.push_back(run);
+        return ret;
+    }
+
+    for (unsigned long long i = 0; i < pages; ++i) {
+        if (isExcluded(seg, first + i)) {
+            if (run.count)
+                ret.push_back(run);
+            run.count = 0;
+        } else if (run.count++ == 0)
+            run.first = i;
+    }
+    if (run.count)
+        ret.push_back(run);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long PageFilter::excludedPages() const
+{
+    unsigned long long ret = 0;
+    for (size_t i = 0; i < m_excluded.size(); ++i)
+        for (size_t j = 0; j < m_excluded[i].size(); ++j)
+            ret += __builtin_popcountll(m_excluded[i][j]);
+    return ret;
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
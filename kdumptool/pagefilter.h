@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#ifndef PAGEFILTER_H
+#define PAGEFILTER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+
+#include "global.h"
+#include "fileutil.h"
+#include "vmcorecontext.h"
+
+//{{{ PageFilter ---------------------------------------------------------------
+
+/**
+ * Finds the pages of an ELF dump that a dump level excludes, from the
+ * page descriptors (struct page) of the crashed kernel, like makedumpfile.
+ *
+ * The descriptors are found through mem_section of a SPARSEMEM kernel
+ * and read through the PT_LOAD segments. The virtual memory map of
+ * SPARSEMEM_VMEMMAP is not in the segments; it is translated with the
+ * kernel page tables, which is implemented for x86_64 only. A page is
+ * excluded only if its descriptor clearly says so; a page of an unknown
+ * type is kept.
+ *
+ * Pages filled with zeros (dump level 1) can only be found by reading
+ * the memory itself. Like makedumpfile for ELF dumps, run() reads the
+ * pages that are still kept once more for that, unless the writer finds
+ * them while it copies the pages (diskdump).
+ */
+class PageFilter {
+
+    public:
+        /**
+         * Dump level bits.
+         */
+        enum {
+            DL_ZERO          = 1,
+            DL_CACHE         = 2,
+            DL_CACHE_PRIVATE = 4,
+            DL_USER          = 8,
+            DL_FREE          = 16
+        };
+
+        /**
+         * The layout of struct page and the flag bits, from VMCOREINFO.
+         */
+        struct PageLayout {
+            unsigned long size;             // SIZE(page)
+            unsigned long flags;            // OFFSET(page.flags)
+            unsigned long mapping;          // OFFSET(page.mapping)
+            unsigned long priv;             // OFFSET(page.private)
+            unsigned long mapcount;         // OFFSET(page._mapcount)
+            uint64_t lru;                   // 1 << PG_lru
+            uint64_t priv_flag;             // 1 << PG_private
+            uint64_t swapcache;             // 1 << PG_swapcache
+            uint64_t swapbacked;            // 1 << PG_swapbacked, or 0
+            uint64_t slab;                  // 1 << PG_slab, or 0
+            bool buddy;                     // buddy_value is known
+            uint32_t buddy_value;           // PAGE_BUDDY_MAPCOUNT_VALUE
+        };
+
+        /**
+         * Pages that are kept, relative to the start of a segment.
+         */
+        struct Run {
+            unsigned long long first;
+            unsigned long long count;
+        };
+
+        /**
+         * Reads the VMCOREINFO of @p dump and checks that its pages can
+         * be filtered for @p dumplevel.
+         *
+         * @param[in] dump the dump file, e.g. /proc/vmcore
+         * @param[in] dumplevel makedumpfile dump level (0 to 31)
+         * @exception KError if the dump cannot be filtered
+         */
+        PageFilter(const std::string &dump, int dumplevel);
+
+        /**
+         * Reads the page descriptors and classifies the pages. Each
+         * thread takes the next range of a PT_LOAD segment.
+         *
+         * @param[in] threads number of threads
+         * @param[in] zeroPages also read the kept pages and exclude
+         *            those filled with zeros if the dump level has
+         *            DL_ZERO
+         * @exception KError if the page descriptors or the pages cannot
+         *            be read
+         */
+        void run(unsigned threads, bool zeroPages = true);
+
+        /**
+         * Returns the parsed headers of the dump.
+         */
+        const VmcoreContext &context() const
+        { return *m_ctx; }
+
+        /**
+         * Returns the page size of the crashed system.
+         */
+        unsigned long pageSize() const
+        { return m_pageSize; }
+
+        /**
+         * Returns the dump level.
+         */
+        int dumpLevel() const
+        { return m_dumpLevel; }
+
+        /**
+         * Reads memory of the crashed kernel at a virtual address.
+         *
+         * @param[in] vaddr the address
+         * @param[out] buffer at least @p len bytes
+         * @param[in] len the number of bytes
+         * @exception KError if the memory is not in the dump
+         */
+        void readVirtual(unsigned long long vaddr, char *buffer,
+                         size_t len) const;
+
+        /**
+         * Returns the pages of segment @p seg that are kept, in order.
+         *
+         * @param[in] seg index into VmcoreContext::segments()
+         */
+        std::vector<Run> keptRuns(size_t seg) const;
+
+        /**
+         * Returns the number of pages that are excluded.
+         */
+        unsigned long long excludedPages() const;
+
+        /**
+         * Reads the layout of struct page from @p info.
+         *
+         * @param[in] info the VMCOREINFO
+         * @param[in] dumplevel only the keys needed by this level are
+         *            required
+         * @exception KError if a needed key is missing
+         */
+        static PageLayout pageLayout(const Vmcoreinfo &info, int dumplevel);
+
+        /**
+         * Classifies one page descriptor.
+         *
+         * @param[in] desc the page descriptor
+         * @param[in] layout the layout of @p desc
+         * @param[in] dumplevel makedumpfile dump level
+         * @return the number of pages from this one that are excluded
+         *         (2^order for a free block), or 0 to keep the page
+         */
+        static unsigned long classify(const char *desc,
+                                      const PageLayout &layout,
+                                      int dumplevel);
+
+        /**
+         * Checks whether _mapcount (or page_type) marks a free page.
+         *
+         * PAGE_BUDDY_MAPCOUNT_VALUE is -128 for old kernels, ~PG_buddy
+         * for page types with a cleared bit (4.18 to 6.10) and the type
+         * in the top byte since 6.11.
+         *
+         * @param[in] mapcount the value of _mapcount
+         * @param[in] value PAGE_BUDDY_MAPCOUNT_VALUE
+         */
+        static bool isBuddy(uint32_t mapcount, uint32_t value);
+
+    private:
+        class Reader;
+
+        void readSections(bool x86);
+        void classifyRange(Reader &reader, size_t seg,
+                           unsigned long long start, unsigned long long end);
+        void excludeZeros(size_t seg, unsigned long long start,
+                          unsigned long long end);
+        void exclude(size_t seg, unsigned long long pfn,
+                     unsigned long long count);
+        bool isExcluded(size_t seg, unsigned long long pfn) const;
+
+        const VmcoreContext::Segment *segmentByVaddr(
+            unsigned long long vaddr) const;
+        const VmcoreContext::Segment *segmentByPaddr(
+            unsigned long long paddr) const;
+
+        std::shared_ptr<const VmcoreContext> m_ctx;
+        FileDescriptor m_fd;
+        int m_dumpLevel;
+        unsigned long m_pageSize;
+        unsigned m_pageShift;
+        PageLayout m_layout;
+
+        // kernel page tables (x86_64)
+        unsigned long long m_pgtable;
+        unsigned m_levels;
+        uint64_t m_smeMask;
+
+        // decoded section_mem_map of each section, 0 if there is none
+        unsigned m_sectionShift;        // pfn to section number
+        std::vector<unsigned long long> m_memMap;
+
+        // excluded pages of each segment, one bit per page; the words
+        // start at a pfn that is a multiple of 64
+        std::vector<std::vector<uint64_t> > m_excluded;
+        std::vector<unsigned long long> m_basePfn;
+};
+
+//}}}
+
+#endif /* PAGEFILTER_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "global.h"
+#include "debug.h"
+#include "pageindex.h"
+
+using std::string;
+
+static const char INDEX_HEADER[] = "KDUMP-INDEX 1";
+
+static const struct {
+    unsigned bit;
+    const char *name;
+} state_names[] = {
+    { PageIndex::STATE_RAW,  "raw" },
+    { PageIndex::STATE_ZLIB, "zlib" },
+    { PageIndex::STATE_ZSTD, "zstd" },
+    { PageIndex::STATE_ZERO, "zero" }
+};
+
+#define STATE_COUNT     (sizeof state_names / sizeof state_names[0])
+
+//{{{ PageIndex ----------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+PageIndex::PageIndex(unsigned long long interval)
+    : m_interval(interval ? interval : 1), m_pageSize(0), m_descOffset(0)
+{}
+
+// -----------------------------------------------------------------------------
+void PageIndex::reset(unsigned long pagesize, off_t descOffset)
+{
+    m_pageSize = pagesize;
+    m_descOffset = descOffset;
+    m_ranges.clear();
+    m_zeros.clear();
+}
+
+// -----------------------------------------------------------------------------
+void PageIndex::addBatch(unsigned long long pfn, unsigned long long desc,
+                         off_t record, unsigned state)
+{
+    if (!m_ranges.empty() && desc < m_ranges.back().desc + m_interval) {
+        m_ranges.back().state |= state;
+        return;
+    }
+
+    Range range;
+    range.pfn = pfn;
+    range.desc = desc;
+    range.record = record;
+    range.state = state;
+    m_ranges.push_back(range);
+}
+
+// -----------------------------------------------------------------------------
+void PageIndex::addZero(unsigned long long pfn)
+{
+    if (!m_zeros.empty()) {
+        ZeroRange &last = m_zeros.back();
+        if (last.pfn + last.pages == pfn) {
+            ++last.pages;
+            return;
+        }
+    }
+
+    ZeroRange range;
+    range.pfn = pfn;
+    range.pages = 1;
+    m_zeros.push_back(range);
+}
+
+// -----------------------------------------------------------------------------
+const PageIndex::Range *PageIndex::find(unsigned long long pfn) const
+{
+    std::vector<Range>::const_iterator it = std::upper_bound(
+        m_ranges.begin(), m_ranges.end(), pfn,
+        [](unsigned long long p, const Range &r) { return p < r.pfn; });
+    if (it == m_ranges.begin())
+        return NULL;
+    return &*--it;
+}
+
+// -----------------------------------------------------------------------------
+bool PageIndex::isZero(unsigned long long pfn) const
+{
+    std::vector<ZeroRange>::const_iterator it = std::upper_bound(
+        m_zeros.begin(), m_zeros.end(), pfn,
+        [](unsigned long long p, const ZeroRange &r) { return p < r.pfn; });
+    if (it == m_zeros.begin())
+        return false;
+    --it;
+    return pfn < it->pfn + it->pages;
+}
+
+// -----------------------------------------------------------------------------
+string PageIndex::str() const
+{
+    std::ostringstream ss;
+    ss << INDEX_HEADER << '\n'
+       << "pagesize " << m_pageSize << '\n'
+       << "descriptors " << m_descOffset << '\n';
+
+    std::vector<Range>::const_iterator it;
+    for (it = m_ranges.begin(); it != m_ranges.end(); ++it) {
+        ss << "range " << it->pfn << ' ' << it->desc << ' ';
+        if (it->record < 0)
+            ss << '-';
+        else
+            ss << it->record;
+        const char *sep = " ";
+        for (size_t i = 0; i < STATE_COUNT; ++i)
+            if (it->state & state_names[i].bit) {
+                ss << sep << state_names[i].name;
+                sep = "+";
+            }
+        if (!it->state)
+            ss << " -";
+        ss << '\n';
+    }
+
+    std::vector<ZeroRange>::const_iterator zit;
+    for (zit = m_zeros.begin(); zit != m_zeros.end(); ++zit)
+        ss << "zero " << zit->pfn << ' ' << zit->pages << '\n';
+
+    return ss.str();
+}
+
+// -----------------------------------------------------------------------------
+static unsigned parseState(const string &word)
+{
+    unsigned ret = 0;
+    if (word == "-")
+        return ret;
+
+    std::istringstream ss(word);
+    string name;
+    while (std::getline(ss, name, '+')) {
+        size_t i;
+        for (i = 0; i < STATE_COUNT; ++i)
+            if (name == state_names[i].name)
+                break;
+        if (i == STATE_COUNT)
+            throw KError("Unknown page state in page index: " + name);
+        ret |= state_names[i].bit;
+    }
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+PageIndex PageIndex::parse(const string &data)
+{
+    Debug::debug()->trace("PageIndex::parse([%zd bytes])", data.size());
+
+    std::istringstream in(data);
+    string line;
+    if (!std::getline(in, line) || line != INDEX_HEADER)
+        throw KError("Not a page index.");
+
+    PageIndex ret;
+    while (std::getline(in, line)) {
+        std::istringstream ss(line);
+        string key;
+        if (!(ss >> key))
+            continue;
+
+        bool ok;
+        if (key == "pagesize")
+            ok = bool(ss >> ret.m_pageSize);
+        else if (key == "descriptors")
+            ok = bool(ss >> ret.m_descOffset);
+        else if (key == "range") {
+            Range range;
+            string record, state;
+            ok = bool(ss >> range.pfn >> range.desc >> record >> state);
+            if (ok) {
+                range.record = record == "-" ? -1 :
+                    (off_t)strtoll(record.c_str(), NULL, 10);
+                range.state = parseState(state);
+                ret.m_ranges.push_back(range);
+            }
+        } else if (key == "zero") {
+            ZeroRange range;
+            ok = bool(ss >> range.pfn >> range.pages);
+            if (ok)
+                ret.m_zeros.push_back(range);
+        } else {
+            // written by a later version
+            Debug::debug()->dbg("Unknown page index line: %s",
+                                line.c_str());
+            ok = true;
+        }
+        if (!ok)
+            throw KError("Invalid page index line: " + line);
+    }
+    return ret;
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#ifndef PAGEINDEX_H
+#define PAGEINDEX_H
+
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "global.h"
+
+// suffix of the sidecar file, e.g. vmcore.index
+#define PAGE_INDEX_SUFFIX       ".index"
+
+// page descriptors between two entries of the index
+#define PAGE_INDEX_INTERVAL     32768
+
+//{{{ PageIndex ----------------------------------------------------------------
+
+/**
+ * Random access index of a dump in the kdump-compressed format, saved
+ * as a sidecar file next to the dump.
+ *
+ * To find the page descriptor of a page frame, a reader of that format
+ * has to count the bits of the bitmap of saved pages up to that page
+ * frame, and a flattened file must even be read up to that descriptor.
+ * The index has an entry every PAGE_INDEX_INTERVAL page descriptors with
+ * the first page frame, the number of its page descriptor and, for a
+ * flattened file, the offset of the record that holds the descriptor.
+ * That record is followed by the record with the page data of its
+ * batch, so a reader seeks to the entry and parses only the records up
+ * to the next entry. Each entry also tells how the pages up to the next
+ * entry are saved, and the ranges of pages filled with zeros are listed
+ * separately.
+ *
+ * The file is text:
+ *
+ *   KDUMP-INDEX 1
+ *   pagesize <bytes>
+ *   descriptors <file offset of the first page descriptor>
+ *   range <pfn> <descriptor> <record offset or -> <state>[+<state>...]
+ *   zero <pfn> <pages>
+ *
+ * where a state is "raw", "zlib", "zstd" or "zero".
+ */
+class PageIndex {
+
+    public:
+        /**
+         * How the pages of a range are saved.
+         */
+        enum State {
+            STATE_RAW   = 1 << 0,
+            STATE_ZLIB  = 1 << 1,
+            STATE_ZSTD  = 1 << 2,
+            STATE_ZERO  = 1 << 3
+        };
+
+        /**
+         * One entry of the index.
+         */
+        struct Range {
+            unsigned long long pfn;     ///< first page frame
+            unsigned long long desc;    ///< number of its page descriptor
+            off_t record;               ///< record in the flattened file,
+                                        ///< or -1
+            unsigned state;             ///< State bits up to the next entry
+        };
+
+        /**
+         * Pages filled with zeros.
+         */
+        struct ZeroRange {
+            unsigned long long pfn;
+            unsigned long long pages;
+        };
+
+        /**
+         * Creates an empty index.
+         *
+         * @param[in] interval page descriptors between two entries
+         */
+        PageIndex(unsigned long long interval = PAGE_INDEX_INTERVAL);
+
+        /**
+         * Removes all entries and sets the layout of the dump file.
+         *
+         * @param[in] pagesize the page size
+         * @param[in] descOffset file offset of the first page descriptor
+         */
+        void reset(unsigned long pagesize, off_t descOffset);
+
+        /**
+         * Adds a batch of saved pages. Batches must be added in the
+         * order of their page descriptors.
+         *
+         * @param[in] pfn the page frame of the first page
+         * @param[in] desc the number of its page descriptor
+         * @param[in] record the offset of the record of the page
+         *            descriptors in the flattened file, or -1
+         * @param[in] state the State bits of the pages
+         */
+        void addBatch(unsigned long long pfn, unsigned long long desc,
+                      off_t record, unsigned state);
+
+        /**
+         * Adds a page filled with zeros. Pages must be added in
+         * ascending order.
+         */
+        void addZero(unsigned long long pfn);
+
+        /**
+         * Returns @c true if there are no entries.
+         */
+        bool empty() const
+        { return m_ranges.empty(); }
+
+        /**
+         * Returns the entry that covers @p pfn, i.e. the last entry that
+         * starts at or below @p pfn, or @c NULL.
+         */
+        const Range *find(unsigned long long pfn) const;
+
+        /**
+         * Checks whether @p pfn is in a range of zero pages.
+         */
+        bool isZero(unsigned long long pfn) const;
+
+        /**
+         * Returns the contents of the sidecar file.
+         */
+        std::string str() const;
+
+        /**
+         * Parses the contents of a sidecar file.
+         *
+         * @param[in] data the contents
+         * @exception KError if @p data is not a page index
+         */
+        static PageIndex parse(const std::string &data);
+
+        unsigned long pageSize() const
+        { return m_pageSize; }
+
+        off_t descOffset() const
+        { return m_descOffset; }
+
+        const std::vector<Range> &ranges() const
+        { return m_ranges; }
+
+        const std::vector<ZeroRange> &zeros() const
+        { return m_zeros; }
+
+    private:
+        unsigned long long m_interval;
+        unsigned long m_pageSize;
+        off_t m_descOffset;
+        std::vector<Range> m_ranges;
+        std::vector<ZeroRange> m_zeros;
+};
+
+//}}}
+
+#endif /* PAGEINDEX_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
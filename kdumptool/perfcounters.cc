@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <string>
+#include <sstream>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "global.h"
+#include "debug.h"
+#include "perfcounters.h"
+
+using std::string;
+
+#ifndef PERF_FLAG_FD_CLOEXEC
+#define PERF_FLAG_FD_CLOEXEC    (1UL << 3)
+#endif
+
+//{{{ PerfCounters -------------------------------------------------------------
+
+static const struct {
+    const char *name;
+    unsigned type;
+    unsigned long long config;
+} counterDefs[PerfCounters::COUNTER_MAX] = {
+    { "cycles",           PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions",     PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "llc_misses",       PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "context_switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+    { "task_clock_ns",    PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+};
+
+PerfCounters *PerfCounters::m_instance = NULL;
+
+// -----------------------------------------------------------------------------
+PerfCounters *PerfCounters::counters()
+{
+    if (!m_instance)
+        m_instance = new PerfCounters();
+
+    return m_instance;
+}
+
+// -----------------------------------------------------------------------------
+PerfCounters::PerfCounters()
+    : m_active(false)
+{
+    for (int i = 0; i < COUNTER_MAX; ++i)
+        m_fd[i] = -1;
+}
+
+// -----------------------------------------------------------------------------
+static int perfEventOpen(struct perf_event_attr *attr)
+{
+    return syscall(__NR_perf_event_open, attr, 0, -1, -1,
+                   PERF_FLAG_FD_CLOEXEC);
+}
+
+// -----------------------------------------------------------------------------
+bool PerfCounters::open()
+{
+    Debug::debug()->trace("PerfCounters::open()");
+
+    close();
+    for (int i = 0; i < COUNTER_MAX; ++i) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof attr);
+        attr.size = sizeof attr;
+        attr.type = counterDefs[i].type;
+        attr.config = counterDefs[i].config;
+        attr.inherit = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+            PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        // the kernel part is interesting (copying, page cache), but it
+        // may be forbidden by perf_event_paranoid
+        m_fd[i] = perfEventOpen(&attr);
+        if (m_fd[i] < 0 && (errno == EACCES || errno == EPERM)) {
+            attr.exclude_kernel = 1;
+            m_fd[i] = perfEventOpen(&attr);
+        }
+        if (m_fd[i] < 0)
+            Debug::debug()->dbg("Cannot open the %s counter: %s",
+                                counterDefs[i].name, strerror(errno));
+        else
+            m_active = true;
+    }
+    return m_active;
+}
+
+// -----------------------------------------------------------------------------
+void PerfCounters::close()
+{
+    for (int i = 0; i < COUNTER_MAX; ++i) {
+        if (m_fd[i] >= 0)
+            ::close(m_fd[i]);
+        m_fd[i] = -1;
+    }
+    m_active = false;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long PerfCounters::scale(unsigned long long count,
+                                       unsigned long long enabled,
+                                       unsigned long long running)
+{
+    if (running == 0 || running >= enabled)
+        return count;
+    return (unsigned long long)((double)count * enabled / running);
+}
+
+// -----------------------------------------------------------------------------
+PerfCounters::Sample PerfCounters::read() const
+{
+    Sample ret;
+    for (int i = 0; i < COUNTER_MAX; ++i) {
+        if (m_fd[i] < 0)
+            continue;
+
+        // value, time enabled, time running (see read_format)
+        unsigned long long buf[3];
+        if (::read(m_fd[i], buf, sizeof buf) != sizeof buf || !buf[2])
+            continue;
+        ret.value[i] = scale(buf[0], buf[1], buf[2]);
+        ret.mask |= 1U << i;
+    }
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+PerfCounters::Sample PerfCounters::delta(const Sample &from, const Sample &to)
+{
+    Sample ret;
+    ret.mask = from.mask & to.mask;
+    for (int i = 0; i < COUNTER_MAX; ++i)
+        if (ret.mask & (1U << i))
+            ret.value[i] = to.value[i] > from.value[i]
+                ? to.value[i] - from.value[i] : 0;
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+const char *PerfCounters::name(Counter counter)
+{
+    return counterDefs[counter].name;
+}
+
+// -----------------------------------------------------------------------------
+string PerfCounters::json(const Sample &sample)
+{
+    std::ostringstream ss;
+    for (int i = 0; i < COUNTER_MAX; ++i)
+        if (sample.mask & (1U << i))
+            ss << (ss.tellp() ? ", " : "{ ") << '"' << counterDefs[i].name
+               << "\": " << sample.value[i];
+    if (!sample.mask)
+        return string();
+    ss << " }";
+    return ss.str();
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
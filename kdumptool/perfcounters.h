@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <string>
+
+#include "global.h"
+
+//{{{ PerfCounters -------------------------------------------------------------
+
+/**
+ * Hardware and software counters of kdump-save, opened with
+ * perf_event_open(2) when the PERF flag is in KDUMPTOOL_FLAGS.
+ *
+ * The counters are inherited by the threads and the child processes
+ * (makedumpfile, ssh) that are created after open(), so they count the
+ * whole save. SaveStats::Timer reads them at the start and at the end of
+ * every phase; the phases of the task graph run concurrently, so the
+ * counts of overlapping phases overlap, too.
+ *
+ * Few instructions per cycle and many LLC misses mean that filtering
+ * and compression wait for memory; a task clock far below the duration
+ * times the number of CPUs with many context switches means that the
+ * save waits for the disk or the network.
+ *
+ * Hardware counters are often not available in a virtual machine; the
+ * counters that cannot be opened are left out of the report.
+ */
+class PerfCounters {
+
+    public:
+        enum Counter {
+            CYCLES,
+            INSTRUCTIONS,
+            LLC_MISSES,
+            CONTEXT_SWITCHES,
+            TASK_CLOCK,                 // CPU time in nanoseconds
+            COUNTER_MAX
+        };
+
+        /**
+         * Values of all counters at one point in time.
+         */
+        struct Sample {
+            Sample()
+                : mask(0)
+            {
+                for (int i = 0; i < COUNTER_MAX; ++i)
+                    value[i] = 0;
+            }
+
+            unsigned long long value[COUNTER_MAX];
+            unsigned mask;              // bit (1 << Counter) if valid
+        };
+
+        /**
+         * Returns the only instance.
+         */
+        static PerfCounters *counters();
+
+        /**
+         * Opens all counters for this process. Counters that cannot be
+         * opened are logged and left out.
+         *
+         * @return @c true if at least one counter has been opened
+         */
+        bool open();
+
+        /**
+         * Closes all counters.
+         */
+        void close();
+
+        /**
+         * Returns @c true if any counter is open.
+         */
+        bool active() const
+        { return m_active; }
+
+        /**
+         * Returns the current values, which are zero at open(). The
+         * mask is 0 if no counter is open.
+         */
+        Sample read() const;
+
+        /**
+         * Returns the counts between @p from and @p to. Only the counters
+         * that are valid in both are valid.
+         */
+        static Sample delta(const Sample &from, const Sample &to);
+
+        /**
+         * Extrapolates a count of a multiplexed counter, which has only
+         * counted for @p running of the @p enabled nanoseconds.
+         *
+         * @return the scaled count, or @p count if the counter has run
+         *         all the time or not at all
+         */
+        static unsigned long long scale(unsigned long long count,
+                                        unsigned long long enabled,
+                                        unsigned long long running);
+
+        /**
+         * Returns the name of @p counter in stats.json.
+         */
+        static const char *name(Counter counter);
+
+        /**
+         * Returns the valid counters of @p sample as a JSON object, or
+         * an empty string if none is valid.
+         */
+        static std::string json(const Sample &sample);
+
+    protected:
+        PerfCounters();
+
+    private:
+        static PerfCounters *m_instance;
+
+        int m_fd[COUNTER_MAX];
+        bool m_active;
+};
+
+//}}}
+
+#endif /* PERFCOUNTERS_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
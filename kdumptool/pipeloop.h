@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#ifndef PIPELOOP_H
+#define PIPELOOP_H
+
+#include <algorithm>
+
+#include <sys/types.h>
+
+#include "global.h"
+#include "util.h"
+#include "dataprovider.h"
+
+//{{{ Read policies ------------------------------------------------------------
+
+/*
+ * The data loops of the transfers are templates, and a policy type
+ * stands for each choice that is made once per file: how the data is
+ * read, and whether zero blocks are skipped. The loop for the options
+ * of a transfer is picked before the first chunk, so that it does not
+ * test them again for every chunk, and the compiler can inline the
+ * policy into the loop.
+ *
+ * A read policy has a read() function that gets the next piece of at
+ * most @c size bytes and returns its length (0 at the end). @c data
+ * points to the piece afterwards. If @c mapped is set, the piece is
+ * not copied and @c buf is not used.
+ */
+
+/**
+ * Copies the data into the buffer (DataProvider::getData()).
+ */
+struct CopyRead {
+    static const bool mapped = false;
+
+    static size_t read(DataProvider *dataprovider, char *buf, size_t size,
+                       const char *&data, off_t &offset)
+    {
+        data = buf;
+        return dataprovider->getData(buf, size);
+    }
+};
+
+/**
+ * Maps the data without copying it (DataProvider::mapData()).
+ */
+struct MapRead {
+    static const bool mapped = true;
+
+    static size_t read(DataProvider *dataprovider, char *buf, size_t size,
+                       const char *&data, off_t &offset)
+    {
+        return dataprovider->mapData(&data, size);
+    }
+};
+
+/**
+ * Copies the data into the buffer and sets @c offset to its position
+ * in the file (DataProvider::getPlacedData()).
+ */
+struct PlacedRead {
+    static const bool mapped = false;
+
+    static size_t read(DataProvider *dataprovider, char *buf, size_t size,
+                       const char *&data, off_t &offset)
+    {
+        data = buf;
+        return dataprovider->getPlacedData(buf, size, &offset);
+    }
+};
+
+//}}}
+//{{{ Hole policies ------------------------------------------------------------
+
+/**
+ * Writes all data, also zero blocks.
+ */
+struct KeepZeros {
+    static const bool sparse = false;
+
+    static bool hole(const char *data, size_t len, size_t blockSize)
+    { return false; }
+};
+
+/**
+ * Leaves every full block of zeros as a hole.
+ */
+struct SkipZeros {
+    static const bool sparse = true;
+
+    static bool hole(const char *data, size_t len, size_t blockSize)
+    { return len == blockSize && Util::isZero(data, len); }
+};
+
+/**
+ * Splits a chunk into the runs of data that must be written and the
+ * blocks that are left as holes, in the order of the chunk.
+ *
+ * @param[in] data the chunk
+ * @param[in] len length of the chunk in bytes
+ * @param[in] blockSize size of a hole (ignored for KeepZeros)
+ * @param[in] write called as write(ptr, len, pos) for each run of data,
+ *            where @c pos is the position within the chunk
+ * @param[in] skip called as skip(len) for each hole
+ */
+template<typename Holes, typename WriteFn, typename SkipFn>
+inline void splitRuns(const char *data, size_t len, size_t blockSize,
+                      WriteFn write, SkipFn skip)
+{
+    if (!Holes::sparse) {
+        if (len)
+            write(data, len, (size_t)0);
+        return;
+    }
+
+    size_t run = 0;
+    for (size_t pos = 0; pos < len; pos += blockSize) {
+        size_t n = std::min(blockSize, len - pos);
+        if (!Holes::hole(data + pos, n, blockSize))
+            continue;
+        if (pos > run)
+            write(data + run, pos - run, run);
+        skip(n);
+        run = pos + n;
+    }
+    if (len > run)
+        write(data + run, len - run, run);
+}
+
+//}}}
+
+#endif /* PIPELOOP_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
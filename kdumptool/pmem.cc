@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <fstream>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/sysmacros.h>
+#if defined(__x86_64__)
+#   include <emmintrin.h>
+#endif
+
+#include "global.h"
+#include "debug.h"
+#include "fileutil.h"
+#include "stringutil.h"
+#include "pmem.h"
+
+using std::string;
+
+#ifndef MAP_SHARED_VALIDATE
+#   define MAP_SHARED_VALIDATE  0x03
+#endif
+#ifndef MAP_SYNC
+#   define MAP_SYNC             0x80000
+#endif
+
+//{{{ PmemRegion ---------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+PmemRegion::PmemRegion(const string &path, char *base,
+                       unsigned long long size)
+    : m_path(path), m_base(base), m_size(size), m_dirtyStart(size),
+      m_dirtyEnd(0)
+{}
+
+// -----------------------------------------------------------------------------
+PmemRegion::~PmemRegion()
+{
+    munmap(m_base, m_size);
+}
+
+// -----------------------------------------------------------------------------
+PmemRegion *PmemRegion::open(const string &path, bool writable)
+{
+    Debug::debug()->trace("PmemRegion::open(%s, %d)", path.c_str(), writable);
+
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return NULL;
+
+    // device DAX is a character device of the "dax" subsystem
+    unsigned long long size = 0;
+    if (S_ISCHR(st.st_mode)) {
+        string sys = "/sys/dev/char/" +
+            StringUtil::number2string(major(st.st_rdev)) + ":" +
+            StringUtil::number2string(minor(st.st_rdev));
+        try {
+            if (FilePath(FilePath(sys + "/subsystem").readLink())
+                    .baseName() != "dax")
+                return NULL;
+        } catch (const KError &e) {
+            return NULL;
+        }
+        std::ifstream fin((sys + "/size").c_str());
+        if (!(fin >> size) || size == 0)
+            throw KError("Cannot get the size of " + path + ".");
+    } else if (S_ISREG(st.st_mode))
+        size = st.st_size;
+    else
+        return NULL;
+    if (size == 0)
+        return NULL;
+
+    int fd = ::open(path.c_str(), (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+    if (fd < 0)
+        throw KSystemError("Cannot open " + path + ".", errno);
+
+    // only DAX mappings accept MAP_SYNC
+    int prot = PROT_READ | (writable ? PROT_WRITE : 0);
+    void *map = mmap(NULL, size, prot, MAP_SHARED_VALIDATE | MAP_SYNC, fd, 0);
+    int err = errno;
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        if (S_ISREG(st.st_mode) && (err == EOPNOTSUPP || err == EINVAL)) {
+            Debug::debug()->dbg("%s is not on a DAX file system",
+                                path.c_str());
+            return NULL;
+        }
+        throw KSystemError("Cannot map " + path + ".", err);
+    }
+
+    Debug::debug()->dbg("Mapped %llu bytes of persistent memory at %s",
+                        size, path.c_str());
+    return new PmemRegion(path, static_cast<char *>(map), size);
+}
+
+// -----------------------------------------------------------------------------
+void PmemRegion::write(unsigned long long offset, const char *data,
+                       size_t len)
+{
+    if (offset > m_size || len > m_size - offset)
+        throw KError("Write beyond the end of " + m_path + ".");
+
+    copy(m_base + offset, data, len);
+    m_dirtyStart = std::min(m_dirtyStart, offset);
+    m_dirtyEnd = std::max(m_dirtyEnd, offset + len);
+}
+
+// -----------------------------------------------------------------------------
+void PmemRegion::persist()
+{
+#if defined(__x86_64__)
+    _mm_sfence();
+#else
+    if (m_dirtyStart < m_dirtyEnd) {
+        unsigned long long page = sysconf(_SC_PAGESIZE);
+        unsigned long long start = m_dirtyStart / page * page;
+        if (msync(m_base + start, m_dirtyEnd - start, MS_SYNC) != 0)
+            throw KSystemError("Cannot flush " + m_path + ".", errno);
+    }
+#endif
+    m_dirtyStart = m_size;
+    m_dirtyEnd = 0;
+}
+
+// -----------------------------------------------------------------------------
+void PmemRegion::copy(char *dst, const char *src, size_t len)
+{
+#if defined(__x86_64__)
+    // the unaligned head and tail go through the cache
+    size_t head = std::min<size_t>(len, (8 - (uintptr_t)dst % 8) % 8);
+    if (head) {
+        memcpy(dst, src, head);
+        _mm_clflush(dst);
+        dst += head;
+        src += head;
+        len -= head;
+    }
+
+    size_t words = len / 8;
+    for (size_t i = 0; i < words; ++i) {
+        long long word;
+        memcpy(&word, src + i * 8, 8);
+        _mm_stream_si64(reinterpret_cast<long long *>(dst) + i, word);
+    }
+
+    size_t tail = len % 8;
+    if (tail) {
+        memcpy(dst + words * 8, src + words * 8, tail);
+        _mm_clflush(dst + words * 8);
+    }
+#else
+    memcpy(dst, src, len);
+#endif
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef PMEM_H
+#define PMEM_H
+
+#include <string>
+
+#include "global.h"
+
+//{{{ PmemRegion ---------------------------------------------------------------
+
+/**
+ * A persistent memory device (device DAX, e.g. /dev/dax0.0) or a file
+ * on a DAX file system, mapped into memory.
+ *
+ * Data is stored with non-temporal stores, which bypass the CPU caches,
+ * and made durable with a store fence. The mapping uses MAP_SYNC, so
+ * no file system metadata has to be flushed either; neither the block
+ * layer nor the page cache is involved. On architectures without
+ * non-temporal stores, the data is copied normally and flushed with
+ * msync().
+ */
+class PmemRegion {
+
+    public:
+        /**
+         * Maps @p path if it is persistent memory.
+         *
+         * @param[in] path the device or file
+         * @param[in] writable map for writing
+         * @return the mapped region, or @c NULL if @p path is not DAX
+         * @exception KError if @p path is DAX but cannot be mapped
+         */
+        static PmemRegion *open(const std::string &path, bool writable);
+
+        /**
+         * Unmaps the region.
+         */
+        ~PmemRegion();
+
+        /**
+         * Returns the size of the region in bytes.
+         */
+        unsigned long long size() const
+        { return m_size; }
+
+        /**
+         * Returns the start of the mapping.
+         */
+        const char *data() const
+        { return m_base; }
+
+        /**
+         * Stores data in the region. It is only durable after persist().
+         *
+         * @param[in] offset offset in the region
+         * @param[in] data the data
+         * @param[in] len number of bytes
+         * @exception KError if the range exceeds the region
+         */
+        void write(unsigned long long offset, const char *data, size_t len);
+
+        /**
+         * Waits until all stored data is durable.
+         *
+         * @exception KSystemError if the data cannot be flushed
+         */
+        void persist();
+
+        /**
+         * Copies memory with non-temporal stores where the CPU has them.
+         * The edges that are not aligned to 8 bytes are flushed from
+         * the cache. The stores are ordered only by a later fence.
+         *
+         * @param[out] dst the target
+         * @param[in] src the source
+         * @param[in] len number of bytes
+         */
+        static void copy(char *dst, const char *src, size_t len);
+
+    private:
+        PmemRegion(const std::string &path, char *base,
+                   unsigned long long size);
+        PmemRegion(const PmemRegion &);
+        PmemRegion &operator=(const PmemRegion &);
+
+        std::string m_path;
+        char *m_base;
+        unsigned long long m_size;
+        unsigned long long m_dirtyStart;
+        unsigned long long m_dirtyEnd;
+};
+
+//}}}
+
+#endif /* PMEM_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
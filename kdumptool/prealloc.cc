@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <sys/statvfs.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <linux/magic.h>
+
+#include "global.h"
+#include "debug.h"
+#include "fileutil.h"
+#include "prealloc.h"
+
+//{{{ Preallocation ------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+Preallocation::Preallocation(int fd, unsigned long long size,
+                             unsigned long long reserve)
+    : m_fd(fd), m_size(0)
+{
+    Debug::debug()->trace("Preallocation::Preallocation(%d, %llu, %llu)",
+                          fd, size, reserve);
+
+#ifdef FS_IOC_FSSETXATTR
+    // the hint must be set while the file has no extents
+    struct statfs sfs;
+    struct fsxattr fsx;
+    if (fstatfs(fd, &sfs) == 0 && sfs.f_type == XFS_SUPER_MAGIC &&
+        ioctl(fd, FS_IOC_FSGETXATTR, &fsx) == 0) {
+        fsx.fsx_xflags |= FS_XFLAG_EXTSIZE;
+        fsx.fsx_extsize = PREALLOC_EXTENT_HINT;
+        if (ioctl(fd, FS_IOC_FSSETXATTR, &fsx) != 0)
+            Debug::debug()->dbg("Cannot set the extent size hint: %s",
+                                strerror(errno));
+    }
+#endif
+
+    struct statvfs vfs;
+    if (fstatvfs(fd, &vfs) != 0) {
+        Debug::debug()->dbg("fstatvfs() failed: %s", strerror(errno));
+        return;
+    }
+    unsigned long long avail =
+        (unsigned long long)vfs.f_bavail * vfs.f_frsize;
+    avail = avail > reserve ? (avail - reserve) / 2 : 0;
+    size = std::min(size, avail);
+    if (!size)
+        return;
+
+    if (fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, size) != 0) {
+        Debug::debug()->dbg("Cannot preallocate %llu bytes: %s",
+                            size, strerror(errno));
+        return;
+    }
+    Debug::debug()->dbg("Preallocated %llu MiB",
+                        bytes_to_megabytes(size));
+    m_size = size;
+}
+
+// -----------------------------------------------------------------------------
+void Preallocation::trim()
+{
+    if (!m_size)
+        return;
+
+    struct stat st;
+    if (fstat(m_fd, &st) != 0) {
+        Debug::debug()->dbg("fstat() failed: %s", strerror(errno));
+        return;
+    }
+    off_t end = st.st_size;
+
+    // unwritten extents without cached data are reported as holes
+    off_t pos = 0;
+    while (pos < end) {
+        off_t hole = lseek(m_fd, pos, SEEK_HOLE);
+        if (hole < 0 || hole >= end)
+            break;
+        off_t data = lseek(m_fd, hole, SEEK_DATA);
+        if (data < 0 || data > end)
+            data = end;
+        punch(hole, data - hole);
+        pos = data;
+    }
+
+    // ext4 frees blocks beyond the end only on truncate, and XFS only
+    // when they are punched out
+    if ((off_t)m_size > end) {
+        if (ftruncate(m_fd, end) != 0)
+            Debug::debug()->dbg("ftruncate() failed: %s", strerror(errno));
+        punch(end, m_size - end);
+    }
+    m_size = 0;
+}
+
+// -----------------------------------------------------------------------------
+void Preallocation::punch(off_t offset, off_t len)
+{
+    if (fallocate(m_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                  offset, len) != 0)
+        Debug::debug()->dbg("Cannot punch a hole at %lld: %s",
+                            (long long)offset, strerror(errno));
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef PREALLOC_H
+#define PREALLOC_H
+
+#include <sys/types.h>
+
+#include "global.h"
+
+// extent size hint for dump files on XFS
+#define PREALLOC_EXTENT_HINT    (64*1024*1024)
+
+//{{{ Preallocation ------------------------------------------------------------
+
+/**
+ * Reserves the expected extent of a file before it is written.
+ *
+ * A dump file that grows with each write, between the writes of other
+ * files on a shared volume, ends up in many small extents, and reading
+ * it later is dominated by seeks. Here the expected size is allocated
+ * up front with fallocate(FALLOC_FL_KEEP_SIZE), so the file size still
+ * follows the data, and on XFS an extent size hint is set for anything
+ * beyond the estimate. At most half of the free space above the reserve
+ * is taken, so that a SpaceGuard still sees room to write.
+ *
+ * Zero blocks that are skipped stay allocated as unwritten extents until
+ * trim() punches them out together with the unused tail. File systems
+ * without fallocate() are written normally.
+ */
+class Preallocation {
+
+    public:
+        /**
+         * Allocates the space.
+         *
+         * @param[in] fd an empty file open for writing
+         * @param[in] size the expected size of the file in bytes
+         * @param[in] reserve bytes that must stay free
+         */
+        Preallocation(int fd, unsigned long long size,
+                      unsigned long long reserve = 0);
+
+        /**
+         * Returns the number of bytes that have been allocated.
+         */
+        unsigned long long size() const
+        { return m_size; }
+
+        /**
+         * Releases the space that the file does not use: the holes and
+         * everything beyond its end. Must be called before the file is
+         * closed; errors are only logged.
+         */
+        void trim();
+
+    private:
+        void punch(off_t offset, off_t len);
+
+        int m_fd;
+        unsigned long long m_size;
+};
+
+//}}}
+
+#endif /* PREALLOC_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
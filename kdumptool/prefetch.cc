@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "global.h"
+#include "debug.h"
+#include "prefetch.h"
+
+//{{{ PrefetchDataProvider -----------------------------------------------------
+
+// -----------------------------------------------------------------------------
+PrefetchDataProvider::PrefetchDataProvider(DataProvider *forward,
+                                           unsigned depth, size_t slotSize)
+    : m_forward(forward), m_slotSize(slotSize), m_ring(depth),
+      m_stop(false), m_started(false), m_end(false), m_pos(0),
+      m_sourceWaits(0), m_sinkWaits(0)
+{
+    m_current.length = 0;
+    m_current.offset = 0;
+}
+
+// -----------------------------------------------------------------------------
+PrefetchDataProvider::~PrefetchDataProvider()
+{
+    stop();
+}
+
+// -----------------------------------------------------------------------------
+void PrefetchDataProvider::prepare()
+{
+    stop();
+    m_end = false;
+    m_current = Slot();
+    m_current.length = 0;
+    m_current.offset = 0;
+    m_pos = 0;
+    m_sourceWaits = 0;
+    m_sinkWaits = 0;
+    m_forward->prepare();
+}
+
+// -----------------------------------------------------------------------------
+void PrefetchDataProvider::start(bool placed)
+{
+    if (m_started)
+        return;
+    Debug::debug()->dbg("Reading %zu buffers of %zu bytes ahead",
+                        m_ring.capacity(), m_slotSize);
+    m_stop = false;
+    m_started = true;
+    m_thread = std::thread(&PrefetchDataProvider::run, this, placed);
+}
+
+// -----------------------------------------------------------------------------
+void PrefetchDataProvider::stop()
+{
+    if (!m_started)
+        return;
+
+    m_stop = true;
+    m_ring.wake();
+    m_thread.join();
+    m_started = false;
+
+    // drop what has been read ahead
+    Slot slot;
+    while (m_ring.tryPop(slot))
+        ;
+}
+
+// -----------------------------------------------------------------------------
+void PrefetchDataProvider::run(bool placed)
+{
+    off_t offset = 0;
+    while (!m_stop) {
+        Slot slot;
+        slot.length = 0;
+        slot.offset = offset;
+        try {
+            slot.buffer = BufferPool::pool()->get(m_slotSize);
+            if (placed)
+                slot.length = m_forward->getPlacedData(
+                    slot.buffer.get(), m_slotSize, &slot.offset);
+            else
+                slot.length = m_forward->getData(slot.buffer.get(),
+                                                 m_slotSize);
+        } catch (...) {
+            slot.length = 0;
+            slot.error = std::current_exception();
+        }
+        offset += placed ? 0 : slot.length;
+        bool last = slot.length == 0;
+
+        if (m_ring.full())
+            m_sinkWaits.fetch_add(1, std::memory_order_relaxed);
+        m_ring.wait([this]() { return m_stop || !m_ring.full(); });
+        if (m_stop || !m_ring.tryPush(slot) || last)
+            break;
+    }
+}
+
+// -----------------------------------------------------------------------------
+bool PrefetchDataProvider::next()
+{
+    if (m_pos < m_current.length)
+        return true;
+    if (m_end)
+        return false;
+
+    if (m_ring.empty())
+        ++m_sourceWaits;
+    m_ring.wait([this]() { return !m_ring.empty(); });
+    m_ring.tryPop(m_current);
+    m_pos = 0;
+
+    if (m_current.error) {
+        m_end = true;
+        std::exception_ptr error = m_current.error;
+        m_current.error = nullptr;
+        std::rethrow_exception(error);
+    }
+    if (m_current.length == 0) {
+        m_end = true;
+        return false;
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+size_t PrefetchDataProvider::copy(char *buffer, size_t maxread,
+                                  off_t *offset)
+{
+    if (!next())
+        return 0;
+
+    size_t ret = std::min(maxread, m_current.length - m_pos);
+    memcpy(buffer, m_current.buffer.get() + m_pos, ret);
+    if (offset)
+        *offset = m_current.offset + m_pos;
+    m_pos += ret;
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+bool PrefetchDataProvider::canSaveToFile() const
+{
+    return m_forward->canSaveToFile();
+}
+
+// -----------------------------------------------------------------------------
+void PrefetchDataProvider::saveToFile(const StringVector &targets)
+{
+    m_forward->saveToFile(targets);
+}
+
+// -----------------------------------------------------------------------------
+size_t PrefetchDataProvider::getData(char *buffer, size_t maxread)
+{
+    start(false);
+    return copy(buffer, maxread, NULL);
+}
+
+// -----------------------------------------------------------------------------
+bool PrefetchDataProvider::canSplice() const
+{
+    return m_forward->canSplice();
+}
+
+// -----------------------------------------------------------------------------
+size_t PrefetchDataProvider::spliceData(int fd)
+{
+    return m_forward->spliceData(fd);
+}
+
+// -----------------------------------------------------------------------------
+bool PrefetchDataProvider::canMapData() const
+{
+    return m_forward->canMapData();
+}
+
+// -----------------------------------------------------------------------------
+size_t PrefetchDataProvider::mapData(const char **data, size_t maxread)
+{
+    return m_forward->mapData(data, maxread);
+}
+
+// -----------------------------------------------------------------------------
+bool PrefetchDataProvider::canPlaceData() const
+{
+    return m_forward->canPlaceData();
+}
+
+// -----------------------------------------------------------------------------
+size_t PrefetchDataProvider::getPlacedData(char *buffer, size_t maxread,
+                                           off_t *offset)
+{
+    start(true);
+    return copy(buffer, maxread, offset);
+}
+
+// -----------------------------------------------------------------------------
+size_t PrefetchDataProvider::getChunk(DataChunk &chunk, size_t maxread)
+{
+    start(m_forward->canPlaceData());
+    if (!next()) {
+        chunk.reset();
+        return 0;
+    }
+
+    // a whole buffer is passed on, anything else is copied
+    if (m_pos == 0 && m_current.length <= maxread) {
+        size_t ret = m_current.length;
+        chunk.assign(std::move(m_current.buffer), ret, m_current.offset);
+        m_current.length = 0;
+        return ret;
+    }
+
+    BufferPool::Buffer buffer = BufferPool::pool()->get(maxread);
+    off_t offset;
+    size_t ret = copy(buffer.get(), maxread, &offset);
+    chunk.assign(std::move(buffer), ret, offset);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void PrefetchDataProvider::finish()
+{
+    stop();
+    Debug::debug()->dbg("Prefetch: waited %llu times for the source, "
+                        "%llu times for the target",
+                        m_sourceWaits, sinkWaits());
+    m_forward->finish();
+}
+
+// -----------------------------------------------------------------------------
+void PrefetchDataProvider::setError(bool error)
+{
+    // the reader thread must not use the other DataProvider any more
+    if (error)
+        stop();
+    m_forward->setError(error);
+}
+
+// -----------------------------------------------------------------------------
+void PrefetchDataProvider::setProgress(Progress *progress)
+{
+    m_forward->setProgress(progress);
+}
+
+// -----------------------------------------------------------------------------
+bool PrefetchDataProvider::canRestart() const
+{
+    return m_forward->canRestart();
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
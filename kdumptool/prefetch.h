@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <thread>
+#include <atomic>
+#include <exception>
+
+#include "global.h"
+#include "dataprovider.h"
+#include "spscring.h"
+
+// size of each buffer in the prefetch ring
+#define PREFETCH_SLOT_SIZE      (1024*1024)
+
+//{{{ PrefetchDataProvider -----------------------------------------------------
+
+/**
+ * DataProvider that reads another DataProvider from its own thread, a
+ * few buffers ahead of the Transfer. Bursts of the source (e.g. while
+ * makedumpfile compresses) and latency spikes of the target are then
+ * absorbed by the ring between them instead of stalling each other.
+ *
+ * The thread is started with the first call to getData(),
+ * getPlacedData() or getChunk(). saveToFile(), spliceData() and
+ * mapData() do not copy the data in kdumptool, so they are passed to
+ * the other DataProvider directly.
+ */
+class PrefetchDataProvider : public DataProvider {
+
+    public:
+        /**
+         * Wraps a DataProvider.
+         *
+         * @param[in] forward the DataProvider that provides the data
+         * @param[in] depth number of buffers read ahead
+         * @param[in] slotSize size of each buffer
+         */
+        PrefetchDataProvider(DataProvider *forward, unsigned depth,
+                             size_t slotSize = PREFETCH_SLOT_SIZE);
+
+        /**
+         * Stops the reader thread.
+         */
+        ~PrefetchDataProvider();
+
+        void prepare();
+        bool canSaveToFile() const;
+        void saveToFile(const StringVector &targets);
+        size_t getData(char *buffer, size_t maxread);
+        bool canSplice() const;
+        size_t spliceData(int fd);
+        bool canMapData() const;
+        size_t mapData(const char **data, size_t maxread);
+        bool canPlaceData() const;
+        size_t getPlacedData(char *buffer, size_t maxread, off_t *offset);
+
+        /**
+         * Hands out the prefetched buffers without copying them.
+         *
+         * @see DataProvider::getChunk()
+         */
+        size_t getChunk(DataChunk &chunk, size_t maxread);
+
+        /**
+         * Stops the reader thread and finishes the other DataProvider.
+         */
+        void finish();
+        void setError(bool error);
+        void setProgress(Progress *progress);
+        bool canRestart() const;
+
+        /**
+         * Returns how often the Transfer had to wait for the source.
+         */
+        unsigned long long sourceWaits() const
+        { return m_sourceWaits; }
+
+        /**
+         * Returns how often the reader had to wait for the Transfer.
+         */
+        unsigned long long sinkWaits() const
+        { return m_sinkWaits.load(std::memory_order_relaxed); }
+
+    private:
+        struct Slot {
+            BufferPool::Buffer buffer;
+            size_t length;
+            off_t offset;
+            std::exception_ptr error;
+        };
+
+        void start(bool placed);
+        void stop();
+        void run(bool placed);
+        bool next();
+        size_t copy(char *buffer, size_t maxread, off_t *offset);
+
+        DataProvider *m_forward;
+        size_t m_slotSize;
+        SpscRing<Slot> m_ring;
+        std::thread m_thread;
+        std::atomic<bool> m_stop;
+
+        // accessed by the consumer only
+        bool m_started;
+        bool m_end;
+        Slot m_current;
+        size_t m_pos;
+        unsigned long long m_sourceWaits;
+
+        std::atomic<unsigned long long> m_sinkWaits;
+};
+
+//}}}
+
+#endif /* PREFETCH_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
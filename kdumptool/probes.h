@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef PROBES_H
+#define PROBES_H
+
+#include "config.h"
+
+/**
+ * Static probe points for bpftrace, perf and SystemTap.
+ *
+ * With sys/sdt.h (from systemtap-sdt-devel), each probe is a single NOP
+ * instruction plus a note in the .note.stapsdt section that describes
+ * where its arguments are. The arguments stay in their registers or
+ * memory, so the probes can stay in the hot paths. Without sys/sdt.h
+ * the macros expand to nothing.
+ *
+ * All probes belong to the provider "kdump"; the list and the arguments
+ * are in kdumptool(8). Probes named *_start and *_done come in pairs on
+ * the same thread, so that the time between them can be measured.
+ */
+
+#if HAVE_SDT
+#   include <sys/sdt.h>
+#   define KDUMP_PROBE(name) \
+        DTRACE_PROBE(kdump, name)
+#   define KDUMP_PROBE1(name, a) \
+        DTRACE_PROBE1(kdump, name, a)
+#   define KDUMP_PROBE2(name, a, b) \
+        DTRACE_PROBE2(kdump, name, a, b)
+#   define KDUMP_PROBE3(name, a, b, c) \
+        DTRACE_PROBE3(kdump, name, a, b, c)
+#else
+#   define KDUMP_PROBE(name)               do { } while (0)
+#   define KDUMP_PROBE1(name, a)           do { } while (0)
+#   define KDUMP_PROBE2(name, a, b)        do { } while (0)
+#   define KDUMP_PROBE3(name, a, b, c)     do { } while (0)
+#endif
+
+#endif /* PROBES_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -25,7 +25,9 @@
 #include <cerrno>
 #include <unistd.h>
 #include <poll.h>
+#include <spawn.h>
 #include <typeinfo>
+#include <chrono>
 
 #include "process.h"
 #include "global.h"
@@ -33,6 +35,7 @@
 #include "charv.h"
 #include "util.h"
 #include "debug.h"
+#include "probes.h"
 
 using std::string;
 using std::istream;
@@ -42,6 +45,25 @@ using std::max;
 using std::make_shared;
 using std::shared_ptr;
 using std::unique_ptr;
+using std::chrono::steady_clock;
+
+// maximum number of bytes moved by one splice(2) call
+#define RELAY_CHUNK     (64*1024)
+
+// -----------------------------------------------------------------------------
+static void writeAll(int fd, const char *buf, size_t len)
+{
+    while (len) {
+        ssize_t cnt = write(fd, buf, len);
+        if (cnt < 0) {
+            if (errno == EINTR)
+                continue;
+            throw KSystemError("Cannot relay data", errno);
+        }
+        buf += cnt;
+        len -= cnt;
+    }
+}
 
 //{{{ SubProcess ---------------------------------------------------------------
 
@@ -96,31 +118,38 @@ void SubProcess::spawn(const string &name, const StringVector &args)
     // execute the child
     //
 
-    pid_t child = fork();
-    if (child > 0) {		// parent code
-	m_pid = child;
+    posix_spawn_file_actions_t actions;
+    int err = posix_spawn_file_actions_init(&actions);
+    if (err)
+        throw KSystemError("SubProcess::spawn(): cannot init file actions",
+                           err);
 
+    pid_t child;
+    try {
         for (auto &elem : m_fdmap)
-            elem.second->finalizeParent();
+            elem.second->finalizeChild(&actions, elem.first);
 
-    } else if (child == 0) {	// child code
-        for (auto &elem : m_fdmap)
-            elem.second->finalizeChild(elem.first);
+        CharV fullV = args;
+        fullV.insert(fullV.begin(), name);
 
-    	// execute the process
-	CharV fullV = args;
-	fullV.insert(fullV.begin(), name);
-	char **vector = fullV.data();
+        // glibc uses clone(CLONE_VM|CLONE_VFORK) and reports exec errors
+        err = posix_spawnp(&child, name.c_str(), &actions, NULL,
+                           fullV.data(), environ);
+    } catch (...) {
+        posix_spawn_file_actions_destroy(&actions);
+        throw;
+    }
+    posix_spawn_file_actions_destroy(&actions);
 
-	int ret = execvp(name.c_str(), vector);
-	if (ret < 0)
-	    throw KSystemError("Execution of '" + name + "' failed.", errno);
+    if (err)
+        throw KSystemError("Execution of '" + name + "' failed.", err);
 
-    } else {                    // parent code failure
-        throw KSystemError("SubProcess::spawn(): fork failed", errno);
-    }
+    m_pid = child;
+    for (auto &elem : m_fdmap)
+        elem.second->finalizeParent();
 
-    Debug::debug()->dbg("Forked child PID %d", m_pid);
+    Debug::debug()->dbg("Spawned child PID %d", m_pid);
+    KDUMP_PROBE2(process_spawn, m_pid, name.c_str());
 }
 
 // -----------------------------------------------------------------------------
@@ -155,6 +184,7 @@ int SubProcess::wait(void)
 		     + StringUtil::number2string(ret) + " exited.");
 
     Debug::debug()->dbg("PID %d exited with status 0x%04x", m_pid, status);
+    KDUMP_PROBE2(process_exit, m_pid, status);
 
     m_pid = -1;
     return status;
@@ -169,15 +199,31 @@ SubProcessFD::~SubProcessFD()
 }
 
 // -----------------------------------------------------------------------------
-void SubProcessFD::_move_fd(int& oldfd, int newfd)
+void SubProcessFD::_move_fd(posix_spawn_file_actions_t *actions,
+                            int oldfd, int newfd)
 {
-    if (dup2(oldfd, newfd) < 0)
+    int err;
+    if (oldfd == newfd) {
+        // nothing to move, but the descriptor must lose FD_CLOEXEC;
+        // glibc 2.29 clears it in the child for a dup2 onto itself
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 29)
+        err = posix_spawn_file_actions_adddup2(actions, oldfd, newfd);
+#else
+        int flags = fcntl(oldfd, F_GETFD);
+        err = 0;
+        if (flags < 0 || fcntl(oldfd, F_SETFD, flags & ~FD_CLOEXEC) < 0)
+            err = errno;
+#endif
+    } else {
+        err = posix_spawn_file_actions_adddup2(actions, oldfd, newfd);
+        if (!err)
+            err = posix_spawn_file_actions_addclose(actions, oldfd);
+    }
+    if (err)
         throw KSystemError("Cannot duplicate fd "
                            + StringUtil::number2string(oldfd)
                            + " to fd " + StringUtil::number2string(newfd),
-                           errno);
-    close(oldfd);
-    oldfd = -1;
+                           err);
 }
 
 //}}}
@@ -194,9 +240,10 @@ void SubProcessRedirect::finalizeParent()
 }
 
 // -----------------------------------------------------------------------------
-void SubProcessRedirect::finalizeChild(int fd)
+void SubProcessRedirect::finalizeChild(posix_spawn_file_actions_t *actions,
+                                       int fd)
 {
-    _move_fd(m_fd, fd);
+    _move_fd(actions, m_fd, fd);
 }
 
 //}}}
@@ -237,11 +284,11 @@ void ParentToChildPipe::finalizeParent()
 }
 
 // -----------------------------------------------------------------------------
-void ParentToChildPipe::finalizeChild(int fd)
+void ParentToChildPipe::finalizeChild(posix_spawn_file_actions_t *actions,
+                                      int fd)
 {
-    ::close(m_pipefd[1]);
-    m_pipefd[1] = -1;
-    _move_fd(m_pipefd[0], fd);
+    // the write end is O_CLOEXEC, so the child never sees it
+    _move_fd(actions, m_pipefd[0], fd);
 }
 
 //}}}
@@ -255,11 +302,11 @@ void ChildToParentPipe::finalizeParent()
 }
 
 // -----------------------------------------------------------------------------
-void ChildToParentPipe::finalizeChild(int fd)
+void ChildToParentPipe::finalizeChild(posix_spawn_file_actions_t *actions,
+                                      int fd)
 {
-    ::close(m_pipefd[0]);
-    m_pipefd[0] = -1;
-    _move_fd(m_pipefd[1], fd);
+    // the read end is O_CLOEXEC, so the child never sees it
+    _move_fd(actions, m_pipefd[1], fd);
 }
 
 //}}}
@@ -285,21 +332,20 @@ class IStream : public Input {
 
     private:
 	std::istream *m_input;
-	int pollidx;
 	char buf[BUFSIZ], *bufptr, *bufend;
 };
 
 // -----------------------------------------------------------------------------
 void IStream::setupIO(MultiplexIO &io)
 {
-    pollidx = io.add(m_pipe->writeEnd(), POLLOUT);
+    m_pollidx = io.add(m_pipe->writeEnd(), POLLOUT);
 }
 
 // -----------------------------------------------------------------------------
 void IStream::handleEvents(MultiplexIO &io)
 {
     ssize_t cnt;
-    const struct pollfd &poll = io.at(pollidx);
+    const struct pollfd &poll = io.at(m_pollidx);
 
     if (poll.revents & POLLOUT) {
 	// Buffer underflow
@@ -316,12 +362,69 @@ void IStream::handleEvents(MultiplexIO &io)
 	bufptr += cnt;
 
 	if (m_input->eof()) {
+	    io.deactivate(m_pollidx);
             m_pipe->close();
-	    io.deactivate(pollidx);
 	}
     }
 }
 
+//}}}
+//{{{ FDInput ------------------------------------------------------------------
+class FDInput : public Input {
+    public:
+	FDInput(int fd, int src)
+	: Input(fd), m_src(src), m_splice(true)
+	{ }
+
+        virtual void setupIO(MultiplexIO &io);
+        virtual void handleEvents(MultiplexIO &io);
+
+    private:
+	int m_src;
+	bool m_splice;
+};
+
+// -----------------------------------------------------------------------------
+void FDInput::setupIO(MultiplexIO &io)
+{
+    // the pipe to the child is written blocking, like in IStream
+    m_pollidx = io.add(m_src, POLLIN);
+}
+
+// -----------------------------------------------------------------------------
+void FDInput::handleEvents(MultiplexIO &io)
+{
+    const struct pollfd &poll = io.at(m_pollidx);
+    if (!(poll.revents & (POLLIN | POLLHUP | POLLERR)))
+	return;
+
+    ssize_t cnt = -1;
+    if (m_splice) {
+	cnt = splice(m_src, NULL, m_pipe->writeEnd(), NULL, RELAY_CHUNK,
+		     SPLICE_F_MOVE);
+	if (cnt < 0 && errno == EINVAL) {
+	    Debug::debug()->dbg("Cannot splice from fd %d, copying", m_src);
+	    m_splice = false;
+	}
+    }
+    if (!m_splice) {
+	char buf[BUFSIZ];
+	cnt = read(m_src, buf, sizeof buf);
+	if (cnt > 0)
+	    writeAll(m_pipe->writeEnd(), buf, cnt);
+    }
+    if (cnt < 0) {
+	if (errno == EINTR)
+	    return;
+	throw KSystemError("Cannot relay data to input pipe", errno);
+    }
+
+    if (!cnt) {
+	io.deactivate(m_pollidx);
+	m_pipe->close();
+    }
+}
+
 //}}}
 //{{{ Output -------------------------------------------------------------------
 
@@ -346,21 +449,20 @@ class OStream : public Output {
 
     private:
 	std::ostream *m_output;
-	int pollidx;
 	char buf[BUFSIZ];
 };
 
 // -----------------------------------------------------------------------------
 void OStream::setupIO(MultiplexIO &io)
 {
-    pollidx = io.add(m_pipe->readEnd(), POLLIN);
+    m_pollidx = io.add(m_pipe->readEnd(), POLLIN);
 }
 
 // -----------------------------------------------------------------------------
 void OStream::handleEvents(MultiplexIO &io)
 {
     ssize_t cnt;
-    const struct pollfd &poll = io.at(pollidx);
+    const struct pollfd &poll = io.at(m_pollidx);
 
     if (poll.revents & (POLLIN | POLLHUP)) {
         if (poll.revents & POLLIN) {
@@ -371,13 +473,96 @@ void OStream::handleEvents(MultiplexIO &io)
 	    cnt = 0;
 
 	if (!cnt) {
+	    io.deactivate(m_pollidx);
             m_pipe->close();
-	    io.deactivate(pollidx);
 	}
 	m_output->write(buf, cnt);
     }
 }
 
+//}}}
+//{{{ FDOutput -----------------------------------------------------------------
+
+class FDOutput : public Output {
+    public:
+	FDOutput(int fd, int dst)
+	: Output(fd), m_dst(dst), m_splice(true)
+	{ }
+
+        virtual void setupIO(MultiplexIO &io);
+        virtual void handleEvents(MultiplexIO &io);
+
+    private:
+	int m_dst;
+	bool m_splice;
+};
+
+// -----------------------------------------------------------------------------
+void FDOutput::setupIO(MultiplexIO &io)
+{
+    m_pollidx = io.add(m_pipe->readEnd(), POLLIN);
+}
+
+// -----------------------------------------------------------------------------
+void FDOutput::handleEvents(MultiplexIO &io)
+{
+    const struct pollfd &poll = io.at(m_pollidx);
+    if (!(poll.revents & (POLLIN | POLLHUP | POLLERR)))
+	return;
+
+    // splice(2) fails with EINVAL e.g. for O_APPEND files
+    ssize_t cnt = -1;
+    if (m_splice) {
+	cnt = splice(m_pipe->readEnd(), NULL, m_dst, NULL, RELAY_CHUNK,
+		     SPLICE_F_MOVE);
+	if (cnt < 0 && errno == EINVAL) {
+	    Debug::debug()->dbg("Cannot splice to fd %d, copying", m_dst);
+	    m_splice = false;
+	}
+    }
+    if (!m_splice) {
+	char buf[BUFSIZ];
+	cnt = read(m_pipe->readEnd(), buf, sizeof buf);
+	if (cnt > 0)
+	    writeAll(m_dst, buf, cnt);
+    }
+    if (cnt < 0) {
+	if (errno == EINTR)
+	    return;
+	throw KSystemError("Cannot relay data from output pipe", errno);
+    }
+
+    if (!cnt) {
+	io.deactivate(m_pollidx);
+	m_pipe->close();
+    }
+}
+
+//}}}
+//{{{ ProcessFilter::IO --------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+bool ProcessFilter::IO::checkEvents(const MultiplexIO &io,
+				    steady_clock::time_point now)
+{
+    if (m_pollidx < 0 || !io.at(m_pollidx).revents)
+	return false;
+    m_lastActivity = now;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+int ProcessFilter::IO::remaining(const MultiplexIO &io,
+				 steady_clock::time_point now) const
+{
+    if (m_timeout < 0 || m_pollidx < 0 || io.at(m_pollidx).fd < 0)
+	return -1;
+
+    auto idle = std::chrono::duration_cast<std::chrono::milliseconds>(
+	now - m_lastActivity).count();
+    return idle >= m_timeout ? 0 : m_timeout - idle;
+}
+
 //}}}
 //{{{ ProcessFilter ------------------------------------------------------------
 
@@ -401,6 +586,26 @@ void ProcessFilter::setOutput(int fd, ostream *stream)
     setIO(io);
 }
 
+// -----------------------------------------------------------------------------
+void ProcessFilter::setInputFD(int fd, int src)
+{
+    unique_ptr<IO> io(new FDInput(fd, src));
+    setIO(io);
+}
+
+// -----------------------------------------------------------------------------
+void ProcessFilter::setOutputFD(int fd, int dst)
+{
+    unique_ptr<IO> io(new FDOutput(fd, dst));
+    setIO(io);
+}
+
+// -----------------------------------------------------------------------------
+void ProcessFilter::setTimeout(int fd, int timeout)
+{
+    m_iomap.at(fd)->setTimeout(timeout);
+}
+
 // -----------------------------------------------------------------------------
 void ProcessFilter::setStdin(std::istream *stream)
 {
@@ -432,13 +637,31 @@ uint8_t ProcessFilter::execute(const string &name, const StringVector &args)
 
     // initialize multiplex IO
     MultiplexIO io;
-    for (auto &elem : m_iomap)
+    steady_clock::time_point now = steady_clock::now();
+    for (auto &elem : m_iomap) {
         elem.second->setupIO(io);
+        elem.second->startTimer(now);
+    }
 
     while (io.active() > 0) {
-	io.monitor();
-        for (auto &elem : m_iomap)
-            elem.second->handleEvents(io);
+        // wait until the nearest idle timeout
+        int timeout = -1;
+        for (auto &elem : m_iomap) {
+            int left = elem.second->remaining(io, now);
+            if (left >= 0 && (timeout < 0 || left < timeout))
+                timeout = left;
+        }
+
+	io.monitor(timeout);
+        now = steady_clock::now();
+        for (auto &elem : m_iomap) {
+            if (elem.second->checkEvents(io, now))
+                elem.second->handleEvents(io);
+            else if (elem.second->remaining(io, now) == 0)
+                // the SubProcess destructor kills the child
+                throw KError("'" + name + "' timed out on fd " +
+                             StringUtil::number2string(elem.first));
+        }
     }
 
     int status = p.wait();
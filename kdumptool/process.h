@@ -20,8 +20,10 @@
 #define PROCESS_H
 
 #include <stdint.h>
+#include <spawn.h>
 #include <map>
 #include <memory>
+#include <chrono>
 
 #include "global.h"
 #include "optionparser.h"
@@ -41,7 +43,7 @@ class SubProcessFD {
         virtual ~SubProcessFD();
 
         /**
-         * Do all necessary preparations before forking.
+         * Do all necessary preparations before spawning.
          */
         virtual void prepare() = 0;
 
@@ -51,15 +53,19 @@ class SubProcessFD {
         virtual void finalizeParent() = 0;
 
         /**
-         * Finalize the file descriptor in child.
+         * Finalize the file descriptor in child. The child does not run
+         * any code of ours, so this only adds spawn file actions.
          *
+         * @param[in] actions file actions for posix_spawn(3)
          * @param[in] fd file descriptor in child
          */
-        virtual void finalizeChild(int fd) = 0;
+        virtual void finalizeChild(posix_spawn_file_actions_t *actions,
+                                   int fd) = 0;
 
     protected:
 
-        void _move_fd(int& oldfd, int newfd);
+        void _move_fd(posix_spawn_file_actions_t *actions,
+                      int oldfd, int newfd);
 };
 
 //}}}
@@ -77,7 +83,7 @@ class SubProcessRedirect : public SubProcessFD {
 
         void prepare();
         void finalizeParent();
-        void finalizeChild(int fd);
+        void finalizeChild(posix_spawn_file_actions_t *actions, int fd);
 };
 
 //}}}
@@ -130,7 +136,7 @@ class ParentToChildPipe : public SubProcessPipe {
     public:
 
         void finalizeParent();
-        void finalizeChild(int fd);
+        void finalizeChild(posix_spawn_file_actions_t *actions, int fd);
 };
 
 //}}}
@@ -144,7 +150,7 @@ class ChildToParentPipe : public SubProcessPipe {
     public:
 
         void finalizeParent();
-        void finalizeChild(int fd);
+        void finalizeChild(posix_spawn_file_actions_t *actions, int fd);
 };
 
 //}}}
@@ -187,13 +193,16 @@ class SubProcess {
         SubProcessFD const& getChildFD(int fd) const;
 
 	/**
-	 * Spawns a subprocess.
+	 * Spawns a subprocess. posix_spawn(3) is used instead of fork(2),
+	 * so the page tables of a large parent are not copied, which
+	 * matters in a small crash kernel.
 	 *
          * @param[in] name the executable (PATH is searched) of the process
          *            to execute
          * @param[in] args the arguments for the process (argv[0] is used from
          *            @c name, so it cannot be overwritten here). Pass an empty
          *            list if you don't want to provide arguments.
+	 * @exception KSystemError if the program cannot be executed
 	 */
 	void spawn(const std::string &name, const StringVector &args);
 
@@ -321,6 +330,35 @@ class ProcessFilter {
 	void setStdout(std::ostream *stream);
 	void setStderr(std::ostream *stream);
 
+        /**
+         * Relay input to the subprocess from a file descriptor. The data
+         * is moved with splice(2) and does not pass through user space.
+         *
+	 * @param[in] fd file descriptor in child
+         * @param[in] src source file descriptor (not closed)
+         */
+        void setInputFD(int fd, int src);
+
+        /**
+         * Relay output from the subprocess to a file descriptor with
+         * splice(2).
+         *
+	 * @param[in] fd file descriptor in child
+         * @param[in] dst target file descriptor (not closed)
+         */
+        void setOutputFD(int fd, int dst);
+
+        /**
+         * Kill the subprocess if the IO set up for @p fd makes no
+         * progress for @p timeout milliseconds; execute() then throws
+         * a KError. Call this after the IO has been set.
+         *
+	 * @param[in] fd file descriptor in child
+         * @param[in] timeout idle time in milliseconds, or -1 for none
+         * @exception std::out_of_range if no IO is set for @p fd
+         */
+        void setTimeout(int fd, int timeout);
+
     private:
 
         std::map<int, std::unique_ptr<IO>> m_iomap;
@@ -338,7 +376,7 @@ class ProcessFilter::IO {
          * @param[in] pipe subprocess pipe.
 	 */
         IO(int fd, std::shared_ptr<SubProcessPipe> &&pipe)
-            : m_fd(fd), m_pipe(pipe)
+            : m_fd(fd), m_pipe(pipe), m_pollidx(-1), m_timeout(-1)
 	{ }
 
 	/**
@@ -376,6 +414,36 @@ class ProcessFilter::IO {
 	 */
         virtual void handleEvents(MultiplexIO &io) = 0;
 
+	/**
+	 * Set the idle timeout (in milliseconds, -1 for none).
+	 */
+	void setTimeout(int timeout)
+	{ m_timeout = timeout; }
+
+	/**
+	 * Start counting the idle time at @p now.
+	 */
+	void startTimer(std::chrono::steady_clock::time_point now)
+	{ m_lastActivity = now; }
+
+	/**
+	 * Record activity at @p now if the last monitor() returned
+	 * events for this IO.
+	 *
+	 * @return @c true if the IO has events
+	 */
+	bool checkEvents(const MultiplexIO &io,
+			 std::chrono::steady_clock::time_point now);
+
+	/**
+	 * Get the time left until the idle timeout expires.
+	 *
+	 * @return milliseconds (0 if expired), or -1 if there is no
+	 *         timeout or the IO is finished
+	 */
+	int remaining(const MultiplexIO &io,
+		      std::chrono::steady_clock::time_point now) const;
+
     protected:
 	/**
 	 * Desired file descriptor in the child.
@@ -386,6 +454,15 @@ class ProcessFilter::IO {
          * Pipe setup for the child.
          */
         std::shared_ptr<SubProcessPipe> m_pipe;
+
+	/**
+	 * Index in the IO multiplexer, set by setupIO().
+	 */
+	int m_pollidx;
+
+    private:
+	int m_timeout;
+	std::chrono::steady_clock::time_point m_lastActivity;
 };
 
 //}}}
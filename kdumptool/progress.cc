@@ -19,6 +19,7 @@
 #include <iomanip>
 #include <iostream>
 #include <cstdlib>
+#include <cstdio>
 
 #include <unistd.h>
 #include <termios.h>
@@ -30,6 +31,7 @@
 #define NAME_MAXLENGTH 30
 #define DEFAULT_WIDTH  80
 #define DEFAULT_HEIGHT 25
+#define RATE_LENGTH    12
 
 using std::string;
 using std::setw;
@@ -71,13 +73,33 @@ void Terminal::printLine(ostream &os) const
     os.fill(prevfill);
 }
 
+//}}}
+//{{{ Progress -----------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+void Progress::reset()
+    throw ()
+{
+    m_current.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+    m_chunks.store(0, std::memory_order_relaxed);
+}
+
 //}}}
 //{{{ TerminalProgress ---------------------------------------------------------
 
+// -----------------------------------------------------------------------------
+static string formatRate(double rate)
+{
+    char buf[32];
+    snprintf(buf, sizeof buf, "%6.1f MiB/s", rate / (1024 * 1024));
+    return string(buf);
+}
+
 // -----------------------------------------------------------------------------
 TerminalProgress::TerminalProgress(const string &name)
     throw ()
-    : m_term(), m_name(name), m_lastUpdate(0)
+    : m_term(), m_name(name), m_running(false)
 {
     // truncate the name
     if (m_name.size() > NAME_MAXLENGTH) {
@@ -85,35 +107,88 @@ TerminalProgress::TerminalProgress(const string &name)
     }
 
     // subtract 1 for the space between string and bar, 1 for the leading
-    // '|' and 1 for the trailing '|', and one space free, 4 for ...%
-    m_progresslen = m_term.width() - NAME_MAXLENGTH - 8;
+    // '|' and 1 for the trailing '|', and one space free, 4 for ...%,
+    // and the rate with a leading space
+    m_progresslen = m_term.width() - NAME_MAXLENGTH - 8 - RATE_LENGTH - 1;
+}
+
+// -----------------------------------------------------------------------------
+TerminalProgress::~TerminalProgress()
+{
+    stopReporter();
 }
 
 // -----------------------------------------------------------------------------
 void TerminalProgress::start()
     throw ()
 {
+    stopReporter();
+    reset();
+
     clearLine();
     cout << setw(NAME_MAXLENGTH) << left << m_name << " Starting." << flush;
+
+    m_startTime = Clock::now();
+    try {
+        m_running = true;
+        m_reporter = std::thread(&TerminalProgress::run, this);
+    } catch (...) {
+        // no progress display, but the operation can still continue
+        m_running = false;
+    }
 }
 
 // -----------------------------------------------------------------------------
-void TerminalProgress::progressed(unsigned long long current,
-                                  unsigned long long max)
-    throw ()
+void TerminalProgress::run()
+{
+    Clock::time_point last = m_startTime;
+    unsigned long long lastValue = 0;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_cond.wait_for(lock, std::chrono::seconds(1),
+                            [this]{ return !m_running; })) {
+        unsigned long long current = this->current();
+        unsigned long long max = maximum();
+        Clock::time_point now = Clock::now();
+
+        double elapsed = std::chrono::duration<double>(now - last).count();
+        double rate = 0;
+        if (elapsed > 0 && current >= lastValue)
+            rate = (current - lastValue) / elapsed;
+        last = now;
+        lastValue = current;
+
+        if (max == 0) {
+            Debug::debug()->dbg("TerminalProgress::run: max==0");
+            continue;
+        }
+
+        lock.unlock();
+        display(current, max, rate);
+        lock.lock();
+    }
+}
+
+// -----------------------------------------------------------------------------
+void TerminalProgress::stopReporter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_cond.notify_all();
+    if (m_reporter.joinable())
+        m_reporter.join();
+}
+
+// -----------------------------------------------------------------------------
+void TerminalProgress::display(unsigned long long current,
+                               unsigned long long max, double rate)
 {
     int number_of_hashes;
     int number_of_dashes;
     int percent;
 
-    time_t now = time(NULL);
-    if (now <= m_lastUpdate)
-        return;
-    if (current == 0 && max == 0) {
-        Debug::debug()->dbg("TerminalProgress::progressed: current==0 and max==0");
-        return;
-    }
-
     percent = current*100/max;
     number_of_hashes = int(double(current)/max*m_progresslen);
 
@@ -137,15 +212,16 @@ void TerminalProgress::progressed(unsigned long long current,
     for (int i = 0; i < number_of_dashes; i++)
         cout << '-';
     cout << "|";
-    cout << setw(3) << right << percent << '%'  << flush;
-
-    m_lastUpdate = now;
+    cout << setw(3) << right << percent << '%';
+    cout << ' ' << formatRate(rate) << flush;
 }
 
 // -----------------------------------------------------------------------------
 void TerminalProgress::stop(bool success)
     throw ()
 {
+    stopReporter();
+
     const char *finish_msg = success
         ? " Finished."
         : " Failed.";
@@ -154,6 +230,15 @@ void TerminalProgress::stop(bool success)
     if (m_term.isdumb())
         cout << endl;
     cout << setw(NAME_MAXLENGTH) << left << m_name << finish_msg;
+
+    // average rate, if there was enough data to make sense of it
+    double elapsed = std::chrono::duration<double>(
+        Clock::now() - m_startTime).count();
+    if (success && elapsed >= 1) {
+        string rate = formatRate(current() / elapsed);
+        cout << " (average " << rate.substr(rate.find_first_not_of(' '))
+             << ")";
+    }
     cout << endl;
 }
 
@@ -20,7 +20,11 @@
 #define PROGRESS_H
 
 #include <iostream>
-#include <ctime>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 
 #include "global.h"
 
@@ -82,10 +86,21 @@ class Terminal {
 
 /**
  * Interface for a progress meter.
+ *
+ * The data path only updates atomic counters with progressed(); it is up
+ * to the implementation to sample and display them, e.g. from a separate
+ * thread.
  */
 class Progress {
 
     public:
+        /**
+         * Creates a Progress object with zero counters.
+         */
+        Progress()
+            : m_current(0), m_max(0), m_chunks(0)
+        { }
+
         /**
          * Destroys a Progress object.
          */
@@ -103,12 +118,41 @@ class Progress {
          * because that function may be used in file access functions that that
          * can be 64 bit large (on 32 bit systems with Large File Support).
          *
+         * It only stores the values, so it is cheap enough to be called
+         * for every chunk of data, from any thread.
+         *
          * @param[in] current the current progress value
          * @param[in] max the maximum progress value
          */
-        virtual void progressed(unsigned long long current,
-                                unsigned long long max)
-        throw () = 0;
+        void progressed(unsigned long long current,
+                        unsigned long long max)
+        throw ()
+        {
+            m_current.store(current, std::memory_order_relaxed);
+            m_max.store(max, std::memory_order_relaxed);
+            m_chunks.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /**
+         * Returns the last current progress value.
+         */
+        unsigned long long current() const
+        throw ()
+        { return m_current.load(std::memory_order_relaxed); }
+
+        /**
+         * Returns the last maximum progress value.
+         */
+        unsigned long long maximum() const
+        throw ()
+        { return m_max.load(std::memory_order_relaxed); }
+
+        /**
+         * Returns how often progressed() has been called.
+         */
+        unsigned long long chunks() const
+        throw ()
+        { return m_chunks.load(std::memory_order_relaxed); }
 
         /**
          * This method has to be called when the operation is finished.
@@ -118,13 +162,28 @@ class Progress {
          */
         virtual void stop(bool success=true)
         throw () = 0;
+
+    protected:
+        /**
+         * Resets all counters to zero.
+         */
+        void reset()
+        throw ();
+
+    private:
+        std::atomic<unsigned long long> m_current;
+        std::atomic<unsigned long long> m_max;
+        std::atomic<unsigned long long> m_chunks;
 };
 
 //}}}
 //{{{ TerminalProgress ---------------------------------------------------------
 
 /**
- * Retrieve some information about the terminal.
+ * Progress bar on the terminal.
+ *
+ * A reporter thread samples the counters once per second and displays
+ * the percentage with the current and the average transfer rate.
  */
 class TerminalProgress : public Progress {
 
@@ -139,19 +198,15 @@ class TerminalProgress : public Progress {
         throw ();
 
         /**
-         * This method has to be called when the operation starts.
+         * Stops the reporter thread if it is still running.
          */
-        void start()
-        throw ();
+        ~TerminalProgress();
 
         /**
-         * This operation has to be called repeadedly.
-         *
-         * @param[in] current the current progress value
-         * @param[in] max the maximum progress value
+         * This method has to be called when the operation starts.
+         * It starts the reporter thread.
          */
-        void progressed(unsigned long long current,
-                        unsigned long long max)
+        void start()
         throw ();
 
         /**
@@ -170,10 +225,21 @@ class TerminalProgress : public Progress {
         Terminal m_term;
 
     private:
+        typedef std::chrono::steady_clock Clock;
+
+        void run();
+        void stopReporter();
+        void display(unsigned long long current, unsigned long long max,
+                     double rate);
+
         std::string m_name;
-        int m_linelen;
         int m_progresslen;
-        time_t m_lastUpdate;
+        Clock::time_point m_startTime;
+
+        bool m_running;
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::thread m_reporter;
 };
 
 //}}}
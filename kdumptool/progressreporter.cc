@@ -0,0 +1,399 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <syslog.h>
+#include <sys/socket.h>
+
+#include <curl/curl.h>
+
+#include "global.h"
+#include "debug.h"
+#include "progressreporter.h"
+#include "socket.h"
+#include "stringutil.h"
+#include "stringvector.h"
+
+using std::string;
+using std::cout;
+using std::endl;
+
+#define ROLLING_WINDOW      60          // seconds
+#define DEFAULT_INTERVAL    10000       // milliseconds
+#define HTTP_TIMEOUT        2000        // milliseconds
+#define KMSG_DEVICE         "/dev/kmsg"
+
+//{{{ Sinks --------------------------------------------------------------------
+
+/**
+ * Prints the report on standard output.
+ */
+class ConsoleSink : public ProgressReporter::Sink {
+    public:
+        void publish(const ProgressReporter &reporter,
+                     const ProgressReporter::Sample &sample)
+        { cout << reporter.text(sample) << endl; }
+};
+
+/**
+ * Sends the report to syslog, i.e. to the journal of the kdump
+ * environment.
+ */
+class SyslogSink : public ProgressReporter::Sink {
+    public:
+        void publish(const ProgressReporter &reporter,
+                     const ProgressReporter::Sample &sample)
+        { syslog(LOG_INFO, "%s", reporter.text(sample).c_str()); }
+};
+
+/**
+ * Writes the report to the kernel log, which reaches netconsole and the
+ * serial console.
+ */
+class KmsgSink : public ProgressReporter::Sink {
+    public:
+        KmsgSink()
+            : m_fd(open(KMSG_DEVICE, O_WRONLY | O_CLOEXEC))
+        {
+            if (m_fd < 0)
+                throw KSystemError("Cannot open " KMSG_DEVICE, errno);
+        }
+
+        ~KmsgSink()
+        { close(m_fd); }
+
+        void publish(const ProgressReporter &reporter,
+                     const ProgressReporter::Sample &sample)
+        {
+            // one write is one record, LOG_NOTICE passes "quiet"
+            string msg = "<5>kdump: " + reporter.text(sample) + "\n";
+            if (write(m_fd, msg.data(), msg.size()) < 0)
+                KDBG("Cannot write to " KMSG_DEVICE ": %s", strerror(errno));
+        }
+
+    private:
+        int m_fd;
+};
+
+/**
+ * Sends the report as a JSON datagram.
+ */
+class UdpSink : public ProgressReporter::Sink {
+    public:
+        /**
+         * @param[in] address "host:port" or "[v6 address]:port"
+         */
+        UdpSink(const string &address)
+        {
+            string::size_type colon = address.rfind(':');
+            if (colon == string::npos || colon + 1 == address.size())
+                throw KError("No port in udp://" + address);
+            string host = address.substr(0, colon);
+            if (host.size() > 2 && host[0] == '[' &&
+                host[host.size() - 1] == ']')
+                host = host.substr(1, host.size() - 2);
+            m_socket.reset(new Socket(host, address.substr(colon + 1),
+                                      Socket::ST_UDP));
+            m_socket->connect();
+        }
+
+        void publish(const ProgressReporter &reporter,
+                     const ProgressReporter::Sample &sample)
+        {
+            string msg = reporter.json(sample);
+            if (send(m_socket->getCurrentFd(), msg.data(), msg.size(),
+                     MSG_DONTWAIT) < 0)
+                KDBG("Cannot send the progress: %s", strerror(errno));
+        }
+
+    private:
+        std::unique_ptr<Socket> m_socket;
+};
+
+/**
+ * POSTs the report as JSON. A slow collector delays the next report,
+ * but never by more than HTTP_TIMEOUT.
+ */
+class HttpSink : public ProgressReporter::Sink {
+    public:
+        HttpSink(const string &url)
+            : m_url(url), m_headers(NULL)
+        {
+            if (curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK)
+                throw KError("curl_global_init() failed.");
+            m_headers = curl_slist_append(NULL,
+                                          "Content-Type: application/json");
+        }
+
+        ~HttpSink()
+        {
+            curl_slist_free_all(m_headers);
+            curl_global_cleanup();
+        }
+
+        void publish(const ProgressReporter &reporter,
+                     const ProgressReporter::Sample &sample)
+        {
+            string msg = reporter.json(sample);
+            CURL *curl = curl_easy_init();
+            if (!curl)
+                return;
+            curl_easy_setopt(curl, CURLOPT_URL, m_url.c_str());
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, m_headers);
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, msg.c_str());
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, long(msg.size()));
+            curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, long(HTTP_TIMEOUT));
+            curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+            CURLcode err = curl_easy_perform(curl);
+            if (err != CURLE_OK)
+                KDBG("Cannot post the progress to %s: %s", m_url.c_str(),
+                     curl_easy_strerror(err));
+            curl_easy_cleanup(curl);
+        }
+
+    private:
+        string m_url;
+        struct curl_slist *m_headers;
+};
+
+//}}}
+//{{{ ProgressReporter ---------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+ProgressReporter::ProgressReporter(const string &name, const string &host)
+    : m_name(name), m_host(host),
+      m_interval(std::chrono::milliseconds(DEFAULT_INTERVAL)), m_total(0),
+      m_state("running"), m_running(false), m_stopped(true)
+{}
+
+// -----------------------------------------------------------------------------
+ProgressReporter::~ProgressReporter()
+{
+    if (!m_stopped)
+        stop(false);
+}
+
+// -----------------------------------------------------------------------------
+void ProgressReporter::addSinks(const string &spec)
+{
+    KString list(spec);
+    StringVector names = list.split(' ');
+    StringVector::const_iterator it;
+    for (it = names.begin(); it != names.end(); ++it) {
+        if (it->empty())
+            continue;
+        KString name(*it);
+        if (name == "console")
+            addSink(new ConsoleSink());
+        else if (name == "syslog")
+            addSink(new SyslogSink());
+        else if (name == "kmsg")
+            addSink(new KmsgSink());
+        else if (name.startsWith("udp://"))
+            addSink(new UdpSink(name.substr(6)));
+        else if (name.startsWith("http://") || name.startsWith("https://"))
+            addSink(new HttpSink(name));
+        else
+            throw KError("Unknown progress report: " + name);
+    }
+}
+
+// -----------------------------------------------------------------------------
+void ProgressReporter::addSink(Sink *sink)
+{
+    m_sinks.push_back(std::unique_ptr<Sink>(sink));
+}
+
+// -----------------------------------------------------------------------------
+void ProgressReporter::start(ByteCounter bytes)
+{
+    stopThread();
+
+    m_bytes = bytes;
+    m_window.clear();
+    m_state = "running";
+    m_startTime = Clock::now();
+    m_stopped = false;
+    try {
+        m_running = true;
+        m_reporter = std::thread(&ProgressReporter::run, this);
+    } catch (...) {
+        // no reports, but the operation can still continue
+        m_running = false;
+    }
+}
+
+// -----------------------------------------------------------------------------
+void ProgressReporter::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_cond.wait_for(lock, m_interval,
+                            [this]{ return !m_running; })) {
+        lock.unlock();
+        publish(sample());
+        lock.lock();
+    }
+}
+
+// -----------------------------------------------------------------------------
+void ProgressReporter::stopThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_cond.notify_all();
+    if (m_reporter.joinable())
+        m_reporter.join();
+}
+
+// -----------------------------------------------------------------------------
+void ProgressReporter::stop(bool success)
+{
+    stopThread();
+    if (m_stopped)
+        return;
+    m_stopped = true;
+
+    m_state = success ? "done" : "failed";
+    Sample last = sample();
+    if (success) {
+        last.permille = 1000;
+        last.eta = 0;
+    }
+    publish(last);
+}
+
+// -----------------------------------------------------------------------------
+void ProgressReporter::publish(const Sample &sample)
+{
+    std::vector<std::unique_ptr<Sink> >::iterator it;
+    for (it = m_sinks.begin(); it != m_sinks.end(); ++it) {
+        try {
+            (*it)->publish(*this, sample);
+        } catch (const std::exception &e) {
+            KDBG("Cannot publish the progress: %s", e.what());
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+ProgressReporter::Sample ProgressReporter::sample()
+{
+    Point now;
+    now.time = Clock::now();
+    now.bytes = m_bytes ? m_bytes() : 0;
+    now.permille = m_permille ? m_permille() : -1;
+
+    // keep one point older than the window, so that it is always covered
+    while (m_window.size() > 1 && now.time - m_window[1].time >=
+           std::chrono::seconds(ROLLING_WINDOW))
+        m_window.pop_front();
+
+    Sample ret;
+    ret.elapsed = std::chrono::duration<double>(
+        now.time - m_startTime).count();
+    ret.bytes = now.bytes;
+    ret.permille = now.permille;
+    ret.rate = 0;
+    ret.eta = -1;
+    ret.state = m_state;
+
+    // before the first sample, the window starts at zero
+    Point first = { m_startTime, 0, -1 };
+    if (!m_window.empty())
+        first = m_window.front();
+    double dt = std::chrono::duration<double>(now.time - first.time).count();
+    if (dt > 0 && now.bytes >= first.bytes)
+        ret.rate = (now.bytes - first.bytes) / dt;
+
+    // the progress of makedumpfile counts the pages, not the output,
+    // so it is better than any size estimate
+    if (now.permille >= 0 && first.permille >= 0 &&
+        now.permille > first.permille && dt > 0)
+        ret.eta = long((1000 - now.permille) * dt /
+                       (now.permille - first.permille) + 0.5);
+    else if (m_total > now.bytes && ret.rate > 0)
+        ret.eta = long((m_total - now.bytes) / ret.rate + 0.5);
+    if (ret.permille < 0 && m_total > 0)
+        ret.permille = std::min(now.bytes * 1000 / m_total, 999ULL);
+
+    m_window.push_back(now);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+static string formatDuration(long seconds)
+{
+    char buf[32];
+    snprintf(buf, sizeof buf, "%ld:%02ld:%02ld", seconds / 3600,
+             seconds / 60 % 60, seconds % 60);
+    return buf;
+}
+
+// -----------------------------------------------------------------------------
+string ProgressReporter::text(const Sample &sample) const
+{
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    ss << m_name << ": " << sample.bytes / 1048576.0 << " MiB";
+    if (sample.state != string("running")) {
+        ss << " in " << formatDuration(long(sample.elapsed)) << ", "
+           << sample.state;
+        return ss.str();
+    }
+    ss << ", " << sample.rate / 1048576.0 << " MiB/s";
+    if (sample.permille >= 0)
+        ss << ", " << sample.permille / 10.0 << "%";
+    if (sample.eta >= 0)
+        ss << ", ETA " << formatDuration(sample.eta);
+    return ss.str();
+}
+
+// -----------------------------------------------------------------------------
+string ProgressReporter::json(const Sample &sample) const
+{
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    ss << "{\"host\": " << StringUtil::jsonString(m_host)
+       << ", \"name\": " << StringUtil::jsonString(m_name)
+       << ", \"state\": \"" << sample.state << "\""
+       << ", \"elapsed\": " << sample.elapsed
+       << ", \"bytes\": " << sample.bytes
+       << ", \"rate\": " << sample.rate;
+    if (sample.permille >= 0)
+        ss << ", \"percent\": " << sample.permille / 10.0;
+    if (sample.eta >= 0)
+        ss << ", \"eta\": " << sample.eta;
+    if (m_total)
+        ss << ", \"total\": " << m_total;
+    ss << "}";
+    return ss.str();
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef PROGRESSREPORTER_H
+#define PROGRESSREPORTER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include "global.h"
+
+//{{{ ProgressReporter ---------------------------------------------------------
+
+/**
+ * Publishes the throughput and the expected remaining time of a long
+ * operation (i.e. saving the dump) at a fixed interval.
+ *
+ * Unlike TerminalProgress, it does not need the total size: the bytes
+ * are sampled from a counter, the rate is averaged over the last
+ * ROLLING_WINDOW seconds, and the ETA comes from the progress of
+ * makedumpfile (in per mille, see setPermille()) or, failing that, from
+ * the expected size (see setTotal()).
+ *
+ * The reports go to any number of sinks. A sink must not throw; a report
+ * that cannot be delivered is lost.
+ */
+class ProgressReporter {
+
+    public:
+        typedef std::chrono::steady_clock Clock;
+        typedef std::function<unsigned long long()> ByteCounter;
+        typedef std::function<int()> PermilleCounter;
+
+        /**
+         * One report.
+         */
+        struct Sample {
+            double elapsed;             // seconds since start()
+            unsigned long long bytes;   // bytes so far
+            double rate;                // bytes per second, rolling
+            int permille;               // progress, -1 if unknown
+            long eta;                   // seconds left, -1 if unknown
+            const char *state;          // "running", "done" or "failed"
+        };
+
+        /**
+         * Receiver of the reports.
+         */
+        class Sink {
+            public:
+                virtual ~Sink() {}
+
+                /**
+                 * Delivers a report. Called from the reporter thread,
+                 * except for the last report.
+                 */
+                virtual void publish(const ProgressReporter &reporter,
+                                     const Sample &sample) = 0;
+        };
+
+        /**
+         * Creates a reporter without sinks.
+         *
+         * @param[in] name what is reported, e.g. "Saving dump"
+         * @param[in] host the name of this host for the remote sinks
+         */
+        ProgressReporter(const std::string &name, const std::string &host);
+
+        /**
+         * Stops the reporter thread. If stop() has not been called, the
+         * last report says that the operation has failed.
+         */
+        ~ProgressReporter();
+
+        /**
+         * Adds the sinks of a KDUMP_PROGRESS_REPORT value: a list of
+         * "console", "syslog", "kmsg", "udp://host:port" and http(s) URLs,
+         * separated by spaces.
+         *
+         * @exception KError if a sink is unknown or cannot be created
+         */
+        void addSinks(const std::string &spec);
+
+        /**
+         * Adds a sink. The reporter deletes it.
+         */
+        void addSink(Sink *sink);
+
+        /**
+         * Returns @c true if there are no sinks.
+         */
+        bool empty() const
+        { return m_sinks.empty(); }
+
+        /**
+         * Sets the time between two reports (default 10 seconds).
+         */
+        void setInterval(std::chrono::milliseconds interval)
+        { m_interval = interval; }
+
+        /**
+         * Sets the expected number of bytes, 0 if unknown.
+         */
+        void setTotal(unsigned long long total)
+        { m_total = total; }
+
+        /**
+         * Sets the function that returns the progress in per mille, or
+         * -1 if it is not known (yet).
+         */
+        void setPermille(PermilleCounter permille)
+        { m_permille = permille; }
+
+        /**
+         * Starts the reporter thread.
+         *
+         * @param[in] bytes returns the number of bytes so far; it is
+         *            called from the reporter thread
+         */
+        void start(ByteCounter bytes);
+
+        /**
+         * Stops the reporter thread and sends the last report.
+         *
+         * @param[in] success @c true if the operation has succeeded
+         */
+        void stop(bool success = true);
+
+        /**
+         * Takes a sample. The ETA needs two samples at least.
+         */
+        Sample sample();
+
+        /**
+         * Formats a sample for humans, e.g.
+         * "Saving dump: 1024.0 MiB, 85.3 MiB/s, 42.5%, ETA 0:01:12".
+         */
+        std::string text(const Sample &sample) const;
+
+        /**
+         * Formats a sample as a JSON object on a single line.
+         */
+        std::string json(const Sample &sample) const;
+
+        /**
+         * Returns the name given in the constructor.
+         */
+        const std::string &name() const
+        { return m_name; }
+
+    private:
+        struct Point {
+            Clock::time_point time;
+            unsigned long long bytes;
+            int permille;
+        };
+
+        ProgressReporter(const ProgressReporter &);
+        ProgressReporter &operator=(const ProgressReporter &);
+
+        void run();
+        void stopThread();
+        void publish(const Sample &sample);
+
+        std::string m_name;
+        std::string m_host;
+        std::vector<std::unique_ptr<Sink> > m_sinks;
+        std::chrono::milliseconds m_interval;
+        unsigned long long m_total;
+        PermilleCounter m_permille;
+        ByteCounter m_bytes;
+
+        Clock::time_point m_startTime;
+        std::deque<Point> m_window;
+        const char *m_state;
+
+        bool m_running;
+        bool m_stopped;
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::thread m_reporter;
+};
+
+//}}}
+
+#endif /* PROGRESSREPORTER_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
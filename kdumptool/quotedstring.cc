@@ -67,4 +67,62 @@ string ShellQuotedString::quoted(void) const
     return ret;
 }
 
+// -----------------------------------------------------------------------------
+static bool is_shell_blank(const char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+// -----------------------------------------------------------------------------
+bool ShellQuotedString::unquote(const string &text, string &result)
+{
+    string ret;
+    string::size_type i = 0;
+    while (i < text.size() && !is_shell_blank(text[i])) {
+        char c = text[i++];
+        if (c == '\'') {
+            string::size_type end = text.find('\'', i);
+            if (end == string::npos)
+                return false;
+            ret.append(text, i, end - i);
+            i = end + 1;
+        } else if (c == '"') {
+            while (true) {
+                if (i >= text.size())
+                    return false;
+                c = text[i++];
+                if (c == '"')
+                    break;
+                if (c == '$' || c == '`')
+                    return false;
+                if (c == '\\') {
+                    if (i >= text.size())
+                        return false;
+                    c = text[i++];
+                    if (c != '$' && c != '`' && c != '"' && c != '\\')
+                        ret.push_back('\\');
+                }
+                ret.push_back(c);
+            }
+        } else if (c == '\\') {
+            if (i >= text.size())
+                return false;
+            ret.push_back(text[i++]);
+        } else if (is_shell_safe(c) || c == '-' || c == '+' ||
+                   c == '=' || c == '%' || c == '^') {
+            ret.push_back(c);
+        } else
+            return false;
+    }
+
+    // only a comment may follow
+    while (i < text.size() && is_shell_blank(text[i]))
+        ++i;
+    if (i < text.size() && text[i] != '#')
+        return false;
+
+    result.swap(ret);
+    return true;
+}
+
 //}}}
@@ -103,6 +103,19 @@ class ShellQuotedString : public QuotedString {
         { }
 
         virtual std::string quoted(void) const;
+
+        /**
+         * Parses a shell word which uses only quoting, i.e. no
+         * expansions, command substitutions or globs. This is the
+         * reverse of quoted(). The word may be followed by white space
+         * and a comment.
+         *
+         * @param[in] text the word
+         * @param[out] result the value of the word
+         * @return @c true on success, @c false if the text can only be
+         *         evaluated by a shell
+         */
+        static bool unquote(const std::string &text, std::string &result);
 };
 
 //}}}
@@ -0,0 +1,524 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+
+#include "global.h"
+#include "debug.h"
+#include "configuration.h"
+#include "rootdirurl.h"
+#include "fileutil.h"
+#include "stringutil.h"
+#include "spaceguard.h"
+#include "savestats.h"
+#include "progress.h"
+#include "rawdump.h"
+
+using std::string;
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// -----------------------------------------------------------------------------
+static unsigned long long alignUp(unsigned long long value)
+{
+    return (value + RAW_BLOCK - 1) / RAW_BLOCK * RAW_BLOCK;
+}
+
+//{{{ RawIndex -----------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+string RawIndex::format() const
+{
+    std::ostringstream ss;
+    ss << RAW_MAGIC << '\n';
+    if (!dump.empty())
+        ss << "dump " << dump << '\n';
+    std::vector<Entry>::const_iterator it;
+    for (it = files.begin(); it != files.end(); ++it)
+        ss << (it->partial ? "partial " : "file ") << it->offset << ' '
+           << it->size << ' ' << it->name << '\n';
+
+    string ret = ss.str();
+    if (ret.size() >= RAW_BLOCK)
+        throw KError("The raw dump index is full.");
+    ret.resize(RAW_BLOCK, '\0');
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+bool RawIndex::parse(const char *block, size_t len)
+{
+    string text(block, strnlen(block, len));
+    std::istringstream iss(text);
+    string line;
+    if (!getline(iss, line) || line != RAW_MAGIC)
+        return false;
+
+    dump.clear();
+    files.clear();
+    while (getline(iss, line)) {
+        std::istringstream ls(line);
+        string key;
+        ls >> key;
+        if (key == "dump")
+            ls >> dump;
+        else if (key == "file" || key == "partial") {
+            Entry entry;
+            entry.partial = key == "partial";
+            if (ls >> entry.offset >> entry.size >> entry.name)
+                files.push_back(entry);
+        }
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long RawIndex::end() const
+{
+    if (files.empty())
+        return RAW_BLOCK;
+    const Entry &last = files.back();
+    return alignUp(last.offset + last.size);
+}
+
+//}}}
+//{{{ RawTransfer --------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+RawTransfer::RawTransfer(const RootDirURLVector &urlv)
+    : URLTransfer(urlv), m_fd(-1), m_direct(true), m_capacity(0)
+{
+    if (urlv.size() > 1)
+        cerr << "WARNING: First raw target used; rest ignored." << endl;
+
+    FilePath path = urlv.front().getPath();
+    m_device = path.dirName();
+    m_index.dump = path.baseName();
+    KDBG("Saving %s to raw device %s", m_index.dump.c_str(),
+         m_device.c_str());
+
+    // persistent memory is written through a mapping
+    m_pmem.reset(PmemRegion::open(m_device, true));
+    if (m_pmem) {
+        m_capacity = m_pmem->size() / RAW_BLOCK * RAW_BLOCK;
+    } else {
+        // the device is never created, a typo must not end up in /dev
+        m_fd = ::open(m_device.c_str(), O_WRONLY | O_DIRECT | O_CLOEXEC);
+        if (m_fd < 0 && errno == EINVAL) {
+            KDBG("%s does not support O_DIRECT", m_device.c_str());
+            m_direct = false;
+            m_fd = ::open(m_device.c_str(), O_WRONLY | O_CLOEXEC);
+        }
+        if (m_fd < 0)
+            throw KSystemError("Cannot open " + m_device + ".", errno);
+
+        struct stat mystat;
+        if (fstat(m_fd, &mystat) == 0 && S_ISBLK(mystat.st_mode)) {
+            uint64_t size;
+            if (ioctl(m_fd, BLKGETSIZE64, &size) == 0)
+                m_capacity = size / RAW_BLOCK * RAW_BLOCK;
+        }
+    }
+    KDBG("Raw device capacity: %llu bytes", m_capacity);
+
+    // whole pages are aligned to RAW_BLOCK
+    try {
+        m_buffer = BufferPool::pool()->get(RAW_BUFFER_SIZE);
+    } catch (...) {
+        if (m_fd >= 0)
+            ::close(m_fd);
+        throw;
+    }
+
+    // the previous dump is gone from here on
+    try {
+        writeIndex();
+    } catch (...) {
+        if (m_fd >= 0)
+            ::close(m_fd);
+        throw;
+    }
+}
+
+// -----------------------------------------------------------------------------
+RawTransfer::~RawTransfer()
+{
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+// -----------------------------------------------------------------------------
+void RawTransfer::perform(DataProvider *dataprovider,
+                          const StringVector &target_files,
+                          bool *directSave)
+{
+    KTRACE("RawTransfer::perform(%p, [ \"%s\"%s ])",
+        dataprovider, target_files.front().c_str(),
+        target_files.size() > 1 ? ", ..." : "");
+
+    if (target_files.size() > 1)
+        cerr << "WARNING: First dump target used; rest ignored." << endl;
+    if (directSave)
+        *directSave = false;
+
+    RawIndex::Entry entry;
+    entry.name = target_files.front();
+    entry.offset = m_index.end();
+    entry.size = 0;
+    entry.partial = false;
+
+    TransferMeter meter("raw", m_device);
+    bool prepared = false;
+    size_t fill = 0;
+    try {
+        dataprovider->prepare();
+        prepared = true;
+
+        bool map = dataprovider->canMapData();
+        for (;;) {
+            size_t read_data = meter.source([&]() -> size_t {
+                    if (!map)
+                        return dataprovider->getData(m_buffer.get() + fill,
+                                                     RAW_BUFFER_SIZE - fill);
+                    const char *data;
+                    size_t ret = dataprovider->mapData(
+                        &data, RAW_BUFFER_SIZE - fill);
+                    memcpy(m_buffer.get() + fill, data, ret);
+                    return ret;
+                });
+            if (read_data == 0)
+                break;
+            meter.moved(read_data);
+            fill += read_data;
+            entry.size += read_data;
+
+            if (fill == RAW_BUFFER_SIZE) {
+                meter.sink([&]() {
+                        writeBuffer(entry.offset + entry.size - fill, fill);
+                    });
+                fill = 0;
+            }
+        }
+        if (fill)
+            meter.sink([&]() {
+                    writeBuffer(entry.offset + entry.size - fill, fill);
+                });
+        m_index.files.push_back(entry);
+        writeIndex();
+    } catch (const KNoSpaceError &error) {
+        if (prepared) {
+            dataprovider->setError(true);
+            dataprovider->finish();
+        }
+
+        // keep what fits, the dump may be saved with TRUNCATE
+        entry.size = std::min(entry.size, error.written() - entry.offset);
+        entry.partial = true;
+        m_index.files.push_back(entry);
+        writeIndex();
+        throw KNoSpaceError(entry.name, entry.size);
+    } catch (...) {
+        if (prepared) {
+            dataprovider->setError(true);
+            dataprovider->finish();
+        }
+        throw;
+    }
+
+    dataprovider->finish();
+}
+
+// -----------------------------------------------------------------------------
+void RawTransfer::writeBuffer(unsigned long long offset, size_t len)
+{
+    size_t padded = alignUp(len);
+    memset(m_buffer.get() + len, 0, padded - len);
+
+    bool full = false;
+    if (m_capacity && offset + padded > m_capacity) {
+        cerr << "The raw device " << m_device << " is full." << endl;
+        padded = offset < m_capacity ? m_capacity - offset : 0;
+        full = true;
+    }
+
+    const char *data = m_buffer.get();
+    if (m_pmem) {
+        m_pmem->write(offset, data, padded);
+        offset += padded;
+        padded = 0;
+    }
+    while (padded) {
+        ssize_t ret = pwrite(m_fd, data, padded, offset);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret < 0)
+            throw KSystemError("RawTransfer: pwrite() failed at " +
+                StringUtil::number2string(offset) + ".", errno);
+        data += ret;
+        padded -= ret;
+        offset += ret;
+    }
+
+    if (full)
+        throw KNoSpaceError(m_device, offset);
+}
+
+// -----------------------------------------------------------------------------
+void RawTransfer::writeIndex()
+{
+    // the index must not refer to data that is not on the disk yet
+    if (m_pmem) {
+        m_pmem->persist();
+        m_pmem->write(0, m_index.format().data(), RAW_BLOCK);
+        m_pmem->persist();
+        return;
+    }
+    if (fdatasync(m_fd) != 0)
+        throw KSystemError("Cannot flush " + m_device + ".", errno);
+
+    string block = m_index.format();
+    char *aligned;
+    if (posix_memalign((void **)&aligned, RAW_BLOCK, RAW_BLOCK))
+        throw KError("Cannot allocate the raw index block.");
+    memcpy(aligned, block.data(), RAW_BLOCK);
+    ssize_t ret;
+    do {
+        ret = pwrite(m_fd, aligned, RAW_BLOCK, 0);
+    } while (ret < 0 && errno == EINTR);
+    int err = errno;
+    free(aligned);
+    if (ret != RAW_BLOCK)
+        throw KSystemError("Cannot write the index of " + m_device + ".",
+                           ret < 0 ? err : EIO);
+
+    if (fdatasync(m_fd) != 0)
+        throw KSystemError("Cannot flush " + m_device + ".", errno);
+}
+
+//}}}
+//{{{ RawEntryDataProvider -----------------------------------------------------
+
+// -----------------------------------------------------------------------------
+void RawEntryDataProvider::prepare()
+{
+    m_pos = 0;
+    AbstractDataProvider::prepare();
+}
+
+// -----------------------------------------------------------------------------
+size_t RawEntryDataProvider::getData(char *buffer, size_t maxread)
+{
+    unsigned long long left = m_entry.size - m_pos;
+    if (maxread > left)
+        maxread = left;
+    if (maxread == 0)
+        return 0;
+
+    if (m_region) {
+        const char *data;
+        size_t ret = mapData(&data, maxread);
+        memcpy(buffer, data, ret);
+        return ret;
+    }
+
+    ssize_t len;
+    do {
+        len = pread(m_fd, buffer, maxread, m_entry.offset + m_pos);
+    } while (len < 0 && errno == EINTR);
+    if (len < 0) {
+        setError(true);
+        throw KSystemError("Error reading " + m_entry.name + " at " +
+            StringUtil::number2hex(m_pos), errno);
+    }
+    if (len == 0)
+        throw KError("The raw device ends within " + m_entry.name + ".");
+    m_pos += len;
+
+    Progress *p = getProgress();
+    if (p)
+        p->progressed(m_pos, m_entry.size);
+
+    return len;
+}
+
+// -----------------------------------------------------------------------------
+bool RawEntryDataProvider::canMapData() const
+{
+    return m_region != NULL;
+}
+
+// -----------------------------------------------------------------------------
+size_t RawEntryDataProvider::mapData(const char **data, size_t maxread)
+{
+    if (!m_region)
+        return AbstractDataProvider::mapData(data, maxread);
+
+    unsigned long long left = m_entry.size - m_pos;
+    if (maxread > left)
+        maxread = left;
+    if (m_entry.offset + m_entry.size > m_region->size())
+        throw KError("The raw device ends within " + m_entry.name + ".");
+
+    *data = m_region->data() + m_entry.offset + m_pos;
+    m_pos += maxread;
+
+    Progress *p = getProgress();
+    if (p)
+        p->progressed(m_pos, m_entry.size);
+
+    return maxread;
+}
+
+//}}}
+//{{{ ExtractRaw ---------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+ExtractRaw::ExtractRaw()
+    : m_dir("/var/crash"), m_keep(false)
+{
+    Debug::debug()->trace("ExtractRaw::ExtractRaw()");
+
+    m_options.push_back(new StringOption("root", 'R', &m_rootdir,
+        "Use the specified root directory instead of /"));
+    m_options.push_back(new StringOption("device", 'D', &m_device,
+        "Extract from the specified device instead of KDUMP_SAVEDIR"));
+    m_options.push_back(new StringOption("dir", 'd', &m_dir,
+        "Save the dumps below the specified directory"));
+    m_options.push_back(new FlagOption("keep", 'k', &m_keep,
+        "Keep the dump on the device"));
+}
+
+// -----------------------------------------------------------------------------
+const char *ExtractRaw::getName() const
+{
+    return "extract_raw";
+}
+
+// -----------------------------------------------------------------------------
+void ExtractRaw::execute()
+{
+    Debug::debug()->trace("ExtractRaw::execute()");
+
+    if (!m_device.empty()) {
+        extract(m_device);
+        return;
+    }
+
+    Configuration *config = Configuration::config();
+    std::istringstream iss(config->KDUMP_SAVEDIR.value());
+    string elem;
+    while (iss >> elem) {
+        RootDirURL url(elem, m_rootdir);
+        if (url.getProtocol() == URLParser::PROT_RAW)
+            extract(url.getPath());
+    }
+}
+
+// -----------------------------------------------------------------------------
+void ExtractRaw::extract(const string &device)
+{
+    Debug::debug()->trace("ExtractRaw::extract(%s)", device.c_str());
+
+    // persistent memory cannot be read with pread()
+    std::unique_ptr<PmemRegion> pmem(PmemRegion::open(device, !m_keep));
+    int fd = -1;
+    if (!pmem) {
+        fd = ::open(device.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            throw KSystemError("Cannot open " + device + ".", errno);
+    }
+
+    try {
+        char block[RAW_BLOCK];
+        RawIndex index;
+        ssize_t len;
+        if (pmem) {
+            len = std::min<unsigned long long>(sizeof block, pmem->size());
+            memcpy(block, pmem->data(), len);
+        } else if ((len = pread(fd, block, sizeof block, 0)) < 0)
+            throw KSystemError("Cannot read " + device + ".", errno);
+        if (!index.parse(block, len) || index.files.empty()) {
+            Debug::debug()->dbg("No dump on %s", device.c_str());
+            if (fd >= 0)
+                ::close(fd);
+            return;
+        }
+
+        FilePath dir = RootDirURL(m_dir, m_rootdir).getRealPath();
+        dir.appendPath(index.dump);
+        cout << "Extracting the dump on " << device << " to " << dir << endl;
+
+        FileTransfer transfer(RootDirURLVector(1, RootDirURL(dir, "")));
+        std::vector<RawIndex::Entry>::const_iterator it;
+        for (it = index.files.begin(); it != index.files.end(); ++it) {
+            if (it->partial)
+                cout << "WARNING: " << it->name << " is incomplete." << endl;
+            std::unique_ptr<RawEntryDataProvider> provider(pmem ?
+                new RawEntryDataProvider(pmem.get(), *it) :
+                new RawEntryDataProvider(fd, *it));
+            transfer.perform(provider.get(), StringVector(1, it->name), NULL);
+        }
+    } catch (...) {
+        if (fd >= 0)
+            ::close(fd);
+        throw;
+    }
+    if (fd >= 0)
+        ::close(fd);
+
+    if (m_keep)
+        return;
+
+    // an empty index, so that the dump is not extracted again
+    string block = RawIndex().format();
+    if (pmem) {
+        pmem->write(0, block.data(), block.size());
+        pmem->persist();
+        return;
+    }
+    fd = ::open(device.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw KSystemError("Cannot open " + device + ".", errno);
+    ssize_t ret = pwrite(fd, block.data(), block.size(), 0);
+    int err = errno;
+    if (ret == (ssize_t)block.size() && fsync(fd) != 0) {
+        err = errno;
+        ret = -1;
+    }
+    ::close(fd);
+    if (ret != (ssize_t)block.size())
+        throw KSystemError("Cannot clear the index of " + device + ".",
+                           ret < 0 ? err : EIO);
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
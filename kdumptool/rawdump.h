@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef RAWDUMP_H
+#define RAWDUMP_H
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "global.h"
+#include "subcommand.h"
+#include "transfer.h"
+#include "dataprovider.h"
+#include "pmem.h"
+
+// the index block at the start of the device
+#define RAW_MAGIC           "KDUMP-RAW 1"
+#define RAW_BLOCK           4096
+
+// size of the O_DIRECT write buffer
+#define RAW_BUFFER_SIZE     (1024*1024)
+
+//{{{ RawIndex -----------------------------------------------------------------
+
+/**
+ * The index of a raw dump device (see RawTransfer).
+ *
+ * The first RAW_BLOCK bytes of the device hold a text index, padded
+ * with zeros:
+ *
+ *   KDUMP-RAW 1
+ *   dump <name>                        the dump directory name
+ *   file <offset> <size> <name>        a complete file
+ *   partial <offset> <size> <name>     a file that was cut short
+ *
+ * The files follow the index, each one aligned to RAW_BLOCK.
+ */
+struct RawIndex {
+
+        struct Entry {
+            std::string name;
+            unsigned long long offset;
+            unsigned long long size;
+            bool partial;
+        };
+
+        std::string dump;
+        std::vector<Entry> files;
+
+        /**
+         * Returns the index as one block.
+         *
+         * @exception KError if the index does not fit into RAW_BLOCK
+         */
+        std::string format() const;
+
+        /**
+         * Reads the index from the first block of a device.
+         *
+         * @return @c false if the block does not contain an index
+         */
+        bool parse(const char *block, size_t len);
+
+        /**
+         * Returns the first offset after the last file.
+         */
+        unsigned long long end() const;
+};
+
+//}}}
+//{{{ RawTransfer --------------------------------------------------------------
+
+/**
+ * Writes the dump directly to a block device (raw:///dev/...), without
+ * a file system. The data goes to the device sequentially with
+ * O_DIRECT, so the kdump kernel keeps no dirty page cache for it and
+ * there is no mount or journal to set up. The index is rewritten after
+ * each file, so it always describes what is on the device.
+ *
+ * Persistent memory (device DAX or a file on a DAX file system) is
+ * mapped instead, and written with non-temporal stores (see
+ * PmemRegion), so that neither the block layer nor the page cache is
+ * involved.
+ *
+ * The device holds one dump; saving a new one discards the previous
+ * dump. Use ExtractRaw (kdumptool extract_raw) to copy it into a dump
+ * directory after the reboot.
+ */
+class RawTransfer : public URLTransfer {
+
+    public:
+
+        /**
+         * Opens the device and invalidates the dump on it.
+         *
+         * @param[in] urlv the target; the last path component is the
+         *            name of the dump directory
+         * @throw KError if the device cannot be opened or written
+         */
+        RawTransfer(const RootDirURLVector &urlv);
+
+        /**
+         * Closes the device.
+         */
+        ~RawTransfer();
+
+        /**
+         * Appends a file. The data is never saved directly.
+         *
+         * @exception KNoSpaceError if the device is full; the part that
+         *            fits is kept as a partial file
+         * @see Transfer::perform()
+         */
+        void perform(DataProvider *dataprovider,
+                     const StringVector &target_files,
+                     bool *directSave);
+
+    protected:
+        /**
+         * Writes @p len bytes of m_buffer at @p offset, padded to
+         * RAW_BLOCK, and throws KNoSpaceError if they exceed the device.
+         */
+        void writeBuffer(unsigned long long offset, size_t len);
+
+        /**
+         * Makes the data durable and writes the index.
+         */
+        void writeIndex();
+
+    private:
+        std::string m_device;
+        int m_fd;
+        bool m_direct;
+        std::unique_ptr<PmemRegion> m_pmem;
+        unsigned long long m_capacity;  // 0 if unknown
+        BufferPool::Buffer m_buffer;
+        RawIndex m_index;
+};
+
+//}}}
+//{{{ RawEntryDataProvider -----------------------------------------------------
+
+/**
+ * Provides one file of a raw dump device.
+ */
+class RawEntryDataProvider : public AbstractDataProvider {
+
+    public:
+        /**
+         * @param[in] fd the device, opened for reading
+         * @param[in] entry the file
+         */
+        RawEntryDataProvider(int fd, const RawIndex::Entry &entry)
+            : m_fd(fd), m_region(NULL), m_entry(entry), m_pos(0)
+        {}
+
+        /**
+         * @param[in] region the mapped persistent memory
+         * @param[in] entry the file
+         */
+        RawEntryDataProvider(const PmemRegion *region,
+                             const RawIndex::Entry &entry)
+            : m_fd(-1), m_region(region), m_entry(entry), m_pos(0)
+        {}
+
+        void prepare();
+        size_t getData(char *buffer, size_t maxread);
+
+        /**
+         * Returns @c true for persistent memory.
+         */
+        bool canMapData() const;
+        size_t mapData(const char **data, size_t maxread);
+
+    private:
+        int m_fd;
+        const PmemRegion *m_region;
+        RawIndex::Entry m_entry;
+        unsigned long long m_pos;
+};
+
+//}}}
+//{{{ ExtractRaw ---------------------------------------------------------------
+
+/**
+ * Subcommand to copy the dumps from raw targets into dump directories.
+ */
+class ExtractRaw : public Subcommand {
+
+    public:
+        /**
+         * Creates a new ExtractRaw object.
+         */
+        ExtractRaw();
+
+    public:
+        /**
+         * Returns the name of the subcommand (extract_raw).
+         */
+        const char *getName() const;
+
+        /**
+         * Executes the function.
+         *
+         * @throw KError on any error. No exception indicates success.
+         */
+        void execute();
+
+    protected:
+        /**
+         * Extracts the dump from one device.
+         *
+         * @param[in] device the block device or persistent memory
+         * @exception KError if the device or the files cannot be accessed
+         */
+        void extract(const std::string &device);
+
+    private:
+        std::string m_rootdir;
+        std::string m_device;
+        std::string m_dir;
+        bool m_keep;
+};
+
+//}}}
+
+#endif /* RAWDUMP_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,345 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "global.h"
+#include "subcommand.h"
+#include "debug.h"
+#include "rearrange.h"
+#include "flattened.h"
+#include "progress.h"
+#include "stringutil.h"
+
+using std::string;
+using std::cout;
+using std::endl;
+
+// maximum size of one pwritev()
+#define REARRANGE_RUN_SIZE	(16*1024*1024)
+
+//{{{ Rearrange ----------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+Rearrange::Rearrange()
+    : m_inPlace(false), m_map(NULL), m_size(0), m_runOffset(0),
+      m_runSize(0), m_bounceUsed(0)
+{
+    m_options.push_back(new FlagOption("in-place", 'i', &m_inPlace,
+        "Rearrange the file in place, without a second copy"));
+}
+
+// -----------------------------------------------------------------------------
+const char *Rearrange::getName() const
+{
+    return "rearrange";
+}
+
+// -----------------------------------------------------------------------------
+bool Rearrange::needsConfigfile() const
+{
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+void Rearrange::parseArgs(const StringVector &args)
+{
+    Debug::debug()->trace(__FUNCTION__);
+
+    if (m_inPlace ? args.size() != 1 : args.size() != 2)
+        throw KError(m_inPlace ? "flattened dump required." :
+                     "flattened dump and output file required.");
+
+    m_input = args[0];
+    m_output = m_inPlace ? args[0] : args[1];
+    Debug::debug()->dbg("input=%s, output=%s",
+                        m_input.c_str(), m_output.c_str());
+}
+
+// -----------------------------------------------------------------------------
+off_t Rearrange::checkInPlace(std::vector<Extent> &gaps)
+{
+    std::vector<Extent> extents;
+    off_t pos = FLAT_HEADER_SIZE;
+    off_t offset, size;
+
+    while (true) {
+        if (m_size - pos < FLAT_RECORD_SIZE)
+            throw KError("The flattened dump has no end record.");
+        if (!FlattenedDataProvider::parseRecord(m_map + pos, &offset, &size))
+            break;
+        pos += FLAT_RECORD_SIZE;
+        if (m_size - pos < size)
+            throw KError("Unexpected end of the flattened dump.");
+        pos += size;
+
+        // the data must not overwrite the part that is not read yet
+        if (offset + size > pos) {
+            setErrorCode(NOT_IN_PLACE);
+            throw KError("The records of " + m_input + " do not allow "
+                         "rearranging it in place.");
+        }
+
+        if (!extents.empty() &&
+            extents.back().offset + extents.back().size == offset)
+            extents.back().size += size;
+        else if (size) {
+            Extent extent = { offset, size };
+            extents.push_back(extent);
+        }
+    }
+
+    // everything that is not written must be a hole in the result
+    std::sort(extents.begin(), extents.end());
+    off_t end = 0;
+    std::vector<Extent>::const_iterator it;
+    for (it = extents.begin(); it != extents.end(); ++it) {
+        if (it->offset > end) {
+            Extent gap = { end, it->offset - end };
+            gaps.push_back(gap);
+        }
+        end = std::max(end, it->offset + it->size);
+    }
+    return end;
+}
+
+// -----------------------------------------------------------------------------
+void Rearrange::add(const unsigned char *data, size_t len, off_t offset)
+{
+    while (len) {
+        if (m_runSize && (offset != m_runOffset + (off_t)m_runSize ||
+                          m_runSize >= REARRANGE_RUN_SIZE ||
+                          m_iov.size() >= IOV_MAX))
+            return;
+
+        if (!m_runSize)
+            m_runOffset = offset;
+
+        size_t n = std::min<size_t>(len, REARRANGE_RUN_SIZE - m_runSize);
+        struct iovec iov;
+        if (m_bounce) {
+            // in place, the data is copied before the file is changed
+            memcpy(m_bounce.get() + m_bounceUsed, data, n);
+            iov.iov_base = m_bounce.get() + m_bounceUsed;
+            m_bounceUsed += n;
+        } else
+            iov.iov_base = const_cast<unsigned char *>(data);
+        iov.iov_len = n;
+        m_iov.push_back(iov);
+
+        m_runSize += n;
+        data += n;
+        len -= n;
+        offset += n;
+    }
+}
+
+// -----------------------------------------------------------------------------
+void Rearrange::flush(int fd)
+{
+    size_t idx = 0;
+    off_t offset = m_runOffset;
+
+    while (idx < m_iov.size()) {
+        ssize_t ret = pwritev(fd, &m_iov[idx], m_iov.size() - idx, offset);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret < 0)
+            throw KSystemError("Error writing " + m_output + " at " +
+                               StringUtil::number2hex(offset), errno);
+
+        offset += ret;
+        while (ret && (size_t)ret >= m_iov[idx].iov_len)
+            ret -= m_iov[idx++].iov_len;
+        if (ret) {
+            m_iov[idx].iov_base = (char *)m_iov[idx].iov_base + ret;
+            m_iov[idx].iov_len -= ret;
+        }
+    }
+
+    m_iov.clear();
+    m_runSize = 0;
+    m_bounceUsed = 0;
+}
+
+// -----------------------------------------------------------------------------
+off_t Rearrange::copyRecords(int fd)
+{
+    TerminalProgress progress("Rearranging");
+    progress.start();
+
+    off_t pos = FLAT_HEADER_SIZE;
+    off_t end = 0;
+    off_t offset, size;
+    try {
+        while (true) {
+            if (m_size - pos < FLAT_RECORD_SIZE)
+                throw KError("The flattened dump has no end record.");
+            if (!FlattenedDataProvider::parseRecord(m_map + pos,
+                                                    &offset, &size))
+                break;
+            pos += FLAT_RECORD_SIZE;
+            if (m_size - pos < size)
+                throw KError("Unexpected end of the flattened dump.");
+
+            const unsigned char *data = m_map + pos;
+            off_t left = size;
+            while (left) {
+                size_t before = m_runSize;
+                add(data, left, offset);
+                size_t n = m_runSize - before;
+                data += n;
+                offset += n;
+                left -= n;
+                if (left)
+                    flush(fd);
+            }
+            end = std::max(end, offset);
+            pos += size;
+            progress.progressed(pos, m_size);
+        }
+        flush(fd);
+    } catch (...) {
+        progress.stop(false);
+        throw;
+    }
+
+    progress.stop(true);
+    return end;
+}
+
+// -----------------------------------------------------------------------------
+void Rearrange::fillGaps(int fd, const std::vector<Extent> &gaps)
+{
+    static const char zeros[64*1024] = { 0 };
+
+    std::vector<Extent>::const_iterator it;
+    for (it = gaps.begin(); it != gaps.end(); ++it) {
+        if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                      it->offset, it->size) == 0)
+            continue;
+        if (errno != EOPNOTSUPP)
+            throw KSystemError("Cannot punch a hole in " + m_output, errno);
+
+        off_t offset = it->offset;
+        off_t left = it->size;
+        while (left) {
+            size_t n = std::min<off_t>(left, sizeof zeros);
+            ssize_t ret = pwrite(fd, zeros, n, offset);
+            if (ret < 0 && errno == EINTR)
+                continue;
+            if (ret < 0)
+                throw KSystemError("Error writing " + m_output, errno);
+            offset += ret;
+            left -= ret;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+void Rearrange::execute()
+{
+    int in = open(m_input.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0)
+        throw KSystemError("Cannot open " + m_input, errno);
+
+    struct stat st;
+    if (fstat(in, &st) != 0) {
+        int err = errno;
+        close(in);
+        throw KSystemError("Cannot stat " + m_input, err);
+    }
+    m_size = st.st_size;
+
+    // do not truncate the input by accident
+    struct stat ost;
+    if (!m_inPlace && stat(m_output.c_str(), &ost) == 0 &&
+        ost.st_dev == st.st_dev && ost.st_ino == st.st_ino) {
+        close(in);
+        throw KError(m_output + " is the input file. Use --in-place.");
+    }
+
+    void *map = MAP_FAILED;
+    if (m_size >= FLAT_HEADER_SIZE)
+        map = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, in, 0);
+    int err = errno;
+    close(in);
+    if (m_size < FLAT_HEADER_SIZE)
+        throw KError(m_input + " is not in makedumpfile flattened format.");
+    if (map == MAP_FAILED)
+        throw KSystemError("Cannot map " + m_input, err);
+    madvise(map, m_size, MADV_SEQUENTIAL);
+    m_map = static_cast<const unsigned char *>(map);
+
+    int out = -1;
+    try {
+        if (!FlattenedDataProvider::validHeader(m_map))
+            throw KError(m_input +
+                         " is not in makedumpfile flattened format.");
+
+        std::vector<Extent> gaps;
+        off_t expected = 0;
+        if (m_inPlace) {
+            expected = checkInPlace(gaps);
+            m_bounce.reset(new char[REARRANGE_RUN_SIZE]);
+            out = open(m_output.c_str(), O_WRONLY | O_CLOEXEC);
+        } else
+            out = open(m_output.c_str(),
+                       O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (out < 0)
+            throw KSystemError("Cannot open " + m_output, errno);
+
+        off_t end = copyRecords(out);
+        if (m_inPlace) {
+            if (end != expected)
+                throw KError("Internal error: " + m_input +
+                             " changed while rearranging it.");
+            fillGaps(out, gaps);
+        }
+
+        // in place, this also cuts off the rest of the flattened data
+        if (ftruncate(out, end) != 0)
+            throw KSystemError("Cannot set the size of " + m_output, errno);
+
+        int ret = close(out);
+        out = -1;
+        if (ret != 0)
+            throw KSystemError("Error closing " + m_output, errno);
+    } catch (...) {
+        if (out >= 0)
+            close(out);
+        munmap(map, m_size);
+        m_map = NULL;
+        throw;
+    }
+
+    munmap(map, m_size);
+    m_map = NULL;
+    cout << "Rearranged " << m_input << " to " << m_output << "." << endl;
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
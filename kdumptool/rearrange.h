@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef REARRANGE_H
+#define REARRANGE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "subcommand.h"
+
+//{{{ Rearrange ----------------------------------------------------------------
+
+/**
+ * Subcommand to convert a dump in makedumpfile flattened format to a
+ * normal dump file, like makedumpfile -R or makedumpfile-R.pl.
+ */
+class Rearrange : public Subcommand {
+
+    public:
+
+        /**
+         * Error codes for Rearrange.
+         */
+        enum ErrorCode {
+            SUCCESS,
+            NOT_IN_PLACE = 2    // the file was not changed
+        };
+
+    public:
+        /**
+         * Creates a new Rearrange object.
+         */
+        Rearrange();
+
+    public:
+        /**
+         * Returns the name of the subcommand (rearrange).
+         */
+        const char *getName() const;
+
+        /**
+         * Parses the non-option arguments from the command line.
+         */
+        virtual void parseArgs(const StringVector &args);
+
+        /**
+         * Returns @c false.
+         */
+        bool needsConfigfile() const;
+
+        /**
+         * Executes the function.
+         *
+         * @throw KError on any error. No exception indicates success.
+         */
+        void execute();
+
+    private:
+        struct Extent {
+            off_t offset;
+            off_t size;
+
+            bool operator<(const Extent &other) const
+            { return offset < other.offset; }
+        };
+
+        off_t checkInPlace(std::vector<Extent> &gaps);
+        off_t copyRecords(int fd);
+        void add(const unsigned char *data, size_t len, off_t offset);
+        void flush(int fd);
+        void fillGaps(int fd, const std::vector<Extent> &gaps);
+
+        std::string m_input;
+        std::string m_output;
+        bool m_inPlace;
+
+        const unsigned char *m_map;
+        off_t m_size;
+
+        // the current run of adjacent data
+        std::vector<struct iovec> m_iov;
+        off_t m_runOffset;
+        size_t m_runSize;
+        std::unique_ptr<char[]> m_bounce;
+        size_t m_bounceUsed;
+};
+
+//}}}
+
+#endif /* REARRANGE_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,415 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "global.h"
+#include "debug.h"
+#include "configuration.h"
+#include "rootdirurl.h"
+#include "process.h"
+#include "checksum.h"
+#include "savedump.h"
+#include "stringutil.h"
+#include "reassemble.h"
+#include "dumpcatalog.h"
+
+using std::string;
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::ifstream;
+using std::ofstream;
+
+// read size for the check of the reassembled dump
+#define REASSEMBLE_BUFFER_SIZE  (4UL << 20)
+
+// signature of a compressed kdump file (struct disk_dump_header)
+#define KDUMP_SIGNATURE         "KDUMP   "
+
+//{{{ ReassemblyMarker ---------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+ReassemblyMarker::ReassemblyMarker(const FilePath &dir)
+    : m_file(dir), m_exists(false)
+{
+    m_file.appendPath(REASSEMBLE_MARKER);
+
+    ifstream fin(m_file.c_str());
+    if (!fin) {
+        if (errno != ENOENT)
+            throw KSystemError("Cannot open " + m_file + ".", errno);
+        return;
+    }
+    m_exists = true;
+
+    string line;
+    while (getline(fin, line)) {
+        std::istringstream iss(line);
+        string key;
+        if (!(iss >> key))
+            continue;
+
+        if (key == "output")
+            iss >> m_output;
+        else if (key == "part") {
+            Part part;
+            if (iss >> part.path >> part.size)
+                m_parts.push_back(part);
+        }
+    }
+
+    if (m_output.empty() || m_parts.empty())
+        throw KError("Invalid marker " + m_file + ".");
+}
+
+// -----------------------------------------------------------------------------
+void ReassemblyMarker::create(const FilePath &dir, const string &output,
+                              const std::vector<Part> &parts)
+{
+    Debug::debug()->trace("ReassemblyMarker::create(%s)", dir.c_str());
+
+    FilePath file = dir;
+    file.appendPath(REASSEMBLE_MARKER);
+
+    // the reassembly must not start before the marker is complete
+    static std::atomic<unsigned> serial(0);
+    string tmp = file + ".tmp" + StringUtil::number2string(getpid()) +
+        "." + StringUtil::number2string(serial++);
+    {
+        ofstream fout(tmp.c_str(), std::ios::trunc);
+        fout << "output " << output << '\n';
+        std::vector<Part>::const_iterator it;
+        for (it = parts.begin(); it != parts.end(); ++it)
+            fout << "part " << it->path << ' ' << it->size << '\n';
+        fout.close();
+        if (!fout) {
+            unlink(tmp.c_str());
+            throw KError("Cannot write " + tmp + ".");
+        }
+    }
+
+    if (rename(tmp.c_str(), file.c_str()) != 0) {
+        int err = errno;
+        unlink(tmp.c_str());
+        throw KSystemError("Cannot rename " + tmp + ".", err);
+    }
+}
+
+// -----------------------------------------------------------------------------
+void ReassemblyMarker::remove()
+{
+    if (unlink(m_file.c_str()) != 0 && errno != ENOENT)
+        throw KSystemError("Cannot remove " + m_file + ".", errno);
+    m_exists = false;
+}
+
+//}}}
+//{{{ ReassembleDumps ----------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+ReassembleDumps::ReassembleDumps()
+    : m_keep(false)
+{
+    Debug::debug()->trace("ReassembleDumps::ReassembleDumps()");
+
+    m_options.push_back(new StringOption("root", 'R', &m_rootdir,
+        "Use the specified root directory instead of /"));
+    m_options.push_back(new FlagOption("keep", 'k', &m_keep,
+        "Keep the parts after the reassembly"));
+}
+
+// -----------------------------------------------------------------------------
+const char *ReassembleDumps::getName() const
+{
+    return "reassemble_dumps";
+}
+
+// -----------------------------------------------------------------------------
+void ReassembleDumps::execute()
+{
+    Debug::debug()->trace("ReassembleDumps::execute()");
+
+    Configuration *config = Configuration::config();
+
+    // split dumps are only saved to local directories
+    StringVector locations;
+    std::istringstream iss(config->KDUMP_SAVEDIR.value());
+    string elem;
+    while (iss >> elem)
+        locations.push_back(elem);
+    if (!config->KDUMP_STAGING_DIR.value().empty())
+        locations.push_back(config->KDUMP_STAGING_DIR.value());
+
+    unsigned failed = 0;
+    StringVector::const_iterator loc;
+    for (loc = locations.begin(); loc != locations.end(); ++loc) {
+        RootDirURL url(*loc, m_rootdir);
+        if (url.getProtocol() != URLParser::PROT_FILE)
+            continue;
+        FilePath dir = url.getRealPath();
+        if (!dir.exists()) {
+            Debug::debug()->dbg("%s does not exist.", dir.c_str());
+            continue;
+        }
+
+        StringVector contents = dir.listDir(FilterDotsAndNondirs());
+        StringVector::const_iterator it;
+        for (it = contents.begin(); it != contents.end(); ++it) {
+            FilePath dump = dir;
+            dump.appendPath(*it);
+            try {
+                reassembleDump(dump);
+            } catch (const KError &error) {
+                cerr << error.what() << endl;
+                ++failed;
+            }
+        }
+    }
+
+    if (failed)
+        throw KError("Reassembling " + StringUtil::number2string(failed) +
+                     " dump(s) failed.");
+}
+
+// -----------------------------------------------------------------------------
+void ReassembleDumps::reassembleDump(const FilePath &dir)
+{
+    Debug::debug()->trace("ReassembleDumps::reassembleDump(%s)", dir.c_str());
+
+    ReassemblyMarker marker(dir);
+    if (!marker.exists())
+        return;
+
+    FilePath output = dir;
+    output.appendPath(marker.output());
+    const std::vector<ReassemblyMarker::Part> &parts = marker.parts();
+    std::vector<ReassemblyMarker::Part>::const_iterator it;
+
+    // the output is renamed into place only after the check, so if it
+    // exists, only the removal of the parts has been interrupted
+    if (!output.exists()) {
+        StringVector args;
+        args.push_back("--reassemble");
+        for (it = parts.begin(); it != parts.end(); ++it) {
+            FilePath path = realPath(it->path);
+            struct stat mystat;
+            if (stat(path.c_str(), &mystat) != 0)
+                throw KSystemError("Cannot stat " + path + ".", errno);
+            if ((unsigned long long)mystat.st_size != it->size)
+                throw KError(path + " has " +
+                             StringUtil::number2string(mystat.st_size) +
+                             " bytes instead of " +
+                             StringUtil::number2string(it->size) + ".");
+            args.push_back(path);
+        }
+
+        FilePath tmp = dir;
+        tmp.appendPath("." + marker.output() + ".reassemble");
+        args.push_back(tmp);
+        unlink(tmp.c_str());
+
+        cout << "Reassembling " << output << " from " << parts.size()
+             << " parts" << endl;
+        std::ostringstream stderrStream;
+        ProcessFilter p;
+        p.setStderr(&stderrStream);
+        int ret = p.execute("makedumpfile", args);
+        if (ret != 0) {
+            unlink(tmp.c_str());
+            KString error = stderrStream.str();
+            throw KError("makedumpfile --reassemble failed: " + error.trim());
+        }
+
+        unsigned long long size;
+        string crc;
+        try {
+            crc = verify(tmp, size);
+        } catch (...) {
+            unlink(tmp.c_str());
+            throw;
+        }
+        updateManifest(dir, marker, crc, size);
+
+        if (rename(tmp.c_str(), output.c_str()) != 0) {
+            int err = errno;
+            unlink(tmp.c_str());
+            throw KSystemError("Cannot rename " + tmp + ".", err);
+        }
+    }
+
+    cout << "Reassembled " << output << endl;
+    if (m_keep)
+        return;
+
+    // the marker goes last, so an interrupted removal is continued
+    for (it = parts.begin(); it != parts.end(); ++it) {
+        FilePath path = realPath(it->path);
+        if (unlink(path.c_str()) != 0 && errno != ENOENT)
+            throw KSystemError("Cannot remove " + path + ".", errno);
+    }
+    marker.remove();
+
+    // the catalog is only an index, so the reassembly has not failed
+    try {
+        DumpCatalog catalog(dir.dirName());
+        const DumpCatalog::Entry *known = catalog.find(dir.baseName());
+        if (known) {
+            DumpCatalog::Entry entry = *known;
+            entry.parts = 0;
+            entry.size = dir.diskUsage();
+            catalog.add(entry);
+        }
+    } catch (const KError &error) {
+        cerr << "WARNING: " << error.what() << endl;
+    }
+}
+
+// -----------------------------------------------------------------------------
+string ReassembleDumps::verify(const FilePath &path, unsigned long long &size)
+{
+    Debug::debug()->trace("ReassembleDumps::verify(%s)", path.c_str());
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw KSystemError("Cannot open " + path + ".", errno);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    std::vector<char> buffer(REASSEMBLE_BUFFER_SIZE);
+    Crc32c crc;
+    size = 0;
+    try {
+        ssize_t n;
+        while ((n = read(fd, buffer.data(), buffer.size())) != 0) {
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw KSystemError("Cannot read " + path + ".", errno);
+            }
+            if (size == 0 && ((size_t)n < strlen(KDUMP_SIGNATURE) ||
+                              memcmp(buffer.data(), KDUMP_SIGNATURE,
+                                     strlen(KDUMP_SIGNATURE)) != 0))
+                throw KError(path + " is not a compressed kdump file.");
+            crc.update(buffer.data(), n);
+
+            // the dump is not read again soon, keep the cache for others
+            posix_fadvise(fd, size, n, POSIX_FADV_DONTNEED);
+            size += n;
+        }
+        if (size == 0)
+            throw KError(path + " is empty.");
+
+        // the parts are removed afterwards, so the data must be on disk
+        if (fsync(fd) != 0)
+            throw KSystemError("Cannot sync " + path + ".", errno);
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+
+    Debug::debug()->dbg("%s: %llu bytes, CRC-32C %s", path.c_str(), size,
+                        crc.hex().c_str());
+    return crc.hex();
+}
+
+// -----------------------------------------------------------------------------
+void ReassembleDumps::updateManifest(const FilePath &dir,
+                                     const ReassemblyMarker &marker,
+                                     const string &crc,
+                                     unsigned long long size)
+{
+    FilePath file = dir;
+    file.appendPath(CHECKSUM_MANIFEST);
+
+    ifstream fin(file.c_str());
+    if (!fin) {
+        if (errno != ENOENT)
+            throw KSystemError("Cannot open " + file + ".", errno);
+        return;
+    }
+
+    StringVector names;
+    std::vector<ReassemblyMarker::Part>::const_iterator it;
+    for (it = marker.parts().begin(); it != marker.parts().end(); ++it)
+        names.push_back(FilePath(it->path).baseName());
+    // an earlier attempt may have been interrupted before the rename
+    names.push_back(marker.output());
+
+    // drop "<crc> <size> <part>[@<offset>]" and "# <part>: ..."
+    std::ostringstream ss;
+    string line;
+    while (getline(fin, line)) {
+        std::istringstream iss(line);
+        string first, second, name;
+        iss >> first >> second >> name;
+        if (first == "#")
+            name = second.substr(0, second.rfind(':'));
+        else
+            name = name.substr(0, name.find('@'));
+
+        StringVector::const_iterator n;
+        for (n = names.begin(); n != names.end(); ++n)
+            if (*n == name)
+                break;
+        if (n == names.end())
+            ss << line << '\n';
+    }
+    fin.close();
+    ss << crc << ' ' << size << ' ' << marker.output() << '\n';
+
+    string tmp = file + ".tmp";
+    {
+        ofstream fout(tmp.c_str(), std::ios::trunc);
+        fout << ss.str();
+        fout.close();
+        if (!fout) {
+            unlink(tmp.c_str());
+            throw KError("Cannot write " + tmp + ".");
+        }
+    }
+    if (rename(tmp.c_str(), file.c_str()) != 0) {
+        int err = errno;
+        unlink(tmp.c_str());
+        throw KSystemError("Cannot rename " + tmp + ".", err);
+    }
+}
+
+// -----------------------------------------------------------------------------
+FilePath ReassembleDumps::realPath(const string &path) const
+{
+    FilePath ret = m_rootdir;
+    if (ret.empty())
+        return path;
+    return ret.appendPath(path);
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
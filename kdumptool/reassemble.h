@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef REASSEMBLE_H
+#define REASSEMBLE_H
+
+#include <string>
+#include <vector>
+
+#include "global.h"
+#include "subcommand.h"
+#include "fileutil.h"
+
+#define REASSEMBLE_MARKER   ".kdump-reassemble"
+
+//{{{ ReassemblyMarker ---------------------------------------------------------
+
+/**
+ * The marker of a split dump that waits for its reassembly.
+ *
+ * With the SPLIT flag, makedumpfile writes one part per CPU, possibly to
+ * several directories of KDUMP_SAVEDIR. The marker is saved next to the
+ * other files of the dump and lists:
+ *
+ *   output <file>          the name of the reassembled dump
+ *   part <path> <size>     a part, as seen by the system, and its size
+ */
+class ReassemblyMarker {
+
+    public:
+        /**
+         * A part of the split dump.
+         */
+        struct Part {
+            std::string path;
+            unsigned long long size;
+        };
+
+        /**
+         * Reads the marker of a dump, if there is one.
+         *
+         * @param[in] dir the directory of the dump
+         * @exception KError if the marker cannot be read
+         */
+        ReassemblyMarker(const FilePath &dir);
+
+        /**
+         * Creates the marker for a split dump that has just been saved.
+         *
+         * @param[in] dir the directory of the dump
+         * @param[in] output the name of the reassembled dump
+         * @param[in] parts the parts in the order of makedumpfile
+         * @exception KError if the marker cannot be written
+         */
+        static void create(const FilePath &dir, const std::string &output,
+                           const std::vector<Part> &parts);
+
+        /**
+         * Returns @c true if the dump waits for its reassembly.
+         */
+        bool exists() const
+        { return m_exists; }
+
+        /**
+         * Returns the name of the reassembled dump.
+         */
+        const std::string &output() const
+        { return m_output; }
+
+        /**
+         * Returns the parts in the order of makedumpfile.
+         */
+        const std::vector<Part> &parts() const
+        { return m_parts; }
+
+        /**
+         * Removes the marker.
+         *
+         * @exception KError if the marker cannot be removed
+         */
+        void remove();
+
+    private:
+        FilePath m_file;
+        bool m_exists;
+        std::string m_output;
+        std::vector<Part> m_parts;
+};
+
+//}}}
+//{{{ ReassembleDumps ----------------------------------------------------------
+
+/**
+ * Subcommand to reassemble the split dumps in KDUMP_SAVEDIR and
+ * KDUMP_STAGING_DIR into a single file.
+ */
+class ReassembleDumps : public Subcommand {
+
+    public:
+        /**
+         * Creates a new ReassembleDumps object.
+         */
+        ReassembleDumps();
+
+    public:
+        /**
+         * Returns the name of the subcommand (reassemble_dumps).
+         */
+        const char *getName() const;
+
+        /**
+         * Executes the function.
+         *
+         * @throw KError on any error. No exception indicates success.
+         */
+        void execute();
+
+    protected:
+        /**
+         * Reassembles one dump and removes its parts unless --keep has
+         * been given.
+         *
+         * @param[in] dir the directory of the dump
+         * @exception KError if a part is missing or makedumpfile fails
+         */
+        void reassembleDump(const FilePath &dir);
+
+        /**
+         * Checks the reassembled dump and makes it durable.
+         *
+         * The file is read once with large sequential reads; its CRC-32C
+         * is returned for the checksum manifest.
+         *
+         * @param[in] path the reassembled dump
+         * @param[out] size the size of the file
+         * @return the CRC-32C as eight hexadecimal digits
+         * @exception KError if the file is not a compressed kdump file
+         */
+        std::string verify(const FilePath &path, unsigned long long &size);
+
+        /**
+         * Replaces the entries of the parts in the checksum manifest of
+         * the dump, if there is one, by the reassembled dump.
+         *
+         * @exception KError if the manifest cannot be written
+         */
+        void updateManifest(const FilePath &dir, const ReassemblyMarker &marker,
+                            const std::string &crc, unsigned long long size);
+
+        /**
+         * Returns the path of @p path below the root directory.
+         */
+        FilePath realPath(const std::string &path) const;
+
+    private:
+        std::string m_rootdir;
+        bool m_keep;
+};
+
+//}}}
+
+#endif /* REASSEMBLE_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
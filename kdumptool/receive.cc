@@ -0,0 +1,1076 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <climits>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "global.h"
+#include "debug.h"
+#include "configuration.h"
+#include "rootdirurl.h"
+#include "routable.h"
+#include "socket.h"
+#include "fileutil.h"
+#include "stringutil.h"
+#include "dataprovider.h"
+#include "savestats.h"
+#include "writeback.h"
+#include "receive.h"
+
+using std::string;
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// maximum number of events handled by one epoll_wait()
+#define STREAM_EVENTS       64
+
+//{{{ StreamFrame --------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+static void putBE(unsigned char *buf, unsigned long long val, int bytes)
+{
+    for (int i = bytes - 1; i >= 0; --i) {
+        buf[i] = val & 0xff;
+        val >>= 8;
+    }
+}
+
+// -----------------------------------------------------------------------------
+static unsigned long long getBE(const unsigned char *buf, int bytes)
+{
+    unsigned long long val = 0;
+    for (int i = 0; i < bytes; ++i)
+        val = (val << 8) | buf[i];
+    return val;
+}
+
+// -----------------------------------------------------------------------------
+void StreamFrame::encode(unsigned char *buf) const
+{
+    putBE(buf, type, 4);
+    putBE(buf + 4, length, 4);
+    putBE(buf + 8, offset, 8);
+}
+
+// -----------------------------------------------------------------------------
+void StreamFrame::decode(const unsigned char *buf)
+{
+    type = getBE(buf, 4);
+    length = getBE(buf + 4, 4);
+    offset = getBE(buf + 8, 8);
+}
+
+//}}}
+//{{{ StreamTransfer -----------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+StreamTransfer::StreamTransfer(const RootDirURLVector &urlv)
+    : URLTransfer(urlv), m_fd(-1), m_version(STREAM_VERSION),
+      m_expectedSize(0), m_rate(0), m_paced(0)
+{
+    if (urlv.size() > 1)
+        cerr << "WARNING: First dump target used; rest ignored." << endl;
+    const RootDirURL &parser = urlv.front();
+
+    Debug::debug()->trace("StreamTransfer::StreamTransfer(%s)",
+                          parser.getURL().c_str());
+
+    Routable rt(parser.getHostname());
+    if (!rt.check(Configuration::config()->KDUMP_NET_TIMEOUT.value()))
+        cerr << "WARNING: Dump target not reachable" << endl;
+
+    m_dumpdir = FilePath(parser.getPath()).baseName();
+    connect();
+}
+
+// -----------------------------------------------------------------------------
+StreamTransfer::~StreamTransfer()
+{
+    Debug::debug()->trace("StreamTransfer::~StreamTransfer()");
+}
+
+// -----------------------------------------------------------------------------
+void StreamTransfer::connect()
+{
+    const RootDirURL &parser = getURLVector().front();
+
+    // an older collector does not pace its senders
+    string message;
+    int err = hello(STREAM_VERSION, message);
+    if (err == EPROTO) {
+        Debug::debug()->dbg("The collector only knows stream version 1");
+        err = hello(1, message);
+    }
+    if (err)
+        throw KSystemError("Connecting to " + parser.getHostname() +
+                           " failed on the collector: " + message, err);
+}
+
+// -----------------------------------------------------------------------------
+int StreamTransfer::hello(unsigned long version, string &message)
+{
+    const RootDirURL &parser = getURLVector().front();
+    int port = parser.getPort();
+    if (port == -1)
+        port = STREAM_PORT;
+
+    m_socket.reset(new Socket(parser.getHostname(), port, Socket::ST_TCP));
+    m_socket->setTuning(NetTuning::forHost(parser.getHostname()));
+    m_fd = m_socket->connect();
+    m_version = version;
+    m_rate = 0;
+
+    sendFrame(StreamFrame(StreamFrame::SF_HELLO, strlen(STREAM_MAGIC),
+                          version), STREAM_MAGIC);
+    StreamFrame frame;
+    recvControl(frame, message);
+    if (frame.type != StreamFrame::SF_STATUS)
+        throw KError("Invalid reply from the collector.");
+    return int(frame.offset);
+}
+
+// -----------------------------------------------------------------------------
+void StreamTransfer::disconnect()
+{
+    m_socket.reset();
+    m_fd = -1;
+}
+
+// -----------------------------------------------------------------------------
+void StreamTransfer::sendFrame(const StreamFrame &frame, const char *payload)
+{
+    unsigned char header[STREAM_HEADER_SIZE];
+    frame.encode(header);
+
+    struct iovec iov[2];
+    iov[0].iov_base = header;
+    iov[0].iov_len = sizeof header;
+    iov[1].iov_base = const_cast<char *>(payload);
+    iov[1].iov_len = frame.length;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof msg);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = frame.length ? 2 : 1;
+    while (msg.msg_iovlen) {
+        ssize_t ret = sendmsg(m_fd, &msg, MSG_NOSIGNAL);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            throw KSystemError("Cannot send to the collector", errno);
+        }
+
+        // skip what has been sent
+        while (msg.msg_iovlen && size_t(ret) >= msg.msg_iov->iov_len) {
+            ret -= msg.msg_iov->iov_len;
+            ++msg.msg_iov;
+            --msg.msg_iovlen;
+        }
+        if (msg.msg_iovlen) {
+            msg.msg_iov->iov_base =
+                static_cast<char *>(msg.msg_iov->iov_base) + ret;
+            msg.msg_iov->iov_len -= ret;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+static void recvFully(int fd, void *buf, size_t len)
+{
+    char *p = static_cast<char *>(buf);
+    while (len) {
+        ssize_t ret = recv(fd, p, len, 0);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret < 0)
+            throw KSystemError("Cannot receive from the collector", errno);
+        if (ret == 0)
+            throw KError("The collector has closed the connection.");
+        p += ret;
+        len -= ret;
+    }
+}
+
+// -----------------------------------------------------------------------------
+void StreamTransfer::recvControl(StreamFrame &frame, string &payload)
+{
+    unsigned char header[STREAM_HEADER_SIZE];
+    recvFully(m_fd, header, sizeof header);
+    frame.decode(header);
+    if (frame.type != StreamFrame::SF_STATUS &&
+        frame.type != StreamFrame::SF_QUEUED &&
+        frame.type != StreamFrame::SF_GRANT)
+        throw KError("Invalid reply from the collector.");
+    if (frame.length > STREAM_MAX_CONTROL)
+        throw KError("Invalid reply from the collector.");
+
+    payload.assign(frame.length, '\0');
+    recvFully(m_fd, &payload[0], frame.length);
+}
+
+// -----------------------------------------------------------------------------
+bool StreamTransfer::notice(const StreamFrame &frame)
+{
+    switch (frame.type) {
+        case StreamFrame::SF_QUEUED:
+            cout << "The collector is busy, waiting for a slot ("
+                 << frame.offset << " dumps waiting)" << endl;
+            return true;
+
+        case StreamFrame::SF_GRANT:
+            Debug::debug()->dbg("The collector grants %llu bytes/s",
+                                frame.offset);
+            m_rate = frame.offset;
+            m_paced = 0;
+            m_grant = std::chrono::steady_clock::now();
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+// -----------------------------------------------------------------------------
+void StreamTransfer::recvStatus(const string &what)
+{
+    StreamFrame frame;
+    string message;
+    do
+        recvControl(frame, message);
+    while (notice(frame));
+
+    if (frame.offset != 0)
+        throw KSystemError(what + " failed on the collector: " + message,
+                           int(frame.offset));
+}
+
+// -----------------------------------------------------------------------------
+void StreamTransfer::checkStatus(const string &what)
+{
+    // the collector only speaks up between replies if a write failed or
+    // the rate has changed
+    struct pollfd pfd;
+    pfd.fd = m_fd;
+    pfd.events = POLLIN;
+    while (::poll(&pfd, 1, 0) > 0) {
+        StreamFrame frame;
+        string message;
+        recvControl(frame, message);
+        if (notice(frame))
+            continue;
+
+        if (frame.offset != 0)
+            throw KSystemError(what + " failed on the collector: " + message,
+                               int(frame.offset));
+        throw KError("Unexpected reply from the collector.");
+    }
+}
+
+// -----------------------------------------------------------------------------
+void StreamTransfer::pace(size_t bytes)
+{
+    if (!m_rate)
+        return;
+
+    m_paced += bytes;
+    std::this_thread::sleep_until(m_grant +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(double(m_paced) / m_rate)));
+}
+
+// -----------------------------------------------------------------------------
+void StreamTransfer::perform(DataProvider *dataprovider,
+                             const StringVector &target_files,
+                             bool *directSave)
+{
+    Debug::debug()->trace("StreamTransfer::perform(%p, [ \"%s\"%s ])",
+        dataprovider, target_files.front().c_str(),
+        target_files.size() > 1 ? ", ..." : "");
+
+    if (directSave)
+        *directSave = false;
+
+    // a failed file has left the previous connection in an unknown state
+    if (m_fd < 0)
+        connect();
+
+    string remote = m_dumpdir + "/" + target_files.front();
+    TransferMeter meter("stream", target_files.front());
+    m_rate = 0;
+    try {
+        sendFrame(StreamFrame(StreamFrame::SF_OPEN, remote.size(),
+                              m_expectedSize),
+                  remote.data());
+        recvStatus("Opening " + remote);
+
+        dataprovider->prepare();
+        try {
+            std::vector<char> buffer(STREAM_CHUNK_SIZE);
+            off_t off = 0;
+            unsigned long long size = 0;
+            bool place = dataprovider->canPlaceData();
+            while (true) {
+                size_t len = meter.source([&]() {
+                        return place ?
+                            dataprovider->getPlacedData(buffer.data(),
+                                                        buffer.size(), &off) :
+                            dataprovider->getData(buffer.data(),
+                                                  buffer.size());
+                    });
+
+                // finished?
+                if (len == 0)
+                    break;
+                meter.moved(len);
+
+                meter.sink([&]() {
+                        sendFrame(StreamFrame(StreamFrame::SF_DATA, len, off),
+                                  buffer.data());
+                        checkStatus("Writing " + remote);
+                        pace(len);
+                    });
+                off += len;
+                if ((unsigned long long)off > size)
+                    size = off;
+            }
+
+            // the reply comes when the file is on the collector's disk
+            meter.sink([&]() {
+                    sendFrame(StreamFrame(StreamFrame::SF_CLOSE, 0, size));
+                    recvStatus("Saving " + remote);
+                });
+        } catch (...) {
+            dataprovider->finish();
+            throw;
+        }
+        dataprovider->finish();
+    } catch (...) {
+        disconnect();
+        throw;
+    }
+}
+
+//}}}
+//{{{ StreamReceiver -----------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+StreamReceiver::Connection::Connection(int fd, const string &peer)
+    : fd(fd), peer(peer), headerLen(0), done(0), hello(false), version(0),
+      bulk(false), queued(false), expected(0), arrival(0), rate(0),
+      file(-1), error(0), written(0), end(0),
+      buffer(NULL), buffered(0), bufferOffset(0)
+{}
+
+// -----------------------------------------------------------------------------
+StreamReceiver::Connection::~Connection()
+{
+    if (file >= 0)
+        ::close(file);
+    free(buffer);
+    ::close(fd);
+}
+
+// -----------------------------------------------------------------------------
+StreamReceiver::StreamReceiver(const string &dir)
+    : m_dir(dir), m_listen(-1), m_epoll(-1), m_port(0), m_slots(0),
+      m_bandwidth(0), m_arrivals(0)
+{
+    Debug::debug()->trace("StreamReceiver::StreamReceiver(%s)", dir.c_str());
+
+    m_epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epoll < 0)
+        throw KSystemError("epoll_create1() failed.", errno);
+}
+
+// -----------------------------------------------------------------------------
+StreamReceiver::~StreamReceiver()
+{
+    // nothing is admitted any more
+    std::map<int, std::unique_ptr<Connection> >::iterator it;
+    for (it = m_connections.begin(); it != m_connections.end(); ++it)
+        it->second->queued = false;
+
+    while (!m_connections.empty())
+        drop(m_connections.begin()->first);
+    if (m_listen >= 0)
+        ::close(m_listen);
+    ::close(m_epoll);
+}
+
+// -----------------------------------------------------------------------------
+void StreamReceiver::listen(const string &address, int port)
+{
+    Debug::debug()->trace("StreamReceiver::listen(%s, %d)",
+                          address.c_str(), port);
+
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    string service = StringUtil::number2string(port);
+    int n = getaddrinfo(address.empty() ? NULL : address.c_str(),
+                        service.c_str(), &hints, &res);
+    if (n != 0)
+        throw KGaiError("getaddrinfo() failed for " + address + ".", n);
+
+    // without an address, one IPv6 socket takes IPv4 connections, too
+    std::vector<struct addrinfo *> candidates;
+    for (struct addrinfo *aip = res; aip; aip = aip->ai_next)
+        candidates.push_back(aip);
+    if (address.empty())
+        std::stable_partition(candidates.begin(), candidates.end(),
+                              [](struct addrinfo *aip) {
+                                  return aip->ai_family == AF_INET6;
+                              });
+
+    int err = EADDRNOTAVAIL;
+    for (size_t i = 0; i < candidates.size() && m_listen < 0; ++i) {
+        struct addrinfo *aip = candidates[i];
+        int fd = socket(aip->ai_family,
+                        aip->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                        aip->ai_protocol);
+        if (fd < 0) {
+            err = errno;
+            continue;
+        }
+
+        int on = 1, off = 0;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on);
+        if (aip->ai_family == AF_INET6 && address.empty())
+            setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof off);
+
+        if (bind(fd, aip->ai_addr, aip->ai_addrlen) == 0 &&
+            ::listen(fd, SOMAXCONN) == 0)
+            m_listen = fd;
+        else {
+            err = errno;
+            ::close(fd);
+        }
+    }
+    freeaddrinfo(res);
+
+    if (m_listen < 0)
+        throw KSystemError("Cannot listen on port " + service + ".", err);
+
+    struct sockaddr_storage ss;
+    socklen_t sslen = sizeof ss;
+    if (getsockname(m_listen, (struct sockaddr *)&ss, &sslen) != 0)
+        throw KSystemError("getsockname() failed.", errno);
+    if (ss.ss_family == AF_INET6)
+        m_port = ntohs(((struct sockaddr_in6 *)&ss)->sin6_port);
+    else
+        m_port = ntohs(((struct sockaddr_in *)&ss)->sin_port);
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof ev);
+    ev.events = EPOLLIN;
+    ev.data.fd = m_listen;
+    if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_listen, &ev) != 0)
+        throw KSystemError("epoll_ctl() failed.", errno);
+}
+
+// -----------------------------------------------------------------------------
+void StreamReceiver::poll(int timeout)
+{
+    struct epoll_event events[STREAM_EVENTS];
+    int n = epoll_wait(m_epoll, events, STREAM_EVENTS, timeout);
+    if (n < 0) {
+        if (errno == EINTR)
+            return;
+        throw KSystemError("epoll_wait() failed.", errno);
+    }
+
+    for (int i = 0; i < n; ++i) {
+        int fd = events[i].data.fd;
+        if (fd == m_listen) {
+            accept();
+            continue;
+        }
+
+        std::map<int, std::unique_ptr<Connection> >::iterator it =
+            m_connections.find(fd);
+        if (it == m_connections.end())
+            continue;
+        Connection &conn = *it->second;
+        bool open;
+        try {
+            open = receive(conn);
+        } catch (const KError &error) {
+            cerr << "WARNING: " << conn.peer << ": " << error.what() << endl;
+            open = false;
+        }
+        if (!open)
+            drop(fd);
+    }
+}
+
+// -----------------------------------------------------------------------------
+void StreamReceiver::accept()
+{
+    while (true) {
+        struct sockaddr_storage ss;
+        socklen_t sslen = sizeof ss;
+        int fd = accept4(m_listen, (struct sockaddr *)&ss, &sslen,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                cerr << "WARNING: accept() failed: " << strerror(errno)
+                     << endl;
+            return;
+        }
+
+        // IPv4 senders have an IPv4-mapped address on an IPv6 socket
+        char addr[INET6_ADDRSTRLEN] = "unknown";
+        if (ss.ss_family == AF_INET6)
+            inet_ntop(AF_INET6, &((struct sockaddr_in6 *)&ss)->sin6_addr,
+                      addr, sizeof addr);
+        else if (ss.ss_family == AF_INET)
+            inet_ntop(AF_INET, &((struct sockaddr_in *)&ss)->sin_addr,
+                      addr, sizeof addr);
+        string peer = addr;
+        if (peer.compare(0, 7, "::ffff:") == 0 &&
+            peer.find('.') != string::npos)
+            peer.erase(0, 7);
+
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof ev);
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            cerr << "WARNING: epoll_ctl() failed: " << strerror(errno)
+                 << endl;
+            ::close(fd);
+            continue;
+        }
+        m_connections[fd].reset(new Connection(fd, peer));
+        Debug::debug()->dbg("Connection from %s", peer.c_str());
+    }
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Receives at most @p len bytes.
+ *
+ * @return the number of bytes, 0 at the end of the stream, or -1 if
+ *         nothing is available now
+ */
+static ssize_t recvSome(int fd, void *buf, size_t len)
+{
+    while (true) {
+        ssize_t ret = recv(fd, buf, len, 0);
+        if (ret >= 0)
+            return ret;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return -1;
+        if (errno != EINTR)
+            throw KSystemError("Cannot receive from the sender", errno);
+    }
+}
+
+// -----------------------------------------------------------------------------
+bool StreamReceiver::receive(Connection &conn)
+{
+    // leave some time to the other connections
+    size_t budget = STREAM_BUFFER_SIZE;
+    while (budget) {
+        ssize_t n;
+
+        if (conn.headerLen < STREAM_HEADER_SIZE) {
+            n = recvSome(conn.fd, conn.header + conn.headerLen,
+                         STREAM_HEADER_SIZE - conn.headerLen);
+            if (n < 0)
+                return true;
+            if (n == 0) {
+                if (conn.headerLen)
+                    throw KError("Connection closed inside a frame.");
+                return false;
+            }
+            conn.headerLen += n;
+            budget -= std::min(budget, size_t(n));
+            if (conn.headerLen < STREAM_HEADER_SIZE)
+                continue;
+
+            conn.frame.decode(conn.header);
+            conn.done = 0;
+            conn.control.clear();
+            if (!conn.hello && conn.frame.type != StreamFrame::SF_HELLO)
+                throw KError("The stream does not start with a greeting.");
+            if (conn.frame.type == StreamFrame::SF_DATA) {
+                if (conn.file < 0 && !conn.error)
+                    throw KError("Data frame without an open file.");
+            } else if (conn.frame.length > STREAM_MAX_CONTROL)
+                throw KError("Control frame is too long.");
+        }
+
+        size_t remaining = conn.frame.length - conn.done;
+        if (remaining && conn.frame.type == StreamFrame::SF_DATA) {
+            // receive straight into the write buffer
+            off_t pos = conn.frame.offset + conn.done;
+            if (conn.buffered &&
+                (pos != conn.bufferOffset + off_t(conn.buffered) ||
+                 conn.buffered == STREAM_BUFFER_SIZE))
+                flush(conn);
+
+            char discard[STREAM_MAX_CONTROL];
+            char *dest;
+            size_t room;
+            if (conn.error) {
+                dest = discard;
+                room = sizeof discard;
+            } else {
+                if (!conn.buffered)
+                    conn.bufferOffset = pos;
+                dest = conn.buffer + conn.buffered;
+                room = STREAM_BUFFER_SIZE - conn.buffered;
+            }
+            n = recvSome(conn.fd, dest, std::min(room, remaining));
+            if (n < 0)
+                return true;
+            if (n == 0)
+                throw KError("Connection closed inside a frame.");
+            if (!conn.error)
+                conn.buffered += n;
+            conn.done += n;
+            conn.written += n;
+            budget -= std::min(budget, size_t(n));
+        } else if (remaining) {
+            char buf[STREAM_MAX_CONTROL];
+            n = recvSome(conn.fd, buf, remaining);
+            if (n < 0)
+                return true;
+            if (n == 0)
+                throw KError("Connection closed inside a frame.");
+            conn.control.append(buf, n);
+            conn.done += n;
+        }
+        if (conn.done < conn.frame.length)
+            continue;
+
+        // the frame is complete
+        conn.headerLen = 0;
+        if (conn.frame.type != StreamFrame::SF_DATA && !control(conn))
+            return false;
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+bool StreamReceiver::control(Connection &conn)
+{
+    switch (conn.frame.type) {
+        case StreamFrame::SF_HELLO:
+            if (conn.control != STREAM_MAGIC || conn.frame.offset < 1 ||
+                conn.frame.offset > STREAM_VERSION) {
+                reply(conn, EPROTO, "Unsupported stream version");
+                return false;
+            }
+            conn.hello = true;
+            conn.version = conn.frame.offset;
+            return reply(conn, 0, string());
+
+        case StreamFrame::SF_OPEN: {
+            if (conn.file >= 0 || conn.error || conn.queued)
+                throw KError("File opened before the last one was closed.");
+            string::size_type slash = conn.control.find('/');
+            if (slash != string::npos &&
+                isBulk(conn.control.substr(slash + 1), conn.frame.offset)) {
+                conn.expected = conn.frame.offset;
+                return admit(conn, conn.control);
+            }
+            return openFile(conn, conn.control);
+        }
+
+        case StreamFrame::SF_CLOSE:
+            return closeFile(conn, conn.frame.offset);
+
+        default:
+            throw KError("Invalid frame type " +
+                         StringUtil::number2string(conn.frame.type) + ".");
+    }
+}
+
+// -----------------------------------------------------------------------------
+static bool validName(const string &name)
+{
+    return !name.empty() && name != "." && name != ".." &&
+        name.find('/') == string::npos;
+}
+
+// -----------------------------------------------------------------------------
+bool StreamReceiver::openFile(Connection &conn, const string &name)
+{
+    string::size_type slash = name.find('/');
+    string dump, file;
+    if (slash != string::npos) {
+        dump = name.substr(0, slash);
+        file = name.substr(slash + 1);
+    }
+    if (!validName(dump) || !validName(file))
+        return reply(conn, EINVAL, "Invalid file name " + name);
+
+    // SaveDump uses "unknown" if it had no route to the collector
+    if (dump.compare(0, 8, "unknown-") == 0)
+        dump = conn.peer + dump.substr(7);
+
+    FilePath path = m_dir;
+    path.appendPath(dump);
+    if (mkdir(path.c_str(), 0755) != 0 && errno != EEXIST)
+        return reply(conn, errno, "Cannot create " + path);
+    path.appendPath(file);
+
+    if (!conn.buffer) {
+        void *buf;
+        if (posix_memalign(&buf, 4096, STREAM_BUFFER_SIZE) != 0)
+            return reply(conn, ENOMEM, "Cannot allocate the buffer");
+        conn.buffer = static_cast<char *>(buf);
+    }
+
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                  0644);
+    if (fd < 0)
+        return reply(conn, errno, "Cannot create " + path);
+
+    conn.file = fd;
+    conn.path = path;
+    conn.written = 0;
+    conn.end = 0;
+    conn.buffered = 0;
+    conn.writeback.reset(new WritebackWindow(fd));
+    cout << conn.peer << ": receiving " << path << endl;
+    return reply(conn, 0, string());
+}
+
+// -----------------------------------------------------------------------------
+bool StreamReceiver::isBulk(const string &name, unsigned long long expected)
+{
+    return name.compare(0, 6, "vmcore") == 0 || expected >= STREAM_BULK_SIZE;
+}
+
+// -----------------------------------------------------------------------------
+size_t StreamReceiver::waiting() const
+{
+    size_t ret = 0;
+    std::map<int, std::unique_ptr<Connection> >::const_iterator it;
+    for (it = m_connections.begin(); it != m_connections.end(); ++it)
+        if (it->second->queued)
+            ++ret;
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+bool StreamReceiver::admit(Connection &conn, const string &name)
+{
+    if (m_slots && m_bulk.size() >= m_slots) {
+        conn.queued = true;
+        conn.pending = name;
+        conn.arrival = ++m_arrivals;
+        cout << conn.peer << ": waiting for a slot for " << name << endl;
+        if (conn.version >= 2)
+            return sendFrame(conn, StreamFrame(StreamFrame::SF_QUEUED, 0,
+                                               waiting()), string());
+        return true;
+    }
+
+    conn.bulk = true;
+    m_bulk.insert(conn.fd);
+    bool ret = openFile(conn, name);
+    if (conn.file < 0)
+        release(conn);
+    else
+        grant();
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void StreamReceiver::release(Connection &conn)
+{
+    conn.queued = false;
+    if (!conn.bulk)
+        return;
+    conn.bulk = false;
+    conn.rate = 0;
+    m_bulk.erase(conn.fd);
+
+    // the smallest dump first; an unknown size counts as the largest
+    std::vector<int> dead;
+    while (!m_slots || m_bulk.size() < m_slots) {
+        Connection *next = NULL;
+        std::map<int, std::unique_ptr<Connection> >::iterator it;
+        for (it = m_connections.begin(); it != m_connections.end(); ++it) {
+            Connection *c = it->second.get();
+            if (!c->queued)
+                continue;
+            unsigned long long size = c->expected ? c->expected : ULLONG_MAX;
+            unsigned long long best = !next ? 0 :
+                next->expected ? next->expected : ULLONG_MAX;
+            if (!next || size < best ||
+                (size == best && c->arrival < next->arrival))
+                next = c;
+        }
+        if (!next)
+            break;
+
+        next->queued = false;
+        next->bulk = true;
+        m_bulk.insert(next->fd);
+        if (!openFile(*next, next->pending))
+            dead.push_back(next->fd);
+        if (next->file < 0) {
+            next->bulk = false;
+            m_bulk.erase(next->fd);
+        }
+    }
+    grant();
+
+    for (size_t i = 0; i < dead.size(); ++i)
+        drop(dead[i]);
+}
+
+// -----------------------------------------------------------------------------
+void StreamReceiver::grant()
+{
+    if (!m_bandwidth || m_bulk.empty())
+        return;
+
+    unsigned long long rate = m_bandwidth / m_bulk.size();
+    std::set<int>::const_iterator it;
+    for (it = m_bulk.begin(); it != m_bulk.end(); ++it) {
+        Connection &conn = *m_connections[*it];
+        if (conn.version < 2 || conn.rate == rate)
+            continue;
+        conn.rate = rate;
+        sendFrame(conn, StreamFrame(StreamFrame::SF_GRANT, 0, rate),
+                  string());
+    }
+}
+
+// -----------------------------------------------------------------------------
+bool StreamReceiver::closeFile(Connection &conn, unsigned long long size)
+{
+    // a failed file has already been reported
+    if (conn.error) {
+        conn.error = 0;
+        release(conn);
+        return true;
+    }
+    if (conn.file < 0)
+        throw KError("Close frame without an open file.");
+
+    flush(conn);
+    if (!conn.error && ftruncate(conn.file, size) != 0)
+        fail(conn, errno, "Cannot truncate " + conn.path);
+    if (!conn.error && fdatasync(conn.file) != 0)
+        fail(conn, errno, "Cannot write " + conn.path);
+    if (conn.error) {
+        conn.error = 0;
+        release(conn);
+        return true;
+    }
+
+    ::close(conn.file);
+    conn.file = -1;
+    conn.writeback.reset();
+    cout << conn.peer << ": saved " << conn.path << " ("
+         << conn.written << " bytes)" << endl;
+    bool ret = reply(conn, 0, string());
+    release(conn);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void StreamReceiver::flush(Connection &conn)
+{
+    const char *p = conn.buffer;
+    off_t pos = conn.bufferOffset;
+    size_t len = conn.buffered;
+    conn.buffered = 0;
+    while (len) {
+        ssize_t ret = pwrite(conn.file, p, len, pos);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret < 0) {
+            fail(conn, errno, "Cannot write " + conn.path);
+            return;
+        }
+        p += ret;
+        pos += ret;
+        len -= ret;
+    }
+
+    if (pos > conn.end)
+        conn.end = pos;
+    try {
+        conn.writeback->advance(conn.end);
+    } catch (const KError &error) {
+        fail(conn, EIO, error.what());
+    }
+}
+
+// -----------------------------------------------------------------------------
+void StreamReceiver::fail(Connection &conn, int err, const string &msg)
+{
+    cerr << "WARNING: " << conn.peer << ": " << msg << ": "
+         << strerror(err) << endl;
+
+    // the rest of the file is discarded
+    conn.error = err;
+    conn.buffered = 0;
+    conn.writeback.reset();
+    ::close(conn.file);
+    conn.file = -1;
+    reply(conn, err, msg);
+}
+
+// -----------------------------------------------------------------------------
+bool StreamReceiver::reply(Connection &conn, int err, const string &msg)
+{
+    return sendFrame(conn,
+                     StreamFrame(StreamFrame::SF_STATUS, msg.size(), err),
+                     msg);
+}
+
+// -----------------------------------------------------------------------------
+bool StreamReceiver::sendFrame(Connection &conn, const StreamFrame &frame,
+                               const string &payload)
+{
+    unsigned char header[STREAM_HEADER_SIZE];
+    frame.encode(header);
+    string data(reinterpret_cast<char *>(header), sizeof header);
+    data += payload;
+
+    // the frames are small and the sender reads them between chunks, so
+    // the socket buffer has room
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t ret = send(conn.fd, data.data() + done, data.size() - done,
+                           MSG_NOSIGNAL);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret < 0) {
+            cerr << "WARNING: " << conn.peer << ": Cannot send to the sender: "
+                 << strerror(errno) << endl;
+            return false;
+        }
+        done += ret;
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+void StreamReceiver::drop(int fd)
+{
+    std::map<int, std::unique_ptr<Connection> >::iterator it =
+        m_connections.find(fd);
+    if (it == m_connections.end())
+        return;
+
+    // keep what has arrived of an unfinished file
+    Connection &conn = *it->second;
+    if (conn.file >= 0) {
+        flush(conn);
+        if (conn.file >= 0)
+            cerr << "WARNING: " << conn.peer << ": " << conn.path
+                 << " is incomplete." << endl;
+    }
+
+    epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, NULL);
+    release(conn);
+    m_connections.erase(it);
+    Debug::debug()->dbg("Connection %d closed", fd);
+}
+
+//}}}
+//{{{ Receive ------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+Receive::Receive()
+    : m_dir("/var/crash"), m_port(STREAM_PORT), m_slots(0), m_bandwidth(0)
+{
+    Debug::debug()->trace("Receive::Receive()");
+
+    m_options.push_back(new StringOption("dir", 'd', &m_dir,
+        "Save the dumps below the specified directory (/var/crash)"));
+    m_options.push_back(new StringOption("address", 'a', &m_address,
+        "Listen on the specified address only"));
+    m_options.push_back(new IntOption("port", 'p', &m_port,
+        "Listen on the specified TCP port (" +
+        StringUtil::number2string(STREAM_PORT) + ")"));
+    m_options.push_back(new IntOption("slots", 's', &m_slots,
+        "Receive at most the specified number of dumps at the same time"));
+    m_options.push_back(new IntOption("bandwidth", 'b', &m_bandwidth,
+        "Share the specified bandwidth in MiB/s among the dumps"));
+}
+
+// -----------------------------------------------------------------------------
+const char *Receive::getName() const
+{
+    return "receive";
+}
+
+// -----------------------------------------------------------------------------
+bool Receive::needsConfigfile() const
+{
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+void Receive::execute()
+{
+    Debug::debug()->trace("Receive::execute()");
+
+    if (m_slots < 0 || m_bandwidth < 0)
+        throw KError("The number of slots and the bandwidth cannot be "
+                     "negative.");
+
+    StreamReceiver receiver(m_dir);
+    receiver.setSlots(m_slots);
+    receiver.setBandwidth((unsigned long long)m_bandwidth << 20);
+    receiver.listen(m_address, m_port);
+    cout << "Saving dumps to " << m_dir << ", listening on port "
+         << receiver.port() << endl;
+
+    while (true)
+        receiver.poll(-1);
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
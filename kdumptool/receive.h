@@ -0,0 +1,479 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef RECEIVE_H
+#define RECEIVE_H
+
+#include <map>
+#include <set>
+#include <memory>
+#include <string>
+#include <chrono>
+
+#include <sys/types.h>
+
+#include "global.h"
+#include "subcommand.h"
+#include "transfer.h"
+
+class Socket;
+class WritebackWindow;
+
+// the framed dump stream of StreamTransfer and StreamReceiver
+#define STREAM_MAGIC        "KDUMPSTR"
+#define STREAM_VERSION      2
+#define STREAM_PORT         7577
+
+// size of the header of each frame
+#define STREAM_HEADER_SIZE  16
+
+// maximum payload of a control frame
+#define STREAM_MAX_CONTROL  4096
+
+// payload of one data frame from StreamTransfer
+#define STREAM_CHUNK_SIZE   (1024*1024)
+
+// write buffer of StreamReceiver for each connection
+#define STREAM_BUFFER_SIZE  (4*1024*1024)
+
+// files of this expected size need a slot on the collector, like vmcore
+#define STREAM_BULK_SIZE    (64ULL << 20)
+
+//{{{ StreamFrame --------------------------------------------------------------
+
+/**
+ * The header of a frame in the dump stream. All numbers are big endian:
+ *
+ *   type       32 bits     one of the Type values
+ *   length     32 bits     size of the payload after the header
+ *   offset     64 bits     depends on the type
+ *
+ * The sender starts with SF_HELLO and then sends each file as SF_OPEN,
+ * any number of SF_DATA frames and SF_CLOSE. The receiver answers
+ * SF_HELLO, SF_OPEN and SF_CLOSE with SF_STATUS. If a write fails, the
+ * receiver sends the error status right away and discards the rest of
+ * the file.
+ *
+ * The receiver may hold back the reply to SF_OPEN of a bulk file until
+ * it admits the file (see StreamReceiver). With version 2, it also
+ * sends SF_QUEUED while the sender waits, and SF_GRANT whenever the
+ * rate of the sender changes. A version 2 sender falls back to version 1
+ * if the receiver answers SF_HELLO with EPROTO.
+ */
+struct StreamFrame {
+
+        enum Type {
+            SF_HELLO = 1,       // payload STREAM_MAGIC, offset the version
+            SF_OPEN,            // payload "<dump directory>/<file>",
+                                // offset the expected size or 0
+            SF_DATA,            // payload written at offset
+            SF_CLOSE,           // offset the file size
+            SF_STATUS,          // offset an errno value, payload a message
+            SF_QUEUED,          // offset the number of waiting files
+            SF_GRANT            // offset bytes per second, 0 for no limit
+        };
+
+        unsigned long type;
+        unsigned long length;
+        unsigned long long offset;
+
+        StreamFrame(unsigned long type = 0, unsigned long length = 0,
+                    unsigned long long offset = 0)
+            : type(type), length(length), offset(offset)
+        {}
+
+        /**
+         * Writes STREAM_HEADER_SIZE bytes to @p buf.
+         */
+        void encode(unsigned char *buf) const;
+
+        /**
+         * Reads STREAM_HEADER_SIZE bytes from @p buf.
+         */
+        void decode(const unsigned char *buf);
+};
+
+//}}}
+//{{{ StreamTransfer -----------------------------------------------------------
+
+/**
+ * Sends the dump to a collector that runs "kdumptool receive"
+ * (kdump://host[:port]/path). The collector chooses where the dump is
+ * saved; only the last component of the path, the dump directory name,
+ * is sent with each file.
+ *
+ * Data that can be placed (see DataProvider::getPlacedData()) is sent
+ * with its offset, so a flattened stream is unflattened on the way.
+ */
+class StreamTransfer : public URLTransfer {
+
+    public:
+
+        /**
+         * Connects to the collector.
+         *
+         * @exception KError if the collector cannot be reached
+         */
+        StreamTransfer(const RootDirURLVector &urlv);
+
+        /**
+         * Closes the connection.
+         */
+        ~StreamTransfer();
+
+        /**
+         * Sends the file. The data is never saved directly.
+         *
+         * @exception KError if the collector reports an error
+         * @see Transfer::perform()
+         */
+        void perform(DataProvider *dataprovider,
+                     const StringVector &target_files,
+                     bool *directSave);
+
+        /**
+         * Sends the size with the following files, so that the collector
+         * can admit the smallest dumps first.
+         *
+         * @see Transfer::setExpectedSize()
+         */
+        void setExpectedSize(unsigned long long bytes)
+        { m_expectedSize = bytes; }
+
+        /**
+         * Returns the rate that the collector has granted in bytes per
+         * second, or 0 if the sender is not paced.
+         */
+        unsigned long long rate() const
+        { return m_rate; }
+
+    protected:
+        void connect();
+        void disconnect();
+
+        /**
+         * Connects and sends SF_HELLO with @p version.
+         *
+         * @param[out] message the message of the reply
+         * @return the errno value of the reply
+         */
+        int hello(unsigned long version, std::string &message);
+
+        /**
+         * Receives one frame from the collector and its payload.
+         *
+         * @exception KError if the frame is not a reply
+         */
+        void recvControl(StreamFrame &frame, std::string &payload);
+
+        /**
+         * Handles SF_QUEUED and SF_GRANT.
+         *
+         * @return @c false if @p frame is something else
+         */
+        bool notice(const StreamFrame &frame);
+
+        /**
+         * Waits until @p bytes more are due at the granted rate.
+         */
+        void pace(size_t bytes);
+
+        /**
+         * Sends one frame and its payload.
+         */
+        void sendFrame(const StreamFrame &frame,
+                       const char *payload = NULL);
+
+        /**
+         * Waits for SF_STATUS and throws KError if it is an error.
+         *
+         * @param[in] what the operation for the error message
+         */
+        void recvStatus(const std::string &what);
+
+        /**
+         * Checks whether the collector has already sent an error.
+         */
+        void checkStatus(const std::string &what);
+
+    private:
+        std::unique_ptr<Socket> m_socket;
+        int m_fd;
+        std::string m_dumpdir;
+        unsigned long m_version;
+        unsigned long long m_expectedSize;
+        unsigned long long m_rate;
+        unsigned long long m_paced;             // bytes since the grant
+        std::chrono::steady_clock::time_point m_grant;
+};
+
+//}}}
+//{{{ StreamReceiver -----------------------------------------------------------
+
+/**
+ * Collects dump streams from many hosts in one event loop.
+ *
+ * Each file is written to "<directory>/<dump directory>/<file>", where
+ * the dump directory is the "<ip>-<timestamp>" name that SaveDump has
+ * chosen. A sender that did not know its address ("unknown-<timestamp>")
+ * gets the address of its connection instead. Contiguous data is
+ * collected in a STREAM_BUFFER_SIZE buffer, and the write-back of each
+ * file is paced with a WritebackWindow, so that dozens of streams do
+ * not fill the page cache.
+ *
+ * When a whole rack crashes, the senders would slow each other down.
+ * Bulk files, i.e. those named "vmcore..." or with an expected size of
+ * at least STREAM_BULK_SIZE, therefore need one of a limited number of
+ * slots (see setSlots()). Other files, like the triage bundle, the
+ * README or dmesg, are admitted at once. A waiting file gets the next
+ * free slot if it is the smallest one, so that as many dumps as possible
+ * are complete early; files of unknown size come last, and the arrival
+ * decides among the rest. The bandwidth of the collector (see
+ * setBandwidth()) is shared equally by the admitted bulk files of
+ * version 2 senders, which pace themselves to their share.
+ */
+class StreamReceiver {
+
+    public:
+        /**
+         * @param[in] dir the directory for the dumps
+         */
+        StreamReceiver(const std::string &dir);
+
+        /**
+         * Closes all connections; unfinished files are kept.
+         */
+        ~StreamReceiver();
+
+        /**
+         * Starts to accept connections.
+         *
+         * @param[in] address the local address, or empty for all
+         * @param[in] port the TCP port, or 0 for any free one
+         * @exception KError if the socket cannot be bound
+         */
+        void listen(const std::string &address, int port);
+
+        /**
+         * Returns the port that the receiver listens on.
+         */
+        int port() const
+        { return m_port; }
+
+        /**
+         * Sets how many bulk files are received at the same time.
+         *
+         * @param[in] slots the number of slots, or 0 for no limit
+         */
+        void setSlots(unsigned slots)
+        { m_slots = slots; }
+
+        /**
+         * Sets the bandwidth that is shared by the bulk files.
+         *
+         * @param[in] bytes bytes per second, or 0 for no pacing
+         */
+        void setBandwidth(unsigned long long bytes)
+        { m_bandwidth = bytes; }
+
+        /**
+         * Returns the number of bulk files that wait for a slot.
+         */
+        size_t waiting() const;
+
+        /**
+         * Checks whether a file needs a slot.
+         *
+         * @param[in] name the file name without the dump directory
+         * @param[in] expected the expected size, or 0 if not known
+         */
+        static bool isBulk(const std::string &name,
+                           unsigned long long expected);
+
+        /**
+         * Returns the number of open connections.
+         */
+        size_t connections() const
+        { return m_connections.size(); }
+
+        /**
+         * Handles the events of at most @p timeout milliseconds.
+         *
+         * @param[in] timeout the timeout, or -1 to wait for an event
+         * @exception KSystemError if epoll fails
+         */
+        void poll(int timeout);
+
+    protected:
+        /**
+         * State of one sender.
+         */
+        struct Connection {
+            int fd;
+            std::string peer;
+
+            // the frame that is being received
+            unsigned char header[STREAM_HEADER_SIZE];
+            size_t headerLen;
+            StreamFrame frame;
+            size_t done;                // bytes of the payload received
+            std::string control;        // payload of a control frame
+            bool hello;
+            unsigned long version;
+
+            // admission of a bulk file
+            bool bulk;                  // holds a slot
+            bool queued;                // waits for a slot
+            std::string pending;        // name of the waiting file
+            unsigned long long expected;
+            unsigned long long arrival;
+            unsigned long long rate;    // last SF_GRANT
+
+            // the file that is being written
+            std::string path;
+            int file;
+            int error;                  // the file is discarded if set
+            unsigned long long written; // bytes received for it
+            off_t end;                  // end of the written data
+            std::unique_ptr<WritebackWindow> writeback;
+            char *buffer;
+            size_t buffered;
+            off_t bufferOffset;
+
+            Connection(int fd, const std::string &peer);
+            ~Connection();
+        };
+
+        void accept();
+
+        /**
+         * Reads what is available from a connection.
+         *
+         * @return @c false if the connection has been closed
+         */
+        bool receive(Connection &conn);
+
+        /**
+         * Handles a control frame after its payload has arrived.
+         *
+         * @return @c false if the connection must be closed
+         */
+        bool control(Connection &conn);
+
+        bool openFile(Connection &conn, const std::string &name);
+        bool closeFile(Connection &conn, unsigned long long size);
+
+        /**
+         * Writes the buffered data of the current file.
+         */
+        void flush(Connection &conn);
+
+        /**
+         * Records a write error for the current file and reports it.
+         */
+        void fail(Connection &conn, int err, const std::string &msg);
+
+        /**
+         * Sends SF_STATUS.
+         *
+         * @return @c false if sending failed
+         */
+        bool reply(Connection &conn, int err, const std::string &msg);
+
+        /**
+         * Sends a frame and its payload.
+         *
+         * @return @c false if sending failed
+         */
+        bool sendFrame(Connection &conn, const StreamFrame &frame,
+                       const std::string &payload);
+
+        /**
+         * Opens a bulk file now, or puts it in the queue.
+         */
+        bool admit(Connection &conn, const std::string &name);
+
+        /**
+         * Gives up the slot of @p conn, if any, and admits the next
+         * waiting files.
+         */
+        void release(Connection &conn);
+
+        /**
+         * Sends SF_GRANT to the admitted bulk files whose share of the
+         * bandwidth has changed.
+         */
+        void grant();
+
+        void drop(int fd);
+
+    private:
+        std::string m_dir;
+        int m_listen;
+        int m_epoll;
+        int m_port;
+        std::map<int, std::unique_ptr<Connection> > m_connections;
+        unsigned m_slots;
+        unsigned long long m_bandwidth;
+        unsigned long long m_arrivals;
+        std::set<int> m_bulk;                   // connections with a slot
+};
+
+//}}}
+//{{{ Receive ------------------------------------------------------------------
+
+/**
+ * Subcommand to collect dumps from StreamTransfer senders.
+ */
+class Receive : public Subcommand {
+
+    public:
+        /**
+         * Creates a new Receive object.
+         */
+        Receive();
+
+    public:
+        /**
+         * Returns the name of the subcommand (receive).
+         */
+        const char *getName() const;
+
+        /**
+         * The collector does not use the kdump configuration.
+         */
+        bool needsConfigfile() const;
+
+        /**
+         * Executes the function.
+         *
+         * @throw KError on any error. No exception indicates success.
+         */
+        void execute();
+
+    private:
+        std::string m_dir;
+        std::string m_address;
+        int m_port;
+        int m_slots;
+        int m_bandwidth;
+};
+
+//}}}
+
+#endif /* RECEIVE_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
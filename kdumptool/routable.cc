@@ -18,6 +18,18 @@
  */
 
 #include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <system_error>
 #include <string.h>
 
 #include <unistd.h>
@@ -38,6 +50,7 @@
 #include "debug.h"
 
 using std::min;
+using std::string;
 
 //{{{ NetLink ------------------------------------------------------------------
 
@@ -50,6 +63,10 @@ class NetLink {
 
 	~NetLink();
 
+	/**
+	 * Sets the timeout of the wait functions in milliseconds
+	 * (-1 waits forever).
+	 */
 	void setTimeout(int timeout)
 	{ m_timeout = timeout; }
 
@@ -60,6 +77,11 @@ class NetLink {
 
 	int waitRouteChange(void);
 
+	/**
+	 * Waits for any change of the links, addresses or routes.
+	 */
+	int waitNetworkChange(void);
+
         const char *prefSrc(void) const
         { return m_prefsrc; }
 
@@ -74,6 +96,11 @@ class NetLink {
 		virtual bool check(const struct sockaddr_nl *nladdr,
 				   const struct nlmsghdr *nh) const;
 	};
+	class ChangeRecvCheck : public RecvCheck {
+	    public:
+		virtual bool check(const struct sockaddr_nl *nladdr,
+				   const struct nlmsghdr *nh) const;
+	};
 	class ReplyRecvCheck : public RecvCheck {
 	    public:
 		ReplyRecvCheck(unsigned peer, unsigned pid, unsigned seq)
@@ -100,7 +127,7 @@ class NetLink {
 
 	int m_fd;
 	struct sockaddr_nl m_local;
-	static unsigned m_seq;
+	static std::atomic<unsigned> m_seq;
 
 	size_t m_buflen;
 	unsigned char *m_buffer;
@@ -110,7 +137,7 @@ class NetLink {
         char m_prefsrc[INET6_ADDRSTRLEN];
 };
 
-unsigned NetLink::m_seq;
+std::atomic<unsigned> NetLink::m_seq;
 
 // -----------------------------------------------------------------------------
 NetLink::NetLink(unsigned subscribe, size_t recv_max)
@@ -170,6 +197,24 @@ bool NetLink::RouteRecvCheck::check(const struct sockaddr_nl *nladdr,
     return true;
 }
 
+// -----------------------------------------------------------------------------
+bool NetLink::ChangeRecvCheck::check(const struct sockaddr_nl *nladdr,
+				     const struct nlmsghdr *nh) const
+{
+    Debug::debug()->trace("ChangeRecvCheck::check(%u)",
+			  (unsigned)nh->nlmsg_type);
+
+    switch (nh->nlmsg_type) {
+    case RTM_NEWLINK:
+    case RTM_DELLINK:
+    case RTM_NEWADDR:
+    case RTM_DELADDR:
+	return true;
+    default:
+	return RouteRecvCheck().check(nladdr, nh);
+    }
+}
+
 // -----------------------------------------------------------------------------
 bool NetLink::ReplyRecvCheck::check(const struct sockaddr_nl *nladdr,
 				    const struct nlmsghdr *nh) const
@@ -199,7 +244,14 @@ int NetLink::receive(const RecvCheck &rc)
     pd.events = POLLIN;
 
     clock_gettime(CLOCK_MONOTONIC, &tsend);
-    tsend.tv_sec += m_timeout;
+    if (m_timeout > 0) {
+	tsend.tv_sec += m_timeout / 1000;
+	tsend.tv_nsec += (m_timeout % 1000) * 1000000L;
+	if (tsend.tv_nsec >= 1000000000L) {
+	    tsend.tv_sec++;
+	    tsend.tv_nsec -= 1000000000L;
+	}
+    }
 
     while (1) {
 	struct nlmsghdr *nh;
@@ -266,6 +318,15 @@ int NetLink::waitRouteChange(void)
     return receive(rc);
 }
 
+// -----------------------------------------------------------------------------
+int NetLink::waitNetworkChange(void)
+{
+    Debug::debug()->trace("waitNetworkChange()");
+
+    ChangeRecvCheck rc;
+    return receive(rc);
+}
+
 // -----------------------------------------------------------------------------
 int NetLink::talk(struct nlmsghdr *req, unsigned peer, unsigned groups)
 {
@@ -425,13 +486,83 @@ int NetLink::parseAttrs(const struct rtattr *rta, size_t len)
 
 //}}}
 
+// how long to wait for the other address family after the first answer
+#define RESOLUTION_DELAY        50      // milliseconds (RFC 8305)
+
+// retry interval for name resolution if the network does not change
+#define RESOLVE_RETRY           1000    // milliseconds
+
+// changes that arrive within this time are handled together
+#define CHANGE_SETTLE           20      // milliseconds
+
+// -----------------------------------------------------------------------------
+static int remainingMs(const struct timespec &tstop)
+{
+    struct timespec tsnow;
+    clock_gettime(CLOCK_MONOTONIC, &tsnow);
+    return (tstop.tv_sec - tsnow.tv_sec) * 1000 +
+        (tstop.tv_nsec - tsnow.tv_nsec) / 1000000L;
+}
+
+// -----------------------------------------------------------------------------
+static bool softGaiError(int res)
+{
+    return res == EAI_NONAME || res == EAI_FAIL || res == EAI_NODATA ||
+        res == EAI_AGAIN || res == EAI_ADDRFAMILY;
+}
+
+/**
+ * Name lookup of one host for IPv6 and IPv4 in parallel. The lookup
+ * threads are detached, so a resolver that hangs does not block the
+ * caller beyond its timeout; the state is shared with them, and the
+ * last owner frees the results that nobody has taken.
+ */
+struct FamilyLookup {
+    std::mutex mutex;
+    std::condition_variable cond;
+    int res[2];
+    int err[2];
+    struct addrinfo *ai[2];
+    bool done[2];
+
+    FamilyLookup()
+    {
+        for (int i = 0; i < 2; ++i) {
+            res[i] = err[i] = 0;
+            ai[i] = NULL;
+            done[i] = false;
+        }
+    }
+
+    ~FamilyLookup()
+    {
+        for (int i = 0; i < 2; ++i)
+            if (ai[i])
+                freeaddrinfo(ai[i]);
+    }
+
+    bool anyResolved() const
+    { return (done[0] && !res[0]) || (done[1] && !res[1]); }
+
+    bool allDone() const
+    { return done[0] && done[1]; }
+};
+
 //{{{ Routable -----------------------------------------------------------------
 
 // -----------------------------------------------------------------------------
 Routable::~Routable()
 {
-    if (m_ai)
-	freeaddrinfo(m_ai);
+    clearAddresses();
+}
+
+// -----------------------------------------------------------------------------
+void Routable::clearAddresses(void)
+{
+    std::vector<struct addrinfo *>::iterator it;
+    for (it = m_ai.begin(); it != m_ai.end(); ++it)
+	freeaddrinfo(*it);
+    m_ai.clear();
 }
 
 // -----------------------------------------------------------------------------
@@ -442,11 +573,15 @@ bool Routable::hasRoute(void)
 
     Debug::debug()->trace("hasRoute(%s)", m_host.c_str());
 
-    for (p = m_ai; p; p = p->ai_next) {
-        if (nl.checkRoute(p) == 0) {
-            Debug::debug()->dbg("m_prefsrc='%s'", nl.prefSrc());
-            m_prefsrc.assign(nl.prefSrc());
-	    return true;
+    // IPv6 comes first, see resolve()
+    std::vector<struct addrinfo *>::const_iterator it;
+    for (it = m_ai.begin(); it != m_ai.end(); ++it) {
+        for (p = *it; p; p = p->ai_next) {
+            if (nl.checkRoute(p) == 0) {
+                Debug::debug()->dbg("m_prefsrc='%s'", nl.prefSrc());
+                m_prefsrc.assign(nl.prefSrc());
+                return true;
+            }
         }
     }
 
@@ -454,10 +589,8 @@ bool Routable::hasRoute(void)
 }
 
 // -----------------------------------------------------------------------------
-bool Routable::resolve(void)
+bool Routable::resolve(int timeout)
 {
-    struct addrinfo hints;
-    int res;
     KString raw_host(m_host);
 
     // remove IPv6 URL bracketing for getaddrinfo
@@ -467,62 +600,184 @@ bool Routable::resolve(void)
 
     Debug::debug()->trace("resolve(%s)", raw_host.c_str());
 
-    if (m_ai)
-	freeaddrinfo(m_ai);
-
-    memset(&hints, 0, sizeof hints);
-    hints.ai_family = AF_UNSPEC;
-    hints.ai_socktype = SOCK_RAW;
-    res = getaddrinfo(raw_host.c_str(), NULL, &hints, &m_ai);
-
-    if (res == 0)
-	return true;
-
-    if (res == EAI_SYSTEM)
-	throw KSystemError("Name resolution failed", errno);
+    clearAddresses();
+
+    // Happy Eyeballs: ask for AAAA and A records separately, so that
+    // a slow answer for one family does not delay the other one
+    static const int families[2] = { AF_INET6, AF_INET };
+    std::shared_ptr<FamilyLookup> lookup(new FamilyLookup);
+    for (int i = 0; i < 2; ++i) {
+        auto fn = [lookup, raw_host, i]() {
+            struct addrinfo hints;
+            struct addrinfo *ai = NULL;
+            memset(&hints, 0, sizeof hints);
+            hints.ai_family = families[i];
+            hints.ai_socktype = SOCK_RAW;
+            int res = getaddrinfo(raw_host.c_str(), NULL, &hints, &ai);
+            int err = errno;
+
+            std::lock_guard<std::mutex> lock(lookup->mutex);
+            lookup->res[i] = res;
+            lookup->err[i] = err;
+            lookup->ai[i] = res ? NULL : ai;
+            lookup->done[i] = true;
+            lookup->cond.notify_all();
+        };
+        try {
+            std::thread(fn).detach();
+        } catch (const std::system_error &) {
+            fn();
+        }
+    }
 
-    if (res != EAI_NONAME && res != EAI_FAIL && res != EAI_NODATA &&
-        res != EAI_AGAIN)
-	throw KGaiError("Name resolution failed", res);
+    std::unique_lock<std::mutex> lock(lookup->mutex);
+    auto deadline = std::chrono::steady_clock::now() +
+        std::chrono::milliseconds(std::max(timeout, 0));
+    lookup->cond.wait_until(lock, deadline, [&lookup]() {
+            return lookup->anyResolved() || lookup->allDone();
+        });
+
+    // give the other family a moment, so that both are tried
+    if (lookup->anyResolved() && !lookup->allDone())
+        lookup->cond.wait_for(lock,
+            std::chrono::milliseconds(RESOLUTION_DELAY),
+            [&lookup]() { return lookup->allDone(); });
+
+    for (int i = 0; i < 2; ++i) {
+        if (lookup->ai[i]) {
+            m_ai.push_back(lookup->ai[i]);
+            lookup->ai[i] = NULL;
+        }
+    }
+    if (!m_ai.empty())
+        return true;
 
-    return false;
+    // both failed: retry unless the resolver is broken
+    for (int i = 0; i < 2; ++i) {
+        if (!lookup->done[i] || softGaiError(lookup->res[i]))
+            return false;
+    }
+    if (lookup->res[0] == EAI_SYSTEM)
+	throw KSystemError("Name resolution failed", lookup->err[0]);
+    throw KGaiError("Name resolution failed", lookup->res[0]);
 }
 
 // -----------------------------------------------------------------------------
-bool Routable::check(int timeout)
+bool Routable::probe(int timeout)
 {
-    // Resolve the target hostname. An attempt is made regularly until the
-    // hostname can be resolved or a specified timeout for network operations
-    // is reached.
     struct timespec tstop;
     clock_gettime(CLOCK_MONOTONIC, &tstop);
     tstop.tv_sec += timeout;
 
-    while (!resolve()) {
-        struct timespec tsnow;
-        clock_gettime(CLOCK_MONOTONIC, &tsnow);
-        int interval = (tstop.tv_sec - tsnow.tv_sec) * 1000;
-        interval += (tstop.tv_nsec - tsnow.tv_nsec) / 1000000L;
-        if (interval <= 0)
+    // Subscribe before the first attempt, so that no change is missed.
+    // Every change of a link, an address or a route retries at once;
+    // the resolver may also become reachable without a change (e.g.
+    // when the DNS server starts), so resolution is also retried
+    // after RESOLVE_RETRY.
+    NetLink nl(RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR |
+               RTMGRP_IPV4_ROUTE | RTMGRP_IPV6_ROUTE);
+
+    for (;;) {
+        if (m_ai.empty())
+            resolve(remainingMs(tstop));
+        if (!m_ai.empty() && hasRoute())
+            return true;
+
+        int left = remainingMs(tstop);
+        if (left <= 0)
+            return false;
+
+        nl.setTimeout(m_ai.empty() ? min(left, RESOLVE_RETRY) : left);
+        int res = nl.waitNetworkChange();
+        if (res == 0) {
+            // let a burst of changes (link, address, route) settle
+            nl.setTimeout(CHANGE_SETTLE);
+            while (nl.waitNetworkChange() == 0)
+                ;
+            // the addresses may depend on the new configuration
+            clearAddresses();
+        } else if (res != -ETIME)
             return false;
+    }
+}
+
+// reachability and preferred source address of each host checked so far
+typedef std::pair<bool, string> RouteResult;
+static std::map<string, std::shared_future<RouteResult> > routeCache;
+static std::mutex routeCacheMutex;
+
+// -----------------------------------------------------------------------------
+bool Routable::check(int timeout)
+{
+    std::shared_future<RouteResult> cached;
+    std::promise<RouteResult> promise;
+    {
+        std::lock_guard<std::mutex> lock(routeCacheMutex);
+        std::map<string, std::shared_future<RouteResult> >::iterator it =
+            routeCache.find(m_host);
+        if (it != routeCache.end())
+            cached = it->second;
+        else
+            routeCache[m_host] = promise.get_future().share();
+    }
+
+    // another thread checks it or has checked it already
+    if (cached.valid()) {
+        RouteResult res = cached.get();
+        Debug::debug()->dbg("Cached route to %s: %s", m_host.c_str(),
+                            res.first ? "reachable" : "unreachable");
+        m_prefsrc = res.second;
+        return res.first;
+    }
 
-        // Sleep, at most for 1 second.
-        struct timespec wait_period;
-        interval = min(interval, 1000);
-        wait_period.tv_sec = interval / 1000;
-        wait_period.tv_nsec = (interval % 1000) * 1000 * 1000;
-        nanosleep(&wait_period, NULL);
+    try {
+        bool reachable = probe(timeout);
+        promise.set_value(RouteResult(reachable, m_prefsrc));
+        return reachable;
+    } catch (...) {
+        // do not cache errors, the next caller tries again
+        promise.set_exception(std::current_exception());
+        std::lock_guard<std::mutex> lock(routeCacheMutex);
+        routeCache.erase(m_host);
+        throw;
     }
+}
 
-    // Check there is an existing route.
-    NetLink nl(RTMGRP_IPV4_ROUTE | RTMGRP_IPV6_ROUTE);
-    nl.setTimeout(timeout);
+// -----------------------------------------------------------------------------
+void Routable::checkAll(const StringVector &hosts, int timeout)
+{
+    std::set<string> unique(hosts.begin(), hosts.end());
+    std::vector<std::thread> threads;
+
+    Debug::debug()->trace("Routable::checkAll(%zu hosts)", unique.size());
+
+    for (std::set<string>::const_iterator it = unique.begin();
+         it != unique.end(); ++it) {
+        string host = *it;
+        auto fn = [host, timeout]() {
+            try {
+                Routable(host).check(timeout);
+            } catch (const std::exception &e) {
+                Debug::debug()->dbg("Cannot check route to %s: %s",
+                                    host.c_str(), e.what());
+            }
+        };
+        try {
+            threads.push_back(std::thread(fn));
+        } catch (const std::system_error &) {
+            fn();
+        }
+    }
 
-    while (!hasRoute())
-	if (nl.waitRouteChange() != 0)
-	    return false;
+    for (size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+}
 
-    return true;
+// -----------------------------------------------------------------------------
+void Routable::clearCache(void)
+{
+    std::lock_guard<std::mutex> lock(routeCacheMutex);
+    routeCache.clear();
 }
 
 //}}}
@@ -20,9 +20,11 @@
 #define ROUTABLE_H
 
 #include <string>
+#include <vector>
 
 #include "subcommand.h"
 #include "global.h"
+#include "stringvector.h"
 
 //{{{ Routable -----------------------------------------------------------------
 
@@ -30,31 +32,71 @@ struct addrinfo;
 
 /**
  * Remote target that can be checked for routability.
+ *
+ * The result of check() is cached for the whole process, because the
+ * same host is checked when the dump targets are set up, by the transfer
+ * (for every file with FTP) and for the notification. A host is checked
+ * only once even if several threads ask for it at the same time.
  */
 class Routable {
 
     public:
 	Routable(const std::string &host)
-		: m_host(host), m_ai(NULL)
+		: m_host(host)
 	{}
 
 	~Routable();
 
+	/**
+	 * Waits until the host can be resolved and has a route.
+	 *
+	 * @param[in] timeout seconds to wait; only used on the first call
+	 *            for a host, later calls return the cached result
+	 * @return @c true if the host is reachable
+	 */
 	bool check(int timeout);
 
         const std::string& prefsrc(void) const
         { return m_prefsrc; }
 
+	/**
+	 * Checks several hosts concurrently and caches the results, so
+	 * that the total wait is one @p timeout rather than one per host.
+	 * Errors are logged and left to the next check() of the host.
+	 *
+	 * @param[in] hosts the hosts (duplicates are checked once)
+	 * @param[in] timeout seconds to wait
+	 */
+	static void checkAll(const StringVector &hosts, int timeout);
+
+	/**
+	 * Forgets all cached results.
+	 */
+	static void clearCache(void);
+
     protected:
-	bool resolve(void);
+	/**
+	 * Resolves the host name for IPv6 and IPv4 concurrently.
+	 *
+	 * @param[in] timeout milliseconds to wait for an answer
+	 * @return @c true if at least one address has been found
+	 * @exception KError if the resolver fails (not just the lookup)
+	 */
+	bool resolve(int timeout);
+
+	void clearAddresses(void);
 
 	bool hasRoute(void);
 
+	/**
+	 * Uncached implementation of check().
+	 */
+	bool probe(int timeout);
+
     private:
-	int m_nlfd;
 	std::string m_host;
         std::string m_prefsrc;
-	struct addrinfo *m_ai;
+	std::vector<struct addrinfo *> m_ai;	// one list per family
 };
 
 //}}}
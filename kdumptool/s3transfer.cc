@@ -0,0 +1,680 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+
+#include <strings.h>
+
+#include "global.h"
+#include "debug.h"
+#include "configuration.h"
+#include "dataprovider.h"
+#include "checksum.h"
+#include "routable.h"
+#include "savestats.h"
+#include "stringutil.h"
+#include "s3transfer.h"
+
+using std::string;
+using std::cerr;
+using std::endl;
+
+// longest response body that is kept for error messages
+#define S3_RESPONSE_MAX     (64*1024)
+
+//{{{ S3Multipart --------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+string S3Multipart::encodeKey(const string &key, bool slash)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    string ret;
+
+    for (string::const_iterator it = key.begin(); it != key.end(); ++it) {
+        unsigned char c = *it;
+        if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~' ||
+            (slash && c == '/'))
+            ret += c;
+        else {
+            ret += '%';
+            ret += hex[c >> 4];
+            ret += hex[c & 0xf];
+        }
+    }
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+string S3Multipart::xmlValue(const string &xml, const string &tag)
+{
+    string::size_type start = xml.find("<" + tag + ">");
+    if (start == string::npos)
+        return string();
+    start += tag.size() + 2;
+    string::size_type end = xml.find("</" + tag + ">", start);
+    if (end == string::npos)
+        return string();
+
+    // the predefined entities are all that S3 uses
+    static const char *const entities[][2] = {
+        { "&lt;", "<" }, { "&gt;", ">" }, { "&quot;", "\"" },
+        { "&apos;", "'" }, { "&amp;", "&" }
+    };
+    string ret;
+    for (string::size_type i = start; i < end; ) {
+        size_t e;
+        for (e = 0; e < sizeof entities / sizeof entities[0]; ++e) {
+            size_t n = strlen(entities[e][0]);
+            if (xml.compare(i, n, entities[e][0]) == 0) {
+                ret += entities[e][1];
+                i += n;
+                break;
+            }
+        }
+        if (e == sizeof entities / sizeof entities[0])
+            ret += xml[i++];
+    }
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+string S3Multipart::headerValue(const char *line, size_t len,
+                                const char *name)
+{
+    size_t n = strlen(name);
+    if (len <= n || line[n] != ':' || strncasecmp(line, name, n) != 0)
+        return string();
+
+    KString ret(line + n + 1, len - n - 1);
+    return ret.trim(" \t\r\n");
+}
+
+// -----------------------------------------------------------------------------
+string S3Multipart::completion(const std::vector<Part> &parts)
+{
+    std::ostringstream ss;
+    ss << "<CompleteMultipartUpload "
+          "xmlns=\"http://s3.amazonaws.com/doc/2006-03-01/\">";
+    std::vector<Part>::const_iterator it;
+    for (it = parts.begin(); it != parts.end(); ++it) {
+        ss << "<Part><PartNumber>" << it->number << "</PartNumber><ETag>";
+        for (string::const_iterator c = it->etag.begin();
+             c != it->etag.end(); ++c) {
+            if (*c == '&')
+                ss << "&amp;";
+            else if (*c == '<')
+                ss << "&lt;";
+            else if (*c == '>')
+                ss << "&gt;";
+            else
+                ss << *c;
+        }
+        ss << "</ETag></Part>";
+    }
+    ss << "</CompleteMultipartUpload>";
+    return ss.str();
+}
+
+// -----------------------------------------------------------------------------
+string S3Multipart::manifest(const string &key, const string &uploadId,
+                             const std::vector<Part> &parts)
+{
+    std::ostringstream ss;
+    ss << "# S3 multipart upload of " << key << endl;
+    ss << "# upload ID " << uploadId << endl;
+    ss << "# <part> <offset> <size> <crc32c> <etag>" << endl;
+    std::vector<Part>::const_iterator it;
+    for (it = parts.begin(); it != parts.end(); ++it)
+        ss << it->number << ' ' << it->offset << ' ' << it->size << ' '
+           << it->crc << ' ' << it->etag << endl;
+    return ss.str();
+}
+
+//}}}
+//{{{ S3Transfer ---------------------------------------------------------------
+
+bool S3Transfer::curl_global_inititalised = false;
+
+// -----------------------------------------------------------------------------
+static size_t s3_read(char *buffer, size_t size, size_t nmemb, void *data)
+{
+    S3Transfer::Request *req = reinterpret_cast<S3Transfer::Request *>(data);
+    size_t n = std::min(req->len - req->pos, size * nmemb);
+    memcpy(buffer, req->buf.get() + req->pos, n);
+    req->pos += n;
+    return n;
+}
+
+// -----------------------------------------------------------------------------
+static int s3_seek(void *data, curl_off_t offset, int origin)
+{
+    // the whole body is in memory, so libcurl can always send it again
+    S3Transfer::Request *req = reinterpret_cast<S3Transfer::Request *>(data);
+    if (origin != SEEK_SET || offset < 0 || (size_t)offset > req->len)
+        return CURL_SEEKFUNC_FAIL;
+    req->pos = offset;
+    return CURL_SEEKFUNC_OK;
+}
+
+// -----------------------------------------------------------------------------
+static size_t s3_write(char *buffer, size_t size, size_t nmemb, void *data)
+{
+    S3Transfer::Request *req = reinterpret_cast<S3Transfer::Request *>(data);
+    size_t n = size * nmemb;
+    if (req->response.size() < S3_RESPONSE_MAX)
+        req->response.append(buffer, std::min(n, S3_RESPONSE_MAX -
+                                              req->response.size()));
+    return n;
+}
+
+// -----------------------------------------------------------------------------
+static size_t s3_header(char *buffer, size_t size, size_t nitems, void *data)
+{
+    S3Transfer::Request *req = reinterpret_cast<S3Transfer::Request *>(data);
+    string etag = S3Multipart::headerValue(buffer, size * nitems, "ETag");
+    if (!etag.empty())
+        req->etag = etag;
+    return size * nitems;
+}
+
+// -----------------------------------------------------------------------------
+S3Transfer::S3Transfer(const RootDirURLVector &urlv)
+    : URLTransfer(urlv), m_multi(NULL), m_headers(NULL), m_meter(NULL)
+{
+    if (urlv.size() > 1)
+	cerr << "WARNING: First dump target used; rest ignored." << endl;
+    const RootDirURL &parser = urlv.front();
+
+    KTRACE("S3Transfer::S3Transfer(%s)", parser.getURL().c_str());
+
+    Configuration *config = Configuration::config();
+
+    // "s3+http" is for local test servers without TLS
+    m_endpoint = strncasecmp(parser.getURL().c_str(), "s3+http:", 8) == 0
+        ? "http://" : "https://";
+    m_endpoint += parser.getHostname();
+    if (parser.getPort() > 0)
+        m_endpoint += ":" + StringUtil::number2string(parser.getPort());
+    m_prefix = parser.getPath();
+    m_tuning = NetTuning::forHost(parser.getHostname());
+
+    m_sigv4 = "aws:amz:" + config->KDUMP_S3_REGION.value() + ":s3";
+    if (!parser.getUsername().empty())
+        m_userpwd = parser.getUsername() + ":" + parser.getPassword();
+
+    long partSize = config->KDUMP_S3_PART_SIZE.value();
+    m_partSize = std::max((size_t)std::max(partSize, 0L) << 20,
+                          S3_MIN_PART_SIZE);
+    m_connections = std::max(config->KDUMP_S3_CONNECTIONS.value(), 1);
+    KDBG("S3 endpoint %s, %lu byte parts, %u connections",
+         m_endpoint.c_str(), (unsigned long)m_partSize, m_connections);
+
+    if (!curl_global_inititalised) {
+        KDBG("Calling curl_global_init()");
+        CURLcode err = curl_global_init(CURL_GLOBAL_ALL);
+        if (err != 0)
+            throw KError("curl_global_init() failed.");
+        curl_global_inititalised = true;
+    }
+
+    // all requests share the connection cache of the multi handle
+    m_multi = curl_multi_init();
+    if (!m_multi)
+        throw KError("S3Transfer: curl_multi_init returned NULL");
+
+    // the payload is protected by TLS, it need not be hashed up front;
+    // waiting for 100-continue costs a round trip for every part
+    struct curl_slist *list;
+    list = curl_slist_append(NULL, "x-amz-content-sha256: UNSIGNED-PAYLOAD");
+    if (list)
+        m_headers = list;
+    list = list ? curl_slist_append(list, "Expect:") : NULL;
+    if (!list) {
+        curl_slist_free_all(m_headers);
+        curl_multi_cleanup(m_multi);
+        throw KError("S3Transfer: curl_slist_append returned NULL");
+    }
+}
+
+// -----------------------------------------------------------------------------
+S3Transfer::~S3Transfer()
+{
+    if (m_headers)
+        curl_slist_free_all(m_headers);
+    if (m_multi)
+        curl_multi_cleanup(m_multi);
+}
+
+// -----------------------------------------------------------------------------
+void S3Transfer::setup(Request &req, const char *method, const string &url,
+                       size_t len)
+{
+    KDBG("S3 %s %s (%lu bytes)", method, url.c_str(), (unsigned long)len);
+
+    if (!req.curl) {
+        req.curl = curl_easy_init();
+        if (!req.curl)
+            throw KError("S3Transfer: curl_easy_init returned NULL");
+    }
+    CURL *curl = req.curl;
+    Configuration *config = Configuration::config();
+    long timeout = config->KDUMP_NET_TIMEOUT.value();
+
+    // every request sends a body, so the method is only a name
+    CURLcode err = curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, req.error);
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(curl, CURLOPT_PRIVATE, &req);
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method);
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE,
+                               (curl_off_t)len);
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(curl, CURLOPT_READFUNCTION, s3_read);
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(curl, CURLOPT_READDATA, &req);
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(curl, CURLOPT_SEEKFUNCTION, s3_seek);
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(curl, CURLOPT_SEEKDATA, &req);
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, s3_write);
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(curl, CURLOPT_WRITEDATA, &req);
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, s3_header);
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(curl, CURLOPT_HEADERDATA, &req);
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(curl, CURLOPT_HTTPHEADER, m_headers);
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(curl, CURLOPT_SOCKOPTFUNCTION, curl_sockopt);
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(curl, CURLOPT_SOCKOPTDATA, &m_tuning);
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, timeout);
+    // a stalled connection fails like a lost one
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, timeout);
+    if (err == CURLE_OK && !m_userpwd.empty()) {
+        err = curl_easy_setopt(curl, CURLOPT_AWS_SIGV4, m_sigv4.c_str());
+        if (err == CURLE_OK)
+            err = curl_easy_setopt(curl, CURLOPT_USERPWD, m_userpwd.c_str());
+    }
+    if (err != CURLE_OK)
+        throw KError(string("CURL error: ") +
+                     (req.error[0] ? req.error : curl_easy_strerror(err)));
+
+    req.len = len;
+}
+
+// -----------------------------------------------------------------------------
+void S3Transfer::start(Request &req)
+{
+    req.pos = 0;
+    req.response.clear();
+    req.etag.clear();
+    req.error[0] = 0;
+    req.result = CURLE_OK;
+    req.status = 0;
+    req.done = false;
+
+    CURLMcode merr = curl_multi_add_handle(m_multi, req.curl);
+    if (merr != CURLM_OK)
+        throw KError(string("CURL error: ") + curl_multi_strerror(merr));
+    req.busy = true;
+}
+
+// -----------------------------------------------------------------------------
+bool S3Transfer::poll()
+{
+    int running;
+    CURLMcode merr = curl_multi_perform(m_multi, &running);
+    if (merr != CURLM_OK)
+        throw KError(string("CURL error: ") + curl_multi_strerror(merr));
+
+    bool finished = false;
+    CURLMsg *msg;
+    int left;
+    while ((msg = curl_multi_info_read(m_multi, &left)) != NULL) {
+        if (msg->msg != CURLMSG_DONE)
+            continue;
+
+        // msg is invalid after the handle has been removed
+        CURL *curl = msg->easy_handle;
+        CURLcode result = msg->data.result;
+        char *priv = NULL;
+        curl_easy_getinfo(curl, CURLINFO_PRIVATE, &priv);
+        Request *req = reinterpret_cast<Request *>(priv);
+        curl_multi_remove_handle(m_multi, curl);
+        if (!req)
+            continue;
+
+        req->result = result;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &req->status);
+        req->busy = false;
+        req->done = true;
+        finished = true;
+    }
+
+    if (!finished && running) {
+        merr = curl_multi_wait(m_multi, NULL, 0, 1000, NULL);
+        if (merr != CURLM_OK)
+            throw KError(string("CURL error: ") + curl_multi_strerror(merr));
+    }
+    return finished;
+}
+
+// -----------------------------------------------------------------------------
+bool S3Transfer::transient(const Request &req) const
+{
+    switch (req.result) {
+        case CURLE_OK:
+            break;
+        case CURLE_COULDNT_CONNECT:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_OPERATION_TIMEDOUT:
+        case CURLE_PARTIAL_FILE:
+        case CURLE_GOT_NOTHING:
+            return true;
+        default:
+            return false;
+    }
+
+    // request timeout, slow down and server errors
+    return req.status == 408 || req.status == 429 || req.status >= 500;
+}
+
+// -----------------------------------------------------------------------------
+string S3Transfer::failure(const Request &req, const string &what) const
+{
+    if (req.result != CURLE_OK)
+        return "CURL error: " + string(req.error[0]
+                                       ? req.error
+                                       : curl_easy_strerror(req.result));
+
+    string ret = "S3 " + what + " failed with HTTP status " +
+        StringUtil::number2string(req.status);
+    string code = S3Multipart::xmlValue(req.response, "Code");
+    if (!code.empty())
+        ret += " (" + code + ": " +
+            S3Multipart::xmlValue(req.response, "Message") + ")";
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void S3Transfer::execute(Request &req, const char *what)
+{
+    int retries = Configuration::config()->KDUMP_TRANSFER_RETRIES.value();
+    while (true) {
+        start(req);
+        while (!req.done)
+            poll();
+        req.done = false;
+
+        if (req.result == CURLE_OK && req.status / 100 == 2)
+            return;
+        if (retries <= 0 || !transient(req))
+            throw KError(failure(req, what));
+        --retries;
+        cerr << "WARNING: " << failure(req, what) << ", retrying ("
+             << retries << " retries left)" << endl;
+    }
+}
+
+// -----------------------------------------------------------------------------
+string S3Transfer::objectURL(const string &key, const string &query) const
+{
+    string ret = m_endpoint + S3Multipart::encodeKey(key);
+    if (!query.empty())
+        ret += "?" + query;
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+size_t S3Transfer::fill(DataProvider *dataprovider, Request &req)
+{
+    if (!req.buf)
+        req.buf = BufferPool::pool()->get(m_partSize);
+
+    size_t len = 0;
+    while (len < m_partSize) {
+        size_t ret = m_meter->source([&]() {
+                return dataprovider->getData(req.buf.get() + len,
+                                             m_partSize - len);
+            });
+        if (ret == 0)
+            break;
+        len += ret;
+    }
+    m_meter->moved(len);
+
+    Crc32c crc;
+    crc.update(req.buf.get(), len);
+    req.len = len;
+    req.part.size = len;
+    req.part.crc = crc.hex();
+    return len;
+}
+
+// -----------------------------------------------------------------------------
+void S3Transfer::perform(DataProvider *dataprovider,
+                         const StringVector &target_files,
+                         bool *directSave)
+{
+    KTRACE("S3Transfer::perform(%p, [ \"%s\"%s ])",
+	dataprovider, target_files.front().c_str(),
+	target_files.size() > 1 ? ", ..." : "");
+
+    if (directSave)
+        *directSave = false;
+
+    const RootDirURL &parser = getURLVector().front();
+    Configuration *config = Configuration::config();
+    Routable rt(parser.getHostname());
+    if (!rt.check(config->KDUMP_NET_TIMEOUT.value()))
+	cerr << "WARNING: Dump target not reachable" << endl;
+
+    FilePath key = m_prefix;
+    key.appendPath(target_files.front());
+
+    // the data is read between network rounds, the rest is network time
+    TransferMeter meter("s3", target_files.front());
+    meter.sinkIsRemainder();
+    m_meter = &meter;
+
+    try {
+        dataprovider->prepare();
+
+        Request first;
+        size_t len = fill(dataprovider, first);
+        if (len < m_partSize) {
+            setup(first, "PUT", objectURL(key, string()), len);
+            execute(first, "PutObject");
+        } else
+            multipart(dataprovider, key, first);
+
+        dataprovider->finish();
+    } catch (...) {
+        m_meter = NULL;
+        dataprovider->setError(true);
+        dataprovider->finish();
+        throw;
+    }
+    m_meter = NULL;
+}
+
+// -----------------------------------------------------------------------------
+void S3Transfer::multipart(DataProvider *dataprovider, const string &key,
+                           Request &first)
+{
+    Request control;
+    setup(control, "POST", objectURL(key, "uploads"), 0);
+    execute(control, "CreateMultipartUpload");
+    string uploadId = S3Multipart::xmlValue(control.response, "UploadId");
+    if (uploadId.empty())
+        throw KError("S3 server returned no upload ID for " + key + ".");
+    string idQuery = "uploadId=" + S3Multipart::encodeKey(uploadId, false);
+    KDBG("Multipart upload %s of %s", uploadId.c_str(), key.c_str());
+
+    int retries = Configuration::config()->KDUMP_TRANSFER_RETRIES.value();
+    std::unique_ptr<Request[]> slots(new Request[m_connections]);
+    auto send = [&](Request &req) {
+        setup(req, "PUT", objectURL(key, "partNumber=" +
+                                    StringUtil::number2string(
+                                        req.part.number) +
+                                    "&" + idQuery), req.len);
+        start(req);
+    };
+
+    m_parts.clear();
+    try {
+        // the first part decided that this is a multipart upload
+        Request &req0 = slots[0];
+        req0.buf = std::move(first.buf);
+        req0.part = first.part;
+        req0.part.number = 1;
+        req0.part.offset = 0;
+        req0.len = first.len;
+        req0.retries = retries;
+        send(req0);
+
+        unsigned next = 1;
+        unsigned long long offset = first.len;
+        bool eof = false;
+        while (true) {
+            unsigned busy = 0;
+            for (unsigned i = 0; i < m_connections; ++i) {
+                Request &req = slots[i];
+                if (req.done) {
+                    req.done = false;
+                    if (req.result == CURLE_OK && req.status / 100 == 2 &&
+                        !req.etag.empty()) {
+                        req.part.etag = req.etag;
+                        m_parts.push_back(req.part);
+                    } else {
+                        string what = "UploadPart " +
+                            StringUtil::number2string(req.part.number);
+                        if (req.retries <= 0 || !transient(req))
+                            throw KError(req.status / 100 == 2
+                                         ? "S3 " + what + " returned no ETag"
+                                         : failure(req, what));
+                        --req.retries;
+                        cerr << "WARNING: " << failure(req, what)
+                             << ", retrying (" << req.retries
+                             << " retries left)" << endl;
+                        send(req);
+                    }
+                }
+
+                // the buffer of a finished part takes the next one
+                if (!req.busy && !eof) {
+                    size_t len = fill(dataprovider, req);
+                    if (len < m_partSize)
+                        eof = true;
+                    if (len > 0) {
+                        if (next >= S3_MAX_PARTS)
+                            throw KError("More than " +
+                                StringUtil::number2string(S3_MAX_PARTS) +
+                                " parts for " + key +
+                                ", increase KDUMP_S3_PART_SIZE.");
+                        req.part.number = ++next;
+                        req.part.offset = offset;
+                        offset += len;
+                        req.retries = retries;
+                        send(req);
+                    }
+                }
+                if (req.busy)
+                    ++busy;
+            }
+            if (!busy)
+                break;
+            poll();
+        }
+
+        std::sort(m_parts.begin(), m_parts.end(),
+                  [](const S3Multipart::Part &a, const S3Multipart::Part &b) {
+                      return a.number < b.number;
+                  });
+        string body = S3Multipart::completion(m_parts);
+        control.buf = BufferPool::pool()->get(body.size());
+        memcpy(control.buf.get(), body.data(), body.size());
+        setup(control, "POST", objectURL(key, idQuery), body.size());
+        execute(control, "CompleteMultipartUpload");
+
+        // the server may report an error after it has sent 200 OK
+        string code = S3Multipart::xmlValue(control.response, "Code");
+        if (!code.empty())
+            throw KError("S3 CompleteMultipartUpload failed (" + code + ": " +
+                         S3Multipart::xmlValue(control.response, "Message") +
+                         ")");
+    } catch (...) {
+        for (unsigned i = 0; i < m_connections; ++i)
+            if (slots[i].busy)
+                curl_multi_remove_handle(m_multi, slots[i].curl);
+
+        // the parts of an aborted upload are not stored
+        try {
+            setup(control, "DELETE", objectURL(key, idQuery), 0);
+            execute(control, "AbortMultipartUpload");
+        } catch (const KError &error) {
+            cerr << "WARNING: " << error.what() << endl;
+        }
+        throw;
+    }
+
+    KDBG("Uploaded %s in %zu parts", key.c_str(), m_parts.size());
+    try {
+        putObject(key + S3_MANIFEST_SUFFIX,
+                  S3Multipart::manifest(key, uploadId, m_parts));
+    } catch (const KError &error) {
+        cerr << "WARNING: " << error.what() << endl;
+    }
+}
+
+// -----------------------------------------------------------------------------
+void S3Transfer::putObject(const string &key, const string &data)
+{
+    Request req;
+    if (!data.empty()) {
+        req.buf = BufferPool::pool()->get(data.size());
+        memcpy(req.buf.get(), data.data(), data.size());
+    }
+    setup(req, "PUT", objectURL(key, string()), data.size());
+    execute(req, "PutObject");
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
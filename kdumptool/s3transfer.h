@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef S3TRANSFER_H
+#define S3TRANSFER_H
+
+#include <string>
+#include <vector>
+
+#include <curl/curl.h>
+
+#include "global.h"
+#include "transfer.h"
+#include "bufferpool.h"
+
+// limits of the S3 multipart upload
+#define S3_MIN_PART_SIZE    (5UL << 20)
+#define S3_MAX_PARTS        10000
+
+// suffix of the part manifest saved next to a multipart object
+#define S3_MANIFEST_SUFFIX  ".parts"
+
+class DataProvider;
+class TransferMeter;
+
+//{{{ S3Multipart --------------------------------------------------------------
+
+/**
+ * The parts of an S3 multipart upload, and the helpers to talk about
+ * them with the server.
+ */
+class S3Multipart {
+
+    public:
+        /**
+         * One uploaded part.
+         */
+        struct Part {
+            unsigned number;            // 1 ... S3_MAX_PARTS
+            unsigned long long offset;  // in the object
+            size_t size;
+            std::string crc;            // CRC-32C of the data
+            std::string etag;           // as returned by the server
+        };
+
+        /**
+         * Percent-encodes an object key for the path of a request, or a
+         * value for the query string if @p slash is @c false.
+         */
+        static std::string encodeKey(const std::string &key,
+                                     bool slash = true);
+
+        /**
+         * Returns the text of the first element @p tag in @p xml, or an
+         * empty string if there is none.
+         */
+        static std::string xmlValue(const std::string &xml,
+                                    const std::string &tag);
+
+        /**
+         * Returns the value of the response header @p name in @p line,
+         * or an empty string if it is another header.
+         */
+        static std::string headerValue(const char *line, size_t len,
+                                       const char *name);
+
+        /**
+         * Returns the body of the CompleteMultipartUpload request.
+         */
+        static std::string completion(const std::vector<Part> &parts);
+
+        /**
+         * Returns the part manifest of an object (see
+         * S3_MANIFEST_SUFFIX), one part per line.
+         */
+        static std::string manifest(const std::string &key,
+                                    const std::string &uploadId,
+                                    const std::vector<Part> &parts);
+};
+
+//}}}
+//{{{ S3Transfer ---------------------------------------------------------------
+
+/**
+ * Uploads files to an S3 compatible object store.
+ *
+ * The data is cut into parts of KDUMP_S3_PART_SIZE MiB that are sent
+ * with a multipart upload, up to KDUMP_S3_CONNECTIONS at the same time.
+ * Each part in flight has its own buffer, so the memory is bounded, and
+ * a failed part is sent again up to KDUMP_TRANSFER_RETRIES times. A file
+ * that fits in one part is uploaded with a single PUT. The requests are
+ * signed by libcurl (AWS Signature Version 4) with the user and password
+ * of the URL as access key and secret key.
+ */
+class S3Transfer : public URLTransfer {
+
+    public:
+        /**
+         * Creates a new S3Transfer object.
+         *
+         * @param[in] urlv target URLs; only the first one is used
+         * @exception KError when initialising the underlying library fails
+         */
+        S3Transfer(const RootDirURLVector &urlv);
+
+        /**
+         * Destroys a S3Transfer object.
+         */
+        ~S3Transfer();
+
+        /**
+         * Uploads the data to the object @p target_files.front().
+         *
+         * @see Transfer::perform()
+         */
+        void perform(DataProvider *dataprovider,
+                     const StringVector &target_files,
+                     bool *directSave);
+
+        /**
+         * One request handled by the multi handle.
+         */
+        struct Request {
+            Request()
+                : curl(NULL), len(0), pos(0), retries(0), busy(false),
+                  done(false), result(CURLE_OK), status(0)
+            { error[0] = 0; }
+
+            ~Request()
+            { if (curl) curl_easy_cleanup(curl); }
+
+            CURL *curl;
+            char error[CURL_ERROR_SIZE];
+            BufferPool::Buffer buf;     // request body
+            size_t len, pos;
+            std::string response;       // response body
+            std::string etag;
+            S3Multipart::Part part;
+            int retries;
+            bool busy;
+            bool done;
+            CURLcode result;
+            long status;                // HTTP status code
+        };
+
+    protected:
+
+        /**
+         * Prepares @p req for a request; @p len bytes of the body are
+         * taken from Request::buf.
+         */
+        void setup(Request &req, const char *method, const std::string &url,
+                   size_t len);
+
+        /**
+         * Adds @p req to the multi handle.
+         */
+        void start(Request &req);
+
+        /**
+         * Sends one request and waits for the response. Transient
+         * failures are retried up to KDUMP_TRANSFER_RETRIES times.
+         *
+         * @exception KError if the request fails
+         */
+        void execute(Request &req, const char *what);
+
+        /**
+         * Runs the multi handle once and marks the finished requests.
+         *
+         * @return @c true if a request has finished
+         */
+        bool poll();
+
+        /**
+         * Returns @c true if @p req failed and may succeed if sent again.
+         */
+        bool transient(const Request &req) const;
+
+        /**
+         * Returns the error of a failed request.
+         */
+        std::string failure(const Request &req, const std::string &what) const;
+
+        /**
+         * Returns the URL of @p key with the query string @p query.
+         */
+        std::string objectURL(const std::string &key,
+                              const std::string &query) const;
+
+        /**
+         * Reads the next part from the DataProvider into @p req.
+         *
+         * @return the number of bytes read
+         */
+        size_t fill(DataProvider *dataprovider, Request &req);
+
+        /**
+         * Uploads the data after the first part with a multipart upload.
+         *
+         * @param[in] first the first part, already read
+         * @exception KError if the upload fails; it is aborted then
+         */
+        void multipart(DataProvider *dataprovider, const std::string &key,
+                       Request &first);
+
+        /**
+         * Uploads a small object from memory.
+         *
+         * @exception KError if the upload fails
+         */
+        void putObject(const std::string &key, const std::string &data);
+
+    private:
+        static bool curl_global_inititalised;
+        CURLM *m_multi;
+        struct curl_slist *m_headers;
+        std::string m_endpoint;         // scheme, host and port
+        std::string m_prefix;           // key prefix from the URL path
+        std::string m_sigv4;            // CURLOPT_AWS_SIGV4
+        std::string m_userpwd;
+        size_t m_partSize;
+        unsigned m_connections;
+        TransferMeter *m_meter;         // of the current object
+        std::vector<S3Multipart::Part> m_parts;
+        NetTuning m_tuning;
+};
+
+//}}}
+
+#endif /* S3TRANSFER_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -21,9 +21,17 @@
 #include <list>
 #include <strings.h>
 #include <cerrno>
+#include <cstring>
 #include <memory>
 #include <sstream>
 #include <fstream>
+#include <mutex>
+#include <exception>
+#include <algorithm>
+#include <chrono>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "subcommand.h"
 #include "debug.h"
@@ -33,16 +41,47 @@
 #include "rootdirurl.h"
 #include "transfer.h"
 #include "sshtransfer.h"
+#include "s3transfer.h"
 #include "configuration.h"
 #include "dataprovider.h"
 #include "progress.h"
 #include "stringutil.h"
 #include "vmcoreinfo.h"
+#include "vmcorecontext.h"
 #include "identifykernel.h"
 #include "email.h"
 #include "routable.h"
 #include "calibrate.h"
 #include "stringvector.h"
+#include "zstddataprovider.h"
+#include "dedup.h"
+#include "teetransfer.h"
+#include "failovertransfer.h"
+#include "dumpcatalog.h"
+#include "segmentreader.h"
+#include "pagefilter.h"
+#include "elffilter.h"
+#include "diskdump.h"
+#include "stripewriter.h"
+#include "flattened.h"
+#include "dmesg.h"
+#include "taskgraph.h"
+#include "estimate.h"
+#include "spaceguard.h"
+#include "timebudget.h"
+#include "prefetch.h"
+#include "numa.h"
+#include "deletedumps.h"
+#include "uploaddumps.h"
+#include "reassemble.h"
+#include "rawdump.h"
+#include "receive.h"
+#include "savestats.h"
+#include "streamrecord.h"
+#include "bitmapplan.h"
+#include "pageindex.h"
+#include "progressreporter.h"
+#include "notification.h"
 
 using std::string;
 using std::list;
@@ -56,13 +95,70 @@ using std::getenv;
 
 #define KERNELCOMMANDLINE "/proc/cmdline"
 
+// file name of the timing report
+#define STATS_FILE		"stats.json"
+
+// threads for the steps of save_dump (dump, kernel copy, notification)
+#define SAVEDUMP_TASK_THREADS	4
+
+// burst that every target gets with the FASTEST flag
+#define FASTEST_PROBE_SIZE	(4UL << 20)
+
+//{{{ PreparedTargets ----------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+PreparedTargets::~PreparedTargets()
+{
+}
+
+// -----------------------------------------------------------------------------
+string PreparedTargets::key(const RootDirURLVector &urlv)
+{
+    string ret;
+    RootDirURLVector::const_iterator it;
+    for (it = urlv.begin(); it != urlv.end(); ++it)
+        ret.append(it->getURL()).push_back('\n');
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void PreparedTargets::add(const RootDirURLVector &urlv, Transfer *transfer,
+                          double seconds)
+{
+    std::unique_ptr<Transfer> owned(transfer);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_transfers[key(urlv)] = std::move(owned);
+    m_seconds[key(urlv)] = seconds;
+}
+
+// -----------------------------------------------------------------------------
+Transfer *PreparedTargets::take(const RootDirURLVector &urlv, double *seconds)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_transfers.find(key(urlv));
+    if (it == m_transfers.end())
+        return NULL;
+    Transfer *ret = it->second.release();
+    m_transfers.erase(it);
+    if (seconds)
+        *seconds = m_seconds[key(urlv)];
+    m_seconds.erase(key(urlv));
+    return ret;
+}
+
+//}}}
 //{{{ SaveDump -----------------------------------------------------------------
 
 // -----------------------------------------------------------------------------
 SaveDump::SaveDump()
     : m_dump(DEFAULT_DUMP), m_nomail(false),
       m_split(0), m_transfer(nullptr), m_usedDirectSave(false),
-      m_useMakedumpfile(false), m_threads(0), m_crashtime(0)
+      m_useMakedumpfile(false), m_flattened(false),
+      m_unflattened(false), m_striped(false),
+      m_noSpace(false), m_truncated(false), m_threads(0), m_crashtime(0), m_checksum(false), m_checksumChunk(0),
+      m_dumpName("vmcore"), m_dumpLevel(0), m_codecTarget(0),
+      m_numaNode(-1), m_expectedSize(0),
+      m_expectedSeconds(0), m_oldDumps(NULL)
 {
 }
 
@@ -71,18 +167,22 @@ SaveDump::~SaveDump()
 {
     Debug::debug()->trace("SaveDump::~SaveDump()");
 
+    // the background setup uses the members
+    if (m_preparing.valid())
+        m_preparing.wait();
     delete m_transfer;
 }
 
 // -----------------------------------------------------------------------------
-int SaveDump::create()
+void SaveDump::prepare()
 {
-    Configuration *config = Configuration::config();
-    int ret = 0;
+    Debug::debug()->trace("SaveDump::prepare()");
 
-    // check if the dump file actually exists
-    if (!m_dump.exists())
-        throw KError("The dump file " + m_dump + " does not exist.");
+    // create() reports a missing dump
+    if (m_preparing.valid() || !m_dump.exists())
+        return;
+
+    Configuration *config = Configuration::config();
 
     try {
         fillVmcoreinfo();
@@ -90,75 +190,199 @@ int SaveDump::create()
         Debug::debug()->dbg("Error when reading VMCOREINFO: %s", error.what());
     }
 
-    // build the transfer object
+    // the limit must be set before the first transfer is created
+    long bufferMemory = config->KDUMP_BUFFER_MEMORY.value();
+    BufferPool::pool()->setLimit(bufferMemory > 0
+        ? (unsigned long long)bufferMemory << 20
+        : BufferPool::defaultLimit());
+
+    // read the kernel log while the dump targets are set up
+    m_dmesg.reset(new DmesgDataProvider(m_dump.c_str()));
+    m_dmesg->start();
+
     // prepend a time stamp to the save dir
     string subdir = StringUtil::formatUnixTime(ISO_DATETIME, m_crashtime);
-    RootDirURLVector urlv;
+    StringVector savedirs, hosts;
+    bool local = false;
     std::istringstream iss(config->KDUMP_SAVEDIR.value());
     FilePath elem;
     while (iss >> elem) {
+        savedirs.push_back(elem);
         RootDirURL url(elem, m_rootdir);
-        if (url.getProtocol() != URLParser::PROT_FILE) {
-            Routable rt(url.getHostname());
-            if (!rt.check(config->KDUMP_NET_TIMEOUT.value())) {
-                cerr << "WARNING: Dump target not reachable" << endl;
-                elem.appendPath(string("unknown-") + subdir);
-            } else
-                elem.appendPath(rt.prefsrc() + '-' + subdir);
-        } else
-            elem.appendPath(subdir);
-        urlv.push_back(RootDirURL(elem, m_rootdir));
+        if (url.getProtocol() == URLParser::PROT_FILE ||
+            url.getProtocol() == URLParser::PROT_RAW)
+            local = true;
+        else
+            hosts.push_back(url.getHostname());
     }
 
-    m_transfer = getTransfer(urlv);
+    // save to the staging directory at local speed; the network targets
+    // get their copy after the reboot (see UploadDumps)
+    string staging = config->KDUMP_STAGING_DIR.value();
+    if (!staging.empty() && !hosts.empty()) {
+        if (local)
+            cerr << "WARNING: KDUMP_STAGING_DIR is ignored, because "
+                    "KDUMP_SAVEDIR contains local targets." << endl;
+        else {
+            m_staged.swap(savedirs);
+            savedirs.assign(1, staging);
+            hosts.clear();
+        }
+    }
 
-    // save the dump
-    try {
-        saveDump(urlv);
-    } catch (const KError &error) {
-        ret = 1;
+    // the triage bundle goes to its own target, even if the dump is
+    // staged, because it is needed while the dump is still being saved
+    string triage = config->KDUMP_TRIAGE_URL.value();
+    if (!triage.empty()) {
+        RootDirURL url(triage, m_rootdir);
+        if (url.getProtocol() == URLParser::PROT_RAW) {
+            cerr << "WARNING: KDUMP_TRIAGE_URL cannot be a raw device."
+                 << endl;
+            triage.clear();
+        } else if (url.getProtocol() != URLParser::PROT_FILE)
+            hosts.push_back(url.getHostname());
+    }
 
-        sendNotification(true, urlv);
+    m_preparing = std::async(std::launch::async,
+                             [this, savedirs, hosts, triage, subdir]() {
+        Configuration *config = Configuration::config();
 
-        // run checkAndDelete() in any case
-        try {
-            checkAndDelete(urlv);
-        } catch (const KError &error) {
-            cout << error.what() << endl;
+        // wait for all remote targets at once; the results are cached
+        // for the transfers below
+        if (!hosts.empty()) {
+            SaveStats::Timer timer("route");
+            Routable::checkAll(hosts, config->KDUMP_NET_TIMEOUT.value());
         }
 
-        if (config->KDUMP_CONTINUE_ON_ERROR.value())
-            cout << error.what() << endl;
-        else
-            throw;
+        auto dumpDir = [&](FilePath elem) -> RootDirURL {
+            RootDirURL url(elem, m_rootdir);
+            if (url.getProtocol() != URLParser::PROT_FILE &&
+                url.getProtocol() != URLParser::PROT_RAW) {
+                Routable rt(url.getHostname());
+                if (!rt.check(config->KDUMP_NET_TIMEOUT.value())) {
+                    cerr << "WARNING: Dump target not reachable" << endl;
+                    elem.appendPath(string("unknown-") + subdir);
+                } else
+                    elem.appendPath(rt.prefsrc() + '-' + subdir);
+            } else
+                elem.appendPath(subdir);
+            return RootDirURL(elem, m_rootdir);
+        };
+
+        StringVector::const_iterator dir;
+        for (dir = savedirs.begin(); dir != savedirs.end(); ++dir)
+            m_urlv.push_back(dumpDir(*dir));
+        if (!triage.empty())
+            m_triagev.push_back(dumpDir(triage));
+
+        // set up the network targets (e.g. NFS and CIFS are mounted);
+        // preflight() may still drop local targets, so they are left
+        // to getTransfer(); with FASTEST, each target gets its own
+        std::vector<RootDirURLVector> groups;
+        std::vector<RootDirURLVector> all;
+        if (useFastest(m_urlv)) {
+            RootDirURLVector::const_iterator it;
+            for (it = m_urlv.begin(); it != m_urlv.end(); ++it)
+                all.push_back(RootDirURLVector(1, *it));
+        } else
+            all = groupByProtocol(m_urlv);
+        std::vector<RootDirURLVector>::const_iterator group;
+        // the triage target only if it cannot share a mount point
+        // with the dump targets
+        if (!m_triagev.empty()) {
+            for (group = all.begin(); group != all.end(); ++group)
+                if (group->front().getProtocol() ==
+                    m_triagev.front().getProtocol())
+                    break;
+            if (group == all.end())
+                all.push_back(m_triagev);
+        }
+        for (group = all.begin(); group != all.end(); ++group) {
+            URLParser::Protocol prot = group->front().getProtocol();
+            if (prot != URLParser::PROT_FILE && prot != URLParser::PROT_RAW)
+                groups.push_back(*group);
+        }
+        // one thread per protocol; a failure is reported again when
+        // getTransfer() tries to create the Transfer
+        SaveStats::Timer timer("connect");
+        std::vector<std::future<void>> setups;
+        for (group = groups.begin(); group != groups.end(); ++group) {
+            RootDirURLVector urlv(*group);
+            setups.push_back(std::async(std::launch::async, [this, urlv]() {
+                try {
+                    std::chrono::steady_clock::time_point start =
+                        std::chrono::steady_clock::now();
+                    Transfer *transfer = getProtocolTransfer(urlv);
+                    m_prepared.add(urlv, transfer,
+                        std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - start).count());
+                } catch (const KError &error) {
+                    Debug::debug()->dbg("Cannot prepare %s: %s",
+                                        urlv.front().getURL().c_str(),
+                                        error.what());
+                }
+            }));
+        }
+        for (auto &setup : setups)
+            setup.get();
+    });
+}
+
+// -----------------------------------------------------------------------------
+int SaveDump::create()
+{
+    Configuration *config = Configuration::config();
+    int ret = 0;
+
+    // check if the dump file actually exists
+    if (!m_dump.exists())
+        throw KError("The dump file " + m_dump + " does not exist.");
+
+    prepare();
+    {
+        SaveStats::Timer timer("prepare-wait");
+        m_preparing.get();
     }
+    RootDirURLVector urlv(m_urlv);
+    RootDirURLVector triagev(m_triagev);
 
-    // send the email afterwards
-    sendNotification(false, urlv);
+    {
+        SaveStats::Timer timer("preflight");
+        preflight(urlv);
+    }
+    if (config->KDUMP_NOTIFICATION_START.value())
+        sendStartNotification(urlv);
+    {
+        // NFS and CIFS targets are mounted here, unless prepare() has
+        // already done it
+        SaveStats::Timer timer("mount");
+        m_transfer = getTransfer(urlv, &m_prepared);
+    }
 
-    // because we don't know the file size in advance, check
-    // afterwards if the disk space is not sufficient and delete
-    // the dump again
-    try {
-        checkAndDelete(urlv);
-    } catch (const KError &error) {
-        ret = 1;
-        if (config->KDUMP_CONTINUE_ON_ERROR.value())
-            cout << error.what() << endl;
-        else
-            throw;
+    // the dump is made for the fastest target; the others are only
+    // used if it fails
+    FailoverTransfer *failover = dynamic_cast<FailoverTransfer *>(m_transfer);
+    if (failover) {
+        RootDirURLVector::const_iterator it;
+        for (it = urlv.begin(); it != urlv.end(); ++it)
+            if (it->getURL() == failover->currentLeg())
+                break;
+        if (it != urlv.end())
+            urlv.assign(1, *it);
     }
 
-    // copy the makedumpfile-R.pl
-    try {
-        if (!m_usedDirectSave && m_useMakedumpfile)
-            copyMakedumpfile();
-    } catch (const KError &error) {
-        ret = 1;
-        if (config->KDUMP_CONTINUE_ON_ERROR.value())
-            cout << error.what() << endl;
-        else
-            throw;
+    // the directories have just been created; the record keeps the
+    // catalogs current while old dumps are deleted
+    catalogDump(urlv, "saving");
+
+    // before any dump thread is started, so that they all inherit it
+    placeThreads(urlv);
+
+    m_checksum = config->kdumptoolContainsFlag(Configuration::FLAG_CHECKSUM);
+    if (m_checksum) {
+        long chunk = config->KDUMP_CHECKSUM_CHUNK_SIZE.value();
+        m_checksumChunk = chunk > 0 ? (size_t)chunk << 20 : 0;
+        Debug::debug()->dbg("Using %s CRC-32C", Crc32c::implementation());
     }
 
     // if we have no VMCOREINFO, then try to command line to get the
@@ -172,37 +396,402 @@ int SaveDump::create()
         }
     }
 
+    // resolve it before the steps that use it run concurrently
+    if (m_hostname.size() == 0)
+        m_hostname = Util::getHostDomain();
+
+    // the dump step drops the kernel log after saving it
+    if (!triagev.empty() && m_dmesg && m_dmesg->wait())
+        m_triageLog = m_dmesg->text();
+
+    // The remaining steps run as a task graph. All steps that use
+    // m_transfer are chained, because a Transfer is not thread-safe.
+    // The kernel copy has its own Transfer if the protocol allows more
+    // than one (mounting a share twice does not), or shares m_transfer
+    // if that is thread-safe, so it overlaps with the dump, and the
+    // notification goes out while the rest is saved.
+    bool continueOnError = config->KDUMP_CONTINUE_ON_ERROR.value();
+    bool dumpFailed = false;
+    std::exception_ptr firstError;
+    std::mutex errorMutex;
+    TaskGraph graph(SAVEDUMP_TASK_THREADS);
+
+    // KDUMP_CONTINUE_ON_ERROR decides whether a failed step stops
+    // the steps that have not started yet
+    auto step = [&](const TaskGraph::Function &fn) -> TaskGraph::Function {
+        return [&, fn]() {
+            try {
+                fn();
+            } catch (const KError &error) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                ret = 1;
+                if (continueOnError || firstError)
+                    cout << error.what() << endl;
+                else {
+                    firstError = std::current_exception();
+                    graph.abort();
+                }
+            }
+        };
+    };
+
+    // the triage bundle overlaps with everything else, and a failure
+    // does not affect the dump
+    size_t triageTask = 0;
+    if (!triagev.empty())
+        triageTask = graph.add("triage", [&]() {
+                try {
+                    saveTriage(triagev);
+                } catch (const KError &error) {
+                    cout << "WARNING: Cannot save the triage bundle: "
+                         << error.what() << endl;
+                }
+            });
+
+    // a raw device is written sequentially by one Transfer
+    bool separateKernel = true;
+    RootDirURLVector::const_iterator url;
+    for (url = urlv.begin(); url != urlv.end(); ++url)
+        if (url->getProtocol() == URLParser::PROT_NFS ||
+            url->getProtocol() == URLParser::PROT_CIFS ||
+            url->getProtocol() == URLParser::PROT_RAW)
+            separateKernel = false;
+
+    TaskGraph::Function kernelTask = step([&]() {
+            if (m_crashrelease.size() == 0) {
+                Debug::debug()->info("Don't copy the kernel and System.map "
+                    "because of missing crash kernel release.");
+                return;
+            }
+            if (!config->KDUMP_COPY_KERNEL.value())
+                return;
+
+            if (separateKernel && m_transfer->isThreadSafe())
+                copyKernel(m_transfer, false);
+            else if (separateKernel) {
+                std::unique_ptr<Transfer> transfer(getTransfer(urlv));
+                copyKernel(transfer.get(), false);
+            } else
+                copyKernel(m_transfer, true);
+        });
+
+    size_t dump = graph.add("dump", step([&]() {
+            try {
+                saveDump(urlv);
+            } catch (const KError &) {
+                dumpFailed = true;
+                throw;
+            }
+        }));
+
+    size_t kernel = 0;
+    if (separateKernel)
+        kernel = graph.add("kernel", kernelTask);
+
+    // only queues the mail, see NotificationQueue
+    size_t notification = graph.add("notification", [&]() {
+            sendNotification(dumpFailed, urlv);
+        }, { dump }, true);
+
+    // transfers to local targets stop before the reserve is used (see
+    // SpaceGuard), but makedumpfile cannot be stopped when it writes a
+    // split dump itself, so check afterwards if the disk space is not
+    // sufficient and delete the dump again
+    std::vector<size_t> checkDeps(1, dump);
+    if (separateKernel)
+        checkDeps.push_back(kernel);
+    bool dumpKept = false;
+    size_t check = graph.add("check", step([&]() {
+            SaveStats::Timer timer("check");
+            try {
+                checkAndDelete(urlv);
+                dumpKept = !dumpFailed;
+            } catch (const KError &error) {
+                // the dump has already failed, just report it
+                if (!dumpFailed)
+                    throw;
+                cout << error.what() << endl;
+            }
+        }), checkDeps, true);
+
+    // the dump is safe once the check has kept it and it is synced;
+    // the triage bundle is the only other step that reads the vmcore
+    if (m_dumpDurable) {
+        std::vector<size_t> durableDeps(1, check);
+        if (!triagev.empty())
+            durableDeps.push_back(triageTask);
+        graph.add("durable", [&]() {
+                if (!dumpKept)
+                    return;
+                try {
+                    SaveStats::Timer timer("sync");
+                    syncTargets(urlv);
+                } catch (const KError &error) {
+                    cout << "WARNING: " << error.what() << endl;
+                    return;
+                }
+                m_dumpDurable();
+            }, durableDeps);
+    }
+
+    // save the reassembly script for striped dumps
+    size_t unstripe = graph.add("unstripe", step([&]() {
+            if (m_striped)
+                generateUnstripe();
+        }), { check });
+
+    // copy the makedumpfile-R.pl
+    size_t makedumpfile = graph.add("makedumpfile", step([&]() {
+            if (!m_usedDirectSave && !m_unflattened && m_flattened)
+                copyMakedumpfile();
+        }), { unstripe });
+
     // generate the README file
-    try {
-        generateInfo();
-    } catch (const KError &error) {
-        ret = 1;
-        if (config->KDUMP_CONTINUE_ON_ERROR.value())
-            cout << error.what() << endl;
-        else
-            throw;
+    size_t info = graph.add("README", step([&]() {
+            SaveStats::Timer timer("README");
+            generateInfo();
+        }), { makedumpfile });
+
+    if (!separateKernel)
+        kernel = graph.add("kernel", kernelTask, { info });
+
+    // save the checksums of everything above
+    size_t checksums = graph.add("checksums", step([&]() {
+            if (m_checksum) {
+                SaveStats::Timer timer("checksums");
+                generateChecksums();
+            }
+        }), { info, kernel });
+
+    // the timing report comes last, even if a step has failed
+    graph.add("stats", [&]() {
+            try {
+                generateStats(dumpFailed);
+            } catch (const KError &error) {
+                cout << "WARNING: " << error.what() << endl;
+            }
+        }, { checksums, notification }, true);
+
+    graph.run();
+    catalogDump(urlv, dumpFailed ? "failed" :
+                m_truncated ? "truncated" : "ok");
+    if (firstError)
+        std::rethrow_exception(firstError);
+
+    // makedumpfile writes the parts round-robin like FileTransfer; only
+    // local directories are reassembled after the reboot
+    if (m_split && m_usedDirectSave && !dumpFailed && !m_truncated &&
+        urlv.front().getProtocol() == URLParser::PROT_FILE) {
+        std::vector<ReassemblyMarker::Part> parts;
+        for (unsigned long i = 1; i <= m_split; ++i) {
+            const RootDirURL &url = urlv[(i - 1) % urlv.size()];
+            string name = "vmcore" + StringUtil::number2string(i);
+            FilePath real = url.getRealPath();
+            real.appendPath(name);
+            FilePath path = url.getPath();
+            path.appendPath(name);
+
+            ReassemblyMarker::Part part;
+            part.path = path;
+            part.size = real.exists() ? real.fileSize() : 0;
+            parts.push_back(part);
+        }
+        try {
+            ReassemblyMarker::create(urlv.front().getRealPath(), m_dumpName,
+                                     parts);
+            cout << "The split dump will be reassembled after the reboot."
+                 << endl;
+        } catch (const KError &error) {
+            cout << "WARNING: " << error.what() << endl;
+        }
     }
 
-    // copy kernel
-    if (m_crashrelease.size() > 0) {
+    if (!m_staged.empty() && !dumpFailed) {
         try {
-            if (config->KDUMP_COPY_KERNEL.value())
-                copyKernel();
+            UploadMarker::create(urlv.front().getRealPath(), m_staged);
+            cout << "The dump will be uploaded after the reboot." << endl;
         } catch (const KError &error) {
+            cout << error.what() << endl;
             ret = 1;
-            if (config->KDUMP_CONTINUE_ON_ERROR.value())
-                cout << error.what() << endl;
-            else
-                throw;
         }
-    } else {
-        Debug::debug()->info("Don't copy the kernel and System.map because of missing "
-            "crash kernel release.");
     }
 
     return ret;
 }
 
+// -----------------------------------------------------------------------------
+void SaveDump::placeThreads(const RootDirURLVector &urlv)
+{
+    Debug::debug()->trace("SaveDump::placeThreads()");
+
+    Configuration *config = Configuration::config();
+    if (config->kdumptoolContainsFlag(Configuration::FLAG_NONUMA))
+        return;
+
+    NumaPlacement numa;
+    if (numa.nodes() < 2)
+        return;
+
+    // with several targets, the first one gets the full dump first
+    const RootDirURL &url = urlv.front();
+    int node = -1;
+    string device;
+    if (url.getProtocol() == URLParser::PROT_FILE ||
+        url.getProtocol() == URLParser::PROT_RAW) {
+        device = url.getRealPath();
+        node = numa.pathNode(device);
+    } else {
+        Routable rt(url.getHostname());
+        if (rt.check(config->KDUMP_NET_TIMEOUT.value()))
+            device = NumaPlacement::interfaceOf(rt.prefsrc());
+        if (!device.empty())
+            node = numa.interfaceNode(device);
+    }
+    if (node < 0) {
+        Debug::debug()->dbg("No NUMA node for the dump target");
+        return;
+    }
+
+    std::vector<int> cpus;
+    try {
+        cpus = numa.nodeCPUs(node);
+    } catch (const KError &error) {
+        Debug::debug()->dbg("%s", error.what());
+    }
+
+    // fewer threads than KDUMP_CPUS would cost more than remote memory
+    unsigned long wanted = 1;
+    if (!config->kdumptoolContainsFlag(Configuration::FLAG_SINGLE) &&
+        config->KDUMP_CPUS.value() > 1)
+        wanted = std::min<unsigned long>(config->KDUMP_CPUS.value(),
+                                         SystemCPU().numOnline());
+    if (cpus.size() < wanted) {
+        Debug::debug()->dbg("Node %d has %zu CPUs, %lu are needed",
+                            node, cpus.size(), wanted);
+        cpus.clear();
+    }
+
+    try {
+        NumaPlacement::bind(cpus, node);
+    } catch (const KError &error) {
+        cout << "WARNING: " << error.what() << endl;
+        return;
+    }
+    m_numaNode = node;
+
+    cout << "Using NUMA node " << node << " of " << device;
+    if (!cpus.empty())
+        cout << " (" << cpus.size() << " CPUs)";
+    cout << endl;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long SaveDump::saveFile(DataProvider *provider,
+                                      const StringVector &targets,
+                                      bool *directSave, Transfer *transfer)
+{
+    if (!transfer)
+        transfer = m_transfer;
+
+    CountingDataProvider counted(provider);
+    if (!m_checksum) {
+        transfer->perform(&counted, targets, directSave);
+        return counted.bytes();
+    }
+
+    ChecksumDataProvider checked(&counted, m_checksumChunk);
+    transfer->perform(&checked, targets, directSave);
+    recordChecksum(checked, targets.front());
+    return counted.bytes();
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long SaveDump::saveFile(DataProvider *provider,
+                                      const string &target,
+                                      bool *directSave, Transfer *transfer)
+{
+    return saveFile(provider, StringVector(1, target), directSave, transfer);
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long SaveDump::saveArtifacts(const ArtifactBatch &artifacts,
+                                           Transfer *transfer)
+{
+    if (!transfer)
+        transfer = m_transfer;
+
+    transfer->performBatch(artifacts);
+
+    unsigned long long bytes = 0;
+    ArtifactBatch::const_iterator it;
+    for (it = artifacts.begin(); it != artifacts.end(); ++it) {
+        bytes += it->second.size();
+        if (!m_checksum)
+            continue;
+
+        // the data is still here, so it need not pass the transfer
+        BufferDataProvider provider(it->second.data(), it->second.size());
+        ChecksumDataProvider checked(&provider, m_checksumChunk);
+        char buf[BUFSIZ];
+        checked.prepare();
+        while (checked.getData(buf, sizeof buf) > 0)
+            ;
+        checked.finish();
+        recordChecksum(checked, it->first);
+    }
+    return bytes;
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::recordChecksum(const ChecksumDataProvider &checked,
+                              const string &name)
+{
+    ostringstream ss;
+
+    if (!checked.valid()) {
+        ss << "# " << name << ": saved directly, no checksum" << endl;
+        std::lock_guard<std::mutex> lock(m_checksumMutex);
+        m_checksums += ss.str();
+        return;
+    }
+
+    ss << checked.checksum().hex() << " " << checked.size() << " "
+       << name << endl;
+
+    const std::vector<Crc32c> &chunks = checked.chunkChecksums();
+    unsigned long long offset = 0;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        unsigned long long len = std::min<unsigned long long>(
+            checked.chunkSize(), checked.size() - offset);
+        ss << chunks[i].hex() << " " << len << " "
+           << name << "@" << offset << endl;
+        offset += len;
+    }
+    std::lock_guard<std::mutex> lock(m_checksumMutex);
+    m_checksums += ss.str();
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::generateChecksums()
+{
+    Configuration *config = Configuration::config();
+
+    ostringstream ss;
+    ss << "# CRC-32C (Castagnoli) of the files as they were saved" << endl;
+    ss << "# <crc32c> <size> <file>[@<offset>]" << endl;
+    ss << m_checksums;
+
+    TerminalProgress progress("Generating checksums");
+    string const& s = ss.str();
+    BufferDataProvider provider(s.c_str(), s.size());
+    if (config->KDUMP_VERBOSE.value()
+	& Configuration::VERB_PROGRESS)
+        provider.setProgress(&progress);
+    else
+        cout << "Generating checksums" << endl;
+    m_transfer->perform(&provider, CHECKSUM_MANIFEST, NULL);
+}
+
 // -----------------------------------------------------------------------------
 void SaveDump::saveDump(const RootDirURLVector &urlv)
 {
@@ -227,29 +816,239 @@ void SaveDump::saveDump(const RootDirURLVector &urlv)
 
     // Save a copy of dmesg
     try {
-        string directCmdline = "makedumpfile --dump-dmesg " + m_dump;
-	string pipeCmdline = "makedumpfile --dump-dmesg -F " + m_dump;
-	ProcessDataProvider logProvider(
-	    pipeCmdline.c_str(), directCmdline.c_str());
+        SaveStats::Timer timer("dmesg");
+        // makedumpfile is the fallback if the log cannot be read directly
+        std::unique_ptr<ProcessDataProvider> process;
+        DataProvider *logProvider = m_dmesg.get();
+        if (!m_dmesg || !m_dmesg->wait()) {
+            StringVector directArgs;
+            directArgs.push_back("makedumpfile");
+            directArgs.push_back("--dump-dmesg");
+            directArgs.push_back(m_dump);
+            StringVector pipeArgs(directArgs);
+            pipeArgs.insert(pipeArgs.end() - 1, "-F");
+            process.reset(new ProcessDataProvider(pipeArgs, directArgs));
+            logProvider = process.get();
+        }
 
 	cout << "Extracting dmesg" << endl;
 	terminal.printLine();
 	TerminalProgress logProgress("Saving dmesg");
         if (config->KDUMP_VERBOSE.value()
 	    & Configuration::VERB_PROGRESS)
-            logProvider.setProgress(&logProgress);
+            logProvider->setProgress(&logProgress);
         else
             cout << "Saving dmesg ..." << endl;
-        m_transfer->perform(&logProvider, "dmesg.txt", NULL);
+        timer.bytes(saveFile(logProvider, "dmesg.txt"));
 	terminal.printLine();
     } catch (const KError &error) {
 	cout << error.what() << endl;
     } catch (...) {
 	cout << "Extracting failed." << endl;
     }
+    m_dmesg.reset();
+
+    string dumpformat = config->KDUMP_DUMPFORMAT.value();
+    long budget = config->KDUMP_TIME_BUDGET.value();
+    bool autoFormat = strcasecmp(dumpformat.c_str(), "auto") == 0;
+
+    // both the codec and the budget depend on the speed of the target
+    unsigned long long rate = 0;
+    if (autoFormat || budget > 0) {
+        try {
+            rate = probeTarget();
+            Debug::debug()->dbg("Target writes %llu MiB/s",
+                                bytes_to_megabytes(rate));
+        } catch (const KError &error) {
+            cout << "WARNING: Cannot measure the speed of the target: "
+                 << error.what() << endl;
+        }
+    }
+    if (autoFormat)
+        dumpformat = chooseFormat(rate);
+
+    if (budget <= 0 || strcasecmp(dumpformat.c_str(), "none") == 0) {
+        saveVmcore(urlv, dumplevel, dumpformat, NULL);
+        return;
+    }
+
+    // the budget counts from the start of kdumptool
+    typedef DeadlineDataProvider::Clock Clock;
+    auto secondsLeft = [budget]() -> unsigned long {
+        double elapsed = SaveStats::stats()->elapsed();
+        return elapsed < budget ? (unsigned long)(budget - elapsed) : 0;
+    };
+
+    std::unique_ptr<DumpEstimator> estimator;
+    try {
+        estimator.reset(new DumpEstimator(DumpEstimator::fromVmcore(m_dump)));
+    } catch (const KError &error) {
+        cout << "WARNING: KDUMP_TIME_BUDGET is ignored: " << error.what()
+             << endl;
+        saveVmcore(urlv, dumplevel, dumpformat, NULL);
+        return;
+    }
+
+    unsigned long workers = 1;
+    if (!config->kdumptoolContainsFlag(Configuration::FLAG_SINGLE) &&
+        config->KDUMP_CPUS.value() > 1)
+        workers = config->KDUMP_CPUS.value();
+    DumpPolicy policy(*estimator, config->KDUMP_ELF_ZSTD_LEVEL.value(),
+                      workers,
+                      !config->kdumptoolContainsFlag(Configuration::FLAG_NOSPARSE));
+    std::vector<DumpPolicy::Choice> candidates =
+        policy.candidates(dumplevel, dumpformat, rate);
+    size_t pick = DumpPolicy::choose(candidates, secondsLeft());
+
+    // excluding pages only helps with page statistics
+    if (pick != 0 && !estimator->hasStats() &&
+        estimator->analyze(m_dump, false)) {
+        candidates = policy.candidates(dumplevel, dumpformat, rate);
+        pick = DumpPolicy::choose(candidates, secondsLeft());
+    }
+
+    auto apply = [&](size_t i) {
+        const DumpPolicy::Choice &c = candidates[i];
+        m_expectedSize = c.estimate.size;
+        m_expectedSeconds = c.seconds;
+        if (c.dumplevel == dumplevel &&
+            strcasecmp(c.format.c_str(), dumpformat.c_str()) == 0)
+            return;
+        ostringstream note;
+        note << "Dump level " << c.dumplevel << " and format " << c.format
+             << " were used instead of " << dumplevel << " and "
+             << dumpformat << " to fit KDUMP_TIME_BUDGET.";
+        m_budgetNote = note.str();
+        cout << m_budgetNote << endl;
+    };
+    apply(pick);
+
+    Clock::time_point deadline = Clock::now() +
+        std::chrono::seconds(secondsLeft());
+    try {
+        saveVmcore(urlv, candidates[pick].dumplevel, candidates[pick].format,
+                   &deadline);
+        return;
+    } catch (const KDeadlineError &error) {
+        cout << "WARNING: " << error.what() << endl;
+
+        // the next dump may have other file names
+        string dir = m_transfer->localDirectory();
+        if (!dir.empty()) {
+            StringVector names(1, m_dumpName);
+            for (unsigned long i = 1; i <= m_split; ++i)
+                names.push_back("vmcore" + StringUtil::number2string(i));
+            for (size_t i = 0; i < names.size(); ++i)
+                unlink((dir + "/" + names[i]).c_str());
+        }
+
+        // the speed so far includes the processing, so it is on the
+        // safe side for the target
+        if (!rate || error.rate() < rate)
+            rate = error.rate();
+        candidates = policy.candidates(dumplevel, dumpformat, rate);
+        pick = DumpPolicy::choose(candidates, secondsLeft(), pick + 1);
+        apply(pick);
+    }
+
+    // there is no time for a third attempt
+    saveVmcore(urlv, candidates[pick].dumplevel, candidates[pick].format,
+               NULL);
+}
+
+// -----------------------------------------------------------------------------
+static std::vector<char> probeData(size_t size)
+{
+    // random data, so that compressing targets do not look faster
+    std::vector<char> data(size);
+    uint64_t x = 0x9e3779b97f4a7c15ULL;
+    for (size_t i = 0; i + sizeof x <= data.size(); i += sizeof x) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        memcpy(&data[i], &x, sizeof x);
+    }
+    return data;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long SaveDump::probeTarget()
+{
+    Debug::debug()->trace("SaveDump::probeTarget()");
+
+    std::vector<char> data = probeData(TIME_BUDGET_PROBE_SIZE);
+
+    SaveStats::Timer timer("probe");
+    BufferDataProvider provider(data.data(), data.size());
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    m_transfer->perform(&provider, TIME_BUDGET_PROBE_FILE, NULL);
+    double elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    timer.bytes(data.size());
+
+    string dir = m_transfer->localDirectory();
+    if (!dir.empty())
+        unlink((dir + "/" TIME_BUDGET_PROBE_FILE).c_str());
+
+    return elapsed > 0 ? data.size() / elapsed : 0;
+}
+
+// -----------------------------------------------------------------------------
+string SaveDump::chooseFormat(unsigned long long rate)
+{
+    Debug::debug()->trace("SaveDump::chooseFormat(%llu)", rate);
+
+    Configuration *config = Configuration::config();
+    unsigned long workers = 1;
+    if (!config->kdumptoolContainsFlag(Configuration::FLAG_SINGLE) &&
+        config->KDUMP_CPUS.value() > 1)
+        workers = std::min<unsigned long>(config->KDUMP_CPUS.value(),
+                                          SystemCPU().numOnline());
+
+    SaveStats::Timer timer("codec-benchmark");
+    CodecBenchmark bench(workers);
+    try {
+        if (!bench.sample(m_dump))
+            throw KError("The dump has no pages to compress.");
+        m_codecs = bench.run(CodecBenchmark::supportedFormats());
+    } catch (const KError &error) {
+        cout << "WARNING: Cannot benchmark the dump formats: "
+             << error.what() << endl;
+        return "compressed";
+    }
+    m_codecTarget = rate;
+
+    const string &format =
+        m_codecs[CodecBenchmark::choose(m_codecs, rate)].format;
+    cout << "Dump format: " << format << " (auto)" << endl;
+    return format;
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::saveVmcore(const RootDirURLVector &urlv, int dumplevel,
+                          const string &dumpformat,
+                          const std::chrono::steady_clock::time_point *deadline)
+{
+    Configuration *config = Configuration::config();
+    Terminal terminal;
+
+    // a second attempt starts over
+    m_split = 0;
+    m_threads = 0;
+    m_dumpName = "vmcore";
+    m_usedDirectSave = m_useMakedumpfile = m_flattened = false;
+    m_unflattened = m_striped = false;
+    m_dumpLevel = dumplevel;
+    m_dumpFormat = dumpformat;
 
     // dump format
-    const string &dumpformat = config->KDUMP_DUMPFORMAT.value();
+    std::unique_ptr<DataProvider> source;
+    std::unique_ptr<RecordingDataProvider> recording;
+    FlattenedDataProvider *flattened = NULL;
+    DiskdumpDataProvider *diskdump = NULL;
+    std::unique_ptr<PageIndex> pageIndex;
+    ProcessDataProvider *process = NULL;
     DataProvider *provider;
 
     bool noDump = strcasecmp(dumpformat.c_str(), "none") == 0;
@@ -257,10 +1056,28 @@ void SaveDump::saveDump(const RootDirURLVector &urlv)
     bool useCompressed = strcasecmp(dumpformat.c_str(), "compressed") == 0;
     bool useLZO = strcasecmp(dumpformat.c_str(), "lzo") == 0;
     bool useSnappy = strcasecmp(dumpformat.c_str(), "snappy") == 0;
+    bool useZstd = strcasecmp(dumpformat.c_str(), "zstd") == 0;
 
     if (noDump)
 	return;			// nothing to be done
 
+    bool excludeDomU = false;
+    if (!config->kdumptoolContainsFlag(Configuration::FLAG_XENALLDOMAINS) &&
+	Util::isXenCoreDump(m_dump.c_str()))
+      excludeDomU = true;
+
+    // raw ELF dumps can be compressed by kdumptool itself
+    int zstdLevel = 0;
+    if (useElf && dumplevel == 0 && !excludeDomU)
+        zstdLevel = config->KDUMP_ELF_ZSTD_LEVEL.value();
+#if !HAVE_ZSTD
+    if (zstdLevel > 0) {
+        cerr << "WARNING: kdumptool was built without zstd support, "
+             << "saving an uncompressed ELF dump." << endl;
+        zstdLevel = 0;
+    }
+#endif
+
     unsigned long cpus = config->KDUMP_CPUS.value();
     unsigned long online_cpus = 0;
     if (cpus) {
@@ -270,64 +1087,338 @@ void SaveDump::saveDump(const RootDirURLVector &urlv)
         if (cpus > online_cpus)
             cpus = online_cpus;
     }
-    if (!config->kdumptoolContainsFlag("SINGLE") &&
+    unsigned long workers = 1;
+    if (!config->kdumptoolContainsFlag(Configuration::FLAG_SINGLE))
+        workers = cpus ? cpus : SystemCPU().numOnline();
+
+    // filtered ELF dumps are made without makedumpfile if possible;
+    // compressed dumps only with DISKDUMP, and makedumpfile splits them
+    unsigned compression = 0;
+    if (config->kdumptoolContainsFlag(Configuration::FLAG_DISKDUMP)) {
+        if (useCompressed)
+            compression = DUMP_DH_COMPRESSED_ZLIB;
+        else if (useZstd)
+            compression = DUMP_DH_COMPRESSED_ZSTD;
+    }
+    if (!DiskdumpDataProvider::supported(compression) ||
+        config->kdumptoolContainsFlag(Configuration::FLAG_SPLIT))
+        compression = 0;
+
+    std::unique_ptr<PageFilter> filter;
+    if (((useElf && dumplevel != 0) || compression) && !excludeDomU &&
+        config->MAKEDUMPFILE_OPTIONS.value().empty() &&
+        !config->kdumptoolContainsFlag(Configuration::FLAG_MAKEDUMPFILE)) {
+        try {
+            SaveStats::Timer timer("filter");
+            filter.reset(new PageFilter(m_dump, dumplevel));
+            // the diskdump writer finds zero pages while it copies them
+            bool zeroPages = !compression;
+            if ((dumplevel & ~PageFilter::DL_ZERO) || zeroPages)
+                filter->run(workers, zeroPages);
+            Debug::debug()->info("%llu pages are excluded",
+                                 filter->excludedPages());
+        } catch (const KError &error) {
+            cerr << "WARNING: " << error.what() << endl;
+            cerr << "Saving the dump with makedumpfile." << endl;
+            filter.reset();
+        }
+    }
+    bool native = useElf && !excludeDomU && (dumplevel == 0 || filter);
+    bool useDiskdump = compression && filter;
+
+    if (!config->kdumptoolContainsFlag(Configuration::FLAG_SINGLE) &&
         cpus > 1) {
 
         /* The check for NOSPLIT is for backward compatibility */
-        if (config->kdumptoolContainsFlag("SPLIT") &&
-            !config->kdumptoolContainsFlag("NOSPLIT")) {
-            if (!useElf)
+        if (config->kdumptoolContainsFlag(Configuration::FLAG_SPLIT) &&
+            !config->kdumptoolContainsFlag(Configuration::FLAG_NOSPLIT)) {
+            if (!useElf || native)
                 m_split = cpus;
             else
                 cerr << "Splitting ELF dumps is not supported." << endl;
         } else {
             if (!useElf)
                 m_threads = cpus - 1;
-            else
+            else if (!native)
                 cerr << "Multithreading is unavailable for ELF dumps" << endl;
         }
     }
 
-    bool excludeDomU = false;
-    if (!config->kdumptoolContainsFlag("XENALLDOMAINS") &&
-	Util::isXenCoreDump(m_dump.c_str()))
-      excludeDomU = true;
+    // every target of a TeeTransfer gets a full copy of the dump, the
+    // next target of a FailoverTransfer must get the same stream, a raw
+    // device holds a single stream, and an object store uploads each
+    // object in parallel parts anyway
+    if (m_split && (dynamic_cast<TeeTransfer *>(m_transfer) ||
+                    dynamic_cast<FailoverTransfer *>(m_transfer) ||
+                    urlv.front().getProtocol() == URLParser::PROT_RAW ||
+                    urlv.front().getProtocol() == URLParser::PROT_S3)) {
+        m_split = 0;
+        m_threads = cpus - 1;
+    }
+
+    // remote targets cannot store split dumps, but the flattened
+    // stream can be striped over parallel connections
+    unsigned long streams = 0;
+    if (m_split && urlv.front().getProtocol() != URLParser::PROT_FILE &&
+        m_transfer->canStripe()) {
+        streams = m_split;
+        m_split = 0;
+        m_threads = cpus - 1;
+    }
+
+    // a local ELF dump is a single file
+    if (native && m_split) {
+        cerr << "Splitting ELF dumps is not supported." << endl;
+        m_split = 0;
+    }
+
+    if (!native && config->kdumptoolContainsFlag(Configuration::FLAG_PRIORITY))
+        cerr << "WARNING: PRIORITY is only available for ELF dumps made by "
+             << "kdumptool." << endl;
+
+    if (native) {
+        // the kernel image first, so that a truncated dump is usable
+        bool priority = config->kdumptoolContainsFlag(
+            Configuration::FLAG_PRIORITY);
+        if (priority) {
+            URLParser::Protocol prot = urlv.front().getProtocol();
+            if (zstdLevel > 0 || m_split || streams ||
+                config->kdumptoolContainsFlag(Configuration::FLAG_DEDUP) ||
+                (config->kdumptoolContainsFlag(Configuration::FLAG_STRIPE) &&
+                 m_transfer->canStripe())) {
+                cerr << "WARNING: PRIORITY is ignored for compressed, "
+                     << "deduplicated, split and striped dumps." << endl;
+                priority = false;
+            } else if (m_transfer->localDirectory().empty() &&
+                       prot != URLParser::PROT_SFTP) {
+                cerr << "WARNING: PRIORITY needs a local or SFTP target."
+                     << endl;
+                priority = false;
+            }
+        }
 
-    if (useElf && dumplevel == 0 && !excludeDomU) {
         // use file source?
-        provider = new FileDataProvider(m_dump.c_str());
+        if (filter)
+            provider = new FilteredElfDataProvider(m_dump.c_str(), *filter,
+                                                   workers, priority);
+        else if (workers > 1 || priority)
+            provider = new SegmentDataProvider(m_dump.c_str(), workers,
+                                               priority);
+        else
+            provider = new FileDataProvider(m_dump.c_str());
         m_useMakedumpfile = false;
+#if HAVE_ZSTD
+        if (zstdLevel > 0) {
+            source.reset(provider);
+            provider = new ZstdDataProvider(source.get(), zstdLevel,
+                                            workers);
+            m_dumpName = "vmcore.zst";
+        }
+#endif
+    } else if (useDiskdump) {
+        // the same file as makedumpfile, also flattened for streams
+        provider = diskdump = new DiskdumpDataProvider(*filter, compression,
+                                                       workers, m_hostname);
+        pageIndex.reset(new PageIndex());
+        diskdump->setIndex(pageIndex.get());
+        m_useMakedumpfile = false;
+        m_flattened = true;
     } else {
         // use makedumpfile
-        ostringstream cmdline;
-        cmdline << "makedumpfile ";
+        StringVector args;
+        args.push_back("makedumpfile");
 	if (m_split)
-	    cmdline << "--split ";
+	    args.push_back("--split");
         if (m_threads) {
-	    SystemCPU syscpu;
-            cmdline << "--num-threads " << m_threads << " ";
+            args.push_back("--num-threads");
+            args.push_back(StringUtil::number2string(m_threads));
+        }
+        // the options are split at whitespace, there is no shell
+        istringstream options(config->MAKEDUMPFILE_OPTIONS.value());
+        string option;
+        while (options >> option)
+            args.push_back(option);
+
+        // fewer passes over the memory of a huge host
+        if (!BitmapPlan::overridden(config->MAKEDUMPFILE_OPTIONS.value())) {
+            string workDir;
+            if (urlv.front().getProtocol() == URLParser::PROT_FILE)
+                workDir = m_transfer->localDirectory();
+            try {
+                BitmapPlan plan = BitmapPlan::forDump(
+                    m_dump, m_split ? m_split : 1, m_threads, workDir,
+                    m_expectedSize);
+                Debug::debug()->info("%s", plan.describe().c_str());
+                StringVector bitmapArgs = plan.options();
+                args.insert(args.end(), bitmapArgs.begin(), bitmapArgs.end());
+
+                SaveStats *stats = SaveStats::stats();
+                stats->setField("bitmap_kb", plan.bitmapKb());
+                stats->setField("bitmap_location",
+                    string(BitmapPlan::locationName(plan.location())));
+                if (plan.cycles())
+                    stats->setField("bitmap_cycles", plan.cycles());
+            } catch (const KError &error) {
+                Debug::debug()->info("No bitmap plan: %s", error.what());
+            }
         }
-        cmdline << config->MAKEDUMPFILE_OPTIONS.value() << " ";
-        cmdline << "-d " << config->KDUMP_DUMPLEVEL.value() << " ";
+
+        args.push_back("-d");
+        args.push_back(StringUtil::number2string(dumplevel));
 	if (excludeDomU)
-	    cmdline << "-X ";
+	    args.push_back("-X");
         if (useElf)
-            cmdline << "-E ";
+            args.push_back("-E");
         if (useCompressed)
-            cmdline << "-c ";
+            args.push_back("-c");
         if (useLZO)
-            cmdline << "-l ";
+            args.push_back("-l");
 	if (useSnappy)
-	    cmdline << "-p ";
-        cmdline << m_dump;
+	    args.push_back("-p");
+        if (useZstd)
+            args.push_back("-z");
+        args.push_back(m_dump);
+
+        StringVector pipeArgs(args);
+        pipeArgs.push_back("-F"); // flattened format
+
+        // targets that can write at any offset unflatten the stream
+        source.reset(process = new ProcessDataProvider(pipeArgs, args));
+        DataProvider *stream = source.get();
+
+        // keep a copy of the stream for ReplayDataProvider
+        const string &record = config->KDUMP_RECORD_STREAM.value();
+        if (!record.empty()) {
+            recording.reset(new RecordingDataProvider(stream, record));
+            stream = recording.get();
+        }
+        provider = flattened = new FlattenedDataProvider(stream);
+        m_useMakedumpfile = m_flattened = true;
+    }
 
-        string directCmdline = cmdline.str();
-        string pipeCmdline = cmdline.str() + " -F"; // flattened format
+    // keep only the pages that earlier dumps of the kernel do not have
+    std::unique_ptr<DataProvider> undeduped;
+    std::unique_ptr<ChunkStore> store;
+    if (config->kdumptoolContainsFlag(Configuration::FLAG_DEDUP)) {
+        string dir = m_transfer->localDirectory();
+        if (!useElf || m_dumpName != "vmcore" || m_split || streams ||
+            (config->kdumptoolContainsFlag(Configuration::FLAG_STRIPE) &&
+             m_transfer->canStripe()))
+            cerr << "WARNING: Only plain ELF dumps can be deduplicated."
+                 << endl;
+        else if (dir.empty())
+            cerr << "WARNING: Dumps can only be deduplicated on a local "
+                 << "or mounted target." << endl;
+        else if (m_crashrelease.empty())
+            cerr << "WARNING: The kernel release is unknown, "
+                 << "the dump is not deduplicated." << endl;
+        else {
+            try {
+                size_t memory =
+                    (size_t)config->KDUMP_DEDUP_INDEX.value() << 20;
+                store.reset(new ChunkStore(
+                    ChunkStore::location(dir, m_crashrelease),
+                    FilePath(dir).baseName(), memory));
+                undeduped.reset(provider);
+                provider = new DedupDataProvider(undeduped.get(),
+                                                 store.get(), m_crashrelease);
+                m_dumpName = "vmcore.dedup";
+            } catch (const KError &error) {
+                cerr << "WARNING: " << error.what() << endl;
+                store.reset();
+            }
+        }
+    }
+
+    // stop the dump while there is still KDUMP_FREE_DISK_SIZE free
+    int reserve = config->KDUMP_FREE_DISK_SIZE.value();
+    if (reserve > 0)
+        m_transfer->setFreeSpaceReserve((unsigned long long)reserve << 20);
+
+    // allocate the expected extent up front; a dedup map is much smaller
+    if (m_expectedSize && !store)
+        m_transfer->setExpectedSize(m_expectedSize);
+
+    // stop a dump that would blow KDUMP_TIME_BUDGET
+    std::unique_ptr<DataProvider> unbounded;
+    if (deadline) {
+        unbounded.reset(provider);
+        provider = new DeadlineDataProvider(unbounded.get(), *deadline,
+                                            m_expectedSize);
+    }
+
+    // read ahead of the transfer in a separate thread
+    std::unique_ptr<DataProvider> unprefetched;
+    int prefetch = config->KDUMP_PREFETCH_DEPTH.value();
+    if (prefetch > 0) {
+        unprefetched.reset(provider);
+        provider = new PrefetchDataProvider(unprefetched.get(), prefetch);
+    }
 
-        provider = new ProcessDataProvider(pipeCmdline.c_str(),
-            directCmdline.c_str());
-        m_useMakedumpfile = true;
+    // makedumpfile may save the dump directly, so it is not counted
+    SaveStats::Timer timer("dump");
+    CountingDataProvider counted(provider);
+    auto fileBytes = [&]() -> unsigned long long {
+        if (urlv.front().getProtocol() != URLParser::PROT_FILE)
+            return 0;
+        StringVector names(1, m_dumpName);
+        if (m_split) {
+            names.clear();
+            for (unsigned long i = 1; i <= m_split; ++i)
+                names.push_back("vmcore" + StringUtil::number2string(i));
+        }
+        unsigned long long ret = 0;
+        for (StringVector::const_iterator it = names.begin();
+             it != names.end(); ++it) {
+            FilePath fp = urlv.front().getRealPath();
+            fp.appendPath(*it);
+            if (fp.exists())
+                ret += fp.fileSize();
+        }
+        return ret;
+    };
+    auto savedBytes = [&]() -> unsigned long long {
+        return m_usedDirectSave ? fileBytes() : counted.bytes();
+    };
+
+    // live progress for the console, the logs and a collector
+    ProgressReporter reporter("Saving dump", m_hostname);
+    try {
+        reporter.addSinks(config->KDUMP_PROGRESS_REPORT.value());
+    } catch (const KError &error) {
+        cout << "WARNING: " << error.what() << endl;
     }
+    if (!reporter.empty() && config->KDUMP_PROGRESS_INTERVAL.value() > 0) {
+        reporter.setInterval(std::chrono::seconds(
+            config->KDUMP_PROGRESS_INTERVAL.value()));
+        unsigned long long total = m_expectedSize;
+        if (!total) {
+            try {
+                bool sparse = !config->kdumptoolContainsFlag(
+                    Configuration::FLAG_NOSPARSE);
+                total = DumpEstimator::fromVmcore(m_dump).estimate(
+                    dumplevel, dumpformat, zstdLevel, cpus ? cpus : 1,
+                    sparse).size;
+            } catch (const KError &error) {
+                KDBG("Cannot estimate the dump size: %s", error.what());
+            }
+        }
+        reporter.setTotal(total);
+        if (process)
+            reporter.setPermille([process]() {
+                    return process->progressPermille();
+                });
+        // when makedumpfile writes the file itself, nothing is counted
+        reporter.start([&]() {
+                unsigned long long bytes = counted.bytes();
+                return bytes ? bytes : fileBytes();
+            });
+    }
+
+    auto placed = [&]() {
+        return (flattened && flattened->placed()) ||
+            (diskdump && diskdump->placed());
+    };
 
     try {
         if (m_useMakedumpfile) {
@@ -337,7 +1428,7 @@ void SaveDump::saveDump(const RootDirURLVector &urlv)
         TerminalProgress progress("Saving dump");
         if (config->KDUMP_VERBOSE.value()
 	    & Configuration::VERB_PROGRESS)
-            provider->setProgress(&progress);
+            counted.setProgress(&progress);
         else
             cout << "Saving dump ..." << endl;
 	if (m_split) {
@@ -347,22 +1438,75 @@ void SaveDump::saveDump(const RootDirURLVector &urlv)
 		ss << "vmcore" << i;
 		targets.push_back(ss.str());
 	    }
-	    m_transfer->perform(provider, targets, &m_usedDirectSave);
+	    saveFile(&counted, targets, &m_usedDirectSave);
+	} else if (streams ||
+                   (config->kdumptoolContainsFlag(Configuration::FLAG_STRIPE) &&
+                    m_transfer->canStripe())) {
+            if (!streams)
+                streams = urlv.size();
+            if (m_checksum) {
+                ChecksumDataProvider checked(&counted, m_checksumChunk);
+                m_transfer->performStriped(&checked, m_dumpName,
+                                           STRIPE_CHUNK_SIZE, streams);
+                recordChecksum(checked, m_dumpName);
+            } else
+                m_transfer->performStriped(&counted, m_dumpName,
+                                           STRIPE_CHUNK_SIZE, streams);
+            m_usedDirectSave = false;
+            m_striped = true;
 	} else {
-	    m_transfer->perform(provider, "vmcore", &m_usedDirectSave);
+	    saveFile(&counted, m_dumpName, &m_usedDirectSave);
 	}
+        reporter.stop(true);
+        m_unflattened = placed();
+        timer.bytes(savedBytes());
+        if (store)
+            cout << "Deduplicated: " << store->found()
+                 << " pages found in earlier dumps, " << store->added()
+                 << " pages stored." << endl;
         if (m_useMakedumpfile)
             terminal.printLine();
+    } catch (const KNoSpaceError &error) {
+        m_transfer->setFreeSpaceReserve(0);
+        m_transfer->setExpectedSize(0);
+        m_unflattened = placed();
+        timer.bytes(savedBytes());
+        delete provider;
+        m_noSpace = true;
+        if (!config->kdumptoolContainsFlag(Configuration::FLAG_TRUNCATE))
+            throw;
+        cout << "WARNING: " << error.what() << endl;
+        cout << "The dump is incomplete." << endl;
+        m_truncated = true;
     } catch (...) {
+        m_transfer->setFreeSpaceReserve(0);
+        m_transfer->setExpectedSize(0);
+        timer.bytes(savedBytes());
         delete provider;
         throw;
     }
+    m_transfer->setFreeSpaceReserve(0);
+    m_transfer->setExpectedSize(0);
+
+    // the offsets are wrong for parts and stripes, and the dump is
+    // usable without its index
+    if (pageIndex && !pageIndex->empty() && !m_truncated && !m_split &&
+        !m_striped) {
+        try {
+            string s = pageIndex->str();
+            BufferDataProvider indexProvider(s.data(), s.size());
+            m_transfer->perform(&indexProvider,
+                                m_dumpName + PAGE_INDEX_SUFFIX, NULL);
+        } catch (const KError &error) {
+            cerr << "WARNING: Cannot save the page index: " << error.what()
+                 << endl;
+        }
+    }
 }
 
 // -----------------------------------------------------------------------------
 void SaveDump::copyMakedumpfile()
 {
-    Configuration *config = Configuration::config();
     string makedumpfile_binary;
     const char *env_path;
 
@@ -383,32 +1527,57 @@ void SaveDump::copyMakedumpfile()
     if (makedumpfile_binary.size() == 0)
         throw KError("makedumpfile-R.pl not found.");
 
-    FileDataProvider provider(makedumpfile_binary.c_str());
-    TerminalProgress progress("Saving makedumpfile-R.pl");
-    if (config->KDUMP_VERBOSE.value()
-	& Configuration::VERB_PROGRESS)
-        provider.setProgress(&progress);
-    else
-        cout << "Saving makedumpfile-R.pl ..." << endl;
-    m_transfer->perform(&provider, "makedumpfile-R.pl", NULL);
-
-    generateRearrange();
+    std::ifstream fin(makedumpfile_binary.c_str(), std::ios::binary);
+    ostringstream perl;
+    perl << fin.rdbuf();
+    if (!fin)
+        throw KError("Cannot read " + makedumpfile_binary + ".");
+
+    // together with the script that uses it: one round trip on a
+    // network target
+    ArtifactBatch artifacts;
+    artifacts.push_back(std::make_pair("makedumpfile-R.pl", perl.str()));
+    artifacts.push_back(std::make_pair("rearrange.sh", rearrangeScript()));
+    cout << "Saving makedumpfile-R.pl and the rearrange script ..." << endl;
+    saveArtifacts(artifacts);
 }
 
 // -----------------------------------------------------------------------------
-void SaveDump::generateRearrange()
+string SaveDump::rearrangeScript()
 {
-    Configuration *config = Configuration::config();
-
-    // and also generate a "rearrange" script
     static const char script[] =
       "#!/bin/sh" "\n"
       "\n"
-      "# rename the flattened vmcore" "\n"
-      "mv vmcore vmcore.flattened || exit 1" "\n"
+      "# prefer kdumptool, which is much faster than the perl script" "\n"
+      "if command -v kdumptool >/dev/null 2>&1 ; then" "\n"
+      "    have_kdumptool=1" "\n"
+      "fi" "\n"
+      "\n"
+      "# try to unflatten in place, without a second copy;" "\n"
+      "# status 2 means that this is not possible and nothing has changed" "\n"
+      "if [ ! -f vmcore.stripes -a -n \"$have_kdumptool\" ] ; then" "\n"
+      "    kdumptool rearrange --in-place vmcore" "\n"
+      "    status=$?" "\n"
+      "    if [ $status -eq 0 ] ; then" "\n"
+      "        rm makedumpfile-R.pl \"$0\" || exit 1" "\n"
+      "        exit 0" "\n"
+      "    fi" "\n"
+      "    [ $status -eq 2 ] || exit 1" "\n"
+      "fi" "\n"
+      "\n"
+      "# rename the flattened vmcore (or join the stripes)" "\n"
+      "if [ -f vmcore.stripes ] ; then" "\n"
+      "    perl unstripe.pl vmcore.stripes vmcore.flattened || exit 1" "\n"
+      "else" "\n"
+      "    mv vmcore vmcore.flattened || exit 1" "\n"
+      "fi" "\n"
       "\n"
       "# unflatten" "\n"
-      "perl makedumpfile-R.pl vmcore < vmcore.flattened || exit 1 " "\n"
+      "if [ -n \"$have_kdumptool\" ] ; then" "\n"
+      "    kdumptool rearrange vmcore.flattened vmcore || exit 1" "\n"
+      "else" "\n"
+      "    perl makedumpfile-R.pl vmcore < vmcore.flattened || exit 1" "\n"
+      "fi" "\n"
       "\n"
       "# delete the original dump" "\n"
       "rm vmcore.flattened || exit 1 " "\n"
@@ -422,21 +1591,90 @@ void SaveDump::generateRearrange()
       "exit 0" "\n"
       "# EOF" "\n";
 
-    TerminalProgress progress2("Generating rearrange script");
-    BufferDataProvider provider2(script, sizeof(script) - 1);
+    return string(script, sizeof(script) - 1);
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::generateUnstripe()
+{
+    Configuration *config = Configuration::config();
+
+    // usage: perl unstripe.pl [MAP [OUTPUT [STRIPE...]]]
+    static const char script[] =
+      "#!/usr/bin/perl" "\n"
+      "\n"
+      "# join the stripes of a dump saved with KDUMPTOOL_FLAGS=STRIPE" "\n"
+      "use strict;" "\n"
+      "use warnings;" "\n"
+      "\n"
+      "my $map = shift @ARGV // 'vmcore.stripes';" "\n"
+      "my $out = shift @ARGV // 'vmcore';" "\n"
+      "my ($chunk, $total, @stripes);" "\n"
+      "\n"
+      "open(my $mh, '<', $map) or die \"$map: $!\\n\";" "\n"
+      "while (<$mh>) {" "\n"
+      "    chomp;" "\n"
+      "    next if /^#/ || !/\\S/;" "\n"
+      "    my ($key, $val) = split(/\\s+/, $_, 2);" "\n"
+      "    if ($key eq 'chunk_size') { $chunk = $val; }" "\n"
+      "    elsif ($key eq 'total_size') { $total = $val; }" "\n"
+      "    elsif ($key eq 'stripe') { push(@stripes, $val); }" "\n"
+      "    else { die \"$map: unknown key $key\\n\"; }" "\n"
+      "}" "\n"
+      "close($mh);" "\n"
+      "die \"$map: incomplete stripe map\\n\"" "\n"
+      "    unless $chunk && defined($total) && @stripes;" "\n"
+      "\n"
+      "# the stripes may have been moved" "\n"
+      "if (@ARGV) {" "\n"
+      "    die \"expected \" . @stripes . \" stripe files\\n\"" "\n"
+      "        unless @ARGV == @stripes;" "\n"
+      "    @stripes = @ARGV;" "\n"
+      "}" "\n"
+      "\n"
+      "my @fh;" "\n"
+      "foreach my $name (@stripes) {" "\n"
+      "    open(my $fh, '<:raw', $name) or die \"$name: $!\\n\";" "\n"
+      "    push(@fh, $fh);" "\n"
+      "}" "\n"
+      "open(my $oh, '>:raw', $out) or die \"$out: $!\\n\";" "\n"
+      "\n"
+      "# chunks are distributed round-robin; keep zero chunks sparse" "\n"
+      "my $pos = 0;" "\n"
+      "for (my $i = 0; $pos < $total; ++$i) {" "\n"
+      "    my $len = $total - $pos < $chunk ? $total - $pos : $chunk;" "\n"
+      "    my $n = $i % @fh;" "\n"
+      "    my $buf;" "\n"
+      "    my $got = read($fh[$n], $buf, $len);" "\n"
+      "    die \"$stripes[$n]: short read\\n\"" "\n"
+      "        unless defined($got) && $got == $len;" "\n"
+      "    if ($buf =~ /^\\0*\\z/) {" "\n"
+      "        seek($oh, $len, 1) or die \"$out: $!\\n\";" "\n"
+      "    } else {" "\n"
+      "        print $oh $buf or die \"$out: $!\\n\";" "\n"
+      "    }" "\n"
+      "    $pos += $len;" "\n"
+      "}" "\n"
+      "truncate($oh, $total) or die \"$out: $!\\n\";" "\n"
+      "close($oh) or die \"$out: $!\\n\";" "\n"
+      "exit 0;" "\n"
+      "# EOF" "\n";
+
+    TerminalProgress progress("Generating unstripe script");
+    BufferDataProvider provider(script, sizeof(script) - 1);
     if (config->KDUMP_VERBOSE.value()
 	& Configuration::VERB_PROGRESS)
-        provider2.setProgress(&progress2);
+        provider.setProgress(&progress);
     else
-        cout << "Generating rearrange script" << endl;
-    m_transfer->perform(&provider2, "rearrange.sh", NULL);
+        cout << "Generating unstripe script" << endl;
+    saveFile(&provider, "unstripe.pl");
 }
 
 // -----------------------------------------------------------------------------
 void SaveDump::fillVmcoreinfo()
 {
-    Vmcoreinfo vm;
-    vm.readFromELF(m_dump.c_str());
+    // parses the dump headers for all later users
+    const Vmcoreinfo &vm = VmcoreContext::get(m_dump)->vmcoreinfo();
 
     try {
         m_crashtime = vm.getLLongValue("CRASHTIME");
@@ -476,28 +1714,100 @@ void SaveDump::generateInfo()
     ss << "----------------" << endl;
     ss << endl;
 
-    if (m_hostname.size() == 0)
-        m_hostname = Util::getHostDomain();
-
     infoLine(ss, "Crash time",
              StringUtil::formatUnixTime("%Y-%m-%d %H:%M (%z)", m_crashtime));
 
     if (m_crashrelease.size() > 0)
         infoLine(ss, "Kernel version", m_crashrelease);
     infoLine(ss, "Host", m_hostname);
-    infoLine(ss, "Dump level", config->KDUMP_DUMPLEVEL.value());
-    infoLine(ss, "Dump format", config->KDUMP_DUMPFORMAT.value());
+    if (m_dumpFormat.empty()) {
+        infoLine(ss, "Dump level", config->KDUMP_DUMPLEVEL.value());
+        infoLine(ss, "Dump format", config->KDUMP_DUMPFORMAT.value());
+    } else {
+        infoLine(ss, "Dump level", m_dumpLevel);
+        infoLine(ss, "Dump format", m_dumpFormat);
+    }
     if (m_split && m_usedDirectSave)
         infoLine(ss, "Split parts", m_split);
+    infoLine(ss, "Timing", SaveStats::stats()->summary());
     ss << endl;
 
-    if (m_useMakedumpfile && !m_usedDirectSave) {
+    if (!m_codecs.empty()) {
+        ss << "KDUMP_DUMPFORMAT=auto";
+        if (m_codecTarget)
+            ss << " for a target writing "
+               << bytes_to_megabytes(m_codecTarget) << " MiB/s";
+        ss << ":" << endl;
+        for (size_t i = 0; i < m_codecs.size(); ++i)
+            ss << "  " << m_codecs[i].format << ": "
+               << (unsigned)(m_codecs[i].ratio * 100 + 0.5)
+               << "% of the input at "
+               << bytes_to_megabytes(m_codecs[i].rate) << " MiB/s"
+               << (m_codecs[i].measured ? "" : " (derived from zlib)")
+               << endl;
+        ss << endl;
+    }
+
+    if (m_flattened && !m_usedDirectSave && !m_unflattened) {
         ss << "NOTE:" << endl;
         ss << "This dump was saved in makedumpfile flattened format." << endl;
         ss << "To read the dump with crash, run \"sh rearrange.sh\" before."
            << endl;
     }
 
+    if (m_striped) {
+        ss << "NOTE:" << endl;
+        ss << "This dump was striped over several directories." << endl;
+        if (m_flattened)
+            ss << "\"sh rearrange.sh\" joins the stripes." << endl;
+        else
+            ss << "To join the stripes, run \"perl unstripe.pl "
+               << m_dumpName << ".stripes " << m_dumpName << "\"." << endl;
+    }
+
+    if (m_truncated) {
+        ss << "NOTE:" << endl;
+        ss << "This dump is incomplete, because less than "
+           << config->KDUMP_FREE_DISK_SIZE.value()
+           << " MiB (KDUMP_FREE_DISK_SIZE)" << endl;
+        ss << "would have been left free on the target." << endl;
+    }
+
+    if (m_dumpName == "vmcore.zst") {
+        ss << "NOTE:" << endl;
+        ss << "This ELF dump was compressed in zstd seekable format." << endl;
+        ss << "To read the dump with crash or gdb, run "
+              "\"zstd -d vmcore.zst\" before." << endl;
+    }
+
+    if (!m_budgetNote.empty()) {
+        ss << "NOTE:" << endl;
+        ss << m_budgetNote << endl;
+    }
+
+    if (m_dumpName == "vmcore.dedup") {
+        ss << "NOTE:" << endl;
+        ss << "The pages of this dump are stored in ../" DEDUP_STORE "/"
+           << m_crashrelease << "/." << endl;
+        ss << "To read the dump with crash or gdb, run "
+              "\"kdumptool reconstruct vmcore.dedup\" before." << endl;
+    }
+
+    TeeTransfer *tee = dynamic_cast<TeeTransfer *>(m_transfer);
+    FailoverTransfer *failover = dynamic_cast<FailoverTransfer *>(m_transfer);
+    StringVector failed;
+    if (tee)
+        failed = tee->failedLegs();
+    else if (failover)
+        failed = failover->failedLegs();
+    if (!failed.empty()) {
+        ss << "NOTE:" << endl;
+        ss << "Saving this dump failed on the following targets:" << endl;
+        for (StringVector::const_iterator it = failed.begin();
+             it != failed.end(); ++it)
+            ss << "    " << *it << endl;
+    }
+
     TerminalProgress progress("Generating README");
     string const& s = ss.str();
     BufferDataProvider provider(s.c_str(), s.size());
@@ -506,40 +1816,201 @@ void SaveDump::generateInfo()
         provider.setProgress(&progress);
     else
         cout << "Generating README" << endl;
-    m_transfer->perform(&provider, "README.txt", NULL);
+    saveFile(&provider, "README.txt");
 }
 
 // -----------------------------------------------------------------------------
-void SaveDump::copyKernel()
+void SaveDump::generateStats(bool failed)
+{
+    Debug::debug()->trace("SaveDump::generateStats");
+    Configuration *config = Configuration::config();
+
+    SaveStats *stats = SaveStats::stats();
+    stats->setField("crash_time", m_crashtime);
+    stats->setField("host", m_hostname);
+    stats->setField("kernel", m_crashrelease);
+    if (m_dumpFormat.empty()) {
+        stats->setField("dump_level", config->KDUMP_DUMPLEVEL.value());
+        stats->setField("dump_format", config->KDUMP_DUMPFORMAT.value());
+    } else {
+        stats->setField("dump_level", m_dumpLevel);
+        stats->setField("dump_format", m_dumpFormat);
+    }
+    if (m_numaNode >= 0)
+        stats->setField("numa_node", (unsigned long long)m_numaNode);
+    BufferPool *pool = BufferPool::pool();
+    stats->setField("buffer_limit", pool->limit());
+    stats->setField("buffer_peak", pool->peak());
+    stats->setField("buffer_overcommits", pool->overcommits());
+    if (!m_codecs.empty()) {
+        stats->setField("target_rate", m_codecTarget);
+        for (size_t i = 0; i < m_codecs.size(); ++i) {
+            const string key = "codec_" + m_codecs[i].format;
+            stats->setField(key + "_ratio_pct",
+                            (unsigned long long)(m_codecs[i].ratio * 100 + 0.5));
+            stats->setField(key + "_rate",
+                            (unsigned long long)m_codecs[i].rate);
+        }
+    }
+    stats->setField("status", string(failed ? "failed" :
+                                     m_truncated ? "truncated" : "ok"));
+
+    string const& s = stats->json();
+    BufferDataProvider provider(s.c_str(), s.size());
+    cout << "Generating " STATS_FILE << endl;
+    m_transfer->perform(&provider, STATS_FILE, NULL);
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::catalogDump(const RootDirURLVector &urlv, const string &status)
+{
+    Debug::debug()->trace("SaveDump::catalogDump(%s)", status.c_str());
+    Configuration *config = Configuration::config();
+
+    DumpCatalog::Entry entry;
+    entry.crashTime = m_crashtime;
+    entry.status = status;
+    if (status != "saving") {
+        entry.format = m_dumpFormat.empty() ?
+            config->KDUMP_DUMPFORMAT.value() : m_dumpFormat;
+        entry.parts = m_usedDirectSave ? m_split : 0;
+        entry.checksum = !m_checksum ? "none" :
+            m_usedDirectSave ? "partial" : "crc32c";
+    }
+
+    RootDirURLVector::const_iterator it;
+    for (it = urlv.begin(); it != urlv.end(); ++it) {
+        if (it->getProtocol() != URLParser::PROT_FILE)
+            continue;
+
+        FilePath path = it->getRealPath();
+        entry.name = path.baseName();
+        try {
+            DumpCatalog catalog(path.dirName());
+            // the first record walks the directory, which can wait
+            // until the dump is safe
+            if (status == "saving") {
+                if (catalog.exists())
+                    catalog.add(entry);
+            } else if (path.exists()) {
+                entry.size = path.diskUsage();
+                catalog.add(entry);
+            } else if (catalog.exists())
+                catalog.remove(entry.name);
+        } catch (const KError &error) {
+            cout << "WARNING: " << error.what() << endl;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::saveTriage(const RootDirURLVector &urlv)
+{
+    Debug::debug()->trace("SaveDump::saveTriage");
+    Configuration *config = Configuration::config();
+
+    SaveStats::Timer timer("triage");
+    std::unique_ptr<Transfer> transfer(getTransfer(urlv, &m_prepared));
+
+    ostringstream vmcoreinfo;
+    try {
+        const Vmcoreinfo &vm = VmcoreContext::get(m_dump)->vmcoreinfo();
+        StringList keys = vm.getKeys();
+        for (StringList::const_iterator it = keys.begin();
+             it != keys.end(); ++it)
+            vmcoreinfo << *it << '=' << vm.getStringValue(it->c_str())
+                       << endl;
+    } catch (const KError &error) {
+        Debug::debug()->dbg("No VMCOREINFO for triage: %s", error.what());
+    }
+
+    ostringstream readme;
+    readme << "Kernel crashdump triage" << endl;
+    readme << "-----------------------" << endl;
+    readme << endl;
+    infoLine(readme, "Crash time",
+             StringUtil::formatUnixTime("%Y-%m-%d %H:%M (%z)", m_crashtime));
+    if (m_crashrelease.size() > 0)
+        infoLine(readme, "Kernel version", m_crashrelease);
+    infoLine(readme, "Host", m_hostname);
+    infoLine(readme, "Dump level", config->KDUMP_DUMPLEVEL.value());
+    infoLine(readme, "Dump format", config->KDUMP_DUMPFORMAT.value());
+    infoLine(readme, "Dump target", config->KDUMP_SAVEDIR.value());
+    readme << endl;
+    readme << "The full dump was still being saved when this bundle was sent."
+           << endl;
+    if (m_triageLog.empty())
+        readme << "The kernel log could not be read without makedumpfile; "
+                  "it is saved with the dump." << endl;
+
+    // the fields of stats.json that are known before the dump
+    ostringstream stats;
+    stats << "{" << endl
+          << "  \"crash_time\": " << m_crashtime << "," << endl
+          << "  \"host\": " << StringUtil::jsonString(m_hostname) << ","
+          << endl
+          << "  \"kernel\": " << StringUtil::jsonString(m_crashrelease)
+          << "," << endl
+          << "  \"dump_level\": " << config->KDUMP_DUMPLEVEL.value() << ","
+          << endl
+          << "  \"dump_format\": "
+          << StringUtil::jsonString(config->KDUMP_DUMPFORMAT.value()) << ","
+          << endl
+          << "  \"status\": \"saving\"" << endl
+          << "}" << endl;
+
+    // most important first, in case the connection breaks
+    ArtifactBatch files;
+    if (!m_triageLog.empty())
+        files.push_back(std::make_pair("dmesg.txt", m_triageLog));
+    if (!vmcoreinfo.str().empty())
+        files.push_back(std::make_pair("vmcoreinfo.txt", vmcoreinfo.str()));
+    files.push_back(std::make_pair("README.txt", readme.str()));
+    files.push_back(std::make_pair(STATS_FILE, stats.str()));
+
+    unsigned long long bytes = 0;
+    for (size_t i = 0; i < files.size(); ++i)
+        bytes += files[i].second.size();
+    transfer->performBatch(files);
+    timer.bytes(bytes);
+    m_triageLog.clear();
+    cout << "Triage bundle saved" << endl;
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::copyKernel(Transfer *transfer, bool progress)
 {
     Debug::debug()->trace("SaveDump::copyKernel()");
 
     Configuration *config = Configuration::config();
+    progress = progress &&
+        (config->KDUMP_VERBOSE.value() & Configuration::VERB_PROGRESS);
 
+    SaveStats::Timer timer("kernel");
     FilePath mapfile = findMapfile();
     FilePath kernel = findKernel();
     FilePath fp;
+    unsigned long long bytes = 0;
 
     // mapfile
     TerminalProgress mapProgress("Copying System.map");
     (fp = m_rootdir).appendPath(mapfile);
     FileDataProvider mapProvider(fp.c_str());
-    if (config->KDUMP_VERBOSE.value()
-	& Configuration::VERB_PROGRESS)
+    if (progress)
         mapProvider.setProgress(&mapProgress);
     else
         cout << "Copying System.map" << endl;
-    m_transfer->perform(&mapProvider, mapfile.baseName().c_str());
+    bytes += saveFile(&mapProvider, mapfile.baseName(), NULL, transfer);
 
     TerminalProgress kernelProgress("Copying kernel");
     (fp = m_rootdir).appendPath(kernel);
     FileDataProvider kernelProvider(fp.c_str());
-    if (config->KDUMP_VERBOSE.value()
-	& Configuration::VERB_PROGRESS)
+    if (progress)
         kernelProvider.setProgress(&kernelProgress);
     else
         cout << "Copying kernel" << endl;
-    m_transfer->perform(&kernelProvider, kernel.baseName().c_str());
+    bytes += saveFile(&kernelProvider, kernel.baseName(), NULL, transfer);
+    timer.bytes(bytes);
 }
 
 // -----------------------------------------------------------------------------
@@ -616,6 +2087,165 @@ string SaveDump::findMapfile()
     throw KError("No System.map found in " + fp);
 }
 
+// -----------------------------------------------------------------------------
+void SaveDump::preflight(RootDirURLVector &urlv)
+{
+    Debug::debug()->trace("SaveDump::preflight()");
+
+    Configuration *config = Configuration::config();
+    unsigned long long reserve =
+        (unsigned long long)config->KDUMP_FREE_DISK_SIZE.value() << 20;
+
+    // usable space of the local targets, -1 for the others; the dump
+    // directory does not exist yet
+    std::vector<long long> room;
+    size_t local = 0;
+    auto measure = [&]() {
+        room.clear();
+        local = 0;
+        RootDirURLVector::const_iterator it;
+        for (it = urlv.begin(); it != urlv.end(); ++it) {
+            long long space = -1;
+            if (it->getProtocol() == URLParser::PROT_FILE) {
+                FilePath dir = it->getRealPath();
+                while (!dir.exists() && dir.size() > 1)
+                    dir = dir.dirName();
+                try {
+                    unsigned long long freeSize = dir.freeDiskSize();
+                    space = freeSize > reserve ? freeSize - reserve : 0;
+                    ++local;
+                } catch (const KError &error) {
+                    Debug::debug()->dbg("%s", error.what());
+                }
+            }
+            room.push_back(space);
+        }
+    };
+    measure();
+    if (!local)
+        return;
+
+    int dumplevel = config->KDUMP_DUMPLEVEL.value();
+    if (dumplevel < 0 || dumplevel > 31)
+        dumplevel = 0;
+    unsigned long workers = 1;
+    if (!config->kdumptoolContainsFlag(Configuration::FLAG_SINGLE) &&
+        config->KDUMP_CPUS.value() > 1)
+        workers = config->KDUMP_CPUS.value();
+    bool sparse = !config->kdumptoolContainsFlag(Configuration::FLAG_NOSPARSE);
+    bool striped = local > 1 &&
+        config->kdumptoolContainsFlag(Configuration::FLAG_STRIPE);
+
+    std::unique_ptr<DumpEstimator> estimator;
+    DumpEstimator::Result est;
+    try {
+        estimator.reset(new DumpEstimator(DumpEstimator::fromVmcore(m_dump)));
+        est = estimator->estimate(dumplevel,
+                                  config->KDUMP_DUMPFORMAT.value(),
+                                  config->KDUMP_ELF_ZSTD_LEVEL.value(),
+                                  workers, sparse);
+        m_expectedSize = est.size;
+        m_expectedSeconds = est.seconds;
+    } catch (const KError &error) {
+        Debug::debug()->dbg("Cannot estimate the dump size: %s",
+                            error.what());
+        return;
+    }
+
+    // a striped dump is spread over all local targets
+    auto available = [&](size_t i) -> unsigned long long {
+        if (!striped)
+            return room[i];
+        unsigned long long total = 0;
+        for (size_t j = 0; j < room.size(); ++j)
+            if (room[j] > 0)
+                total += room[j];
+        return total;
+    };
+    auto fits = [&](unsigned long long need, size_t i) {
+        return room[i] < 0 || available(i) >= need;
+    };
+    auto allFit = [&](unsigned long long need) {
+        for (size_t i = 0; i < room.size(); ++i)
+            if (!fits(need, i))
+                return false;
+        return true;
+    };
+
+    // old dumps may still be deleted in the background (see kdump-save);
+    // wait only until the dump fits, the rest is deleted meanwhile
+    auto waitFor = [&](unsigned long long need) {
+        if (!m_oldDumps || !m_oldDumps->running())
+            return;
+        SaveStats::Timer timer("delete-wait");
+        m_oldDumps->waitUntil([&]() {
+                measure();
+                return allFit(need);
+            });
+    };
+    waitFor(est.maximum);
+
+    if (allFit(est.maximum)) {
+        Debug::debug()->dbg("Largest possible dump (%llu MiB) fits",
+                            bytes_to_megabytes(est.maximum));
+        return;
+    }
+
+    if (estimator->analyze(m_dump, false)) {
+        est = estimator->estimate(dumplevel,
+                                  config->KDUMP_DUMPFORMAT.value(),
+                                  config->KDUMP_ELF_ZSTD_LEVEL.value(),
+                                  workers, sparse);
+        m_expectedSize = est.size;
+        m_expectedSeconds = est.seconds;
+    }
+    cout << "Estimated dump size: " << bytes_to_megabytes(est.size)
+         << " MiB (at least " << bytes_to_megabytes(est.minimum)
+         << " MiB)" << endl;
+
+    // if the expected dump fits before the background deletion is over,
+    // it goes on while the dump is saved, and SpaceGuard notices the
+    // space that it frees
+    waitFor(est.size);
+    if (m_oldDumps && m_oldDumps->running()) {
+        Debug::debug()->dbg("Saving while old dumps are deleted");
+        return;
+    }
+
+    // delete old dumps to make room for the largest dump
+    DeleteDumps deleter;
+    for (size_t i = 0; i < urlv.size(); ++i) {
+        if (fits(est.maximum, i))
+            continue;
+        FilePath target = urlv[i].getRealPath();
+        try {
+            SaveStats::Timer timer("delete");
+            unsigned long long freed =
+                deleter.makeRoom(target.dirName(),
+                                 est.maximum - available(i),
+                                 target.baseName());
+            timer.bytes(freed);
+            room[i] += freed;
+        } catch (const KError &error) {
+            cout << "WARNING: Cannot delete old dumps: " << error.what()
+                 << endl;
+        }
+    }
+
+    // remove the targets that cannot hold even the smallest dump
+    RootDirURLVector keep;
+    for (size_t i = 0; i < urlv.size(); ++i) {
+        if (fits(est.minimum, i))
+            keep.push_back(urlv[i]);
+        else
+            cout << "WARNING: Not enough space for the dump in "
+                 << urlv[i].getRealPath() << ", skipping." << endl;
+    }
+    if (keep.empty())
+        throw KError("Dump too large. Aborting. Check KDUMP_FREE_DISK_SIZE.");
+    urlv.swap(keep);
+}
+
 // -----------------------------------------------------------------------------
 void SaveDump::checkAndDelete(const RootDirURLVector &urlv)
 {
@@ -624,6 +2254,39 @@ void SaveDump::checkAndDelete(const RootDirURLVector &urlv)
 	checkOne(*it);
 }
 
+// -----------------------------------------------------------------------------
+void SaveDump::syncTargets(const RootDirURLVector &urlv)
+{
+    Debug::debug()->trace("SaveDump::syncTargets");
+
+    bool mounted = false;
+    RootDirURLVector::const_iterator it;
+    for (it = urlv.begin(); it != urlv.end(); ++it) {
+        if (it->getProtocol() == URLParser::PROT_NFS ||
+            it->getProtocol() == URLParser::PROT_CIFS) {
+            mounted = true;
+            continue;
+        }
+        // raw devices are synced by RawTransfer
+        if (it->getProtocol() != URLParser::PROT_FILE)
+            continue;
+
+        FilePath path = it->getRealPath();
+        int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0)
+            throw KSystemError("Cannot open " + path, errno);
+        int res = syncfs(fd);
+        int err = errno;
+        close(fd);
+        if (res != 0)
+            throw KSystemError("Cannot sync " + path, err);
+    }
+
+    // the share is mounted somewhere below /mnt by the transfer
+    if (mounted)
+        sync();
+}
+
 // -----------------------------------------------------------------------------
 void SaveDump::checkOne(const RootDirURL &parser)
 {
@@ -639,6 +2302,17 @@ void SaveDump::checkOne(const RootDirURL &parser)
     FilePath path = parser.getRealPath();
     Configuration *config = Configuration::config();
 
+    if (m_truncated) {
+        Debug::debug()->dbg("Keeping the truncated dump.");
+        return;
+    }
+
+    // the dump has been stopped early, but it is not complete
+    if (m_noSpace) {
+        path.rmdir(true);
+        throw KError("Dump too large. Aborting. Check KDUMP_FREE_DISK_SIZE.");
+    }
+
     unsigned long long freeSize = path.freeDiskSize();
     unsigned long long targetDiskSize = config->KDUMP_FREE_DISK_SIZE.value();
 
@@ -656,6 +2330,45 @@ void SaveDump::sendNotification(bool failure, const RootDirURLVector &urlv)
 {
     Debug::debug()->trace("SaveDump::sendNotification");
 
+    ostringstream ss;
+    ss << "Your machine " + m_hostname + " crashed." << endl;
+
+    if (failure)
+        ss << "Copying dump failed." << endl;
+    else {
+        ss << "Dump has been copied to" << endl;
+        RootDirURLVector::const_iterator it;
+        for (it = urlv.begin(); it != urlv.end(); ++it)
+            ss << it->getURL() << endl;
+    }
+
+    queueEmail("kdump: " + m_hostname + " crashed", ss.str());
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::sendStartNotification(const RootDirURLVector &urlv)
+{
+    Debug::debug()->trace("SaveDump::sendStartNotification");
+
+    ostringstream ss;
+    ss << "Your machine " + m_hostname + " crashed." << endl
+       << "Saving the dump to" << endl;
+    RootDirURLVector::const_iterator it;
+    for (it = urlv.begin(); it != urlv.end(); ++it)
+        ss << it->getURL() << endl;
+    if (m_expectedSize)
+        ss << "Estimated dump size: " << bytes_to_megabytes(m_expectedSize)
+           << " MiB" << endl;
+    if (m_expectedSeconds)
+        ss << "Estimated duration: " << (m_expectedSeconds + 59) / 60
+           << " minute(s)" << endl;
+
+    queueEmail("kdump: " + m_hostname + " crashed, saving dump", ss.str());
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::queueEmail(const string &subject, const string &body)
+{
 #if !HAVE_LIBESMTP
     Debug::debug()->dbg("Email support is not compiled-in.");
 #else
@@ -681,14 +2394,11 @@ void SaveDump::sendNotification(bool failure, const RootDirURLVector &urlv)
         if (NotificationTo.size() == 0)
             throw KError("No recipients specified in KDUMP_NOTIFICATION_TO.");
 
-        if (m_hostname.size() == 0)
-            m_hostname = Util::getHostDomain();
-
         Email email("root@" + m_hostname);
         email.setHostname(m_hostname);
         email.setTo(NotificationTo);
 
-	const std::string &NotificationCc =
+        const std::string &NotificationCc =
             config->KDUMP_NOTIFICATION_CC.value();
         if (NotificationCc.size() != 0) {
             istringstream split(NotificationCc);
@@ -700,23 +2410,18 @@ void SaveDump::sendNotification(bool failure, const RootDirURLVector &urlv)
             }
         }
 
-        ostringstream ss;
-        email.setSubject("kdump: " + m_hostname + " crashed");
-
-        ss << "Your machine " + m_hostname + " crashed." << endl;
-
-        if (failure)
-            ss << "Copying dump failed." << endl;
-        else {
-	    ss << "Dump has been copied to" << endl;
-	    RootDirURLVector::const_iterator it;
-            for (it = urlv.begin(); it != urlv.end(); ++it)
-                ss << it->getURL() << endl;
-	}
-
-        email.setBody(ss.str());
-
-        email.send();
+        email.setSubject(subject);
+        email.setBody(body);
+
+        // the relay may be slow or unreachable, so the mail is sent in
+        // the background; kdump-save waits for it before the reboot
+        NotificationQueue::queue()->post("email", [email]() mutable {
+                try {
+                    email.send();
+                } catch (const KError &err) {
+                    Debug::debug()->info("Email failed: %s", err.what());
+                }
+            });
     } catch (const KError &err) {
         Debug::debug()->info("Email failed: %s", err.what());
     }
@@ -751,7 +2456,27 @@ string SaveDump::getKernelReleaseCommandline()
 }
 
 // -----------------------------------------------------------------------------
-Transfer *SaveDump::getTransfer(const RootDirURLVector &urlv)
+std::vector<RootDirURLVector>
+SaveDump::groupByProtocol(const RootDirURLVector &urlv)
+{
+    std::vector<RootDirURLVector> groups;
+    RootDirURLVector::const_iterator it;
+    for (it = urlv.begin(); it != urlv.end(); ++it) {
+        std::vector<RootDirURLVector>::iterator group;
+        for (group = groups.begin(); group != groups.end(); ++group)
+            if (group->front().getProtocol() == it->getProtocol())
+                break;
+        if (group == groups.end())
+            groups.push_back(RootDirURLVector(1, *it));
+        else
+            group->push_back(*it);
+    }
+    return groups;
+}
+
+// -----------------------------------------------------------------------------
+Transfer *SaveDump::getTransfer(const RootDirURLVector &urlv,
+                                PreparedTargets *prepared)
 {
     Debug::debug()->trace("SaveDump::getTransfer(%p)",
 			  &urlv);
@@ -759,6 +2484,138 @@ Transfer *SaveDump::getTransfer(const RootDirURLVector &urlv)
     if (urlv.size() == 0)
 	throw KError("No target specified!");
 
+    auto protocolTransfer = [prepared](const RootDirURLVector &group) {
+        Transfer *ret = prepared ? prepared->take(group) : NULL;
+        if (ret)
+            Debug::debug()->dbg("Using prepared transfer");
+        return ret ? ret : getProtocolTransfer(group);
+    };
+
+    if (useFastest(urlv))
+        return getFastestTransfer(urlv, prepared);
+
+    // group the targets by protocol, keeping their order
+    std::vector<RootDirURLVector> groups = groupByProtocol(urlv);
+    if (groups.size() == 1)
+        return protocolTransfer(urlv);
+
+    // different protocols: save a copy to each of them
+    Debug::debug()->dbg("Returning TeeTransfer");
+    long lag = Configuration::config()->KDUMP_TARGET_LAG.value();
+    std::unique_ptr<TeeTransfer> tee(
+        new TeeTransfer(lag > 0 ? (size_t)lag << 20 : 0));
+    std::vector<RootDirURLVector>::const_iterator group;
+    for (group = groups.begin(); group != groups.end(); ++group) {
+        string name;
+        RootDirURLVector::const_iterator it;
+        for (it = group->begin(); it != group->end(); ++it) {
+            if (!name.empty())
+                name += ' ';
+            name += it->getURL();
+        }
+        tee->addLeg(protocolTransfer(*group), name);
+    }
+    return tee.release();
+}
+
+// -----------------------------------------------------------------------------
+bool SaveDump::useFastest(const RootDirURLVector &urlv)
+{
+    Configuration *config = Configuration::config();
+    if (!config->kdumptoolContainsFlag(Configuration::FLAG_FASTEST) ||
+        urlv.size() < 2)
+        return false;
+
+    RootDirURLVector::const_iterator it;
+    for (it = urlv.begin(); it != urlv.end(); ++it)
+        if (it->getProtocol() == URLParser::PROT_FILE ||
+            it->getProtocol() == URLParser::PROT_RAW)
+            return false;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+Transfer *SaveDump::getFastestTransfer(const RootDirURLVector &urlv,
+                                       PreparedTargets *prepared)
+{
+    Debug::debug()->trace("SaveDump::getFastestTransfer(%p)", &urlv);
+
+    Configuration *config = Configuration::config();
+    int timeout = config->KDUMP_NET_TIMEOUT.value();
+
+    SaveStats::Timer timer("fastest");
+    const std::vector<char> data = probeData(FASTEST_PROBE_SIZE);
+    std::vector<TargetProbe> probes(urlv.size());
+    std::vector<std::unique_ptr<Transfer>> transfers(urlv.size());
+
+    // one thread per target, so that they are all probed at once
+    std::vector<std::future<void>> threads;
+    for (size_t i = 0; i < urlv.size(); ++i) {
+        probes[i].index = i;
+        probes[i].name = urlv[i].getURL();
+        threads.push_back(std::async(std::launch::async, [&, i]() {
+            TargetProbe &probe = probes[i];
+            RootDirURLVector single(1, urlv[i]);
+            try {
+                Routable rt(urlv[i].getHostname());
+                if (!rt.check(timeout))
+                    throw KError("Not reachable");
+
+                std::chrono::steady_clock::time_point start =
+                    std::chrono::steady_clock::now();
+                Transfer *transfer = prepared ?
+                    prepared->take(single, &probe.connectSeconds) : NULL;
+                if (!transfer) {
+                    transfer = getProtocolTransfer(single);
+                    probe.connectSeconds = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start).count();
+                }
+                transfers[i].reset(transfer);
+
+                BufferDataProvider provider(data.data(), data.size());
+                start = std::chrono::steady_clock::now();
+                transfer->perform(&provider, TIME_BUDGET_PROBE_FILE, NULL);
+                probe.burstSeconds = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start).count();
+                probe.burstBytes = data.size();
+
+                string dir = transfer->localDirectory();
+                if (!dir.empty())
+                    unlink((dir + "/" TIME_BUDGET_PROBE_FILE).c_str());
+                probe.ok = true;
+            } catch (const KError &error) {
+                probe.error = error.what();
+            }
+        }));
+    }
+    for (auto &thread : threads)
+        thread.get();
+
+    std::unique_ptr<FailoverTransfer> failover(new FailoverTransfer());
+    std::vector<size_t> order = TargetProbe::rank(probes);
+    std::vector<size_t>::const_iterator it;
+    for (it = order.begin(); it != order.end(); ++it) {
+        const TargetProbe &probe = probes[*it];
+        Debug::debug()->dbg("%s: connected in %.3f s, %llu bytes/s",
+                            probe.name.c_str(), probe.connectSeconds,
+                            probe.rate());
+        failover->addLeg(transfers[*it].release(), probe.name);
+    }
+    for (size_t i = 0; i < probes.size(); ++i)
+        if (!probes[i].ok)
+            cerr << "WARNING: Dump target " << probes[i].name
+                 << " is not used: " << probes[i].error << endl;
+
+    if (order.empty())
+        throw KError("None of the dump targets can be used.");
+    cout << "Saving the dump to the fastest target "
+         << failover->currentLeg() << endl;
+    return failover.release();
+}
+
+// -----------------------------------------------------------------------------
+Transfer *SaveDump::getProtocolTransfer(const RootDirURLVector &urlv)
+{
     switch (urlv.begin()->getProtocol()) {
         case URLParser::PROT_FILE:
             Debug::debug()->dbg("Returning FileTransfer");
@@ -784,6 +2641,18 @@ Transfer *SaveDump::getTransfer(const RootDirURLVector &urlv)
             Debug::debug()->dbg("Returning CIFSTransfer");
             return new CIFSTransfer(urlv);
 
+        case URLParser::PROT_RAW:
+            Debug::debug()->dbg("Returning RawTransfer");
+            return new RawTransfer(urlv);
+
+        case URLParser::PROT_KDUMP:
+            Debug::debug()->dbg("Returning StreamTransfer");
+            return new StreamTransfer(urlv);
+
+        case URLParser::PROT_S3:
+            Debug::debug()->dbg("Returning S3Transfer");
+            return new S3Transfer(urlv);
+
         default:
             throw KError("Unknown protocol.");
     }
@@ -826,6 +2695,13 @@ void SaveDumpCommand::execute()
         m_hostname.c_str(), int(m_nomail));
 
     setErrorCode(create());
+
+    // the process ends here, so the email must go out now
+    int timeout = Configuration::config()->KDUMP_NOTIFICATION_TIMEOUT.value();
+    if (!NotificationQueue::queue()->wait(
+            std::chrono::seconds(std::max(timeout, 0))))
+        cerr << "WARNING: Notification not sent within "
+             << timeout << " seconds" << endl;
 }
 
 //}}}
@@ -19,13 +19,73 @@
 #ifndef SAVE_DUMP_H
 #define SAVE_DUMP_H
 
+#include <chrono>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "fileutil.h"
 #include "subcommand.h"
 #include "urlparser.h"
 #include "rootdirurl.h"
+#include "codecbench.h"
+
+// file name of the CHECKSUM manifest
+#define CHECKSUM_MANIFEST	"checksums"
 
 class Transfer;
+class DataProvider;
+class ChecksumDataProvider;
+class DmesgDataProvider;
+class DeleteDumpsThread;
+
+//{{{ PreparedTargets ----------------------------------------------------------
+
+/**
+ * Transfers that are created before they are needed (see
+ * SaveDump::prepare()), so that the network targets are mounted or
+ * connected when the dump starts.
+ */
+class PreparedTargets {
+
+    public:
+        ~PreparedTargets();
 
+        /**
+         * Adds a Transfer and takes its ownership.
+         *
+         * @param[in] urlv the targets of @p transfer
+         * @param[in] transfer the Transfer
+         * @param[in] seconds how long it took to create @p transfer
+         */
+        void add(const RootDirURLVector &urlv, Transfer *transfer,
+                 double seconds = 0);
+
+        /**
+         * Returns the Transfer that has been prepared for exactly
+         * @p urlv and passes its ownership to the caller.
+         *
+         * @param[in] urlv the targets
+         * @param[out] seconds how long it took to create the Transfer,
+         *             or @c NULL
+         * @return the Transfer, or @c NULL if there is none
+         */
+        Transfer *take(const RootDirURLVector &urlv, double *seconds = NULL);
+
+    private:
+        std::mutex m_mutex;
+        std::map<std::string, std::unique_ptr<Transfer>> m_transfers;
+        std::map<std::string, double> m_seconds;
+
+        static std::string key(const RootDirURLVector &urlv);
+};
+
+//}}}
 //{{{ SaveDump -----------------------------------------------------------------
 
 class SaveDump {
@@ -40,6 +100,14 @@ class SaveDump {
         SaveDump();
         ~SaveDump();
 
+        /**
+         * Starts to set up the dump targets in the background: waits
+         * for their routes and creates the Transfer objects of the
+         * network targets concurrently, while the caller prepares the
+         * rest of the system. Called by create() if not done before.
+         */
+        void prepare();
+
         int create();
 
         const FilePath& dumpPath() const
@@ -67,47 +135,273 @@ class SaveDump {
         void noMail(bool nomail)
         { m_nomail = nomail; }
 
+        /**
+         * Sets the deletion of old dumps that runs in the background.
+         * The dump only waits until it fits (see preflight()).
+         */
+        void oldDumps(DeleteDumpsThread *oldDumps)
+        { m_oldDumps = oldDumps; }
+
+        /**
+         * Sets a function that is called (from a worker thread) as soon
+         * as the dump itself has been saved, checked and synced to its
+         * targets, while the README, kernel, checksums and notification
+         * are still being saved. The vmcore is not read after that.
+         */
+        void dumpDurable(const std::function<void()> &fn)
+        { m_dumpDurable = fn; }
+
+        /**
+         * Returns a Transfer object suitable for the provided URL.
+         * If the URLs use different protocols, a TeeTransfer saves
+         * a copy to each protocol. With the FASTEST flag, a
+         * FailoverTransfer saves to the fastest network target instead
+         * (see getFastestTransfer()).
+         *
+         * @param[in] url the URL
+         * @return the Transfer object
+         *
+         * @param[in] prepared take the Transfer objects from there if
+         *            they have been created in advance, or @c NULL
+         * @exception KError if parsing the URL failed or there's no
+         *            implementation for that class.
+         */
+        static Transfer *getTransfer(const RootDirURLVector &urlv,
+                                     PreparedTargets *prepared = NULL);
+
+        /**
+         * Splits @p urlv into groups of URLs with the same protocol,
+         * keeping their order.
+         */
+        static std::vector<RootDirURLVector>
+        groupByProtocol(const RootDirURLVector &urlv);
+
     protected:
         void saveDump(const RootDirURLVector &urlv);
 
+        /**
+         * Saves the dump file itself with the given settings (the rest
+         * of saveDump()).
+         *
+         * @param[in] deadline stop the dump with a KDeadlineError if it
+         *            would not be finished in time, or @c NULL
+         */
+        void saveVmcore(const RootDirURLVector &urlv, int dumplevel,
+                        const std::string &dumpformat,
+                        const std::chrono::steady_clock::time_point *deadline);
+
+        /**
+         * Measures the speed of the dump target with a probe file.
+         *
+         * @return bytes per second
+         * @exception KError if the probe cannot be written
+         */
+        unsigned long long probeTarget();
+
+        /**
+         * Chooses the codec for KDUMP_DUMPFORMAT=auto with a
+         * CodecBenchmark.
+         *
+         * @param[in] rate bytes per second of the target, 0 if unknown
+         * @return the dump format, "compressed" if the benchmark fails
+         */
+        std::string chooseFormat(unsigned long long rate);
+
+        /**
+         * Binds kdumptool (and the processes that it starts) to the NUMA
+         * node of the first dump target, see NumaPlacement.
+         */
+        void placeThreads(const RootDirURLVector &urlv);
+
         void copyMakedumpfile();
 
         void generateInfo();
 
-        void generateRearrange();
+        /**
+         * Returns the script that turns a flattened dump into a normal
+         * one (rearrange.sh).
+         */
+        static std::string rearrangeScript();
+
+        void generateUnstripe();
+
+        /**
+         * Saves one file with @p transfer (m_transfer if @c NULL) and
+         * records its checksum if the CHECKSUM flag is set.
+         *
+         * @return the number of bytes that have passed through kdumptool
+         * @see Transfer::perform()
+         */
+        unsigned long long saveFile(DataProvider *provider,
+                                    const StringVector &targets,
+                                    bool *directSave,
+                                    Transfer *transfer = NULL);
+        unsigned long long saveFile(DataProvider *provider,
+                                    const std::string &target,
+                                    bool *directSave = NULL,
+                                    Transfer *transfer = NULL);
+
+        /**
+         * Saves small files with @p transfer (m_transfer if @c NULL) in
+         * one batch and records their checksums if the CHECKSUM flag is
+         * set.
+         *
+         * @return the number of bytes saved
+         * @see Transfer::performBatch()
+         */
+        unsigned long long saveArtifacts(
+            const std::vector<std::pair<std::string, std::string> > &artifacts,
+            Transfer *transfer = NULL);
+
+        void recordChecksum(const ChecksumDataProvider &checked,
+                            const std::string &name);
+
+        void generateChecksums();
+
+        /**
+         * Saves the timing report of SaveStats as stats.json.
+         *
+         * @param[in] failed @c true if saving the dump has failed
+         */
+        void generateStats(bool failed);
+
+        /**
+         * Records the dump in the DumpCatalog of its local directories.
+         * Errors are only reported, because the catalog can be rebuilt.
+         *
+         * @param[in] urlv the dump directories
+         * @param[in] status "saving" before the dump is saved, which is
+         *            only recorded in existing catalogs, or the status of
+         *            stats.json afterwards
+         */
+        void catalogDump(const RootDirURLVector &urlv,
+                         const std::string &status);
+
+        /**
+         * Saves the triage bundle (dmesg, VMCOREINFO, a short README and
+         * the header of stats.json) to KDUMP_TRIAGE_URL.
+         *
+         * @param[in] urlv the triage directory
+         * @exception KError if the bundle cannot be saved
+         */
+        void saveTriage(const RootDirURLVector &urlv);
 
         void fillVmcoreinfo();
 
-        void copyKernel();
+        /**
+         * Copies System.map and the kernel with @p transfer.
+         *
+         * @param[in] progress show a progress bar (if configured); off
+         *            while other steps use the terminal
+         */
+        void copyKernel(Transfer *transfer, bool progress);
 
         std::string findKernel();
 
         std::string findMapfile();
 
+        /**
+         * Estimates the dump size and removes the local targets that
+         * cannot hold the dump and keep KDUMP_FREE_DISK_SIZE free.
+         * The dump is only analysed with makedumpfile if the largest
+         * possible dump does not fit.
+         *
+         * @param[in,out] urlv the dump targets
+         * @exception KError if no target is left
+         */
+        void preflight(RootDirURLVector &urlv);
+
         void checkAndDelete(const RootDirURLVector &urlv);
 
+        /**
+         * Flushes the local and mounted dump targets to stable storage.
+         * The other protocols have finished when the transfer returns.
+         *
+         * @exception KSystemError if a target cannot be synced
+         */
+        void syncTargets(const RootDirURLVector &urlv);
+
+        /**
+         * Queues the email that says whether the dump has been saved.
+         */
         void sendNotification(bool failure, const RootDirURLVector &urlv);
 
+        /**
+         * Queues the email that says that the dump is being saved, with
+         * the estimate of preflight() if there is one.
+         */
+        void sendStartNotification(const RootDirURLVector &urlv);
+
+        /**
+         * Sends an email to KDUMP_NOTIFICATION_TO in the background
+         * (see NotificationQueue), if email is configured.
+         */
+        void queueEmail(const std::string &subject, const std::string &body);
+
         std::string getKernelReleaseCommandline();
 
         /**
-         * Returns a Transfer object suitable for the provided URL.
+         * Returns a Transfer object for URLs with the same protocol.
          *
-         * @param[in] url the URL
-         * @return the Transfer object
+         * @see getTransfer()
+         */
+        static Transfer *getProtocolTransfer(const RootDirURLVector &urlv);
+
+        /**
+         * Checks whether the FASTEST flag applies to @p urlv, i.e.
+         * whether there are several targets and all of them are
+         * network targets.
+         */
+        static bool useFastest(const RootDirURLVector &urlv);
+
+        /**
+         * Probes all targets of @p urlv at the same time: the route
+         * (see Routable), the time to create the Transfer and the time
+         * to save a FASTEST_PROBE_SIZE burst. Returns a FailoverTransfer
+         * with the usable targets, fastest first.
          *
-         * @exception KError if parsing the URL failed or there's no
-         *            implementation for that class.
+         * @param[in] urlv the targets
+         * @param[in] prepared take the Transfer objects from there if
+         *            they have been created in advance, or @c NULL
+         * @exception KError if no target can be used
          */
-	Transfer *getTransfer(const RootDirURLVector &urlv);
+        static Transfer *getFastestTransfer(const RootDirURLVector &urlv,
+                                            PreparedTargets *prepared);
 
     private:
         unsigned long m_split;
         Transfer *m_transfer;
         bool m_usedDirectSave;
         bool m_useMakedumpfile;
+        bool m_flattened;               // the stream is flattened
+        bool m_unflattened;             // ... but it has been placed
+        bool m_striped;
+        bool m_noSpace;                 // free space ran out while saving
+        bool m_truncated;               // ... and the dump has been kept
         unsigned long m_threads;
         unsigned long long m_crashtime;
+        bool m_checksum;
+        size_t m_checksumChunk;
+        std::string m_checksums;	// manifest lines
+        std::mutex m_checksumMutex;	// protects m_checksums
+        std::string m_dumpName;		// vmcore or vmcore.zst
+        int m_dumpLevel;                // actual dump level ...
+        std::string m_dumpFormat;       // ... and format, see saveVmcore()
+        std::string m_budgetNote;       // why they differ from the config
+        std::vector<CodecBenchmark::Result> m_codecs; // see chooseFormat()
+        unsigned long long m_codecTarget;  // ... and the target rate
+        int m_numaNode;                 // see placeThreads(), or -1
+        std::unique_ptr<DmesgDataProvider> m_dmesg;
+        unsigned long long m_expectedSize; // estimate of preflight(), or 0
+        unsigned long m_expectedSeconds;   // ... and its duration
+        DeleteDumpsThread *m_oldDumps;     // background deletion or NULL
+        std::function<void()> m_dumpDurable; // see dumpDurable()
+        StringVector m_staged;             // targets for kdump-upload.service
+        std::future<void> m_preparing;     // see prepare()
+        RootDirURLVector m_urlv;           // dump directories ...
+        RootDirURLVector m_triagev;        // ... and the triage directory
+        PreparedTargets m_prepared;
+        std::string m_triageLog;           // dmesg for saveTriage()
 
         void checkOne(const RootDirURL &parser);
 };
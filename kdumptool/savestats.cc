@@ -0,0 +1,343 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <exception>
+#include <cstdio>
+
+#include "global.h"
+#include "debug.h"
+#include "savestats.h"
+#include "stringutil.h"
+
+using std::string;
+using std::ostringstream;
+using std::chrono::duration;
+
+// -----------------------------------------------------------------------------
+static double seconds(SaveStats::Clock::duration d)
+{
+    return duration<double>(d).count();
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Returns the peaks of the memory samples taken between @p from and
+ * @p to as a JSON object, or an empty string if there are none.
+ */
+static string memoryPeaks(const std::vector<SaveStats::Memory> &samples,
+                          SaveStats::Clock::time_point from,
+                          SaveStats::Clock::time_point to)
+{
+    SaveStats::Memory peak = SaveStats::Memory();
+    peak.available = ~0ULL;
+    unsigned long count = 0;
+
+    std::vector<SaveStats::Memory>::const_iterator it;
+    for (it = samples.begin(); it != samples.end(); ++it) {
+        if (it->time < from || it->time > to)
+            continue;
+        peak.available = std::min(peak.available, it->available);
+        peak.dirty = std::max(peak.dirty, it->dirty);
+        peak.writeback = std::max(peak.writeback, it->writeback);
+        peak.slab = std::max(peak.slab, it->slab);
+        peak.rss = std::max(peak.rss, it->rss);
+        peak.helperRss = std::max(peak.helperRss, it->helperRss);
+        ++count;
+    }
+    if (!count)
+        return string();
+
+    ostringstream ss;
+    ss << "{ \"samples\": " << count
+       << ", \"min_available_kb\": " << peak.available
+       << ", \"max_dirty_kb\": " << peak.dirty
+       << ", \"max_writeback_kb\": " << peak.writeback
+       << ", \"max_slab_kb\": " << peak.slab
+       << ", \"max_rss_kb\": " << peak.rss
+       << ", \"max_makedumpfile_rss_kb\": " << peak.helperRss << " }";
+    return ss.str();
+}
+
+//{{{ SaveStats::Timer ---------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+SaveStats::Timer::Timer(const string &name)
+    : m_name(name), m_start(Clock::now()),
+      m_perf(PerfCounters::counters()->read()), m_bytes(0),
+      m_exceptions(std::uncaught_exceptions())
+{}
+
+// -----------------------------------------------------------------------------
+SaveStats::Timer::~Timer()
+{
+    bool ok = std::uncaught_exceptions() == m_exceptions;
+    PerfCounters::Sample perf = PerfCounters::delta(m_perf,
+        PerfCounters::counters()->read());
+    SaveStats::stats()->add(m_name, m_start, Clock::now(), m_bytes, ok,
+                            &perf);
+}
+
+//}}}
+//{{{ SaveStats ----------------------------------------------------------------
+
+SaveStats *SaveStats::m_instance = NULL;
+
+// -----------------------------------------------------------------------------
+SaveStats *SaveStats::stats()
+{
+    if (!m_instance)
+        m_instance = new SaveStats();
+
+    return m_instance;
+}
+
+// -----------------------------------------------------------------------------
+SaveStats::SaveStats()
+    : m_created(Clock::now())
+{}
+
+// -----------------------------------------------------------------------------
+void SaveStats::add(const string &name, Clock::time_point start,
+                    Clock::time_point end, unsigned long long bytes, bool ok,
+                    const PerfCounters::Sample *perf)
+{
+    Debug::debug()->dbg("Phase %s: %.3f s, %llu bytes%s", name.c_str(),
+                        seconds(end - start), bytes, ok ? "" : ", failed");
+
+    Phase phase = { name, start, end, bytes, ok,
+                    perf ? *perf : PerfCounters::Sample() };
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_phases.push_back(phase);
+}
+
+// -----------------------------------------------------------------------------
+void SaveStats::addTransfer(const Transfer &transfer)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_transfers.push_back(transfer);
+}
+
+// -----------------------------------------------------------------------------
+void SaveStats::addMemory(const Memory &memory)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_memory.push_back(memory);
+}
+
+// -----------------------------------------------------------------------------
+bool SaveStats::find(const string &name, Phase &phase) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<Phase>::const_reverse_iterator it;
+    for (it = m_phases.rbegin(); it != m_phases.rend(); ++it)
+        if (it->name == name) {
+            phase = *it;
+            return true;
+        }
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+void SaveStats::setField(const string &key, const string &value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_fields.push_back(make_pair(key, StringUtil::jsonString(value)));
+}
+
+// -----------------------------------------------------------------------------
+void SaveStats::setField(const string &key, unsigned long long value)
+{
+    ostringstream ss;
+    ss << value;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_fields.push_back(make_pair(key, ss.str()));
+}
+
+// -----------------------------------------------------------------------------
+SaveStats::Clock::time_point SaveStats::first() const
+{
+    // the configuration is read before the first SaveDump exists
+    Clock::time_point ret = m_created;
+    std::vector<Phase>::const_iterator it;
+    for (it = m_phases.begin(); it != m_phases.end(); ++it)
+        ret = std::min(ret, it->start);
+    std::vector<Transfer>::const_iterator tr;
+    for (tr = m_transfers.begin(); tr != m_transfers.end(); ++tr)
+        ret = std::min(ret, tr->start);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+double SaveStats::elapsed() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return seconds(Clock::now() - first());
+}
+
+// -----------------------------------------------------------------------------
+string SaveStats::summary() const
+{
+    ostringstream ss;
+    ss << std::fixed << std::setprecision(1);
+
+    Phase dump;
+    if (find("dump", dump)) {
+        double secs = seconds(dump.end - dump.start);
+        ss << "dump " << secs << " s, "
+           << dump.bytes / (1024.0 * 1024.0) << " MiB";
+        if (secs > 0)
+            ss << " at " << dump.bytes / (1024.0 * 1024.0) / secs
+               << " MiB/s";
+        ss << "; ";
+    }
+    ss << elapsed() << " s since start";
+    return ss.str();
+}
+
+// -----------------------------------------------------------------------------
+string SaveStats::json() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<Phase> phases(m_phases);
+    std::stable_sort(phases.begin(), phases.end(),
+                     [](const Phase &a, const Phase &b) {
+                         return a.start < b.start;
+                     });
+    Clock::time_point base = first();
+
+    ostringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    ss << "{" << std::endl;
+    ss << "  \"version\": 1," << std::endl;
+    std::vector<std::pair<string, string> >::const_iterator field;
+    for (field = m_fields.begin(); field != m_fields.end(); ++field)
+        ss << "  " << StringUtil::jsonString(field->first) << ": "
+           << field->second << "," << std::endl;
+    Clock::time_point now = Clock::now();
+    ss << "  \"seconds\": " << seconds(now - base) << "," << std::endl;
+    string memory = memoryPeaks(m_memory, base, now);
+    if (!memory.empty())
+        ss << "  \"memory\": " << memory << "," << std::endl;
+    string perf = PerfCounters::json(PerfCounters::counters()->read());
+    if (!perf.empty())
+        ss << "  \"perf\": " << perf << "," << std::endl;
+    ss << "  \"phases\": [";
+    std::vector<Phase>::const_iterator it;
+    for (it = phases.begin(); it != phases.end(); ++it) {
+        ss << (it == phases.begin() ? "" : ",") << std::endl;
+        ss << "    { \"name\": " << StringUtil::jsonString(it->name)
+           << ", \"start\": " << seconds(it->start - base)
+           << ", \"seconds\": " << seconds(it->end - it->start)
+           << ", \"bytes\": " << it->bytes
+           << ", \"ok\": " << (it->ok ? "true" : "false");
+        memory = memoryPeaks(m_memory, it->start, it->end);
+        if (!memory.empty())
+            ss << "," << std::endl << "      \"memory\": " << memory;
+        perf = PerfCounters::json(it->perf);
+        if (!perf.empty())
+            ss << "," << std::endl << "      \"perf\": " << perf;
+        ss << " }";
+    }
+    ss << std::endl << "  ]," << std::endl;
+
+    std::vector<Transfer> transfers(m_transfers);
+    std::stable_sort(transfers.begin(), transfers.end(),
+                     [](const Transfer &a, const Transfer &b) {
+                         return a.start < b.start;
+                     });
+    ss << "  \"transfers\": [";
+    std::vector<Transfer>::const_iterator tr;
+    for (tr = transfers.begin(); tr != transfers.end(); ++tr) {
+        ss << (tr == transfers.begin() ? "" : ",") << std::endl;
+        ss << "    { \"method\": " << StringUtil::jsonString(tr->method)
+           << ", \"target\": " << StringUtil::jsonString(tr->target)
+           << ", \"start\": " << seconds(tr->start - base)
+           << ", \"seconds\": " << seconds(tr->end - tr->start)
+           << "," << std::endl
+           << "      \"source_seconds\": " << seconds(tr->source)
+           << ", \"source_calls\": " << tr->sourceCalls
+           << ", \"sink_seconds\": " << seconds(tr->sink)
+           << ", \"sink_calls\": " << tr->sinkCalls
+           << ", \"buffer_size\": " << tr->buffer
+           << "," << std::endl
+           << "      \"bytes\": " << tr->bytes
+           << ", \"sparse_bytes\": " << tr->sparse
+           << ", \"ok\": " << (tr->ok ? "true" : "false") << " }";
+    }
+    ss << std::endl << "  ]" << std::endl;
+    ss << "}" << std::endl;
+    return ss.str();
+}
+
+// -----------------------------------------------------------------------------
+void SaveStats::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_created = Clock::now();
+    m_phases.clear();
+    m_transfers.clear();
+    m_memory.clear();
+    m_fields.clear();
+}
+
+//}}}
+//{{{ TransferMeter ------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+TransferMeter::TransferMeter(const string &method, const string &target)
+    : m_sinkIsRemainder(false), m_exceptions(std::uncaught_exceptions())
+{
+    m_record.method = method;
+    m_record.target = target;
+    m_record.start = Clock::now();
+    m_record.source = m_record.sink = Clock::duration::zero();
+    m_record.bytes = m_record.sparse = 0;
+    m_record.sourceCalls = m_record.sinkCalls = 0;
+    m_record.buffer = 0;
+}
+
+// -----------------------------------------------------------------------------
+TransferMeter::~TransferMeter()
+{
+    m_record.end = Clock::now();
+    m_record.ok = std::uncaught_exceptions() == m_exceptions;
+    if (m_sinkIsRemainder) {
+        m_record.sink = m_record.end - m_record.start - m_record.source;
+        if (m_record.sink < Clock::duration::zero())
+            m_record.sink = Clock::duration::zero();
+    }
+
+    Debug::debug()->dbg("Transfer %s (%s): %llu bytes in %.3f s, "
+        "source %.3f s (%llu calls), sink %.3f s (%llu calls), "
+        "%llu bytes sparse, %zu bytes buffer%s", m_record.target.c_str(),
+        m_record.method.c_str(), m_record.bytes,
+        seconds(m_record.end - m_record.start),
+        seconds(m_record.source), m_record.sourceCalls,
+        seconds(m_record.sink), m_record.sinkCalls, m_record.sparse,
+        m_record.buffer, m_record.ok ? "" : ", failed");
+
+    SaveStats::stats()->addTransfer(m_record);
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
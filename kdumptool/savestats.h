@@ -0,0 +1,342 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef SAVESTATS_H
+#define SAVESTATS_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <mutex>
+#include <chrono>
+
+#include "global.h"
+#include "debug.h"
+#include "probes.h"
+#include "perfcounters.h"
+
+//{{{ SaveStats ----------------------------------------------------------------
+
+/**
+ * Timing report of the steps that save a dump.
+ *
+ * Each step (phase) is recorded with its monotonic start and end time,
+ * the number of bytes it has moved and whether it has succeeded. The
+ * steps run in different threads and even come from different places
+ * (kdump-save loads the configuration and deletes old dumps before
+ * SaveDump runs), so there is only one instance, like Debug.
+ */
+class SaveStats {
+
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        /**
+         * One recorded phase.
+         */
+        struct Phase {
+            std::string name;
+            Clock::time_point start;
+            Clock::time_point end;
+            unsigned long long bytes;
+            bool ok;
+            PerfCounters::Sample perf;  // counts during the phase
+        };
+
+        /**
+         * Accounting of one transfer, see TransferMeter.
+         */
+        struct Transfer {
+            std::string method;         // e.g. "pipe" or "sftp"
+            std::string target;
+            Clock::time_point start;
+            Clock::time_point end;
+            Clock::duration source;     // waiting for the DataProvider
+            Clock::duration sink;       // waiting for the target
+            unsigned long long bytes;
+            unsigned long long sparse;  // bytes skipped as holes
+            unsigned long long sourceCalls;
+            unsigned long long sinkCalls;
+            size_t buffer;              // chosen buffer size, 0 if none
+            bool ok;
+        };
+
+        /**
+         * One sample of the memory usage, see MemoryWatch. All sizes
+         * are in KiB.
+         */
+        struct Memory {
+            Clock::time_point time;
+            unsigned long long available;   // MemAvailable
+            unsigned long long dirty;
+            unsigned long long writeback;
+            unsigned long long slab;
+            unsigned long long rss;         // kdump-save itself
+            unsigned long long helperRss;   // all makedumpfile processes
+        };
+
+        /**
+         * Records a phase from its construction until its destruction.
+         * The phase has failed if it is left with an exception.
+         */
+        class Timer {
+
+            public:
+                /**
+                 * Starts the phase @p name.
+                 */
+                Timer(const std::string &name);
+
+                /**
+                 * Records the phase in SaveStats::stats().
+                 */
+                ~Timer();
+
+                /**
+                 * Sets the number of bytes moved by the phase.
+                 */
+                void bytes(unsigned long long bytes)
+                { m_bytes = bytes; }
+
+            private:
+                Timer(const Timer &);
+                Timer &operator=(const Timer &);
+
+                std::string m_name;
+                Clock::time_point m_start;
+                PerfCounters::Sample m_perf;
+                unsigned long long m_bytes;
+                int m_exceptions;
+        };
+
+    public:
+        /**
+         * Returns the only instance.
+         */
+        static SaveStats *stats();
+
+        /**
+         * Records a phase.
+         *
+         * @param[in] perf the PerfCounters counts during the phase, or
+         *            @c NULL if there are none
+         */
+        void add(const std::string &name, Clock::time_point start,
+                 Clock::time_point end, unsigned long long bytes, bool ok,
+                 const PerfCounters::Sample *perf = NULL);
+
+        /**
+         * Records a transfer.
+         */
+        void addTransfer(const Transfer &transfer);
+
+        /**
+         * Records a memory sample.
+         */
+        void addMemory(const Memory &memory);
+
+        /**
+         * Looks up the last phase called @p name.
+         *
+         * @param[out] phase set to the phase if it has been found
+         * @return @c true if the phase has been recorded
+         */
+        bool find(const std::string &name, Phase &phase) const;
+
+        /**
+         * Adds a string field to the report.
+         */
+        void setField(const std::string &key, const std::string &value);
+
+        /**
+         * Adds a number field to the report.
+         */
+        void setField(const std::string &key, unsigned long long value);
+
+        /**
+         * Returns the seconds since the first phase has started.
+         */
+        double elapsed() const;
+
+        /**
+         * Returns a line with the duration, size and rate of the dump
+         * phase and the elapsed time, for the README.
+         */
+        std::string summary() const;
+
+        /**
+         * Returns the report as a JSON object. The phases and the
+         * transfers are sorted by their start time, which is given in
+         * seconds after the start of the first phase. The peaks of the
+         * memory samples are reported for the whole save and for each
+         * phase that has been sampled, and so are the PerfCounters.
+         */
+        std::string json() const;
+
+        /**
+         * Forgets all phases, fields and memory samples.
+         */
+        void clear();
+
+    protected:
+        SaveStats();
+
+    private:
+        static SaveStats *m_instance;
+
+        Clock::time_point m_created;
+        std::vector<Phase> m_phases;
+        std::vector<Transfer> m_transfers;
+        std::vector<Memory> m_memory;
+        std::vector<std::pair<std::string, std::string> > m_fields;
+        mutable std::mutex m_mutex;
+
+        Clock::time_point first() const;
+};
+
+//}}}
+//{{{ TransferMeter ------------------------------------------------------------
+
+/**
+ * Accounts one Transfer::perform() call: how long it has waited for the
+ * DataProvider (the source) and for the target (the sink), how many
+ * calls that took, and how many bytes have been moved or skipped as
+ * holes. If the source takes most of the time, makedumpfile (filtering
+ * and compression) is the bottleneck; if the sink does, it is the disk
+ * or the network.
+ *
+ * The result goes to the debug log and to SaveStats when the meter is
+ * destroyed. A meter must only be used by one thread.
+ */
+class TransferMeter {
+
+    public:
+        typedef SaveStats::Clock Clock;
+
+        /**
+         * Starts the accounting.
+         *
+         * @param[in] method how the data is moved, e.g. "pipe"
+         * @param[in] target the target file
+         */
+        TransferMeter(const std::string &method, const std::string &target);
+
+        /**
+         * Records the transfer. It has failed if the meter is left with
+         * an exception.
+         */
+        ~TransferMeter();
+
+        /**
+         * Calls @p fn, which waits for the source, and returns its result.
+         */
+        template<typename Fn>
+        auto source(Fn fn) -> decltype(fn())
+        {
+            Span span(m_record.source, m_record.sourceCalls,
+                      m_record.method.c_str(), false);
+            return fn();
+        }
+
+        /**
+         * Calls @p fn, which waits for the sink, and returns its result.
+         */
+        template<typename Fn>
+        auto sink(Fn fn) -> decltype(fn())
+        {
+            Span span(m_record.sink, m_record.sinkCalls,
+                      m_record.method.c_str(), true);
+            return fn();
+        }
+
+        /**
+         * Adds @p bytes to the data that has been moved.
+         */
+        void moved(unsigned long long bytes)
+        {
+            m_record.bytes += bytes;
+            KEVENT("moved %llu bytes, %llu in total", bytes, m_record.bytes);
+            KDUMP_PROBE2(moved, m_record.method.c_str(), bytes);
+        }
+
+        /**
+         * Adds @p bytes to the data that has been skipped as holes.
+         */
+        void sparse(unsigned long long bytes)
+        { m_record.sparse += bytes; }
+
+        /**
+         * Records the size of the transfer buffer.
+         */
+        void bufferSize(size_t size)
+        { m_record.buffer = size; }
+
+        /**
+         * Counts all time outside source() as sink time, for targets
+         * such as libcurl that call back for the data.
+         */
+        void sinkIsRemainder()
+        { m_sinkIsRemainder = true; }
+
+    private:
+        TransferMeter(const TransferMeter &);
+        TransferMeter &operator=(const TransferMeter &);
+
+        /**
+         * Adds the time from its construction to its destruction, and
+         * fires the source_start/source_done or sink_start/sink_done
+         * probes around it.
+         */
+        class Span {
+            public:
+                Span(Clock::duration &total, unsigned long long &calls,
+                     const char *method, bool sink)
+                    : m_total(total), m_method(method), m_sink(sink)
+                {
+                    ++calls;
+                    if (m_sink)
+                        KDUMP_PROBE1(sink_start, m_method);
+                    else
+                        KDUMP_PROBE1(source_start, m_method);
+                    m_start = Clock::now();
+                }
+
+                ~Span()
+                {
+                    m_total += Clock::now() - m_start;
+                    if (m_sink)
+                        KDUMP_PROBE1(sink_done, m_method);
+                    else
+                        KDUMP_PROBE1(source_done, m_method);
+                }
+
+            private:
+                Clock::duration &m_total;
+                const char *m_method;
+                bool m_sink;
+                Clock::time_point m_start;
+        };
+
+        SaveStats::Transfer m_record;
+        bool m_sinkIsRemainder;
+        int m_exceptions;
+};
+
+//}}}
+
+#endif /* SAVESTATS_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,385 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "global.h"
+#include "debug.h"
+#include "progress.h"
+#include "stringutil.h"
+#include "vmcorecontext.h"
+#include "segmentreader.h"
+#include "probes.h"
+
+using std::string;
+
+// maximum size of one pread()
+#define SEGMENT_BLOCK_SIZE		(2*1024*1024)
+
+// blocks that may be read ahead of the consumer, per thread
+#define SEGMENT_BLOCKS_PER_THREAD	2
+
+//{{{ SegmentDataProvider ------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+SegmentDataProvider::SegmentDataProvider(const char *filename,
+                                         unsigned threads, bool priority)
+    : m_filename(filename), m_priority(priority), m_fd(-1), m_fileSize(0),
+      m_threadCount(std::max(threads, 1U)),
+      m_currentPos(0), m_currentOffset(0), m_next(0),
+      m_consumed(0), m_stop(false)
+{
+    m_current.length = 0;
+}
+
+// -----------------------------------------------------------------------------
+SegmentDataProvider::~SegmentDataProvider()
+{
+    stop();
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+// -----------------------------------------------------------------------------
+void SegmentDataProvider::prepare()
+{
+    Debug::debug()->trace("SegmentDataProvider::prepare, %u threads",
+                          m_threadCount);
+
+    m_fd = ::open(m_filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0)
+        throw KSystemError("Cannot open file " + m_filename, errno);
+
+    m_fileSize = lseek(m_fd, 0, SEEK_END);
+    if (m_fileSize == (off_t)-1)
+        throw KSystemError("lseek() failed with " + m_filename + ".", errno);
+
+    planBlocks();
+
+    m_currentPos = 0;
+    m_current.data.reset();
+    m_current.length = 0;
+    m_currentOffset = 0;
+    m_next = m_consumed = 0;
+    m_ready.clear();
+    m_stop = false;
+    for (unsigned i = 0; i < m_threadCount; ++i)
+        m_threads.emplace_back(&SegmentDataProvider::run, this);
+
+    AbstractDataProvider::prepare();
+}
+
+// -----------------------------------------------------------------------------
+void SegmentDataProvider::planBlocks()
+{
+    std::vector<loff_t> bounds;
+    bounds.push_back(0);
+    bounds.push_back(m_fileSize);
+
+    // a damaged ELF header must not prevent the copy
+    std::vector<VmcoreContext::Segment> segments;
+    unsigned long long kernel = 0;
+    try {
+        std::shared_ptr<const VmcoreContext> ctx =
+            VmcoreContext::get(m_filename);
+        segments = ctx->segments();
+        if (ctx->hasVmcoreinfo()) {
+            try {
+                kernel = strtoull(ctx->vmcoreinfo().getStringValue(
+                        "SYMBOL(_stext)").c_str(), NULL, 16);
+            } catch (const KError &e) {
+                Debug::debug()->dbg("No _stext in VMCOREINFO");
+            }
+        }
+        std::vector<VmcoreContext::Segment>::const_iterator it;
+        for (it = segments.begin(); it != segments.end(); ++it) {
+            bounds.push_back(it->offset);
+            bounds.push_back(it->offset + it->filesz);
+        }
+        Debug::debug()->dbg("%s has %zu PT_LOAD segments",
+                            m_filename.c_str(), segments.size());
+    } catch (const KError &e) {
+        Debug::debug()->dbg("Cannot parse %s: %s", m_filename.c_str(),
+                            e.what());
+    }
+
+    std::sort(bounds.begin(), bounds.end());
+    bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+
+    // the gaps between the segments (headers, padding) are read, too,
+    // so that the result is identical to the file
+    m_blocks.clear();
+    for (size_t i = 1; i < bounds.size(); ++i) {
+        loff_t start = bounds[i - 1];
+        loff_t end = std::min(bounds[i], m_fileSize);
+        if (start < end)
+            addBlocks(start, start, end - start);
+    }
+
+    if (m_priority)
+        prioritize(m_blocks, segments, kernel);
+}
+
+// -----------------------------------------------------------------------------
+void SegmentDataProvider::addBlocks(loff_t offset, loff_t target,
+                                    unsigned long long length)
+{
+    while (length) {
+        Range block;
+        block.offset = offset;
+        block.length = std::min<unsigned long long>(SEGMENT_BLOCK_SIZE,
+                                                    length);
+        block.target = target;
+        m_blocks.push_back(block);
+        // negative offsets do not advance, see readBlock()
+        if (offset >= 0)
+            offset += block.length;
+        target += block.length;
+        length -= block.length;
+    }
+}
+
+// -----------------------------------------------------------------------------
+void SegmentDataProvider::prioritize(std::vector<Range> &blocks,
+    const std::vector<VmcoreContext::Segment> &segments,
+    unsigned long long kernel)
+{
+    if (blocks.empty())
+        return;
+
+    const VmcoreContext::Segment *image = NULL;
+    std::vector<VmcoreContext::Segment>::const_iterator it;
+    for (it = segments.begin(); it != segments.end(); ++it)
+        if (kernel >= it->vaddr && kernel - it->vaddr < it->memsz)
+            image = &*it;
+    if (!image && !segments.empty())
+        image = &segments.front();
+
+    auto rank = [&](const Range &block) -> int {
+        if (&block == &blocks.back())
+            return 0;
+        for (it = segments.begin(); it != segments.end(); ++it) {
+            if (block.offset < it->offset ||
+                    block.offset - it->offset >= (loff_t)it->filesz)
+                continue;
+            if (&*it == image)
+                return 1;
+            unsigned long long paddr =
+                it->paddr + (block.offset - it->offset);
+            if (paddr + block.length > image->paddr &&
+                    paddr < image->paddr + image->filesz)
+                return 2;
+            return 3;
+        }
+        return 0;
+    };
+
+    std::vector<std::pair<int, size_t> > order;
+    order.reserve(blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i)
+        order.push_back(std::make_pair(rank(blocks[i]), i));
+    std::stable_sort(order.begin(), order.end());
+
+    std::vector<Range> sorted;
+    sorted.reserve(blocks.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        sorted.push_back(blocks[order[i].second]);
+    blocks.swap(sorted);
+}
+
+// -----------------------------------------------------------------------------
+void SegmentDataProvider::run()
+{
+    const size_t window = m_threadCount * SEGMENT_BLOCKS_PER_THREAD;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_cond.wait(lock, [this, window]{
+                return m_stop || m_next >= m_blocks.size() ||
+                    m_next < m_consumed + window;
+            });
+        if (m_stop || m_next >= m_blocks.size())
+            break;
+
+        size_t index = m_next++;
+        Block block;
+        if (!m_free.empty()) {
+            block.data = std::move(m_free.back());
+            m_free.pop_back();
+        }
+        lock.unlock();
+
+        const Range &range = m_blocks[index];
+        block.length = range.length;
+        try {
+            if (!block.data)
+                block.data = BufferPool::pool()->get(SEGMENT_BLOCK_SIZE);
+            readBlock(range, block.data.get());
+        } catch (...) {
+            block.error = std::current_exception();
+        }
+
+        lock.lock();
+        m_ready[index] = std::move(block);
+        m_cond.notify_all();
+    }
+}
+
+// -----------------------------------------------------------------------------
+void SegmentDataProvider::readBlock(const Range &range, char *buffer)
+{
+    size_t done = 0;
+    while (done < range.length) {
+        ssize_t ret = pread(m_fd, buffer + done, range.length - done,
+                            range.offset + done);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret < 0)
+            throw KSystemError("Error reading from " + m_filename + " at " +
+                               StringUtil::number2hex(range.offset + done),
+                               errno);
+        if (ret == 0)
+            throw KError("Unexpected end of " + m_filename + ".");
+        done += ret;
+    }
+}
+
+// -----------------------------------------------------------------------------
+size_t SegmentDataProvider::mapData(const char **data, size_t maxread)
+{
+    if (m_fd < 0)
+        throw KError("File " + m_filename + " not opened.");
+
+    *data = NULL;
+    if (m_currentOffset == m_current.length) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_current.data)
+            m_free.push_back(std::move(m_current.data));
+        m_current.length = m_currentOffset = 0;
+        if (m_consumed >= m_blocks.size())
+            return 0;
+
+        // segment_wait is how long the readers are behind
+        KDUMP_PROBE1(segment_wait_start, m_consumed);
+        m_cond.wait(lock, [this]{ return m_ready.count(m_consumed) != 0; });
+        KDUMP_PROBE1(segment_wait_done, m_consumed);
+        std::map<size_t, Block>::iterator it = m_ready.find(m_consumed);
+        m_current = std::move(it->second);
+        m_ready.erase(it);
+        ++m_consumed;
+        m_cond.notify_all();
+        lock.unlock();
+
+        if (m_current.error) {
+            setError(true);
+            std::rethrow_exception(m_current.error);
+        }
+    }
+
+    size_t ret = std::min(maxread, m_current.length - m_currentOffset);
+    *data = m_current.data.get() + m_currentOffset;
+    m_currentOffset += ret;
+    KDUMP_PROBE2(segment_read, m_currentPos, ret);
+    m_currentPos += ret;
+
+    Progress *p = getProgress();
+    if (p)
+        p->progressed(m_currentPos, m_fileSize);
+
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+size_t SegmentDataProvider::getData(char *buffer, size_t maxread)
+{
+    // the blocks are not in file order
+    if (m_priority)
+        throw KError("Prioritized data must be placed.");
+
+    const char *data;
+    size_t ret = mapData(&data, maxread);
+    if (ret)
+        memcpy(buffer, data, ret);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+bool SegmentDataProvider::canMapData() const
+{
+    return !m_priority;
+}
+
+// -----------------------------------------------------------------------------
+bool SegmentDataProvider::canPlaceData() const
+{
+    return m_priority;
+}
+
+// -----------------------------------------------------------------------------
+size_t SegmentDataProvider::getPlacedData(char *buffer, size_t maxread,
+                                          off_t *offset)
+{
+    if (!m_priority)
+        return AbstractDataProvider::getPlacedData(buffer, maxread, offset);
+
+    const char *data;
+    size_t ret = mapData(&data, maxread);
+    if (ret) {
+        memcpy(buffer, data, ret);
+        *offset = m_blocks[m_consumed - 1].target + m_currentOffset - ret;
+    }
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void SegmentDataProvider::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+
+    std::vector<std::thread>::iterator it;
+    for (it = m_threads.begin(); it != m_threads.end(); ++it)
+        it->join();
+    m_threads.clear();
+    m_ready.clear();
+}
+
+// -----------------------------------------------------------------------------
+void SegmentDataProvider::finish()
+{
+    Debug::debug()->trace("SegmentDataProvider::finish");
+
+    stop();
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    AbstractDataProvider::finish();
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef SEGMENTREADER_H
+#define SEGMENTREADER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include "global.h"
+#include "dataprovider.h"
+#include "bufferpool.h"
+#include "vmcorecontext.h"
+
+//{{{ SegmentDataProvider ------------------------------------------------------
+
+/**
+ * DataProvider that reads a file with several threads.
+ *
+ * The file is cut into blocks; for an ELF file (like /proc/vmcore) no
+ * block crosses the boundary of a PT_LOAD segment. The threads read
+ * disjoint blocks with pread(), and a reorder buffer hands them out in
+ * file order. That hides the latency of each read from the old memory
+ * of the crashed kernel.
+ *
+ * In priority order, the blocks are handed out with
+ * DataProvider::getPlacedData() in the order of their importance for
+ * the analysis (see prioritize()), so that a dump which is cut short
+ * still has the headers and the kernel image.
+ *
+ * Subclasses can produce a different file from the same input by
+ * overriding planBlocks() and readBlock().
+ */
+class SegmentDataProvider : public AbstractDataProvider {
+
+    public:
+
+        /**
+         * Creates a new SegmentDataProvider object.
+         *
+         * @param[in] filename the name of the file
+         * @param[in] threads number of reader threads
+         * @param[in] priority hand out the blocks in priority order
+         */
+        SegmentDataProvider(const char *filename, unsigned threads,
+                            bool priority = false);
+
+        /**
+         * Stops the threads and closes the file.
+         */
+        ~SegmentDataProvider();
+
+        /**
+         * Opens the file, plans the blocks and starts the threads.
+         *
+         * @see DataProvider::prepare()
+         */
+        void prepare();
+
+        /**
+         * Provides the data.
+         *
+         * @see DataProvider::getData()
+         */
+        size_t getData(char *buffer, size_t maxread);
+
+        /**
+         * Returns @c true unless the blocks are in priority order.
+         *
+         * @see DataProvider::canMapData()
+         */
+        bool canMapData() const;
+
+        /**
+         * Returns @c true if the blocks are in priority order.
+         *
+         * @see DataProvider::canPlaceData()
+         */
+        bool canPlaceData() const;
+
+        /**
+         * Provides the data in priority order.
+         *
+         * @see DataProvider::getPlacedData()
+         */
+        size_t getPlacedData(char *buffer, size_t maxread, off_t *offset);
+
+        /**
+         * Returns a pointer into the current block.
+         *
+         * @see DataProvider::mapData()
+         */
+        size_t mapData(const char **data, size_t maxread);
+
+        /**
+         * Stops the threads and closes the file.
+         *
+         * @see DataProvider::finish()
+         */
+        void finish();
+
+        /**
+         * Returns @c true, because prepare() reads the file from the
+         * start again.
+         *
+         * @see DataProvider::canRestart()
+         */
+        bool canRestart() const
+        { return true; }
+
+        /**
+         * A block of the file.
+         */
+        struct Range {
+            loff_t offset;          // in the file, see readBlock()
+            size_t length;
+            loff_t target;          // in the output
+        };
+
+        /**
+         * Sorts the blocks by their importance for the analysis:
+         *
+         *  1. everything outside the PT_LOAD segments (the ELF header,
+         *     the program headers and the notes) and the last block, so
+         *     that the file has its full size from the start,
+         *  2. the segment with the kernel image (text, data and the
+         *     kernel page tables of swapper_pg_dir),
+         *  3. the same physical memory in the other segments,
+         *  4. the rest of the memory.
+         *
+         * The order within each class is kept.
+         *
+         * @param[in,out] blocks the blocks in file order
+         * @param[in] segments the PT_LOAD segments
+         * @param[in] kernel virtual address of the kernel text (_stext),
+         *            or 0 to take the first segment
+         */
+        static void prioritize(std::vector<Range> &blocks,
+            const std::vector<VmcoreContext::Segment> &segments,
+            unsigned long long kernel);
+
+    protected:
+        /**
+         * Cuts the file into blocks. The output is a copy of the file.
+         * Called by prepare() after the file has been opened.
+         */
+        virtual void planBlocks();
+
+        /**
+         * Reads one block in a reader thread.
+         *
+         * @param[in] range the block
+         * @param[out] buffer at least @c range.length bytes
+         * @exception KError if the block cannot be read
+         */
+        virtual void readBlock(const Range &range, char *buffer);
+
+        /**
+         * Appends blocks for @p length bytes that are read at @p offset
+         * and go to @p target in the output.
+         */
+        void addBlocks(loff_t offset, loff_t target,
+                       unsigned long long length);
+
+        std::string m_filename;
+        bool m_priority;
+        int m_fd;
+        loff_t m_fileSize;      // of the output
+        std::vector<Range> m_blocks;
+
+    private:
+        struct Block {
+            BufferPool::Buffer data;
+            size_t length;
+            std::exception_ptr error;
+        };
+
+        void run();
+        void stop();
+
+        unsigned m_threadCount;
+
+        // accessed by the getData() thread only
+        loff_t m_currentPos;
+        Block m_current;
+        size_t m_currentOffset;
+
+        // shared with the reader threads
+        size_t m_next;          // next block to read
+        size_t m_consumed;      // next block to hand out
+        std::map<size_t, Block> m_ready;
+        std::vector<BufferPool::Buffer> m_free;
+        bool m_stop;
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::vector<std::thread> m_threads;
+};
+
+//}}}
+
+#endif /* SEGMENTREADER_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
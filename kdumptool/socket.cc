@@ -135,6 +135,9 @@ int Socket::connect()
             continue;
         }
 
+        if (m_socketType == ST_TCP)
+            m_tuning.apply(m_currentFd);
+
         if (::connect(m_currentFd, res->ai_addr, res->ai_addrlen) == 0)
             break;
 
@@ -25,6 +25,7 @@
 #include "global.h"
 #include "optionparser.h"
 #include "subcommand.h"
+#include "nettuning.h"
 
 //{{{ Socket -------------------------------------------------------------------
 
@@ -97,6 +98,14 @@ class Socket {
          */
         int connect();
 
+        /**
+         * Sets the TCP options for the next connect().
+         *
+         * @param[in] tuning the socket options
+         */
+        void setTuning(const NetTuning &tuning)
+        { m_tuning = tuning; }
+
         /**
          * Returns the current file descriptor (form the last Socket::connect()
          * call or -1 of there's no open connection.
@@ -116,6 +125,7 @@ class Socket {
         std::string m_service;
         SocketType m_socketType;
         Family m_family;
+        NetTuning m_tuning;
 
         void setHostname(const std::string &address);
 };
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <algorithm>
+
+#include "global.h"
+#include "debug.h"
+#include "fileutil.h"
+#include "stringutil.h"
+#include "spaceguard.h"
+
+using std::string;
+
+// look at the free space at least after this many bytes
+#define SPACE_GUARD_INTERVAL	(256ULL << 20)
+
+//{{{ KNoSpaceError ------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+KNoSpaceError::KNoSpaceError(const string &path, unsigned long long written)
+    : KError("Less than KDUMP_FREE_DISK_SIZE would be left free, stopped "
+             "writing " + path + " after " +
+             StringUtil::number2string(bytes_to_megabytes(written)) +
+             " MiB."),
+      m_written(written)
+{}
+
+//}}}
+//{{{ SpaceGuard ---------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+SpaceGuard::SpaceGuard(const string &path, unsigned long long reserve)
+    : m_path(path), m_reserve(reserve), m_headroom(0), m_budget(0),
+      m_written(0), m_exhausted(false)
+{
+    Debug::debug()->trace("SpaceGuard::SpaceGuard(%s, %llu)",
+                          path.c_str(), reserve);
+    refresh();
+}
+
+// -----------------------------------------------------------------------------
+void SpaceGuard::refresh()
+{
+    unsigned long long free;
+    try {
+        free = FilePath(m_path).freeDiskSize();
+    } catch (const KError &error) {
+        // don't stop a dump only because the check does not work
+        Debug::debug()->dbg("%s", error.what());
+        m_headroom = m_budget = SPACE_GUARD_INTERVAL;
+        return;
+    }
+
+    m_headroom = free > m_reserve ? free - m_reserve : 0;
+    m_budget = std::min(m_headroom / 2, SPACE_GUARD_INTERVAL);
+    Debug::debug()->dbg("%llu MiB may be written to %s",
+                        bytes_to_megabytes(m_headroom), m_path.c_str());
+}
+
+// -----------------------------------------------------------------------------
+size_t SpaceGuard::allow(size_t len)
+{
+    if (m_exhausted)
+        return 0;
+
+    if (len > m_budget)
+        refresh();
+
+    size_t ret = std::min<unsigned long long>(len, m_headroom);
+    m_headroom -= ret;
+    m_budget -= std::min<unsigned long long>(ret, m_budget);
+    m_written += ret;
+    if (ret < len)
+        m_exhausted = true;
+
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void SpaceGuard::check() const
+{
+    if (m_exhausted)
+        throw KNoSpaceError(m_path, m_written);
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
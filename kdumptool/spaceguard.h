@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef SPACEGUARD_H
+#define SPACEGUARD_H
+
+#include <string>
+
+#include "global.h"
+
+//{{{ KNoSpaceError ------------------------------------------------------------
+
+/**
+ * Thrown when a SpaceGuard has stopped a transfer. The data written
+ * so far is still on disk.
+ */
+class KNoSpaceError : public KError {
+    public:
+        /**
+         * @param[in] path the file that has been stopped
+         * @param[in] written bytes written to the file
+         */
+        KNoSpaceError(const std::string &path, unsigned long long written);
+
+        /**
+         * Returns the number of bytes written before the transfer
+         * was stopped.
+         */
+        unsigned long long written() const
+        { return m_written; }
+
+    private:
+        unsigned long long m_written;
+};
+
+//}}}
+//{{{ SpaceGuard ---------------------------------------------------------------
+
+/**
+ * Watches the free space of a file system while a file is written.
+ *
+ * The writer asks for permission before each write with allow(). The
+ * free space is not looked up every time: after each lookup, half of
+ * the space above the reserve may be written before the next one, so
+ * the number of lookups grows only logarithmically while the space
+ * runs out. Other files on the same file system are noticed within
+ * SPACE_GUARD_INTERVAL bytes.
+ */
+class SpaceGuard {
+
+    public:
+        /**
+         * @param[in] path the file that is written (or a directory on
+         *            the same file system)
+         * @param[in] reserve bytes that must stay free
+         */
+        SpaceGuard(const std::string &path, unsigned long long reserve);
+
+        /**
+         * Accounts for the next write.
+         *
+         * @param[in] len the number of bytes to be written
+         * @return how many of these bytes may be written; if this is
+         *         less than @p len, the guard is exhausted
+         */
+        size_t allow(size_t len);
+
+        /**
+         * Returns @c true if a write has been refused.
+         */
+        bool exhausted() const
+        { return m_exhausted; }
+
+        /**
+         * Returns the number of bytes allowed so far.
+         */
+        unsigned long long written() const
+        { return m_written; }
+
+        /**
+         * Throws KNoSpaceError if a write has been refused.
+         */
+        void check() const;
+
+    private:
+        void refresh();
+
+        std::string m_path;
+        unsigned long long m_reserve;
+        unsigned long long m_headroom;  // may be written in total
+        unsigned long long m_budget;    // may be written before refresh()
+        unsigned long long m_written;
+        bool m_exhausted;
+};
+
+//}}}
+
+#endif /* SPACEGUARD_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+
+// how often a waiting thread polls before it goes to sleep
+#define SPSC_RING_SPINS     64
+
+//{{{ SpscRing -----------------------------------------------------------------
+
+/**
+ * Bounded ring for exactly one producer and one consumer thread.
+ *
+ * tryPush() and tryPop() do not take a lock: the producer only moves
+ * the tail and the consumer only moves the head. A thread that has to
+ * wait for the other one spins for a while and then sleeps on a
+ * condition variable, which the other side only touches if somebody
+ * sleeps.
+ */
+template<typename T>
+class SpscRing {
+
+    public:
+        /**
+         * @param[in] capacity maximum number of queued items
+         */
+        explicit SpscRing(size_t capacity)
+            : m_slots(capacity ? capacity : 1), m_head(0), m_tail(0),
+              m_sleepers(0)
+        {}
+
+        /**
+         * Returns the maximum number of queued items.
+         */
+        size_t capacity() const
+        { return m_slots.size(); }
+
+        /**
+         * Returns @c true if nothing is queued (consumer side).
+         */
+        bool empty() const
+        {
+            return m_head.load(std::memory_order_relaxed) ==
+                m_tail.load(std::memory_order_acquire);
+        }
+
+        /**
+         * Returns @c true if no item can be pushed (producer side).
+         */
+        bool full() const
+        {
+            return m_tail.load(std::memory_order_relaxed) -
+                m_head.load(std::memory_order_acquire) == m_slots.size();
+        }
+
+        /**
+         * Moves @p item into the ring unless it is full. Producer only.
+         *
+         * @return @c false if the ring is full
+         */
+        bool tryPush(T &item)
+        {
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            if (tail - m_head.load(std::memory_order_acquire) ==
+                    m_slots.size())
+                return false;
+            m_slots[tail % m_slots.size()] = std::move(item);
+            m_tail.store(tail + 1, std::memory_order_release);
+            wake();
+            return true;
+        }
+
+        /**
+         * Moves the oldest item out of the ring. Consumer only.
+         *
+         * @return @c false if the ring is empty
+         */
+        bool tryPop(T &item)
+        {
+            size_t head = m_head.load(std::memory_order_relaxed);
+            if (head == m_tail.load(std::memory_order_acquire))
+                return false;
+            item = std::move(m_slots[head % m_slots.size()]);
+            m_head.store(head + 1, std::memory_order_release);
+            wake();
+            return true;
+        }
+
+        /**
+         * Waits until @p ready returns @c true. @p ready is checked
+         * again whenever the other side pushes or pops.
+         */
+        template<typename Pred>
+        void wait(Pred ready)
+        {
+            for (int i = 0; i < SPSC_RING_SPINS; ++i) {
+                if (ready())
+                    return;
+                std::this_thread::yield();
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_sleepers.fetch_add(1);
+            // the timeout covers a wake-up between ready() and the wait
+            while (!ready())
+                m_cond.wait_for(lock, std::chrono::milliseconds(1));
+            m_sleepers.fetch_sub(1);
+        }
+
+        /**
+         * Wakes up a waiting thread, e.g. after a stop flag is set.
+         */
+        void wake()
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_sleepers.load()) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_cond.notify_all();
+            }
+        }
+
+    private:
+        std::vector<T> m_slots;
+        alignas(64) std::atomic<size_t> m_head;         // next to pop
+        alignas(64) std::atomic<size_t> m_tail;         // next to push
+        alignas(64) std::atomic<int> m_sleepers;
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+};
+
+//}}}
+
+#endif /* SPSCRING_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
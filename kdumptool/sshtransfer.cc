@@ -18,12 +18,21 @@
  */
 #include <iostream>
 #include <string>
+#include <deque>
+#include <algorithm>
+#include <cstring>
 #include <cstdlib>
 #include <cerrno>
+#include <csignal>
 #include <memory>
+#include <atomic>
+#include <sstream>
 
 #include <stdint.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/uio.h>
 
 #include "global.h"
 #include "debug.h"
@@ -34,6 +43,10 @@
 #include "socket.h"
 #include "sshtransfer.h"
 #include "routable.h"
+#include "stripewriter.h"
+#include "savestats.h"
+#include "pipeloop.h"
+#include "probes.h"
 
 using std::string;
 using std::cerr;
@@ -44,14 +57,15 @@ using std::make_shared;
 
 /* -------------------------------------------------------------------------- */
 SSHTransfer::SSHTransfer(const RootDirURLVector &urlv)
-    : URLTransfer(urlv)
+    : URLTransfer(urlv), m_tuner("ssh"),
+      m_masterChecked(false), m_masterReady(false), m_sinkChecked(false)
 {
     if (urlv.size() > 1)
 	cerr << "WARNING: First dump target used; rest ignored." << endl;
     const RootDirURL &target = urlv.front();
 
-    Debug::debug()->trace("SSHTransfer::SSHTransfer(%s)",
-			  target.getURL().c_str());
+    KTRACE("SSHTransfer::SSHTransfer(%s)",
+	   target.getURL().c_str());
 
     // Check network status
     Configuration *config = Configuration::config();
@@ -59,21 +73,60 @@ SSHTransfer::SSHTransfer(const RootDirURLVector &urlv)
     if (!rt.check(config->KDUMP_NET_TIMEOUT.value()))
 	cerr << "WARNING: Dump target not reachable" << endl;
 
-    string remote;
-    remote.assign("mkdir -p ").append(target.getPath());
-
-    SubProcess p;
-    p.spawn("ssh", makeArgs(remote));
-    int status = p.wait();
-    if (status != 0)
-	throw KError("SSHTransfer::SSHTransfer: ssh command failed"
-		     " with status " + StringUtil::number2string(status));
+    // the first file creates the target directory (see remoteSave())
+    static std::atomic<unsigned> instances(0);
+    m_controlPath.assign("/kdump/.ssh/mux-")
+	.append(StringUtil::number2string(getpid())).append("-")
+	.append(StringUtil::number2string(instances++));
+
+    // -f returns after authentication; the connection stays in the
+    // background until ~SSHTransfer()
+    StringVector args = makeArgs(string(), false);
+    StringVector opts {
+	"-f", "-N",
+	"-o", "ControlMaster=yes",
+	"-o", "ControlPath=" + m_controlPath
+    };
+    args.insert(args.begin(), opts.begin(), opts.end());
+    m_master.spawn("ssh", args);
 }
 
 /* -------------------------------------------------------------------------- */
 SSHTransfer::~SSHTransfer()
 {
-    Debug::debug()->trace("SSHTransfer::~SSHTransfer()");
+    KTRACE("SSHTransfer::~SSHTransfer()");
+
+    try {
+	waitMaster();
+	if (m_masterReady) {
+	    StringVector args = makeArgs(string(), false);
+	    StringVector opts {
+		"-O", "exit",
+		"-o", "ControlPath=" + m_controlPath
+	    };
+	    args.insert(args.begin(), opts.begin(), opts.end());
+
+	    SubProcess p;
+	    p.spawn("ssh", args);
+	    p.wait();
+	}
+    } catch (const KError &error) {
+	KDBG("Cannot stop the ssh connection: %s", error.what());
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+void SSHTransfer::waitMaster(void)
+{
+    if (m_masterChecked)
+	return;
+    m_masterChecked = true;
+
+    int status = m_master.wait();
+    m_masterReady = (status == 0);
+    if (!m_masterReady)
+	cerr << "WARNING: Cannot share the ssh connection (status "
+	     << status << "); connecting for each file" << endl;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -81,7 +134,7 @@ void SSHTransfer::perform(DataProvider *dataprovider,
 			  const StringVector &target_files,
 			  bool *directSave)
 {
-    Debug::debug()->trace("SSHTransfer::perform(%p, [ \"%s\"%s ])",
+    KTRACE("SSHTransfer::perform(%p, [ \"%s\"%s ])",
 	dataprovider, target_files.front().c_str(),
 	target_files.size() > 1 ? ", ..." : "");
 
@@ -95,31 +148,59 @@ void SSHTransfer::perform(DataProvider *dataprovider,
     FilePath fp = target.getPath();
     fp.appendPath(target_files.front());
 
-    string remote;
-    remote.assign("dd of=").append(fp).append("-incomplete");
-    remote.append(" && mv ").append(fp).append("-incomplete ").append(fp);
-    Debug::debug()->dbg("Remote command: %s", remote.c_str());
+    string remote = remoteSave(fp);
+    KDBG("Remote command: %s", remote.c_str());
 
+    waitMaster();
     SubProcess p;
     auto pipe = make_shared<ParentToChildPipe>();
     p.setChildFD(STDIN_FILENO, pipe);
     p.spawn("ssh", makeArgs(remote));
 
     int fd = pipe->writeEnd();
+    TransferMeter meter("ssh", target_files.front());
     try {
         dataprovider->prepare();
         prepared = true;
 
-        while (true) {
-            size_t read_data = dataprovider->getData(m_buffer, BUFSIZ);
+        // ssh reads from a pipe, so the data can be spliced
+        bool splice = dataprovider->canSplice();
+        if (splice) {
+            KDBG("Moving the data with splice()");
+            size_t moved;
+            while ((moved = meter.source([&]() {
+                        return dataprovider->spliceData(fd);
+                    })) != 0)
+                meter.moved(moved);
+        }
+
+        // mapped data can be written without copying it to m_buffer
+        bool map = !splice && dataprovider->canMapData();
+        while (!splice) {
+            size_t size = m_tuner.size();
+            if (!map && m_buffer.size() < size) {
+                m_buffer.reset();
+                m_buffer = BufferPool::pool()->get(size);
+            }
+
+            const char *p = m_buffer.get();
+            size_t read_data = meter.source([&]() {
+                    return map ?
+                        dataprovider->mapData(&p, size) :
+                        dataprovider->getData(m_buffer.get(), size);
+                });
 
             // finished?
             if (read_data == 0)
                 break;
+            meter.moved(read_data);
+            size_t written = read_data;
+            BufferTuner::Clock::time_point start = BufferTuner::Clock::now();
 
-	    char *p = m_buffer;
 	    while (read_data) {
-		ssize_t ret = write(fd, p, read_data);
+		ssize_t ret = meter.sink([&]() {
+			return write(fd, p, read_data);
+		    });
 
 		if (ret < 0)
 		    throw KSystemError("SSHTransfer::perform: write failed",
@@ -127,7 +208,10 @@ void SSHTransfer::perform(DataProvider *dataprovider,
 		read_data -= ret;
 		p += ret;
 	    }
+            m_tuner.account(written, BufferTuner::Clock::now() - start);
         }
+        if (!splice)
+            meter.bufferSize(m_tuner.size());
     } catch (...) {
         if (prepared)
             dataprovider->finish();
@@ -142,7 +226,161 @@ void SSHTransfer::perform(DataProvider *dataprovider,
 		     " with status " + StringUtil::number2string(status));
 }
 
-StringVector SSHTransfer::makeArgs(std::string const &remote)
+/* -------------------------------------------------------------------------- */
+void SSHTransfer::performStriped(DataProvider *dataprovider,
+				 const string &target_file,
+				 size_t chunkSize, unsigned streams)
+{
+    KTRACE("SSHTransfer::performStriped(%p, %s, %lu, %u)",
+	dataprovider, target_file.c_str(), (unsigned long)chunkSize, streams);
+
+    if (streams < 1)
+	streams = 1;
+
+    const RootDirURL &target = getURLVector().front();
+    std::vector<std::unique_ptr<SubProcess>> procs;
+    StripeWriter::Vector writers;
+    StringVector stripes;
+    unsigned long long total = 0;
+    TransferMeter meter("ssh-stripe", target_file);
+    bool prepared = false;
+
+    // the stripe writers inherit the mask, so a dead ssh process is
+    // reported as EPIPE, not SIGPIPE
+    sigset_t sigpipe, oldmask;
+    sigemptyset(&sigpipe);
+    sigaddset(&sigpipe, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &sigpipe, &oldmask);
+
+    try {
+	for (unsigned n = 0; n < streams; ++n) {
+	    FilePath fp = target.getPath();
+	    fp.appendPath(target_file + ".stripe" +
+			  StringUtil::number2string(n));
+	    stripes.push_back(fp);
+
+	    string remote = remoteSave(fp);
+	    KDBG("Remote command: %s", remote.c_str());
+
+	    procs.emplace_back(new SubProcess());
+	    auto pipe = make_shared<ParentToChildPipe>();
+	    procs.back()->setChildFD(STDIN_FILENO, pipe);
+	    procs.back()->spawn("ssh", makeArgs(remote, false));
+
+	    // keep the write end away from the other ssh processes
+	    int fd = fcntl(pipe->writeEnd(), F_DUPFD_CLOEXEC, 0);
+	    if (fd < 0)
+		throw KSystemError("SSHTransfer::performStriped: "
+				   "cannot duplicate pipe", errno);
+	    pipe->close();
+	    writers.emplace_back(new StripeWriter(fd, fp, chunkSize, 0));
+	}
+
+	dataprovider->prepare();
+	prepared = true;
+
+	total = StripeWriter::distribute(dataprovider, writers, chunkSize,
+					 meter);
+	for (unsigned n = 0; n < writers.size(); ++n)
+	    meter.sink([&]() { writers[n]->finish(); });
+    } catch (...) {
+	// stop ssh first, a writer may be blocked on a full pipe
+	for (unsigned n = 0; n < procs.size(); ++n) {
+	    try {
+		if (procs[n]->getChildPID() != -1)
+		    procs[n]->kill();
+	    } catch (const KError &) {
+	    }
+	}
+	writers.clear();
+	for (unsigned n = 0; n < procs.size(); ++n) {
+	    try {
+		if (procs[n]->getChildPID() != -1)
+		    procs[n]->wait();
+	    } catch (const KError &) {
+	    }
+	}
+	pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
+	if (prepared) {
+	    dataprovider->setError(true);
+	    dataprovider->finish();
+	}
+	throw;
+    }
+    pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
+
+    dataprovider->finish();
+
+    for (unsigned n = 0; n < procs.size(); ++n) {
+	int status = procs[n]->wait();
+	if (status != 0)
+	    throw KError("SSHTransfer::performStriped: ssh command failed"
+			 " with status " + StringUtil::number2string(status));
+    }
+
+    const string map = StripeWriter::map(chunkSize, total, stripes);
+    BufferDataProvider mapProvider(map.c_str(), map.size());
+    Transfer::perform(&mapProvider, target_file + ".stripes");
+}
+
+/* -------------------------------------------------------------------------- */
+void SSHTransfer::negotiateSink(void)
+{
+    if (m_sinkChecked)
+	return;
+    m_sinkChecked = true;
+
+    // dd defaults to 512-byte blocks, i.e. one write per 512 bytes on
+    // the target host; with separate ibs and obs, dd writes full blocks
+    // even if the pipe returns less
+    static const char probe[] =
+	"if dd if=/dev/null of=/dev/null ibs=1M obs=1M conv=sparse"
+	" 2>/dev/null; then echo sparse;"
+	" elif dd if=/dev/null of=/dev/null ibs=1M obs=1M"
+	" 2>/dev/null; then echo blocks;"
+	" fi";
+
+    waitMaster();
+    std::ostringstream stdoutStream;
+    ProcessFilter p;
+    p.setStdout(&stdoutStream);
+    int status;
+    try {
+	status = p.execute("ssh", makeArgs(probe));
+    } catch (const KError &error) {
+	KDBG("Cannot probe the remote dd: %s", error.what());
+	return;
+    }
+
+    KString answer = stdoutStream.str();
+    answer.trim();
+    if (status != 0)
+	KDBG("Remote dd probe failed with status %d", status);
+    else if (answer == "sparse") {
+	m_sinkOptions = " ibs=1M obs=1M";
+	Configuration *config = Configuration::config();
+	if (!config->kdumptoolContainsFlag(Configuration::FLAG_NOSPARSE))
+	    m_sinkOptions.append(" conv=sparse");
+    } else if (answer == "blocks")
+	m_sinkOptions = " ibs=1M obs=1M";
+    KDBG("Remote dd options:%s", m_sinkOptions.c_str());
+}
+
+/* -------------------------------------------------------------------------- */
+string SSHTransfer::remoteSave(const FilePath &fp)
+{
+    negotiateSink();
+
+    string remote;
+    remote.assign("mkdir -p ").append(fp.dirName());
+    remote.append(" && dd of=").append(fp).append("-incomplete")
+	.append(m_sinkOptions);
+    remote.append(" && mv ").append(fp).append("-incomplete ").append(fp);
+    return remote;
+}
+
+/* -------------------------------------------------------------------------- */
+StringVector SSHTransfer::makeArgs(std::string const &remote, bool shared)
 {
     const RootDirURL &target = getURLVector().front();
     StringVector ret;
@@ -150,6 +388,14 @@ StringVector SSHTransfer::makeArgs(std::string const &remote)
     ret.push_back("-F");
     ret.push_back("/kdump/.ssh/config");
 
+    ret.push_back("-o");
+    if (shared && m_masterReady) {
+	ret.push_back("ControlPath=" + m_controlPath);
+	ret.push_back("-o");
+	ret.push_back("ControlMaster=no");
+    } else
+	ret.push_back("ControlPath=none");
+
     ret.push_back("-l");
     ret.push_back(target.getUsername());
 
@@ -160,7 +406,8 @@ StringVector SSHTransfer::makeArgs(std::string const &remote)
     }
 
     ret.push_back(target.getHostname());
-    ret.push_back(remote);
+    if (!remote.empty())
+	ret.push_back(remote);
 
     return ret;
 }
@@ -334,14 +581,17 @@ void SFTPPacket::addString(KString const &val)
 std::string SFTPPacket::getString(void)
 {
     unsigned long len = getInt32();
+    if (len > m_vector.size() - m_gpos)
+	throw KError("SFTP string exceeds the packet");
     ByteVector::iterator it = m_vector.begin() + m_gpos;
+    m_gpos += len;
     return string(it, it + len);
 }
 
 /* -------------------------------------------------------------------------- */
-ByteVector const &SFTPPacket::update(void)
+ByteVector const &SFTPPacket::update(size_t payload)
 {
-    uint_fast32_t len = m_vector.size() - sizeof(uint32_t);
+    uint_fast32_t len = m_vector.size() - sizeof(uint32_t) + payload;
     m_vector[0] = (len >> 24) & 0xff;
     m_vector[1] = (len >> 16) & 0xff;
     m_vector[2] = (len >>  8) & 0xff;
@@ -354,7 +604,7 @@ ByteVector const &SFTPPacket::update(void)
 
 /* -------------------------------------------------------------------------- */
 SFTPTransfer::SFTPTransfer(const RootDirURLVector &urlv)
-    : URLTransfer(urlv)
+    : URLTransfer(urlv), m_lastid(0), m_session(0)
 {
     if (urlv.size() > 1)
 	cerr << "WARNING: First dump target used; rest ignored." << endl;
@@ -366,9 +616,27 @@ SFTPTransfer::SFTPTransfer(const RootDirURLVector &urlv)
     if (!rt.check(config->KDUMP_NET_TIMEOUT.value()))
 	cerr << "WARNING: Dump target not reachable" << endl;
 
-    Debug::debug()->trace("SFTPTransfer::SFTPTransfer(%s)",
-			  parser.getURL().c_str());
+    KTRACE("SFTPTransfer::SFTPTransfer(%s)",
+	   parser.getURL().c_str());
+
+    int window = config->KDUMP_SFTP_WINDOW.value();
+    m_window = window > 0 ? window : 1;
+    int chunk = config->KDUMP_SFTP_CHUNK_SIZE.value();
+    if (chunk <= 0)
+	chunk = 1;
+    else if (chunk > SFTP_MAX_CHUNK_KB)
+	chunk = SFTP_MAX_CHUNK_KB;
+    m_chunkSize = chunk * 1024;
+    KDBG("SFTP window %zu, chunk size %zu",
+	 m_window, m_chunkSize);
+
+    connect();
+    mkpath(parser.getPath());
+}
 
+/* -------------------------------------------------------------------------- */
+void SFTPTransfer::connect(void)
+{
     m_req = make_shared<ParentToChildPipe>();
     m_process.setChildFD(STDIN_FILENO, m_req);
 
@@ -387,15 +655,83 @@ SFTPTransfer::SFTPTransfer(const RootDirURLVector &urlv)
 	throw KError(KString("Invalid response to SSH_FXP_INIT: type ") +
 		     StringUtil::number2string(unsigned(type)));
     m_proto_ver = initpkt.getInt32();
-    Debug::debug()->dbg("Remote SFTP version %lu", m_proto_ver);
+    KDBG("Remote SFTP version %lu", m_proto_ver);
+}
 
-    mkpath(parser.getPath());
+/* -------------------------------------------------------------------------- */
+void SFTPTransfer::reconnect(void)
+{
+    KTRACE("SFTPTransfer::reconnect()");
+
+    // the old ssh process has failed, its status does not matter
+    m_req->close();
+    m_resp->close();
+    m_process.wait();
+
+    // the open handles and outstanding requests are gone with it
+    ++m_session;
+    m_writes.clear();
+    m_ignored.clear();
+    m_replies.clear();
+
+    const RootDirURL &parser = getURLVector().front();
+    Routable rt(parser.getHostname());
+    if (!rt.check(Configuration::config()->KDUMP_NET_TIMEOUT.value()))
+	cerr << "WARNING: Dump target not reachable" << endl;
+
+    connect();
+}
+
+/* -------------------------------------------------------------------------- */
+template<typename Fn>
+void SFTPTransfer::resumable(OpenFile &file, int &retries, Fn fn)
+{
+    // another file may have reconnected in the meantime
+    bool lost = file.session != m_session;
+    while (true) {
+	try {
+	    if (lost) {
+		if (file.session == m_session)
+		    reconnect();
+
+		// acknowledged data must have survived
+		openfile(file, SSH_FXF_WRITE);
+		unsigned long long size = filesize(file.handle);
+		if (size < file.acked)
+		    throw KError(file.path + " has shrunk to " +
+				 StringUtil::number2string(size) +
+				 " bytes on the server.");
+
+		// send everything that has not been acknowledged again
+		std::map<unsigned long, PendingWrite> pending;
+		pending.swap(file.pending);
+		KDBG("Resuming %s with %zu pending writes",
+		     file.path.c_str(), pending.size());
+		for (auto &it : pending) {
+		    PendingWrite &w = it.second;
+		    BufferPool::Buffer data;
+		    data.swap(w.data);
+		    writefile(file, w.off, data, w.len);
+		}
+		lost = false;
+	    }
+	    fn();
+	    return;
+	} catch (const KSFTPDisconnect &e) {
+	    if (retries <= 0)
+		throw;
+	    --retries;
+	    cerr << "WARNING: " << e.what() << ", reconnecting ("
+		 << retries << " retries left)" << endl;
+	    lost = true;
+	}
+    }
 }
 
 /* -------------------------------------------------------------------------- */
 SFTPTransfer::~SFTPTransfer()
 {
-    Debug::debug()->trace("SFTPTransfer::~SFTPTransfer()");
+    KTRACE("SFTPTransfer::~SFTPTransfer()");
 
     if (m_process.getChildPID() != -1) {
         m_req->close();
@@ -413,7 +749,7 @@ void SFTPTransfer::perform(DataProvider *dataprovider,
                            const StringVector &target_files,
                            bool *directSave)
 {
-    Debug::debug()->trace("SFTPTransfer::perform(%p, [ \"%s\"%s ])",
+    KTRACE("SFTPTransfer::perform(%p, [ \"%s\"%s ])",
 	dataprovider, target_files.front().c_str(),
 	target_files.size() > 1 ? ", ..." : "");
 
@@ -426,63 +762,182 @@ void SFTPTransfer::perform(DataProvider *dataprovider,
     FilePath fp = target.getPath();
     fp.appendPath(target_files.front());
 
-    string handle = createfile(fp);
+    // the session is locked for each request, so that other threads
+    // can upload their files while this one waits for its data
+    int retries = Configuration::config()->KDUMP_TRANSFER_RETRIES.value();
+    OpenFile file(fp);
+    {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	openfile(file, SSH_FXF_WRITE | SSH_FXF_CREAT | SSH_FXF_TRUNC);
+    }
+    TransferMeter meter("sftp", target_files.front());
     try {
 	dataprovider->prepare();
-	ByteVector buffer(BUFSIZ);
-	off_t off = 0;
 	try {
-	    while (true) {
-		char *bufp = (char*) buffer.data();
-		size_t len = dataprovider->getData(bufp, buffer.size());
-
-		// finished?
-		if (len == 0)
-		    break;
-
-		buffer.resize(len);
-		writefile(handle, off, buffer);
-		off += buffer.size();
-		buffer.resize(buffer.capacity());
-	    }
+	    if (dataprovider->canPlaceData())
+		uploadLoop<PlacedRead>(dataprovider, file, retries, meter);
+	    else
+		uploadLoop<CopyRead>(dataprovider, file, retries, meter);
 	} catch (...) {
 	    dataprovider->finish();
 	    throw;
 	}
 	dataprovider->finish();
     } catch (...) {
-	closefile(handle);
+	std::lock_guard<std::mutex> lock(m_mutex);
+	// collect the remaining replies before closing the handle
+	try {
+	    if (file.session == m_session) {
+		while (!file.pending.empty())
+		    waitwrite();
+		closefile(file.handle);
+	    }
+	} catch (...) {
+	    // report the original error
+	}
+	forget(file);
 	throw;
     }
 
-    closefile(handle);
+    // all data has been acknowledged, so a handle that was lost
+    // with another file's connection need not be closed
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (file.session == m_session)
+	closefile(file.handle);
 }
 
 /* -------------------------------------------------------------------------- */
-bool SFTPTransfer::exists(const string &file)
+void SFTPTransfer::performBatch(const ArtifactBatch &artifacts)
 {
-    Debug::debug()->trace("SFTPTransfer::exists(%s)", file.c_str());
+    KTRACE("SFTPTransfer::performBatch([%zu files])", artifacts.size());
 
-    SFTPPacket pkt;
-    pkt.addByte(SSH_FXP_STAT);
-    pkt.addInt32(nextId());
-    pkt.addString(file);
-    sendPacket(pkt);
+    if (artifacts.empty())
+	return;
 
-    recvPacket(pkt);
-    unsigned char type = pkt.getByte();
-    unsigned long id = pkt.getInt32();
-    if (id != m_lastid)
-	throw KError("SFTP request/reply id mismatch");
+    const RootDirURL &target = getURLVector().front();
 
-    if (type == SSH_FXP_ATTRS)
-	return true;
+    // the writes keep pointers to their file, so it must not move
+    std::deque<OpenFile> files;
+    TransferMeter meter("sftp-batch", artifacts.front().first);
+    bool lost = false;
+    {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	try {
+	    meter.sink([&]() {
+		    // one round trip for all OPEN requests
+		    std::vector<unsigned long> ids;
+		    for (auto const &a : artifacts) {
+			FilePath fp = target.getPath();
+			files.emplace_back(fp.appendPath(a.first));
+			ids.push_back(sendOpen(files.back().path,
+					       SSH_FXF_WRITE | SSH_FXF_CREAT |
+					       SSH_FXF_TRUNC));
+		    }
+		    for (size_t n = 0; n < files.size(); ++n) {
+			files[n].handle = recvHandle(ids[n], files[n].path);
+			files[n].session = m_session;
+		    }
+
+		    // the writes of all files share the window
+		    BufferPool::Buffer buffer =
+			BufferPool::pool()->get(m_chunkSize);
+		    for (size_t n = 0; n < files.size(); ++n) {
+			const string &data = artifacts[n].second;
+			for (size_t off = 0; off < data.size(); ) {
+			    size_t len = std::min(m_chunkSize,
+						  data.size() - off);
+			    memcpy(buffer.get(), data.data() + off, len);
+			    writefile(files[n], off, buffer, len);
+			    meter.moved(len);
+			    off += len;
+			}
+		    }
+		    for (auto &file : files)
+			flushwrites(file);
+
+		    // and one for the CLOSE requests
+		    ids.clear();
+		    for (auto const &file : files)
+			ids.push_back(sendClose(file.handle));
+		    for (size_t n = 0; n < files.size(); ++n) {
+			recvClose(ids[n], files[n].handle);
+			files[n].handle.clear();
+		    }
+		});
+	} catch (const KSFTPDisconnect &e) {
+	    for (auto &file : files)
+		forget(file);
+	    if (Configuration::config()->KDUMP_TRANSFER_RETRIES.value() <= 0)
+		throw;
+	    cerr << "WARNING: " << e.what()
+		 << ", saving the files one by one" << endl;
+	    reconnect();
+	    lost = true;
+	} catch (...) {
+	    for (auto &file : files)
+		forget(file);
+	    // close what is still open, but report the original error
+	    try {
+		for (auto const &file : files)
+		    if (!file.handle.empty() && file.session == m_session)
+			closefile(file.handle);
+	    } catch (...) {
+	    }
+	    throw;
+	}
+    }
 
-    if (type != SSH_FXP_STATUS)
-	throw KError("Invalid response to SSH_FXP_LSTAT: type " +
-		     StringUtil::number2string(unsigned(type)));
+    // perform() takes the lock itself and resumes each file
+    if (lost)
+	Transfer::performBatch(artifacts);
+}
 
-    unsigned long errcode = pkt.getInt32();
+/* -------------------------------------------------------------------------- */
+template<typename Read>
+void SFTPTransfer::uploadLoop(DataProvider *dataprovider, OpenFile &file,
+			      int &retries, TransferMeter &meter)
+{
+    // writefile() sends the buffer itself
+    static_assert(!Read::mapped, "the data must be in the buffer");
+
+    BufferPool::Buffer buffer = BufferPool::pool()->get(m_chunkSize);
+    off_t off = 0;
+    while (true) {
+	const char *data;
+	size_t len = meter.source([&]() {
+		return Read::read(dataprovider, buffer.get(), buffer.size(),
+				  data, off);
+	    });
+
+	// finished?
+	if (len == 0)
+	    break;
+	meter.moved(len);
+
+	// waits for replies when the window is full
+	meter.sink([&]() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		resumable(file, retries, [&]() {
+			writefile(file, off, buffer, len);
+		    });
+	    });
+	off += len;
+    }
+    meter.sink([&]() {
+	    std::lock_guard<std::mutex> lock(m_mutex);
+	    resumable(file, retries, [&]() { flushwrites(file); });
+	});
+}
+
+/* -------------------------------------------------------------------------- */
+bool SFTPTransfer::exists(const string &file)
+{
+    KTRACE("SFTPTransfer::exists(%s)", file.c_str());
+
+    unsigned long errcode = recvStatus(sendPath(SSH_FXP_STAT, file),
+				       "SSH_FXP_STAT");
+    if (errcode == SSH_FX_OK)
+	return true;
     if (errcode != SSH_FX_NO_SUCH_FILE)
 	throw KSFTPError("stat failed on " + file, errcode);
 
@@ -492,59 +947,90 @@ bool SFTPTransfer::exists(const string &file)
 /* -------------------------------------------------------------------------- */
 void SFTPTransfer::mkpath(const std::string &path)
 {
-    Debug::debug()->trace("SFTPTransfer::mkpath(%s)", path.c_str());
+    KTRACE("SFTPTransfer::mkpath(%s)", path.c_str());
 
-    if (!exists(path)) {
-	KString dir = path;
+    // the path and its parents, the shortest first
+    StringVector dirs;
+    KString dir = path;
+    while (true) {
+	dirs.insert(dirs.begin(), dir);
 	dir.rtrim(PATH_SEPARATOR);
 	KString::size_type pos = dir.rfind(PATH_SEPARATOR);
-	if (pos > 0 && pos != KString::npos) {
-	    dir.erase(pos);
-	    mkpath(dir);
-	}
-
-	SFTPPacket pkt;
-	pkt.addByte(SSH_FXP_MKDIR);
-	pkt.addInt32(nextId());
-	pkt.addString(path);
-	pkt.addInt32(0UL);
-	sendPacket(pkt);
-
-	recvPacket(pkt);
-	unsigned char type = pkt.getByte();
-	unsigned long id = pkt.getInt32();
-	if (id != m_lastid)
-	    throw KError("SFTP request/reply id mismatch");
-
-	if (type != SSH_FXP_STATUS)
-	    throw KError("Invalid response to SSH_FXP_MKDIR: type " +
-			 StringUtil::number2string(unsigned(type)));
+	if (pos == 0 || pos == KString::npos)
+	    break;
+	dir.erase(pos);
+    }
 
-	unsigned long errcode = pkt.getInt32();
+    // one round trip for all STAT requests
+    std::vector<unsigned long> ids;
+    for (auto const &d : dirs)
+	ids.push_back(sendPath(SSH_FXP_STAT, d));
+    std::vector<unsigned long> status;
+    for (auto id : ids)
+	status.push_back(recvStatus(id, "SSH_FXP_STAT"));
+
+    // everything below the longest existing path must be created
+    size_t first = dirs.size();
+    while (first > 0) {
+	unsigned long errcode = status[first - 1];
+	if (errcode == SSH_FX_OK)
+	    break;
+	if (errcode != SSH_FX_NO_SUCH_FILE)
+	    throw KSFTPError("stat failed on " + dirs[first - 1], errcode);
+	--first;
+    }
+    if (first == dirs.size())
+	return;
+
+    // and one for the MKDIR requests
+    ids.clear();
+    for (size_t i = first; i < dirs.size(); ++i)
+	ids.push_back(sendPath(SSH_FXP_MKDIR, dirs[i]));
+    status.clear();
+    for (auto id : ids)
+	status.push_back(recvStatus(id, "SSH_FXP_MKDIR"));
+
+    // a server may execute the requests in any order
+    for (size_t i = first; i < dirs.size(); ++i) {
+	if (status[i - first] == SSH_FX_OK || exists(dirs[i]))
+	    continue;
+	KDBG("Creating %s again", dirs[i].c_str());
+	unsigned long errcode = recvStatus(sendPath(SSH_FXP_MKDIR, dirs[i]),
+					   "SSH_FXP_MKDIR");
 	if (errcode != SSH_FX_OK)
-	    throw KSFTPError("mkdir failed on " + path, errcode);
+	    throw KSFTPError("mkdir failed on " + dirs[i], errcode);
     }
 }
 
 /* -------------------------------------------------------------------------- */
-std::string SFTPTransfer::createfile(const std::string &file)
+std::string SFTPTransfer::createfile(const std::string &file,
+				     unsigned long flags)
 {
-    Debug::debug()->trace("SFTPTransfer::createfile(%s)", file.c_str());
+    KTRACE("SFTPTransfer::createfile(%s, 0x%lx)", file.c_str(), flags);
+
+    return recvHandle(sendOpen(file, flags), file);
+}
 
+/* -------------------------------------------------------------------------- */
+unsigned long SFTPTransfer::sendOpen(const std::string &file,
+				     unsigned long flags)
+{
     SFTPPacket pkt;
+    unsigned long id = nextId();
     pkt.addByte(SSH_FXP_OPEN);
-    pkt.addInt32(nextId());
+    pkt.addInt32(id);
     pkt.addString(file);
-    pkt.addInt32(SSH_FXF_WRITE | SSH_FXF_CREAT | SSH_FXF_TRUNC);
+    pkt.addInt32(flags);
     pkt.addInt32(0UL);		// no attrs
     sendPacket(pkt);
+    return id;
+}
 
-    recvPacket(pkt);
-    unsigned char type = pkt.getByte();
-    unsigned long id = pkt.getInt32();
-    if (id != m_lastid)
-	throw KError("SFTP request/reply id mismatch");
-
+/* -------------------------------------------------------------------------- */
+std::string SFTPTransfer::recvHandle(unsigned long id, const std::string &file)
+{
+    SFTPPacket pkt;
+    unsigned char type = recvReply(id, pkt);
     if (type == SSH_FXP_HANDLE)
 	return pkt.getString();
 
@@ -559,22 +1045,30 @@ std::string SFTPTransfer::createfile(const std::string &file)
 /* -------------------------------------------------------------------------- */
 void SFTPTransfer::closefile(const std::string &handle)
 {
-    Debug::debug()->trace("SFTPTransfer::closefile(%s)", handle.c_str());
+    KTRACE("SFTPTransfer::closefile(%s)", handle.c_str());
 
+    recvClose(sendClose(handle), handle);
+}
+
+/* -------------------------------------------------------------------------- */
+unsigned long SFTPTransfer::sendClose(const std::string &handle)
+{
     SFTPPacket pkt;
+    unsigned long id = nextId();
     pkt.addByte(SSH_FXP_CLOSE);
-    pkt.addInt32(nextId());
+    pkt.addInt32(id);
     pkt.addString(handle);
     sendPacket(pkt);
+    return id;
+}
 
-    recvPacket(pkt);
-    unsigned char type = pkt.getByte();
-    unsigned long id = pkt.getInt32();
-    if (id != m_lastid)
-	throw KError("SFTP request/reply id mismatch");
-
+/* -------------------------------------------------------------------------- */
+void SFTPTransfer::recvClose(unsigned long id, const std::string &handle)
+{
+    SFTPPacket pkt;
+    unsigned char type = recvReply(id, pkt);
     if (type != SSH_FXP_STATUS)
-	throw KError("Invalid response to SSH_FXP_OPEN: type " +
+	throw KError("Invalid response to SSH_FXP_CLOSE: type " +
 		     StringUtil::number2string(unsigned(type)));
 
     unsigned long errcode = pkt.getInt32();
@@ -583,31 +1077,174 @@ void SFTPTransfer::closefile(const std::string &handle)
 }
 
 /* -------------------------------------------------------------------------- */
-void SFTPTransfer::writefile(const std::string &handle, off_t off,
-			     const ByteVector &data)
+unsigned long long SFTPTransfer::filesize(const std::string &handle)
 {
+    KTRACE("SFTPTransfer::filesize(%s)", handle.c_str());
+
     SFTPPacket pkt;
-    pkt.addByte(SSH_FXP_WRITE);
-    pkt.addInt32(nextId());
+    unsigned long id = nextId();
+    pkt.addByte(SSH_FXP_FSTAT);
+    pkt.addInt32(id);
     pkt.addString(handle);
-    pkt.addInt64(off);
-    pkt.addInt32(data.size());
-    pkt.addByteVector(data);
     sendPacket(pkt);
 
+    unsigned char type = recvReply(id, pkt);
+    if (type == SSH_FXP_ATTRS) {
+	unsigned long flags = pkt.getInt32();
+	if (!(flags & SSH_FILEXFER_ATTR_SIZE))
+	    throw KError("SSH_FXP_FSTAT reply has no size");
+	return pkt.getInt64();
+    }
+
+    if (type != SSH_FXP_STATUS)
+	throw KError("Invalid response to SSH_FXP_FSTAT: type " +
+		     StringUtil::number2string(unsigned(type)));
+
+    unsigned long errcode = pkt.getInt32();
+    throw KSFTPError("fstat failed on " + handle, errcode);
+}
+
+/* -------------------------------------------------------------------------- */
+void SFTPTransfer::openfile(OpenFile &file, unsigned long flags)
+{
+    file.handle = createfile(file.path, flags);
+    file.session = m_session;
+}
+
+/* -------------------------------------------------------------------------- */
+void SFTPTransfer::writefile(OpenFile &file, off_t off,
+			     BufferPool::Buffer &data, size_t len)
+{
+    while (m_writes.size() >= m_window)
+	waitwrite();
+    if (file.error != SSH_FX_OK)
+	throw KSFTPError("write failed on " + file.path, file.error);
+
+    SFTPPacket pkt;
+    unsigned long id = nextId();
+    pkt.addByte(SSH_FXP_WRITE);
+    pkt.addInt32(id);
+    pkt.addString(file.handle);
+    pkt.addInt64(off);
+    pkt.addInt32(len);
+    sendPacket(pkt, data.get(), len);
+    KEVENT("sftp: write request %llu at offset %llu", id, off);
+    KDUMP_PROBE3(sftp_send, id, off, len);
+
+    // keep the data until the server has it
+    PendingWrite &w = file.pending[id];
+    w.off = off;
+    w.len = len;
+    w.data.swap(data);
+    m_writes[id] = &file;
+    if (!m_spare.empty()) {
+	data.swap(m_spare.back());
+	m_spare.pop_back();
+    } else
+	data = BufferPool::pool()->get(w.data.size());
+}
+
+/* -------------------------------------------------------------------------- */
+void SFTPTransfer::waitwrite(void)
+{
+    SFTPPacket pkt;
     recvPacket(pkt);
     unsigned char type = pkt.getByte();
     unsigned long id = pkt.getInt32();
-    if (id != m_lastid)
-	throw KError("SFTP request/reply id mismatch");
-
+    KEVENT("sftp: reply %llu, type %llu", id, type);
+    KDUMP_PROBE2(sftp_ack, id, type);
+
+    // replies may come in any order, so match them by id
+    std::map<unsigned long, OpenFile *>::iterator it = m_writes.find(id);
+    if (it == m_writes.end()) {
+	if (m_ignored.erase(id))
+	    return;
+	Reply &reply = m_replies[id];
+	reply.type = type;
+	reply.pkt = pkt;
+	return;
+    }
+    OpenFile &file = *it->second;
+    m_writes.erase(it);
+
+    std::map<unsigned long, PendingWrite>::iterator w =
+	file.pending.find(id);
+    unsigned long long end = w->second.off + w->second.len;
+    if (end > file.acked)
+	file.acked = end;
+    m_spare.push_back(std::move(w->second.data));
+    file.pending.erase(w);
+
+    // the error belongs to the thread that writes this file
     if (type != SSH_FXP_STATUS)
 	throw KError("Invalid response to SSH_FXP_WRITE: type " +
 		     StringUtil::number2string(unsigned(type)));
-
     unsigned long errcode = pkt.getInt32();
-    if (errcode != SSH_FX_OK)
-	throw KSFTPError("close failed on " + handle, errcode);
+    if (errcode != SSH_FX_OK && file.error == SSH_FX_OK)
+	file.error = errcode;
+}
+
+/* -------------------------------------------------------------------------- */
+void SFTPTransfer::flushwrites(OpenFile &file)
+{
+    KTRACE("SFTPTransfer::flushwrites(%s): %zu pending",
+	   file.path.c_str(), file.pending.size());
+
+    while (!file.pending.empty())
+	waitwrite();
+    if (file.error != SSH_FX_OK)
+	throw KSFTPError("write failed on " + file.path, file.error);
+}
+
+/* -------------------------------------------------------------------------- */
+void SFTPTransfer::forget(OpenFile &file)
+{
+    for (auto const &it : file.pending) {
+	if (m_writes.erase(it.first))
+	    m_ignored.insert(it.first);
+    }
+    file.pending.clear();
+}
+
+/* -------------------------------------------------------------------------- */
+unsigned long SFTPTransfer::sendPath(unsigned char type,
+				     const std::string &path)
+{
+    SFTPPacket pkt;
+    unsigned long id = nextId();
+    pkt.addByte(type);
+    pkt.addInt32(id);
+    pkt.addString(path);
+    if (type == SSH_FXP_MKDIR)
+	pkt.addInt32(0UL);		// no attrs
+    sendPacket(pkt);
+    return id;
+}
+
+/* -------------------------------------------------------------------------- */
+unsigned char SFTPTransfer::recvReply(unsigned long id, SFTPPacket &pkt)
+{
+    std::map<unsigned long, Reply>::iterator it;
+    while ((it = m_replies.find(id)) == m_replies.end())
+	waitwrite();
+
+    unsigned char type = it->second.type;
+    pkt = it->second.pkt;
+    m_replies.erase(it);
+    return type;
+}
+
+/* -------------------------------------------------------------------------- */
+unsigned long SFTPTransfer::recvStatus(unsigned long id, const char *request)
+{
+    SFTPPacket pkt;
+    unsigned char type = recvReply(id, pkt);
+    if (type == SSH_FXP_ATTRS)
+	return SSH_FX_OK;
+    if (type != SSH_FXP_STATUS)
+	throw KError(KString("Invalid response to ") + request + ": type " +
+		     StringUtil::number2string(unsigned(type)));
+    return pkt.getInt32();
 }
 
 /* -------------------------------------------------------------------------- */
@@ -628,6 +1265,17 @@ StringVector SFTPTransfer::makeArgs(void)
 	ret.push_back(StringUtil::number2string(port));
     }
 
+    // a dead link must end ssh, so that the transfer can resume
+    if (Configuration::config()->KDUMP_TRANSFER_RETRIES.value() > 0) {
+	int timeout = Configuration::config()->KDUMP_NET_TIMEOUT.value();
+	int interval = timeout >= 6 ? timeout / 3 : 2;
+	ret.push_back("-o");
+	ret.push_back("ServerAliveInterval=" +
+		      StringUtil::number2string(interval));
+	ret.push_back("-o");
+	ret.push_back("ServerAliveCountMax=3");
+    }
+
     ret.push_back("-s");
 
     ret.push_back(target.getHostname());
@@ -637,20 +1285,53 @@ StringVector SFTPTransfer::makeArgs(void)
 }
 
 /* -------------------------------------------------------------------------- */
-void SFTPTransfer::sendPacket(SFTPPacket &pkt)
+void SFTPTransfer::sendPacket(SFTPPacket &pkt,
+			      const char *payload, size_t len)
 {
-    const ByteVector bv = pkt.update();
-    const unsigned char *bufp = bv.data();
-    size_t buflen = bv.size();
-
-    while (buflen) {
-        ssize_t len = write(m_req->writeEnd(), bufp, buflen);
-	if (len < 0)
+    const ByteVector &bv = pkt.update(len);
+    struct iovec iov[2];
+    iov[0].iov_base = const_cast<unsigned char *>(bv.data());
+    iov[0].iov_len = bv.size();
+    iov[1].iov_base = const_cast<char *>(payload);
+    iov[1].iov_len = len;
+
+    // a dead ssh process is reported as EPIPE, not SIGPIPE
+    sigset_t sigpipe, oldmask;
+    sigemptyset(&sigpipe);
+    sigaddset(&sigpipe, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &sigpipe, &oldmask);
+
+    struct iovec *iovp = iov;
+    int iovcnt = len ? 2 : 1;
+    while (iovcnt) {
+        ssize_t ret = writev(m_req->writeEnd(), iovp, iovcnt);
+	if (ret < 0) {
+	    if (errno == EINTR)
+		continue;
+	    int err = errno;
+	    if (err == EPIPE) {
+		struct timespec zero = { 0, 0 };
+		sigtimedwait(&sigpipe, NULL, &zero);
+	    }
+	    pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
+	    if (err == EPIPE)
+		throw KSFTPDisconnect("SFTP connection lost");
 	    throw KSystemError("SFTPTransfer::sendPacket: write failed",
-			       errno);
-	bufp += len;
-	buflen -= len;
+			       err);
+	}
+
+	// skip what has been written
+	while (iovcnt && size_t(ret) >= iovp->iov_len) {
+	    ret -= iovp->iov_len;
+	    ++iovp;
+	    --iovcnt;
+	}
+	if (iovcnt) {
+	    iovp->iov_base = static_cast<char *>(iovp->iov_base) + ret;
+	    iovp->iov_len -= ret;
+	}
     }
+    pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -658,11 +1339,13 @@ void SFTPTransfer::recvBuffer(unsigned char *bufp, size_t buflen)
 {
     while (buflen) {
         ssize_t len = read(m_resp->readEnd(), bufp, buflen);
+	if (len < 0 && errno == EINTR)
+	    continue;
 	if (len < 0)
 	    throw KSystemError("SFTPTransfer::recvPacket: read failed",
 			       errno);
 	else if (!len)
-	    throw KError("SFTPTransfer::recvPacket: unexpected EOF");
+	    throw KSFTPDisconnect("SFTP connection lost");
 
 	bufp += len;
 	buflen -= len;
@@ -20,6 +20,10 @@
 #define SSHTRANSFER_H
 
 #include <memory>
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
 
 #include "global.h"
 #include "stringutil.h"
@@ -27,10 +31,19 @@
 #include "process.h"
 #include "transfer.h"
 
+// OpenSSH sftp-server rejects packets bigger than 256 KiB
+#define SFTP_MAX_CHUNK_KB	252
+
 //{{{ SSHTransfer --------------------------------------------------------------
 
 /**
  * Transfers a file to SSH (upload).
+ *
+ * All files are sent over one connection (an OpenSSH ControlMaster),
+ * which is started in the background when the object is created, so
+ * that the key exchange and authentication do not delay the dump and
+ * are not repeated for each file. Striped transfers use their own
+ * connections, because they are meant to spread the encryption.
  */
 class SSHTransfer : public URLTransfer {
 
@@ -57,10 +70,56 @@ class SSHTransfer : public URLTransfer {
                      const StringVector &target_files,
                      bool *directSave);
 
-    private:
-        char m_buffer[BUFSIZ];
+        /**
+         * Striping is always possible over several ssh connections.
+         *
+         * @see Transfer::canStripe()
+         */
+        bool canStripe()
+        { return true; }
+
+        /**
+         * Sends each stripe over its own ssh process, so that the
+         * encryption runs on several CPUs.
+         *
+         * @see Transfer::performStriped()
+         */
+        void performStriped(DataProvider *dataprovider,
+                            const std::string &target_file,
+                            size_t chunkSize, unsigned streams);
 
-	StringVector makeArgs(std::string const &remote);
+    private:
+        BufferPool::Buffer m_buffer;
+        BufferTuner m_tuner;
+
+	SubProcess m_master;		// ssh -f -N with ControlMaster
+	std::string m_controlPath;
+	bool m_masterChecked;
+	bool m_masterReady;
+	std::string m_sinkOptions;	// extra options of the remote dd
+	bool m_sinkChecked;
+
+	/**
+	 * Wait until the shared connection that has been started by the
+	 * constructor is authenticated. If it has failed, every file gets
+	 * its own connection as before.
+	 */
+	void waitMaster(void);
+
+	/**
+	 * Find out once which options the remote dd accepts: large blocks
+	 * and sparse output (GNU dd), large blocks only (BusyBox), or
+	 * nothing at all.
+	 */
+	void negotiateSink(void);
+
+	std::string remoteSave(const FilePath &fp);
+
+	/**
+	 * @param[in] remote the remote command, none if empty
+	 * @param[in] shared use the shared connection (if it works)
+	 */
+	StringVector makeArgs(std::string const &remote, bool shared = true);
 };
 
 //}}}
@@ -109,6 +168,17 @@ class KSFTPErrorCode : public KErrorCode {
 
 typedef KCodeError<KSFTPErrorCode> KSFTPError;
 
+/**
+ * The connection to the SFTP server has been lost. Unlike KSFTPError,
+ * the transfer can be resumed over a new connection.
+ */
+class KSFTPDisconnect : public KError {
+    public:
+        KSFTPDisconnect(const std::string &msg)
+            : KError(msg)
+        {}
+};
+
 //}}}
 //{{{ SFTPPacket ---------------------------------------------------------------
 
@@ -120,6 +190,7 @@ enum {
     SSH_FXP_VERSION	=   2,
     SSH_FXP_OPEN	=   3,
     SSH_FXP_CLOSE	=   4,
+    SSH_FXP_FSTAT	=   8,
     SSH_FXP_WRITE	=   6,
     SSH_FXP_MKDIR	=  14,
     SSH_FXP_STAT	=  17,
@@ -140,6 +211,13 @@ enum {
     SSH_FXF_EXCL	= 0x00000020,
 };
 
+/**
+ * Attribute flags
+ */
+enum {
+    SSH_FILEXFER_ATTR_SIZE	= 0x00000001,
+};
+
 /**
  * Encode/decode an SFTP packet.
  */
@@ -152,7 +230,15 @@ class SFTPPacket {
 	ByteVector const &data(void) const
 	{ return m_vector; }
 
-	ByteVector const &update(void);
+	/**
+	 * Update the length field at the start of the packet.
+	 *
+	 * @param[in] payload number of bytes that will be sent right
+	 *            after the packet data, without being copied into
+	 *            the packet (see SFTPTransfer::sendPacket())
+	 * @return the packet data
+	 */
+	ByteVector const &update(size_t payload = 0);
 
 	void setData(ByteVector const &val)
 	{
@@ -216,28 +302,206 @@ class SFTPTransfer : public URLTransfer {
                      const StringVector &target_files,
                      bool *directSave);
 
+        /**
+         * Several files can be uploaded at the same time; their
+         * requests share the ssh session.
+         *
+         * @see Transfer::isThreadSafe()
+         */
+        bool isThreadSafe()
+        { return true; }
+
+        /**
+         * Sends the requests for all files without waiting for the
+         * replies in between: the OPEN requests, then the writes, then
+         * the CLOSE requests. If the connection is lost, the files are
+         * uploaded again one by one.
+         *
+         * @see Transfer::performBatch()
+         */
+        void performBatch(const ArtifactBatch &artifacts);
+
     protected:
 	static const int MY_PROTO_VER = 3; // our advertised version
 
+	/**
+	 * A write request that has not been acknowledged yet.
+	 */
+	struct PendingWrite {
+	    off_t off;
+	    size_t len;
+	    BufferPool::Buffer data;
+	};
+
+	/**
+	 * A remote file that is being written.
+	 */
+	struct OpenFile {
+	    std::string path;
+	    std::string handle;
+	    unsigned long session;	// m_session when the handle was opened
+	    unsigned long long acked;	// end of the acknowledged data
+	    unsigned long error;	// status of the first failed write
+
+	    // write requests that have not been replied yet, by id
+	    std::map<unsigned long, PendingWrite> pending;
+
+	    OpenFile(const std::string &file)
+		: path(file), session(0), acked(0), error(SSH_FX_OK)
+	    { }
+	};
+
         bool exists(const std::string &file);
+
+	/**
+	 * Create a directory and all its missing parents. The STAT
+	 * requests for all components are sent at once, and so are the
+	 * MKDIR requests for the missing ones. If the server does not
+	 * create them in order, the failed directories are created again
+	 * one by one.
+	 */
         void mkpath(const std::string &path);
-	std::string createfile(const std::string &file);
+
+	std::string createfile(const std::string &file,
+			       unsigned long flags = SSH_FXF_WRITE |
+			       SSH_FXF_CREAT | SSH_FXF_TRUNC);
 	void closefile(const std::string &handle);
-	void writefile(const std::string &handle, off_t off,
-		       const ByteVector &data);
+
+	/**
+	 * The two halves of createfile() and closefile(), so that several
+	 * requests can be sent before the first reply is read.
+	 *
+	 * @return sendOpen() and sendClose() return the request id
+	 */
+	unsigned long sendOpen(const std::string &file, unsigned long flags);
+	std::string recvHandle(unsigned long id, const std::string &file);
+	unsigned long sendClose(const std::string &handle);
+	void recvClose(unsigned long id, const std::string &handle);
+
+	/**
+	 * Returns the size of an open file.
+	 */
+	unsigned long long filesize(const std::string &handle);
+
+	/**
+	 * Open @p file.path and bind its handle to the current session.
+	 */
+	void openfile(OpenFile &file, unsigned long flags);
+
+	/**
+	 * Send a write request without waiting for the reply.
+	 * If there are already too many requests in flight (for any
+	 * file), wait for replies first.
+	 *
+	 * The buffer is kept until the write is acknowledged, so that
+	 * it can be sent again after a reconnect; @p data is replaced
+	 * with a free buffer of the same size.
+	 *
+	 * @exception KError if an earlier write to @p file failed
+	 */
+	void writefile(OpenFile &file, off_t off,
+		       BufferPool::Buffer &data, size_t len);
+
+	/**
+	 * Receive one reply. Replies to write requests are matched with
+	 * their file, all others are kept for recvReply().
+	 */
+	void waitwrite(void);
+
+	/**
+	 * Wait for replies to all outstanding writes to @p file.
+	 *
+	 * @exception KError if a write failed
+	 */
+	void flushwrites(OpenFile &file);
+
+	/**
+	 * Drop the outstanding writes to @p file; their replies are
+	 * ignored when they arrive.
+	 */
+	void forget(OpenFile &file);
+
+	/**
+	 * Run @p fn, and if the connection is lost, connect again
+	 * (at most KDUMP_TRANSFER_RETRIES times for each file), reopen
+	 * @p file and send all writes that have not been acknowledged.
+	 * The same happens if another file has reconnected since
+	 * @p file was opened.
+	 *
+	 * @param[in,out] file the remote file
+	 * @param[in,out] retries the remaining reconnects
+	 * @param[in] fn the operation
+	 */
+	template<typename Fn>
+	void resumable(OpenFile &file, int &retries, Fn fn);
+
+	/**
+	 * The upload loop of perform() for a Read policy that copies
+	 * the data (see pipeloop.h). The policy is picked once per file.
+	 */
+	template<typename Read>
+	void uploadLoop(DataProvider *dataprovider, OpenFile &file,
+			int &retries, TransferMeter &meter);
 
     private:
+	/**
+	 * A reply that has arrived before it was asked for.
+	 */
+	struct Reply {
+	    unsigned char type;
+	    SFTPPacket pkt;
+	};
+
 	SubProcess m_process;
         std::shared_ptr<SubProcessPipe> m_req, m_resp;
 	unsigned long m_proto_ver; // remote SFTP protocol version
 	unsigned long m_lastid;
+	unsigned long m_session;	// incremented by each reconnect
+
+	// one request and its reply at a time; data is read unlocked
+	std::mutex m_mutex;
+
+	// outstanding write requests of all files, by id
+	std::map<unsigned long, OpenFile *> m_writes;
+	std::set<unsigned long> m_ignored;	// see forget()
+	std::map<unsigned long, Reply> m_replies;
+	std::vector<BufferPool::Buffer> m_spare; // acknowledged buffers
+	size_t m_window;	// maximum number of pending writes
+	size_t m_chunkSize;	// data size of one write request
 
+	void connect(void);
+	void reconnect(void);
 	StringVector makeArgs(void);
 
 	unsigned long nextId(void)
 	{ return m_lastid = (m_lastid + 1) & ((1UL << 32) - 1); }
 
-	void sendPacket(SFTPPacket &pkt);
+	/**
+	 * Send a request whose only argument is a path (STAT, MKDIR).
+	 *
+	 * @return the request id
+	 */
+	unsigned long sendPath(unsigned char type, const std::string &path);
+
+	/**
+	 * Wait for the reply to request @p id. Write replies that arrive
+	 * in the meantime are processed.
+	 *
+	 * @return the reply type; @p pkt is positioned after the id
+	 */
+	unsigned char recvReply(unsigned long id, SFTPPacket &pkt);
+
+	/**
+	 * Wait for the status reply to request @p id. An SSH_FXP_ATTRS
+	 * reply counts as SSH_FX_OK.
+	 *
+	 * @param[in] request the request name for error messages
+	 * @return the status code
+	 */
+	unsigned long recvStatus(unsigned long id, const char *request);
+
+	void sendPacket(SFTPPacket &pkt,
+			const char *payload = NULL, size_t len = 0);
 	void recvPacket(SFTPPacket &pkt);
 	void recvBuffer(unsigned char *bufp, size_t buflen);
 };
@@ -0,0 +1,354 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "global.h"
+#include "debug.h"
+#include "stringutil.h"
+#include "streamrecord.h"
+
+using std::string;
+using std::cerr;
+using std::endl;
+
+#define TIMING_SUFFIX       ".timing"
+#define TIMING_HEADER       "# kdump stream timing: usec bytes"
+
+//{{{ RecordingDataProvider ----------------------------------------------------
+
+// -----------------------------------------------------------------------------
+RecordingDataProvider::RecordingDataProvider(DataProvider *forward,
+                                             const string &path)
+    : m_forward(forward), m_path(path), m_fd(-1), m_timing(NULL),
+      m_recorded(0)
+{}
+
+// -----------------------------------------------------------------------------
+RecordingDataProvider::~RecordingDataProvider()
+{
+    if (m_fd >= 0)
+        close(m_fd);
+    if (m_timing)
+        fclose(m_timing);
+}
+
+// -----------------------------------------------------------------------------
+void RecordingDataProvider::prepare()
+{
+    KTRACE("RecordingDataProvider::prepare(): %s", m_path.c_str());
+
+    m_recorded = 0;
+    m_chunks.reset();
+    m_fd = open(m_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                0600);
+    if (m_fd < 0) {
+        stopRecording("open");
+    } else {
+        string timing = m_path + TIMING_SUFFIX;
+        m_timing = fopen(timing.c_str(), "we");
+        if (!m_timing)
+            stopRecording("open");
+        else
+            fprintf(m_timing, "%s\n", TIMING_HEADER);
+    }
+
+    m_forward->prepare();
+    m_start = Clock::now();
+}
+
+// -----------------------------------------------------------------------------
+void RecordingDataProvider::stopRecording(const char *what)
+{
+    cerr << "WARNING: Cannot " << what << " " << m_path << ": "
+         << strerror(errno) << ", the stream is not recorded." << endl;
+
+    if (m_fd >= 0)
+        close(m_fd);
+    m_fd = -1;
+    if (m_timing)
+        fclose(m_timing);
+    m_timing = NULL;
+}
+
+// -----------------------------------------------------------------------------
+void RecordingDataProvider::record(const char *data, size_t len)
+{
+    if (m_fd < 0 || len == 0)
+        return;
+
+    unsigned long long usec =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - m_start).count();
+
+    size_t done = 0;
+    while (done < len) {
+        ssize_t ret = write(m_fd, data + done, len - done);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0) {
+            stopRecording("write");
+            return;
+        }
+        done += ret;
+    }
+    if (fprintf(m_timing, "%llu %zu\n", usec, len) < 0) {
+        stopRecording("write the timing of");
+        return;
+    }
+    m_recorded += len;
+}
+
+// -----------------------------------------------------------------------------
+bool RecordingDataProvider::canSaveToFile() const
+{
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+void RecordingDataProvider::saveToFile(const StringVector &targets)
+{
+    throw KError("RecordingDataProvider::saveToFile() not implemented.");
+}
+
+// -----------------------------------------------------------------------------
+size_t RecordingDataProvider::getData(char *buffer, size_t maxread)
+{
+    size_t ret = m_forward->getData(buffer, maxread);
+    record(buffer, ret);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+bool RecordingDataProvider::canSplice() const
+{
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+size_t RecordingDataProvider::spliceData(int fd)
+{
+    throw KError("RecordingDataProvider::spliceData() not implemented.");
+}
+
+// -----------------------------------------------------------------------------
+bool RecordingDataProvider::canMapData() const
+{
+    return m_forward->canMapData();
+}
+
+// -----------------------------------------------------------------------------
+size_t RecordingDataProvider::mapData(const char **data, size_t maxread)
+{
+    size_t ret = m_forward->mapData(data, maxread);
+    record(*data, ret);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+bool RecordingDataProvider::canPlaceData() const
+{
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+size_t RecordingDataProvider::getPlacedData(char *buffer, size_t maxread,
+                                            off_t *offset)
+{
+    throw KError("RecordingDataProvider::getPlacedData() not implemented.");
+}
+
+// -----------------------------------------------------------------------------
+size_t RecordingDataProvider::getChunk(DataChunk &chunk, size_t maxread)
+{
+    return m_chunks.get(this, chunk, maxread);
+}
+
+// -----------------------------------------------------------------------------
+void RecordingDataProvider::finish()
+{
+    m_forward->finish();
+
+    if (m_fd >= 0 && close(m_fd) != 0) {
+        m_fd = -1;
+        stopRecording("close");
+    }
+    m_fd = -1;
+    if (m_timing && fclose(m_timing) != 0) {
+        m_timing = NULL;
+        stopRecording("close the timing of");
+    }
+    m_timing = NULL;
+    KDBG("Recorded %llu bytes to %s", m_recorded, m_path.c_str());
+}
+
+// -----------------------------------------------------------------------------
+void RecordingDataProvider::setError(bool error)
+{
+    m_forward->setError(error);
+}
+
+// -----------------------------------------------------------------------------
+void RecordingDataProvider::setProgress(Progress *progress)
+{
+    m_forward->setProgress(progress);
+}
+
+// -----------------------------------------------------------------------------
+bool RecordingDataProvider::canRestart() const
+{
+    return m_forward->canRestart();
+}
+
+//}}}
+//{{{ ReplayDataProvider -------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+ReplayDataProvider::ReplayDataProvider(const string &path, bool realtime)
+    : m_path(path), m_realtime(realtime), m_fd(-1), m_chunk(0),
+      m_chunkLeft(0), m_produced(0), m_pending(false)
+{}
+
+// -----------------------------------------------------------------------------
+ReplayDataProvider::~ReplayDataProvider()
+{
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+// -----------------------------------------------------------------------------
+void ReplayDataProvider::readTiming()
+{
+    string timing = m_path + TIMING_SUFFIX;
+    FILE *fp = fopen(timing.c_str(), "re");
+    if (!fp) {
+        if (m_realtime)
+            throw KSystemError("Cannot open " + timing, errno);
+        KDBG("No timing in %s, replaying at full speed", timing.c_str());
+        return;
+    }
+
+    char line[128];
+    unsigned lineno = 0;
+    while (fgets(line, sizeof line, fp)) {
+        ++lineno;
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+        Chunk chunk;
+        if (sscanf(line, "%llu %zu", &chunk.usec, &chunk.size) != 2) {
+            fclose(fp);
+            throw KError(timing + ":" + StringUtil::number2string(lineno) +
+                         ": Invalid timing");
+        }
+        m_chunks.push_back(chunk);
+    }
+    fclose(fp);
+}
+
+// -----------------------------------------------------------------------------
+void ReplayDataProvider::prepare()
+{
+    KTRACE("ReplayDataProvider::prepare(): %s", m_path.c_str());
+
+    m_fd = open(m_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0)
+        throw KSystemError("Cannot open " + m_path, errno);
+
+    m_chunks.clear();
+    readTiming();
+    m_chunk = 0;
+    m_chunkLeft = m_chunks.empty() ? 0 : m_chunks[0].size;
+    m_produced = 0;
+    m_latencies.clear();
+    m_pending = false;
+
+    AbstractDataProvider::prepare();
+    m_start = Clock::now();
+}
+
+// -----------------------------------------------------------------------------
+double ReplayDataProvider::duration() const
+{
+    if (m_chunks.empty())
+        return 0.0;
+    return m_chunks.back().usec / 1000000.0;
+}
+
+// -----------------------------------------------------------------------------
+size_t ReplayDataProvider::getData(char *buffer, size_t maxread)
+{
+    // the previous chunk has been written
+    Clock::time_point now = Clock::now();
+    if (m_pending)
+        m_latencies.push_back(
+            std::chrono::duration<double>(now - m_last).count());
+
+    size_t len = maxread;
+    if (!m_chunks.empty()) {
+        if (m_chunkLeft == 0 && m_chunk < m_chunks.size()) {
+            if (++m_chunk < m_chunks.size())
+                m_chunkLeft = m_chunks[m_chunk].size;
+        }
+        if (m_chunk >= m_chunks.size()) {
+            m_pending = false;
+            return 0;
+        }
+        len = std::min(len, m_chunkLeft);
+
+        // a chunk is not available before its time in the recording
+        if (m_realtime && m_chunkLeft == m_chunks[m_chunk].size)
+            std::this_thread::sleep_until(m_start +
+                std::chrono::microseconds(m_chunks[m_chunk].usec));
+    }
+
+    ssize_t ret;
+    do {
+        ret = read(m_fd, buffer, len);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0)
+        throw KSystemError("Cannot read " + m_path, errno);
+    if (ret == 0 && m_chunk < m_chunks.size())
+        KDBG("%s ends before the recorded chunk %zu", m_path.c_str(),
+             m_chunk);
+
+    m_chunkLeft -= std::min(m_chunkLeft, size_t(ret));
+    m_produced += ret;
+    m_pending = ret > 0;
+    m_last = Clock::now();
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void ReplayDataProvider::finish()
+{
+    if (m_fd >= 0)
+        close(m_fd);
+    m_fd = -1;
+    AbstractDataProvider::finish();
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
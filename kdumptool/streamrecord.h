@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef STREAMRECORD_H
+#define STREAMRECORD_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "global.h"
+#include "dataprovider.h"
+
+//{{{ RecordingDataProvider ----------------------------------------------------
+
+/**
+ * DataProvider that forwards the data of another DataProvider and saves
+ * a copy of it, so that the stream can be replayed later with
+ * ReplayDataProvider.
+ *
+ * The data goes to the file given in the constructor. A second file with
+ * the suffix ".timing" gets one line for each chunk: the time in
+ * microseconds since DataProvider::prepare() at which the chunk was
+ * available, and its size in bytes.
+ *
+ * The recording must not break the dump: if a file cannot be written,
+ * a warning is printed and the recording stops, but the data is still
+ * passed on. Because all data has to pass through getData() or
+ * mapData(), the fast paths saveToFile() and spliceData() are disabled.
+ */
+class RecordingDataProvider : public DataProvider {
+
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        /**
+         * Wraps a DataProvider.
+         *
+         * @param[in] forward the DataProvider that provides the data
+         * @param[in] path the file for the copy of the data
+         */
+        RecordingDataProvider(DataProvider *forward, const std::string &path);
+
+        /**
+         * Closes the recording if it is still open.
+         */
+        ~RecordingDataProvider();
+
+        void prepare();
+
+        /**
+         * Returns @c false.
+         */
+        bool canSaveToFile() const;
+
+        void saveToFile(const StringVector &targets);
+        size_t getData(char *buffer, size_t maxread);
+
+        /**
+         * Returns @c false.
+         */
+        bool canSplice() const;
+
+        size_t spliceData(int fd);
+        bool canMapData() const;
+        size_t mapData(const char **data, size_t maxread);
+
+        /**
+         * Returns @c false; the recording is the stream itself.
+         */
+        bool canPlaceData() const;
+
+        size_t getPlacedData(char *buffer, size_t maxread, off_t *offset);
+        size_t getChunk(DataChunk &chunk, size_t maxread);
+        void finish();
+        void setError(bool error);
+        void setProgress(Progress *progress);
+        bool canRestart() const;
+
+        /**
+         * Returns the number of bytes that have been recorded.
+         */
+        unsigned long long recorded() const
+        { return m_recorded; }
+
+    private:
+        void record(const char *data, size_t len);
+        void stopRecording(const char *what);
+
+        DataProvider *m_forward;
+        std::string m_path;
+        int m_fd;
+        FILE *m_timing;
+        Clock::time_point m_start;
+        unsigned long long m_recorded;
+        ChunkAdapter m_chunks;
+};
+
+//}}}
+//{{{ ReplayDataProvider -------------------------------------------------------
+
+/**
+ * DataProvider that plays back a stream saved by RecordingDataProvider.
+ *
+ * The data is returned in the recorded chunks. In real time mode each
+ * chunk is only returned when it was available in the recording, so the
+ * target sees the same bursts as during the original dump; otherwise the
+ * data is returned as fast as the target takes it. Note that the recorded
+ * times include the waits for the original target.
+ *
+ * Like SyntheticDataProvider, it records the time between two calls to
+ * getData(), i.e. the time the target needed for a chunk.
+ */
+class ReplayDataProvider : public AbstractDataProvider {
+
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        /**
+         * Creates a new ReplayDataProvider object.
+         *
+         * @param[in] path the file written by RecordingDataProvider
+         * @param[in] realtime @c true to keep the recorded timing
+         */
+        ReplayDataProvider(const std::string &path, bool realtime);
+
+        /**
+         * Closes the recording if it is still open.
+         */
+        ~ReplayDataProvider();
+
+        /**
+         * Opens the recording and reads the timing file.
+         *
+         * @exception KError if the recording cannot be opened, or if the
+         *            timing file is missing in real time mode
+         */
+        void prepare();
+
+        size_t getData(char *buffer, size_t maxread);
+        void finish();
+
+        /**
+         * Returns the number of recorded chunks (zero if the timing file
+         * has not been read or is missing).
+         */
+        size_t chunks() const
+        { return m_chunks.size(); }
+
+        /**
+         * Returns the recorded duration in seconds.
+         */
+        double duration() const;
+
+        /**
+         * Returns the number of bytes returned by getData() so far.
+         */
+        unsigned long long produced() const
+        { return m_produced; }
+
+        /**
+         * Returns the time in seconds between the chunks, in the order
+         * they have been requested.
+         */
+        const std::vector<double> &latencies() const
+        { return m_latencies; }
+
+    private:
+        struct Chunk {
+            unsigned long long usec;        // time since the start
+            size_t size;
+        };
+
+        void readTiming();
+
+        std::string m_path;
+        bool m_realtime;
+        int m_fd;
+        std::vector<Chunk> m_chunks;
+        size_t m_chunk;                     // current chunk
+        size_t m_chunkLeft;                 // bytes left in the chunk
+        Clock::time_point m_start;
+
+        unsigned long long m_produced;
+        std::vector<double> m_latencies;
+        Clock::time_point m_last;           // end of the last getData()
+        bool m_pending;                     // a chunk is being written
+};
+
+//}}}
+
+#endif /* STREAMRECORD_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
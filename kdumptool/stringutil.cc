@@ -22,6 +22,7 @@
 #include <sstream>
 #include <iomanip>
 #include <ctime>
+#include <cstdio>
 
 #include "stringutil.h"
 #include "global.h"
@@ -55,6 +56,26 @@ int StringUtil::hex2int(char c)
     throw KError(string("StringUtil::hex2int: '") + c + "' is not a hex digit");
 }
 
+// -----------------------------------------------------------------------------
+string StringUtil::jsonString(const string &s)
+{
+    string ret("\"");
+    for (string::const_iterator it = s.begin(); it != s.end(); ++it) {
+        unsigned char c = *it;
+        if (c == '"' || c == '\\') {
+            ret += '\\';
+            ret += c;
+        } else if (c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof buf, "\\u%04x", c);
+            ret += buf;
+        } else
+            ret += c;
+    }
+    ret += '"';
+    return ret;
+}
+
 //}}}
 //{{{ KString ------------------------------------------------------------------
 
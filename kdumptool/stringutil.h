@@ -66,6 +66,15 @@ class StringUtil {
                                           time_t value);
 
 	static int hex2int(char c);
+
+        /**
+         * Quotes a string for JSON.
+         *
+         * @param[in] s the string
+         * @return @p s in double quotes, with the special characters
+         *         escaped
+         */
+        static std::string jsonString(const std::string &s);
 };
 
 //}}}
@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cerrno>
+#include <algorithm>
+#include <sstream>
+
+#include <unistd.h>
+
+#include "global.h"
+#include "debug.h"
+#include "util.h"
+#include "dataprovider.h"
+#include "spaceguard.h"
+#include "savestats.h"
+#include "stripewriter.h"
+
+using std::string;
+using std::endl;
+
+//{{{ StripeWriter -------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+StripeWriter::StripeWriter(int fd, const string &name, size_t chunkSize,
+                           size_t blockSize, SpaceGuard *guard)
+    : m_fd(fd), m_name(name), m_blockSize(blockSize), m_offset(0),
+      m_guard(guard), m_done(false)
+{
+    try {
+        for (int i = 0; i < STRIPE_BUFFERS; ++i) {
+            m_buffers.push_back(BufferPool::pool()->get(chunkSize));
+            m_free.push_back(m_buffers.back().get());
+        }
+
+        m_thread = std::thread(&StripeWriter::run, this);
+    } catch (...) {
+        ::close(m_fd);
+        throw;
+    }
+}
+
+// -----------------------------------------------------------------------------
+StripeWriter::~StripeWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.clear();
+        m_done = true;
+    }
+    m_cond.notify_all();
+    if (m_thread.joinable())
+        m_thread.join();
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+// -----------------------------------------------------------------------------
+void StripeWriter::rethrow()
+{
+    if (m_error) {
+        std::exception_ptr error = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+// -----------------------------------------------------------------------------
+char *StripeWriter::getBuffer()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait(lock, [this]{ return !m_free.empty() || m_error; });
+    rethrow();
+
+    char *buf = m_free.front();
+    m_free.pop_front();
+    return buf;
+}
+
+// -----------------------------------------------------------------------------
+void StripeWriter::queue(char *buf, size_t len)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(std::make_pair(buf, len));
+    }
+    m_cond.notify_all();
+}
+
+// -----------------------------------------------------------------------------
+void StripeWriter::finish()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_done = true;
+    }
+    m_cond.notify_all();
+    m_thread.join();
+    rethrow();
+
+    // the file size is not extended by skipped blocks at the end
+    if (m_blockSize && ftruncate(m_fd, m_offset) != 0)
+        throw KSystemError("Unable to set the file size of " + m_name, errno);
+
+    int fd = m_fd;
+    m_fd = -1;
+    if (::close(fd) != 0)
+        throw KSystemError("Error in close for " + m_name, errno);
+}
+
+// -----------------------------------------------------------------------------
+void StripeWriter::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_cond.wait(lock, [this]{ return !m_queue.empty() || m_done; });
+        if (m_queue.empty())
+            break;
+
+        std::pair<char *, size_t> chunk = m_queue.front();
+        lock.unlock();
+        try {
+            writeChunk(chunk.first, chunk.second);
+        } catch (...) {
+            lock.lock();
+            m_error = std::current_exception();
+            m_queue.clear();
+            m_cond.notify_all();
+            break;
+        }
+        lock.lock();
+        m_queue.pop_front();
+        m_free.push_back(chunk.first);
+        m_cond.notify_all();
+    }
+}
+
+// -----------------------------------------------------------------------------
+void StripeWriter::writeChunk(const char *buf, size_t len)
+{
+    size_t pos = 0;
+    size_t granted = 0;     // bytes accounted with m_guard
+    while (pos < len) {
+        size_t n = len - pos;
+        if (m_blockSize) {
+            n = std::min(m_blockSize, n);
+            if (n == m_blockSize && Util::isZero(buf + pos, n)) {
+                pos += n;
+                granted = std::max(granted, pos);
+                continue;
+            }
+        }
+
+        if (m_guard && granted < pos + n) {
+            size_t need = pos + n - granted;
+            if (m_guard->allow(need) < need)
+                m_guard->check();
+            granted = pos + n;
+        }
+
+        ssize_t ret;
+        if (m_blockSize)
+            ret = pwrite(m_fd, buf + pos, n, m_offset + pos);
+        else
+            ret = write(m_fd, buf + pos, n);
+
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            throw KSystemError("Error in write for " + m_name, errno);
+        }
+        if (ret == 0)
+            throw KError("Cannot write to " + m_name + ".");
+        pos += ret;
+    }
+    m_offset += len;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long StripeWriter::distribute(DataProvider *dataprovider,
+                                            Vector &writers,
+                                            size_t chunkSize,
+                                            TransferMeter &meter)
+{
+    unsigned long long total = 0;
+
+    for (size_t i = 0; ; i = (i + 1) % writers.size()) {
+        char *buf = meter.sink([&]() { return writers[i]->getBuffer(); });
+        size_t read_data = 0;
+        while (read_data < chunkSize) {
+            size_t ret = meter.source([&]() {
+                    return dataprovider->getData(buf + read_data,
+                                                 chunkSize - read_data);
+                });
+            if (ret == 0)
+                break;
+            read_data += ret;
+        }
+        meter.moved(read_data);
+
+        if (read_data)
+            writers[i]->queue(buf, read_data);
+        total += read_data;
+
+        // finished?
+        if (read_data < chunkSize)
+            break;
+    }
+
+    return total;
+}
+
+// -----------------------------------------------------------------------------
+string StripeWriter::map(size_t chunkSize, unsigned long long total,
+                         const StringVector &stripes)
+{
+    std::ostringstream ss;
+
+    ss << "# kdump stripe map" << endl;
+    ss << "chunk_size " << chunkSize << endl;
+    ss << "total_size " << total << endl;
+
+    StringVector::const_iterator it;
+    for (it = stripes.begin(); it != stripes.end(); ++it)
+        ss << "stripe " << *it << endl;
+
+    return ss.str();
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
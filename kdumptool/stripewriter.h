@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef STRIPEWRITER_H
+#define STRIPEWRITER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <sys/types.h>
+
+#include "stringvector.h"
+#include "bufferpool.h"
+
+class DataProvider;
+class SpaceGuard;
+class TransferMeter;
+
+// chunk size for the STRIPE flag
+#define STRIPE_CHUNK_SIZE	(4*1024*1024)
+
+// number of chunk buffers per writer thread
+#define STRIPE_BUFFERS		2
+
+//{{{ StripeWriter -------------------------------------------------------------
+
+/**
+ * Writes one stripe of a striped dump in a separate thread.
+ *
+ * The main thread takes a free buffer with getBuffer(), fills it with
+ * one chunk and hands it over with queue(). The writer thread stores
+ * the chunks sequentially. Errors of the writer thread are reported by
+ * the next call to getBuffer() or finish().
+ *
+ * A stripe is either a regular file, where zero blocks can be skipped,
+ * or a pipe (e.g. to ssh), which is written strictly sequentially.
+ */
+class StripeWriter {
+
+    public:
+
+        typedef std::vector<std::unique_ptr<StripeWriter>> Vector;
+
+        /**
+         * Starts the writer thread.
+         *
+         * @param[in] fd file descriptor open for writing; the object
+         *            takes ownership and closes it
+         * @param[in] name name of the stripe (for error messages)
+         * @param[in] chunkSize size of the chunk buffers
+         * @param[in] blockSize zero blocks of this size are skipped,
+         *            or 0 to write everything sequentially
+         * @param[in] guard stops the writer when the free space runs
+         *            out (KNoSpaceError), or @c NULL; the object takes
+         *            ownership
+         */
+        StripeWriter(int fd, const std::string &name, size_t chunkSize,
+                     size_t blockSize, SpaceGuard *guard = NULL);
+
+        /**
+         * Discards all queued chunks, stops the thread and closes the
+         * file descriptor.
+         */
+        ~StripeWriter();
+
+        /**
+         * Returns a free chunk buffer, waiting if all buffers are queued.
+         *
+         * @exception KError if a previous write has failed
+         */
+        char *getBuffer();
+
+        /**
+         * Queues a buffer returned by getBuffer() for writing.
+         */
+        void queue(char *buf, size_t len);
+
+        /**
+         * Writes all queued chunks and closes the file descriptor.
+         *
+         * @exception KError if a write has failed
+         */
+        void finish();
+
+        /**
+         * Reads all data from a DataProvider and distributes it
+         * round-robin in chunks over the writers. The caller must
+         * prepare and finish the DataProvider and call finish() for
+         * each writer.
+         *
+         * @param[in] meter accounts the reads and the waits for a free
+         *            buffer
+         * @return the total number of bytes
+         * @exception KError on any error
+         */
+        static unsigned long long distribute(DataProvider *dataprovider,
+                                             Vector &writers,
+                                             size_t chunkSize,
+                                             TransferMeter &meter);
+
+        /**
+         * Formats the chunk map for unstripe.pl.
+         *
+         * @param[in] chunkSize chunk size in bytes
+         * @param[in] total total data size in bytes
+         * @param[in] stripes paths of the stripes, in round-robin order
+         */
+        static std::string map(size_t chunkSize, unsigned long long total,
+                               const StringVector &stripes);
+
+    private:
+        void run();
+        void writeChunk(const char *buf, size_t len);
+        void rethrow();
+
+        int m_fd;
+        std::string m_name;
+        size_t m_blockSize;
+        off_t m_offset;
+        std::unique_ptr<SpaceGuard> m_guard;
+
+        std::vector<BufferPool::Buffer> m_buffers;
+        std::deque<char *> m_free;
+        std::deque<std::pair<char *, size_t>> m_queue;
+        bool m_done;
+        std::exception_ptr m_error;
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::thread m_thread;
+};
+
+//}}}
+
+#endif /* STRIPEWRITER_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
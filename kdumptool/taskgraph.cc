@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <algorithm>
+#include <thread>
+
+#include "global.h"
+#include "debug.h"
+#include "taskgraph.h"
+
+using std::string;
+
+//{{{ TaskGraph ----------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+TaskGraph::TaskGraph(unsigned threads)
+    : m_threads(std::max(threads, 1U)), m_finished(0), m_aborted(false)
+{}
+
+// -----------------------------------------------------------------------------
+size_t TaskGraph::add(const string &name, const Function &fn,
+                      const std::vector<size_t> &deps, bool always)
+{
+    // only earlier tasks can be dependencies, so there are no cycles
+    std::vector<size_t>::const_iterator it;
+    for (it = deps.begin(); it != deps.end(); ++it)
+        if (*it >= m_tasks.size())
+            throw KError("Task " + name + " depends on an unknown task.");
+
+    Task task;
+    task.name = name;
+    task.fn = fn;
+    task.deps = deps;
+    task.always = always;
+    task.state = Task::PENDING;
+    task.skipped = false;
+    m_tasks.push_back(task);
+    return m_tasks.size() - 1;
+}
+
+// -----------------------------------------------------------------------------
+void TaskGraph::abort()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_aborted = true;
+}
+
+// -----------------------------------------------------------------------------
+bool TaskGraph::skipped(size_t task) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_tasks.at(task).skipped;
+}
+
+// -----------------------------------------------------------------------------
+bool TaskGraph::ready(const Task &task) const
+{
+    std::vector<size_t>::const_iterator it;
+    for (it = task.deps.begin(); it != task.deps.end(); ++it)
+        if (m_tasks[*it].state != Task::FINISHED)
+            return false;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+void TaskGraph::run()
+{
+    m_finished = 0;
+    m_error = nullptr;
+
+    size_t count = std::min<size_t>(m_threads, m_tasks.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < count; ++i)
+        threads.emplace_back(&TaskGraph::worker, this);
+
+    std::vector<std::thread>::iterator it;
+    for (it = threads.begin(); it != threads.end(); ++it)
+        it->join();
+
+    if (m_error)
+        std::rethrow_exception(m_error);
+}
+
+// -----------------------------------------------------------------------------
+void TaskGraph::worker()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        std::vector<Task>::iterator it;
+        m_cond.wait(lock, [this, &it]{
+                if (m_finished == m_tasks.size())
+                    return true;
+                for (it = m_tasks.begin(); it != m_tasks.end(); ++it)
+                    if (it->state == Task::PENDING && ready(*it))
+                        return true;
+                return false;
+            });
+        if (m_finished == m_tasks.size())
+            break;
+
+        Task &task = *it;
+        if (m_aborted && !task.always) {
+            Debug::debug()->dbg("Skipping task %s", task.name.c_str());
+            task.skipped = true;
+        } else {
+            task.state = Task::RUNNING;
+            lock.unlock();
+
+            Debug::debug()->dbg("Starting task %s", task.name.c_str());
+            std::exception_ptr error;
+            try {
+                task.fn();
+            } catch (...) {
+                error = std::current_exception();
+            }
+            Debug::debug()->dbg("Finished task %s", task.name.c_str());
+
+            lock.lock();
+            if (error) {
+                if (!m_error)
+                    m_error = error;
+                m_aborted = true;
+            }
+        }
+
+        task.state = Task::FINISHED;
+        ++m_finished;
+        m_cond.notify_all();
+    }
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef TASKGRAPH_H
+#define TASKGRAPH_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include "global.h"
+
+//{{{ TaskGraph ----------------------------------------------------------------
+
+/**
+ * Runs a set of tasks with a pool of threads. A task starts when all
+ * tasks it depends on have finished, so tasks without a dependency
+ * between them run concurrently.
+ *
+ * Dependencies only order the tasks: a task runs even if one of its
+ * dependencies has failed. The tasks handle their own errors; an
+ * exception that escapes a task aborts the graph and is re-thrown by
+ * run().
+ */
+class TaskGraph {
+
+    public:
+        typedef std::function<void()> Function;
+
+        /**
+         * Creates an empty graph.
+         *
+         * @param[in] threads maximum number of tasks that run at once
+         */
+        TaskGraph(unsigned threads);
+
+        /**
+         * Adds a task.
+         *
+         * @param[in] name name of the task (for debugging)
+         * @param[in] fn the function that performs the task
+         * @param[in] deps tasks that must finish before this one starts
+         * @param[in] always run the task even after abort()
+         * @return the ID of the task
+         * @exception KError if @p deps contains an unknown ID
+         */
+        size_t add(const std::string &name, const Function &fn,
+                   const std::vector<size_t> &deps = std::vector<size_t>(),
+                   bool always = false);
+
+        /**
+         * Skips all tasks that have not started yet, except those that
+         * have been added with @c always. May be called from a task.
+         */
+        void abort();
+
+        /**
+         * Runs all tasks and waits until they have finished.
+         *
+         * @exception std::exception the first exception that escaped a task
+         */
+        void run();
+
+        /**
+         * Returns @c true if the task was skipped because of abort().
+         */
+        bool skipped(size_t task) const;
+
+    private:
+        struct Task {
+            std::string name;
+            Function fn;
+            std::vector<size_t> deps;
+            bool always;
+            enum { PENDING, RUNNING, FINISHED } state;
+            bool skipped;
+        };
+
+        bool ready(const Task &task) const;
+        void worker();
+
+        std::vector<Task> m_tasks;
+        unsigned m_threads;
+        size_t m_finished;
+        bool m_aborted;
+        std::exception_ptr m_error;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cond;
+};
+
+//}}}
+
+#endif /* TASKGRAPH_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,401 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "global.h"
+#include "debug.h"
+#include "dataprovider.h"
+#include "teetransfer.h"
+
+using std::string;
+using std::cerr;
+using std::endl;
+
+// size of the buffers that are passed to the legs
+#define TEE_BUFFER_SIZE		(1024*1024)
+
+typedef std::shared_ptr<std::vector<char>> TeeBuffer;
+
+//{{{ TeeLeg -------------------------------------------------------------------
+
+/**
+ * One child transfer of a TeeTransfer. The object is the DataProvider
+ * for the child transfer, which runs in a separate thread.
+ */
+class TeeLeg : public AbstractDataProvider {
+
+    public:
+        TeeLeg(Transfer *transfer, const string &name, size_t maxQueue);
+        ~TeeLeg();
+
+        const string &name() const
+        { return m_name; }
+
+        bool failed() const
+        { return m_failed; }
+
+        const string &error() const
+        { return m_error; }
+
+        Transfer *transfer() const
+        { return m_transfer.get(); }
+
+        /**
+         * Starts the child transfer in a new thread.
+         */
+        void start(const StringVector &target_files);
+
+        /**
+         * Starts Transfer::performBatch() of the child transfer in a
+         * new thread. Wait for it with stop().
+         */
+        void startBatch(const ArtifactBatch &artifacts);
+
+        /**
+         * Queues a buffer, waiting while the queue is full.
+         *
+         * @return @c false if the leg has failed
+         */
+        bool push(const TeeBuffer &buf);
+
+        /**
+         * Signals the end of the data (or an error if @p abort is set)
+         * and waits for the thread.
+         */
+        void stop(bool abort);
+
+        size_t getData(char *buffer, size_t maxread);
+
+    private:
+        void run(StringVector target_files);
+        void runBatch(const ArtifactBatch *artifacts);
+
+        /**
+         * Records the error of the child transfer.
+         */
+        void fail(const std::exception &ex);
+
+        std::unique_ptr<Transfer> m_transfer;
+        string m_name;
+        size_t m_maxQueue;
+
+        std::deque<TeeBuffer> m_queue;
+        size_t m_offset;
+        bool m_eof;
+        bool m_abort;
+        bool m_failed;
+        string m_error;
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::thread m_thread;
+};
+
+// -----------------------------------------------------------------------------
+TeeLeg::TeeLeg(Transfer *transfer, const string &name, size_t maxQueue)
+    : m_transfer(transfer), m_name(name), m_maxQueue(maxQueue),
+      m_offset(0), m_eof(false), m_abort(false), m_failed(false)
+{}
+
+// -----------------------------------------------------------------------------
+TeeLeg::~TeeLeg()
+{
+    if (m_thread.joinable())
+        stop(true);
+}
+
+// -----------------------------------------------------------------------------
+void TeeLeg::start(const StringVector &target_files)
+{
+    m_queue.clear();
+    m_offset = 0;
+    m_eof = m_abort = false;
+    m_thread = std::thread(&TeeLeg::run, this, target_files);
+}
+
+// -----------------------------------------------------------------------------
+void TeeLeg::startBatch(const ArtifactBatch &artifacts)
+{
+    m_queue.clear();
+    m_offset = 0;
+    m_eof = m_abort = false;
+    m_thread = std::thread(&TeeLeg::runBatch, this, &artifacts);
+}
+
+// -----------------------------------------------------------------------------
+bool TeeLeg::push(const TeeBuffer &buf)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait(lock, [this]{
+            return m_queue.size() < m_maxQueue || m_failed;
+        });
+    if (m_failed)
+        return false;
+
+    m_queue.push_back(buf);
+    m_cond.notify_all();
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+void TeeLeg::stop(bool abort)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_eof = true;
+        m_abort = abort;
+    }
+    m_cond.notify_all();
+    m_thread.join();
+}
+
+// -----------------------------------------------------------------------------
+size_t TeeLeg::getData(char *buffer, size_t maxread)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait(lock, [this]{
+            return !m_queue.empty() || m_eof;
+        });
+    if (m_abort)
+        throw KError("Reading the data failed.");
+    if (m_queue.empty())
+        return 0;
+
+    const std::vector<char> &buf = *m_queue.front();
+    size_t len = std::min(maxread, buf.size() - m_offset);
+    memcpy(buffer, buf.data() + m_offset, len);
+    m_offset += len;
+    if (m_offset == buf.size()) {
+        m_queue.pop_front();
+        m_offset = 0;
+        m_cond.notify_all();
+    }
+    return len;
+}
+
+// -----------------------------------------------------------------------------
+void TeeLeg::run(StringVector target_files)
+{
+    try {
+        m_transfer->perform(this, target_files, NULL);
+    } catch (const std::exception &ex) {
+        fail(ex);
+    }
+}
+
+// -----------------------------------------------------------------------------
+void TeeLeg::runBatch(const ArtifactBatch *artifacts)
+{
+    try {
+        m_transfer->performBatch(*artifacts);
+    } catch (const std::exception &ex) {
+        fail(ex);
+    }
+}
+
+// -----------------------------------------------------------------------------
+void TeeLeg::fail(const std::exception &ex)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // errors of the DataProvider are reported by TeeTransfer
+    if (m_abort)
+        return;
+    m_failed = true;
+    m_error = ex.what();
+    m_queue.clear();
+    m_cond.notify_all();
+}
+
+//}}}
+//{{{ TeeTransfer --------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+TeeTransfer::TeeTransfer(size_t maxLag)
+    : m_maxLag(maxLag)
+{}
+
+// -----------------------------------------------------------------------------
+TeeTransfer::~TeeTransfer()
+{}
+
+// -----------------------------------------------------------------------------
+void TeeTransfer::addLeg(Transfer *transfer, const string &name)
+{
+    size_t maxQueue = std::max(m_maxLag / TEE_BUFFER_SIZE, (size_t)1);
+    m_legs.emplace_back(new TeeLeg(transfer, name, maxQueue));
+}
+
+// -----------------------------------------------------------------------------
+void TeeTransfer::perform(DataProvider *dataprovider,
+                          const StringVector &target_files,
+                          bool *directSave)
+{
+    Debug::debug()->trace("TeeTransfer::perform(%p, [ \"%s\"%s ])",
+        dataprovider, target_files.front().c_str(),
+        target_files.size() > 1 ? ", ..." : "");
+
+    if (directSave)
+        *directSave = false;
+
+    std::vector<TeeLeg *> active;
+    std::vector<std::unique_ptr<TeeLeg>>::iterator it;
+    for (it = m_legs.begin(); it != m_legs.end(); ++it)
+        if (!(*it)->failed())
+            active.push_back(it->get());
+    if (active.empty())
+        throw KError("Saving " + target_files.front() +
+                     " failed: all dump targets have failed before.");
+
+    std::vector<TeeLeg *>::iterator leg;
+    for (leg = active.begin(); leg != active.end(); ++leg)
+        (*leg)->start(target_files);
+
+    bool prepared = false;
+    try {
+        dataprovider->prepare();
+        prepared = true;
+
+        bool eof = false;
+        while (!eof) {
+            TeeBuffer buf = std::make_shared<std::vector<char>>(
+                TEE_BUFFER_SIZE);
+            size_t len = 0;
+            while (len < TEE_BUFFER_SIZE) {
+                size_t ret = dataprovider->getData(buf->data() + len,
+                                                   TEE_BUFFER_SIZE - len);
+                if (ret == 0) {
+                    eof = true;
+                    break;
+                }
+                len += ret;
+            }
+            if (len == 0)
+                break;
+            buf->resize(len);
+
+            // stop reading when nobody is left to take the data
+            bool alive = false;
+            for (leg = active.begin(); leg != active.end(); ++leg)
+                if ((*leg)->push(buf))
+                    alive = true;
+            if (!alive)
+                break;
+        }
+    } catch (...) {
+        for (leg = active.begin(); leg != active.end(); ++leg)
+            (*leg)->stop(true);
+        if (prepared) {
+            dataprovider->setError(true);
+            dataprovider->finish();
+        }
+        throw;
+    }
+
+    for (leg = active.begin(); leg != active.end(); ++leg)
+        (*leg)->stop(false);
+
+    unsigned saved = 0;
+    for (leg = active.begin(); leg != active.end(); ++leg) {
+        if ((*leg)->failed())
+            cerr << "WARNING: Saving " << target_files.front() << " to "
+                 << (*leg)->name() << " failed: " << (*leg)->error() << endl;
+        else
+            ++saved;
+    }
+
+    if (!saved)
+        dataprovider->setError(true);
+    dataprovider->finish();
+
+    if (!saved)
+        throw KError("Saving " + target_files.front() +
+                     " failed on all dump targets.");
+}
+
+// -----------------------------------------------------------------------------
+void TeeTransfer::performBatch(const ArtifactBatch &artifacts)
+{
+    Debug::debug()->trace("TeeTransfer::performBatch([%zu files])",
+        artifacts.size());
+
+    if (artifacts.empty())
+        return;
+    const string &first = artifacts.front().first;
+
+    std::vector<TeeLeg *> active;
+    std::vector<std::unique_ptr<TeeLeg>>::iterator it;
+    for (it = m_legs.begin(); it != m_legs.end(); ++it)
+        if (!(*it)->failed())
+            active.push_back(it->get());
+    if (active.empty())
+        throw KError("Saving " + first +
+                     " failed: all dump targets have failed before.");
+
+    // the data is in memory, so the legs need not be fed
+    std::vector<TeeLeg *>::iterator leg;
+    for (leg = active.begin(); leg != active.end(); ++leg)
+        (*leg)->startBatch(artifacts);
+    for (leg = active.begin(); leg != active.end(); ++leg)
+        (*leg)->stop(false);
+
+    unsigned saved = 0;
+    for (leg = active.begin(); leg != active.end(); ++leg) {
+        if ((*leg)->failed())
+            cerr << "WARNING: Saving " << first << " and other files to "
+                 << (*leg)->name() << " failed: " << (*leg)->error() << endl;
+        else
+            ++saved;
+    }
+
+    if (!saved)
+        throw KError("Saving " + first + " failed on all dump targets.");
+}
+
+// -----------------------------------------------------------------------------
+void TeeTransfer::setFreeSpaceReserve(unsigned long long bytes)
+{
+    for (size_t i = 0; i < m_legs.size(); ++i)
+        m_legs[i]->transfer()->setFreeSpaceReserve(bytes);
+}
+
+// -----------------------------------------------------------------------------
+void TeeTransfer::setExpectedSize(unsigned long long bytes)
+{
+    for (size_t i = 0; i < m_legs.size(); ++i)
+        m_legs[i]->transfer()->setExpectedSize(bytes);
+}
+
+// -----------------------------------------------------------------------------
+StringVector TeeTransfer::failedLegs() const
+{
+    StringVector ret;
+    std::vector<std::unique_ptr<TeeLeg>>::const_iterator it;
+    for (it = m_legs.begin(); it != m_legs.end(); ++it)
+        if ((*it)->failed())
+            ret.push_back((*it)->name());
+    return ret;
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef TEETRANSFER_H
+#define TEETRANSFER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "global.h"
+#include "transfer.h"
+
+class TeeLeg;
+
+//{{{ TeeTransfer --------------------------------------------------------------
+
+/**
+ * Transfer that saves every file to several other transfers at once.
+ *
+ * The data is read from the DataProvider only once. Each child transfer
+ * (a "leg") runs in its own thread and reads from a bounded queue, so a
+ * slow leg can fall behind the fastest one by at most the queue size
+ * before reading blocks.
+ *
+ * If one leg fails, a warning is printed and that leg is skipped for all
+ * following files, but the other legs continue.
+ */
+class TeeTransfer : public Transfer {
+
+    public:
+
+        /**
+         * Creates a new TeeTransfer object without any legs.
+         *
+         * @param[in] maxLag maximum number of bytes that a leg may fall
+         *            behind
+         */
+        TeeTransfer(size_t maxLag);
+
+        /**
+         * Destroys the TeeTransfer object and all child transfers.
+         */
+        ~TeeTransfer();
+
+        /**
+         * Adds a child transfer. The object takes ownership of
+         * @p transfer.
+         *
+         * @param[in] transfer the child transfer
+         * @param[in] name name of the leg (for messages)
+         */
+        void addLeg(Transfer *transfer, const std::string &name);
+
+        /**
+         * Transfers the file to all legs that have not failed so far.
+         * The data is never saved directly, so @p directSave is always
+         * set to @c false.
+         *
+         * @exception KError if reading the data fails, or if no leg
+         *            saved the file successfully
+         * @see Transfer::perform()
+         */
+        void perform(DataProvider *dataprovider,
+                     const StringVector &target_files,
+                     bool *directSave);
+
+        /**
+         * Saves the files to all legs that have not failed so far, each
+         * leg in its own thread.
+         *
+         * @exception KError if no leg saved the files successfully
+         * @see Transfer::performBatch()
+         */
+        void performBatch(const ArtifactBatch &artifacts);
+
+        /**
+         * Sets the reserve for all legs. A leg that runs out of space
+         * fails like on any other error.
+         *
+         * @see Transfer::setFreeSpaceReserve()
+         */
+        void setFreeSpaceReserve(unsigned long long bytes);
+
+        /**
+         * Sets the expected size for all legs.
+         *
+         * @see Transfer::setExpectedSize()
+         */
+        void setExpectedSize(unsigned long long bytes);
+
+        /**
+         * Returns the names of the legs that have failed.
+         */
+        StringVector failedLegs() const;
+
+    private:
+        size_t m_maxLag;
+        std::vector<std::unique_ptr<TeeLeg>> m_legs;
+};
+
+//}}}
+
+#endif /* TEETRANSFER_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "global.h"
+#include "debug.h"
+#include "asyncwriter.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+#define BUFFER_SIZE     (4 * 4096)
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+//{{{ ShortWriter --------------------------------------------------------------
+
+/**
+ * Makes an engine write only the first @c m_submitted bytes of each
+ * request and report only @c m_reported of them, so that AsyncWriter
+ * must finish the rest itself.
+ */
+template<typename Engine>
+class ShortWriter : public Engine {
+
+    public:
+        ShortWriter(int fd, size_t submitted, size_t reported)
+            : Engine(fd, BUFFER_SIZE, 2),
+              m_submitted(submitted), m_reported(reported)
+        { }
+
+    protected:
+        typedef typename Engine::Request Request;
+
+        void submit(Request *req)
+        {
+            size_t len = req->len;
+            if (req->len > m_submitted)
+                req->len = m_submitted;
+            try {
+                Engine::submit(req);
+            } catch (...) {
+                req->len = len;
+                throw;
+            }
+            req->len = len;
+        }
+
+        Request *reap(ssize_t *result)
+        {
+            Request *req = Engine::reap(result);
+            if (*result > ssize_t(m_reported))
+                *result = m_reported;
+            return req;
+        }
+
+    private:
+        size_t m_submitted;
+        size_t m_reported;
+};
+
+//}}}
+
+// -----------------------------------------------------------------------------
+/**
+ * Writes @p data at offset 0 of the file @p path with a ShortWriter.
+ *
+ * @param[out] direct whether the file had O_DIRECT after the write
+ * @return the file contents, or an empty string if the engine
+ *         is not available
+ */
+template<typename Engine>
+static string writeShort(const string &path, const string &data,
+                         size_t submitted, size_t reported, bool &direct)
+{
+    int fd = open(path.c_str(), O_WRONLY | O_TRUNC | O_DIRECT);
+    if (fd < 0)
+        fd = open(path.c_str(), O_WRONLY | O_TRUNC);
+    if (fd < 0)
+        throw KSystemError("Cannot open " + path, errno);
+
+    std::unique_ptr<AsyncWriter> writer;
+    try {
+        writer.reset(new ShortWriter<Engine>(fd, submitted, reported));
+    } catch (const KError &error) {
+        cerr << error.what() << endl;
+        close(fd);
+        return string();
+    }
+
+    char *buf = writer->getBuffer();
+    memcpy(buf, data.data(), data.size());
+    writer->write(buf, data.size(), 0);
+    writer->drain();
+    writer.reset();
+    direct = fcntl(fd, F_GETFL) & O_DIRECT;
+    close(fd);
+
+    string ret(data.size() + 1, '\0');
+    fd = open(path.c_str(), O_RDONLY);
+    ssize_t len = pread(fd, &ret[0], ret.size(), 0);
+    close(fd);
+    ret.resize(len > 0 ? len : 0);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Checks both short write cases with one engine. An engine that is not
+ * available in the test environment passes.
+ */
+template<typename Engine>
+static void checkEngine(TestRun &test, const char *name, const string &path)
+{
+    string data(BUFFER_SIZE, '\0');
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = char(i * 13 + i / 4096);
+
+    string what = string(name) + ": the rest of a short write is written";
+    test.check(what.c_str(), [&]() {
+            bool direct = false;
+            string ret = writeShort<Engine>(path, data, 4096, 4096, direct);
+            return ret.empty() || ret == data;
+        });
+
+    what = string(name) + ": an unaligned rest clears O_DIRECT";
+    test.check(what.c_str(), [&]() {
+            bool direct = true;
+            string ret = writeShort<Engine>(path, data, 4096, 1000, direct);
+            return ret.empty() || (ret == data && !direct);
+        });
+
+    what = string(name) + ": an unaligned file tail";
+    test.check(what.c_str(), [&]() {
+            string tail = data.substr(0, 3 * 4096 + 100);
+            bool direct = true;
+            string ret = writeShort<Engine>(path, tail, 4096, 4096, direct);
+            return ret.empty() || (ret == tail && !direct);
+        });
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    char tmpl[] = "/tmp/testasyncwriter.XXXXXX";
+    int tmpfd = mkstemp(tmpl);
+    if (tmpfd < 0) {
+        cerr << "Cannot create a temporary file" << endl;
+        return EXIT_FAILURE;
+    }
+    close(tmpfd);
+    string path(tmpl);
+
+    try {
+        TestRun test;
+
+        checkEngine<IoUringWriter>(test, "io_uring", path);
+        checkEngine<PosixAioWriter>(test, "POSIX AIO", path);
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    unlink(tmpl);
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
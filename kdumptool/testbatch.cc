@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "global.h"
+#include "debug.h"
+#include "batch.h"
+#include "kdumptool.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+//{{{ Record -------------------------------------------------------------------
+
+static StringVector recorded;
+static int runs;
+
+/**
+ * Subcommand that records its arguments.
+ */
+class Record : public Subcommand {
+    public:
+        Record()
+            : m_status(0), m_fail(false)
+        {
+            m_options.push_back(new IntOption("status", 's', &m_status,
+                "Exit status"));
+            m_options.push_back(new FlagOption("fail", 'f', &m_fail,
+                "Throw an exception"));
+        }
+
+        const char *getName() const
+        { return "record"; }
+
+        bool needsConfigfile() const
+        { return false; }
+
+        void parseArgs(const StringVector &args)
+        { m_args = args; }
+
+        void execute()
+        {
+            ++runs;
+            recorded = m_args;
+            if (m_fail)
+                throw KError("Failed as requested");
+            setErrorCode(m_status);
+        }
+
+    private:
+        int m_status;
+        bool m_fail;
+        StringVector m_args;
+};
+
+// -----------------------------------------------------------------------------
+static void addRecord(KdumpTool &kdt)
+{
+    kdt.addSubcommand(new Record);
+}
+
+// -----------------------------------------------------------------------------
+static StringVector words(const char *first, const char *second = NULL,
+                          const char *third = NULL)
+{
+    StringVector ret;
+    ret.push_back(first);
+    if (second)
+        ret.push_back(second);
+    if (third)
+        ret.push_back(third);
+    return ret;
+}
+
+//}}}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+        KdumpTool parent;
+
+        test.check("Split a quoted command line",
+                   []() {
+                       StringVector w;
+                       return Batch::splitCommand(
+                           "  print_target 'a b'\"c \\\"d\\\"\" e\\ f  ", w) &&
+                           w == words("print_target", "a bc \"d\"", "e f");
+                   });
+
+        test.check("Skip empty lines and comments",
+                   []() {
+                       StringVector w;
+                       return !Batch::splitCommand("   ", w) &&
+                           !Batch::splitCommand(" # find_kernel", w) &&
+                           Batch::splitCommand("a#b # c", w) &&
+                           w == words("a#b");
+                   });
+
+        test.check("Reject an unterminated quote",
+                   []() {
+                       StringVector w;
+                       try {
+                           Batch::splitCommand("record 'x", w);
+                       } catch (const KError &) {
+                           return true;
+                       }
+                       return false;
+                   });
+
+        test.check("Run a command with options and arguments",
+                   [&]() {
+                       Batch batch(parent, addRecord);
+                       return batch.run(words("record", "-s3", "arg")) == 3 &&
+                           recorded == words("arg");
+                   });
+
+        test.check("Failed commands exit with 255",
+                   [&]() {
+                       Batch batch(parent, addRecord);
+                       return batch.run(words("record", "--fail")) == 255 &&
+                           batch.run(words("batch", "record")) == 255;
+                   });
+
+        test.check("Stop at the first failure",
+                   [&]() {
+                       Batch batch(parent, addRecord);
+                       StringVector args = words("record", "one", ";");
+                       args.push_back("record");
+                       args.push_back("-s2");
+                       args.push_back(";");
+                       args.push_back("record");
+                       batch.parseArgs(args);
+                       runs = 0;
+                       batch.execute();
+                       return runs == 2 && batch.getErrorCode() == 2;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
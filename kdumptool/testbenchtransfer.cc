@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "global.h"
+#include "debug.h"
+#include "benchtransfer.h"
+#include "flattened.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+#define MiB     (1ULL << 20)
+#define PAGE    4096
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static bool isZero(const char *p, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+        if (p[i])
+            return false;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Reads the whole stream in odd-sized chunks and counts the zero pages.
+ */
+static string readAll(DataProvider &dp, unsigned long long *zeroPages)
+{
+    string ret;
+    char buf[12345];
+    size_t n;
+
+    dp.prepare();
+    while ((n = dp.getData(buf, sizeof buf)) > 0)
+        ret.append(buf, n);
+    dp.finish();
+
+    *zeroPages = 0;
+    for (size_t pos = 0; pos + PAGE <= ret.size(); pos += PAGE)
+        if (isZero(&ret[pos], PAGE))
+            ++*zeroPages;
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_INFO);
+    try {
+        TestRun test;
+
+        test.check("Zero pattern",
+                   []() {
+                       SyntheticDataProvider dp(
+                           SyntheticDataProvider::SP_ZERO, 4 * MiB, 0);
+                       unsigned long long zero;
+                       string data = readAll(dp, &zero);
+                       return data.size() == 4 * MiB &&
+                           zero == 4 * MiB / PAGE &&
+                           dp.produced() == 4 * MiB;
+                   });
+
+        test.check("Random pattern",
+                   []() {
+                       SyntheticDataProvider dp(
+                           SyntheticDataProvider::SP_RANDOM, 4 * MiB, 50);
+                       unsigned long long zero;
+                       string data = readAll(dp, &zero);
+                       return data.size() == 4 * MiB && zero == 0 &&
+                           data.compare(0, PAGE, data, PAGE, PAGE) != 0;
+                   });
+
+        test.check("Mixed pattern has the zero ratio",
+                   []() {
+                       SyntheticDataProvider dp(
+                           SyntheticDataProvider::SP_MIXED, 16 * MiB, 25);
+                       unsigned long long zero;
+                       string data = readAll(dp, &zero);
+                       unsigned long long pages = 16 * MiB / PAGE;
+                       return data.size() == 16 * MiB &&
+                           zero > pages * 20 / 100 && zero < pages * 30 / 100;
+                   });
+
+        test.check("Same options give the same data",
+                   []() {
+                       SyntheticDataProvider a(
+                           SyntheticDataProvider::SP_MIXED, 1 * MiB, 50);
+                       SyntheticDataProvider b(
+                           SyntheticDataProvider::SP_MIXED, 1 * MiB, 50);
+                       unsigned long long zero;
+                       return readAll(a, &zero) == readAll(b, &zero);
+                   });
+
+        test.check("Flattened stream can be placed",
+                   []() {
+                       SyntheticDataProvider mixed(
+                           SyntheticDataProvider::SP_MIXED, 4 * MiB, 30);
+                       unsigned long long zero;
+                       string expect = readAll(mixed, &zero);
+
+                       SyntheticDataProvider synth(
+                           SyntheticDataProvider::SP_FLATTENED, 4 * MiB, 30);
+                       FlattenedDataProvider flat(&synth);
+                       string placed(4 * MiB, '\0');
+                       char buf[PAGE];
+                       off_t offset;
+                       size_t n;
+                       flat.prepare();
+                       while ((n = flat.getPlacedData(buf, sizeof buf,
+                                                      &offset)) > 0) {
+                           if (offset + n > placed.size())
+                               return false;
+                           memcpy(&placed[offset], buf, n);
+                       }
+                       flat.finish();
+                       return placed == expect &&
+                           synth.produced() == FLAT_HEADER_SIZE +
+                           (4 * MiB / PAGE - zero) * (FLAT_RECORD_SIZE + PAGE) +
+                           FLAT_RECORD_SIZE;
+                   });
+
+        test.check("Chunk latencies",
+                   []() {
+                       SyntheticDataProvider dp(
+                           SyntheticDataProvider::SP_ZERO, 1 * MiB, 0);
+                       char buf[256 * 1024];
+                       while (dp.getData(buf, sizeof buf) > 0)
+                           ;
+                       dp.getData(buf, sizeof buf);
+                       // four chunks, each one measured when the next
+                       // one (or the end) is requested
+                       return dp.latencies().size() == 4;
+                   });
+
+        test.check("Unknown pattern",
+                   []() {
+                       try {
+                           SyntheticDataProvider::parsePattern("ones");
+                       } catch (const KError &) {
+                           return SyntheticDataProvider::parsePattern(
+                               "flattened") ==
+                               SyntheticDataProvider::SP_FLATTENED;
+                       }
+                       return false;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
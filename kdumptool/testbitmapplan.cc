@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "global.h"
+#include "debug.h"
+#include "bitmapplan.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// 4 TiB of 4 KiB pages: one bitmap is 128 MiB
+static const unsigned long long HUGE_PFNS = 1ULL << 30;
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+
+    try {
+        TestRun test;
+
+        test.check("Both bitmaps in memory need a single cycle",
+                   []() {
+                       BitmapPlan plan(HUGE_PFNS, 1ULL << 20, 1, 0);
+                       StringVector opts = plan.options();
+                       return plan.bitmapKb() == 131072 &&
+                           plan.location() == BitmapPlan::MEMORY &&
+                           plan.cycles() == 1 && opts.size() == 2 &&
+                           opts[0] == "--cyclic-buffer" &&
+                           opts[1] == "131072";
+                   });
+
+        test.check("Split processes share the bitmap",
+                   []() {
+                       BitmapPlan plan(HUGE_PFNS, 1ULL << 20, 4, 0);
+                       return plan.location() == BitmapPlan::MEMORY &&
+                           plan.bufferKb() == 32768 && plan.cycles() == 1;
+                   });
+
+        test.check("Bitmap files go to the target if memory is short",
+                   []() {
+                       BitmapPlan plan(HUGE_PFNS, 131072, 1, 3,
+                                       "/var/crash/x", 1ULL << 30);
+                       StringVector opts = plan.options();
+                       return plan.location() == BitmapPlan::DISK &&
+                           plan.cycles() == 1 && opts.size() == 3 &&
+                           opts[0] == "--non-cyclic" &&
+                           opts[1] == "--work-dir" &&
+                           opts[2] == "/var/crash/x";
+                   });
+
+        test.check("Without space on the target the buffer is maximized",
+                   []() {
+                       // 50% of 128 MiB less 3 threads, halved
+                       BitmapPlan plan(HUGE_PFNS, 131072, 1, 3,
+                                       "/var/crash/x", 200ULL << 20);
+                       return plan.location() == BitmapPlan::MEMORY &&
+                           plan.bufferKb() == 26624 && plan.cycles() == 5;
+                   });
+
+        test.check("makedumpfile decides if nothing fits",
+                   []() {
+                       BitmapPlan plan(HUGE_PFNS, 2048, 1, 0);
+                       return plan.location() == BitmapPlan::DEFAULT &&
+                           plan.cycles() == 0 && plan.options().empty();
+                   });
+
+        test.check("MAKEDUMPFILE_OPTIONS override the plan",
+                   []() {
+                       return BitmapPlan::overridden("-D --cyclic-buffer 8") &&
+                           BitmapPlan::overridden("--work-dir=/tmp") &&
+                           BitmapPlan::overridden("--non-cyclic") &&
+                           !BitmapPlan::overridden("--message-level 1");
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
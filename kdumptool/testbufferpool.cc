@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <unistd.h>
+
+#include "global.h"
+#include "debug.h"
+#include "bufferpool.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+#define KiB     (1UL << 10)
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+        BufferPool *pool = BufferPool::pool();
+        const size_t page = sysconf(_SC_PAGESIZE);
+
+        test.check("Buffers are page-aligned",
+                   [&]() {
+                       BufferPool::Buffer b = pool->get(100);
+                       b.get()[99] = 'x';
+                       return b && b.size() == 100 &&
+                           (uintptr_t)b.get() % page == 0;
+                   });
+
+        test.check("Returned buffers are reused",
+                   [&]() {
+                       char *first;
+                       {
+                           BufferPool::Buffer b = pool->get(64 * KiB);
+                           first = b.get();
+                       }
+                       BufferPool::Buffer b = pool->get(64 * KiB);
+                       return b.get() == first;
+                   });
+
+        test.check("Moving a buffer keeps one owner",
+                   [&]() {
+                       BufferPool::Buffer a = pool->get(page);
+                       char *p = a.get();
+                       BufferPool::Buffer b(std::move(a));
+                       return !a && b.get() == p;
+                   });
+
+        pool->setLimit(256 * KiB);
+
+        test.check("tryGet() respects the limit",
+                   [&]() {
+                       BufferPool::Buffer a = pool->tryGet(192 * KiB);
+                       BufferPool::Buffer b = pool->tryGet(128 * KiB);
+                       return a && !b;
+                   });
+
+        test.check("Cached buffers make room for other sizes",
+                   [&]() {
+                       { BufferPool::Buffer a = pool->get(192 * KiB); }
+                       BufferPool::Buffer b = pool->tryGet(200 * KiB);
+                       return bool(b);
+                   });
+
+        test.check("get() waits for a returned buffer",
+                   [&]() {
+                       unsigned long long before = pool->overcommits();
+                       BufferPool::Buffer a = pool->get(192 * KiB);
+                       std::thread t([&]() {
+                           std::this_thread::sleep_for(
+                               std::chrono::milliseconds(100));
+                           a.reset();
+                       });
+                       BufferPool::Buffer b = pool->get(128 * KiB);
+                       t.join();
+                       return b && pool->overcommits() == before;
+                   });
+
+        test.check("A single large request is granted",
+                   [&]() {
+                       unsigned long long before = pool->overcommits();
+                       BufferPool::Buffer a = pool->get(512 * KiB);
+                       return a && pool->overcommits() == before + 1 &&
+                           pool->peak() >= 512 * KiB;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
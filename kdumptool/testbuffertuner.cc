@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "global.h"
+#include "debug.h"
+#include "buffertuner.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+#define KiB     (1UL << 10)
+#define MiB     (1UL << 20)
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+//{{{ SimulatedTuner -----------------------------------------------------------
+
+/**
+ * Feeds a BufferTuner with writes whose duration is computed from
+ * their size, on a simulated clock.
+ */
+class SimulatedTuner : public BufferTuner {
+
+    public:
+        SimulatedTuner()
+            : BufferTuner("test"),
+              m_now(Clock::now())
+        { }
+
+        /**
+         * Writes until the tuner settles or @p seconds have passed.
+         */
+        template<typename cost_fn>
+        void run(cost_fn cost, double seconds = 10)
+        {
+            Clock::time_point end = m_now +
+                std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(seconds));
+            while (!settled() && m_now < end) {
+                Clock::duration latency =
+                    std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double>(cost(size())));
+                m_now += latency;
+                account(size(), latency, m_now);
+            }
+        }
+
+    private:
+        Clock::time_point m_now;
+};
+
+//}}}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+
+        test.check("Initial size is a multiple of the granularity",
+                   []() {
+                       BufferTuner t("test", 3000);
+                       return t.size() % 3000 == 0 && t.size() <= MiB &&
+                           t.size() > MiB - 3000 && !t.settled();
+                   });
+
+        test.check("Larger writes that are faster grow the buffer",
+                   []() {
+                       SimulatedTuner t;
+                       // a fixed 10 ms per write
+                       t.run([](size_t size) { return 0.01; });
+                       return t.settled() && t.size() == TUNER_MAX_SIZE;
+                   });
+
+        test.check("Same throughput keeps the initial size",
+                   []() {
+                       SimulatedTuner t;
+                       // 100 MiB/s at any size
+                       t.run([](size_t size) {
+                               return (double)size / (100 * MiB);
+                           });
+                       return t.settled() && t.size() == TUNER_INITIAL_SIZE;
+                   });
+
+        test.check("Smaller writes that are faster shrink the buffer",
+                   []() {
+                       SimulatedTuner t;
+                       // the rate drops with the size
+                       t.run([](size_t size) {
+                               double mib = (double)size / MiB;
+                               return 0.01 * mib * mib;
+                           });
+                       return t.settled() && t.size() == TUNER_MIN_SIZE;
+                   });
+
+        test.check("Slow writes shrink the buffer",
+                   []() {
+                       SimulatedTuner t;
+                       // 5 MiB/s at any size: a 1 MiB write takes 200 ms
+                       t.run([](size_t size) {
+                               return (double)size / (5 * MiB);
+                           });
+                       return t.settled() && t.size() == 256 * KiB;
+                   });
+
+        test.check("Tuning ends after the tuning period",
+                   []() {
+                       SimulatedTuner t;
+                       // the first window is longer than the period
+                       t.run([](size_t size) { return 0.5; });
+                       return t.settled() && t.size() == TUNER_INITIAL_SIZE;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+
+#include <cstdlib>
+#include <cerrno>
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "global.h"
+#include "debug.h"
+#include "fileutil.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    char dir[] = "/tmp/testcanonicalpath.XXXXXX";
+    try {
+        TestRun test;
+
+        if (!mkdtemp(dir))
+            throw KSystemError("mkdtemp() failed", errno);
+        string root = dir;
+        mkdir((root + "/real").c_str(), 0755);
+        mkdir((root + "/real/dir").c_str(), 0755);
+        mkdir((root + "/swap").c_str(), 0755);
+        close(open((root + "/real/file").c_str(), O_CREAT | O_WRONLY, 0644));
+        symlink("/real", (root + "/abs").c_str());
+        symlink("real/dir", (root + "/rel").c_str());
+        symlink("../../..", (root + "/up").c_str());
+        symlink("abs", (root + "/chain").c_str());
+
+        test.check("Absolute link inside the root",
+                   [&]() {
+                       return FilePath("/abs/dir").getCanonicalPath(root) ==
+                           root + "/real/dir";
+                   });
+
+        test.check("Relative link with a missing tail",
+                   [&]() {
+                       return FilePath("/rel/x/y").getCanonicalPath(root) ==
+                           root + "/real/dir/x/y";
+                   });
+
+        test.check("Link cannot leave the root",
+                   [&]() {
+                       return FilePath("/up/real").getCanonicalPath(root) ==
+                           root + "/real";
+                   });
+
+        test.check("Parent of a missing directory",
+                   [&]() {
+                       return FilePath("/missing/../real//.")
+                           .getCanonicalPath(root) == root + "/real";
+                   });
+
+        test.check("Chain of links",
+                   [&]() {
+                       return FilePath("/chain/dir/new")
+                           .getCanonicalPath(root) == root + "/real/dir/new";
+                   });
+
+        test.check("Root itself",
+                   [&]() {
+                       return FilePath("/").getCanonicalPath(root) == root &&
+                           FilePath("/").getCanonicalPath() == "/";
+                   });
+
+        test.check("File in the middle of a path",
+                   [&]() {
+                       try {
+                           FilePath("/real/file/x").getCanonicalPath(root);
+                       } catch (KError &e) {
+                           return true;
+                       }
+                       return false;
+                   });
+
+        test.check("Cleared cache sees a new link",
+                   [&]() {
+                       bool before = FilePath("/swap/new")
+                           .getCanonicalPath(root) == root + "/swap/new";
+                       rmdir((root + "/swap").c_str());
+                       symlink("real", (root + "/swap").c_str());
+                       FilePath::clearCanonicalCache();
+                       return before && FilePath("/swap/new")
+                           .getCanonicalPath(root) == root + "/real/new";
+                   });
+
+        unlink((root + "/real/file").c_str());
+        unlink((root + "/abs").c_str());
+        unlink((root + "/rel").c_str());
+        unlink((root + "/up").c_str());
+        unlink((root + "/chain").c_str());
+        unlink((root + "/swap").c_str());
+        rmdir((root + "/real/dir").c_str());
+        rmdir((root + "/real").c_str());
+        rmdir(dir);
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "global.h"
+#include "debug.h"
+#include "checksum.h"
+#include "dataprovider.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static uint32_t crc(const char *data, size_t len)
+{
+    Crc32c c;
+    c.update(data, len);
+    return c.value();
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_TRACE);
+    try {
+        TestRun test;
+
+        cout << "Implementation: " << Crc32c::implementation() << endl;
+
+        const string digits("123456789");
+        char zeros[32], ones[32], large[1031];
+        memset(zeros, 0, sizeof zeros);
+        memset(ones, 0xff, sizeof ones);
+        for (size_t i = 0; i < sizeof large; ++i)
+            large[i] = (char)(i * 7 + 3);
+
+        // test vectors from RFC 3720, B.4
+        test.check("Empty data",
+                   []() {
+                       return crc("", 0) == 0;
+                   });
+
+        test.check("Check value of \"123456789\"",
+                   [&digits]() {
+                       return crc(digits.c_str(), digits.size()) ==
+                           0xe3069283;
+                   });
+
+        test.check("32 bytes of zeroes",
+                   [&zeros]() {
+                       return crc(zeros, sizeof zeros) == 0x8a9136aa;
+                   });
+
+        test.check("32 bytes of ones",
+                   [&ones]() {
+                       return crc(ones, sizeof ones) == 0x62a8ab43;
+                   });
+
+        test.check("Hex formatting",
+                   [&digits]() {
+                       Crc32c c;
+                       c.update(digits.c_str(), digits.size());
+                       return c.hex() == "e3069283";
+                   });
+
+        test.check("Incremental update matches a single update",
+                   [&large]() {
+                       for (size_t split = 0; split <= 17; ++split) {
+                           Crc32c c;
+                           c.update(large, split);
+                           c.update(large + split, sizeof large - split);
+                           if (c.value() != crc(large, sizeof large))
+                               return false;
+                       }
+                       return true;
+                   });
+
+        test.check("Unaligned data",
+                   [&large]() {
+                       Crc32c a, b;
+                       a.update(large + 1, 100);
+                       for (size_t i = 1; i <= 100; ++i)
+                           b.update(large + i, 1);
+                       return a.value() == b.value();
+                   });
+
+        test.check("ChecksumDataProvider per file and per chunk",
+                   [&digits]() {
+                       BufferDataProvider buffer(digits.c_str(),
+                                                 digits.size());
+                       ChecksumDataProvider checked(&buffer, 4);
+                       char buf[3];
+
+                       checked.prepare();
+                       while (checked.getData(buf, sizeof buf))
+                           ;
+                       checked.finish();
+
+                       const std::vector<Crc32c> &chunks =
+                           checked.chunkChecksums();
+                       return checked.valid() &&
+                           checked.size() == digits.size() &&
+                           checked.checksum().value() == 0xe3069283 &&
+                           chunks.size() == 3 &&
+                           chunks[0].value() == crc("1234", 4) &&
+                           chunks[1].value() == crc("5678", 4) &&
+                           chunks[2].value() == crc("9", 1);
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
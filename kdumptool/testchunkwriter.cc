@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "global.h"
+#include "debug.h"
+#include "dataprovider.h"
+#include "chunkwriter.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+#define BLOCK   4096
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static string tempFile(const string &content)
+{
+    char name[] = "/tmp/testchunkwriter.XXXXXX";
+    int fd = mkstemp(name);
+    if (fd < 0)
+        throw KSystemError("Cannot create a temporary file", errno);
+    if (write(fd, content.data(), content.size()) != (ssize_t)content.size())
+        throw KSystemError("Cannot write a temporary file", errno);
+    close(fd);
+    return name;
+}
+
+// -----------------------------------------------------------------------------
+static string readFile(const string &path)
+{
+    string ret;
+    int fd = open(path.c_str(), O_RDONLY);
+    char buf[BLOCK];
+    ssize_t len;
+    while ((len = read(fd, buf, sizeof buf)) > 0)
+        ret.append(buf, len);
+    close(fd);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+static DataChunk makeChunk(const string &data, off_t offset)
+{
+    BufferPool::Buffer buf = BufferPool::pool()->get(data.size());
+    memcpy(buf.get(), data.data(), data.size());
+    DataChunk chunk;
+    chunk.assign(std::move(buf), data.size(), offset);
+    return chunk;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+        string text;
+        for (int i = 0; i < 1000; ++i)
+            text += "line " + std::to_string(i) + "\n";
+
+        test.check("Sequential data gets consecutive offsets",
+                   [&]() {
+                       BufferDataProvider dp(text.data(), text.size());
+                       dp.prepare();
+                       std::vector<DataChunk> chunks;
+                       string joined;
+                       off_t expect = 0;
+                       bool ok = true;
+                       DataChunk chunk;
+                       while (dp.getChunk(chunk, 1000)) {
+                           ok = ok && chunk.offset() == expect;
+                           expect += chunk.length();
+                           chunks.push_back(std::move(chunk));
+                       }
+                       dp.finish();
+                       // all chunks are still valid
+                       for (const DataChunk &c : chunks)
+                           joined.append(c.data(), c.length());
+                       return ok && joined == text && chunks.size() > 1;
+                   });
+
+        test.check("Mapped chunks outlive the file",
+                   [&]() {
+                       string path = tempFile(text);
+                       DataChunk first;
+                       {
+                           FileDataProvider dp(path.c_str());
+                           dp.prepare();
+                           dp.getChunk(first, 100);
+                           DataChunk next;
+                           dp.getChunk(next, 100);
+                           dp.finish();
+                       }
+                       unlink(path.c_str());
+                       return first.length() == 100 && first.offset() == 0 &&
+                           string(first.data(), 100) == text.substr(0, 100);
+                   });
+
+        test.check("Chunks are written at their offsets with holes",
+                   [&]() {
+                       string path = tempFile("");
+                       int fd = open(path.c_str(), O_WRONLY);
+                       string a(BLOCK, 'a'), z(2 * BLOCK, '\0');
+                       unsigned long long sparse;
+                       off_t end;
+                       {
+                           ChunkWriter writer(fd, 2, BLOCK);
+                           writer.write(makeChunk(a, 3 * BLOCK));
+                           writer.write(makeChunk(z, 0));
+                           writer.write(makeChunk(a, 2 * BLOCK));
+                           writer.write(makeChunk(z, 4 * BLOCK));
+                           writer.drain();
+                           sparse = writer.sparse();
+                           end = writer.end();
+                       }
+                       close(fd);
+                       string data = readFile(path);
+                       unlink(path.c_str());
+                       // zero blocks before the end must be written
+                       return end == 6 * BLOCK && sparse == 2 * BLOCK &&
+                           data == z + a + a;
+                   });
+
+        test.check("Write errors are reported",
+                   [&]() {
+                       string path = tempFile("");
+                       int fd = open(path.c_str(), O_RDONLY);
+                       bool thrown = false;
+                       try {
+                           ChunkWriter writer(fd, 2, 0);
+                           writer.write(makeChunk(text, 0));
+                           writer.drain();
+                       } catch (const KError &e) {
+                           thrown = true;
+                       }
+                       close(fd);
+                       unlink(path.c_str());
+                       return thrown;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "global.h"
+#include "debug.h"
+#include "codecbench.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+#define MiB     (1ULL << 20)
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static CodecBenchmark::Result makeResult(const char *format, double ratio,
+                                         double rate)
+{
+    CodecBenchmark::Result r;
+    r.format = format;
+    r.measured = true;
+    r.ratio = ratio;
+    r.rate = rate;
+    return r;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+
+        test.check("Parse makedumpfile -v",
+                   []() {
+                       StringVector f = CodecBenchmark::parseVersion(
+                           "makedumpfile: version 1.7.4 (released on 6 Nov 2023)\n"
+                           "lzo\tenabled\n"
+                           "snappy\tdisabled\n"
+                           "zstd\tenabled\n");
+                       return f.size() == 3 && f[0] == "compressed" &&
+                           f[1] == "lzo" && f[2] == "zstd";
+                   });
+
+        test.check("Old makedumpfile has zlib only",
+                   []() {
+                       StringVector f = CodecBenchmark::parseVersion("");
+                       return f.size() == 1 && f[0] == "compressed";
+                   });
+
+        test.check("Slow target prefers strong compression",
+                   []() {
+                       vector<CodecBenchmark::Result> r;
+                       r.push_back(makeResult("compressed", 0.3, 160 * MiB));
+                       r.push_back(makeResult("lzo", 0.4, 1000 * MiB));
+                       return CodecBenchmark::choose(r, 50 * MiB) == 0;
+                   });
+
+        test.check("Fast target prefers fast compression",
+                   []() {
+                       vector<CodecBenchmark::Result> r;
+                       r.push_back(makeResult("compressed", 0.3, 160 * MiB));
+                       r.push_back(makeResult("lzo", 0.4, 1000 * MiB));
+                       return CodecBenchmark::choose(r, 2000 * MiB) == 1;
+                   });
+
+        test.check("Compressible sample",
+                   []() {
+                       string data;
+                       for (int i = 0; data.size() < 1 * MiB; ++i)
+                           data += "page " + std::to_string(i) + " ";
+                       CodecBenchmark bench(2);
+                       bench.setSample(data, 4096);
+                       StringVector f(1, "compressed");
+                       f.push_back("lzo");
+                       vector<CodecBenchmark::Result> r = bench.run(f);
+                       return r.size() == 2 && r[0].measured &&
+                           r[0].ratio < 0.5 && r[0].rate > 0 &&
+                           !r[1].measured && r[1].ratio > r[0].ratio &&
+                           r[1].rate > r[0].rate;
+                   });
+
+        test.check("Random pages are stored as they are",
+                   []() {
+                       string data(1 * MiB, '\0');
+                       unsigned x = 12345;
+                       for (size_t i = 0; i < data.size(); ++i) {
+                           x = x * 1103515245 + 12345;
+                           data[i] = x >> 24;
+                       }
+                       CodecBenchmark bench(1);
+                       bench.setSample(data, 4096);
+                       vector<CodecBenchmark::Result> r =
+                           bench.run(StringVector(1, "compressed"));
+                       return r.size() == 1 && r[0].ratio == 1.0;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
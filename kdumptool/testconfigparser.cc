@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include <unistd.h>
+
+#include "global.h"
+#include "debug.h"
+#include "fileutil.h"
+#include "configparser.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+//{{{ NativeParser -------------------------------------------------------------
+
+class NativeParser : public ShellConfigParser {
+
+    public:
+        NativeParser(const string &filename)
+        : ShellConfigParser(filename)
+        { }
+
+        using ShellConfigParser::parseNative;
+};
+
+//}}}
+
+// -----------------------------------------------------------------------------
+static void writeFile(const string &name, const string &content)
+{
+    std::ofstream fout(name.c_str(), std::ios::trunc);
+    fout << content;
+    fout.close();
+    if (!fout)
+        throw KError("Cannot write " + name + ".");
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+
+    char tmpl[] = "testconfigparser.XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        cerr << "mkdtemp() failed" << endl;
+        return EXIT_FAILURE;
+    }
+    FilePath dir(tmpl);
+    string file = FilePath(dir).appendPath("sysconfig");
+
+    try {
+        TestRun test;
+
+        test.check("Simple assignments are parsed natively",
+                   [&]() {
+                       writeFile(file,
+                                 "# comment\n"
+                                 "\n"
+                                 "A=plain\n"
+                                 "B=\"double quoted  value\"\n"
+                                 "C='single $quoted'\n"
+                                 "  D=  \n"
+                                 "E=\"  leading\"\n"
+                                 "F=\"esc \\\"q\\\" \\$x\"\n"
+                                 "G=a\\ b # comment\n"
+                                 "H=mixed\"part\"'two'\n"
+                                 "UNKNOWN=1\n");
+                       NativeParser cp(file);
+                       const char *const names[] = {
+                           "A", "B", "C", "D", "E", "F", "G", "H", "I"
+                       };
+                       for (const char *name : names)
+                           cp.addVariable(name, "x");
+                       if (!cp.parseNative())
+                           return false;
+                       // the values that /bin/sh prints
+                       return cp.getValue("A") == "plain" &&
+                           cp.getValue("B") == "double quoted value" &&
+                           cp.getValue("C") == "single $quoted" &&
+                           cp.getValue("D") == "" &&
+                           cp.getValue("E") == " leading" &&
+                           cp.getValue("F") == "esc \"q\" $x" &&
+                           cp.getValue("G") == "a b" &&
+                           cp.getValue("H") == "mixedparttwo" &&
+                           cp.getValue("I") == "x";
+                   });
+
+        test.check("Defaults are folded like in the shell",
+                   [&]() {
+                       writeFile(file, "A=1\n");
+                       NativeParser cp(file);
+                       cp.addVariable("B", " two  words ");
+                       return cp.parseNative() &&
+                           cp.getValue("B") == " two words";
+                   });
+
+        test.check("Expansions need a shell",
+                   [&]() {
+                       writeFile(file, "FOO=bar\nTEST=$FOO\n");
+                       NativeParser cp(file);
+                       cp.addVariable("TEST", "");
+                       if (cp.parseNative())
+                           return false;
+                       cp.parse();
+                       return cp.getValue("TEST") == "bar";
+                   });
+
+        test.check("Other shell syntax needs a shell",
+                   [&]() {
+                       const char *const files[] = {
+                           "export A=1\n",
+                           "A=1; B=2\n",
+                           "A=\"multi\nline\"\n",
+                           "A=`date`\n",
+                           "A=~/dump\n",
+                           "A=*\n",
+                           "A=b c\n",
+                       };
+                       for (const char *content : files) {
+                           writeFile(file, content);
+                           NativeParser cp(file);
+                           cp.addVariable("A", "");
+                           if (cp.parseNative())
+                               return false;
+                       }
+                       return true;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    dir.rmdir(true);
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
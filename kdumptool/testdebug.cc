@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+// compile out the trace messages of this file
+#define KDUMP_MODULE_LOG_LEVEL  10
+
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "global.h"
+#include "debug.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static const char *counted(unsigned *count)
+{
+    ++*count;
+    return "argument";
+}
+
+// -----------------------------------------------------------------------------
+static string readLog(FILE *fp)
+{
+    string ret;
+    char buf[256];
+
+    fflush(fp);
+    rewind(fp);
+    while (fgets(buf, sizeof buf, fp))
+        ret += buf;
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    try {
+        TestRun test;
+        Debug *debug = Debug::debug();
+
+        test.check("Disabled messages skip their arguments",
+                   [debug]() {
+                       unsigned count = 0;
+                       debug->setStderrLevel(Debug::DL_INFO);
+                       KDBG("%s", counted(&count));
+                       return count == 0 && !debug->enabled(Debug::DL_DEBUG);
+                   });
+
+        test.check("Enabled messages are printed",
+                   [debug]() {
+                       unsigned count = 0;
+                       FILE *fp = tmpfile();
+                       debug->setFileHandle(fp);
+                       KDBG("%s", counted(&count));
+                       debug->setFileHandle(NULL);
+                       string log = readLog(fp);
+                       fclose(fp);
+                       return count == 1 &&
+                           log == "DEBUG: argument\n";
+                   });
+
+        test.check("Compiled-out messages skip their arguments",
+                   [debug]() {
+                       unsigned count = 0;
+                       FILE *fp = tmpfile();
+                       debug->setFileHandle(fp);
+                       KTRACE("%s", counted(&count));
+                       KEVENT("event %llu %llu", 1, 2);
+                       debug->setFileHandle(NULL);
+                       string log = readLog(fp);
+                       fclose(fp);
+                       debug->dumpEvents();
+                       return count == 0 && log.empty();
+                   });
+
+        test.check("Events are formatted when dumped",
+                   [debug]() {
+                       FILE *fp = tmpfile();
+                       debug->setStderrLevel(Debug::DL_NONE);
+                       debug->setFileHandle(fp);
+                       debug->event("first %llu", 1, 0);
+                       debug->event("second %llu of %llu", 2, 3);
+                       debug->dumpEvents();
+                       debug->setFileHandle(NULL);
+                       string log = readLog(fp);
+                       fclose(fp);
+                       return log.find("Last 2 of 2 trace events") !=
+                           string::npos &&
+                           log.find(" first 1\n") != string::npos &&
+                           log.find("-0.000000 second 2 of 3\n") !=
+                           string::npos;
+                   });
+
+        test.check("Ring buffer keeps the last events",
+                   [debug]() {
+                       FILE *fp = tmpfile();
+                       debug->setFileHandle(fp);
+                       for (unsigned long long i = 0; i < 1000; ++i)
+                           debug->event("event %llu", i, 0);
+                       debug->dumpEvents();
+                       debug->dumpEvents();    // nothing left
+                       debug->setFileHandle(NULL);
+                       string log = readLog(fp);
+                       fclose(fp);
+                       return log.find("Last 256 of 1000 trace") !=
+                           string::npos &&
+                           log.find(" event 743\n") == string::npos &&
+                           log.find(" event 744\n") != string::npos &&
+                           log.find(" event 999\n") != string::npos &&
+                           log.find("Last ", log.find("Last ") + 1) ==
+                           string::npos;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <stdint.h>
+
+#include "global.h"
+#include "debug.h"
+#include "dataprovider.h"
+#include "flattened.h"
+#include "fileutil.h"
+#include "dedup.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+#define RELEASE     "6.4.0-1-default"
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static string page(int seed)
+{
+    string ret(DEDUP_CHUNK_SIZE, '\0');
+    for (size_t i = 0; i < ret.size(); i += 8)
+        ret[i] = char(seed * 31 + i / 8);
+    ret[1] = char(seed);
+    ret[2] = char(seed >> 8);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+static void putBE64(string &s, int64_t val)
+{
+    for (int shift = 56; shift >= 0; shift -= 8)
+        s.push_back(char((uint64_t)val >> shift));
+}
+
+// -----------------------------------------------------------------------------
+static string flatRecord(int64_t offset, const string &data)
+{
+    string ret;
+    putBE64(ret, offset);
+    putBE64(ret, data.size());
+    return ret + data;
+}
+
+// -----------------------------------------------------------------------------
+static string readFile(const string &path)
+{
+    std::ifstream fin(path.c_str(), std::ios::binary);
+    std::ostringstream ss;
+    ss << fin.rdbuf();
+    return ss.str();
+}
+
+// -----------------------------------------------------------------------------
+static string saveMap(DataProvider *p, const string &dumpdir,
+                      unsigned long long *found = NULL,
+                      unsigned long long *added = NULL)
+{
+    ChunkStore store(ChunkStore::location(dumpdir, RELEASE),
+                     FilePath(dumpdir).baseName(), 1 << 20);
+    DedupDataProvider dedup(p, &store, RELEASE);
+
+    FilePath(dumpdir).mkdir(true);
+    string map = dumpdir + "/vmcore.dedup";
+    std::ofstream fout(map.c_str(), std::ios::binary);
+    char buf[65536];
+    size_t n;
+    dedup.prepare();
+    while ((n = dedup.getData(buf, sizeof buf)) > 0)
+        fout.write(buf, n);
+    dedup.finish();
+
+    if (found)
+        *found = store.found();
+    if (added)
+        *added = store.added();
+    return map;
+}
+
+// -----------------------------------------------------------------------------
+static string reconstruct(const string &map)
+{
+    string output = map + ".out";
+    Reconstruct r;
+    StringVector args;
+    args.push_back(map);
+    args.push_back(output);
+    r.parseArgs(args);
+    r.execute();
+    return readFile(output);
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    char tmpl[] = "/tmp/testdedup.XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        cerr << "Cannot create a temporary directory" << endl;
+        return EXIT_FAILURE;
+    }
+    string dir(tmpl);
+
+    try {
+        TestRun test;
+
+        test.check("Added chunks are found",
+                   [&]() {
+                       ChunkStore store(dir + "/store1", "a", 1 << 20);
+                       string p1 = page(1), p2 = page(2);
+                       ChunkStore::Ref added = store.add(p1.data());
+                       ChunkStore::Ref found;
+                       return store.find(p1.data(), &found) &&
+                           found.pack == added.pack &&
+                           found.offset == added.offset &&
+                           !store.find(p2.data(), &found);
+                   });
+
+        test.check("Committed chunks are found by the next dump",
+                   [&]() {
+                       string p1 = page(1), p2 = page(2);
+                       {
+                           ChunkStore store(dir + "/store2", "a", 1 << 20);
+                           store.add(p1.data());
+                           store.commit();
+                           store.add(p2.data());
+                       }
+                       ChunkStore store(dir + "/store2", "b", 1 << 20);
+                       ChunkStore::Ref ref;
+                       return store.find(p1.data(), &ref) &&
+                           store.packs()[ref.pack] == "a" &&
+                           !store.find(p2.data(), &ref);
+                   });
+
+        // an ELF header, data pages, a repeated page and zero pages
+        string vmcore(100, 'E');
+        vmcore.resize(DEDUP_CHUNK_SIZE, '\0');
+        for (int i = 0; i < 64; ++i)
+            vmcore += page(i);
+        vmcore += page(5);
+        vmcore += string(8 * DEDUP_CHUNK_SIZE, '\0');
+        vmcore += page(64).substr(0, 1000);
+
+        test.check("A dump is reconstructed from its map",
+                   [&]() {
+                       BufferDataProvider p(vmcore.data(), vmcore.size());
+                       unsigned long long found, added;
+                       string map = saveMap(&p, dir + "/dump1",
+                                            &found, &added);
+                       // the header page and 64 data pages are stored,
+                       // page 5 only once and zero pages not at all
+                       return added == 65 && found == 1 &&
+                           readFile(map).size() < 4096 &&
+                           reconstruct(map) == vmcore;
+                   });
+
+        test.check("A second dump stores only the changed pages",
+                   [&]() {
+                       string second(vmcore);
+                       second.replace(3 * DEDUP_CHUNK_SIZE, 10, "0123456789");
+                       BufferDataProvider p(second.data(), second.size());
+                       unsigned long long added;
+                       string map = saveMap(&p, dir + "/dump2",
+                                            NULL, &added);
+                       return added == 1 &&
+                           reconstruct(map) == second;
+                   });
+
+        test.check("Placed data keeps its offsets",
+                   [&]() {
+                       string stream(4096, '\0');
+                       stream.replace(0, 12, "makedumpfile");
+                       stream[23] = 1;  // type
+                       stream[31] = 1;  // version
+                       stream += flatRecord(2 * DEDUP_CHUNK_SIZE, page(7));
+                       stream += flatRecord(10, "head");
+                       putBE64(stream, -1);
+                       putBE64(stream, -1);
+                       BufferDataProvider buffer(stream.data(),
+                                                 stream.size());
+                       FlattenedDataProvider flat(&buffer);
+                       string map = saveMap(&flat, dir + "/dump3");
+
+                       string expect(3 * DEDUP_CHUNK_SIZE, '\0');
+                       expect.replace(10, 4, "head");
+                       expect.replace(2 * DEDUP_CHUNK_SIZE, DEDUP_CHUNK_SIZE,
+                                      page(7));
+                       return reconstruct(map) == expect;
+                   });
+
+        test.check("Other files are not dedup maps",
+                   [&]() {
+                       std::ofstream(dir + "/notamap") << "vmcore\n";
+                       try {
+                           reconstruct(dir + "/notamap");
+                       } catch (const KError &) {
+                           return true;
+                       }
+                       return false;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    FilePath(dir).rmdir(true);
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
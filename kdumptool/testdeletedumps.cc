@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include <unistd.h>
+
+#include "global.h"
+#include "debug.h"
+#include "configuration.h"
+#include "deletedumps.h"
+#include "fileutil.h"
+#include "stringutil.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::ofstream;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static void makeDumps(const FilePath &dir, int count)
+{
+    for (int i = 1; i <= count; ++i) {
+        FilePath dump = dir;
+        dump.appendPath("2020-01-0" + StringUtil::number2string(i) +
+                        "-00:00");
+        dump.mkdir(true);
+        dump.appendPath("vmcore");
+        ofstream(dump.c_str()) << string(4096, 'x');
+    }
+}
+
+// -----------------------------------------------------------------------------
+static size_t countDumps(const FilePath &dir)
+{
+    return dir.listDir(FilterKdumpDirs()).size();
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    char tmpl[] = "/tmp/testdeletedumps.XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        cerr << "Cannot create a temporary directory" << endl;
+        return EXIT_FAILURE;
+    }
+    FilePath dir(tmpl);
+
+    try {
+        TestRun test;
+
+        FilePath configFile = dir;
+        configFile.appendPath("kdump.conf");
+        FilePath savedir = dir;
+        savedir.appendPath("dumps");
+        ofstream(configFile.c_str())
+            << "KDUMP_SAVEDIR=\"file://" << savedir << "\"" << endl
+            << "KDUMP_KEEP_OLD_DUMPS=1" << endl;
+        Configuration::config()->readFile(configFile);
+
+        test.check("Wait until enough has been deleted",
+                   [&]() {
+                       makeDumps(savedir, 5);
+                       DeleteDumpsThread deleter("");
+                       deleter.start();
+                       bool ok = deleter.waitUntil([&]() {
+                               return countDumps(savedir) <= 3;
+                           });
+                       deleter.finish();
+                       return ok && !deleter.running() &&
+                           countDumps(savedir) == 1;
+                   });
+
+        test.check("Waiting ends when nothing more is deleted",
+                   [&]() {
+                       makeDumps(savedir, 3);
+                       DeleteDumpsThread deleter("");
+                       deleter.start();
+                       bool ok = deleter.waitUntil([]() { return false; });
+                       deleter.finish();
+                       return !ok && countDumps(savedir) == 1;
+                   });
+
+        test.check("Abandoned deletion keeps the dumps",
+                   [&]() {
+                       makeDumps(savedir, 3);
+                       size_t before = countDumps(savedir);
+                       DeleteDumpsThread deleter("");
+                       deleter.abandon();
+                       deleter.start();
+                       deleter.finish();
+                       return before > 1 && countDumps(savedir) == before;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    dir.rmdir(true);
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "global.h"
+#include "debug.h"
+#include "diskdump.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::vector;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+typedef DiskdumpDataProvider::Extent Extent;
+
+#define PAGE            4096UL
+
+// -----------------------------------------------------------------------------
+static Extent extent(unsigned long long pfn, unsigned long long pages,
+                     loff_t offset)
+{
+    Extent ret;
+    ret.pfn = pfn;
+    ret.pages = pages;
+    ret.offset = offset;
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+static bool sameExtent(const Extent &ext, unsigned long long pfn,
+                       unsigned long long pages, loff_t offset)
+{
+    return ext.pfn == pfn && ext.pages == pages && ext.offset == offset;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+
+        test.check("Extents are sorted by page frame",
+                   []() {
+                       vector<Extent> e;
+                       e.push_back(extent(100, 10, 0x10000));
+                       e.push_back(extent(0, 50, 0x200000));
+                       DiskdumpDataProvider::mergeExtents(e, PAGE);
+                       return e.size() == 2 &&
+                           sameExtent(e[0], 0, 50, 0x200000) &&
+                           sameExtent(e[1], 100, 10, 0x10000);
+                   });
+
+        test.check("Pages of the kernel image are saved once",
+                   []() {
+                       vector<Extent> e;
+                       e.push_back(extent(0, 1000, 0x1000));
+                       e.push_back(extent(200, 100, 0x400000));
+                       e.push_back(extent(900, 200, 0x800000));
+                       DiskdumpDataProvider::mergeExtents(e, PAGE);
+                       return e.size() == 2 &&
+                           sameExtent(e[0], 0, 1000, 0x1000) &&
+                           sameExtent(e[1], 1000, 100,
+                                      0x800000 + 100 * PAGE);
+                   });
+
+        test.check("Bitmap of the whole dump",
+                   []() {
+                       vector<Extent> e;
+                       e.push_back(extent(1, 2, 0));
+                       e.push_back(extent(8, 9, 0));
+                       unsigned char bitmap[4] = { 0 };
+                       DiskdumpDataProvider::setBits(bitmap, sizeof bitmap,
+                                                     0, e);
+                       return bitmap[0] == 0x06 && bitmap[1] == 0xff &&
+                           bitmap[2] == 0x01 && bitmap[3] == 0;
+                   });
+
+        test.check("Bitmap in parts",
+                   []() {
+                       vector<Extent> e;
+                       e.push_back(extent(4, 10, 0));
+                       e.push_back(extent(30, 1, 0));
+                       unsigned char first[1] = { 0 };
+                       unsigned char second[3] = { 0 };
+                       DiskdumpDataProvider::setBits(first, sizeof first,
+                                                     0, e);
+                       DiskdumpDataProvider::setBits(second, sizeof second,
+                                                     8, e);
+                       return first[0] == 0xf0 && second[0] == 0x3f &&
+                           second[1] == 0 && second[2] == 0x40;
+                   });
+
+        test.check("zlib is always supported",
+                   []() {
+                       return DiskdumpDataProvider::supported(
+                           DUMP_DH_COMPRESSED_ZLIB) &&
+                           !DiskdumpDataProvider::supported(0);
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
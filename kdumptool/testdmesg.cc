@@ -0,0 +1,343 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <stdint.h>
+
+#include <elf.h>
+#include <unistd.h>
+
+#include "global.h"
+#include "debug.h"
+#include "dmesg.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+// virtual address of the (only) PT_LOAD segment
+#define TEST_VADDR		0xffff888000000000ULL
+
+// file offset and size of the PT_LOAD segment
+#define TEST_OFFSET		4096
+#define TEST_SIZE		(128*1024)
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+//{{{ TestDump -----------------------------------------------------------------
+
+/**
+ * A minimal ELF64 dump with a VMCOREINFO note and one PT_LOAD segment.
+ */
+class TestDump {
+    string m_info;
+    string m_memory;
+
+public:
+    TestDump()
+        : m_memory(TEST_SIZE, '\0')
+    { }
+
+    void info(const string &line)
+    { m_info += line + "\n"; }
+
+    template<typename T>
+    void put(size_t offset, T val)
+    { memcpy(&m_memory[offset], &val, sizeof val); }
+
+    void putText(size_t offset, const string &data)
+    { m_memory.replace(offset, data.size(), data); }
+
+    string text(const string &name);
+};
+
+// -----------------------------------------------------------------------------
+string TestDump::text(const string &name)
+{
+    string note;
+    Elf64_Nhdr nhdr;
+    nhdr.n_namesz = sizeof "VMCOREINFO";
+    nhdr.n_descsz = m_info.size();
+    nhdr.n_type = 0;
+    note.append(reinterpret_cast<char *>(&nhdr), sizeof nhdr);
+    note.append("VMCOREINFO", sizeof "VMCOREINFO");
+    note.resize((note.size() + 3) & ~3);
+    note += m_info;
+    note.resize((note.size() + 3) & ~3);
+
+    Elf64_Ehdr ehdr;
+    memset(&ehdr, 0, sizeof ehdr);
+    memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+    ehdr.e_ident[EI_CLASS] = ELFCLASS64;
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+    ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+#else
+    ehdr.e_ident[EI_DATA] = ELFDATA2MSB;
+#endif
+    ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+    ehdr.e_type = ET_CORE;
+    ehdr.e_version = EV_CURRENT;
+    ehdr.e_phoff = sizeof ehdr;
+    ehdr.e_ehsize = sizeof ehdr;
+    ehdr.e_phentsize = sizeof(Elf64_Phdr);
+    ehdr.e_phnum = 2;
+
+    Elf64_Phdr phdr[2];
+    memset(phdr, 0, sizeof phdr);
+    phdr[0].p_type = PT_NOTE;
+    phdr[0].p_offset = sizeof ehdr + sizeof phdr;
+    phdr[0].p_filesz = note.size();
+    phdr[1].p_type = PT_LOAD;
+    phdr[1].p_offset = TEST_OFFSET;
+    phdr[1].p_vaddr = TEST_VADDR;
+    phdr[1].p_filesz = phdr[1].p_memsz = m_memory.size();
+
+    string file(reinterpret_cast<char *>(&ehdr), sizeof ehdr);
+    file.append(reinterpret_cast<char *>(phdr), sizeof phdr);
+    file += note;
+    file.resize(TEST_OFFSET);
+    file += m_memory;
+
+    char path[] = "testdmesg.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+        throw KSystemError("mkstemp() failed", errno);
+    bool ok = write(fd, file.data(), file.size()) == ssize_t(file.size());
+    close(fd);
+
+    DmesgDataProvider dmesg(path);
+    if (name == "thread")
+        dmesg.start();
+    bool done = ok && dmesg.wait();
+    unlink(path);
+    if (!done)
+        throw KError("Extraction failed: " + dmesg.error());
+    return dmesg.text();
+}
+
+//}}}
+
+// -----------------------------------------------------------------------------
+static string hex(unsigned long long addr)
+{
+    char buf[32];
+    snprintf(buf, sizeof buf, "%llx", addr);
+    return buf;
+}
+
+// -----------------------------------------------------------------------------
+static void lockless(TestDump &dump)
+{
+    const unsigned long long desc_state = 62;
+
+    dump.info("OSRELEASE=6.4.0-test");
+    dump.info("SYMBOL(prb)=" + hex(TEST_VADDR));
+    dump.info("OFFSET(printk_ringbuffer.desc_ring)=0");
+    dump.info("OFFSET(printk_ringbuffer.text_data_ring)=48");
+    dump.info("OFFSET(prb_desc_ring.count_bits)=0");
+    dump.info("OFFSET(prb_desc_ring.descs)=8");
+    dump.info("OFFSET(prb_desc_ring.infos)=16");
+    dump.info("OFFSET(prb_desc_ring.head_id)=24");
+    dump.info("OFFSET(prb_desc_ring.tail_id)=32");
+    dump.info("SIZE(prb_desc)=24");
+    dump.info("OFFSET(prb_desc.state_var)=0");
+    dump.info("OFFSET(prb_desc.text_blk_lpos)=8");
+    dump.info("OFFSET(prb_data_blk_lpos.begin)=0");
+    dump.info("OFFSET(prb_data_blk_lpos.next)=8");
+    dump.info("SIZE(printk_info)=16");
+    dump.info("OFFSET(printk_info.ts_nsec)=0");
+    dump.info("OFFSET(printk_info.text_len)=8");
+    dump.info("OFFSET(prb_data_ring.size_bits)=0");
+    dump.info("OFFSET(prb_data_ring.data)=8");
+    dump.info("OFFSET(atomic_long_t.counter)=0");
+
+    // prb points to the ring buffer structure
+    dump.put<uint64_t>(0, TEST_VADDR + 0x100);
+
+    // 4 descriptors, 64 bytes of text
+    dump.put<uint32_t>(0x100, 2);
+    dump.put<uint64_t>(0x108, TEST_VADDR + 0x200);
+    dump.put<uint64_t>(0x110, TEST_VADDR + 0x300);
+    dump.put<uint64_t>(0x118, 8);               // head_id
+    dump.put<uint64_t>(0x120, 5);               // tail_id
+    dump.put<uint32_t>(0x130, 6);
+    dump.put<uint64_t>(0x138, TEST_VADDR + 0x400);
+
+    struct {
+        unsigned long long id, state, begin, next, ts;
+        const char *text;
+    } records[] = {
+        { 5, 2, 88, 104, 1000001000ULL, "hello" },
+        { 6, 1, 104, 120, 2500000000ULL, "a\nb\x01" },
+        { 7, 2, 120, 152, 12345000000000ULL, "wrapped line" },
+        { 8, 0, 152, 168, 0, "reserved" },
+    };
+    for (size_t i = 0; i < sizeof records / sizeof records[0]; ++i) {
+        size_t idx = records[i].id & 3;
+        size_t desc = 0x200 + idx * 24;
+        dump.put<uint64_t>(desc, records[i].id |
+                           records[i].state << desc_state);
+        dump.put<uint64_t>(desc + 8, records[i].begin);
+        dump.put<uint64_t>(desc + 16, records[i].next);
+        dump.put<uint64_t>(0x300 + idx * 16, records[i].ts);
+        dump.put<uint16_t>(0x300 + idx * 16 + 8, strlen(records[i].text));
+
+        // a reserved descriptor has no data yet
+        if (records[i].state == 0)
+            continue;
+
+        // a wrapping block starts at the beginning of the ring
+        size_t begin = records[i].begin;
+        if ((begin >> 6) != (records[i].next >> 6))
+            begin = 0;
+        size_t block = 0x400 + (begin & 63);
+        dump.put<uint64_t>(block, records[i].id);
+        dump.putText(block + 8, records[i].text);
+    }
+}
+
+// -----------------------------------------------------------------------------
+static void structured(TestDump &dump)
+{
+    dump.info("OSRELEASE=5.3.18-test");
+    dump.info("SYMBOL(log_buf)=" + hex(TEST_VADDR));
+    dump.info("SYMBOL(log_buf_len)=" + hex(TEST_VADDR + 8));
+    dump.info("SYMBOL(log_first_idx)=" + hex(TEST_VADDR + 12));
+    dump.info("SYMBOL(log_next_idx)=" + hex(TEST_VADDR + 16));
+    dump.info("SIZE(printk_log)=16");
+    dump.info("OFFSET(printk_log.ts_nsec)=0");
+    dump.info("OFFSET(printk_log.len)=8");
+    dump.info("OFFSET(printk_log.text_len)=10");
+
+    dump.put<uint64_t>(0, TEST_VADDR + 0x100);
+    dump.put<uint32_t>(8, 80);
+    dump.put<uint32_t>(12, 32);
+    dump.put<uint32_t>(16, 24);
+
+    // the oldest record, then a wrap-around marker, then the newest
+    dump.put<uint64_t>(0x100 + 32, 3000000000ULL);
+    dump.put<uint16_t>(0x100 + 40, 24);
+    dump.put<uint16_t>(0x100 + 42, 5);
+    dump.putText(0x100 + 48, "older");
+    dump.put<uint16_t>(0x100 + 56 + 8, 0);
+    dump.put<uint64_t>(0x100, 4000000000ULL);
+    dump.put<uint16_t>(0x100 + 8, 24);
+    dump.put<uint16_t>(0x100 + 10, 5);
+    dump.putText(0x100 + 16, "newer");
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_TRACE);
+    try {
+        TestRun test;
+
+        const string locklessLog =
+            "[    1.000001] hello\n"
+            "[    2.500000] a.b\\x01\n"
+            "[12345.000000] wrapped line\n";
+
+        test.check("Lockless ring buffer",
+                   [&locklessLog]() {
+                       TestDump dump;
+                       lockless(dump);
+                       return dump.text("inline") == locklessLog;
+                   });
+
+        test.check("Extraction in a thread",
+                   [&locklessLog]() {
+                       TestDump dump;
+                       lockless(dump);
+                       return dump.text("thread") == locklessLog;
+                   });
+
+        test.check("Structured log buffer",
+                   []() {
+                       TestDump dump;
+                       structured(dump);
+                       return dump.text("inline") ==
+                           "[    3.000000] older\n"
+                           "[    4.000000] newer\n";
+                   });
+
+        test.check("Missing symbols are an error",
+                   []() {
+                       TestDump dump;
+                       dump.info("OSRELEASE=6.4.0-test");
+                       try {
+                           dump.text("inline");
+                       } catch (const KError &) {
+                           return true;
+                       }
+                       return false;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include <unistd.h>
+
+#include "global.h"
+#include "debug.h"
+#include "dumpcatalog.h"
+#include "fileutil.h"
+#include "stringutil.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::ofstream;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static FilePath makeDump(const FilePath &dir, const string &name,
+                         const char *file)
+{
+    FilePath dump = dir;
+    dump.appendPath(name);
+    dump.mkdir(true);
+    if (file) {
+        FilePath path = dump;
+        path.appendPath(file);
+        ofstream(path.c_str()) << string(4096, 'x');
+    }
+    return dump;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    char tmpl[] = "/tmp/testdumpcatalog.XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        cerr << "Cannot create a temporary directory" << endl;
+        return EXIT_FAILURE;
+    }
+    FilePath dir(tmpl);
+    FilePath file = dir;
+    file.appendPath(DUMP_CATALOG_FILE);
+
+    try {
+        TestRun test;
+
+        test.check("Missing catalog is built from the directory",
+                   [&]() {
+                       makeDump(dir, "2020-01-01-00:00", "vmcore");
+                       makeDump(dir, "2020-01-02-00:00", "vmcore.zst");
+                       makeDump(dir, "2020-01-03-00:00", "vmcore1");
+                       makeDump(dir, "2020-01-04-00:00", "README.txt");
+                       DumpCatalog catalog(dir);
+                       if (catalog.exists() || catalog.current())
+                           return false;
+                       catalog.rebuild();
+                       catalog.save();
+                       DumpCatalog loaded(dir);
+                       StringVector dumps = loaded.dumps();
+                       return loaded.current() && dumps.size() == 3 &&
+                           dumps[2] == "2020-01-03-00:00" &&
+                           loaded.size(dumps[0]) >= 4096 &&
+                           loaded.find(dumps[0])->crashTime > 0;
+                   });
+
+        test.check("Records are replayed",
+                   [&]() {
+                       DumpCatalog catalog(dir);
+                       DumpCatalog::Entry entry;
+                       entry.name = "2020-01-03-00:00";
+                       entry.crashTime = 1577923200;
+                       entry.size = 12345;
+                       entry.format = "compressed";
+                       entry.parts = 4;
+                       entry.checksum = "crc32c";
+                       entry.status = "ok";
+                       catalog.add(entry);
+                       FilePath(dir).appendPath("2020-01-01-00:00")
+                           .rmdir(true);
+                       catalog.remove("2020-01-01-00:00");
+
+                       DumpCatalog loaded(dir);
+                       const DumpCatalog::Entry *e =
+                           loaded.find("2020-01-03-00:00");
+                       return loaded.current() &&
+                           loaded.dumps().size() == 2 && e &&
+                           e->crashTime == 1577923200 &&
+                           loaded.size(e->name) == 12345 &&
+                           e->format == "compressed" && e->parts == 4 &&
+                           e->checksum == "crc32c" && e->status == "ok";
+                   });
+
+        test.check("A torn record is ignored",
+                   [&]() {
+                       ofstream(file.c_str(), std::ios::app)
+                           << "delete 2020-01-02";
+                       DumpCatalog loaded(dir);
+                       return loaded.exists() &&
+                           loaded.find("2020-01-02-00:00") != NULL;
+                   });
+
+        test.check("A dump is only listed once it has a dump file",
+                   [&]() {
+                       FilePath dump = makeDump(dir, "2020-01-05-00:00",
+                                                NULL);
+                       DumpCatalog catalog(dir);
+                       DumpCatalog::Entry entry;
+                       entry.name = "2020-01-05-00:00";
+                       entry.crashTime = 1578182400;
+                       entry.status = "saving";
+                       catalog.add(entry);
+                       DumpCatalog loaded(dir);
+                       size_t before = loaded.dumps().size();
+                       ofstream(FilePath(dump).appendPath("vmcore").c_str())
+                           << string(4096, 'x');
+                       return loaded.current() && before == 2 &&
+                           loaded.dumps().size() == 3 &&
+                           loaded.size(entry.name) >= 4096;
+                   });
+
+        test.check("Changes by others make the catalog outdated",
+                   [&]() {
+                       makeDump(dir, "2020-01-06-00:00", "vmcore");
+                       DumpCatalog catalog(dir);
+                       if (catalog.current())
+                           return false;
+                       catalog.rebuild();
+                       return catalog.dumps().size() == 4 &&
+                           catalog.find("2020-01-03-00:00")->parts == 4;
+                   });
+
+        test.check("A rewrite keeps the records of others",
+                   [&]() {
+                       DumpCatalog catalog(dir);
+                       catalog.rebuild();
+                       makeDump(dir, "2020-01-07-00:00", "vmcore");
+                       DumpCatalog other(dir);
+                       DumpCatalog::Entry entry;
+                       entry.name = "2020-01-07-00:00";
+                       entry.crashTime = 1578355200;
+                       entry.size = 4096;
+                       entry.status = "ok";
+                       other.add(entry);
+                       catalog.save();
+                       DumpCatalog loaded(dir);
+                       return loaded.current() &&
+                           loaded.dumps().size() == 5 &&
+                           loaded.find(entry.name) != NULL;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    dir.rmdir(true);
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "global.h"
+#include "debug.h"
+#include "dynlib.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+
+        test.check("Nothing is loaded before the first call",
+                   []() {
+                       DynamicLibrary lib("libc.so.6");
+                       return lib.find("strlen") == NULL;
+                   });
+
+        test.check("Look up a function",
+                   []() {
+                       DynamicLibrary lib("libc.so.6");
+                       typedef size_t (*strlen_t)(const char *);
+                       strlen_t fn = reinterpret_cast<strlen_t>(
+                           lib.symbol("strlen"));
+                       return fn("kdump") == 5 && lib.find("strlen") != NULL;
+                   });
+
+        test.check("Missing symbol",
+                   []() {
+                       DynamicLibrary lib("libc.so.6");
+                       try {
+                           lib.symbol("kdump_no_such_function");
+                       } catch (const KError &) {
+                           return lib.available();
+                       }
+                       return false;
+                   });
+
+        test.check("Missing library",
+                   []() {
+                       DynamicLibrary lib("libkdump-no-such-library.so.0");
+                       try {
+                           lib.symbol("strlen");
+                       } catch (const KError &e) {
+                           return !lib.available() &&
+                               strstr(e.what(), lib.soname()) != NULL;
+                       }
+                       return false;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "global.h"
+#include "debug.h"
+#include "estimate.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+#define GiB     (1ULL << 30)
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+
+        test.check("Parse --mem-usage table",
+                   []() {
+                       DumpEstimator e(16 * GiB, 4096);
+                       bool ok = e.parseStats(
+                           "TYPE\t\tPAGES\t\t\tEXCLUDABLE\tDESCRIPTION\n"
+                           "-----------------------------------------\n"
+                           "ZERO\t\t1000\t\tyes\t\tPages filled with zero\n"
+                           "FREE\t\t262144\t\tyes\t\tFree pages\n"
+                           "KERN_DATA\t5000\t\tno\t\tDumpable kernel data\n"
+                           "\n"
+                           "page size:\t\t4096\n");
+                       // level 16 drops the free pages only
+                       return ok && e.hasStats() &&
+                           e.estimate(16, "ELF", 0, 1, false).input ==
+                           15 * GiB;
+                   });
+
+        test.check("Parse --show-stats report",
+                   []() {
+                       DumpEstimator e(4 * GiB, 4096);
+                       e.parseStats(
+                           "Original pages  : 0x0000000000100000\n"
+                           "  Excluded pages   : 0x0000000000080000\n"
+                           "    Pages filled with zero  : 0x0000000000040000\n"
+                           "    Non-private cache pages : 0x0000000000000000\n"
+                           "    Private cache pages     : 0x0000000000000000\n"
+                           "    User process data pages : 0x0000000000000000\n"
+                           "    Free pages              : 0x0000000000040000\n"
+                           "  Remaining pages  : 0x0000000000080000\n");
+                       return e.estimate(31, "ELF", 0, 1, false).input ==
+                           2 * GiB;
+                   });
+
+        test.check("Unfiltered ELF without holes is exact",
+                   []() {
+                       DumpEstimator e(8 * GiB, 4096);
+                       DumpEstimator::Result r =
+                           e.estimate(0, "ELF", 0, 1, false);
+                       return r.minimum == 8 * GiB && r.size == 8 * GiB &&
+                           r.maximum == 8 * GiB;
+                   });
+
+        test.check("Sparse ELF without statistics has no lower bound",
+                   []() {
+                       DumpEstimator e(8 * GiB, 4096);
+                       return e.estimate(0, "ELF", 0, 1, true).minimum == 0;
+                   });
+
+        test.check("Compressed dump range",
+                   []() {
+                       DumpEstimator e(8 * GiB, 4096);
+                       DumpEstimator::Result r =
+                           e.estimate(31, "compressed", 0, 4, true);
+                       return r.minimum < r.size && r.size < r.maximum &&
+                           r.maximum > 8 * GiB && r.seconds > 0;
+                   });
+
+        test.check("No dump",
+                   []() {
+                       DumpEstimator e(8 * GiB, 4096);
+                       return e.estimate(31, "none", 0, 1, true).maximum == 0;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "global.h"
+#include "debug.h"
+#include "dataprovider.h"
+#include "failovertransfer.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+//{{{ FakeTransfer -------------------------------------------------------------
+
+/**
+ * Transfer that reads the data into a string, and fails when @c failAt
+ * bytes have been read (never if it is negative).
+ */
+class FakeTransfer : public Transfer {
+
+    public:
+        FakeTransfer(long failAt)
+            : m_failAt(failAt), m_files(0)
+        {}
+
+        void perform(DataProvider *dataprovider,
+                     const StringVector &target_files,
+                     bool *directSave)
+        {
+            if (directSave)
+                *directSave = false;
+            m_data.clear();
+            dataprovider->prepare();
+            char buf[4];
+            size_t ret;
+            while ((ret = dataprovider->getData(buf, sizeof buf)) > 0) {
+                m_data.append(buf, ret);
+                if (m_failAt >= 0 && m_data.size() >= (size_t)m_failAt) {
+                    dataprovider->setError(true);
+                    dataprovider->finish();
+                    throw KError("Broken pipe");
+                }
+            }
+            if (m_failAt == 0)
+                throw KError("Connection refused");
+            dataprovider->finish();
+            ++m_files;
+        }
+
+        const string &data() const
+        { return m_data; }
+
+        unsigned files() const
+        { return m_files; }
+
+    private:
+        long m_failAt;
+        string m_data;
+        unsigned m_files;
+};
+
+//}}}
+//{{{ RestartableProvider ------------------------------------------------------
+
+/**
+ * DataProvider for a string that starts over in prepare().
+ */
+class RestartableProvider : public AbstractDataProvider {
+
+    public:
+        RestartableProvider(const string &data)
+            : m_data(data), m_pos(0)
+        {}
+
+        void prepare()
+        { m_pos = 0; }
+
+        size_t getData(char *buffer, size_t maxread)
+        {
+            size_t len = m_data.copy(buffer, maxread, m_pos);
+            m_pos += len;
+            return len;
+        }
+
+        bool canRestart() const
+        { return true; }
+
+    private:
+        string m_data;
+        size_t m_pos;
+};
+
+//}}}
+
+// -----------------------------------------------------------------------------
+static TargetProbe probe(const char *name, double connect, double burst)
+{
+    TargetProbe ret;
+    ret.name = name;
+    ret.ok = true;
+    ret.connectSeconds = connect;
+    ret.burstBytes = 1 << 20;
+    ret.burstSeconds = burst;
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+
+    try {
+        TestRun test;
+
+        test.check("Targets by probe time",
+                   []() {
+                       std::vector<TargetProbe> probes;
+                       probes.push_back(probe("slow", 0.1, 2.0));
+                       probes.push_back(probe("down", 0, 0));
+                       probes.back().ok = false;
+                       probes.push_back(probe("fast", 0.5, 0.5));
+                       probes.push_back(probe("slow-login", 1.5, 0.1));
+                       std::vector<size_t> order = TargetProbe::rank(probes);
+                       return order.size() == 3 && order[0] == 2 &&
+                           order[1] == 3 && order[2] == 0 &&
+                           probes[2].rate() == 2 << 20;
+                   });
+
+        test.check("First leg keeps the files",
+                   []() {
+                       FakeTransfer *first = new FakeTransfer(-1);
+                       FakeTransfer *second = new FakeTransfer(-1);
+                       FailoverTransfer failover;
+                       failover.addLeg(first, "first");
+                       failover.addLeg(second, "second");
+                       string s = "0123456789";
+                       BufferDataProvider a(s.data(), s.size());
+                       failover.perform(&a, StringVector(1, "a"), NULL);
+                       BufferDataProvider b(s.data(), s.size());
+                       failover.perform(&b, StringVector(1, "b"), NULL);
+                       return first->files() == 2 && second->files() == 0 &&
+                           failover.currentLeg() == "first" &&
+                           failover.failedLegs().empty();
+                   });
+
+        test.check("Failure before any data",
+                   []() {
+                       FakeTransfer *first = new FakeTransfer(0);
+                       FakeTransfer *second = new FakeTransfer(-1);
+                       FailoverTransfer failover;
+                       failover.addLeg(first, "first");
+                       failover.addLeg(second, "second");
+                       string s = "";
+                       BufferDataProvider a(s.data(), s.size());
+                       failover.perform(&a, StringVector(1, "a"), NULL);
+                       return second->files() == 1 &&
+                           failover.currentLeg() == "second" &&
+                           failover.failedLegs().size() == 1;
+                   });
+
+        test.check("Restart after a broken transfer",
+                   []() {
+                       FakeTransfer *first = new FakeTransfer(4);
+                       FakeTransfer *second = new FakeTransfer(-1);
+                       FailoverTransfer failover;
+                       failover.addLeg(first, "first");
+                       failover.addLeg(second, "second");
+                       RestartableProvider provider("0123456789");
+                       failover.perform(&provider, StringVector(1, "vmcore"),
+                                        NULL);
+                       return second->data() == "0123456789" &&
+                           failover.failedLegs().front() == "first";
+                   });
+
+        test.check("No restart of a stream",
+                   []() {
+                       FakeTransfer *first = new FakeTransfer(4);
+                       FakeTransfer *second = new FakeTransfer(-1);
+                       FailoverTransfer failover;
+                       failover.addLeg(first, "first");
+                       failover.addLeg(second, "second");
+                       string s = "0123456789";
+                       BufferDataProvider provider(s.data(), s.size());
+                       try {
+                           failover.perform(&provider,
+                                            StringVector(1, "vmcore"), NULL);
+                       } catch (const KError &error) {
+                           return second->files() == 0;
+                       }
+                       return false;
+                   });
+
+        test.check("Batch starts over on the next leg",
+                   []() {
+                       FakeTransfer *first = new FakeTransfer(4);
+                       FakeTransfer *second = new FakeTransfer(-1);
+                       FailoverTransfer failover;
+                       failover.addLeg(first, "first");
+                       failover.addLeg(second, "second");
+                       ArtifactBatch artifacts;
+                       artifacts.push_back(std::make_pair("a", "01234567"));
+                       artifacts.push_back(std::make_pair("b", "xyz"));
+                       failover.performBatch(artifacts);
+                       return first->files() == 0 && second->files() == 2 &&
+                           second->data() == "xyz" &&
+                           failover.currentLeg() == "second";
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
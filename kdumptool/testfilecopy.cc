@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "global.h"
+#include "debug.h"
+#include "dataprovider.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+#define HOLE_SIZE       (4 << 20)
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static string readFile(const string &path)
+{
+    string ret;
+    int fd = open(path.c_str(), O_RDONLY);
+    char buf[65536];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof buf)) > 0)
+        ret.append(buf, n);
+    close(fd);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+
+        char dir[] = "/tmp/testfilecopy.XXXXXX";
+        if (!mkdtemp(dir))
+            throw KSystemError("mkdtemp failed", errno);
+        string source = string(dir) + "/source";
+        string target = string(dir) + "/target";
+
+        // data, a hole, data and a hole at the end
+        int fd = open(source.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        string head(8192, 'h'), tail(4096, 't');
+        if (write(fd, head.data(), head.size()) != (ssize_t)head.size() ||
+            pwrite(fd, tail.data(), tail.size(), head.size() + HOLE_SIZE) !=
+                (ssize_t)tail.size() ||
+            ftruncate(fd, head.size() + 2 * HOLE_SIZE) != 0)
+            throw KSystemError("Cannot create " + source, errno);
+        close(fd);
+
+        test.check("Regular files are copied by the kernel",
+                   [&]() {
+                       FileDataProvider file(source.c_str());
+                       FileDataProvider proc("/proc/self/status");
+                       return file.canSaveToFile() && !proc.canSaveToFile();
+                   });
+
+        test.check("Copy has the same content",
+                   [&]() {
+                       FileDataProvider dp(source.c_str());
+                       CountingDataProvider counted(&dp);
+                       counted.saveToFile(StringVector(1, target));
+                       return readFile(target) == readFile(source) &&
+                           counted.bytes() == head.size() + 2 * HOLE_SIZE;
+                   });
+
+        test.check("Holes are preserved",
+                   [&]() {
+                       struct stat ss, ts;
+                       if (stat(source.c_str(), &ss) != 0 ||
+                           stat(target.c_str(), &ts) != 0)
+                           return false;
+                       // only if the file system has holes at all
+                       return ss.st_blocks * 512 >= ss.st_size ||
+                           ts.st_blocks <= ss.st_blocks;
+                   });
+
+        test.check("Missing source",
+                   [&]() {
+                       FileDataProvider dp((source + ".missing").c_str());
+                       try {
+                           dp.saveToFile(StringVector(1, target));
+                       } catch (const KError &) {
+                           return !dp.canSaveToFile();
+                       }
+                       return false;
+                   });
+
+        unlink(source.c_str());
+        unlink(target.c_str());
+        rmdir(dir);
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <stdint.h>
+
+#include "global.h"
+#include "debug.h"
+#include "dataprovider.h"
+#include "flattened.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static void putBE64(string &s, int64_t val)
+{
+    for (int shift = 56; shift >= 0; shift -= 8)
+        s.push_back(char((uint64_t)val >> shift));
+}
+
+// -----------------------------------------------------------------------------
+static string flatHeader(void)
+{
+    string ret("makedumpfile");
+    ret.resize(16);
+    putBE64(ret, 1);            // type
+    putBE64(ret, 1);            // version
+    ret.resize(4096);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+static string flatRecord(int64_t offset, const string &data)
+{
+    string ret;
+    putBE64(ret, offset);
+    putBE64(ret, data.size());
+    return ret + data;
+}
+
+// -----------------------------------------------------------------------------
+static string flatEnd(void)
+{
+    string ret;
+    putBE64(ret, -1);
+    putBE64(ret, -1);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+static string unflatten(const string &stream, size_t bufsize)
+{
+    BufferDataProvider buffer(stream.data(), stream.size());
+    FlattenedDataProvider flat(&buffer);
+    string file;
+    char buf[16];
+    off_t offset;
+    size_t len;
+
+    flat.prepare();
+    while ((len = flat.getPlacedData(buf, std::min(bufsize, sizeof buf),
+                                     &offset)) != 0) {
+        if (file.size() < offset + len)
+            file.resize(offset + len);
+        file.replace(offset, len, buf, len);
+    }
+    flat.finish();
+    return file;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_TRACE);
+    try {
+        TestRun test;
+
+        const string stream = flatHeader() +
+            flatRecord(0, "header") +
+            flatRecord(20, "data after a hole") +
+            flatRecord(2, "ADE") +
+            flatEnd();
+        string expected("heADEr");
+        expected.resize(20);
+        expected += "data after a hole";
+
+        test.check("Records are placed at their offsets",
+                   [&stream, &expected]() {
+                       return unflatten(stream, 16) == expected;
+                   });
+
+        test.check("Records are split by a small buffer",
+                   [&stream, &expected]() {
+                       return unflatten(stream, 5) == expected;
+                   });
+
+        test.check("getData() returns the flattened stream",
+                   [&stream]() {
+                       BufferDataProvider buffer(stream.data(),
+                                                 stream.size());
+                       FlattenedDataProvider flat(&buffer);
+                       string out;
+                       char buf[100];
+                       size_t len;
+
+                       flat.prepare();
+                       while ((len = flat.getData(buf, sizeof buf)) != 0)
+                           out.append(buf, len);
+                       flat.finish();
+                       return out == stream && !flat.placed();
+                   });
+
+        test.check("Missing end record is an error",
+                   [&stream]() {
+                       try {
+                           unflatten(stream.substr(0, stream.size() - 16),
+                                     16);
+                       } catch (const KError &) {
+                           return true;
+                       }
+                       return false;
+                   });
+
+        test.check("Other formats are rejected",
+                   [&expected]() {
+                       string elf = expected;
+                       elf.resize(8192);
+                       try {
+                           unflatten(elf, 16);
+                       } catch (const KError &) {
+                           return true;
+                       }
+                       return false;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <zlib.h>
+
+#include "global.h"
+#include "debug.h"
+#include "ikconfig.h"
+
+#if HAVE_LZMA
+#  include <lzma.h>
+#endif
+#if HAVE_ZSTD
+#  include <zstd.h>
+#endif
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static string filler(size_t len, unsigned seed)
+{
+    string ret(len, '\0');
+    for (size_t i = 0; i < len; ++i) {
+        seed = seed * 1103515245 + 12345;
+        ret[i] = seed >> 16;
+    }
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+static string gzip(const string &data)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof stream);
+    if (deflateInit2(&stream, 9, Z_DEFLATED, 16 + MAX_WBITS, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+        throw KError("deflateInit2() failed");
+
+    string ret(deflateBound(&stream, data.size()), '\0');
+    stream.next_in = (Bytef *)data.data();
+    stream.avail_in = data.size();
+    stream.next_out = (Bytef *)&ret[0];
+    stream.avail_out = ret.size();
+    int err = deflate(&stream, Z_FINISH);
+    deflateEnd(&stream);
+    if (err != Z_STREAM_END)
+        throw KError("deflate() failed");
+    ret.resize(stream.total_out);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+static bool readImage(const string &image, const string &expected)
+{
+    IkconfigReader reader(
+        reinterpret_cast<const unsigned char *>(image.data()), image.size());
+    return reader.readImage() && reader.data() == expected;
+}
+
+// -----------------------------------------------------------------------------
+static bool readEmbedded(const string &image, const string &expected)
+{
+    IkconfigReader reader(
+        reinterpret_cast<const unsigned char *>(image.data()), image.size());
+    return reader.readEmbedded() && reader.data() == expected;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+
+        const string ikconfig = gzip("CONFIG_IKCONFIG=y\n"
+                                     "# CONFIG_IKHEADERS is not set\n");
+        const string vmlinux = filler(300000, 1) + "IKCFG_ST" + ikconfig +
+            "IKCFG_ED" + filler(100000, 2);
+
+        // a gzip magic that does not start a valid stream
+        const string setup = filler(4096, 3) + "\x1f\x8b\x08" + string(1, 0) +
+            filler(1000, 4);
+
+        test.check("Uncompressed image",
+                   [&]() {
+                       return readImage(vmlinux, ikconfig);
+                   });
+
+        test.check("gzip compressed image",
+                   [&]() {
+                       return readImage(gzip(vmlinux), ikconfig);
+                   });
+
+        test.check("Marker across a buffer boundary",
+                   [&]() {
+                       string image = filler(65536 - 3, 5) + "IKCFG_ST" +
+                           ikconfig + "IKCFG_ED";
+                       return readImage(gzip(image), ikconfig);
+                   });
+
+        test.check("gzip payload after a false magic",
+                   [&]() {
+                       return readEmbedded(setup + gzip(vmlinux) +
+                                           filler(512, 6), ikconfig);
+                   });
+
+#if HAVE_LZMA
+        test.check("xz payload",
+                   [&]() {
+                       string xz(vmlinux.size() + 4096, '\0');
+                       size_t pos = 0;
+                       if (lzma_easy_buffer_encode(
+                               6, LZMA_CHECK_CRC32, NULL,
+                               (const uint8_t *)vmlinux.data(),
+                               vmlinux.size(), (uint8_t *)&xz[0], &pos,
+                               xz.size()) != LZMA_OK)
+                           throw KError("lzma_easy_buffer_encode() failed");
+                       xz.resize(pos);
+                       return readEmbedded(setup + xz, ikconfig);
+                   });
+#endif
+
+#if HAVE_ZSTD
+        test.check("zstd payload",
+                   [&]() {
+                       string zst(ZSTD_compressBound(vmlinux.size()), '\0');
+                       size_t len = ZSTD_compress(&zst[0], zst.size(),
+                                                  vmlinux.data(),
+                                                  vmlinux.size(), 19);
+                       if (ZSTD_isError(len))
+                           throw KError("ZSTD_compress() failed");
+                       zst.resize(len);
+                       return readEmbedded(setup + zst, ikconfig);
+                   });
+#endif
+
+        test.check("Kernel without IKCONFIG",
+                   [&]() {
+                       string image = setup + gzip(filler(200000, 7));
+                       IkconfigReader reader(
+                           reinterpret_cast<const unsigned char *>(
+                               image.data()), image.size());
+                       return !reader.readEmbedded();
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <zlib.h>
+
+#include "global.h"
+#include "debug.h"
+#include "kconfig.h"
+#include "stringutil.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::ostringstream;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+// Compresses like IKCONFIG (a raw deflate stream)
+static string deflateRaw(const string &data)
+{
+    z_stream stream;
+    stream.zalloc = NULL;
+    stream.zfree = NULL;
+    stream.opaque = NULL;
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS,
+                     8, Z_DEFAULT_STRATEGY) != Z_OK)
+        throw KError("deflateInit2() failed");
+
+    string out(deflateBound(&stream, data.size()), '\0');
+    stream.next_in = (Bytef *)data.data();
+    stream.avail_in = data.size();
+    stream.next_out = (Bytef *)&out[0];
+    stream.avail_out = out.size();
+    int ret = deflate(&stream, Z_FINISH);
+    deflateEnd(&stream);
+    if (ret != Z_STREAM_END)
+        throw KError("deflate() failed");
+    out.resize(stream.total_out);
+    return out;
+}
+
+// -----------------------------------------------------------------------------
+// A configuration with the RELOCATABLE option near the start
+static string bigConfig(unsigned lines)
+{
+    ostringstream ss;
+    ss << "#" << endl
+       << "# Automatically generated file; DO NOT EDIT." << endl
+       << "#" << endl
+       << "CONFIG_RELOCATABLE=y" << endl;
+    for (unsigned i = 0; i < lines; ++i)
+        ss << "CONFIG_OPTION_" << i << "=" << i << endl;
+    ss << "CONFIG_LAST=\"end\"" << endl;
+    return ss.str();
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+
+        test.check("Value types",
+                   []() {
+                       KconfigQuery q(StringVector {
+                               "CONFIG_A", "CONFIG_B", "CONFIG_C",
+                               "CONFIG_D", "CONFIG_E"
+                           });
+                       q.readFromString(
+                           "CONFIG_A=y\n"
+                           "CONFIG_AB=m\n"
+                           "CONFIG_B=m\n"
+                           "# CONFIG_C is not set\n"
+                           "CONFIG_D=42\n"
+                           "CONFIG_E=\"text\"\n");
+                       return q.complete() &&
+                           q.get("CONFIG_A").getTristateValue() ==
+                           KconfigValue::ON &&
+                           q.get("CONFIG_B").getTristateValue() ==
+                           KconfigValue::MODULE &&
+                           q.get("CONFIG_C").getTristateValue() ==
+                           KconfigValue::OFF &&
+                           q.get("CONFIG_D").getIntValue() == 42 &&
+                           q.get("CONFIG_E").getStringValue() == "text";
+                   });
+
+        test.check("Stops when all options are found",
+                   []() {
+                       KconfigQuery q(StringVector { "CONFIG_A" });
+                       // the invalid line would throw if it was parsed
+                       q.readFromString("CONFIG_A=y\n# CONFIG_A\nCONFIG_A\n");
+                       return q.complete() &&
+                           q.get("CONFIG_A").getType() ==
+                           KconfigValue::T_TRISTATE;
+                   });
+
+        test.check("Missing option",
+                   []() {
+                       KconfigQuery q(StringVector { "CONFIG_A", "CONFIG_X" });
+                       q.readFromString("CONFIG_A=y\nCONFIG_XY=y\n");
+                       return !q.complete() &&
+                           q.get("CONFIG_X").getType() ==
+                           KconfigValue::T_INVALID &&
+                           q.get("CONFIG_UNKNOWN").getType() ==
+                           KconfigValue::T_INVALID;
+                   });
+
+        test.check("Many options",
+                   []() {
+                       StringVector names;
+                       ostringstream ss;
+                       for (unsigned i = 0; i < 300; ++i) {
+                           string name = "CONFIG_OPT" +
+                               StringUtil::number2string(i);
+                           names.push_back(name);
+                           ss << name << '=' << i << endl;
+                       }
+                       KconfigQuery q(names);
+                       q.readFromString(ss.str());
+                       return q.complete() &&
+                           q.get("CONFIG_OPT299").getIntValue() == 299;
+                   });
+
+        test.check("Compressed configuration, early option",
+                   []() {
+                       string data = deflateRaw(bigConfig(200000));
+                       KconfigQuery q(StringVector { "CONFIG_RELOCATABLE" });
+                       q.readFromDeflate(data.data(), data.size());
+                       return q.complete() &&
+                           q.get("CONFIG_RELOCATABLE").getTristateValue() ==
+                           KconfigValue::ON;
+                   });
+
+        test.check("Compressed configuration, last line",
+                   []() {
+                       string config = bigConfig(20000);
+                       // no newline after the last line
+                       config.resize(config.size() - 1);
+                       string data = deflateRaw(config);
+                       KconfigQuery q(StringVector {
+                               "CONFIG_LAST", "CONFIG_NONE"
+                           });
+                       q.readFromDeflate(data.data(), data.size());
+                       return q.get("CONFIG_LAST").getStringValue() == "end" &&
+                           !q.complete();
+                   });
+
+        test.check("Truncated compressed configuration",
+                   []() {
+                       string data = deflateRaw(bigConfig(20000));
+                       KconfigQuery q(StringVector { "CONFIG_LAST" });
+                       try {
+                           q.readFromDeflate(data.data(), data.size() / 2);
+                       } catch (const KError &) {
+                           return true;
+                       }
+                       return false;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include <unistd.h>
+
+#include "global.h"
+#include "debug.h"
+#include "fileutil.h"
+#include "kernelcache.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static void writeFile(const string &name, const string &data)
+{
+    std::ofstream fout(name.c_str(), std::ios::binary | std::ios::trunc);
+    fout << data;
+    fout.close();
+    if (!fout)
+        throw KError("Cannot write " + name + ".");
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+
+    char tmpl[] = "testkernelcache.XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        cerr << "mkdtemp() failed" << endl;
+        return EXIT_FAILURE;
+    }
+    FilePath dir(tmpl);
+    string image = FilePath(dir).appendPath("vmlinuz");
+    string cache = FilePath(dir).appendPath("cache");
+
+    try {
+        TestRun test;
+
+        writeFile(image, "not really a kernel");
+        const string config = "CONFIG_A=y\n\n# CONFIG_B is not set\n";
+
+        test.check("Values are stored",
+                   [&]() {
+                       KernelCache first(image, cache);
+                       string value;
+                       if (first.get("config", value))
+                           return false;
+                       first.set("config", config);
+                       first.set("type", "2");
+                       first.save();
+
+                       KernelCache second(image, cache);
+                       string type;
+                       return second.get("config", value) &&
+                           value == config &&
+                           second.get("type", type) && type == "2";
+                   });
+
+        test.check("Changed image invalidates the entry",
+                   [&]() {
+                       // change the size, the mtime may be the same
+                       writeFile(image, "a different kernel image");
+                       KernelCache cached(image, cache);
+                       string value;
+                       return !cached.get("config", value);
+                   });
+
+        test.check("Unwritable cache is ignored",
+                   [&]() {
+                       KernelCache cached(image, "/nonexistent/kdump");
+                       cached.set("type", "1");
+                       cached.save();
+                       string value;
+                       return cached.get("type", value) && value == "1";
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    dir.rmdir(true);
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+
+#include <cstdlib>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "global.h"
+#include "debug.h"
+#include "luksheader.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+/**
+ * Writes a LUKS image with a 16 KiB header and @p json as metadata.
+ */
+static void writeImage(const string &path, int version, const string &json)
+{
+    string image(16384, '\0');
+    memcpy(&image[0], "LUKS\xba\xbe", 6);
+    image[7] = version;
+    image[14] = 0x40;           // hdr_size 0x4000, big endian
+    image.replace(4096, json.size(), json);
+
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+        throw KSystemError("Cannot create " + path, errno);
+    ssize_t ret = write(fd, image.data(), image.size());
+    close(fd);
+    if (ret != (ssize_t)image.size())
+        throw KError("Cannot write " + path);
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    char path[] = "/tmp/testluksheader.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        cerr << "Cannot create a temporary file" << endl;
+        return EXIT_FAILURE;
+    }
+    close(fd);
+
+    try {
+        TestRun test;
+
+        test.check("Largest Argon2 memory cost",
+                   [&]() {
+                       writeImage(path, 2,
+                           "{\"keyslots\":{"
+                           "\"0\":{\"type\":\"luks2\",\"kdf\":{"
+                           "\"type\":\"argon2id\",\"time\":4,"
+                           "\"memory\":524288,\"cpus\":4}},"
+                           "\"1\":{\"type\":\"luks2\",\"kdf\":{"
+                           "\"type\":\"argon2i\",\"memory\": 1048576}},"
+                           "\"2\":{\"type\":\"luks2\",\"kdf\":{"
+                           "\"type\":\"pbkdf2\",\"iterations\":1000}}},"
+                           "\"segments\":{},\"digests\":{},"
+                           "\"config\":{\"json_size\":\"12288\"}}");
+                       LuksHeader header(path);
+                       return header.version() == 2 &&
+                           header.memory() == 1048576;
+                   });
+
+        test.check("LUKS1 needs no memory",
+                   [&]() {
+                       writeImage(path, 1, string());
+                       LuksHeader header(path);
+                       return header.version() == 1 && header.memory() == 0;
+                   });
+
+        test.check("Not a LUKS device",
+                   [&]() {
+                       writeImage(path, 2, string());
+                       if (::truncate(path, 0) != 0)
+                           return false;
+                       try {
+                           LuksHeader header(path);
+                       } catch (KError &e) {
+                           return true;
+                       }
+                       return false;
+                   });
+
+        test.check("Only keys of the keyslots count",
+                   []() {
+                       return LuksHeader::keyslotMemory(
+                           "{\"keyslots\":{\"0\":{\"kdf\":{"
+                           "\"type\":\"memory\",\"salt\":\"}\","
+                           "\"memory\":5}}},"
+                           "\"tokens\":{\"0\":{\"memory\":99}}}") == 5;
+                   });
+
+        test.check("Truncated keyslots",
+                   []() {
+                       try {
+                           LuksHeader::keyslotMemory(
+                               "{\"keyslots\":{\"0\":{\"memory\":5}");
+                       } catch (KError &e) {
+                           return true;
+                       }
+                       return false;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    unlink(path);
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include "global.h"
+#include "debug.h"
+#include "fileutil.h"
+#include "memoryhistory.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static string stats(const string &host, const string &status,
+                    unsigned long long available)
+{
+    return "{\n"
+        "  \"version\": 1,\n"
+        "  \"crash_time\": 1234567890,\n"
+        "  \"host\": \"" + host + "\",\n"
+        "  \"dump_level\": 31,\n"
+        "  \"dump_format\": \"compressed\",\n"
+        "  \"mem_total_kb\": 400000,\n"
+        "  \"status\": \"" + status + "\",\n"
+        "  \"seconds\": 12.000,\n"
+        "  \"memory\": { \"samples\": 12, \"min_available_kb\": " +
+        std::to_string(available) + ", \"max_dirty_kb\": 30000, "
+        "\"max_writeback_kb\": 2000, \"max_slab_kb\": 9000, "
+        "\"max_rss_kb\": 15000, \"max_makedumpfile_rss_kb\": 40000 },\n"
+        "  \"phases\": [\n"
+        "    { \"name\": \"dump\", \"start\": 1.000, \"seconds\": 10.000, "
+        "\"bytes\": 0, \"ok\": true,\n"
+        "      \"memory\": { \"samples\": 10, \"min_available_kb\": 1, "
+        "\"max_dirty_kb\": 1, \"max_writeback_kb\": 1, \"max_slab_kb\": 1, "
+        "\"max_rss_kb\": 1, \"max_makedumpfile_rss_kb\": 1 } }\n"
+        "  ],\n"
+        "  \"transfers\": [\n"
+        "  ]\n"
+        "}\n";
+}
+
+// -----------------------------------------------------------------------------
+static void writeStats(const FilePath &dir, const string &dump,
+                       const string &contents)
+{
+    FilePath path(dir);
+    path.appendPath(dump);
+    path.mkdir(true);
+    path.appendPath("stats.json");
+    std::ofstream(path.c_str()) << contents;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    char tmpl[] = "/tmp/testmemoryhistory.XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        cerr << "Cannot create a temporary directory" << endl;
+        return EXIT_FAILURE;
+    }
+    FilePath dir(tmpl);
+
+    try {
+        TestRun test;
+
+        test.check("Peaks of the whole save",
+                   []() {
+                       MemoryHistory::Dump dump;
+                       return MemoryHistory::parse(
+                           stats("host.example.com", "ok", 150000), dump) &&
+                           dump.host == "host.example.com" &&
+                           dump.format == "compressed" &&
+                           dump.status == "ok" && dump.level == 31 &&
+                           dump.memTotal == 400000 &&
+                           dump.minAvailable == 150000 &&
+                           dump.pageCache == 32000 && dump.rss == 55000;
+                   });
+
+        test.check("Triage stats without memory",
+                   []() {
+                       MemoryHistory::Dump dump;
+                       return !MemoryHistory::parse(
+                           "{\n  \"host\": \"host\",\n"
+                           "  \"status\": \"saving\"\n}\n", dump);
+                   });
+
+        test.check("Only comparable dumps",
+                   []() {
+                       MemoryHistory history("host", "compressed", 31);
+                       MemoryHistory::Dump dump;
+                       MemoryHistory::parse(stats("host.example.com", "ok",
+                                                  150000), dump);
+                       bool ok = history.add(dump, "same host");
+                       dump.host = "other";
+                       ok = ok && !history.add(dump, "other host");
+                       dump.host = "host";
+                       dump.format = "ELF";
+                       ok = ok && !history.add(dump, "other format");
+                       dump.format = "compressed";
+                       dump.status = "failed";
+                       ok = ok && !history.add(dump, "failed");
+                       return ok && history.size() == 1;
+                   });
+
+        test.check("Any format with auto",
+                   []() {
+                       MemoryHistory history("host", "auto", 31);
+                       MemoryHistory::Dump dump;
+                       MemoryHistory::parse(stats("host", "ok", 150000),
+                                            dump);
+                       return history.add(dump, "auto");
+                   });
+
+        test.check("Dumps of a collector",
+                   [&dir]() {
+                       writeStats(dir, "10.0.0.1-2026-01-01-10:00",
+                                  stats("host", "ok", 150000));
+                       writeStats(dir, "10.0.0.1-2026-02-01-10:00",
+                                  stats("host", "truncated", 10000));
+                       writeStats(dir, "10.0.0.2-2026-02-01-10:00",
+                                  stats("other", "ok", 5000));
+                       MemoryHistory history("host", "compressed", 31);
+                       history.addDir(dir);
+                       return history.size() == 2 &&
+                           history.rss() == 55000 &&
+                           history.pageCache() == 32000 &&
+                           history.shortfall(5) == 10000 &&
+                           history.shortfall(2) == 0;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    dir.rmdir(true);
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "global.h"
+#include "debug.h"
+#include "fileutil.h"
+#include "memorywatch.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static void writeFile(const FilePath &dir, const string &name,
+                      const string &contents)
+{
+    FilePath path(dir);
+    path.appendPath(name);
+    FilePath(path.dirName()).mkdir(true);
+    std::ofstream(path.c_str()) << contents;
+}
+
+// -----------------------------------------------------------------------------
+static string status(unsigned long rss)
+{
+    std::ostringstream ss;
+    ss << "Name:\tprocess\n"
+       << "VmHWM:\t  " << rss * 2 << " kB\n"
+       << "VmRSS:\t  " << rss << " kB\n";
+    return ss.str();
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    char tmpl[] = "/tmp/testmemorywatch.XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        cerr << "Cannot create a temporary directory" << endl;
+        return EXIT_FAILURE;
+    }
+    FilePath proc(tmpl);
+
+    try {
+        TestRun test;
+
+        writeFile(proc, "meminfo",
+                  "MemTotal:         500000 kB\n"
+                  "MemFree:          200000 kB\n"
+                  "MemAvailable:     300000 kB\n"
+                  "Dirty:               128 kB\n"
+                  "Writeback:            64 kB\n"
+                  "WritebackTmp:          1 kB\n"
+                  "Slab:              12000 kB\n");
+        writeFile(proc, "self/status", status(8000));
+        writeFile(proc, "1/comm", "systemd\n");
+        writeFile(proc, "1/status", status(9000));
+        writeFile(proc, "42/comm", "makedumpfile\n");
+        writeFile(proc, "42/status", status(30000));
+        writeFile(proc, "43/comm", "makedumpfile\n");
+        writeFile(proc, "43/status", status(1000));
+
+        test.check("Value of a key",
+                   []() {
+                       std::istringstream iss("Dirty: 12 kB\n"
+                                              "Writeback: 34 kB\n");
+                       return MemoryWatch::parseKb(iss, "Writeback") == 34;
+                   });
+
+        test.check("Key with a common prefix",
+                   []() {
+                       std::istringstream iss("WritebackTmp: 5 kB\n"
+                                              "Writeback: 34 kB\n");
+                       return MemoryWatch::parseKb(iss, "Writeback") == 34;
+                   });
+
+        test.check("Missing key",
+                   []() {
+                       std::istringstream iss("Dirty: 12 kB\n");
+                       return MemoryWatch::parseKb(iss, "Slab") == 0;
+                   });
+
+        test.check("Sample of a procfs",
+                   [&proc]() {
+                       MemoryWatch watch(proc);
+                       SaveStats::Memory m = watch.sample();
+                       return m.available == 300000 && m.dirty == 128 &&
+                           m.writeback == 64 && m.slab == 12000 &&
+                           m.rss == 8000 && m.helperRss == 31000;
+                   });
+
+        test.check("Samples go to stats.json",
+                   [&proc]() {
+                       SaveStats *stats = SaveStats::stats();
+                       stats->clear();
+                       {
+                           MemoryWatch watch(proc);
+                           watch.start();
+                       }
+                       string json = stats->json();
+                       return json.find("\"mem_total_kb\": 500000,") !=
+                           string::npos &&
+                           json.find("\"memory\": { \"samples\": 2, "
+                                     "\"min_available_kb\": 300000") !=
+                           string::npos;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    proc.rmdir(true);
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
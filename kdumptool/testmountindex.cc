@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+
+#include <cstdlib>
+#include <cerrno>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "global.h"
+#include "debug.h"
+#include "mounts.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+//{{{ FileMountTable -----------------------------------------------------------
+
+/**
+ * Mount table read from a file in fstab format.
+ */
+class FileMountTable : public MountTable {
+    public:
+        FileMountTable(const string &path)
+        {
+            if (mnt_table_parse_file(m_tb, path.c_str()) != 0)
+                throw KError("Cannot parse " + path);
+        }
+};
+
+//}}}
+
+// -----------------------------------------------------------------------------
+static string source(MountPoint mp)
+{
+    return mp ? mp.source() : "(none)";
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    char dir[] = "/tmp/testmountindex.XXXXXX";
+    try {
+        TestRun test;
+
+        if (!mkdtemp(dir))
+            throw KSystemError("mkdtemp() failed", errno);
+        string base = FilePath(dir).getCanonicalPath();
+        mkdir((base + "/crash").c_str(), 0755);
+        mkdir((base + "/crashx").c_str(), 0755);
+        mkdir((base + "/proc").c_str(), 0755);
+
+        string fstab = base + "/fstab";
+        FILE *f = fopen(fstab.c_str(), "w");
+        if (!f)
+            throw KSystemError("fopen() failed", errno);
+        fprintf(f, "/dev/root / ext4 defaults 0 0\n");
+        fprintf(f, "/dev/base %s xfs defaults 0 0\n", base.c_str());
+        fprintf(f, "/dev/crash %s/crash xfs defaults 0 0\n", base.c_str());
+        fprintf(f, "proc %s/proc proc defaults 0 0\n", base.c_str());
+        fprintf(f, "/dev/swap none swap sw 0 0\n");
+        fprintf(f, "/dev/over %s/crash xfs defaults 0 0\n", base.c_str());
+        fclose(f);
+
+        MountIndex index((FileMountTable(fstab)));
+
+        test.check("Pseudo filesystems and swap are not indexed",
+                   [&]() {
+                       return index.size() == 3;
+                   });
+
+        test.check("Longest prefix wins",
+                   [&]() {
+                       return source(index.find(base + "/crash/1/vmcore")) ==
+                           "/dev/over" &&
+                           source(index.find(base + "/other")) ==
+                           "/dev/base" &&
+                           source(index.find("/usr")) == "/dev/root";
+                   });
+
+        test.check("Prefixes match whole components",
+                   [&]() {
+                       return source(index.find(base + "/crashx")) ==
+                           "/dev/base";
+                   });
+
+        test.check("Mount under a pseudo filesystem",
+                   [&]() {
+                       return source(index.find(base + "/proc/1")) ==
+                           "/dev/base";
+                   });
+
+        test.check("Canonical target is precomputed",
+                   [&]() {
+                       MountPoint mp = index.find(base + "/crash");
+                       return mp.canonicalTarget() == base + "/crash";
+                   });
+
+        unlink(fstab.c_str());
+        rmdir((base + "/crash").c_str());
+        rmdir((base + "/crashx").c_str());
+        rmdir((base + "/proc").c_str());
+        rmdir(dir);
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "global.h"
+#include "debug.h"
+#include "multipath.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+//{{{ JoinHandler --------------------------------------------------------------
+
+/**
+ * Records each line as its tokens joined by '|', one line per entry.
+ */
+class JoinHandler : public MultipathConf::Handler {
+    public:
+        StringVector lines;
+        string raw;
+
+        void process(std::string_view line,
+                     const MultipathConf::TokenVector &tokens)
+        {
+            raw.append(line);
+            string joined;
+            MultipathConf::TokenVector::const_iterator it;
+            for (it = tokens.begin(); it != tokens.end(); ++it)
+                joined += (it == tokens.begin() ? "" : "|") + string(*it);
+            lines.push_back(joined);
+        }
+};
+
+//}}}
+
+// -----------------------------------------------------------------------------
+static StringVector parse(const string &data, string *raw = NULL)
+{
+    MultipathConf conf(data);
+    JoinHandler handler;
+    conf.process(handler);
+    if (raw)
+        *raw = handler.raw;
+    return handler.lines;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+
+        test.check("Keywords, groups and strings",
+                   []() {
+                       StringVector l = parse(
+                           "blacklist {\n\twwid \"^3600 .*\"\n}x\n");
+                       return l.size() == 4 && l[0] == "blacklist|{" &&
+                           l[1] == "wwid|\"|^3600 .*|\"" && l[2] == "}|x" &&
+                           l[3].empty();
+                   });
+
+        test.check("Comments, also at the start of a string",
+                   []() {
+                       StringVector l = parse("a # b\n\"!c\" d\n! e\n");
+                       return l.size() == 4 && l[0] == "a" &&
+                           l[1] == "\"" && l[2].empty();
+                   });
+
+        test.check("CR ends a line",
+                   []() {
+                       StringVector l = parse("a\r\nb\n");
+                       return l.size() == 4 && l[0] == "a" &&
+                           l[1].empty() && l[2] == "b";
+                   });
+
+        test.check("Unterminated last line is passed but not parsed",
+                   []() {
+                       string raw;
+                       StringVector l = parse("a\nb c", &raw);
+                       return l.size() == 2 && l[0] == "a" &&
+                           l[1].empty() && raw == "a\nb c";
+                   });
+
+        test.check("NUL ends the parsed part of a line",
+                   []() {
+                       StringVector l = parse(string("a\0b\nc\n", 6));
+                       return l.size() == 3 && l[0] == "a" && l[1] == "c";
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
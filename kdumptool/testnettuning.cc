@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "global.h"
+#include "debug.h"
+#include "nettuning.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+
+        test.check("Empty specification",
+                   []() {
+                       return NetTuning("", "collector").empty() &&
+                           NetTuning().empty();
+                   });
+
+        test.check("All settings",
+                   []() {
+                       NetTuning t("cc=bbr sndbuf=4M lowat=128k",
+                                   "collector");
+                       return t.congestion() == "bbr" &&
+                           t.sndbuf() == 4UL << 20 &&
+                           t.notsentLowat() == 128UL << 10;
+                   });
+
+        test.check("Host-specific settings",
+                   []() {
+                       const char spec[] =
+                           "sndbuf=1M sndbuf=16M@far cc=bbr@far";
+                       NetTuning far(spec, "far");
+                       NetTuning near(spec, "near");
+                       return far.sndbuf() == 16UL << 20 &&
+                           far.congestion() == "bbr" &&
+                           near.sndbuf() == 1UL << 20 &&
+                           near.congestion().empty();
+                   });
+
+        test.check("Later words override earlier ones",
+                   []() {
+                       NetTuning t("lowat=16K@host lowat=1G", "host");
+                       return t.notsentLowat() == 1UL << 30;
+                   });
+
+        test.check("IPv6 literal host",
+                   []() {
+                       NetTuning t("cc=bbr@[fd00::1]", "[fd00::1]");
+                       return t.congestion() == "bbr";
+                   });
+
+        test.check("Invalid size",
+                   []() {
+                       try {
+                           NetTuning("sndbuf=4X", "host");
+                       } catch (const KError &) {
+                           return true;
+                       }
+                       return false;
+                   });
+
+        test.check("Unknown setting",
+                   []() {
+                       try {
+                           NetTuning("rcvbuf=4M", "host");
+                       } catch (const KError &) {
+                           return true;
+                       }
+                       return false;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+
+#include <unistd.h>
+
+#include "global.h"
+#include "debug.h"
+#include "notification.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+typedef std::chrono::steady_clock Clock;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+        NotificationQueue *queue = NotificationQueue::queue();
+        std::mutex mutex;
+        std::vector<int> sent;
+
+        test.check("Notifications are sent in order",
+                   [&]() {
+                       for (int i = 0; i < 3; ++i)
+                           queue->post("test", [&, i]() {
+                                   usleep(10000);
+                                   std::lock_guard<std::mutex> lock(mutex);
+                                   sent.push_back(i);
+                               });
+                       bool ok = queue->wait(std::chrono::seconds(5));
+                       std::lock_guard<std::mutex> lock(mutex);
+                       return ok && queue->idle() &&
+                           sent == std::vector<int>({ 0, 1, 2 });
+                   });
+
+        test.check("A failed notification does not stop the queue",
+                   [&]() {
+                       sent.clear();
+                       queue->post("test", []() {
+                               throw KError("relay down");
+                           });
+                       queue->post("test", [&]() {
+                               std::lock_guard<std::mutex> lock(mutex);
+                               sent.push_back(3);
+                           });
+                       bool ok = queue->wait(std::chrono::seconds(5));
+                       std::lock_guard<std::mutex> lock(mutex);
+                       return ok && sent == std::vector<int>({ 3 });
+                   });
+
+        test.check("Posting does not wait",
+                   [&]() {
+                       Clock::time_point start = Clock::now();
+                       queue->post("test", []() { sleep(1); });
+                       return Clock::now() - start <
+                           std::chrono::milliseconds(500);
+                   });
+
+        // the slow notification above is still being sent
+        test.check("Deadline",
+                   [&]() {
+                       sent.clear();
+                       queue->post("test", [&]() {
+                               std::lock_guard<std::mutex> lock(mutex);
+                               sent.push_back(4);
+                           });
+                       Clock::time_point start = Clock::now();
+                       bool ok = queue->wait(std::chrono::milliseconds(100));
+                       bool quick = Clock::now() - start <
+                           std::chrono::milliseconds(900);
+                       sleep(2);
+                       std::lock_guard<std::mutex> lock(mutex);
+                       return !ok && quick && sent.empty();
+                   });
+
+        test.check("No notifications after the deadline",
+                   [&]() {
+                       queue->post("test", [&]() {
+                               std::lock_guard<std::mutex> lock(mutex);
+                               sent.push_back(5);
+                           });
+                       return queue->idle() &&
+                           queue->wait(std::chrono::milliseconds(100)) &&
+                           sent.empty();
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <cerrno>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#include "global.h"
+#include "debug.h"
+#include "fileutil.h"
+#include "numa.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+#define HBA         "devices/pci0000:80/0000:80:01.0"
+#define NIC         "devices/pci0000:00/0000:00:02.0"
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static void writeFile(const string &path, const string &contents)
+{
+    FilePath(FilePath(path).dirName()).mkdir(true);
+    std::ofstream(path.c_str()) << contents << endl;
+}
+
+// -----------------------------------------------------------------------------
+static void makeLink(const string &target, const string &path)
+{
+    FilePath(FilePath(path).dirName()).mkdir(true);
+    if (symlink(target.c_str(), path.c_str()) != 0)
+        throw KSystemError("Cannot create " + path, errno);
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * A sysfs with two nodes: a SCSI disk with a device mapper volume on
+ * node 1 and a network interface on node 0.
+ */
+static void makeSysfs(const string &sys)
+{
+    writeFile(sys + "/devices/system/node/online", "0-1");
+    writeFile(sys + "/devices/system/node/node0/cpulist", "0-3");
+    writeFile(sys + "/devices/system/node/node1/cpulist", "4-5,7");
+
+    writeFile(sys + "/" HBA "/numa_node", "1");
+    FilePath(sys + "/" HBA "/host0/block/sda/sda1").mkdir(true);
+    makeLink("../../" HBA "/host0/block/sda/sda1", sys + "/dev/block/8:1");
+    makeLink("../../../../../" HBA "/host0/block/sda/sda1",
+             sys + "/devices/virtual/block/dm-0/slaves/sda1");
+    makeLink("../../devices/virtual/block/dm-0", sys + "/dev/block/253:0");
+    FilePath(sys + "/devices/virtual/block/loop0").mkdir(true);
+    makeLink("../../devices/virtual/block/loop0", sys + "/dev/block/7:0");
+
+    writeFile(sys + "/" NIC "/numa_node", "0");
+    makeLink("../../../" NIC, sys + "/class/net/eth1/device");
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    char tmpl[] = "/tmp/testnuma.XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        cerr << "Cannot create a temporary directory" << endl;
+        return EXIT_FAILURE;
+    }
+    string sys(tmpl);
+
+    try {
+        TestRun test;
+        makeSysfs(sys);
+        NumaPlacement numa(sys.c_str());
+
+        test.check("Parse CPU lists",
+                   []() {
+                       vector<int> cpus = NumaPlacement::parseList("0-2,8\n");
+                       return cpus.size() == 4 && cpus[2] == 2 &&
+                           cpus[3] == 8;
+                   });
+
+        test.check("Malformed CPU list",
+                   []() {
+                       try {
+                           NumaPlacement::parseList("3-1");
+                       } catch (const KError &) {
+                           return true;
+                       }
+                       return false;
+                   });
+
+        test.check("Count nodes",
+                   [&]() {
+                       return numa.nodes() == 2 &&
+                           NumaPlacement("/nonexistent").nodes() == 1;
+                   });
+
+        test.check("Partition on node 1",
+                   [&]() {
+                       return numa.blockDeviceNode(makedev(8, 1)) == 1;
+                   });
+
+        test.check("Device mapper follows its slaves",
+                   [&]() {
+                       return numa.blockDeviceNode(makedev(253, 0)) == 1;
+                   });
+
+        test.check("Virtual device without slaves",
+                   [&]() {
+                       return numa.blockDeviceNode(makedev(7, 0)) == -1 &&
+                           numa.blockDeviceNode(makedev(9, 9)) == -1;
+                   });
+
+        test.check("Network interface on node 0",
+                   [&]() {
+                       return numa.interfaceNode("eth1") == 0 &&
+                           numa.interfaceNode("eth9") == -1;
+                   });
+
+        test.check("CPUs of a node",
+                   [&]() {
+                       vector<int> cpus = numa.nodeCPUs(1);
+                       return cpus.size() == 3 && cpus[0] == 4 &&
+                           cpus[2] == 7;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    FilePath(sys).rmdir(true);
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+
+#include "global.h"
+#include "debug.h"
+#include "pagefilter.h"
+#include "elffilter.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::vector;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+
+typedef PageFilter::Run Run;
+typedef FilteredElfDataProvider::Load Load;
+
+#define PAGE            4096ULL
+
+// -----------------------------------------------------------------------------
+static PageFilter::PageLayout layout()
+{
+    PageFilter::PageLayout ret = PageFilter::PageLayout();
+    ret.size = 64;
+    ret.flags = 0;
+    ret.mapping = 24;
+    ret.priv = 40;
+    ret.mapcount = 48;
+    ret.lru = 1ULL << 4;
+    ret.priv_flag = 1ULL << 13;
+    ret.swapcache = 1ULL << 10;
+    ret.swapbacked = 1ULL << 19;
+    ret.slab = 1ULL << 7;
+    ret.buddy = true;
+    ret.buddy_value = ~0x80U;
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+static vector<char> page(uint64_t flags, uint64_t mapping,
+                         uint32_t mapcount = 0xffffffffU, uint64_t priv = 0)
+{
+    PageFilter::PageLayout l = layout();
+    vector<char> ret(l.size);
+    memcpy(&ret[l.flags], &flags, sizeof flags);
+    memcpy(&ret[l.mapping], &mapping, sizeof mapping);
+    memcpy(&ret[l.mapcount], &mapcount, sizeof mapcount);
+    memcpy(&ret[l.priv], &priv, sizeof priv);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+static unsigned long classify(const vector<char> &desc, int dumplevel)
+{
+    return PageFilter::classify(desc.data(), layout(), dumplevel);
+}
+
+// -----------------------------------------------------------------------------
+static Run run(unsigned long long first, unsigned long long count)
+{
+    Run ret;
+    ret.first = first;
+    ret.count = count;
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+static bool sameLoad(const Load &load, unsigned long long offset,
+                     unsigned long long filesz, unsigned long long memsz)
+{
+    return load.offset == offset && load.filesz == filesz &&
+        load.memsz == memsz;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+
+        test.check("Free pages of all kernel generations",
+                   []() {
+                       return PageFilter::isBuddy(0xffffff80U, 0xffffff80U) &&
+                           !PageFilter::isBuddy(0xffffffffU, 0xffffff80U) &&
+                           PageFilter::isBuddy(0xffffff7fU, 0xffffff7fU) &&
+                           PageFilter::isBuddy(0xf000007fU, 0xffffff7fU) &&
+                           !PageFilter::isBuddy(0xffffffffU, 0xffffff7fU) &&
+                           !PageFilter::isBuddy(0, 0xffffff7fU) &&
+                           PageFilter::isBuddy(0xf0000003U, 0xf0000000U) &&
+                           !PageFilter::isBuddy(0xffffffffU, 0xf0000000U) &&
+                           !PageFilter::isBuddy(0xf1000000U, 0xf0000000U);
+                   });
+
+        test.check("A free block is excluded as a whole",
+                   []() {
+                       vector<char> desc = page(0, 0, ~0x80U, 3);
+                       return classify(desc, 16) == 8 &&
+                           classify(desc, 15) == 0;
+                   });
+
+        test.check("User data",
+                   []() {
+                       vector<char> anon = page(1ULL << 4, 0xffff888001230001ULL);
+                       return classify(anon, 8) == 1 &&
+                           classify(anon, 31 & ~8) == 0;
+                   });
+
+        test.check("Cache pages with and without private data",
+                   []() {
+                       vector<char> cache = page(1ULL << 4, 0xffff888004560000ULL);
+                       vector<char> priv = page((1ULL << 4) | (1ULL << 13),
+                                                0xffff888004560000ULL);
+                       return classify(cache, 2) == 1 &&
+                           classify(priv, 2) == 0 &&
+                           classify(priv, 4) == 1 &&
+                           classify(cache, 8 | 16) == 0;
+                   });
+
+        test.check("Swap cache needs PG_swapbacked",
+                   []() {
+                       vector<char> checked = page(1ULL << 10, 0);
+                       vector<char> swap = page((1ULL << 10) | (1ULL << 19), 0);
+                       return classify(checked, 31) == 0 &&
+                           classify(swap, 31) == 1;
+                   });
+
+        test.check("Slab and unknown pages are kept",
+                   []() {
+                       return classify(page(1ULL << 7, 1), 31) == 0 &&
+                           classify(page(0, 0), 31) == 0;
+                   });
+
+        test.check("Short gaps are zeros, long gaps cut the segment",
+                   []() {
+                       vector<Run> runs;
+                       runs.push_back(run(0, 100));
+                       runs.push_back(run(150, 50));
+                       runs.push_back(run(1000, 3096));
+                       vector<Load> l = FilteredElfDataProvider::planLoads(
+                           runs, 4096 * PAGE, 4096 * PAGE, PAGE);
+                       return l.size() == 2 &&
+                           sameLoad(l[0], 0, 200 * PAGE, 1000 * PAGE) &&
+                           sameLoad(l[1], 1000 * PAGE, 3096 * PAGE,
+                                    3096 * PAGE);
+                   });
+
+        test.check("Excluded memory at the start and at the end",
+                   []() {
+                       vector<Run> runs;
+                       runs.push_back(run(512, 10));
+                       vector<Load> l = FilteredElfDataProvider::planLoads(
+                           runs, 4096 * PAGE, 8192 * PAGE, PAGE);
+                       return l.size() == 2 &&
+                           sameLoad(l[0], 0, 0, 512 * PAGE) &&
+                           sameLoad(l[1], 512 * PAGE, 10 * PAGE,
+                                    (8192 - 512) * PAGE);
+                   });
+
+        test.check("A segment without kept pages",
+                   []() {
+                       vector<Load> l = FilteredElfDataProvider::planLoads(
+                           vector<Run>(), 4096 * PAGE, 4096 * PAGE, PAGE);
+                       return l.size() == 1 &&
+                           sameLoad(l[0], 0, 0, 4096 * PAGE);
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
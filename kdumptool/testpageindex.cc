@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "global.h"
+#include "debug.h"
+#include "pageindex.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static PageIndex sample()
+{
+    // batches of 512 pages, an entry every 1024 descriptors
+    PageIndex index(1024);
+    index.reset(4096, 8192);
+    index.addBatch(0, 0, 4096, PageIndex::STATE_ZLIB);
+    index.addBatch(512, 512, 900000, PageIndex::STATE_RAW);
+    index.addBatch(4096, 1024, 1800000, PageIndex::STATE_ZLIB);
+    index.addZero(10);
+    index.addZero(11);
+    index.addZero(4100);
+    return index;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+
+    try {
+        TestRun test;
+
+        test.check("Batches within the interval share an entry",
+                   []() {
+                       PageIndex index = sample();
+                       const std::vector<PageIndex::Range> &r =
+                           index.ranges();
+                       return r.size() == 2 && r[0].pfn == 0 &&
+                           r[0].record == 4096 &&
+                           r[0].state == (PageIndex::STATE_ZLIB |
+                                          PageIndex::STATE_RAW) &&
+                           r[1].pfn == 4096 && r[1].desc == 1024;
+                   });
+
+        test.check("Lookup of a page frame",
+                   []() {
+                       PageIndex index = sample();
+                       const PageIndex::Range *a = index.find(4095);
+                       const PageIndex::Range *b = index.find(1ULL << 40);
+                       PageIndex empty;
+                       return a && a->desc == 0 && b && b->desc == 1024 &&
+                           !empty.find(0);
+                   });
+
+        test.check("Zero pages are merged into runs",
+                   []() {
+                       PageIndex index = sample();
+                       return index.zeros().size() == 2 &&
+                           index.zeros()[0].pages == 2 &&
+                           index.isZero(11) && !index.isZero(12) &&
+                           !index.isZero(9) && index.isZero(4100);
+                   });
+
+        test.check("The sidecar file is read back",
+                   []() {
+                       PageIndex index = sample();
+                       string s = index.str();
+                       PageIndex copy = PageIndex::parse(s);
+                       return copy.str() == s && copy.pageSize() == 4096 &&
+                           copy.descOffset() == 8192 &&
+                           s.find("range 0 0 4096 raw+zlib\n") !=
+                               string::npos;
+                   });
+
+        test.check("Placed dumps have no record offsets",
+                   []() {
+                       PageIndex index;
+                       index.reset(4096, 8192);
+                       index.addBatch(7, 0, -1, PageIndex::STATE_ZSTD);
+                       PageIndex copy = PageIndex::parse(index.str());
+                       return copy.ranges().size() == 1 &&
+                           copy.ranges()[0].record == -1 &&
+                           copy.ranges()[0].state == PageIndex::STATE_ZSTD;
+                   });
+
+        test.check("Other files are not page indexes",
+                   []() {
+                       try {
+                           PageIndex::parse("KDUMP-CATALOG 1\n");
+                           return false;
+                       } catch (const KError &) {
+                           return true;
+                       }
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cerrno>
+#include <ctime>
+
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "global.h"
+#include "debug.h"
+#include "perfcounters.h"
+#include "savestats.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static unsigned long long threadTime()
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+        throw KSystemError("Cannot read the thread CPU time", errno);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Spins until the calling thread has used @p duration of CPU time, so
+ * that the counts do not depend on the load of the machine.
+ */
+static void burn(std::chrono::milliseconds duration)
+{
+    unsigned long long end = threadTime() +
+        std::chrono::nanoseconds(duration).count();
+    volatile unsigned long x = 0;
+    while (threadTime() < end)
+        ++x;
+}
+
+// -----------------------------------------------------------------------------
+static bool haveTaskClock()
+{
+    PerfCounters::Sample s = PerfCounters::counters()->read();
+    if (s.mask & (1U << PerfCounters::TASK_CLOCK))
+        return true;
+    cout << "(no task clock) ";
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+
+    try {
+        TestRun test;
+
+        test.check("Only counters valid in both samples are compared",
+                   []() {
+                       PerfCounters::Sample a, b;
+                       a.value[PerfCounters::CYCLES] = 10;
+                       a.value[PerfCounters::TASK_CLOCK] = 5;
+                       a.mask = (1U << PerfCounters::CYCLES) |
+                           (1U << PerfCounters::TASK_CLOCK);
+                       b.value[PerfCounters::CYCLES] = 25;
+                       b.value[PerfCounters::INSTRUCTIONS] = 7;
+                       b.mask = (1U << PerfCounters::CYCLES) |
+                           (1U << PerfCounters::INSTRUCTIONS);
+                       PerfCounters::Sample d = PerfCounters::delta(a, b);
+                       return d.mask == (1U << PerfCounters::CYCLES) &&
+                           d.value[PerfCounters::CYCLES] == 15 &&
+                           d.value[PerfCounters::INSTRUCTIONS] == 0;
+                   });
+
+        test.check("Multiplexed counts are extrapolated",
+                   []() {
+                       return PerfCounters::scale(100, 200, 100) == 200 &&
+                           PerfCounters::scale(100, 100, 100) == 100 &&
+                           PerfCounters::scale(5, 10, 0) == 5;
+                   });
+
+        test.check("The report lists the valid counters",
+                   []() {
+                       PerfCounters::Sample s;
+                       if (!PerfCounters::json(s).empty())
+                           return false;
+                       s.value[PerfCounters::INSTRUCTIONS] = 3;
+                       s.value[PerfCounters::CONTEXT_SWITCHES] = 4;
+                       s.value[PerfCounters::LLC_MISSES] = 99;
+                       s.mask = (1U << PerfCounters::INSTRUCTIONS) |
+                           (1U << PerfCounters::CONTEXT_SWITCHES);
+                       return PerfCounters::json(s) ==
+                           "{ \"instructions\": 3, "
+                           "\"context_switches\": 4 }";
+                   });
+
+        PerfCounters::counters()->open();
+
+        test.check("Counts of child processes are inherited",
+                   []() {
+                       if (!haveTaskClock())
+                           return true;
+                       PerfCounters::Sample before =
+                           PerfCounters::counters()->read();
+                       pid_t pid = fork();
+                       if (pid == 0) {
+                           burn(std::chrono::milliseconds(200));
+                           _exit(0);
+                       }
+                       int status;
+                       if (pid < 0 || waitpid(pid, &status, 0) != pid)
+                           return false;
+                       PerfCounters::Sample d = PerfCounters::delta(before,
+                           PerfCounters::counters()->read());
+                       return d.value[PerfCounters::TASK_CLOCK] >=
+                           150000000ULL;
+                   });
+
+        test.check("Phases have their own counts",
+                   []() {
+                       if (!haveTaskClock())
+                           return true;
+                       {
+                           SaveStats::Timer timer("burn");
+                           burn(std::chrono::milliseconds(100));
+                       }
+                       SaveStats::Phase phase;
+                       string json = SaveStats::stats()->json();
+                       return SaveStats::stats()->find("burn", phase) &&
+                           phase.perf.value[PerfCounters::TASK_CLOCK] >=
+                               50000000ULL &&
+                           json.find("\"perf\": { ") != string::npos;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
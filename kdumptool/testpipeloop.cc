@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "global.h"
+#include "debug.h"
+#include "pipeloop.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+#define BLOCK   8
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+/**
+ * Describes the runs of @p data as "w<pos>+<len>" and "s<len>" words.
+ */
+template<typename Holes>
+static string runs(const string &data)
+{
+    std::ostringstream ss;
+    splitRuns<Holes>(data.data(), data.size(), BLOCK,
+        [&](const char *run, size_t len, size_t pos) {
+            ss << "w" << pos << "+" << len << " ";
+        },
+        [&](size_t len) {
+            ss << "s" << len << " ";
+        });
+    return ss.str();
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+
+    try {
+        TestRun test;
+
+        const string zero(BLOCK, '\0');
+        const string data(BLOCK, 'x');
+
+        test.check("KeepZeros writes everything at once",
+                   [&]() {
+                       return runs<KeepZeros>(data + zero + data) ==
+                           "w0+24 ";
+                   });
+
+        test.check("SkipZeros leaves full zero blocks",
+                   [&]() {
+                       return runs<SkipZeros>(data + zero + zero + data) ==
+                           "w0+8 s8 s8 w24+8 ";
+                   });
+
+        test.check("A partial zero block is written",
+                   [&]() {
+                       return runs<SkipZeros>(zero + string(3, '\0')) ==
+                           "s8 w8+3 ";
+                   });
+
+        test.check("Nothing to do for an empty chunk",
+                   [&]() {
+                       return runs<SkipZeros>("").empty() &&
+                           runs<KeepZeros>("").empty();
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
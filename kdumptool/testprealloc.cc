@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <cerrno>
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+#include "global.h"
+#include "debug.h"
+#include "prealloc.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+#define MiB     (1ULL << 20)
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static unsigned long long allocated(int fd)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        throw KSystemError("fstat failed", errno);
+    return (unsigned long long)st.st_blocks * 512;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+
+        char path[] = "/tmp/testprealloc.XXXXXX";
+        int fd = mkstemp(path);
+        if (fd < 0)
+            throw KSystemError("mkstemp failed", errno);
+
+        Preallocation prealloc(fd, 16 * MiB);
+        bool supported = prealloc.size() > 0;
+        if (!supported)
+            cout << "fallocate() is not supported on /tmp" << endl;
+
+        test.check("Space is allocated, the size is kept",
+                   [&]() {
+                       struct stat st;
+                       return fstat(fd, &st) == 0 && st.st_size == 0 &&
+                           (!supported || allocated(fd) >= 16 * MiB);
+                   });
+
+        test.check("Trim releases holes and the tail",
+                   [&]() {
+                       string data(4096, 'x');
+                       if (pwrite(fd, data.data(), data.size(), 0) !=
+                               (ssize_t)data.size() ||
+                           pwrite(fd, data.data(), data.size(), 4 * MiB) !=
+                               (ssize_t)data.size() ||
+                           fsync(fd) != 0)
+                           return false;
+                       prealloc.trim();
+                       struct stat st;
+                       return fstat(fd, &st) == 0 &&
+                           st.st_size == (off_t)(4 * MiB + 4096) &&
+                           allocated(fd) < 4 * MiB &&
+                           prealloc.size() == 0;
+                   });
+
+        test.check("Half of the free space above the reserve",
+                   [&]() {
+                       struct statvfs vfs;
+                       if (fstatvfs(fd, &vfs) != 0)
+                           return false;
+                       unsigned long long avail =
+                           (unsigned long long)vfs.f_bavail * vfs.f_frsize;
+                       if (ftruncate(fd, 0) != 0 || avail < 64 * MiB)
+                           return false;
+                       Preallocation none(fd, 1ULL << 50, avail * 2);
+                       // leave 64 MiB above the reserve, allow for
+                       // other writers on the file system
+                       Preallocation half(fd, 1ULL << 50, avail - 64 * MiB);
+                       bool ok = none.size() == 0 &&
+                           half.size() <= 33 * MiB &&
+                           (!supported || half.size() >= 31 * MiB);
+                       half.trim();
+                       return ok;
+                   });
+
+        close(fd);
+        unlink(path);
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "global.h"
+#include "debug.h"
+#include "prefetch.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+#define KiB     (1UL << 10)
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+//{{{ FailingDataProvider -----------------------------------------------------
+
+/**
+ * Returns a number of bytes and then fails.
+ */
+class FailingDataProvider : public AbstractDataProvider {
+    size_t m_left;
+
+public:
+    FailingDataProvider(size_t bytes)
+        : m_left(bytes)
+    { }
+
+    size_t getData(char *buffer, size_t maxread)
+    {
+        if (!m_left)
+            throw KError("source failed");
+        size_t ret = std::min(maxread, m_left);
+        std::fill(buffer, buffer + ret, 'x');
+        m_left -= ret;
+        return ret;
+    }
+};
+
+//}}}
+
+// -----------------------------------------------------------------------------
+static string pattern(size_t size)
+{
+    string ret(size, '\0');
+    for (size_t i = 0; i < size; ++i)
+        ret[i] = "0123456789abcdef"[(i * 7 + i / 13) % 16];
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+        const string data = pattern(1000 * KiB + 123);
+
+        test.check("The ring keeps the order",
+                   []() {
+                       SpscRing<unsigned> ring(8);
+                       const unsigned count = 100000;
+                       std::thread producer([&]() {
+                           for (unsigned i = 0; i < count; ++i) {
+                               unsigned item = i;
+                               ring.wait([&]() { return !ring.full(); });
+                               ring.tryPush(item);
+                           }
+                       });
+                       bool ok = true;
+                       for (unsigned i = 0; i < count; ++i) {
+                           unsigned item = 0;
+                           ring.wait([&]() { return !ring.empty(); });
+                           ring.tryPop(item);
+                           ok = ok && item == i;
+                       }
+                       producer.join();
+                       return ok && ring.empty();
+                   });
+
+        test.check("Small reads see all data",
+                   [&]() {
+                       BufferDataProvider source(data.data(), data.size());
+                       PrefetchDataProvider dp(&source, 2, 64 * KiB);
+                       dp.prepare();
+                       string out;
+                       char buf[1000];
+                       size_t n;
+                       while ((n = dp.getData(buf, sizeof buf)) != 0)
+                           out.append(buf, n);
+                       dp.finish();
+                       return out == data;
+                   });
+
+        test.check("Chunks are passed on with their offsets",
+                   [&]() {
+                       BufferDataProvider source(data.data(), data.size());
+                       PrefetchDataProvider dp(&source, 3, 64 * KiB);
+                       dp.prepare();
+                       string out;
+                       bool ok = true;
+                       DataChunk chunk;
+                       while (dp.getChunk(chunk, 64 * KiB)) {
+                           ok = ok && chunk.offset() == (off_t)out.size();
+                           out.append(chunk.data(), chunk.length());
+                       }
+                       dp.finish();
+                       return ok && out == data;
+                   });
+
+        test.check("Errors of the source reach the reader",
+                   []() {
+                       FailingDataProvider source(200 * KiB);
+                       PrefetchDataProvider dp(&source, 2, 64 * KiB);
+                       dp.prepare();
+                       size_t total = 0;
+                       char buf[4096];
+                       try {
+                           size_t n;
+                           while ((n = dp.getData(buf, sizeof buf)) != 0)
+                               total += n;
+                       } catch (const KError &e) {
+                           dp.setError(true);
+                           dp.finish();
+                           return total == 200 * KiB;
+                       }
+                       return false;
+                   });
+
+        test.check("Stopping early does not hang",
+                   [&]() {
+                       BufferDataProvider source(data.data(), data.size());
+                       PrefetchDataProvider dp(&source, 1, 4 * KiB);
+                       dp.prepare();
+                       char buf[100];
+                       dp.getData(buf, sizeof buf);
+                       dp.finish();
+                       return true;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
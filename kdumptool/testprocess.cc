@@ -18,14 +18,18 @@
  */
 #include <iostream>
 #include <memory>
+#include <cerrno>
+#include <cstring>
 
 #include <unistd.h>
+#include <fcntl.h>
 
 #include "global.h"
 #include "kdumptool.h"
 #include "process.h"
 #include "debug.h"
 #include "stringvector.h"
+#include "stringutil.h"
 
 using std::cout;
 using std::cerr;
@@ -135,6 +139,27 @@ int main(int argc, char *argv[])
 	status = p2.wait();
 	Debug::debug()->info("'grep' exited with status %d", status);
 
+	// A close-on-exec descriptor that is already at its target number
+	int pfd[2];
+	if (::pipe2(pfd, O_CLOEXEC) < 0)
+	    throw KSystemError("Cannot create a pipe", errno);
+	SubProcess p3;
+	p3.setChildFD(pfd[1], make_shared<SubProcessRedirect>(pfd[1]));
+	StringVector v3;
+	v3.push_back("-c");
+	v3.push_back("echo inherited >&" + StringUtil::number2string(pfd[1]));
+	p3.spawn("sh", v3);
+	close(pfd[1]);
+	char buf[32];
+	res = read(pfd[0], buf, sizeof buf);
+	close(pfd[0]);
+	status = p3.wait();
+	Debug::debug()->info("'sh' exited with status %d", status);
+	if (status != 0 || res != 10 || memcmp(buf, "inherited\n", 10)) {
+	    cerr << "Descriptor " << pfd[1] << " was not inherited" << endl;
+	    ++errors;
+	}
+
     } catch(const std::exception &ex) {
 	cerr << "Fatal exception: " << ex.what() << endl;
 	++errors;
@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "global.h"
+#include "debug.h"
+#include "dataprovider.h"
+#include "progressreporter.h"
+#include "stringutil.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+//{{{ Capture -----------------------------------------------------------------
+
+// the reports received by a CaptureSink; it outlives the reporter
+class Capture {
+    public:
+        void add(const ProgressReporter::Sample &sample)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_samples.push_back(sample);
+        }
+
+        std::vector<ProgressReporter::Sample> samples()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_samples;
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::vector<ProgressReporter::Sample> m_samples;
+};
+
+class CaptureSink : public ProgressReporter::Sink {
+    public:
+        CaptureSink(Capture &capture)
+            : m_capture(capture)
+        {}
+
+        void publish(const ProgressReporter &reporter,
+                     const ProgressReporter::Sample &sample)
+        { m_capture.add(sample); }
+
+    private:
+        Capture &m_capture;
+};
+
+//}}}
+
+// -----------------------------------------------------------------------------
+static ProgressReporter::Sample makeSample(const char *state)
+{
+    ProgressReporter::Sample s;
+    s.elapsed = 75;
+    s.bytes = 512ULL << 20;
+    s.rate = 2 << 20;
+    s.permille = 425;
+    s.eta = 72;
+    s.state = state;
+    return s;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+
+        test.check("Parse the makedumpfile progress",
+                   []() {
+                       return ProcessDataProvider::parsePermille(
+                           "Copying data                      : "
+                           "[ 12.0 %] /\r"
+                           "Copying data                      : "
+                           "[ 45.3 %] |") == 453 &&
+                           ProcessDataProvider::parsePermille(
+                               "Excluding free pages               : "
+                               "[100.0 %] |\n") == -1 &&
+                           ProcessDataProvider::parsePermille(
+                               "Copying data : [100.0 %] -\n") == 1000;
+                   });
+
+        test.check("Text report",
+                   []() {
+                       ProgressReporter r("Saving dump", "host");
+                       return r.text(makeSample("running")) ==
+                           "Saving dump: 512.0 MiB, 2.0 MiB/s, 42.5%, "
+                           "ETA 0:01:12" &&
+                           r.text(makeSample("done")) ==
+                           "Saving dump: 512.0 MiB in 0:01:15, done";
+                   });
+
+        test.check("JSON report",
+                   []() {
+                       ProgressReporter r("Saving dump", "a\"b");
+                       r.setTotal(1ULL << 30);
+                       return r.json(makeSample("running")) ==
+                           "{\"host\": \"a\\\"b\", \"name\": \"Saving dump\", "
+                           "\"state\": \"running\", \"elapsed\": 75.0, "
+                           "\"bytes\": 536870912, \"rate\": 2097152.0, "
+                           "\"percent\": 42.5, \"eta\": 72, "
+                           "\"total\": 1073741824}";
+                   });
+
+        test.check("ETA from the expected size",
+                   []() {
+                       std::atomic<unsigned long long> bytes(0);
+                       Capture capture;
+                       ProgressReporter r("Saving dump", "host");
+                       r.addSink(new CaptureSink(capture));
+                       r.setInterval(std::chrono::milliseconds(20));
+                       r.setTotal(100ULL << 20);
+                       r.start([&bytes]() { return bytes.load(); });
+                       for (int i = 0; i < 10; ++i) {
+                           bytes += 1 << 20;
+                           usleep(10000);
+                       }
+                       r.stop(true);
+
+                       std::vector<ProgressReporter::Sample> v =
+                           capture.samples();
+                       if (v.size() < 2)
+                           return false;
+                       const ProgressReporter::Sample &mid = v[v.size() - 2];
+                       const ProgressReporter::Sample &last = v.back();
+                       // about 100 MiB/s, so 90 MiB take about a second
+                       return string(mid.state) == "running" &&
+                           mid.rate > 0 && mid.eta >= 0 && mid.eta < 10 &&
+                           mid.permille > 0 && mid.permille < 200 &&
+                           string(last.state) == "done" &&
+                           last.permille == 1000 && last.eta == 0;
+                   });
+
+        test.check("ETA from the makedumpfile progress",
+                   []() {
+                       ProgressReporter r("Saving dump", "host");
+                       int permille = 100;
+                       r.setPermille([&permille]() { return permille; });
+                       r.start([]() { return 0ULL; });
+                       r.sample();
+                       usleep(100000);
+                       permille = 200;
+                       ProgressReporter::Sample s = r.sample();
+                       r.stop(true);
+                       // 10% in 0.1 s, the remaining 80% in 0.8 s
+                       return s.permille == 200 && s.eta >= 0 && s.eta <= 2;
+                   });
+
+        test.check("Failed operation",
+                   []() {
+                       Capture capture;
+                       {
+                           ProgressReporter r("Saving dump", "host");
+                           r.addSink(new CaptureSink(capture));
+                           r.start([]() { return 0ULL; });
+                       }
+                       std::vector<ProgressReporter::Sample> v =
+                           capture.samples();
+                       return !v.empty() && string(v.back().state) == "failed";
+                   });
+
+        test.check("Unknown sink",
+                   []() {
+                       ProgressReporter r("Saving dump", "host");
+                       try {
+                           r.addSinks("console pigeon");
+                       } catch (const KError &) {
+                           return true;
+                       }
+                       return false;
+                   });
+
+        test.check("UDP collector",
+                   []() {
+                       int fd = socket(AF_INET, SOCK_DGRAM, 0);
+                       struct sockaddr_in addr = sockaddr_in();
+                       addr.sin_family = AF_INET;
+                       addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                       socklen_t len = sizeof addr;
+                       if (fd < 0 ||
+                           bind(fd, (struct sockaddr *)&addr, len) != 0 ||
+                           getsockname(fd, (struct sockaddr *)&addr,
+                                       &len) != 0)
+                           return false;
+
+                       {
+                           ProgressReporter r("Saving dump", "host");
+                           r.addSinks("udp://127.0.0.1:" +
+                                      StringUtil::number2string(
+                                          ntohs(addr.sin_port)));
+                           r.start([]() { return 42ULL; });
+                           r.stop(true);
+                       }
+
+                       struct pollfd pfd = { fd, POLLIN, 0 };
+                       char buf[1024];
+                       ssize_t n = -1;
+                       if (poll(&pfd, 1, 2000) == 1)
+                           n = recv(fd, buf, sizeof buf - 1, 0);
+                       close(fd);
+                       if (n <= 0)
+                           return false;
+                       string msg(buf, n);
+                       return msg.find("\"state\": \"done\"") != string::npos &&
+                           msg.find("\"bytes\": 42,") != string::npos;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
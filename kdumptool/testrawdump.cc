@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <memory>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "global.h"
+#include "debug.h"
+#include "dataprovider.h"
+#include "rootdirurl.h"
+#include "rawdump.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::ofstream;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static bool readIndex(const string &device, RawIndex &index)
+{
+    char block[RAW_BLOCK];
+    int fd = open(device.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    ssize_t len = pread(fd, block, sizeof block, 0);
+    close(fd);
+    return len == RAW_BLOCK && index.parse(block, len);
+}
+
+// -----------------------------------------------------------------------------
+static string readEntry(const string &device, const RawIndex::Entry &entry)
+{
+    char buffer[8192];
+    string ret;
+    int fd = open(device.c_str(), O_RDONLY);
+    if (fd < 0)
+        return ret;
+    RawEntryDataProvider provider(fd, entry);
+    provider.prepare();
+    size_t n;
+    while ((n = provider.getData(buffer, sizeof buffer)) > 0)
+        ret.append(buffer, n);
+    provider.finish();
+    close(fd);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    char tmpl[] = "/tmp/testrawdump.XXXXXX";
+    int tmpfd = mkstemp(tmpl);
+    if (tmpfd < 0) {
+        cerr << "Cannot create a temporary file" << endl;
+        return EXIT_FAILURE;
+    }
+    close(tmpfd);
+    string device(tmpl);
+    string url = "raw://" + device + "/2020-01-01-00:00";
+
+    try {
+        TestRun test;
+
+        test.check("Index round trip",
+                   []() {
+                       RawIndex index;
+                       index.dump = "2020-01-01-00:00";
+                       RawIndex::Entry entry = { "vmcore", 4096, 5000, true };
+                       index.files.push_back(entry);
+                       string block = index.format();
+
+                       RawIndex parsed;
+                       return block.size() == RAW_BLOCK &&
+                           parsed.parse(block.data(), block.size()) &&
+                           parsed.dump == index.dump &&
+                           parsed.files.size() == 1 &&
+                           parsed.files[0].offset == 4096 &&
+                           parsed.files[0].size == 5000 &&
+                           parsed.files[0].partial &&
+                           parsed.end() == 12288;
+                   });
+
+        test.check("Foreign data is not an index",
+                   []() {
+                       string block(RAW_BLOCK, 'x');
+                       RawIndex index;
+                       return !index.parse(block.data(), block.size());
+                   });
+
+        test.check("Files are written after the index",
+                   [&]() {
+                       string vmcore(RAW_BUFFER_SIZE + 1000, 'v');
+                       string readme("Kernel crash\n");
+                       {
+                           RawTransfer transfer(RootDirURLVector(
+                               1, RootDirURL(url, "")));
+                           BufferDataProvider p1(vmcore.data(),
+                                                 vmcore.size());
+                           transfer.perform(&p1, StringVector(1, "vmcore"),
+                                            NULL);
+                           BufferDataProvider p2(readme.data(),
+                                                 readme.size());
+                           transfer.perform(&p2,
+                                            StringVector(1, "README.txt"),
+                                            NULL);
+                       }
+
+                       RawIndex index;
+                       if (!readIndex(device, index) ||
+                           index.dump != "2020-01-01-00:00" ||
+                           index.files.size() != 2)
+                           return false;
+                       const RawIndex::Entry &e1 = index.files[0];
+                       const RawIndex::Entry &e2 = index.files[1];
+                       return e1.offset == RAW_BLOCK &&
+                           e2.offset % RAW_BLOCK == 0 &&
+                           e2.offset >= e1.offset + e1.size &&
+                           !e1.partial && !e2.partial &&
+                           readEntry(device, e1) == vmcore &&
+                           readEntry(device, e2) == readme;
+                   });
+
+        test.check("A new dump invalidates the old one",
+                   [&]() {
+                       RawTransfer transfer(RootDirURLVector(
+                           1, RootDirURL(url, "")));
+                       RawIndex index;
+                       return readIndex(device, index) &&
+                           index.files.empty();
+                   });
+
+        test.check("Persistent memory copy",
+                   []() {
+                       char src[300], dst[320];
+                       for (size_t i = 0; i < sizeof src; ++i)
+                           src[i] = char(i * 7);
+                       // unaligned head and tail around the stream stores
+                       for (size_t off = 0; off < 9; ++off) {
+                           memset(dst, 0, sizeof dst);
+                           PmemRegion::copy(dst + off, src + 3, 251);
+                           if (memcmp(dst + off, src + 3, 251) != 0 ||
+                               dst[off + 251] != 0)
+                               return false;
+                       }
+                       return true;
+                   });
+
+        test.check("A regular file is not persistent memory",
+                   [&]() {
+                       std::unique_ptr<PmemRegion> region(
+                           PmemRegion::open(device, false));
+                       return !region;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    unlink(tmpl);
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
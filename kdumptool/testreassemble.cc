@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "global.h"
+#include "debug.h"
+#include "configuration.h"
+#include "reassemble.h"
+#include "fileutil.h"
+#include "stringutil.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::ifstream;
+using std::ofstream;
+using std::string;
+
+// concatenates the parts after the kdump signature
+#define FAKE_MAKEDUMPFILE \
+    "#!/bin/sh\n" \
+    "shift\n" \
+    "out=\n" \
+    "for f; do out=$f; done\n" \
+    "printf 'KDUMP   ' > \"$out\"\n" \
+    "while [ $# -gt 1 ]; do cat \"$1\" >> \"$out\"; shift; done\n"
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static string readFile(const FilePath &path)
+{
+    ifstream fin(path.c_str(), std::ios::binary);
+    return string(std::istreambuf_iterator<char>(fin),
+                  std::istreambuf_iterator<char>());
+}
+
+// -----------------------------------------------------------------------------
+static FilePath splitDump(const FilePath &savedir, const string &name,
+                          unsigned long long damage = 0)
+{
+    FilePath dump = savedir;
+    dump.appendPath(name);
+    dump.mkdir(true);
+
+    std::vector<ReassemblyMarker::Part> parts;
+    for (int i = 1; i <= 3; ++i) {
+        FilePath path = dump;
+        path.appendPath("vmcore" + StringUtil::number2string(i));
+        ReassemblyMarker::Part part;
+        part.path = path;
+        string data(1000 * i, char('0' + i));
+        ofstream(part.path.c_str()) << data;
+        part.size = data.size() + (i == 2 ? damage : 0);
+        parts.push_back(part);
+    }
+
+    FilePath file = dump;
+    file.appendPath("checksums");
+    ofstream(file.c_str())
+        << "# CRC-32C (Castagnoli) of the files as they were saved\n"
+        << "# vmcore1: saved directly, no checksum\n"
+        << "0a0b0c0d 13 README.txt\n";
+
+    ReassemblyMarker::create(dump, "vmcore", parts);
+    return dump;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    char tmpl[] = "/tmp/testreassemble.XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        cerr << "Cannot create a temporary directory" << endl;
+        return EXIT_FAILURE;
+    }
+    FilePath dir(tmpl);
+
+    try {
+        TestRun test;
+
+        FilePath bin = dir;
+        bin.appendPath("bin");
+        bin.mkdir(true);
+        FilePath fake = bin;
+        fake.appendPath("makedumpfile");
+        ofstream(fake.c_str()) << FAKE_MAKEDUMPFILE;
+        chmod(fake.c_str(), 0755);
+        const char *path = getenv("PATH");
+        setenv("PATH", (bin + ":" + (path ? path : "/bin:/usr/bin")).c_str(),
+               1);
+
+        FilePath configFile = dir;
+        configFile.appendPath("kdump.conf");
+        FilePath savedir = dir;
+        savedir.appendPath("dumps");
+        savedir.mkdir(true);
+        ofstream(configFile.c_str())
+            << "KDUMP_SAVEDIR=\"file://" << savedir << "\"" << endl;
+        Configuration::config()->readFile(configFile);
+
+        test.check("Marker round trip",
+                   [&]() {
+                       FilePath dump = splitDump(savedir, "marker");
+                       ReassemblyMarker marker(dump);
+                       bool ok = marker.exists() &&
+                           marker.output() == "vmcore" &&
+                           marker.parts().size() == 3 &&
+                           marker.parts()[2].size == 3000;
+                       dump.rmdir(true);
+                       return ok;
+                   });
+
+        test.check("Split dump is reassembled",
+                   [&]() {
+                       FilePath dump = splitDump(savedir, "2020-01-01-00:00");
+                       ReassembleDumps reassemble;
+                       reassemble.execute();
+
+                       FilePath vmcore = dump, part = dump, manifest = dump;
+                       vmcore.appendPath("vmcore");
+                       part.appendPath("vmcore1");
+                       manifest.appendPath("checksums");
+                       string checksums = readFile(manifest);
+                       return vmcore.exists() &&
+                           vmcore.fileSize() == 8 + 6000 &&
+                           !part.exists() &&
+                           !ReassemblyMarker(dump).exists() &&
+                           checksums.find("vmcore1") == string::npos &&
+                           checksums.find("README.txt") != string::npos &&
+                           checksums.find(" 6008 vmcore\n") != string::npos;
+                   });
+
+        test.check("Incomplete parts are kept",
+                   [&]() {
+                       FilePath dump = splitDump(savedir, "2020-01-02-00:00",
+                                                 1);
+                       ReassembleDumps reassemble;
+                       bool failed = false;
+                       try {
+                           reassemble.execute();
+                       } catch (const KError &) {
+                           failed = true;
+                       }
+
+                       FilePath vmcore = dump, part = dump;
+                       vmcore.appendPath("vmcore");
+                       part.appendPath("vmcore2");
+                       bool ok = failed && !vmcore.exists() &&
+                           part.exists() && ReassemblyMarker(dump).exists();
+                       dump.rmdir(true);
+                       return ok;
+                   });
+
+        test.check("Interrupted removal is continued",
+                   [&]() {
+                       FilePath dump = splitDump(savedir, "2020-01-03-00:00");
+                       FilePath vmcore = dump, part = dump;
+                       vmcore.appendPath("vmcore");
+                       ofstream(vmcore.c_str()) << "KDUMP   done";
+                       part.appendPath("vmcore1");
+                       unlink(part.c_str());
+
+                       ReassembleDumps reassemble;
+                       reassemble.execute();
+                       part = dump;
+                       part.appendPath("vmcore3");
+                       return readFile(vmcore) == "KDUMP   done" &&
+                           !part.exists() &&
+                           !ReassemblyMarker(dump).exists();
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    dir.rmdir(true);
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
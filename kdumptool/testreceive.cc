@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <functional>
+#include <stdint.h>
+
+#include <unistd.h>
+
+#include "global.h"
+#include "debug.h"
+#include "dataprovider.h"
+#include "flattened.h"
+#include "rootdirurl.h"
+#include "fileutil.h"
+#include "stringutil.h"
+#include "receive.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static void putBE64(string &s, int64_t val)
+{
+    for (int shift = 56; shift >= 0; shift -= 8)
+        s.push_back(char((uint64_t)val >> shift));
+}
+
+// -----------------------------------------------------------------------------
+static string flatRecord(int64_t offset, const string &data)
+{
+    string ret;
+    putBE64(ret, offset);
+    putBE64(ret, data.size());
+    return ret + data;
+}
+
+// -----------------------------------------------------------------------------
+static string readFile(const string &path)
+{
+    std::ifstream fin(path.c_str(), std::ios::binary);
+    std::ostringstream ss;
+    ss << fin.rdbuf();
+    return ss.str();
+}
+
+// -----------------------------------------------------------------------------
+static void send(const string &url, const string &name, DataProvider *p,
+                 unsigned long long expected = 0)
+{
+    StreamTransfer transfer(RootDirURLVector(1, RootDirURL(url, "")));
+    transfer.setExpectedSize(expected);
+    transfer.perform(p, StringVector(1, name), NULL);
+}
+
+//{{{ GateDataProvider ---------------------------------------------------------
+
+/**
+ * DataProvider that sends a few bytes and then waits for the gate to
+ * open before it ends the file.
+ */
+class GateDataProvider : public AbstractDataProvider {
+
+    public:
+        GateDataProvider(const std::atomic<bool> &open)
+            : m_open(open), m_sent(false)
+        {}
+
+        size_t getData(char *buffer, size_t maxread)
+        {
+            if (!m_sent) {
+                m_sent = true;
+                memcpy(buffer, "gate", 4);
+                return 4;
+            }
+            while (!m_open)
+                usleep(10000);
+            return 0;
+        }
+
+    private:
+        const std::atomic<bool> &m_open;
+        bool m_sent;
+};
+
+//}}}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    char tmpl[] = "/tmp/testreceive.XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        cerr << "Cannot create a temporary directory" << endl;
+        return EXIT_FAILURE;
+    }
+    string dir(tmpl);
+
+    try {
+        TestRun test;
+
+        test.check("Frame header round trip",
+                   []() {
+                       unsigned char buf[STREAM_HEADER_SIZE];
+                       StreamFrame(StreamFrame::SF_DATA, 0x123456,
+                                   0x1122334455667788ULL).encode(buf);
+                       StreamFrame frame;
+                       frame.decode(buf);
+                       return buf[0] == 0 && buf[3] == StreamFrame::SF_DATA &&
+                           buf[8] == 0x11 && buf[15] == 0x88 &&
+                           frame.type == StreamFrame::SF_DATA &&
+                           frame.length == 0x123456 &&
+                           frame.offset == 0x1122334455667788ULL;
+                   });
+
+        StreamReceiver receiver(dir);
+        receiver.listen("127.0.0.1", 0);
+        std::atomic<bool> stop(false);
+        std::thread loop([&]() {
+                while (!stop)
+                    receiver.poll(50);
+            });
+        string base = "kdump://127.0.0.1:" +
+            StringUtil::number2string(receiver.port()) + "/var/crash/";
+
+        test.check("Files are saved in the dump directory",
+                   [&]() {
+                       string vmcore(STREAM_BUFFER_SIZE + 12345, 'v');
+                       for (size_t i = 0; i < vmcore.size(); i += 4093)
+                           vmcore[i] = char(i);
+                       BufferDataProvider p(vmcore.data(), vmcore.size());
+                       send(base + "10.0.0.1-2020-01-01-00:00", "vmcore", &p);
+                       return readFile(dir + "/10.0.0.1-2020-01-01-00:00/"
+                                       "vmcore") == vmcore;
+                   });
+
+        test.check("A flattened stream is unflattened",
+                   [&]() {
+                       string stream(4096, '\0');
+                       stream.replace(0, 12, "makedumpfile");
+                       stream[23] = 1;  // type
+                       stream[31] = 1;  // version
+                       stream += flatRecord(8192, "tail");
+                       stream += flatRecord(0, "head");
+                       putBE64(stream, -1);
+                       putBE64(stream, -1);
+                       BufferDataProvider buffer(stream.data(),
+                                                 stream.size());
+                       FlattenedDataProvider flat(&buffer);
+                       send(base + "10.0.0.1-2020-01-01-00:00", "dump", &flat);
+
+                       string expect(8196, '\0');
+                       expect.replace(0, 4, "head");
+                       expect.replace(8192, 4, "tail");
+                       return readFile(dir + "/10.0.0.1-2020-01-01-00:00/"
+                                       "dump") == expect;
+                   });
+
+        test.check("A sender without a route gets its address",
+                   [&]() {
+                       string readme("Kernel crash\n");
+                       BufferDataProvider p(readme.data(), readme.size());
+                       send(base + "unknown-2020-01-01-00:00", "README.txt",
+                            &p);
+                       return readFile(dir + "/127.0.0.1-2020-01-01-00:00/"
+                                       "README.txt") == readme;
+                   });
+
+        test.check("File names cannot leave the dump directory",
+                   [&]() {
+                       string data("x");
+                       BufferDataProvider p(data.data(), data.size());
+                       try {
+                           send(base + "10.0.0.1-2020-01-01-00:00",
+                                "../escaped", &p);
+                       } catch (const KError &) {
+                           return access((dir + "/escaped").c_str(),
+                                         F_OK) != 0;
+                       }
+                       return false;
+                   });
+
+        stop = true;
+        loop.join();
+
+        test.check("All connections are closed",
+                   [&]() {
+                       for (int i = 0; i < 20 && receiver.connections(); ++i)
+                           receiver.poll(50);
+                       return receiver.connections() == 0;
+                   });
+
+        test.check("Bulk dumps wait for a slot, smallest first",
+                   [&]() {
+                       StreamReceiver busy(dir);
+                       busy.setSlots(1);
+                       busy.listen("127.0.0.1", 0);
+                       string url = "kdump://127.0.0.1:" +
+                           StringUtil::number2string(busy.port()) +
+                           "/var/crash/";
+                       auto pollUntil = [&busy](std::function<bool()> cond) {
+                           for (int i = 0; i < 500 && !cond(); ++i)
+                               busy.poll(10);
+                           return cond();
+                       };
+
+                       std::mutex mutex;
+                       std::vector<string> order;
+                       auto sender = [&](string host, string name,
+                                         DataProvider *p,
+                                         unsigned long long expected) {
+                           try {
+                               send(url + host + "-2020-01-01-00:00", name,
+                                    p, expected);
+                           } catch (const KError &error) {
+                               cerr << error.what() << endl;
+                           }
+                           std::lock_guard<std::mutex> lock(mutex);
+                           order.push_back(host);
+                       };
+                       auto done = [&](size_t n) {
+                           std::lock_guard<std::mutex> lock(mutex);
+                           return order.size() >= n;
+                       };
+
+                       std::atomic<bool> open(false);
+                       GateDataProvider gate(open);
+                       std::thread first(sender, "10.0.0.2", "vmcore",
+                                         &gate, 0);
+                       string held = dir + "/10.0.0.2-2020-01-01-00:00/vmcore";
+                       bool admitted = pollUntil([&]() {
+                               return access(held.c_str(), F_OK) == 0;
+                           });
+
+                       string data("data");
+                       BufferDataProvider large(data.data(), data.size());
+                       BufferDataProvider small(data.data(), data.size());
+                       BufferDataProvider readme(data.data(), data.size());
+                       std::thread second(sender, "10.0.0.3", "vmcore",
+                                          &large, 1000ULL << 20);
+                       bool queued = pollUntil([&]() {
+                               return busy.waiting() == 1;
+                           });
+                       std::thread third(sender, "10.0.0.4", "vmcore",
+                                         &small, 200ULL << 20);
+                       queued = queued && pollUntil([&]() {
+                               return busy.waiting() == 2;
+                           });
+
+                       // the README is not held back
+                       std::thread fourth(sender, "10.0.0.5", "README.txt",
+                                          &readme, 0);
+                       bool passed = pollUntil([&]() { return done(1); });
+
+                       open = true;
+                       bool finished = pollUntil([&]() { return done(4); });
+                       first.join();
+                       second.join();
+                       third.join();
+                       fourth.join();
+
+                       // the first and the smallest dump may finish in
+                       // any order, the largest one is the last
+                       return admitted && queued && passed && finished &&
+                           order[0] == "10.0.0.5" && order[3] == "10.0.0.3";
+                   });
+
+        test.check("Only dumps need a slot",
+                   []() {
+                       return StreamReceiver::isBulk("vmcore", 0) &&
+                           StreamReceiver::isBulk("vmcore.zst", 0) &&
+                           StreamReceiver::isBulk("vmlinux.debug",
+                                                  STREAM_BULK_SIZE) &&
+                           !StreamReceiver::isBulk("README.txt", 0) &&
+                           !StreamReceiver::isBulk("dmesg.txt", 4096);
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    FilePath(dir).rmdir(true);
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
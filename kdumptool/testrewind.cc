@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "global.h"
+#include "debug.h"
+#include "dataprovider.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+#define WINDOW      16384
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static string makeData(size_t size)
+{
+    string ret(size, '\0');
+    for (size_t i = 0; i < size; ++i)
+        ret[i] = char(i * 7 + i / 251);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+static string readAll(RewindDataProvider &provider, size_t chunk)
+{
+    char buffer[65536];
+    string ret;
+    size_t n;
+    while ((n = provider.getData(buffer, chunk)) > 0)
+        ret.append(buffer, n);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+        const string data = makeData(100000);
+
+        test.check("Data passes unchanged",
+                   [&]() {
+                       BufferDataProvider buf(data.data(), data.size());
+                       RewindDataProvider rewind(&buf, WINDOW);
+                       rewind.prepare();
+                       string out = readAll(rewind, 3000);
+                       rewind.finish();
+                       return out == data && rewind.position() == data.size();
+                   });
+
+        test.check("Rewind within the window",
+                   [&]() {
+                       BufferDataProvider buf(data.data(), data.size());
+                       RewindDataProvider rewind(&buf, WINDOW);
+                       rewind.prepare();
+                       string out = readAll(rewind, 5000);
+                       unsigned long long pos = data.size() - WINDOW + 100;
+                       if (!rewind.rewind(pos))
+                           return false;
+                       out.resize(pos);
+                       out += readAll(rewind, 7000);
+                       rewind.finish();
+                       return out == data;
+                   });
+
+        test.check("Rewind in the middle of the stream",
+                   [&]() {
+                       BufferDataProvider buf(data.data(), data.size());
+                       RewindDataProvider rewind(&buf, WINDOW);
+                       rewind.prepare();
+                       char buffer[40000];
+                       size_t n = rewind.getData(buffer, sizeof buffer);
+                       if (!rewind.rewind(n - 1000))
+                           return false;
+                       string out(buffer, n - 1000);
+                       out += readAll(rewind, 4096);
+                       rewind.finish();
+                       return out == data;
+                   });
+
+        test.check("Rewind beyond the window fails",
+                   [&]() {
+                       BufferDataProvider buf(data.data(), data.size());
+                       RewindDataProvider rewind(&buf, WINDOW);
+                       rewind.prepare();
+                       readAll(rewind, 4096);
+                       bool ok = !rewind.rewind(data.size() - WINDOW - 1) &&
+                           !rewind.rewind(data.size() + 1) &&
+                           rewind.position() == data.size();
+                       rewind.finish();
+                       return ok;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
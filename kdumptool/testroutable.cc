@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <chrono>
+
+#include "global.h"
+#include "debug.h"
+#include "routable.h"
+#include "stringvector.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+typedef std::chrono::steady_clock Clock;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static double seconds(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+
+        test.check("Loopback is reachable",
+                   []() {
+                       Routable rt("127.0.0.1");
+                       return rt.check(1) && rt.prefsrc() == "127.0.0.1";
+                   });
+
+        test.check("Cached result has the source address",
+                   []() {
+                       Routable rt("127.0.0.1");
+                       return rt.check(1) && rt.prefsrc() == "127.0.0.1";
+                   });
+
+        // both families are asked, whichever answers is used
+        test.check("Host name is resolved without delay",
+                   []() {
+                       Clock::time_point start = Clock::now();
+                       return Routable("localhost").check(5) &&
+                           seconds(start) < 1;
+                   });
+
+        // .invalid never resolves (RFC 2606)
+        test.check("Unresolvable hosts are checked concurrently",
+                   []() {
+                       StringVector hosts;
+                       hosts.push_back("a.kdump.invalid");
+                       hosts.push_back("b.kdump.invalid");
+                       hosts.push_back("a.kdump.invalid");
+                       hosts.push_back("127.0.0.1");
+                       Clock::time_point start = Clock::now();
+                       Routable::checkAll(hosts, 1);
+                       // one timeout, not one per host
+                       return seconds(start) < 1.9;
+                   });
+
+        test.check("Unreachable result is cached",
+                   []() {
+                       Clock::time_point start = Clock::now();
+                       bool a = Routable("a.kdump.invalid").check(1);
+                       bool b = Routable("b.kdump.invalid").check(1);
+                       return !a && !b && seconds(start) < 0.5;
+                   });
+
+        test.check("Cache can be cleared",
+                   []() {
+                       Routable::clearCache();
+                       Clock::time_point start = Clock::now();
+                       return !Routable("a.kdump.invalid").check(1) &&
+                           seconds(start) >= 0.9;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "global.h"
+#include "debug.h"
+#include "s3transfer.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static std::vector<S3Multipart::Part> twoParts()
+{
+    std::vector<S3Multipart::Part> parts(2);
+    parts[0].number = 1;
+    parts[0].offset = 0;
+    parts[0].size = 5 << 20;
+    parts[0].crc = "1a2b3c4d";
+    parts[0].etag = "\"e1\"";
+    parts[1].number = 2;
+    parts[1].offset = 5 << 20;
+    parts[1].size = 100;
+    parts[1].crc = "5e6f7a8b";
+    parts[1].etag = "\"e2\"";
+    return parts;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+
+        test.check("Object keys are percent-encoded",
+                   []() {
+                       return S3Multipart::encodeKey(
+                           "/dumps/10.0.0.1-2026-10-14-08:00/vmcore") ==
+                           "/dumps/10.0.0.1-2026-10-14-08%3A00/vmcore" &&
+                           S3Multipart::encodeKey("a/b+c=", false) ==
+                           "a%2Fb%2Bc%3D";
+                   });
+
+        test.check("Upload ID from the XML response",
+                   []() {
+                       string xml =
+                           "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                           "<InitiateMultipartUploadResult>"
+                           "<Bucket>dumps</Bucket><Key>vmcore</Key>"
+                           "<UploadId>VXBsb2Fk&amp;SUQ</UploadId>"
+                           "</InitiateMultipartUploadResult>";
+                       return S3Multipart::xmlValue(xml, "UploadId") ==
+                           "VXBsb2Fk&SUQ" &&
+                           S3Multipart::xmlValue(xml, "Code").empty();
+                   });
+
+        test.check("ETag response header",
+                   []() {
+                       const char etag[] = "etag: \"3858f62230ac3c91\"\r\n";
+                       const char other[] = "Content-Length: 0\r\n";
+                       return S3Multipart::headerValue(
+                           etag, strlen(etag), "ETag") ==
+                           "\"3858f62230ac3c91\"" &&
+                           S3Multipart::headerValue(
+                               other, strlen(other), "ETag").empty();
+                   });
+
+        test.check("CompleteMultipartUpload body",
+                   []() {
+                       return S3Multipart::completion(twoParts()) ==
+                           "<CompleteMultipartUpload "
+                           "xmlns=\"http://s3.amazonaws.com/doc/2006-03-01/\">"
+                           "<Part><PartNumber>1</PartNumber>"
+                           "<ETag>\"e1\"</ETag></Part>"
+                           "<Part><PartNumber>2</PartNumber>"
+                           "<ETag>\"e2\"</ETag></Part>"
+                           "</CompleteMultipartUpload>";
+                   });
+
+        test.check("Part manifest",
+                   []() {
+                       string manifest = S3Multipart::manifest(
+                           "/dumps/vmcore", "abc", twoParts());
+                       return manifest.find("# upload ID abc\n") !=
+                           string::npos &&
+                           manifest.find("\n1 0 5242880 1a2b3c4d \"e1\"\n") !=
+                           string::npos &&
+                           manifest.find("\n2 5242880 100 5e6f7a8b \"e2\"\n") !=
+                           string::npos;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "global.h"
+#include "debug.h"
+#include "savestats.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+
+// -----------------------------------------------------------------------------
+static bool contains(const string &haystack, const string &needle)
+{
+    if (haystack.find(needle) != string::npos)
+        return true;
+    cerr << "\"" << needle << "\" not found in:" << endl << haystack;
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+        SaveStats *stats = SaveStats::stats();
+
+        test.check("Timer records bytes",
+                   [stats]() {
+                       {
+                           SaveStats::Timer timer("dump");
+                           timer.bytes(1048576);
+                       }
+                       SaveStats::Phase phase;
+                       return stats->find("dump", phase) &&
+                           phase.bytes == 1048576 && phase.ok &&
+                           phase.end >= phase.start;
+                   });
+
+        test.check("Timer left with an exception",
+                   [stats]() {
+                       try {
+                           SaveStats::Timer timer("kernel");
+                           throw KError("copying failed");
+                       } catch (const KError &) {
+                       }
+                       SaveStats::Phase phase;
+                       return stats->find("kernel", phase) && !phase.ok;
+                   });
+
+        test.check("Phases sorted by start",
+                   [stats]() {
+                       SaveStats::Clock::time_point now =
+                           SaveStats::Clock::now();
+                       stats->add("config", now - std::chrono::seconds(2),
+                                  now - std::chrono::seconds(1), 0, true);
+                       string json = stats->json();
+                       return json.find("\"config\"") <
+                           json.find("\"dump\"") &&
+                           contains(json, "\"name\": \"config\", "
+                                    "\"start\": 0.000, \"seconds\": 1.000");
+                   });
+
+        test.check("Fields are escaped",
+                   [stats]() {
+                       stats->setField("host", "a\"b\\c\n");
+                       stats->setField("crash_time", 1234567890ULL);
+                       string json = stats->json();
+                       return contains(json,
+                                       "\"host\": \"a\\\"b\\\\c\\u000a\",") &&
+                           contains(json, "\"crash_time\": 1234567890,") &&
+                           contains(json, "\"ok\": false }");
+                   });
+
+        test.check("Transfer meter",
+                   [stats]() {
+                       {
+                           TransferMeter meter("pipe", "vmcore");
+                           size_t n = meter.source([]() { return 4096; });
+                           meter.moved(n);
+                           meter.sink([]() { });
+                           meter.sparse(512);
+                       }
+                       string json = stats->json();
+                       return contains(json, "\"method\": \"pipe\", "
+                                       "\"target\": \"vmcore\"") &&
+                           contains(json, "\"source_calls\": 1") &&
+                           contains(json, "\"sink_calls\": 1") &&
+                           contains(json, "\"bytes\": 4096, "
+                                    "\"sparse_bytes\": 512, \"ok\": true");
+                   });
+
+        test.check("Sink time as the remainder",
+                   [stats]() {
+                       stats->clear();
+                       try {
+                           TransferMeter meter("ftp", "vmcore");
+                           meter.sinkIsRemainder();
+                           std::this_thread::sleep_for(
+                               std::chrono::milliseconds(20));
+                           throw KError("upload failed");
+                       } catch (const KError &) {
+                       }
+                       string json = stats->json();
+                       size_t pos = json.find("\"sink_seconds\": ");
+                       return pos != string::npos &&
+                           atof(json.c_str() + pos + 16) >= 0.02 &&
+                           contains(json, "\"ok\": false }");
+                   });
+
+        test.check("Summary of the dump phase",
+                   [stats]() {
+                       stats->clear();
+                       SaveStats::Clock::time_point now =
+                           SaveStats::Clock::now();
+                       stats->add("dump", now - std::chrono::seconds(4),
+                                  now, 40ULL << 20, true);
+                       return contains(stats->summary(),
+                                       "dump 4.0 s, 40.0 MiB at 10.0 MiB/s; ");
+                   });
+
+        test.check("Memory peaks of a phase",
+                   [stats]() {
+                       stats->clear();
+                       SaveStats::Clock::time_point now =
+                           SaveStats::Clock::now();
+                       SaveStats::Memory m = SaveStats::Memory();
+                       m.time = now - std::chrono::seconds(3);
+                       m.available = 100000;
+                       m.rss = 20000;
+                       stats->addMemory(m);
+                       m.time = now - std::chrono::seconds(1);
+                       m.available = 150000;
+                       m.dirty = 4096;
+                       m.helperRss = 50000;
+                       stats->addMemory(m);
+                       stats->add("filter", now - std::chrono::seconds(4),
+                                  now - std::chrono::seconds(2), 0, true);
+                       stats->add("dump", now - std::chrono::seconds(2),
+                                  now, 0, true);
+                       string json = stats->json();
+                       return contains(json, "\"ok\": true,\n      "
+                                       "\"memory\": { \"samples\": 1, "
+                                       "\"min_available_kb\": 100000, "
+                                       "\"max_dirty_kb\": 0") &&
+                           contains(json, "\"max_dirty_kb\": 4096, "
+                                    "\"max_writeback_kb\": 0, "
+                                    "\"max_slab_kb\": 0, "
+                                    "\"max_rss_kb\": 20000, "
+                                    "\"max_makedumpfile_rss_kb\": 50000 }") &&
+                           contains(json, "\"memory\": { \"samples\": 2, "
+                                    "\"min_available_kb\": 100000, "
+                                    "\"max_dirty_kb\": 4096,");
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "global.h"
+#include "debug.h"
+#include "segmentreader.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::vector;
+
+#define MiB     (1ULL << 20)
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+typedef SegmentDataProvider::Range Range;
+
+// -----------------------------------------------------------------------------
+static VmcoreContext::Segment segment(unsigned long long vaddr,
+                                      unsigned long long paddr,
+                                      off_t offset, unsigned long long size)
+{
+    VmcoreContext::Segment seg;
+    seg.vaddr = vaddr;
+    seg.paddr = paddr;
+    seg.offset = offset;
+    seg.filesz = seg.memsz = size;
+    return seg;
+}
+
+// -----------------------------------------------------------------------------
+static vector<Range> blocks(off_t size, size_t length)
+{
+    vector<Range> ret;
+    Range r;
+    r.offset = 0;
+    r.length = 4096;
+    ret.push_back(r);
+    for (off_t off = 4096; off < size; off += length) {
+        r.offset = off;
+        r.length = std::min<off_t>(length, size - off);
+        ret.push_back(r);
+    }
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+
+        // low memory, then the kernel text at physical 16 MiB, then
+        // the direct mapping of 0-32 MiB
+        vector<VmcoreContext::Segment> segs;
+        segs.push_back(segment(0xffff888000000000ULL, 0, 4096, 8 * MiB));
+        segs.push_back(segment(0xffffffff81000000ULL, 16 * MiB,
+                               4096 + 8 * MiB, 8 * MiB));
+        segs.push_back(segment(0xffff888001000000ULL, 16 * MiB,
+                               4096 + 16 * MiB, 16 * MiB));
+        const off_t size = 4096 + 32 * MiB;
+
+        test.check("Headers, kernel image, its memory, rest",
+                   [&]() {
+                       vector<Range> b = blocks(size, 2 * MiB);
+                       SegmentDataProvider::prioritize(
+                           b, segs, 0xffffffff81000000ULL);
+                       // header, last block, 4 kernel blocks, 4 physical
+                       // copies, the remaining 6 blocks
+                       return b.size() == 17 && b[0].offset == 0 &&
+                           b[1].offset == size - 2 * (off_t)MiB &&
+                           b[2].offset == 4096 + 8 * (off_t)MiB &&
+                           b[6].offset == 4096 + 16 * (off_t)MiB &&
+                           b[10].offset == 4096;
+                   });
+
+        test.check("Order is kept within a class",
+                   [&]() {
+                       vector<Range> b = blocks(size, 2 * MiB);
+                       SegmentDataProvider::prioritize(
+                           b, segs, 0xffffffff81000000ULL);
+                       for (size_t i = 3; i < b.size(); ++i)
+                           if (i != 6 && i != 10 &&
+                                   b[i].offset < b[i - 1].offset)
+                               return false;
+                       return true;
+                   });
+
+        test.check("Without _stext the first segment is the kernel",
+                   [&]() {
+                       vector<Range> b = blocks(size, 2 * MiB);
+                       SegmentDataProvider::prioritize(b, segs, 0);
+                       return b[2].offset == 4096;
+                   });
+
+        test.check("Every block is kept",
+                   [&]() {
+                       vector<Range> b = blocks(size, 3 * MiB);
+                       vector<Range> orig = b;
+                       SegmentDataProvider::prioritize(
+                           b, segs, 0xffffffff81000000ULL);
+                       unsigned long long sum = 0;
+                       for (size_t i = 0; i < b.size(); ++i)
+                           sum += b[i].length;
+                       return b.size() == orig.size() &&
+                           sum == (unsigned long long)size;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -138,6 +138,10 @@ int main(int argc, char *argv[])
 		dumpvec(pkt.update());
 		break;
 
+	    case 'p':
+		dumpvec(pkt.update(parseval(arg + 1, 8)));
+		break;
+
 	    case 'b':
 		if (arg[1])
 		    pkt.addByte(parseval(arg + 1, 2));
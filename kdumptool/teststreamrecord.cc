@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+
+#include <unistd.h>
+
+#include "global.h"
+#include "debug.h"
+#include "fileutil.h"
+#include "streamrecord.h"
+#include "benchtransfer.h"
+#include "flattened.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+#define CHUNKS      5
+#define CHUNK_SIZE  1000
+#define CHUNK_DELAY 20      // milliseconds
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+//{{{ BurstDataProvider -------------------------------------------------------
+
+/**
+ * Returns CHUNKS chunks of CHUNK_SIZE bytes, each one after a pause,
+ * like makedumpfile between two compressed blocks.
+ */
+class BurstDataProvider : public AbstractDataProvider {
+    unsigned m_chunk;
+
+public:
+    BurstDataProvider()
+        : m_chunk(0)
+    { }
+
+    size_t getData(char *buffer, size_t maxread)
+    {
+        if (m_chunk == CHUNKS)
+            return 0;
+        std::this_thread::sleep_for(
+            std::chrono::milliseconds(CHUNK_DELAY));
+        size_t len = std::min(maxread, size_t(CHUNK_SIZE));
+        memset(buffer, 'a' + m_chunk++, len);
+        return len;
+    }
+};
+
+//}}}
+
+// -----------------------------------------------------------------------------
+/**
+ * Reads a whole stream and remembers the size of each chunk.
+ */
+static string readAll(DataProvider &dp, std::vector<size_t> *chunks = NULL)
+{
+    string ret;
+    char buf[65536];
+    size_t n;
+
+    dp.prepare();
+    while ((n = dp.getData(buf, sizeof buf)) > 0) {
+        ret.append(buf, n);
+        if (chunks)
+            chunks->push_back(n);
+    }
+    dp.finish();
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+static string readFile(const string &path)
+{
+    FileDataProvider dp(path.c_str());
+    return readAll(dp);
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_INFO);
+
+    char tmpl[] = "teststreamrecord.XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        cerr << "mkdtemp() failed" << endl;
+        return EXIT_FAILURE;
+    }
+    FilePath dir(tmpl);
+    string stream = FilePath(dir).appendPath("stream");
+
+    try {
+        TestRun test;
+        string expect;
+
+        test.check("Record a stream",
+                   [&]() {
+                       BurstDataProvider burst;
+                       RecordingDataProvider rec(&burst, stream);
+                       expect = readAll(rec);
+                       string timing = readFile(stream + ".timing");
+                       size_t lines = 0;
+                       for (size_t i = 0; i < timing.size(); ++i)
+                           if (timing[i] == '\n')
+                               ++lines;
+                       // the header and one line for each chunk
+                       return expect.size() == CHUNKS * CHUNK_SIZE &&
+                           rec.recorded() == expect.size() &&
+                           readFile(stream) == expect &&
+                           lines == CHUNKS + 1 && !rec.canSplice() &&
+                           !rec.canSaveToFile();
+                   });
+
+        test.check("Replay at full speed keeps the chunks",
+                   [&]() {
+                       ReplayDataProvider replay(stream, false);
+                       std::vector<size_t> chunks;
+                       std::chrono::steady_clock::time_point start =
+                           std::chrono::steady_clock::now();
+                       string data = readAll(replay, &chunks);
+                       std::chrono::duration<double> elapsed =
+                           std::chrono::steady_clock::now() - start;
+                       return data == expect && chunks.size() == CHUNKS &&
+                           chunks[0] == CHUNK_SIZE &&
+                           replay.chunks() == CHUNKS &&
+                           replay.produced() == expect.size() &&
+                           replay.latencies().size() == CHUNKS &&
+                           elapsed.count() < replay.duration();
+                   });
+
+        test.check("Replay in real time",
+                   [&]() {
+                       ReplayDataProvider replay(stream, true);
+                       std::chrono::steady_clock::time_point start =
+                           std::chrono::steady_clock::now();
+                       string data = readAll(replay);
+                       std::chrono::duration<double> elapsed =
+                           std::chrono::steady_clock::now() - start;
+                       return data == expect &&
+                           replay.duration() >= CHUNKS * CHUNK_DELAY / 1000.0 &&
+                           elapsed.count() >= replay.duration();
+                   });
+
+        test.check("Replay without timing",
+                   [&]() {
+                       unlink((stream + ".timing").c_str());
+                       ReplayDataProvider replay(stream, false);
+                       std::vector<size_t> chunks;
+                       string data = readAll(replay, &chunks);
+                       if (data != expect || chunks.size() != 1)
+                           return false;
+
+                       ReplayDataProvider realtime(stream, true);
+                       try {
+                           realtime.prepare();
+                       } catch (const KError &) {
+                           return true;
+                       }
+                       return false;
+                   });
+
+        test.check("A failed recording passes the data on",
+                   [&]() {
+                       BurstDataProvider burst;
+                       RecordingDataProvider rec(&burst,
+                           FilePath(dir).appendPath("missing/stream"));
+                       return readAll(rec) == expect && rec.recorded() == 0;
+                   });
+
+        test.check("Unflatten a replayed stream",
+                   [&]() {
+                       SyntheticDataProvider mixed(
+                           SyntheticDataProvider::SP_MIXED, 1 << 20, 30);
+                       string plain = readAll(mixed);
+
+                       SyntheticDataProvider synth(
+                           SyntheticDataProvider::SP_FLATTENED, 1 << 20, 30);
+                       RecordingDataProvider rec(&synth, stream);
+                       readAll(rec);
+
+                       ReplayDataProvider replay(stream, false);
+                       FlattenedDataProvider flat(&replay);
+                       string placed(plain.size(), '\0');
+                       char buf[4096];
+                       off_t offset;
+                       size_t n;
+                       flat.prepare();
+                       while ((n = flat.getPlacedData(buf, sizeof buf,
+                                                      &offset)) > 0) {
+                           if (offset + n > placed.size())
+                               return false;
+                           memcpy(&placed[offset], buf, n);
+                       }
+                       flat.finish();
+                       return placed == plain;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    dir.rmdir(true);
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+#include "global.h"
+#include "debug.h"
+#include "taskgraph.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_TRACE);
+    try {
+        TestRun test;
+
+        test.check("Dependencies are respected",
+                   []() {
+                       std::mutex mutex;
+                       string order;
+                       auto append = [&](char c) {
+                           return [&, c]() {
+                               std::lock_guard<std::mutex> lock(mutex);
+                               order += c;
+                           };
+                       };
+
+                       TaskGraph graph(4);
+                       size_t a = graph.add("a", append('a'));
+                       size_t b = graph.add("b", append('b'), { a });
+                       size_t c = graph.add("c", append('c'), { b });
+                       graph.add("d", append('d'), { a, c });
+                       graph.run();
+                       return order == "abcd";
+                   });
+
+        test.check("Independent tasks run concurrently",
+                   []() {
+                       std::mutex mutex;
+                       std::condition_variable cond;
+                       bool first = false, second = false;
+
+                       // each task waits for the other one
+                       TaskGraph graph(2);
+                       graph.add("first", [&]() {
+                               std::unique_lock<std::mutex> lock(mutex);
+                               first = true;
+                               cond.notify_all();
+                               cond.wait_for(lock, std::chrono::seconds(10),
+                                             [&]{ return second; });
+                           });
+                       graph.add("second", [&]() {
+                               std::unique_lock<std::mutex> lock(mutex);
+                               second = true;
+                               cond.notify_all();
+                               cond.wait_for(lock, std::chrono::seconds(10),
+                                             [&]{ return first; });
+                           });
+
+                       auto start = std::chrono::steady_clock::now();
+                       graph.run();
+                       return std::chrono::steady_clock::now() - start <
+                           std::chrono::seconds(5);
+                   });
+
+        test.check("abort() skips pending tasks",
+                   []() {
+                       bool ran = false, always = false;
+
+                       TaskGraph graph(1);
+                       size_t a = graph.add("a", [&]() { graph.abort(); });
+                       size_t b = graph.add("b", [&]() { ran = true; }, { a });
+                       graph.add("c", [&]() { always = true; }, { a }, true);
+                       graph.run();
+                       return !ran && always && graph.skipped(b);
+                   });
+
+        test.check("Exceptions are re-thrown",
+                   []() {
+                       bool ran = false;
+
+                       TaskGraph graph(1);
+                       size_t a = graph.add("a", []() {
+                               throw KError("task failed");
+                           });
+                       graph.add("b", [&]() { ran = true; }, { a });
+                       try {
+                           graph.run();
+                       } catch (const KError &) {
+                           return !ran;
+                       }
+                       return false;
+                   });
+
+        test.check("Unknown dependencies are rejected",
+                   []() {
+                       TaskGraph graph(1);
+                       try {
+                           graph.add("a", []() {}, { 0 });
+                       } catch (const KError &) {
+                           return true;
+                       }
+                       return false;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
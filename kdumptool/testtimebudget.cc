@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "global.h"
+#include "debug.h"
+#include "dataprovider.h"
+#include "timebudget.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+#define MiB     (1ULL << 20)
+#define GiB     (1ULL << 30)
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static DumpEstimator makeEstimator()
+{
+    DumpEstimator e(16 * GiB, 4096);
+    e.setPages(DumpEstimator::PC_ZERO, 1 * GiB / 4096);
+    e.setPages(DumpEstimator::PC_CACHE, 4 * GiB / 4096);
+    e.setPages(DumpEstimator::PC_USER, 4 * GiB / 4096);
+    e.setPages(DumpEstimator::PC_FREE, 4 * GiB / 4096);
+    return e;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+
+        test.check("Configured settings come first",
+                   []() {
+                       DumpEstimator e = makeEstimator();
+                       DumpPolicy policy(e, 0, 1, true);
+                       vector<DumpPolicy::Choice> c =
+                           policy.candidates(1, "ELF", 0);
+                       return c.size() > 1 && c[0].dumplevel == 1 &&
+                           c[0].format == "ELF";
+                   });
+
+        test.check("Large budget keeps the configuration",
+                   []() {
+                       DumpEstimator e = makeEstimator();
+                       DumpPolicy policy(e, 0, 1, true);
+                       vector<DumpPolicy::Choice> c =
+                           policy.candidates(31, "compressed", 1 * GiB);
+                       return DumpPolicy::choose(c, 86400) == 0;
+                   });
+
+        test.check("Slow target downgrades",
+                   []() {
+                       DumpEstimator e = makeEstimator();
+                       DumpPolicy policy(e, 0, 1, true);
+                       vector<DumpPolicy::Choice> c =
+                           policy.candidates(0, "ELF", 100 * MiB);
+                       // a full dump needs more than two minutes
+                       size_t i = DumpPolicy::choose(c, 120);
+                       return i != 0 && c[i].seconds <= 120 &&
+                           c[i].estimate.size < c[0].estimate.size;
+                   });
+
+        test.check("Fastest candidate if nothing fits",
+                   []() {
+                       DumpEstimator e = makeEstimator();
+                       DumpPolicy policy(e, 0, 1, true);
+                       vector<DumpPolicy::Choice> c =
+                           policy.candidates(0, "ELF", 1 * MiB);
+                       size_t i = DumpPolicy::choose(c, 1);
+                       for (size_t j = 0; j < c.size(); ++j)
+                           if (c[j].seconds < c[i].seconds)
+                               return false;
+                       return true;
+                   });
+
+        test.check("Restart skips earlier candidates",
+                   []() {
+                       DumpEstimator e = makeEstimator();
+                       DumpPolicy policy(e, 0, 1, true);
+                       vector<DumpPolicy::Choice> c =
+                           policy.candidates(0, "ELF", 1 * GiB);
+                       return DumpPolicy::choose(c, 86400, 2) == 2 &&
+                           DumpPolicy::choose(c, 86400, c.size()) ==
+                           c.size() - 1;
+                   });
+
+        test.check("Data passes before the deadline",
+                   []() {
+                       string data(1 * MiB, 'x');
+                       BufferDataProvider buffer(data.data(), data.size());
+                       DeadlineDataProvider dp(&buffer,
+                           DeadlineDataProvider::Clock::now() +
+                           std::chrono::hours(1), data.size());
+                       dp.prepare();
+                       string out;
+                       char buf[65536];
+                       size_t n;
+                       while ((n = dp.getData(buf, sizeof buf)) > 0)
+                           out.append(buf, n);
+                       dp.finish();
+                       return out == data && !dp.canSaveToFile();
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <chrono>
+
+#include <unistd.h>
+
+#include "global.h"
+#include "debug.h"
+#include "configuration.h"
+#include "dataprovider.h"
+#include "uploaddumps.h"
+#include "fileutil.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::ofstream;
+using std::string;
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+static FilePath stageDump(const FilePath &staging, const string &name,
+                          const string &target)
+{
+    FilePath dump = staging;
+    dump.appendPath(name);
+    dump.mkdir(true);
+
+    FilePath file = dump;
+    file.appendPath("vmcore");
+    ofstream(file.c_str()) << string(65536, 'x');
+    (file = dump).appendPath("README.txt");
+    ofstream(file.c_str()) << "Kernel crash" << endl;
+
+    UploadMarker::create(dump, StringVector(1, target));
+    return dump;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    char tmpl[] = "/tmp/testuploaddumps.XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        cerr << "Cannot create a temporary directory" << endl;
+        return EXIT_FAILURE;
+    }
+    FilePath dir(tmpl);
+
+    try {
+        TestRun test;
+
+        FilePath configFile = dir;
+        configFile.appendPath("kdump.conf");
+        FilePath staging = dir;
+        staging.appendPath("staging");
+        FilePath remote = dir;
+        remote.appendPath("remote");
+        string target = "file://" + remote;
+        ofstream(configFile.c_str())
+            << "KDUMP_STAGING_DIR=\"" << staging << "\"" << endl;
+        Configuration::config()->readFile(configFile);
+
+        test.check("Throttle limits the rate",
+                   []() {
+                       string data(65536, 'x');
+                       char buffer[16384];
+                       BufferDataProvider buf(data.c_str(), data.size());
+                       ThrottledDataProvider throttled(&buf, 262144);
+                       auto start = std::chrono::steady_clock::now();
+                       throttled.prepare();
+                       size_t total = 0, n;
+                       while ((n = throttled.getData(buffer,
+                                                     sizeof buffer)) > 0)
+                           total += n;
+                       throttled.finish();
+                       auto ms = std::chrono::duration_cast<
+                           std::chrono::milliseconds>(
+                               std::chrono::steady_clock::now() - start);
+                       // 64 KiB at 256 KiB/s
+                       return total == data.size() && ms.count() >= 200 &&
+                           !throttled.canSaveToFile();
+                   });
+
+        test.check("Marker records the progress",
+                   [&]() {
+                       FilePath dump = stageDump(staging, "marker", target);
+                       {
+                           UploadMarker marker(dump);
+                           marker.setDestination(target, target + "/x");
+                           marker.setDone(target, "README.txt");
+                       }
+                       UploadMarker marker(dump);
+                       bool ok = marker.exists() &&
+                           marker.targets().size() == 1 &&
+                           marker.destination(target) == target + "/x" &&
+                           marker.done(target, "README.txt") &&
+                           !marker.done(target, "vmcore");
+                       dump.rmdir(true);
+                       return ok;
+                   });
+
+        test.check("Staged dump is uploaded and removed",
+                   [&]() {
+                       FilePath dump = stageDump(staging, "2020-01-01-00:00",
+                                                 target);
+                       UploadDumps upload;
+                       upload.execute();
+                       FilePath vmcore = remote;
+                       vmcore.appendPath("2020-01-01-00:00/vmcore");
+                       return vmcore.exists() &&
+                           vmcore.fileSize() == 65536 && !dump.exists();
+                   });
+
+        test.check("Uploaded files are not copied again",
+                   [&]() {
+                       FilePath dump = stageDump(staging, "2020-01-02-00:00",
+                                                 target);
+                       UploadMarker(dump).setDone(target, "vmcore");
+                       UploadDumps upload;
+                       upload.execute();
+                       FilePath copy = remote;
+                       copy.appendPath("2020-01-02-00:00");
+                       FilePath readme = copy, vmcore = copy;
+                       readme.appendPath("README.txt");
+                       vmcore.appendPath("vmcore");
+                       return readme.exists() && !vmcore.exists() &&
+                           !dump.exists();
+                   });
+
+        test.check("Dumps without a marker stay",
+                   [&]() {
+                       FilePath dump = staging;
+                       dump.appendPath("2020-01-03-00:00");
+                       dump.mkdir(true);
+                       UploadDumps upload;
+                       upload.execute();
+                       return dump.exists();
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    dir.rmdir(true);
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
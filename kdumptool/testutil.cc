@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "global.h"
+#include "debug.h"
+#include "util.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::vector;
+
+// larger than any vector block of Util::isZero(), so that every
+// implementation sees an unaligned head and tail
+#define MAX_SHIFT       64
+#define MAX_LENGTH      300
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+/**
+ * Calls @p fn for every tested combination of start offset and length.
+ * The lengths cover each remainder of the vector blocks and a few pages.
+ */
+template<typename check_fn>
+static bool forEachRange(check_fn fn)
+{
+    vector<size_t> lengths;
+    for (size_t len = 0; len <= MAX_LENGTH; ++len)
+        lengths.push_back(len);
+    lengths.push_back(4095);
+    lengths.push_back(4096);
+    lengths.push_back(4097);
+    lengths.push_back(3 * 4096 + 65);
+
+    for (size_t shift = 0; shift < MAX_SHIFT; ++shift)
+        for (size_t i = 0; i < lengths.size(); ++i)
+            if (!fn(shift, lengths[i]))
+                return false;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+
+    try {
+        TestRun test;
+
+        // room for a guard byte before and after every range
+        vector<char> buf(MAX_SHIFT + 4 * 4096 + 2);
+
+        test.check("Zero ranges at any offset and of any length",
+                   [&]() {
+                       return forEachRange([&](size_t shift, size_t len) {
+                               return Util::isZero(&buf[1 + shift], len);
+                           });
+                   });
+
+        test.check("Non-zero bytes next to the range are ignored",
+                   [&]() {
+                       return forEachRange([&](size_t shift, size_t len) {
+                               char *p = &buf[1 + shift];
+                               p[-1] = p[len] = 1;
+                               bool ret = Util::isZero(p, len);
+                               p[-1] = p[len] = 0;
+                               return ret;
+                           });
+                   });
+
+        test.check("A single non-zero byte in the head, body or tail",
+                   [&]() {
+                       return forEachRange([&](size_t shift, size_t len) {
+                               char *p = &buf[1 + shift];
+                               size_t pos[] = { 0, len / 2, len - 1 };
+                               for (size_t i = 0; len && i < 3; ++i) {
+                                   p[pos[i]] = char(0x80 >> (i + shift) % 8);
+                                   bool ret = Util::isZero(p, len);
+                                   p[pos[i]] = 0;
+                                   if (ret)
+                                       return false;
+                               }
+                               return true;
+                           });
+                   });
+
+        test.check("Every position of a non-zero byte is found",
+                   [&]() {
+                       char *p = &buf[1];
+                       for (size_t len = 1; len <= MAX_LENGTH; ++len) {
+                           for (size_t i = 0; i < len; ++i) {
+                               p[i] = 1;
+                               bool ret = Util::isZero(p, len);
+                               p[i] = 0;
+                               if (ret)
+                                   return false;
+                           }
+                       }
+                       return true;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
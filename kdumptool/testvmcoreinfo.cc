@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <elf.h>
+#include <endian.h>
+#include <unistd.h>
+
+#include "global.h"
+#include "debug.h"
+#include "vmcoreinfo.h"
+#include "vmcorecontext.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+// size of a per-CPU NT_PRSTATUS note on x86_64
+#define PRSTATUS_SIZE		336
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+template<typename Nhdr>
+static string note(const string &name, unsigned type, const string &desc)
+{
+    Nhdr nhdr;
+    nhdr.n_namesz = name.size() + 1;
+    nhdr.n_descsz = desc.size();
+    nhdr.n_type = type;
+
+    string ret(reinterpret_cast<char *>(&nhdr), sizeof nhdr);
+    ret.append(name.c_str(), name.size() + 1);
+    ret.resize((ret.size() + 3) & ~3);
+    ret += desc;
+    ret.resize((ret.size() + 3) & ~3);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+template<typename Ehdr, typename Phdr>
+static string writeDump(const string &notes, bool withNotes = true)
+{
+    Ehdr ehdr;
+    memset(&ehdr, 0, sizeof ehdr);
+    memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+    ehdr.e_ident[EI_CLASS] = sizeof(ehdr.e_entry) == 8
+        ? ELFCLASS64 : ELFCLASS32;
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+    ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+#else
+    ehdr.e_ident[EI_DATA] = ELFDATA2MSB;
+#endif
+    ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+    ehdr.e_type = ET_CORE;
+    ehdr.e_version = EV_CURRENT;
+    ehdr.e_phoff = sizeof ehdr;
+    ehdr.e_ehsize = sizeof ehdr;
+    ehdr.e_phentsize = sizeof(Phdr);
+    ehdr.e_phnum = 1;
+
+    Phdr phdr;
+    memset(&phdr, 0, sizeof phdr);
+    phdr.p_type = withNotes ? PT_NOTE : PT_LOAD;
+    phdr.p_offset = sizeof ehdr + sizeof phdr;
+    phdr.p_filesz = notes.size();
+
+    string file(reinterpret_cast<char *>(&ehdr), sizeof ehdr);
+    file.append(reinterpret_cast<char *>(&phdr), sizeof phdr);
+    file += notes;
+
+    char path[] = "testvmcoreinfo.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+        throw KSystemError("mkstemp() failed", errno);
+    bool ok = write(fd, file.data(), file.size()) == ssize_t(file.size());
+    close(fd);
+    if (!ok) {
+        unlink(path);
+        throw KError("Cannot write the test dump.");
+    }
+    return path;
+}
+
+// -----------------------------------------------------------------------------
+template<typename Ehdr, typename Phdr, typename Nhdr>
+static Vmcoreinfo readDump(const string &notes, bool withNotes = true)
+{
+    string path = writeDump<Ehdr, Phdr>(notes, withNotes);
+
+    Vmcoreinfo vm;
+    try {
+        vm.readFromELF(path.c_str());
+    } catch (...) {
+        unlink(path.c_str());
+        throw;
+    }
+    unlink(path.c_str());
+    return vm;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    try {
+        TestRun test;
+
+        const string info = "OSRELEASE=6.4.0-test\nCRASHTIME=1700000000\n";
+        const string prstatus(PRSTATUS_SIZE, 'x');
+
+        test.check("VMCOREINFO after many CPU notes",
+                   [&info, &prstatus]() {
+                       string notes;
+                       for (int i = 0; i < 2048; ++i)
+                           notes += note<Elf64_Nhdr>("CORE", NT_PRSTATUS,
+                                                     prstatus);
+                       notes += note<Elf64_Nhdr>("VMCOREINFO", 0, info);
+                       Vmcoreinfo vm = readDump<Elf64_Ehdr, Elf64_Phdr,
+                                                Elf64_Nhdr>(notes);
+                       return vm.getStringValue("OSRELEASE") ==
+                           "6.4.0-test" && !vm.isXenVmcoreinfo();
+                   });
+
+        test.check("ELF32 dump",
+                   [&info, &prstatus]() {
+                       string notes = note<Elf32_Nhdr>("CORE", NT_PRSTATUS,
+                                                       prstatus) +
+                           note<Elf32_Nhdr>("VMCOREINFO", 0, info);
+                       Vmcoreinfo vm = readDump<Elf32_Ehdr, Elf32_Phdr,
+                                                Elf32_Nhdr>(notes);
+                       return vm.getLLongValue("CRASHTIME") == 1700000000;
+                   });
+
+        test.check("VMCOREINFO_XEN is recognised",
+                   [&prstatus]() {
+                       string notes = note<Elf64_Nhdr>("CORE", NT_PRSTATUS,
+                                                       prstatus) +
+                           note<Elf64_Nhdr>("VMCOREINFO_XEN", 0,
+                                            "XEN_VERSION_MAJOR=4\n");
+                       Vmcoreinfo vm = readDump<Elf64_Ehdr, Elf64_Phdr,
+                                                Elf64_Nhdr>(notes);
+                       return vm.isXenVmcoreinfo() &&
+                           vm.getStringValue("XEN_VERSION_MAJOR") == "4";
+                   });
+
+        test.check("Missing VMCOREINFO is an error",
+                   [&prstatus]() {
+                       string notes = note<Elf64_Nhdr>("CORE", NT_PRSTATUS,
+                                                       prstatus);
+                       try {
+                           readDump<Elf64_Ehdr, Elf64_Phdr,
+                                    Elf64_Nhdr>(notes);
+                       } catch (const KError &) {
+                           return true;
+                       }
+                       return false;
+                   });
+
+        test.check("Missing PT_NOTE is an error",
+                   [&info]() {
+                       string notes = note<Elf64_Nhdr>("VMCOREINFO", 0, info);
+                       try {
+                           readDump<Elf64_Ehdr, Elf64_Phdr,
+                                    Elf64_Nhdr>(notes, false);
+                       } catch (const KError &) {
+                           return true;
+                       }
+                       return false;
+                   });
+
+        test.check("Xen note is detected",
+                   [&info]() {
+                       string notes = note<Elf64_Nhdr>("Xen", 0x1000001,
+                                                       string(8, 'x')) +
+                           note<Elf64_Nhdr>("VMCOREINFO", 0, info);
+                       string path = writeDump<Elf64_Ehdr, Elf64_Phdr>(notes);
+                       bool xen = VmcoreContext::get(path)->isXenDump();
+                       unlink(path.c_str());
+
+                       path = writeDump<Elf64_Ehdr, Elf64_Phdr>(
+                           note<Elf64_Nhdr>("VMCOREINFO", 0, info));
+                       bool other = VmcoreContext::get(path)->isXenDump();
+                       unlink(path.c_str());
+                       return xen && !other;
+                   });
+
+        test.check("Headers are parsed once",
+                   [&info]() {
+                       string notes = note<Elf64_Nhdr>("VMCOREINFO", 0, info);
+                       string path = writeDump<Elf64_Ehdr, Elf64_Phdr>(notes);
+                       std::shared_ptr<const VmcoreContext> first =
+                           VmcoreContext::get(path);
+                       bool same = VmcoreContext::get(path) == first;
+
+                       // a changed file is parsed again
+                       unlink(path.c_str());
+                       bool changed = false;
+                       if (rename(writeDump<Elf64_Ehdr, Elf64_Phdr>(
+                                      notes + notes).c_str(),
+                                  path.c_str()) == 0) {
+                           changed = VmcoreContext::get(path) != first;
+                           unlink(path.c_str());
+                       }
+                       return same && changed;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
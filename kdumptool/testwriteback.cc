@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "global.h"
+#include "debug.h"
+#include "writeback.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+#define WINDOW      (1024*1024)
+
+//{{{ TestRun -----------------------------------------------------------------
+
+class TestRun {
+    int m_result;
+
+public:
+    TestRun()
+        : m_result(EXIT_SUCCESS)
+    { }
+
+    int result(void)
+    { return m_result; }
+
+    template<typename check_fn>
+    void check(const char *what, check_fn fn);
+};
+
+// -----------------------------------------------------------------------------
+template<typename check_fn>
+void TestRun::check(const char *what, check_fn fn)
+{
+    cout << what << ": ";
+    try {
+        if (fn()) {
+            cout << "OK";
+        } else {
+            cout << "FAILED";
+            m_result = EXIT_FAILURE;
+        }
+        cout << endl;
+    } catch (KError &e) {
+        cout << "EXCEPTION" << endl;
+        cerr << e.what() << endl;
+        m_result = EXIT_FAILURE;
+    }
+}
+//}}}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int result = EXIT_SUCCESS;
+
+    Debug::debug()->setStderrLevel(Debug::DL_DEBUG);
+    char tmpl[] = "/tmp/testwriteback.XXXXXX";
+    int fd = mkstemp(tmpl);
+    if (fd < 0) {
+        cerr << "Cannot create a temporary file" << endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        TestRun test;
+
+        test.check("Windows behind the cursor are written back",
+                   [&]() {
+                       WritebackWindow window(fd, WINDOW);
+                       string chunk(WINDOW / 4, 'x');
+                       off_t pos = 0;
+                       bool ok = true;
+                       for (int i = 0; i < 40; ++i) {
+                           if (pwrite(fd, chunk.data(), chunk.size(), pos) !=
+                               (ssize_t)chunk.size())
+                               return false;
+                           pos += chunk.size();
+                           window.advance(pos);
+                           // never more than two windows outstanding
+                           if (window.enabled() &&
+                               pos - window.completed() > 2 * WINDOW)
+                               ok = false;
+                       }
+                       return ok && (!window.enabled() ||
+                                     window.completed() == 9 * WINDOW);
+                   });
+
+        test.check("Pipes are written normally",
+                   []() {
+                       int pfd[2];
+                       if (pipe(pfd) != 0)
+                           return false;
+                       WritebackWindow window(pfd[1], WINDOW);
+                       window.advance(2 * WINDOW);
+                       close(pfd[0]);
+                       close(pfd[1]);
+                       return !window.enabled() && window.completed() == 0;
+                   });
+
+        result = test.result();
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        result = EXIT_FAILURE;
+    }
+
+    close(fd);
+    unlink(tmpl);
+    return result;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
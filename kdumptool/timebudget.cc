@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <algorithm>
+#include <strings.h>
+
+#include "global.h"
+#include "debug.h"
+#include "fileutil.h"
+#include "stringutil.h"
+#include "timebudget.h"
+
+using std::string;
+using std::vector;
+
+// page types excluded one after another: zero, free, cache, user
+static const int level_steps[] = { 1, 16, 2 | 4, 8 };
+
+// formats tried for each dump level after the configured one
+static const char *const fallback_formats[] = { "lzo", "compressed" };
+
+//{{{ KDeadlineError -----------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+KDeadlineError::KDeadlineError(unsigned long long written,
+                               unsigned long long rate, unsigned long late)
+    : KError("The dump would exceed KDUMP_TIME_BUDGET by " +
+             StringUtil::number2string(late) + " s, stopped after " +
+             StringUtil::number2string(bytes_to_megabytes(written)) +
+             " MiB."),
+      m_rate(rate)
+{}
+
+//}}}
+//{{{ DumpPolicy ---------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+DumpPolicy::DumpPolicy(const DumpEstimator &estimator, int zstdLevel,
+                       unsigned long workers, bool sparse)
+    : m_estimator(estimator), m_zstdLevel(zstdLevel), m_workers(workers),
+      m_sparse(sparse)
+{}
+
+// -----------------------------------------------------------------------------
+vector<DumpPolicy::Choice> DumpPolicy::candidates(
+    int dumplevel, const string &format, unsigned long long rate) const
+{
+    vector<int> levels(1, dumplevel);
+    for (size_t i = 0; i < sizeof level_steps / sizeof level_steps[0]; ++i) {
+        int next = levels.back() | level_steps[i];
+        if (next != levels.back())
+            levels.push_back(next);
+    }
+
+    StringVector formats(1, format);
+    for (size_t i = 0;
+         i < sizeof fallback_formats / sizeof fallback_formats[0]; ++i) {
+        bool known = false;
+        for (size_t j = 0; j < formats.size(); ++j)
+            if (strcasecmp(formats[j].c_str(), fallback_formats[i]) == 0)
+                known = true;
+        if (!known)
+            formats.push_back(fallback_formats[i]);
+    }
+
+    vector<Choice> ret;
+    for (size_t i = 0; i < levels.size(); ++i) {
+        for (size_t j = 0; j < formats.size(); ++j) {
+            Choice c;
+            c.dumplevel = levels[i];
+            c.format = formats[j];
+            c.estimate = m_estimator.estimate(c.dumplevel, c.format,
+                                              m_zstdLevel, m_workers,
+                                              m_sparse);
+            c.seconds = c.estimate.seconds;
+            if (rate) {
+                unsigned long transfer = (c.estimate.size + rate - 1) / rate;
+                c.seconds = std::max(c.seconds, transfer);
+            }
+            Debug::debug()->dbg("Dump level %d, %s: %llu MiB in %lu s",
+                                c.dumplevel, c.format.c_str(),
+                                bytes_to_megabytes(c.estimate.size),
+                                c.seconds);
+            ret.push_back(c);
+        }
+    }
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+size_t DumpPolicy::choose(const vector<Choice> &candidates,
+                          unsigned long seconds, size_t first)
+{
+    if (first >= candidates.size())
+        return candidates.size() - 1;
+
+    size_t fastest = first;
+    for (size_t i = first; i < candidates.size(); ++i) {
+        if (candidates[i].seconds <= seconds)
+            return i;
+        if (candidates[i].seconds <= candidates[fastest].seconds)
+            fastest = i;
+    }
+    return fastest;
+}
+
+//}}}
+//{{{ DeadlineDataProvider -----------------------------------------------------
+
+// -----------------------------------------------------------------------------
+void DeadlineDataProvider::prepare()
+{
+    m_bytes = 0;
+    m_started = false;
+    m_forward->prepare();
+}
+
+// -----------------------------------------------------------------------------
+bool DeadlineDataProvider::canSaveToFile() const
+{
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+void DeadlineDataProvider::saveToFile(const StringVector &targets)
+{
+    throw KError("DeadlineDataProvider::saveToFile() not implemented.");
+}
+
+// -----------------------------------------------------------------------------
+size_t DeadlineDataProvider::getData(char *buffer, size_t maxread)
+{
+    return account(m_forward->getData(buffer, maxread));
+}
+
+// -----------------------------------------------------------------------------
+bool DeadlineDataProvider::canSplice() const
+{
+    return m_forward->canSplice();
+}
+
+// -----------------------------------------------------------------------------
+size_t DeadlineDataProvider::spliceData(int fd)
+{
+    return account(m_forward->spliceData(fd));
+}
+
+// -----------------------------------------------------------------------------
+bool DeadlineDataProvider::canMapData() const
+{
+    return m_forward->canMapData();
+}
+
+// -----------------------------------------------------------------------------
+size_t DeadlineDataProvider::mapData(const char **data, size_t maxread)
+{
+    return account(m_forward->mapData(data, maxread));
+}
+
+// -----------------------------------------------------------------------------
+bool DeadlineDataProvider::canPlaceData() const
+{
+    return m_forward->canPlaceData();
+}
+
+// -----------------------------------------------------------------------------
+size_t DeadlineDataProvider::getPlacedData(char *buffer, size_t maxread,
+                                           off_t *offset)
+{
+    return account(m_forward->getPlacedData(buffer, maxread, offset));
+}
+
+// -----------------------------------------------------------------------------
+size_t DeadlineDataProvider::getChunk(DataChunk &chunk, size_t maxread)
+{
+    return account(m_forward->getChunk(chunk, maxread));
+}
+
+// -----------------------------------------------------------------------------
+size_t DeadlineDataProvider::account(size_t bytes)
+{
+    Clock::time_point now = Clock::now();
+    if (!m_started) {
+        if (!bytes)
+            return bytes;
+        m_started = true;
+        m_start = m_checked = now;
+    }
+    m_bytes += bytes;
+
+    if (now - m_checked < std::chrono::seconds(1) ||
+        now - m_start < std::chrono::seconds(TIME_BUDGET_GRACE))
+        return bytes;
+    m_checked = now;
+
+    double elapsed = std::chrono::duration<double>(now - m_start).count();
+    unsigned long long rate = m_bytes / elapsed;
+    if (!rate)
+        rate = 1;
+    unsigned long long left = m_expected > m_bytes ? m_expected - m_bytes : 0;
+    Clock::time_point end = now + std::chrono::seconds(left / rate);
+    if (end > m_deadline) {
+        unsigned long late =
+            std::chrono::duration_cast<std::chrono::seconds>(
+                end - m_deadline).count();
+        throw KDeadlineError(m_bytes, rate, late);
+    }
+    return bytes;
+}
+
+// -----------------------------------------------------------------------------
+void DeadlineDataProvider::finish()
+{
+    m_forward->finish();
+}
+
+// -----------------------------------------------------------------------------
+void DeadlineDataProvider::setError(bool error)
+{
+    m_forward->setError(error);
+}
+
+// -----------------------------------------------------------------------------
+void DeadlineDataProvider::setProgress(Progress *progress)
+{
+    m_forward->setProgress(progress);
+}
+
+// -----------------------------------------------------------------------------
+bool DeadlineDataProvider::canRestart() const
+{
+    return m_forward->canRestart();
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
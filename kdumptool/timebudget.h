@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef TIMEBUDGET_H
+#define TIMEBUDGET_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "global.h"
+#include "dataprovider.h"
+#include "estimate.h"
+
+// bytes written to the target to measure its speed
+#define TIME_BUDGET_PROBE_SIZE  (32UL << 20)
+
+// name of the probe file in the dump directory
+#define TIME_BUDGET_PROBE_FILE  ".kdump-probe"
+
+// the first seconds of a dump are too noisy for a projection
+#define TIME_BUDGET_GRACE       20
+
+//{{{ KDeadlineError -----------------------------------------------------------
+
+/**
+ * Thrown when a DeadlineDataProvider has stopped a dump that would not
+ * be finished within the time budget.
+ */
+class KDeadlineError : public KError {
+    public:
+        /**
+         * @param[in] written bytes passed on before the dump was stopped
+         * @param[in] rate bytes per second so far
+         * @param[in] late seconds by which the budget would be exceeded
+         */
+        KDeadlineError(unsigned long long written, unsigned long long rate,
+                       unsigned long late);
+
+        /**
+         * Returns the bytes per second measured until the dump was
+         * stopped.
+         */
+        unsigned long long rate() const
+        { return m_rate; }
+
+    private:
+        unsigned long long m_rate;
+};
+
+//}}}
+//{{{ DumpPolicy ---------------------------------------------------------------
+
+/**
+ * Picks the dump level and format that fit into a time budget
+ * (KDUMP_TIME_BUDGET).
+ *
+ * The candidates start with the configured settings. Then more page
+ * types are excluded, in the order zero, free, cache and user pages,
+ * and for each dump level the faster compressed formats are tried, so
+ * that the dump keeps as much memory as possible. A dump takes as long
+ * as the slower of the processing (see DumpEstimator) and the target.
+ */
+class DumpPolicy {
+
+    public:
+        /**
+         * A dump level and format with its estimate.
+         */
+        struct Choice {
+            int dumplevel;
+            std::string format;
+            DumpEstimator::Result estimate;
+            unsigned long seconds;      // projected duration
+        };
+
+        /**
+         * @param[in] estimator the estimator for the dump
+         * @param[in] zstdLevel KDUMP_ELF_ZSTD_LEVEL
+         * @param[in] workers number of CPUs used for the dump
+         * @param[in] sparse @c true if zero blocks are written as holes
+         */
+        DumpPolicy(const DumpEstimator &estimator, int zstdLevel,
+                   unsigned long workers, bool sparse);
+
+        /**
+         * Lists the candidates, best dump first.
+         *
+         * @param[in] dumplevel the configured dump level
+         * @param[in] format the configured dump format
+         * @param[in] rate speed of the target in bytes per second, or
+         *            0 if it is not known
+         */
+        std::vector<Choice> candidates(int dumplevel,
+                                       const std::string &format,
+                                       unsigned long long rate) const;
+
+        /**
+         * Returns the index of the first candidate from @p first that
+         * takes at most @p seconds, or of the fastest one if none does.
+         */
+        static size_t choose(const std::vector<Choice> &candidates,
+                             unsigned long seconds, size_t first = 0);
+
+    private:
+        const DumpEstimator &m_estimator;
+        int m_zstdLevel;
+        unsigned long m_workers;
+        bool m_sparse;
+};
+
+//}}}
+//{{{ DeadlineDataProvider -----------------------------------------------------
+
+/**
+ * DataProvider that forwards everything to another DataProvider and
+ * stops the dump with a KDeadlineError as soon as it is clear that it
+ * cannot be finished in time. The projection assumes that the rest of
+ * the expected bytes is passed on at the rate so far, which is counted
+ * from the first byte, because makedumpfile analyses the memory before
+ * it writes anything. The data must pass through kdumptool for that,
+ * so saveToFile() is not available.
+ */
+class DeadlineDataProvider : public DataProvider {
+
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        /**
+         * Wraps a DataProvider.
+         *
+         * @param[in] forward the DataProvider that provides the data
+         * @param[in] deadline when the dump must be finished
+         * @param[in] expected the expected number of bytes
+         */
+        DeadlineDataProvider(DataProvider *forward,
+                             Clock::time_point deadline,
+                             unsigned long long expected)
+            : m_forward(forward), m_deadline(deadline),
+              m_expected(expected), m_bytes(0), m_started(false)
+        {}
+
+        void prepare();
+        bool canSaveToFile() const;
+        void saveToFile(const StringVector &targets);
+        size_t getData(char *buffer, size_t maxread);
+        bool canSplice() const;
+        size_t spliceData(int fd);
+        bool canMapData() const;
+        size_t mapData(const char **data, size_t maxread);
+        bool canPlaceData() const;
+        size_t getPlacedData(char *buffer, size_t maxread, off_t *offset);
+        size_t getChunk(DataChunk &chunk, size_t maxread);
+        void finish();
+        void setError(bool error);
+        void setProgress(Progress *progress);
+        bool canRestart() const;
+
+    protected:
+        /**
+         * Accounts @p bytes and checks the projection once a second.
+         *
+         * @exception KDeadlineError if the dump would be late
+         */
+        size_t account(size_t bytes);
+
+    private:
+        DataProvider *m_forward;
+        Clock::time_point m_deadline;
+        unsigned long long m_expected;
+        unsigned long long m_bytes;
+        bool m_started;
+        Clock::time_point m_start;      // first byte
+        Clock::time_point m_checked;    // last projection
+};
+
+//}}}
+
+#endif /* TIMEBUDGET_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -21,8 +21,11 @@
 #include <cstdarg>
 #include <cerrno>
 #include <algorithm>
+#include <memory>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <cstring>
 
 #include <curl/curl.h>
@@ -37,18 +40,32 @@
 #include "stringutil.h"
 #include "configuration.h"
 #include "routable.h"
+#include "asyncwriter.h"
+#include "stripewriter.h"
+#include "spaceguard.h"
+#include "writeback.h"
+#include "prealloc.h"
+#include "chunkwriter.h"
+#include "savestats.h"
+#include "pipeloop.h"
+#include "probes.h"
 
 using std::fopen;
 using std::fread;
 using std::fclose;
 using std::string;
-using std::copy;
-using std::strlen;
 using std::cerr;
 using std::endl;
 
 #define DEFAULT_MOUNTPOINT "/mnt"
 
+// size of the buffer for piped data
+#define PIPE_BUFFER_SIZE	(256*1024)
+
+// buffer size and number of buffers for the ASYNCIO write engine
+#define ASYNC_BUFFER_SIZE	(1024*1024)
+#define ASYNC_QUEUE_DEPTH	4
+
 //{{{ Transfer -----------------------------------------------------------------
 
 // -----------------------------------------------------------------------------
@@ -60,6 +77,26 @@ void Transfer::perform(DataProvider *dataprovider,
     perform(dataprovider, target_files, directSave);
 }
 
+// -----------------------------------------------------------------------------
+void Transfer::performStriped(DataProvider *dataprovider,
+                              const std::string &target_file,
+                              size_t chunkSize, unsigned streams)
+{
+    throw KError("Striping is not supported for this dump target.");
+}
+
+// -----------------------------------------------------------------------------
+void Transfer::performBatch(const ArtifactBatch &artifacts)
+{
+    ArtifactBatch::const_iterator it;
+    for (it = artifacts.begin(); it != artifacts.end(); ++it) {
+        BufferDataProvider provider(it->second.c_str(), it->second.size());
+        perform(&provider, it->first);
+    }
+}
+
+//}}}
+
 //{{{ URLTransfer --------------------------------------------------------------
 
 // -----------------------------------------------------------------------------
@@ -73,7 +110,8 @@ URLTransfer::URLTransfer(const RootDirURLVector &urlv)
 
 // -----------------------------------------------------------------------------
 FileTransfer::FileTransfer(const RootDirURLVector &urlv)
-    : URLTransfer(urlv), m_bufferSize(0), m_buffer(NULL)
+    : URLTransfer(urlv), m_reserve(0), m_expected(0), m_blockSize(0),
+      m_bufferSize(0), m_tuner("pipe")
 {
     RootDirURLVector::const_iterator it;
     for (it = urlv.begin(); it != urlv.end(); ++it)
@@ -86,26 +124,31 @@ FileTransfer::FileTransfer(const RootDirURLVector &urlv)
         dir.mkdir(true);
     }
 
-    // try to get the buffer size
+    // try to get the block size
     for (it = urlv.begin(); it != urlv.end(); ++it) {
 	struct stat mystat;
 	int err = stat(it->getRealPath().c_str(), &mystat);
-	if (err == 0 && (size_t)mystat.st_blksize > m_bufferSize)
-	    m_bufferSize = mystat.st_blksize;
+	if (err == 0 && (size_t)mystat.st_blksize > m_blockSize)
+	    m_blockSize = mystat.st_blksize;
     }
 
-    if (m_bufferSize == 0) {
-        Debug::debug()->dbg("Cannot determine block size. Using %d.", BUFSIZ);
-        m_bufferSize = BUFSIZ;
+    if (m_blockSize == 0) {
+        KDBG("Cannot determine block size. Using %d.", BUFSIZ);
+        m_blockSize = BUFSIZ;
     }
 
-    m_buffer = new char[m_bufferSize];
+    // chunks of the placed copy; holes are still made per block
+    m_bufferSize = PIPE_BUFFER_SIZE / m_blockSize * m_blockSize;
+    if (m_bufferSize == 0)
+        m_bufferSize = m_blockSize;
+
+    // the pipe copy tunes the size of its writes, in whole blocks
+    m_tuner = BufferTuner("pipe", m_blockSize);
 }
 
 // -----------------------------------------------------------------------------
 FileTransfer::~FileTransfer()
 {
-    delete[] m_buffer;
 }
 
 // -----------------------------------------------------------------------------
@@ -113,7 +156,7 @@ void FileTransfer::perform(DataProvider *dataprovider,
                            const StringVector &target_files,
                            bool *directSave)
 {
-    Debug::debug()->trace("FileTransfer::perform(%p, [ \"%s\"%s ])",
+    KTRACE("FileTransfer::perform(%p, [ \"%s\"%s ])",
 	dataprovider, target_files.front().c_str(),
 	target_files.size() > 1 ? ", ..." : "");
 
@@ -128,7 +171,13 @@ void FileTransfer::perform(DataProvider *dataprovider,
 	    itv = urlv.begin();
     }
 
-    if (dataprovider->canSaveToFile()) {
+    // a process that saves the file itself cannot be stopped in time,
+    // and its write-back cannot be controlled
+    bool writeback = Configuration::config()->kdumptoolContainsFlag(
+        Configuration::FLAG_WRITEBACK);
+    bool watch = (m_reserve || writeback) && full_targets.size() == 1 &&
+        dataprovider->canPlaceData();
+    if (dataprovider->canSaveToFile() && !watch) {
 	performFile(dataprovider, full_targets);
         if (directSave)
             *directSave = true;
@@ -143,67 +192,184 @@ void FileTransfer::perform(DataProvider *dataprovider,
 void FileTransfer::performFile(DataProvider *dataprovider,
 			       const StringVector &target_files)
 {
-    Debug::debug()->trace("FileTransfer::performFile(%p, [ \"%s\"%s ])",
+    KTRACE("FileTransfer::performFile(%p, [ \"%s\"%s ])",
 	dataprovider, target_files.front().c_str(),
 	target_files.size() > 1 ? ", ..." : "");
 
-    dataprovider->saveToFile(target_files);
+    // the DataProvider writes the files itself
+    TransferMeter meter("direct", target_files.front());
+    meter.source([&]() { dataprovider->saveToFile(target_files); });
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Window policy of FileTransfer::pipeLoop() without write-back control.
+ */
+struct NoWindow {
+    static void sync(FILE *fp, WritebackWindow *window, TransferMeter &meter)
+    { }
+};
+
+/**
+ * Window policy that hands the written data over to the write-back
+ * after each chunk.
+ */
+struct FlushWindow {
+    static void sync(FILE *fp, WritebackWindow *window, TransferMeter &meter)
+    {
+        // the kernel must see the data before its write-back
+        meter.sink([&]() {
+                if (fflush(fp) != 0)
+                    throw KSystemError("FileTransfer::perform: "
+                        "fflush() failed.", errno);
+                window->advance(ftello(fp));
+            });
+    }
+};
+
+typedef void (FileTransfer::*PipeLoop)(DataProvider *, FILE *, off_t *,
+                                       SpaceGuard *, WritebackWindow *,
+                                       TransferMeter &);
+
+// -----------------------------------------------------------------------------
+template<typename Read, typename Holes, typename Window>
+void FileTransfer::pipeLoop(DataProvider *dataprovider, FILE *fp,
+                            off_t *hole, SpaceGuard *guard,
+                            WritebackWindow *window, TransferMeter &meter)
+{
+    off_t offset = 0;
+    while (true) {
+        size_t size = m_tuner.size();
+        if (!Read::mapped && m_buffer.size() < size) {
+            m_buffer.reset();
+            m_buffer = BufferPool::pool()->get(size);
+        }
+
+        const char *data;
+        size_t read_data = meter.source([&]() {
+                return Read::read(dataprovider, m_buffer.get(), size, data,
+                                  offset);
+            });
+
+        // finished?
+        if (read_data == 0)
+            break;
+        meter.moved(read_data);
+        BufferTuner::Clock::time_point written = BufferTuner::Clock::now();
+
+        // sparse files: skip all zero blocks, write the rest
+        splitRuns<Holes>(data, read_data, m_blockSize,
+            [&](const char *run, size_t len, size_t) {
+                meter.sink([&]() {
+                        writeData(fp, run, len, hole, guard);
+                    });
+            },
+            [&](size_t len) {
+                *hole += len;
+                meter.sparse(len);
+                KDUMP_PROBE1(file_skip, len);
+            });
+
+        Window::sync(fp, window, meter);
+        m_tuner.account(read_data, BufferTuner::Clock::now() - written);
+    }
 }
 
 // -----------------------------------------------------------------------------
 void FileTransfer::performPipe(DataProvider *dataprovider,
 			       const StringVector &target_files)
 {
-    Debug::debug()->trace("FileTransfer::performPipe(%p, [ \"%s\"%s ])",
+    KTRACE("FileTransfer::performPipe(%p, [ \"%s\"%s ])",
         dataprovider, target_files.front().c_str(),
 	target_files.size() > 1 ? ", ..." : "");
 
     if (target_files.size() > 1)
 	cerr << "WARNING: First dump target used; rest ignored." << endl;
 
-    FILE *fp = open(target_files.front().c_str());
-    bool sparse = !Configuration::config()->kdumptoolContainsFlag("NOSPARSE");
+    bool sparse = !Configuration::config()->kdumptoolContainsFlag(
+        Configuration::FLAG_NOSPARSE);
     if (!sparse)
-        Debug::debug()->info("Creation of sparse files disabled in "
+        KINFO("Creation of sparse files disabled in "
             "configuration.");
 
+    if (dataprovider->canPlaceData()) {
+        performPlaced(dataprovider, target_files.front(), sparse);
+        return;
+    }
+
+    if (Configuration::config()->kdumptoolContainsFlag(
+            Configuration::FLAG_ASYNCIO)) {
+        performPipeAsync(dataprovider, target_files.front(), sparse);
+        return;
+    }
+
+    FILE *fp = open(target_files.front().c_str());
+    std::unique_ptr<Preallocation> prealloc(preallocation(fileno(fp)));
+    std::unique_ptr<SpaceGuard> guard(spaceGuard(target_files.front()));
+    std::unique_ptr<WritebackWindow> window(writebackWindow(fileno(fp)));
+    TransferMeter meter("pipe", target_files.front());
     bool prepared = false;
 
-    bool last_was_sparse = false;
+    off_t hole = 0;
     try {
         dataprovider->prepare();
         prepared = true;
 
-        while (true) {
-            size_t read_data = dataprovider->getData(m_buffer, m_bufferSize);
-
-            // finished?
-            if (read_data == 0)
-                break;
-
-            // sparse files
-            if (sparse && read_data == m_bufferSize &&
-                    Util::isZero(m_buffer, m_bufferSize)) {
-                int ret = fseek(fp, m_bufferSize, SEEK_CUR);
-                if (ret != 0)
-                    throw KSystemError("FileTransfer::perform: fseek() failed.",
-                        errno);
-                last_was_sparse = true;
-            } else {
-                size_t ret = fwrite(m_buffer, 1, read_data, fp);
-                if (ret != read_data)
-                    throw KSystemError("FileTransfer::perform: fwrite() failed"
-                        " with " + StringUtil::number2string(ret) +  ".", errno);
-                last_was_sparse = false;
+        // without sparse files, there is no need to look at the data;
+        // splice() cannot be stopped at a given size
+        bool splice = !sparse && !guard && dataprovider->canSplice();
+        if (splice) {
+            KDBG("Moving the data with splice()");
+            size_t moved;
+            while ((moved = meter.source([&]() {
+                        return dataprovider->spliceData(fileno(fp));
+                    })) != 0) {
+                meter.moved(moved);
+                if (window)
+                    meter.sink([&]() {
+                            window->advance(lseek(fileno(fp), 0, SEEK_CUR));
+                        });
             }
         }
 
-        if (last_was_sparse) {
+        // the loop for these options is picked once; mapped data can be
+        // written without copying it to m_buffer
+        if (!splice) {
+            bool map = dataprovider->canMapData();
+            static const PipeLoop loops[2][2][2] = {
+                {
+                    { &FileTransfer::pipeLoop<CopyRead, KeepZeros, NoWindow>,
+                      &FileTransfer::pipeLoop<CopyRead, KeepZeros,
+                                              FlushWindow> },
+                    { &FileTransfer::pipeLoop<CopyRead, SkipZeros, NoWindow>,
+                      &FileTransfer::pipeLoop<CopyRead, SkipZeros,
+                                              FlushWindow> },
+                },
+                {
+                    { &FileTransfer::pipeLoop<MapRead, KeepZeros, NoWindow>,
+                      &FileTransfer::pipeLoop<MapRead, KeepZeros,
+                                              FlushWindow> },
+                    { &FileTransfer::pipeLoop<MapRead, SkipZeros, NoWindow>,
+                      &FileTransfer::pipeLoop<MapRead, SkipZeros,
+                                              FlushWindow> },
+                },
+            };
+            PipeLoop loop = loops[map][sparse][window != NULL];
+            (this->*loop)(dataprovider, fp, &hole, guard.get(), window.get(),
+                          meter);
+            meter.bufferSize(m_tuner.size());
+        }
+
+        if (hole) {
+            int ret = fseek(fp, hole, SEEK_CUR);
+            if (ret != 0)
+                throw KSystemError("FileTransfer::perform: fseek() failed.",
+                    errno);
 
             loff_t old_offset = ftell(fp);
 
             // write something
-            int ret = fputc('\0', fp);
+            ret = fputc('\0', fp);
             if (ret == EOF)
                 throw KSystemError("Unable to write.", errno);
 
@@ -214,20 +380,370 @@ void FileTransfer::performPipe(DataProvider *dataprovider,
                 throw KSystemError("Unable to set the file position.", errno);
         }
     } catch (...) {
+        if (prealloc && fflush(fp) == 0)
+            prealloc->trim();
         close(fp);
-        if (prepared)
+        if (prepared) {
+            dataprovider->setError(true);
             dataprovider->finish();
+        }
         throw;
     }
 
+    if (prealloc) {
+        if (fflush(fp) != 0)
+            throw KSystemError("FileTransfer::perform: fflush() failed.",
+                errno);
+        meter.sink([&]() { prealloc->trim(); });
+    }
     close(fp);
     dataprovider->finish();
 }
 
+// -----------------------------------------------------------------------------
+void FileTransfer::writeData(FILE *fp, const char *data, size_t len,
+                             off_t *hole, SpaceGuard *guard)
+{
+    if (!len)
+        return;
+
+    // write what fits, so that the file ends where it was stopped
+    size_t allowed = guard ? guard->allow(len) : len;
+    if (allowed < len) {
+        writeData(fp, data, allowed, hole, NULL);
+        guard->check();
+    }
+
+    if (*hole) {
+        int ret = fseek(fp, *hole, SEEK_CUR);
+        if (ret != 0)
+            throw KSystemError("FileTransfer::perform: fseek() failed.",
+                errno);
+        *hole = 0;
+    }
+
+    KDUMP_PROBE1(file_write, len);
+    size_t ret = fwrite(data, 1, len, fp);
+    if (ret != len)
+        throw KSystemError("FileTransfer::perform: fwrite() failed"
+            " with " + StringUtil::number2string(ret) +  ".", errno);
+}
+
+// -----------------------------------------------------------------------------
+void FileTransfer::performPlaced(DataProvider *dataprovider,
+                                 const string &target_file,
+                                 bool sparse)
+{
+    KTRACE("FileTransfer::performPlaced(%p, %s, %d)",
+        dataprovider, target_file.c_str(), sparse);
+
+    int fd = ::open(target_file.c_str(),
+                    O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0)
+        throw KSystemError("Error in open for " + target_file, errno);
+
+    std::unique_ptr<Preallocation> prealloc(preallocation(fd));
+    std::unique_ptr<SpaceGuard> guard(spaceGuard(target_file));
+    std::unique_ptr<WritebackWindow> window(writebackWindow(fd));
+    TransferMeter meter("placed", target_file);
+    bool prepared = false;
+    try {
+        dataprovider->prepare();
+        prepared = true;
+
+        // the next chunk is read while the previous ones are written
+        ChunkWriter writer(fd, ASYNC_QUEUE_DEPTH, sparse ? m_blockSize : 0,
+                           guard.get(), window.get());
+        DataChunk chunk;
+        size_t read_data;
+        while ((read_data = meter.source([&]() {
+                        return dataprovider->getChunk(chunk, m_bufferSize);
+                    })) != 0) {
+            meter.moved(read_data);
+            meter.sink([&]() { writer.write(std::move(chunk)); });
+        }
+        meter.sink([&]() { writer.drain(); });
+        meter.sparse(writer.sparse());
+        off_t end = writer.end();
+
+        // the file size is not extended by skipped blocks at the end
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+            throw KSystemError("Cannot stat " + target_file, errno);
+        if (st.st_size < end && ftruncate(fd, end) != 0)
+            throw KSystemError("Unable to set the file size.", errno);
+        if (prealloc)
+            meter.sink([&]() { prealloc->trim(); });
+    } catch (...) {
+        if (prealloc)
+            prealloc->trim();
+        ::close(fd);
+        if (prepared) {
+            dataprovider->setError(true);
+            dataprovider->finish();
+        }
+        throw;
+    }
+
+    if (::close(fd) != 0)
+        throw KSystemError("Error in close for " + target_file, errno);
+    dataprovider->finish();
+}
+
+// -----------------------------------------------------------------------------
+void FileTransfer::performPipeAsync(DataProvider *dataprovider,
+                                    const string &target_file,
+                                    bool sparse)
+{
+    KTRACE("FileTransfer::performPipeAsync(%p, %s, %d)",
+        dataprovider, target_file.c_str(), sparse);
+
+    // holes are created in units of the file system block size, but
+    // they must not break the alignment needed for O_DIRECT
+    const size_t align = AsyncWriter::alignment();
+    const size_t block = (m_blockSize + align - 1) / align * align;
+    size_t bufsize = ASYNC_BUFFER_SIZE / block * block;
+    if (bufsize == 0)
+        bufsize = block;
+
+    bool direct = true;
+    int fd = ::open(target_file.c_str(),
+                    O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0666);
+    if (fd < 0 && errno == EINVAL) {
+        KDBG("O_DIRECT not supported for %s",
+            target_file.c_str());
+        direct = false;
+        fd = ::open(target_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    }
+    if (fd < 0)
+        throw KSystemError("Error in open for " + target_file, errno);
+
+    std::unique_ptr<Preallocation> prealloc(preallocation(fd));
+    std::unique_ptr<SpaceGuard> guard(spaceGuard(target_file));
+    TransferMeter meter("async", target_file);
+    bool prepared = false;
+    try {
+        std::unique_ptr<AsyncWriter> writer(
+            AsyncWriter::create(fd, bufsize, ASYNC_QUEUE_DEPTH));
+        KDBG("Writing %s with %s (%s)",
+            target_file.c_str(), writer->engineName(),
+            direct ? "O_DIRECT" : "buffered");
+
+        dataprovider->prepare();
+        prepared = true;
+
+        // the space guard is checked with no write in flight
+        auto queue = [&](const char *data, size_t len, off_t pos) {
+            meter.sink([&]() {
+                    if (guard && guard->allow(len) < len) {
+                        writer->drain();
+                        guard->check();
+                    }
+                    KDUMP_PROBE1(file_write, len);
+                    writer->write(data, len, pos);
+                });
+        };
+
+        off_t offset = 0;
+        bool last_was_sparse = false;
+        while (true) {
+            char *buf = meter.sink([&]() { return writer->getBuffer(); });
+            size_t read_data = 0;
+            while (read_data < bufsize) {
+                size_t ret = meter.source([&]() {
+                        return dataprovider->getData(buf + read_data,
+                                                     bufsize - read_data);
+                    });
+                if (ret == 0)
+                    break;
+                read_data += ret;
+            }
+
+            // finished?
+            if (read_data == 0)
+                break;
+            meter.moved(read_data);
+
+            // an unaligned length is only possible at the end of the data
+            if (direct && read_data % align) {
+                writer->drain();
+                int flags = fcntl(fd, F_GETFL);
+                if (flags < 0 || fcntl(fd, F_SETFL, flags & ~O_DIRECT) < 0)
+                    throw KSystemError("Cannot clear O_DIRECT", errno);
+                direct = false;
+            }
+
+            // queue the non-zero runs, skip zero blocks
+            auto write = [&](const char *run, size_t len, size_t pos) {
+                queue(run, len, offset + pos);
+                last_was_sparse = false;
+            };
+            auto skip = [&](size_t len) {
+                meter.sparse(len);
+                KDUMP_PROBE1(file_skip, len);
+                last_was_sparse = true;
+            };
+            if (sparse)
+                splitRuns<SkipZeros>(buf, read_data, block, write, skip);
+            else
+                splitRuns<KeepZeros>(buf, read_data, block, write, skip);
+
+            offset += read_data;
+        }
+
+        meter.sink([&]() { writer->drain(); });
+
+        // the file size is not extended by skipped blocks at the end
+        if (last_was_sparse && ftruncate(fd, offset) != 0)
+            throw KSystemError("Unable to set the file size.", errno);
+        if (prealloc)
+            meter.sink([&]() { prealloc->trim(); });
+    } catch (...) {
+        if (prealloc)
+            prealloc->trim();
+        ::close(fd);
+        if (prepared) {
+            dataprovider->setError(true);
+            dataprovider->finish();
+        }
+        throw;
+    }
+
+    if (::close(fd) != 0)
+        throw KSystemError("Error in close for " + target_file, errno);
+    dataprovider->finish();
+}
+
+// -----------------------------------------------------------------------------
+bool FileTransfer::canStripe()
+{
+    return getURLVector().size() > 1;
+}
+
+// -----------------------------------------------------------------------------
+string FileTransfer::localDirectory()
+{
+    return getURLVector().front().getRealPath();
+}
+
+// -----------------------------------------------------------------------------
+void FileTransfer::performStriped(DataProvider *dataprovider,
+                                  const string &target_file,
+                                  size_t chunkSize, unsigned streams)
+{
+    KTRACE("FileTransfer::performStriped(%p, %s, %lu, %u)",
+        dataprovider, target_file.c_str(), (unsigned long)chunkSize, streams);
+
+    bool sparse = !Configuration::config()->kdumptoolContainsFlag(
+        Configuration::FLAG_NOSPARSE);
+
+    // chunks must not break the block size used for holes
+    chunkSize = chunkSize / m_blockSize * m_blockSize;
+    if (chunkSize == 0)
+        chunkSize = m_blockSize;
+
+    RootDirURLVector &urlv = getURLVector();
+    StripeWriter::Vector writers;
+    StringVector stripes;
+    unsigned long long total = 0;
+    TransferMeter meter("stripe", target_file);
+    bool prepared = false;
+    try {
+        unsigned n = 0;
+        RootDirURLVector::const_iterator it;
+        for (it = urlv.begin(); it != urlv.end(); ++it, ++n) {
+            string name = target_file + ".stripe" +
+                StringUtil::number2string(n);
+            FilePath path = it->getRealPath();
+            path.appendPath(name);
+            int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+            if (fd < 0)
+                throw KSystemError("Error in open for " + path, errno);
+            writers.emplace_back(new StripeWriter(fd, path, chunkSize,
+                                                  sparse ? m_blockSize : 0,
+                                                  spaceGuard(path)));
+
+            FilePath origpath = it->getPath();
+            stripes.push_back(origpath.appendPath(name));
+        }
+        KDBG("Striping %s over %u targets in %lu byte chunks",
+            target_file.c_str(), n, (unsigned long)chunkSize);
+
+        dataprovider->prepare();
+        prepared = true;
+
+        total = StripeWriter::distribute(dataprovider, writers, chunkSize,
+                                         meter);
+        for (n = 0; n < writers.size(); ++n)
+            meter.sink([&]() { writers[n]->finish(); });
+    } catch (...) {
+        writers.clear();
+        if (prepared) {
+            dataprovider->setError(true);
+            dataprovider->finish();
+        }
+        throw;
+    }
+
+    dataprovider->finish();
+
+    // the map goes to the first directory
+    const string map = StripeWriter::map(chunkSize, total, stripes);
+    BufferDataProvider mapProvider(map.c_str(), map.size());
+    Transfer::perform(&mapProvider, target_file + ".stripes");
+}
+
+// -----------------------------------------------------------------------------
+void FileTransfer::performBatch(const ArtifactBatch &artifacts)
+{
+    KTRACE("FileTransfer::performBatch([%lu files])",
+        (unsigned long)artifacts.size());
+
+    if (artifacts.empty())
+        return;
+
+    FilePath dir = getURLVector().front().getRealPath();
+    std::unique_ptr<SpaceGuard> guard(spaceGuard(dir));
+    TransferMeter meter("batch", dir);
+
+    ArtifactBatch::const_iterator it;
+    for (it = artifacts.begin(); it != artifacts.end(); ++it) {
+        FilePath path = dir;
+        path.appendPath(it->first);
+        const char *data = it->second.data();
+        size_t len = it->second.size();
+
+        // all or nothing, a truncated script is of no use
+        if (guard.get() && guard->allow(len) < len)
+            guard->check();
+
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0)
+            throw KSystemError("Error in open for " + path, errno);
+        while (len > 0) {
+            ssize_t ret = meter.sink([&]() {
+                    return ::write(fd, data, len);
+                });
+            if (ret < 0) {
+                int err = errno;
+                if (err == EINTR)
+                    continue;
+                ::close(fd);
+                throw KSystemError("Error in write for " + path, err);
+            }
+            meter.moved(ret);
+            data += ret;
+            len -= ret;
+        }
+        if (::close(fd) != 0)
+            throw KSystemError("Error in close for " + path, errno);
+    }
+}
+
 // -----------------------------------------------------------------------------
 FILE *FileTransfer::open(const string &target_file)
 {
-    Debug::debug()->trace("FileTransfer::open(%s)", target_file.c_str());
+    KTRACE("FileTransfer::open(%s)", target_file.c_str());
 
     FILE *fp = fopen(target_file.c_str(), "w");
     if (!fp)
@@ -239,22 +755,123 @@ FILE *FileTransfer::open(const string &target_file)
 // -----------------------------------------------------------------------------
 void FileTransfer::close(FILE *fp)
 {
-    Debug::debug()->trace("FileTransfer::close()");
+    KTRACE("FileTransfer::close()");
+    KEVENT("close fd %llu, offset %llu", fileno(fp), ftello(fp));
 
     fclose(fp);
 }
 
+// -----------------------------------------------------------------------------
+SpaceGuard *FileTransfer::spaceGuard(const string &target_file) const
+{
+    if (!m_reserve)
+        return NULL;
+    return new SpaceGuard(target_file, m_reserve);
+}
+
+// -----------------------------------------------------------------------------
+WritebackWindow *FileTransfer::writebackWindow(int fd) const
+{
+    if (!Configuration::config()->kdumptoolContainsFlag(
+            Configuration::FLAG_WRITEBACK))
+        return NULL;
+    KDBG("Writing back in %d byte windows", WRITEBACK_WINDOW);
+    return new WritebackWindow(fd);
+}
+
+// -----------------------------------------------------------------------------
+Preallocation *FileTransfer::preallocation(int fd) const
+{
+    if (!m_expected)
+        return NULL;
+    return new Preallocation(fd, m_expected, m_reserve);
+}
+
 //}}}
 //{{{ FTPTransfer --------------------------------------------------------------
 
 bool FTPTransfer::curl_global_inititalised = false;
 
+/**
+ * Source of FTPTransfer::perform().
+ */
+struct FTPReader {
+    DataProvider *dataprovider;
+    TransferMeter *meter;
+    RewindDataProvider *rewind;     // NULL if the upload cannot resume
+};
+
 // -----------------------------------------------------------------------------
-static size_t curl_readfunction(void *buffer, size_t size, size_t nmemb,
+static size_t curl_readfunction(char *buffer, size_t size, size_t nmemb,
                                 void *data)
 {
-    DataProvider *dataprovider = reinterpret_cast<DataProvider *>(data);
-    return dataprovider->getData((char *)buffer, size * nmemb);
+    FTPReader *reader = reinterpret_cast<FTPReader *>(data);
+    size_t ret = reader->meter->source([&]() {
+            return reader->dataprovider->getData(buffer, size * nmemb);
+        });
+    reader->meter->moved(ret);
+    KDUMP_PROBE2(curl_read, size * nmemb, ret);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+static int curl_seekfunction(void *data, curl_off_t offset, int origin)
+{
+    FTPReader *reader = reinterpret_cast<FTPReader *>(data);
+    if (!reader->rewind || origin != SEEK_SET || offset < 0 ||
+        !reader->rewind->rewind(offset))
+        return CURL_SEEKFUNC_FAIL;
+    return CURL_SEEKFUNC_OK;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Checks whether an FTP upload failed because of the network.
+ */
+static bool curl_transient(CURLcode result)
+{
+    switch (result) {
+        case CURLE_COULDNT_CONNECT:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_OPERATION_TIMEDOUT:
+        case CURLE_PARTIAL_FILE:
+        case CURLE_GOT_NOTHING:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Source of one upload of FTPTransfer::performBatch().
+ */
+struct FTPArtifact {
+    const std::string *data;
+    size_t pos;
+    TransferMeter *meter;
+};
+
+// -----------------------------------------------------------------------------
+static size_t curl_readartifact(char *buffer, size_t size, size_t nmemb,
+                                void *data)
+{
+    FTPArtifact *artifact = reinterpret_cast<FTPArtifact *>(data);
+    size_t ret = std::min(size * nmemb,
+                          artifact->data->size() - artifact->pos);
+    memcpy(buffer, artifact->data->data() + artifact->pos, ret);
+    artifact->pos += ret;
+    artifact->meter->moved(ret);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+int curl_sockopt(void *clientp, curl_socket_t fd, curlsocktype purpose)
+{
+    if (purpose == CURLSOCKTYPE_IPCXN)
+        static_cast<const NetTuning *>(clientp)->apply(fd);
+    return CURL_SOCKOPT_OK;
 }
 
 // -----------------------------------------------------------------------------
@@ -264,101 +881,147 @@ static int curl_debug(CURL *curl, curl_infotype info, char *buffer,
     (void)curl;
     (void)data;
 
-    if (!Debug::debug()->isDebugEnabled())
-        return 0;
-
-    char *printbuffer = new char[bufsiz+1];
-    copy(buffer, buffer+bufsiz, printbuffer);
-    printbuffer[bufsiz] = 0;
-
-    while (printbuffer[strlen(printbuffer)-1] == '\n')
-        printbuffer[strlen(printbuffer)-1] = 0;
-
+    Debug::Level level;
+    const char *prefix;
     switch (info) {
         case CURLINFO_TEXT:
-            Debug::debug()->dbg("CURL: %s", printbuffer);
+            level = Debug::DL_DEBUG;
+            prefix = "";
             break;
 
         case CURLINFO_HEADER_IN:
-            Debug::debug()->trace("CURL: <- %s", printbuffer);
+            level = Debug::DL_TRACE;
+            prefix = "<- ";
             break;
 
         case CURLINFO_HEADER_OUT:
-            Debug::debug()->trace("CURL: %s", printbuffer);
+            level = Debug::DL_TRACE;
+            prefix = "";
             break;
 
         default:
-            break;
+            return 0;
     }
 
-    delete[] printbuffer;
+    // check the level before doing any work, this is called very often
+    if (level < KDUMP_MODULE_LOG_LEVEL || !Debug::debug()->enabled(level))
+        return 0;
+
+    // the buffer is not NUL-terminated, print it without a copy
+    while (bufsiz > 0 && buffer[bufsiz-1] == '\n')
+        --bufsiz;
+    Debug::debug()->msg(level, "CURL: %s%.*s", prefix, int(bufsiz), buffer);
 
     return 0;
 }
 
 // -----------------------------------------------------------------------------
 FTPTransfer::FTPTransfer(const RootDirURLVector &urlv)
-    : URLTransfer(urlv), m_curl(NULL)
+    : URLTransfer(urlv), m_multi(NULL)
 {
     if (urlv.size() > 1)
 	cerr << "WARNING: First dump target used; rest ignored." << endl;
     const RootDirURL &parser = urlv.front();
 
-    Debug::debug()->trace("FTPTransfer::FTPTransfer(%s)",
-			  parser.getURL().c_str());
+    KTRACE("FTPTransfer::FTPTransfer(%s)",
+	   parser.getURL().c_str());
+
+    m_upload.curl = NULL;
+    m_tuning = NetTuning::forHost(parser.getHostname());
 
     // init the CURL library
     if (!curl_global_inititalised) {
-        Debug::debug()->dbg("Calling curl_global_init()");
+        KDBG("Calling curl_global_init()");
         CURLcode err = curl_global_init(CURL_GLOBAL_ALL);
         if (err != 0)
             throw KError("curl_global_init() failed.");
         curl_global_inititalised = true;
     }
 
-    m_curl = curl_easy_init();
-    if (!m_curl)
-        throw KError("FTPTransfer::open(): curl_easy_init returned NULL");
-
-    // error buffer
-    CURLcode err = curl_easy_setopt(m_curl, CURLOPT_ERRORBUFFER, m_curlError);
-    if (err != CURLE_OK)
-        throw KError("CURLOPT_ERRORBUFFER failed");
-
-    // TODO: add configuration option
-    err = curl_easy_setopt(m_curl, CURLOPT_DEBUGFUNCTION, curl_debug);
-    if (err != CURLE_OK)
-        throw KError(string("CURL error: ") + m_curlError);
-
-    err = curl_easy_setopt(m_curl, CURLOPT_DEBUGDATA, NULL);
-    if (err != CURLE_OK)
-        throw KError(string("CURL error: ") + m_curlError);
-
-    err = curl_easy_setopt(m_curl, CURLOPT_VERBOSE, 1);
-    if (err != CURLE_OK)
-        throw KError(string("CURL error: ") + m_curlError);
+    // all uploads share the connection cache of the multi handle
+    m_multi = curl_multi_init();
+    if (!m_multi)
+        throw KError("FTPTransfer::open(): curl_multi_init returned NULL");
 
-    // create directory
-    err = curl_easy_setopt(m_curl, CURLOPT_FTP_CREATE_MISSING_DIRS, 1);
-    if (err != CURLE_OK)
-        throw KError(string("CURL error: " ) + m_curlError);
-
-    // read function
-    err = curl_easy_setopt(m_curl, CURLOPT_READFUNCTION, curl_readfunction);
-    if (err != CURLE_OK)
-        throw KError(string("CURL error: ") + m_curlError);
-
-    // set upload
-    err = curl_easy_setopt(m_curl, CURLOPT_UPLOAD, 1);
-    if (err != CURLE_OK)
-        throw KError(string("CURL error: ") + m_curlError);
+    try {
+        newHandle(m_upload);
+    } catch (...) {
+        curl_multi_cleanup(m_multi);
+        throw;
+    }
 }
 
 // -----------------------------------------------------------------------------
 FTPTransfer::~FTPTransfer()
 {
-    if (m_curl)
-        curl_easy_cleanup(m_curl);
+    if (m_upload.curl)
+        curl_easy_cleanup(m_upload.curl);
+    if (m_multi)
+        curl_multi_cleanup(m_multi);
+}
+
+// -----------------------------------------------------------------------------
+CURL *FTPTransfer::newHandle(Upload &upload)
+{
+    upload.error[0] = 0;
+    upload.result = CURLE_OK;
+    upload.curl = curl_easy_init();
+    if (!upload.curl)
+        throw KError("FTPTransfer::open(): curl_easy_init returned NULL");
+
+    try {
+        // error buffer
+        CURLcode err = curl_easy_setopt(upload.curl, CURLOPT_ERRORBUFFER,
+                                        upload.error);
+        if (err != CURLE_OK)
+            throw KError("CURLOPT_ERRORBUFFER failed");
+
+        // find the Upload in runMulti()
+        err = curl_easy_setopt(upload.curl, CURLOPT_PRIVATE, &upload);
+        if (err != CURLE_OK)
+            throw KError(string("CURL error: ") + upload.error);
+
+        // TODO: add configuration option
+        err = curl_easy_setopt(upload.curl, CURLOPT_DEBUGFUNCTION, curl_debug);
+        if (err != CURLE_OK)
+            throw KError(string("CURL error: ") + upload.error);
+
+        err = curl_easy_setopt(upload.curl, CURLOPT_DEBUGDATA, NULL);
+        if (err != CURLE_OK)
+            throw KError(string("CURL error: ") + upload.error);
+
+        // without a log, libcurl need not even format the messages
+        long verbose = Debug::debug()->enabled(Debug::DL_DEBUG) ? 1 : 0;
+        err = curl_easy_setopt(upload.curl, CURLOPT_VERBOSE, verbose);
+        if (err != CURLE_OK)
+            throw KError(string("CURL error: ") + upload.error);
+
+        // socket options of KDUMP_NET_TUNING
+        err = curl_easy_setopt(upload.curl, CURLOPT_SOCKOPTFUNCTION,
+                               curl_sockopt);
+        if (err != CURLE_OK)
+            throw KError(string("CURL error: ") + upload.error);
+
+        err = curl_easy_setopt(upload.curl, CURLOPT_SOCKOPTDATA, &m_tuning);
+        if (err != CURLE_OK)
+            throw KError(string("CURL error: ") + upload.error);
+
+        // create directory
+        err = curl_easy_setopt(upload.curl, CURLOPT_FTP_CREATE_MISSING_DIRS, 1);
+        if (err != CURLE_OK)
+            throw KError(string("CURL error: " ) + upload.error);
+
+        // set upload
+        err = curl_easy_setopt(upload.curl, CURLOPT_UPLOAD, 1);
+        if (err != CURLE_OK)
+            throw KError(string("CURL error: ") + upload.error);
+    } catch (...) {
+        curl_easy_cleanup(upload.curl);
+        upload.curl = NULL;
+        throw;
+    }
+
+    return upload.curl;
 }
 
 // -----------------------------------------------------------------------------
@@ -366,23 +1029,85 @@ void FTPTransfer::perform(DataProvider *dataprovider,
                           const StringVector &target_files,
                           bool *directSave)
 {
-    Debug::debug()->trace("FTPTransfer::perform(%p, [ \"%s\"%s ])",
+    KTRACE("FTPTransfer::perform(%p, [ \"%s\"%s ])",
 	dataprovider, target_files.front().c_str(),
 	target_files.size() > 1 ? ", ..." : "");
 
     if (directSave)
         *directSave = false;
-    open(dataprovider, target_files.front().c_str());
 
+    // keep the end of the data to resume after a network failure
+    int retries = Configuration::config()->KDUMP_TRANSFER_RETRIES.value();
+    std::unique_ptr<RewindDataProvider> rewind;
+    if (retries > 0) {
+        rewind.reset(new RewindDataProvider(dataprovider, FTP_REWIND_SIZE));
+        dataprovider = rewind.get();
+    }
+
+    // libcurl calls back for the data, so the rest is network time
+    TransferMeter meter("ftp", target_files.front());
+    meter.sinkIsRemainder();
+    FTPReader reader = { dataprovider, &meter, rewind.get() };
+    open(m_upload, target_files.front(), curl_readfunction, &reader);
+
+    CURLcode err = curl_easy_setopt(m_upload.curl, CURLOPT_SEEKFUNCTION,
+                                    curl_seekfunction);
+    if (err != CURLE_OK)
+        throw KError(string("CURL error: ") + m_upload.error);
+    err = curl_easy_setopt(m_upload.curl, CURLOPT_SEEKDATA, &reader);
+    if (err != CURLE_OK)
+        throw KError(string("CURL error: ") + m_upload.error);
+
+    bool added = false;
     try {
         dataprovider->prepare();
 
-        CURLcode err = curl_easy_perform(m_curl);
-        if (err != 0)
-            throw KError(string("CURL error: ") + m_curlError);
+        curl_off_t resume = 0;
+        while (true) {
+            // -1 lets libcurl ask for the size and append (APPE)
+            err = curl_easy_setopt(m_upload.curl, CURLOPT_RESUME_FROM_LARGE,
+                                   resume);
+            if (err != CURLE_OK)
+                throw KError(string("CURL error: ") + m_upload.error);
+
+            CURLMcode merr = curl_multi_add_handle(m_multi, m_upload.curl);
+            if (merr != CURLM_OK)
+                throw KError(string("CURL error: ") +
+                             curl_multi_strerror(merr));
+            added = true;
+
+            try {
+                m_upload.result = CURLE_OK;
+                runMulti(NULL, NULL);
+            } catch (const KError &e) {
+                if (retries <= 0 || !curl_transient(m_upload.result))
+                    throw;
+                --retries;
+                cerr << "WARNING: " << e.what() << ", resuming ("
+                     << retries << " retries left)" << endl;
+
+                curl_multi_remove_handle(m_multi, m_upload.curl);
+                added = false;
+                Routable rt(getURLVector().front().getHostname());
+                if (!rt.check(Configuration::config()->
+                              KDUMP_NET_TIMEOUT.value()))
+                    cerr << "WARNING: Dump target not reachable" << endl;
+                resume = -1;
+                continue;
+            }
+            break;
+        }
 
+        curl_multi_remove_handle(m_multi, m_upload.curl);
+        added = false;
+        curl_easy_setopt(m_upload.curl, CURLOPT_RESUME_FROM_LARGE,
+                         (curl_off_t)0);
         dataprovider->finish();
     } catch (...) {
+        if (added)
+            curl_multi_remove_handle(m_multi, m_upload.curl);
+        curl_easy_setopt(m_upload.curl, CURLOPT_RESUME_FROM_LARGE,
+                         (curl_off_t)0);
         dataprovider->setError(true);
         dataprovider->finish();
         throw;
@@ -390,12 +1115,12 @@ void FTPTransfer::perform(DataProvider *dataprovider,
 }
 
 // -----------------------------------------------------------------------------
-void FTPTransfer::open(DataProvider *dataprovider,
-                        const string &target_file)
+void FTPTransfer::open(Upload &upload, const string &target_file,
+                       curl_read_callback readfunc, void *readdata)
 {
     CURLcode err;
 
-    Debug::debug()->trace("FTPTransfer::open(%p, %s)", dataprovider,
+    KTRACE("FTPTransfer::open(%p, %s)", readdata,
         target_file.c_str());
 
     RootDirURLVector &urlv = getURLVector();
@@ -410,14 +1135,300 @@ void FTPTransfer::open(DataProvider *dataprovider,
     // set the URL
     FilePath full_url = parser.getURL();
     full_url.appendPath(target_file);
-    err = curl_easy_setopt(m_curl, CURLOPT_URL, full_url.c_str());
+    err = curl_easy_setopt(upload.curl, CURLOPT_URL, full_url.c_str());
+    if (err != CURLE_OK)
+        throw KError(string("CURL error: ") + upload.error);
+
+    // read function
+    err = curl_easy_setopt(upload.curl, CURLOPT_READFUNCTION, readfunc);
     if (err != CURLE_OK)
-        throw KError(string("CURL error: ") + m_curlError);
+        throw KError(string("CURL error: ") + upload.error);
 
     // read data
-    err = curl_easy_setopt(m_curl, CURLOPT_READDATA, dataprovider);
+    err = curl_easy_setopt(upload.curl, CURLOPT_READDATA, readdata);
     if (err != CURLE_OK)
-        throw KError(string("CURL error: ") + m_curlError);
+        throw KError(string("CURL error: ") + upload.error);
+}
+
+// -----------------------------------------------------------------------------
+void FTPTransfer::runMulti(bool (*idle)(void *), void *data)
+{
+    while (true) {
+        int running;
+        CURLMcode merr = curl_multi_perform(m_multi, &running);
+        if (merr != CURLM_OK)
+            throw KError(string("CURL error: ") + curl_multi_strerror(merr));
+
+        CURLMsg *msg;
+        int left;
+        while ((msg = curl_multi_info_read(m_multi, &left)) != NULL) {
+            if (msg->msg != CURLMSG_DONE || msg->data.result == CURLE_OK)
+                continue;
+
+            char *priv = NULL;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &priv);
+            Upload *upload = reinterpret_cast<Upload *>(priv);
+            if (upload)
+                upload->result = msg->data.result;
+            string error = upload && upload->error[0]
+                ? upload->error
+                : curl_easy_strerror(msg->data.result);
+            throw KError("CURL error: " + error);
+        }
+
+        if (!running)
+            break;
+
+        // new data for a paused upload?
+        if (idle && idle(data))
+            continue;
+
+        merr = curl_multi_wait(m_multi, NULL, 0, 1000, NULL);
+        if (merr != CURLM_OK)
+            throw KError(string("CURL error: ") + curl_multi_strerror(merr));
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+/**
+ * One stripe of FTPTransfer::performStriped().
+ */
+struct FTPStripe {
+    CURL *curl;
+    BufferPool::Buffer buf;
+    size_t len, pos;
+    bool eof;
+    bool paused;
+};
+
+/**
+ * Distributes the chunks of a DataProvider over the stripes.
+ */
+struct FTPStriper {
+    DataProvider *dataprovider;
+    TransferMeter *meter;
+    std::vector<FTPStripe> stripes;
+    size_t chunkSize;
+    size_t next;
+    bool eof;
+    unsigned long long total;
+};
+
+// -----------------------------------------------------------------------------
+static size_t curl_readstripe(char *buffer, size_t size, size_t nmemb,
+                              void *data)
+{
+    FTPStripe *stripe = reinterpret_cast<FTPStripe *>(data);
+
+    size_t avail = stripe->len - stripe->pos;
+    if (avail == 0) {
+        if (stripe->eof)
+            return 0;
+        // wait until this stripe gets its next chunk
+        stripe->paused = true;
+        return CURL_READFUNC_PAUSE;
+    }
+
+    size_t n = std::min(avail, size * nmemb);
+    memcpy(buffer, stripe->buf.get() + stripe->pos, n);
+    stripe->pos += n;
+    KDUMP_PROBE2(curl_read, size * nmemb, n);
+    return n;
+}
+
+// -----------------------------------------------------------------------------
+static bool curl_fillstripes(void *data)
+{
+    FTPStriper *striper = reinterpret_cast<FTPStriper *>(data);
+    bool filled = false;
+
+    // refill consumed stripes in round-robin order
+    while (!striper->eof) {
+        FTPStripe &stripe = striper->stripes[striper->next];
+        if (stripe.pos < stripe.len)
+            break;
+
+        size_t read_data = 0;
+        while (read_data < striper->chunkSize) {
+            size_t ret = striper->meter->source([&]() {
+                    return striper->dataprovider->getData(
+                        stripe.buf.get() + read_data,
+                        striper->chunkSize - read_data);
+                });
+            if (ret == 0)
+                break;
+            read_data += ret;
+        }
+        striper->meter->moved(read_data);
+
+        stripe.len = read_data;
+        stripe.pos = 0;
+        striper->total += read_data;
+        striper->next = (striper->next + 1) % striper->stripes.size();
+        filled = true;
+
+        // finished?
+        if (read_data < striper->chunkSize) {
+            striper->eof = true;
+            std::vector<FTPStripe>::iterator it;
+            for (it = striper->stripes.begin();
+                 it != striper->stripes.end(); ++it)
+                it->eof = true;
+        }
+    }
+
+    std::vector<FTPStripe>::iterator it;
+    for (it = striper->stripes.begin(); it != striper->stripes.end(); ++it) {
+        if (it->paused && (it->pos < it->len || it->eof)) {
+            it->paused = false;
+            curl_easy_pause(it->curl, CURLPAUSE_CONT);
+            filled = true;
+        }
+    }
+
+    return filled;
+}
+
+// -----------------------------------------------------------------------------
+void FTPTransfer::performStriped(DataProvider *dataprovider,
+                                 const string &target_file,
+                                 size_t chunkSize, unsigned streams)
+{
+    KTRACE("FTPTransfer::performStriped(%p, %s, %lu, %u)",
+        dataprovider, target_file.c_str(), (unsigned long)chunkSize, streams);
+
+    if (streams < 1)
+        streams = 1;
+
+    const RootDirURL &parser = getURLVector().front();
+    std::unique_ptr<Upload[]> uploads(new Upload[streams]);
+    for (unsigned n = 0; n < streams; ++n)
+        uploads[n].curl = NULL;
+
+    TransferMeter meter("ftp-stripe", target_file);
+    meter.sinkIsRemainder();
+
+    FTPStriper striper;
+    striper.dataprovider = dataprovider;
+    striper.meter = &meter;
+    striper.stripes.resize(streams);
+    striper.chunkSize = chunkSize;
+    striper.next = 0;
+    striper.eof = false;
+    striper.total = 0;
+
+    StringVector stripes;
+    unsigned added = 0;
+    bool prepared = false;
+    try {
+        for (unsigned n = 0; n < streams; ++n) {
+            FTPStripe &stripe = striper.stripes[n];
+            stripe.curl = newHandle(uploads[n]);
+            stripe.buf = BufferPool::pool()->get(chunkSize);
+            stripe.len = stripe.pos = 0;
+            stripe.eof = stripe.paused = false;
+
+            string name = target_file + ".stripe" +
+                StringUtil::number2string(n);
+            open(uploads[n], name, curl_readstripe, &stripe);
+
+            FilePath fp = parser.getPath();
+            stripes.push_back(fp.appendPath(name));
+        }
+
+        dataprovider->prepare();
+        prepared = true;
+
+        for (; added < streams; ++added) {
+            CURLMcode merr = curl_multi_add_handle(m_multi,
+                                                   uploads[added].curl);
+            if (merr != CURLM_OK)
+                throw KError(string("CURL error: ") +
+                             curl_multi_strerror(merr));
+        }
+
+        KDBG("Striping %s over %u FTP connections",
+            target_file.c_str(), streams);
+        runMulti(curl_fillstripes, &striper);
+    } catch (...) {
+        for (unsigned n = 0; n < streams; ++n) {
+            if (n < added)
+                curl_multi_remove_handle(m_multi, uploads[n].curl);
+            if (uploads[n].curl)
+                curl_easy_cleanup(uploads[n].curl);
+        }
+        if (prepared) {
+            dataprovider->setError(true);
+            dataprovider->finish();
+        }
+        throw;
+    }
+
+    for (unsigned n = 0; n < streams; ++n) {
+        curl_multi_remove_handle(m_multi, uploads[n].curl);
+        curl_easy_cleanup(uploads[n].curl);
+    }
+    dataprovider->finish();
+
+    const string map = StripeWriter::map(chunkSize, striper.total, stripes);
+    BufferDataProvider mapProvider(map.c_str(), map.size());
+    Transfer::perform(&mapProvider, target_file + ".stripes");
+}
+
+// -----------------------------------------------------------------------------
+void FTPTransfer::performBatch(const ArtifactBatch &artifacts)
+{
+    KTRACE("FTPTransfer::performBatch([%lu files])",
+        (unsigned long)artifacts.size());
+
+    const size_t count = artifacts.size();
+    if (count == 0)
+        return;
+
+    std::unique_ptr<Upload[]> uploads(new Upload[count]);
+    std::unique_ptr<FTPArtifact[]> sources(new FTPArtifact[count]);
+    for (size_t n = 0; n < count; ++n)
+        uploads[n].curl = NULL;
+
+    TransferMeter meter("ftp-batch", artifacts.front().first);
+    meter.sinkIsRemainder();
+
+    size_t added = 0;
+    try {
+        for (size_t n = 0; n < count; ++n) {
+            sources[n].data = &artifacts[n].second;
+            sources[n].pos = 0;
+            sources[n].meter = &meter;
+            newHandle(uploads[n]);
+            open(uploads[n], artifacts[n].first, curl_readartifact,
+                 &sources[n]);
+        }
+
+        for (; added < count; ++added) {
+            CURLMcode merr = curl_multi_add_handle(m_multi,
+                                                   uploads[added].curl);
+            if (merr != CURLM_OK)
+                throw KError(string("CURL error: ") +
+                             curl_multi_strerror(merr));
+        }
+
+        KDBG("Uploading %lu files at once", (unsigned long)count);
+        runMulti(NULL, NULL);
+    } catch (...) {
+        for (size_t n = 0; n < count; ++n) {
+            if (n < added)
+                curl_multi_remove_handle(m_multi, uploads[n].curl);
+            if (uploads[n].curl)
+                curl_easy_cleanup(uploads[n].curl);
+        }
+        throw;
+    }
+
+    for (size_t n = 0; n < count; ++n) {
+        curl_multi_remove_handle(m_multi, uploads[n].curl);
+        curl_easy_cleanup(uploads[n].curl);
+    }
 }
 
 //}}}
@@ -454,11 +1465,29 @@ RootDirURL NFSTransfer::translate(const RootDirURL &parser)
     m_mountpoint = DEFAULT_MOUNTPOINT;
     m_mountpoint.appendPath(parser.getHostname()).appendPath(mountedDir);
     m_mountpoint.mkdir(true);
-    Debug::debug()->dbg("Path: %s, Mountpoint: %s, Rest: %s",
+    KDBG("Path: %s, Mountpoint: %s, Rest: %s",
         path.c_str(), m_mountpoint.c_str(), rest.c_str());
 
-    FileUtil::nfsmount(parser.getHostname(), mountedDir,
-        m_mountpoint, options);
+    // try the tuned options first; older kernels lack e.g. nconnect
+    const string &tuning = config->KDUMP_NFS_MOUNT_OPTIONS.value();
+    bool mounted = false;
+    if (!tuning.empty()) {
+        StringVector tuned(options);
+        tuned.push_back(tuning);
+        try {
+            FileUtil::nfsmount(parser.getHostname(), mountedDir,
+                m_mountpoint, tuned);
+            mounted = true;
+        } catch (const KError &error) {
+            cerr << "WARNING: " << error.what() << endl;
+            cerr << "WARNING: Mounting again without KDUMP_NFS_MOUNT_OPTIONS."
+                 << endl;
+        }
+    }
+
+    if (!mounted)
+        FileUtil::nfsmount(parser.getHostname(), mountedDir,
+            m_mountpoint, options);
 
     return RootDirURL("file://" + m_mountpoint + PATH_SEPARATOR + rest, "");
 }
@@ -466,12 +1495,12 @@ RootDirURL NFSTransfer::translate(const RootDirURL &parser)
 // -----------------------------------------------------------------------------
 NFSTransfer::~NFSTransfer()
 {
-    Debug::debug()->trace("NFSTransfer::~NFSTransfer()");
+    KTRACE("NFSTransfer::~NFSTransfer()");
 
     try {
         close();
     } catch (const KError &kerror) {
-        Debug::debug()->info("Error: %s", kerror.what());
+        KINFO("Error: %s", kerror.what());
     }
 }
 
@@ -486,7 +1515,7 @@ void NFSTransfer::perform(DataProvider *dataprovider,
 // -----------------------------------------------------------------------------
 void NFSTransfer::close()
 {
-    Debug::debug()->trace("NFSTransfer::close()");
+    KTRACE("NFSTransfer::close()");
     if (!m_mountpoint.empty()) {
         FileUtil::umount(m_mountpoint);
         m_mountpoint.clear();
@@ -533,8 +1562,24 @@ RootDirURL CIFSTransfer::translate(const RootDirURL &parser)
         options.push_back("port=" + StringUtil::number2string(parser.getPort()));
     }
 
-    FileUtil::mount("//" + parser.getHostname() + "/" + share,
-        DEFAULT_MOUNTPOINT, "cifs", options);
+    // try the tuned options first; older kernels lack e.g. multichannel
+    const string device = "//" + parser.getHostname() + "/" + share;
+    const string &tuning = config->KDUMP_CIFS_MOUNT_OPTIONS.value();
+    bool mounted = false;
+    if (!tuning.empty()) {
+        StringVector tuned(options);
+        tuned.push_back(tuning);
+        try {
+            FileUtil::mount(device, DEFAULT_MOUNTPOINT, "cifs", tuned);
+            mounted = true;
+        } catch (const KError &error) {
+            cerr << "WARNING: " << error.what() << endl;
+            cerr << "WARNING: Mounting again without KDUMP_CIFS_MOUNT_OPTIONS."
+                 << endl;
+        }
+    }
+    if (!mounted)
+        FileUtil::mount(device, DEFAULT_MOUNTPOINT, "cifs", options);
     m_mountpoint = DEFAULT_MOUNTPOINT;
 
     string rest = parser.getPath();
@@ -547,7 +1592,7 @@ RootDirURL CIFSTransfer::translate(const RootDirURL &parser)
     FilePath prefix = m_mountpoint;
     prefix.appendPath(rest);
 
-    Debug::debug()->dbg("Mountpoint: %s, Rest: %s, Prefix: %s",
+    KDBG("Mountpoint: %s, Rest: %s, Prefix: %s",
         m_mountpoint.c_str(), rest.c_str(), prefix.c_str());
 
     return RootDirURL("file://" + prefix, "");
@@ -556,12 +1601,12 @@ RootDirURL CIFSTransfer::translate(const RootDirURL &parser)
 // -----------------------------------------------------------------------------
 CIFSTransfer::~CIFSTransfer()
 {
-    Debug::debug()->trace("CIFSTransfer::~CIFSTransfer()");
+    KTRACE("CIFSTransfer::~CIFSTransfer()");
 
     try {
         close();
     } catch (const KError &kerror) {
-        Debug::debug()->info("Error: %s", kerror.what());
+        KINFO("Error: %s", kerror.what());
     }
 }
 
@@ -576,7 +1621,7 @@ void CIFSTransfer::perform(DataProvider *dataprovider,
 // -----------------------------------------------------------------------------
 void CIFSTransfer::close()
 {
-    Debug::debug()->trace("CIFSTransfer::close()");
+    KTRACE("CIFSTransfer::close()");
     if (m_mountpoint.size() > 0) {
         FileUtil::umount(m_mountpoint);
         m_mountpoint.clear();
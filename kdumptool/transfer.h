@@ -21,6 +21,9 @@
 
 #include <cstdio>
 #include <cstdarg>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <curl/curl.h>
 
@@ -29,8 +32,24 @@
 #include "fileutil.h"
 #include "rootdirurl.h"
 #include "stringvector.h"
+#include "bufferpool.h"
+#include "buffertuner.h"
+#include "nettuning.h"
+
+// data kept for resuming an FTP upload after a network failure
+#define FTP_REWIND_SIZE     (8*1024*1024)
 
 class DataProvider;
+class SpaceGuard;
+class WritebackWindow;
+class Preallocation;
+class TransferMeter;
+
+/**
+ * Small files that are saved together: pairs of the target file name
+ * and the file contents.
+ */
+typedef std::vector<std::pair<std::string, std::string> > ArtifactBatch;
 
 //{{{ Transfer -----------------------------------------------------------------
 
@@ -80,6 +99,84 @@ class Transfer {
 	void perform(DataProvider *dataprovider,
 		     const std::string &target_file,
 		     bool *directSave=NULL);
+
+        /**
+         * Checks whether Transfer::performStriped() can be used.
+         *
+         * @return @c false in the default implementation
+         */
+        virtual bool canStripe()
+        { return false; }
+
+        /**
+         * Checks whether perform() can be called from several threads
+         * at the same time.
+         *
+         * @return @c false in the default implementation
+         */
+        virtual bool isThreadSafe()
+        { return false; }
+
+        /**
+         * Returns the local directory where the dump is saved, if the
+         * target is a local or mounted file system.
+         *
+         * @return an empty string in the default implementation
+         */
+        virtual std::string localDirectory()
+        { return std::string(); }
+
+        /**
+         * Distributes the data round-robin in fixed-size chunks over
+         * several streams. Each stream is saved to a file named
+         * "<target_file>.stripe<n>", and a chunk map
+         * "<target_file>.stripes" is saved like a normal target file.
+         * The DataProvider::saveToFile() shortcut is never used.
+         *
+         * @param[in] dataprovider the data provider
+         * @param[in] target_file the file name for the target
+         * @param[in] chunkSize size of each chunk in bytes
+         * @param[in] streams number of parallel streams (ignored by
+         *            transfers that have one stream per target)
+         * @exception KError on any error, or if striping is not supported
+         */
+        virtual void performStriped(DataProvider *dataprovider,
+                                    const std::string &target_file,
+                                    size_t chunkSize, unsigned streams);
+
+        /**
+         * Saves several small files that are kept in memory. A transfer
+         * with a high cost per file (a connection, a round trip for each
+         * request) saves them together. The default implementation calls
+         * perform() for each file.
+         *
+         * @param[in] artifacts the file names and contents
+         * @exception KError on any error; some of the files may have
+         *            been saved
+         */
+        virtual void performBatch(const ArtifactBatch &artifacts);
+
+        /**
+         * Stops the following transfers before less than @p bytes
+         * would be left free on a local target. The file is kept up to
+         * that point, and KNoSpaceError is thrown. The default
+         * implementation ignores the reserve.
+         *
+         * @param[in] bytes bytes that must stay free, or 0 to write
+         *            until the file system is full
+         */
+        virtual void setFreeSpaceReserve(unsigned long long bytes)
+        { }
+
+        /**
+         * Sets the expected size of the files of the following
+         * transfers, so that a local target can allocate the space up
+         * front. The default implementation ignores the size.
+         *
+         * @param[in] bytes the expected size, or 0 if it is not known
+         */
+        virtual void setExpectedSize(unsigned long long bytes)
+        { }
 };
 
 //}}}
@@ -150,6 +247,56 @@ class FileTransfer : public URLTransfer {
                      const StringVector &target_files,
                      bool *directSave);
 
+        /**
+         * Returns @c true if there is more than one target directory.
+         *
+         * @see Transfer::canStripe()
+         */
+        bool canStripe();
+
+        /**
+         * Returns the first target directory.
+         *
+         * @see Transfer::localDirectory()
+         */
+        std::string localDirectory();
+
+        /**
+         * Writes one stripe per target directory, each with its own
+         * thread. The number of streams is ignored.
+         *
+         * @see Transfer::performStriped()
+         */
+        void performStriped(DataProvider *dataprovider,
+                            const std::string &target_file,
+                            size_t chunkSize, unsigned streams);
+
+        /**
+         * Writes all files to the first target directory, with one
+         * free space check for all of them.
+         *
+         * @see Transfer::performBatch()
+         */
+        void performBatch(const ArtifactBatch &artifacts);
+
+        /**
+         * Watches the free space on each target while writing.
+         * makedumpfile cannot be stopped when it saves the dump itself,
+         * so a single dump file is piped through kdumptool instead.
+         *
+         * @see Transfer::setFreeSpaceReserve()
+         */
+        void setFreeSpaceReserve(unsigned long long bytes)
+        { m_reserve = bytes; }
+
+        /**
+         * Preallocates the file that is written by kdumptool.
+         *
+         * @see Transfer::setExpectedSize()
+         */
+        void setExpectedSize(unsigned long long bytes)
+        { m_expected = bytes; }
+
     protected:
 
         void performFile(DataProvider *dataprovider,
@@ -158,18 +305,106 @@ class FileTransfer : public URLTransfer {
         void performPipe(DataProvider *dataprovider,
 			 const StringVector &target_files);
 
+        /**
+         * Writes data at the current position of a file, after skipping
+         * a pending hole.
+         *
+         * @param[in] fp the target file
+         * @param[in] data the data to be written
+         * @param[in] len length of the data in bytes
+         * @param[in,out] hole size of the pending hole, reset if skipped
+         * @param[in] guard the free space watch, or @c NULL
+         * @exception KNoSpaceError if @p guard stops the write
+         * @exception KError on any error
+         */
+        void writeData(FILE *fp, const char *data, size_t len, off_t *hole,
+                       SpaceGuard *guard);
+
+        /**
+         * The copy loop of performPipe() for one combination of a Read
+         * and a Holes policy (see pipeloop.h) and a Window policy (the
+         * write-back, see transfer.cc).
+         *
+         * @param[in] dataprovider the data provider, already prepared
+         * @param[in] fp the target file
+         * @param[in,out] hole size of the pending hole
+         * @param[in] guard the free space watch, or @c NULL
+         * @param[in] window the write-back window, or @c NULL
+         * @param[in] meter accounts for the transfer
+         * @exception KError on any error
+         */
+        template<typename Read, typename Holes, typename Window>
+        void pipeLoop(DataProvider *dataprovider, FILE *fp, off_t *hole,
+                      SpaceGuard *guard, WritebackWindow *window,
+                      TransferMeter &meter);
+
+        /**
+         * Variant of performPipe() for a DataProvider that can place
+         * its data (see DataProvider::getPlacedData()). The pieces are
+         * read as chunks (see DataProvider::getChunk()) and written at
+         * their offsets by a ChunkWriter, while the next one is read.
+         *
+         * @param[in] dataprovider the data provider
+         * @param[in] target_file the full path of the target file
+         * @param[in] sparse create a sparse file
+         * @exception KError on any error
+         */
+        void performPlaced(DataProvider *dataprovider,
+                           const std::string &target_file,
+                           bool sparse);
+
+        /**
+         * Variant of performPipe() which overlaps reading from the
+         * data provider with writing the target file. Used with the
+         * ASYNCIO flag in KDUMPTOOL_FLAGS.
+         *
+         * @param[in] dataprovider the data provider
+         * @param[in] target_file the full path of the target file
+         * @param[in] sparse create a sparse file
+         * @exception KError on any error
+         */
+        void performPipeAsync(DataProvider *dataprovider,
+                              const std::string &target_file,
+                              bool sparse);
+
         FILE *open(const std::string &target_file);
 
         void close(FILE *fp);
 
+        /**
+         * Returns a SpaceGuard for @p target_file if a reserve is set.
+         */
+        SpaceGuard *spaceGuard(const std::string &target_file) const;
+
+        /**
+         * Returns a WritebackWindow for @p fd if the WRITEBACK flag is
+         * set in KDUMPTOOL_FLAGS.
+         */
+        WritebackWindow *writebackWindow(int fd) const;
+
+        /**
+         * Returns a Preallocation for @p fd if the expected size is set.
+         */
+        Preallocation *preallocation(int fd) const;
+
     private:
+        unsigned long long m_reserve;
+        unsigned long long m_expected;
+        size_t m_blockSize;
         size_t m_bufferSize;
-        char *m_buffer;
+        BufferPool::Buffer m_buffer;
+        BufferTuner m_tuner;
 };
 
 //}}}
 //{{{ FTPTransfer --------------------------------------------------------------
 
+/**
+ * CURLOPT_SOCKOPTFUNCTION callback that applies the NetTuning which
+ * @p clientp points to.
+ */
+int curl_sockopt(void *clientp, curl_socket_t fd, curlsocktype purpose);
+
 /**
  * Transfers a file to FTP (upload).
  */
@@ -198,15 +433,67 @@ class FTPTransfer : public URLTransfer {
                      const StringVector &target_files,
                      bool *directSave);
 
+        /**
+         * Striping is always possible over several FTP data connections.
+         *
+         * @see Transfer::canStripe()
+         */
+        bool canStripe()
+        { return true; }
+
+        /**
+         * Uploads all stripes concurrently, each over its own FTP
+         * connection.
+         *
+         * @see Transfer::performStriped()
+         */
+        void performStriped(DataProvider *dataprovider,
+                            const std::string &target_file,
+                            size_t chunkSize, unsigned streams);
+
+        /**
+         * Uploads all files concurrently, so that the connections are
+         * set up at the same time.
+         *
+         * @see Transfer::performBatch()
+         */
+        void performBatch(const ArtifactBatch &artifacts);
+
     protected:
 
-        void open(DataProvider *dataprovider,
-		  const std::string &target_file);
+        /**
+         * One upload handled by the multi handle.
+         */
+        struct Upload {
+            CURL *curl;
+            char error[CURL_ERROR_SIZE];
+            CURLcode result;    // of the last failed transfer
+        };
+
+        /**
+         * Creates an easy handle with the options common to all uploads.
+         */
+        CURL *newHandle(Upload &upload);
+
+        void open(Upload &upload, const std::string &target_file,
+                  curl_read_callback readfunc, void *readdata);
+
+        /**
+         * Runs the multi handle until all transfers are finished.
+         *
+         * @param[in] idle called between two rounds of the event loop,
+         *            or NULL; returns @c true if it resumed a paused
+         *            transfer, so there is no need to wait for sockets
+         * @param[in] data argument for @a idle
+         * @exception KError if a transfer failed
+         */
+        void runMulti(bool (*idle)(void *), void *data);
 
     private:
-        char m_curlError[CURL_ERROR_SIZE];
         static bool curl_global_inititalised;
-        CURL *m_curl;
+        CURLM *m_multi;
+        Upload m_upload;
+        NetTuning m_tuning;
 };
 
 //}}}
@@ -240,6 +527,22 @@ class NFSTransfer : public URLTransfer {
                      const StringVector &target_files,
                      bool *directSave);
 
+        /**
+         * Returns the directory below the mount point.
+         *
+         * @see Transfer::localDirectory()
+         */
+        std::string localDirectory()
+        { return m_fileTransfer->localDirectory(); }
+
+        /**
+         * Writes the files below the mount point.
+         *
+         * @see Transfer::performBatch()
+         */
+        void performBatch(const ArtifactBatch &artifacts)
+        { m_fileTransfer->performBatch(artifacts); }
+
     protected:
         void close();
 
@@ -287,6 +590,22 @@ class CIFSTransfer : public URLTransfer {
                      const StringVector &target_files,
                      bool *directSave);
 
+        /**
+         * Returns the directory below the mount point.
+         *
+         * @see Transfer::localDirectory()
+         */
+        std::string localDirectory()
+        { return m_fileTransfer->localDirectory(); }
+
+        /**
+         * Writes the files below the mount point.
+         *
+         * @see Transfer::performBatch()
+         */
+        void performBatch(const ArtifactBatch &artifacts)
+        { m_fileTransfer->performBatch(artifacts); }
+
     protected:
         void close();
 
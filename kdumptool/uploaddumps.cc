@@ -0,0 +1,324 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "global.h"
+#include "debug.h"
+#include "configuration.h"
+#include "rootdirurl.h"
+#include "routable.h"
+#include "transfer.h"
+#include "dataprovider.h"
+#include "savedump.h"
+#include "stringutil.h"
+#include "uploaddumps.h"
+#include "reassemble.h"
+
+using std::string;
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::ifstream;
+using std::ofstream;
+
+//{{{ UploadMarker -------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+UploadMarker::UploadMarker(const FilePath &dir)
+    : m_file(dir), m_exists(false)
+{
+    m_file.appendPath(UPLOAD_MARKER);
+
+    ifstream fin(m_file.c_str());
+    if (!fin) {
+        if (errno != ENOENT)
+            throw KSystemError("Cannot open " + m_file + ".", errno);
+        return;
+    }
+    m_exists = true;
+
+    string line;
+    while (getline(fin, line)) {
+        std::istringstream iss(line);
+        string key, target, value;
+        if (!(iss >> key >> target))
+            continue;
+        iss >> value;
+
+        if (key == "target")
+            m_targets.push_back(target);
+        else if (key == "dest")
+            m_dest[target] = value;
+        else if (key == "done")
+            m_done.insert(std::make_pair(target, value));
+    }
+}
+
+// -----------------------------------------------------------------------------
+void UploadMarker::create(const FilePath &dir, const StringVector &targets)
+{
+    Debug::debug()->trace("UploadMarker::create(%s)", dir.c_str());
+
+    FilePath file = dir;
+    file.appendPath(UPLOAD_MARKER);
+
+    // the upload must not start before the marker is complete
+    static std::atomic<unsigned> serial(0);
+    string tmp = file + ".tmp" + StringUtil::number2string(getpid()) +
+        "." + StringUtil::number2string(serial++);
+    {
+        ofstream fout(tmp.c_str(), std::ios::trunc);
+        StringVector::const_iterator it;
+        for (it = targets.begin(); it != targets.end(); ++it)
+            fout << "target " << *it << '\n';
+        fout.close();
+        if (!fout) {
+            unlink(tmp.c_str());
+            throw KError("Cannot write " + tmp + ".");
+        }
+    }
+
+    if (rename(tmp.c_str(), file.c_str()) != 0) {
+        int err = errno;
+        unlink(tmp.c_str());
+        throw KSystemError("Cannot rename " + tmp + ".", err);
+    }
+}
+
+// -----------------------------------------------------------------------------
+string UploadMarker::destination(const string &target) const
+{
+    std::map<string, string>::const_iterator it = m_dest.find(target);
+    return it == m_dest.end() ? string() : it->second;
+}
+
+// -----------------------------------------------------------------------------
+void UploadMarker::setDestination(const string &target, const string &dest)
+{
+    append("dest " + target + " " + dest);
+    m_dest[target] = dest;
+}
+
+// -----------------------------------------------------------------------------
+bool UploadMarker::done(const string &target, const string &file) const
+{
+    return m_done.find(std::make_pair(target, file)) != m_done.end();
+}
+
+// -----------------------------------------------------------------------------
+void UploadMarker::setDone(const string &target, const string &file)
+{
+    append("done " + target + " " + file);
+    m_done.insert(std::make_pair(target, file));
+}
+
+// -----------------------------------------------------------------------------
+void UploadMarker::append(const string &line)
+{
+    ofstream fout(m_file.c_str(), std::ios::app);
+    fout << line << '\n';
+    fout.close();
+    if (!fout)
+        throw KError("Cannot write " + m_file + ".");
+}
+
+//}}}
+//{{{ UploadDumps --------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+UploadDumps::UploadDumps()
+    : m_keep(false)
+{
+    Debug::debug()->trace("UploadDumps::UploadDumps()");
+
+    m_options.push_back(new StringOption("root", 'R', &m_rootdir,
+        "Use the specified root directory instead of /"));
+    m_options.push_back(new FlagOption("keep", 'k', &m_keep,
+        "Keep the staged dumps after the upload"));
+}
+
+// -----------------------------------------------------------------------------
+const char *UploadDumps::getName() const
+{
+    return "upload_dumps";
+}
+
+// -----------------------------------------------------------------------------
+void UploadDumps::execute()
+{
+    Debug::debug()->trace("UploadDumps::execute()");
+
+    Configuration *config = Configuration::config();
+    string staging = config->KDUMP_STAGING_DIR.value();
+    if (staging.empty()) {
+        Debug::debug()->dbg("KDUMP_STAGING_DIR is not set.");
+        return;
+    }
+
+    FilePath dir = RootDirURL(staging, m_rootdir).getRealPath();
+    if (!dir.exists()) {
+        Debug::debug()->dbg("%s does not exist.", dir.c_str());
+        return;
+    }
+
+    unsigned failed = 0;
+    StringVector contents = dir.listDir(FilterDotsAndNondirs());
+    StringVector::const_iterator it;
+    for (it = contents.begin(); it != contents.end(); ++it) {
+        FilePath dump = dir;
+        dump.appendPath(*it);
+        try {
+            uploadDump(dump);
+        } catch (const KError &error) {
+            cerr << error.what() << endl;
+            ++failed;
+        }
+    }
+
+    if (failed)
+        throw KError("Uploading " + StringUtil::number2string(failed) +
+                     " dump(s) failed.");
+}
+
+// -----------------------------------------------------------------------------
+void UploadDumps::uploadDump(const FilePath &dir)
+{
+    Debug::debug()->trace("UploadDumps::uploadDump(%s)", dir.c_str());
+
+    UploadMarker marker(dir);
+    if (!marker.exists())
+        return;
+
+    // the small files come first, so the README and the kernel log are
+    // available long before the dump itself
+    std::vector<std::pair<unsigned long long, string> > sized;
+    StringVector contents = dir.listDir(FilterDots());
+    StringVector::const_iterator it;
+    for (it = contents.begin(); it != contents.end(); ++it) {
+        if (*it == UPLOAD_MARKER || *it == REASSEMBLE_MARKER ||
+            it->compare(0, strlen(UPLOAD_MARKER ".tmp"),
+                        UPLOAD_MARKER ".tmp") == 0)
+            continue;
+        FilePath path = dir;
+        path.appendPath(*it);
+        struct stat mystat;
+        if (stat(path.c_str(), &mystat) != 0 || !S_ISREG(mystat.st_mode))
+            continue;
+        sized.push_back(std::make_pair(mystat.st_size, *it));
+    }
+    std::sort(sized.begin(), sized.end());
+    StringVector files;
+    for (size_t i = 0; i < sized.size(); ++i)
+        files.push_back(sized[i].second);
+
+    const StringVector &targets = marker.targets();
+    unsigned failed = 0;
+    for (it = targets.begin(); it != targets.end(); ++it) {
+        try {
+            uploadTarget(dir, files, marker, *it);
+        } catch (const KError &error) {
+            cerr << error.what() << endl;
+            ++failed;
+        }
+    }
+
+    if (failed)
+        throw KError("Upload of " + dir + " is incomplete.");
+
+    cout << "Uploaded " << dir << endl;
+    if (!m_keep) {
+        // the marker goes first, so a partial removal is not uploaded again
+        FilePath file = dir;
+        file.appendPath(UPLOAD_MARKER);
+        if (unlink(file.c_str()) != 0)
+            throw KSystemError("Cannot remove " + file + ".", errno);
+        FilePath(dir).rmdir(true);
+    }
+}
+
+// -----------------------------------------------------------------------------
+void UploadDumps::uploadTarget(const FilePath &dir, const StringVector &files,
+                               UploadMarker &marker, const string &target)
+{
+    Debug::debug()->trace("UploadDumps::uploadTarget(%s, %s)",
+                          dir.c_str(), target.c_str());
+
+    Configuration *config = Configuration::config();
+
+    StringVector::const_iterator it;
+    for (it = files.begin(); it != files.end(); ++it)
+        if (!marker.done(target, *it))
+            break;
+    if (it == files.end())
+        return;
+
+    // choose the directory once, so that a resumed upload does not
+    // start over in a new one if the source address has changed
+    string dest = marker.destination(target);
+    if (dest.empty()) {
+        FilePath elem = target;
+        string name = dir.baseName();
+        RootDirURL url(target, m_rootdir);
+        if (url.getProtocol() != URLParser::PROT_FILE) {
+            Routable rt(url.getHostname());
+            if (!rt.check(config->KDUMP_NET_TIMEOUT.value()))
+                throw KError("Dump target " + url.getHostname() +
+                             " is not reachable.");
+            elem.appendPath(rt.prefsrc() + '-' + name);
+        } else
+            elem.appendPath(name);
+        dest = elem;
+        marker.setDestination(target, dest);
+    }
+
+    std::unique_ptr<Transfer> transfer(SaveDump::getTransfer(
+        RootDirURLVector(1, RootDirURL(dest, m_rootdir))));
+    unsigned long long rate =
+        (unsigned long long)std::max(config->KDUMP_UPLOAD_BANDWIDTH.value(),
+                                     0) << 10;
+
+    for (; it != files.end(); ++it) {
+        if (marker.done(target, *it))
+            continue;
+
+        FilePath path = dir;
+        path.appendPath(*it);
+        cout << "Uploading " << path << " to " << dest << endl;
+
+        FileDataProvider provider(path.c_str());
+        ThrottledDataProvider throttled(&provider, rate);
+        transfer->perform(&throttled, *it);
+        marker.setDone(target, *it);
+    }
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
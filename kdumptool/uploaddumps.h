@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef UPLOADDUMPS_H
+#define UPLOADDUMPS_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "global.h"
+#include "subcommand.h"
+#include "fileutil.h"
+#include "stringvector.h"
+
+#define UPLOAD_MARKER       ".kdump-upload"
+
+//{{{ UploadMarker -------------------------------------------------------------
+
+/**
+ * The marker of a staged dump (see KDUMP_STAGING_DIR).
+ *
+ * The marker lists the network targets that still need a copy of the
+ * dump, and each file that has been copied to a target is appended, so
+ * that an interrupted upload continues with the next file. The lines are:
+ *
+ *   target <url>           the dump has to be uploaded to <url>
+ *   dest <url> <dest>      the directory for the dump below <url>
+ *   done <url> <file>      <file> has been uploaded to <url>
+ */
+class UploadMarker {
+
+    public:
+        /**
+         * Reads the marker of a staged dump, if there is one.
+         *
+         * @param[in] dir the directory of the staged dump
+         * @exception KError if the marker cannot be read
+         */
+        UploadMarker(const FilePath &dir);
+
+        /**
+         * Creates the marker for a dump that has just been staged.
+         *
+         * @param[in] dir the directory of the staged dump
+         * @param[in] targets the network targets from KDUMP_SAVEDIR
+         * @exception KError if the marker cannot be written
+         */
+        static void create(const FilePath &dir, const StringVector &targets);
+
+        /**
+         * Returns @c true if the dump is waiting for an upload.
+         */
+        bool exists() const
+        { return m_exists; }
+
+        /**
+         * Returns the targets in the order of KDUMP_SAVEDIR.
+         */
+        const StringVector &targets() const
+        { return m_targets; }
+
+        /**
+         * Returns the directory of the dump on @p target, or an empty
+         * string if it has not been chosen yet.
+         */
+        std::string destination(const std::string &target) const;
+
+        /**
+         * Records the directory of the dump on @p target.
+         *
+         * @exception KError if the marker cannot be written
+         */
+        void setDestination(const std::string &target,
+                            const std::string &dest);
+
+        /**
+         * Returns @c true if @p file has been uploaded to @p target.
+         */
+        bool done(const std::string &target, const std::string &file) const;
+
+        /**
+         * Records that @p file has been uploaded to @p target.
+         *
+         * @exception KError if the marker cannot be written
+         */
+        void setDone(const std::string &target, const std::string &file);
+
+    protected:
+        void append(const std::string &line);
+
+    private:
+        FilePath m_file;
+        bool m_exists;
+        StringVector m_targets;
+        std::map<std::string, std::string> m_dest;
+        std::set<std::pair<std::string, std::string> > m_done;
+};
+
+//}}}
+//{{{ UploadDumps --------------------------------------------------------------
+
+/**
+ * Subcommand to upload the dumps in KDUMP_STAGING_DIR to the network
+ * targets in KDUMP_SAVEDIR.
+ */
+class UploadDumps : public Subcommand {
+
+    public:
+        /**
+         * Creates a new UploadDumps object.
+         */
+        UploadDumps();
+
+    public:
+        /**
+         * Returns the name of the subcommand (upload_dumps).
+         */
+        const char *getName() const;
+
+        /**
+         * Executes the function.
+         *
+         * @throw KError on any error. No exception indicates success.
+         */
+        void execute();
+
+    protected:
+        /**
+         * Uploads one staged dump to all its targets and removes it
+         * unless --keep has been given.
+         *
+         * @param[in] dir the directory of the staged dump
+         * @exception KError if the upload to a target fails
+         */
+        void uploadDump(const FilePath &dir);
+
+        /**
+         * Uploads the missing files of a staged dump to one target.
+         *
+         * @param[in] dir the directory of the staged dump
+         * @param[in] files the files of the dump, smallest first
+         * @param[in] marker the marker of the dump
+         * @param[in] target the URL from KDUMP_SAVEDIR
+         * @exception KError if the upload fails
+         */
+        void uploadTarget(const FilePath &dir, const StringVector &files,
+                          UploadMarker &marker, const std::string &target);
+
+    private:
+        std::string m_rootdir;
+        bool m_keep;
+};
+
+//}}}
+
+#endif /* UPLOADDUMPS_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
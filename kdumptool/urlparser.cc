@@ -57,6 +57,14 @@ URLParser::Protocol URLParser::string2protocol(const string &protocol)
         return PROT_CIFS;
     else if (strcasecmp(protocol.c_str(), "smb") == 0)
         return PROT_CIFS;
+    else if (strcasecmp(protocol.c_str(), "raw") == 0)
+        return PROT_RAW;
+    else if (strcasecmp(protocol.c_str(), "kdump") == 0)
+        return PROT_KDUMP;
+    else if (strcasecmp(protocol.c_str(), "s3") == 0)
+        return PROT_S3;
+    else if (strcasecmp(protocol.c_str(), "s3+http") == 0)
+        return PROT_S3;
     else
         throw KError("Protocol " + protocol + " is invalid.");
 }
@@ -77,6 +85,12 @@ string URLParser::protocol2string(URLParser::Protocol protocol)
             return "nfs";
         case PROT_CIFS:
             return "cifs";
+        case PROT_RAW:
+            return "raw";
+        case PROT_KDUMP:
+            return "kdump";
+        case PROT_S3:
+            return "s3";
         default:
             throw KError("Invalid protocol constant: " +
                 StringUtil::number2string(protocol) + ".");
@@ -217,6 +231,8 @@ URLParser::URLParser(const std::string &url)
     //
     if (m_protocol == PROT_FILE && !m_hostname.empty())
 	throw KError("File protocol cannot specify a remote host");
+    if (m_protocol == PROT_RAW && !m_hostname.empty())
+	throw KError("Raw protocol cannot specify a remote host");
 
     Debug::debug()->dbg("URL parsed as: protocol=%s, host=%s, port=%d, "
         "username=%s, password=%s, path=%s",
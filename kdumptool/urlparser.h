@@ -45,7 +45,10 @@ class URLParser {
             PROT_SFTP,          /**< Secure File Transfer Protocol */
             PROT_SSH,           /**< Secure Shell */
             PROT_NFS,           /**< Network File System */
-            PROT_CIFS           /**< Common Internet File System (SMB) */
+            PROT_CIFS,          /**< Common Internet File System (SMB) */
+            PROT_RAW,           /**< block device without a file system */
+            PROT_KDUMP,         /**< collector (kdumptool receive) */
+            PROT_S3             /**< S3 compatible object store */
         };
 
     public:
@@ -65,7 +68,8 @@ class URLParser {
 
         /**
          * Returns the protocol of the URL, i.e. PROT_FILE, @c PROT_FTP,
-         * @c PROT_SFTP, @c PROT_NFS or @c PROT_CIFS.
+         * @c PROT_SFTP, @c PROT_NFS, @c PROT_CIFS, @c PROT_RAW, @c PROT_KDUMP
+         * or @c PROT_S3.
          *
          * @return the protocol
          */
@@ -75,7 +79,7 @@ class URLParser {
          * Returns the protocol as string.
          *
          * @return the protocol as string, i.e. @c file, @c ftp, @c sftp,
-         * @c nfs or @c cifs.
+         * @c nfs, @c cifs or @c raw.
          */
         std::string getProtocolAsString() const;
 
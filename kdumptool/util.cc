@@ -26,16 +26,21 @@
 #include <sys/types.h>
 #include <sys/utsname.h>
 #include <sys/stat.h>
-#include <sys/mman.h>
+#include <stdint.h>
 
-#include <libelf.h>
-#include <gelf.h>
+#if defined(__x86_64__)
+#  include <immintrin.h>
+#elif defined(__aarch64__)
+#  include <arm_neon.h>
+#endif
+
+#include <elf.h>
 
 #include "global.h"
-#include "elf.h"
 #include "util.h"
 #include "debug.h"
 #include "fileutil.h"
+#include "vmcorecontext.h"
 
 using std::string;
 using std::strerror;
@@ -138,197 +143,12 @@ bool Util::isElfFile(const string &file)
     return isElfFile(FileDescriptor(file, O_RDONLY));
 }
 
-// -----------------------------------------------------------------------------
-static off_t FindElfNoteByName(int fd, off_t offset, size_t sz,
-                               const char *name)
-{
-    char *buf, *p;
-    size_t to_read;
-    size_t nlen;
-    off_t ret = (off_t)-1;
-
-    Debug::debug()->trace("FindElfNoteByName(%d, %lu, %lu, %s)",
-                          fd, (unsigned long)offset, (unsigned long)sz, name);
-
-    if (lseek(fd, offset, SEEK_SET) == (off_t)-1)
-        throw KSystemError("Cannot seek to ELF notes", errno);
-
-    buf = new char[sz];
-    try {
-        to_read = sz;
-        p = buf;
-        while (to_read) {
-            ssize_t bytes_read = read(fd, p, to_read);
-            if (bytes_read < 0)
-                throw KSystemError("Cannot read ELF note", errno);
-            else if (!bytes_read)
-                throw KError("Unexpected EOF while reading ELF note");
-
-            to_read -= bytes_read;
-            p += bytes_read;
-        }
-
-        nlen = strlen(name);
-        to_read = sz;
-        p = buf;
-        while (to_read) {
-            Elf64_Nhdr *hdr = reinterpret_cast<Elf64_Nhdr*>(p);
-            if (to_read < sizeof(*hdr))
-                break;
-            to_read -= sizeof(*hdr);
-            p += sizeof(*hdr);
-
-            size_t notesz =
-                ((hdr->n_namesz + 3) & (-(Elf64_Word)4)) +
-                ((hdr->n_descsz + 3) & (-(Elf64_Word)4));
-            if (to_read < notesz)
-                break;
-
-            if ((hdr->n_namesz == nlen && !memcmp(p, name, nlen)) ||
-                (hdr->n_namesz == nlen+1 && !memcmp(p, name, nlen+1))) {
-                ret = offset + (p - buf) - sizeof(*hdr);
-                break;
-            }
-
-            to_read -= notesz;
-            p += notesz;
-        }
-    } catch (...) {
-        delete buf;
-        throw;
-    }
-
-    return ret;
-}
-
-// -----------------------------------------------------------------------------
-#define ELF_HEADER_MAPSIZE          (128*1024)
-
-static void *map_elf(int fd, size_t len)
-{
-    void *map;
-    map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
-    if (map == MAP_FAILED) {
-	map = mmap(NULL, len, PROT_READ | PROT_WRITE,
-		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-	if (map == MAP_FAILED)
-	    throw KSystemError("Cannot allocate ELF headers", errno);
-
-	size_t to_read = len;
-	char *p = reinterpret_cast<char *>(map);
-	while (to_read) {
-	    ssize_t bytes_read = read(fd, p, to_read);
-	    if (bytes_read < 0)
-		throw KSystemError("ELF read error", errno);
-	    else if (!bytes_read)
-		break;
-
-	    to_read -= bytes_read;
-	    p += bytes_read;
-	}
-    }
-    return map;
-}
-
-bool Util::isXenCoreDump(int fd)
-{
-    void *map = MAP_FAILED;
-    Elf *elf = (Elf*)0;
-    bool ret = false;
-    size_t mapsize = ELF_HEADER_MAPSIZE;
-
-    Debug::debug()->trace("isXenCoreDump(%d)", fd);
-
-    if (elf_version(EV_CURRENT) == EV_NONE)
-        throw KError("libelf is out of date.");
-
-    try {
-        map = map_elf(fd, mapsize);
-        elf = elf_memory(reinterpret_cast<char *>(map), mapsize);
-        if (!elf)
-            throw KELFError("elf_memory() failed", elf_errno());
-
-        if (elf_kind(elf) != ELF_K_ELF)
-            return false;
-
-        size_t endphdr;
-        Elf32_Ehdr *ehdr32;
-        Elf64_Ehdr *ehdr64;
-
-        switch (gelf_getclass(elf)) {
-        case ELFCLASS32:
-            ehdr32 = reinterpret_cast<Elf32_Ehdr*>(map);
-            endphdr = ehdr32->e_phoff + ehdr32->e_phentsize * ehdr32->e_phnum;
-            break;
-        case ELFCLASS64:
-            ehdr64 = reinterpret_cast<Elf64_Ehdr*>(map);
-            endphdr = ehdr64->e_phoff + ehdr64->e_phentsize * ehdr64->e_phnum;
-            break;
-        default:
-            throw KError("Unrecognized ELF class");
-        }
-
-        if (endphdr > mapsize) {
-            elf_end(elf);
-            munmap(map, mapsize);
-
-            long pagesize = sysconf(_SC_PAGESIZE);
-            mapsize = (endphdr + pagesize - 1) & ~(pagesize - 1);
-            Debug::debug()->dbg("Enlarging map size to %zu bytes", mapsize);
-
-            map = map_elf(fd, mapsize);
-            elf = elf_memory(reinterpret_cast<char *>(map), mapsize);
-            if (!elf)
-                throw KELFError("elf_memory() failed", elf_errno());
-        }
-
-        size_t phnum, i;
-        if (elf_getphdrnum(elf, &phnum))
-            throw KELFError("Cannot count ELF program headers", elf_errno());
-
-        for (i = 0; i < phnum; ++i) {
-            GElf_Phdr phdr;
-
-            if (gelf_getphdr(elf, i, &phdr) != &phdr)
-                throw KELFError("getphdr() failed.", elf_errno());
-
-            if (phdr.p_type == PT_NOTE &&
-                FindElfNoteByName(fd, phdr.p_offset, phdr.p_filesz, "Xen")
-                != (off_t)-1) {
-                ret = true;
-                break;
-            }
-        }
-    } catch (...) {
-        if (elf)
-            elf_end(elf);
-        if (map != MAP_FAILED)
-            munmap(map, mapsize);
-        throw;
-    }
-
-    munmap(map, mapsize);
-    elf_end(elf);
-    return ret;
-}
-
 // -----------------------------------------------------------------------------
 bool Util::isXenCoreDump(const string &file)
 {
-    int fd = open(file.c_str(), O_RDONLY);
-    if (fd < 0) {
-        throw KSystemError("Opening of " + file + " failed.", errno);
-    }
+    Debug::debug()->trace("isXenCoreDump(%s)", file.c_str());
 
-    bool ret;
-    try {
-         ret = isXenCoreDump(fd);
-    } catch (...) {
-        close(fd);
-        throw;
-    }
-
-    return ret;
+    return VmcoreContext::get(file)->isXenDump();
 }
 
 // -----------------------------------------------------------------------------
@@ -367,15 +187,122 @@ void Util::daemonize()
 }
 
 // -----------------------------------------------------------------------------
-bool Util::isZero(const char *buffer, size_t size)
+typedef unsigned long __attribute__((__may_alias__)) AliasedWord;
+
+// Portable version, one machine word at a time
+static bool isZeroGeneric(const char *buffer, size_t size)
 {
-    for (size_t i = 0; i < size; i++)
-        if (buffer[i] != 0)
+    const char *p = buffer;
+    const char *end = buffer + size;
+
+    while (p < end && ((uintptr_t)p & (sizeof(AliasedWord) - 1)))
+        if (*p++)
+            return false;
+
+    for (; end - p >= (ptrdiff_t)(4 * sizeof(AliasedWord));
+         p += 4 * sizeof(AliasedWord)) {
+        const AliasedWord *w = reinterpret_cast<const AliasedWord *>(p);
+        if (w[0] | w[1] | w[2] | w[3])
+            return false;
+    }
+
+    while (p < end)
+        if (*p++)
             return false;
 
     return true;
 }
 
+#if defined(__x86_64__)
+
+// SSE2 is part of the x86_64 baseline
+static bool isZeroSSE2(const char *buffer, size_t size)
+{
+    const char *p = buffer;
+    const char *end = buffer + size;
+
+    for (; end - p >= 64; p += 64) {
+        const __m128i *v = reinterpret_cast<const __m128i *>(p);
+        __m128i acc = _mm_or_si128(
+            _mm_or_si128(_mm_loadu_si128(v), _mm_loadu_si128(v + 1)),
+            _mm_or_si128(_mm_loadu_si128(v + 2), _mm_loadu_si128(v + 3)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(acc, _mm_setzero_si128()))
+            != 0xffff)
+            return false;
+    }
+
+    return isZeroGeneric(p, end - p);
+}
+
+__attribute__((target("avx2")))
+static bool isZeroAVX2(const char *buffer, size_t size)
+{
+    const char *p = buffer;
+    const char *end = buffer + size;
+
+    for (; end - p >= 128; p += 128) {
+        const __m256i *v = reinterpret_cast<const __m256i *>(p);
+        __m256i acc = _mm256_or_si256(
+            _mm256_or_si256(_mm256_loadu_si256(v), _mm256_loadu_si256(v + 1)),
+            _mm256_or_si256(_mm256_loadu_si256(v + 2),
+                            _mm256_loadu_si256(v + 3)));
+        if (!_mm256_testz_si256(acc, acc))
+            return false;
+    }
+
+    return isZeroSSE2(p, end - p);
+}
+
+#elif defined(__aarch64__)
+
+// NEON is mandatory on AArch64
+static bool isZeroNEON(const char *buffer, size_t size)
+{
+    const char *p = buffer;
+    const char *end = buffer + size;
+
+    for (; end - p >= 64; p += 64) {
+        const uint8_t *v = reinterpret_cast<const uint8_t *>(p);
+        uint8x16_t acc = vorrq_u8(
+            vorrq_u8(vld1q_u8(v), vld1q_u8(v + 16)),
+            vorrq_u8(vld1q_u8(v + 32), vld1q_u8(v + 48)));
+        if (vmaxvq_u8(acc))
+            return false;
+    }
+
+    return isZeroGeneric(p, end - p);
+}
+
+#endif
+
+typedef bool (*IsZeroFunc)(const char *buffer, size_t size);
+
+// Choose the best implementation for the running CPU
+static IsZeroFunc selectIsZero(void)
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        Debug::debug()->dbg("Using AVX2 zero block detection");
+        return isZeroAVX2;
+    }
+    Debug::debug()->dbg("Using SSE2 zero block detection");
+    return isZeroSSE2;
+#elif defined(__aarch64__)
+    Debug::debug()->dbg("Using NEON zero block detection");
+    return isZeroNEON;
+#else
+    return isZeroGeneric;
+#endif
+}
+
+// -----------------------------------------------------------------------------
+bool Util::isZero(const char *buffer, size_t size)
+{
+    static const IsZeroFunc func = selectIsZero();
+    return func(buffer, size);
+}
+
 // -----------------------------------------------------------------------------
 string Util::getHostDomain()
 {
@@ -397,20 +324,11 @@ string Util::getHostDomain()
 ssize_t Util::findBytes(const unsigned char *haystack, size_t haystack_len,
                         const unsigned char *needle, size_t needle_len)
 {
-    for (size_t i = 0; i < (haystack_len-needle_len); i++) {
-        bool found = true;
-        for (size_t j = 0; j < needle_len; j++) {
-            if (haystack[i+j] != needle[j]) {
-                found = false;
-                break;
-            }
-        }
-        if (found) {
-            return i;
-        }
-    }
+    const void *pos = memmem(haystack, haystack_len, needle, needle_len);
+    if (!pos)
+        return -1;
 
-    return -1;
+    return static_cast<const unsigned char *>(pos) - haystack;
 }
 
 // -----------------------------------------------------------------------------
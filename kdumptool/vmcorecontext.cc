@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <endian.h>
+
+#include <elf.h>
+
+#include "global.h"
+#include "debug.h"
+#include "vmcorecontext.h"
+#include "stringutil.h"
+#include "fileutil.h"
+
+using std::string;
+using std::min;
+
+#define VMCOREINFO_NOTE_NAME		"VMCOREINFO"
+#define VMCOREINFO_XEN_NOTE_NAME	"VMCOREINFO_XEN"
+#define XEN_NOTE_NAME			"Xen"
+
+// bytes of the note name that are read together with the note header;
+// longer names need a second read
+#define NOTE_NAME_PREFIX		32
+
+//{{{ VmcoreContext ------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+static void readAt(int fd, void *buffer, size_t size, off_t offset,
+                   const string &file)
+{
+    char *p = static_cast<char *>(buffer);
+
+    while (size) {
+        ssize_t ret = pread(fd, p, size, offset);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret < 0)
+            throw KSystemError("Cannot read " + file + " at " +
+                               StringUtil::number2hex(offset), errno);
+        if (ret == 0)
+            throw KError("Unexpected end of " + file + ".");
+        p += ret;
+        offset += ret;
+        size -= ret;
+    }
+}
+
+// -----------------------------------------------------------------------------
+std::shared_ptr<const VmcoreContext> VmcoreContext::get(const string &dump)
+{
+    static std::mutex mutex;
+    static std::map<string, std::shared_ptr<const VmcoreContext> > cache;
+
+    struct stat st;
+    if (stat(dump.c_str(), &st) != 0)
+        throw KSystemError("Cannot stat " + dump, errno);
+
+    // parse under the lock, so that concurrent users parse only once
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<const VmcoreContext> &ctx = cache[dump];
+    if (!ctx || !ctx->sameFile(st))
+        ctx.reset(new VmcoreContext(dump));
+    else
+        Debug::debug()->trace("Reusing the parsed headers of %s",
+                              dump.c_str());
+    return ctx;
+}
+
+// -----------------------------------------------------------------------------
+VmcoreContext::VmcoreContext(const string &dump)
+    : m_path(dump), m_pointerSize(0), m_hasNotes(false)
+{
+    Debug::debug()->trace("VmcoreContext::VmcoreContext(%s)", dump.c_str());
+
+    FileDescriptor fd(dump, O_RDONLY | O_CLOEXEC);
+    if (fstat(fd, &m_stat) != 0)
+        throw KSystemError("Cannot stat " + dump, errno);
+
+    unsigned char ident[EI_NIDENT];
+    ssize_t ret = pread(fd, ident, sizeof ident, 0);
+    if (ret < 0)
+        throw KSystemError("Cannot read " + dump, errno);
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+    const unsigned char data = ELFDATA2LSB;
+#else
+    const unsigned char data = ELFDATA2MSB;
+#endif
+    if (ret != sizeof ident || memcmp(ident, ELFMAG, SELFMAG) != 0)
+        m_error = dump + " is no ELF object.";
+    else if (ident[EI_DATA] != data)
+        m_error = "Unsupported byte order of " + dump + ".";
+    else if (ident[EI_CLASS] == ELFCLASS64)
+        parse<Elf64_Ehdr, Elf64_Phdr, Elf64_Shdr, Elf64_Nhdr>(fd);
+    else if (ident[EI_CLASS] == ELFCLASS32)
+        parse<Elf32_Ehdr, Elf32_Phdr, Elf32_Shdr, Elf32_Nhdr>(fd);
+    else
+        m_error = "Invalid ELF class of " + dump + ".";
+
+    if (isElf())
+        readVmcoreinfo(fd);
+}
+
+// -----------------------------------------------------------------------------
+bool VmcoreContext::sameFile(const struct stat &st) const
+{
+    return st.st_dev == m_stat.st_dev && st.st_ino == m_stat.st_ino &&
+        st.st_size == m_stat.st_size &&
+        st.st_mtim.tv_sec == m_stat.st_mtim.tv_sec &&
+        st.st_mtim.tv_nsec == m_stat.st_mtim.tv_nsec;
+}
+
+// -----------------------------------------------------------------------------
+template<typename Ehdr, typename Phdr, typename Shdr, typename Nhdr>
+void VmcoreContext::parse(int fd)
+{
+    Ehdr ehdr;
+    readAt(fd, &ehdr, sizeof ehdr, 0, m_path);
+    if (ehdr.e_phentsize != sizeof(Phdr))
+        throw KError("Invalid size of the program headers in " +
+                     m_path + ".");
+
+    // with extended numbering, the count is in the first section header
+    size_t phnum = ehdr.e_phnum;
+    if (phnum == PN_XNUM) {
+        Shdr shdr;
+        readAt(fd, &shdr, sizeof shdr, ehdr.e_shoff, m_path);
+        phnum = shdr.sh_info;
+    }
+
+    std::vector<Phdr> phdrs(phnum);
+    readAt(fd, phdrs.data(), phnum * sizeof(Phdr), ehdr.e_phoff, m_path);
+    m_pointerSize = sizeof(ehdr.e_entry);
+
+    typename std::vector<Phdr>::const_iterator it;
+    for (it = phdrs.begin(); it != phdrs.end(); ++it) {
+        if (it->p_type == PT_LOAD && it->p_filesz) {
+            Segment seg;
+            seg.vaddr = it->p_vaddr;
+            seg.paddr = it->p_paddr;
+            seg.offset = it->p_offset;
+            seg.filesz = it->p_filesz;
+            seg.memsz = it->p_memsz;
+            m_segments.push_back(seg);
+            continue;
+        }
+        if (it->p_type != PT_NOTE)
+            continue;
+        m_hasNotes = true;
+
+        Debug::debug()->dbg("PT_NOTE size: %lld, offset: %lld",
+            (unsigned long long)it->p_filesz,
+            (unsigned long long)it->p_offset);
+
+        // read only the note headers; the contents (mostly per-CPU
+        // register sets) are read by whoever needs them
+        off_t pos = it->p_offset;
+        off_t end = it->p_offset + it->p_filesz;
+        while (pos + off_t(sizeof(Nhdr)) <= end) {
+            char buf[sizeof(Nhdr) + NOTE_NAME_PREFIX];
+            size_t len = min<off_t>(sizeof buf, end - pos);
+            readAt(fd, buf, len, pos, m_path);
+
+            Nhdr nhdr;
+            memcpy(&nhdr, buf, sizeof nhdr);
+            off_t desc = pos + sizeof nhdr + ((nhdr.n_namesz + 3) & ~3);
+            off_t next = desc + ((nhdr.n_descsz + 3) & ~3);
+            if (next > end) {
+                Debug::debug()->dbg("Truncated note at %lld",
+                                    (long long)pos);
+                break;
+            }
+
+            Note note;
+            if (nhdr.n_namesz <= len - sizeof nhdr)
+                note.name.assign(buf + sizeof nhdr, nhdr.n_namesz);
+            else {
+                note.name.resize(nhdr.n_namesz);
+                readAt(fd, &note.name[0], nhdr.n_namesz,
+                       pos + sizeof nhdr, m_path);
+            }
+            note.name.resize(strnlen(note.name.c_str(), note.name.size()));
+            note.type = nhdr.n_type;
+            note.offset = desc;
+            note.size = nhdr.n_descsz;
+            m_notes.push_back(note);
+
+            pos = next;
+        }
+    }
+
+    Debug::debug()->dbg("%s: %zu PT_LOAD segments, %zu notes",
+                        m_path.c_str(), m_segments.size(), m_notes.size());
+}
+
+// -----------------------------------------------------------------------------
+void VmcoreContext::readVmcoreinfo(int fd)
+{
+    // a VMCOREINFO note takes precedence over VMCOREINFO_XEN
+    const Note *found = NULL;
+    bool xen = false;
+    std::vector<Note>::const_iterator it;
+    for (it = m_notes.begin(); it != m_notes.end(); ++it) {
+        if (it->name == VMCOREINFO_NOTE_NAME) {
+            found = &*it;
+            break;
+        } else if (it->name == VMCOREINFO_XEN_NOTE_NAME) {
+            found = &*it;
+            xen = true;
+        }
+    }
+
+    if (!m_hasNotes) {
+        m_error = m_path + " contains no PT_NOTE segment.";
+        return;
+    }
+    if (!found) {
+        m_error = "VMCOREINFO not found.";
+        return;
+    }
+
+    Debug::debug()->dbg("Found %s, offset: %lld, size: %lld",
+                        found->name.c_str(), (long long)found->offset,
+                        (long long)found->size);
+    ByteVector data(found->size);
+    readAt(fd, data.data(), data.size(), found->offset, m_path);
+    m_vmcoreinfo.readFromNote(data, xen);
+}
+
+// -----------------------------------------------------------------------------
+bool VmcoreContext::isXenDump() const
+{
+    std::vector<Note>::const_iterator it;
+    for (it = m_notes.begin(); it != m_notes.end(); ++it)
+        if (it->name == XEN_NOTE_NAME)
+            return true;
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long VmcoreContext::memorySize() const
+{
+    unsigned long long ret = 0;
+    std::vector<Segment>::const_iterator it;
+    for (it = m_segments.begin(); it != m_segments.end(); ++it)
+        ret += it->filesz;
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+const Vmcoreinfo &VmcoreContext::vmcoreinfo() const
+{
+    if (!m_error.empty())
+        throw KError(m_error);
+    return m_vmcoreinfo;
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
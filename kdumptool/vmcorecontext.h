@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef VMCORECONTEXT_H
+#define VMCORECONTEXT_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "global.h"
+#include "vmcoreinfo.h"
+
+//{{{ VmcoreContext ------------------------------------------------------------
+
+/**
+ * The parsed headers of an ELF dump (like /proc/vmcore): the PT_LOAD
+ * layout, the notes and the VMCOREINFO.
+ *
+ * get() parses each file only once per process, so SaveDump, the dmesg
+ * reader, Util::isXenCoreDump() and read_vmcoreinfo share one open and
+ * parse cycle. The headers are read with pread(); of the notes, only
+ * the headers and the contents of VMCOREINFO are read.
+ */
+class VmcoreContext {
+
+    public:
+        struct Segment {
+            unsigned long long vaddr;
+            unsigned long long paddr;
+            off_t offset;
+            unsigned long long filesz;
+            unsigned long long memsz;
+        };
+
+        struct Note {
+            std::string name;
+            unsigned type;
+            off_t offset;           // of the contents
+            size_t size;
+        };
+
+        /**
+         * Returns the context of @p dump, parsing it on first use. The
+         * cached context is reused as long as the file is unchanged.
+         * This function is thread-safe.
+         *
+         * @param[in] dump the dump file
+         * @exception KError if the file cannot be read
+         */
+        static std::shared_ptr<const VmcoreContext> get(const std::string &dump);
+
+        /**
+         * Returns the name of the dump file.
+         */
+        const std::string &path() const
+        { return m_path; }
+
+        /**
+         * Returns @c true if the file is an ELF file with the byte
+         * order of this machine.
+         */
+        bool isElf() const
+        { return m_pointerSize != 0; }
+
+        /**
+         * Returns the size of a pointer (4 for ELF32, 8 for ELF64).
+         */
+        unsigned pointerSize() const
+        { return m_pointerSize; }
+
+        /**
+         * Returns the PT_LOAD segments that have data in the file.
+         */
+        const std::vector<Segment> &segments() const
+        { return m_segments; }
+
+        /**
+         * Returns the headers of all notes.
+         */
+        const std::vector<Note> &notes() const
+        { return m_notes; }
+
+        /**
+         * Returns @c true if the dump contains a "Xen" note.
+         */
+        bool isXenDump() const;
+
+        /**
+         * Returns the sum of the PT_LOAD sizes in the file, which is
+         * the size of an ELF dump without the headers.
+         */
+        unsigned long long memorySize() const;
+
+        /**
+         * Returns @c true if the dump contains a VMCOREINFO note.
+         */
+        bool hasVmcoreinfo() const
+        { return m_error.empty(); }
+
+        /**
+         * Returns the VMCOREINFO.
+         *
+         * @exception KError if the dump contains no VMCOREINFO
+         */
+        const Vmcoreinfo &vmcoreinfo() const;
+
+    protected:
+        VmcoreContext(const std::string &dump);
+
+        bool sameFile(const struct stat &st) const;
+
+        template<typename Ehdr, typename Phdr, typename Shdr, typename Nhdr>
+        void parse(int fd);
+
+        void readVmcoreinfo(int fd);
+
+    private:
+        std::string m_path;
+        struct stat m_stat;
+        unsigned m_pointerSize;
+        std::vector<Segment> m_segments;
+        std::vector<Note> m_notes;
+        bool m_hasNotes;
+        Vmcoreinfo m_vmcoreinfo;
+        std::string m_error;    // why there is no VMCOREINFO
+};
+
+//}}}
+
+#endif /* VMCORECONTEXT_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
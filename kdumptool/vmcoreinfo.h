@@ -36,8 +36,6 @@ class Vmcoreinfo {
 
         /**
          * Creates a new Vmcoreinfo object.
-         *
-         * @exception KError if the libelf library is out of date
          */
         Vmcoreinfo();
 
@@ -48,13 +46,22 @@ class Vmcoreinfo {
         { }
 
         /**
-         * Reads the vmcoreinfo from a ELF file as NOTES section.
+         * Reads the vmcoreinfo from a ELF file as NOTES section. The file
+         * is parsed only once per process, see VmcoreContext::get().
          *
          * @param[in] elf_file the ELF file
          * @exception KError if reading the vmcoreinfo failed
          */
         void readFromELF(const char *elf_file);
 
+        /**
+         * Parses the contents of a VMCOREINFO note.
+         *
+         * @param[in] data the note contents
+         * @param[in] xen @c true if the note is VMCOREINFO_XEN
+         */
+        void readFromNote(const ByteVector &data, bool xen);
+
         /**
          * Gets all keys.
          *
@@ -97,12 +104,6 @@ class Vmcoreinfo {
          */
         bool isXenVmcoreinfo() const;
 
-    protected:
-        ByteVector readElfNote(const char *file);
-
-        ByteVector readVmcoreinfoFromNotes(const char *buffer, size_t size,
-                                           bool isElf64);
-
     private:
         StringStringMap m_map;
         bool m_xenVmcoreinfo;
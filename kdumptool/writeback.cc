@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+
+#include "global.h"
+#include "debug.h"
+#include "stringutil.h"
+#include "writeback.h"
+
+//{{{ WritebackWindow ----------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+WritebackWindow::WritebackWindow(int fd, size_t window)
+    : m_fd(fd), m_window(window), m_next(0), m_completed(0), m_enabled(true)
+{
+}
+
+// -----------------------------------------------------------------------------
+void WritebackWindow::advance(off_t pos)
+{
+    while (m_enabled && pos >= m_next + (off_t)m_window) {
+        if (!sync(m_next, m_window, SYNC_FILE_RANGE_WRITE))
+            return;
+
+        // the previous window has had a whole window's time to finish
+        if (m_next >= (off_t)m_window) {
+            off_t prev = m_next - m_window;
+            if (!sync(prev, m_window, SYNC_FILE_RANGE_WAIT_BEFORE |
+                      SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER))
+                return;
+            posix_fadvise(m_fd, prev, m_window, POSIX_FADV_DONTNEED);
+            m_completed = m_next;
+        }
+        m_next += m_window;
+    }
+}
+
+// -----------------------------------------------------------------------------
+bool WritebackWindow::sync(off_t offset, size_t len, unsigned int flags)
+{
+    int ret;
+    do {
+        ret = sync_file_range(m_fd, offset, len, flags);
+    } while (ret < 0 && errno == EINTR);
+    if (ret == 0)
+        return true;
+
+    if (errno == EINVAL || errno == ESPIPE || errno == ENOSYS) {
+        Debug::debug()->dbg("sync_file_range() not supported: %s",
+                            strerror(errno));
+        m_enabled = false;
+        return false;
+    }
+    throw KSystemError("Write-back failed at " +
+        StringUtil::number2string(offset) + ".", errno);
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
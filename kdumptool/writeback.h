@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef WRITEBACK_H
+#define WRITEBACK_H
+
+#include <sys/types.h>
+
+#include "global.h"
+
+// write-back granularity; at most two windows of a file are dirty
+#define WRITEBACK_WINDOW    (8*1024*1024)
+
+//{{{ WritebackWindow ----------------------------------------------------------
+
+/**
+ * Keeps the dirty page cache of a sequentially written file small.
+ *
+ * Without help, the kernel lets a file accumulate dirty pages up to
+ * vm.dirty_ratio before it starts writing them, and the kdump kernel
+ * must have memory for all of them. Here, write-back of each window
+ * is started with sync_file_range() as soon as the writer has moved
+ * past it, and the writer waits for the window before that, so no
+ * more than two windows are dirty or under write-back at any time.
+ * The written-back pages are dropped from the page cache, too.
+ *
+ * File systems that do not support sync_file_range() are written
+ * normally.
+ */
+class WritebackWindow {
+
+    public:
+        /**
+         * @param[in] fd the file descriptor of the target file
+         * @param[in] window the window size in bytes
+         */
+        WritebackWindow(int fd, size_t window = WRITEBACK_WINDOW);
+
+        /**
+         * Notes that everything before @p pos has been written.
+         *
+         * @param[in] pos the current end of the written data
+         * @exception KSystemError if write-back of a window fails
+         */
+        void advance(off_t pos);
+
+        /**
+         * Returns the offset up to which the data is on the disk.
+         */
+        off_t completed() const
+        { return m_completed; }
+
+        /**
+         * Returns @c false if write-back cannot be controlled for the
+         * file.
+         */
+        bool enabled() const
+        { return m_enabled; }
+
+    private:
+        bool sync(off_t offset, size_t len, unsigned int flags);
+
+        int m_fd;
+        size_t m_window;
+        off_t m_next;           // start of the first unsubmitted window
+        off_t m_completed;
+        bool m_enabled;
+};
+
+//}}}
+
+#endif /* WRITEBACK_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,354 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+
+#include "zstddataprovider.h"
+
+#if HAVE_ZSTD
+
+#include <cstring>
+#include <algorithm>
+
+#include <zstd.h>
+
+#include "debug.h"
+#include "probes.h"
+
+using std::string;
+
+// uncompressed size of one seekable frame
+#define ZSTD_FRAME_SIZE		(1024*1024)
+
+// seek table magic numbers (see zstd_seekable_compression_format.md)
+#define ZSTD_SKIPPABLE_MAGIC	0x184D2A5E
+#define ZSTD_SEEKABLE_MAGIC	0x8F92EAB1
+
+//{{{ ZstdDataProvider ---------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+ZstdDataProvider::ZstdDataProvider(DataProvider *forward, int level,
+                                   unsigned workers)
+    : m_forward(forward), m_level(level), m_workers(std::max(workers, 1U)),
+      m_eof(false), m_tableDone(false), m_out(NULL), m_outLen(0),
+      m_stop(false)
+{}
+
+// -----------------------------------------------------------------------------
+ZstdDataProvider::~ZstdDataProvider()
+{
+    stopWorkers();
+}
+
+// -----------------------------------------------------------------------------
+void ZstdDataProvider::prepare()
+{
+    Debug::debug()->trace("ZstdDataProvider::prepare, level %d, %u threads",
+                          m_level, m_workers);
+
+    m_forward->prepare();
+
+    m_eof = false;
+    m_tableDone = false;
+    m_chunks.reset();
+    m_current.reset();
+    m_out = NULL;
+    m_outLen = 0;
+    m_entries.clear();
+
+    m_stop = false;
+    for (unsigned i = 0; i < m_workers; ++i)
+        m_threads.emplace_back(&ZstdDataProvider::run, this);
+}
+
+// -----------------------------------------------------------------------------
+bool ZstdDataProvider::canSaveToFile() const
+{
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+void ZstdDataProvider::saveToFile(const StringVector &targets)
+{
+    throw KError("ZstdDataProvider cannot save to a file.");
+}
+
+// -----------------------------------------------------------------------------
+size_t ZstdDataProvider::getData(char *buffer, size_t maxread)
+{
+    while (m_outLen == 0) {
+        if (m_current)
+            m_free.push_back(std::move(m_current));
+
+        readFrames();
+        if (m_frames.empty()) {
+            if (m_tableDone)
+                return 0;
+            appendSeekTable();
+            m_out = m_table.data();
+            m_outLen = m_table.size();
+            break;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cond.wait(lock, [this]{
+                return m_frames.front()->state == Frame::DONE;
+            });
+        m_current = std::move(m_frames.front());
+        m_frames.pop_front();
+        lock.unlock();
+
+        if (m_current->error)
+            std::rethrow_exception(m_current->error);
+
+        m_entries.push_back(std::make_pair(m_current->outLen,
+                                           m_current->inLen));
+        m_out = m_current->out.get();
+        m_outLen = m_current->outLen;
+    }
+
+    size_t len = std::min(maxread, m_outLen);
+    memcpy(buffer, m_out, len);
+    m_out += len;
+    m_outLen -= len;
+    KDUMP_PROBE1(zstd_read, len);
+    return len;
+}
+
+// -----------------------------------------------------------------------------
+bool ZstdDataProvider::canSplice() const
+{
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+size_t ZstdDataProvider::spliceData(int fd)
+{
+    throw KError("ZstdDataProvider cannot splice data.");
+}
+
+// -----------------------------------------------------------------------------
+bool ZstdDataProvider::canMapData() const
+{
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+size_t ZstdDataProvider::mapData(const char **data, size_t maxread)
+{
+    throw KError("ZstdDataProvider cannot map data.");
+}
+
+// -----------------------------------------------------------------------------
+bool ZstdDataProvider::canPlaceData() const
+{
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+size_t ZstdDataProvider::getPlacedData(char *buffer, size_t maxread,
+                                       off_t *offset)
+{
+    throw KError("ZstdDataProvider cannot place data.");
+}
+
+// -----------------------------------------------------------------------------
+size_t ZstdDataProvider::getChunk(DataChunk &chunk, size_t maxread)
+{
+    return m_chunks.get(this, chunk, maxread);
+}
+
+// -----------------------------------------------------------------------------
+void ZstdDataProvider::finish()
+{
+    stopWorkers();
+    m_forward->finish();
+}
+
+// -----------------------------------------------------------------------------
+void ZstdDataProvider::setError(bool error)
+{
+    m_forward->setError(error);
+}
+
+// -----------------------------------------------------------------------------
+void ZstdDataProvider::setProgress(Progress *progress)
+{
+    // progress is measured on the uncompressed data
+    m_forward->setProgress(progress);
+}
+
+// -----------------------------------------------------------------------------
+bool ZstdDataProvider::canRestart() const
+{
+    return m_forward->canRestart();
+}
+
+// -----------------------------------------------------------------------------
+void ZstdDataProvider::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+
+    std::vector<std::thread>::iterator it;
+    for (it = m_threads.begin(); it != m_threads.end(); ++it)
+        it->join();
+    m_threads.clear();
+    m_frames.clear();
+}
+
+// -----------------------------------------------------------------------------
+std::unique_ptr<ZstdDataProvider::Frame> ZstdDataProvider::newFrame()
+{
+    std::unique_ptr<Frame> frame;
+
+    if (!m_free.empty()) {
+        frame = std::move(m_free.back());
+        m_free.pop_back();
+    } else {
+        frame.reset(new Frame);
+        frame->in = BufferPool::pool()->get(ZSTD_FRAME_SIZE);
+        frame->out = BufferPool::pool()->get(
+            ZSTD_COMPRESSBOUND(ZSTD_FRAME_SIZE));
+    }
+    frame->inLen = frame->outLen = 0;
+    frame->state = Frame::PENDING;
+    frame->error = nullptr;
+    return frame;
+}
+
+// -----------------------------------------------------------------------------
+void ZstdDataProvider::readFrames()
+{
+    // only this thread changes m_frames, so it can read the size unlocked
+    while (!m_eof && m_frames.size() <= m_workers) {
+        std::unique_ptr<Frame> frame = newFrame();
+
+        while (frame->inLen < ZSTD_FRAME_SIZE) {
+            size_t ret = m_forward->getData(frame->in.get() + frame->inLen,
+                                            ZSTD_FRAME_SIZE - frame->inLen);
+            if (ret == 0) {
+                m_eof = true;
+                break;
+            }
+            frame->inLen += ret;
+        }
+
+        if (frame->inLen == 0) {
+            m_free.push_back(std::move(frame));
+            break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_frames.push_back(std::move(frame));
+        }
+        m_cond.notify_all();
+    }
+}
+
+// -----------------------------------------------------------------------------
+static void putLE32(string &s, uint32_t val)
+{
+    for (int i = 0; i < 4; ++i) {
+        s.push_back(char(val & 0xff));
+        val >>= 8;
+    }
+}
+
+// -----------------------------------------------------------------------------
+void ZstdDataProvider::appendSeekTable()
+{
+    m_table.clear();
+
+    // skippable frame header
+    putLE32(m_table, ZSTD_SKIPPABLE_MAGIC);
+    putLE32(m_table, m_entries.size() * 8 + 9);
+
+    // one entry per frame, without checksums
+    std::vector<std::pair<uint32_t, uint32_t>>::const_iterator it;
+    for (it = m_entries.begin(); it != m_entries.end(); ++it) {
+        putLE32(m_table, it->first);
+        putLE32(m_table, it->second);
+    }
+
+    // footer: number of frames, descriptor, magic
+    putLE32(m_table, m_entries.size());
+    m_table.push_back('\0');
+    putLE32(m_table, ZSTD_SEEKABLE_MAGIC);
+
+    m_tableDone = true;
+}
+
+// -----------------------------------------------------------------------------
+void ZstdDataProvider::run()
+{
+    ZSTD_CCtx *cctx = ZSTD_createCCtx();
+    if (cctx) {
+        ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, m_level);
+        // let zstd -d verify each frame
+        ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1);
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        std::deque<std::unique_ptr<Frame>>::iterator it;
+        m_cond.wait(lock, [this, &it]{
+                if (m_stop)
+                    return true;
+                for (it = m_frames.begin(); it != m_frames.end(); ++it)
+                    if ((*it)->state == Frame::PENDING)
+                        return true;
+                return false;
+            });
+        if (m_stop)
+            break;
+
+        Frame *frame = it->get();
+        frame->state = Frame::BUSY;
+        lock.unlock();
+
+        if (!cctx)
+            frame->error = std::make_exception_ptr(
+                KError("Cannot allocate a zstd compression context."));
+        else {
+            size_t ret = ZSTD_compress2(cctx, frame->out.get(),
+                                        ZSTD_COMPRESSBOUND(ZSTD_FRAME_SIZE),
+                                        frame->in.get(), frame->inLen);
+            if (ZSTD_isError(ret))
+                frame->error = std::make_exception_ptr(
+                    KError(string("zstd compression failed: ") +
+                           ZSTD_getErrorName(ret)));
+            else
+                frame->outLen = ret;
+        }
+
+        lock.lock();
+        frame->state = Frame::DONE;
+        m_cond.notify_all();
+    }
+    lock.unlock();
+
+    ZSTD_freeCCtx(cctx);
+}
+
+//}}}
+
+#endif // HAVE_ZSTD
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
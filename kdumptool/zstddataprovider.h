@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ */
+#ifndef ZSTDDATAPROVIDER_H
+#define ZSTDDATAPROVIDER_H
+
+#include "global.h"
+
+#if HAVE_ZSTD
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <stdint.h>
+
+#include "dataprovider.h"
+#include "bufferpool.h"
+
+//{{{ ZstdDataProvider ---------------------------------------------------------
+
+/**
+ * Decorator that compresses the data of another DataProvider with zstd.
+ *
+ * The input is cut into frames of ZSTD_FRAME_SIZE bytes, which are
+ * compressed independently by a pool of worker threads and returned in
+ * the original order. A seek table follows the last frame, so the result
+ * is in the zstd seekable format: it can be decompressed with the plain
+ * zstd tool, and seek-aware readers can access any offset directly.
+ *
+ * The wrapped DataProvider is only accessed from the thread that calls
+ * getData().
+ */
+class ZstdDataProvider : public DataProvider {
+
+    public:
+
+        /**
+         * Wraps a DataProvider.
+         *
+         * @param[in] forward the DataProvider that provides the data
+         * @param[in] level zstd compression level
+         * @param[in] workers number of compression threads
+         */
+        ZstdDataProvider(DataProvider *forward, int level, unsigned workers);
+
+        /**
+         * Stops the worker threads.
+         */
+        ~ZstdDataProvider();
+
+        void prepare();
+
+        /**
+         * Returns @c false, because the data must be compressed.
+         */
+        bool canSaveToFile() const;
+        void saveToFile(const StringVector &targets);
+        size_t getData(char *buffer, size_t maxread);
+
+        /**
+         * Returns @c false, because the data must be compressed.
+         */
+        bool canSplice() const;
+        size_t spliceData(int fd);
+        bool canMapData() const;
+        size_t mapData(const char **data, size_t maxread);
+        bool canPlaceData() const;
+        size_t getPlacedData(char *buffer, size_t maxread, off_t *offset);
+        size_t getChunk(DataChunk &chunk, size_t maxread);
+
+        void finish();
+        void setError(bool error);
+        void setProgress(Progress *progress);
+        bool canRestart() const;
+
+    private:
+        struct Frame {
+            BufferPool::Buffer in;
+            size_t inLen;
+            BufferPool::Buffer out;
+            size_t outLen;
+            enum { PENDING, BUSY, DONE } state;
+            std::exception_ptr error;
+        };
+
+        void run();
+        void stopWorkers();
+        std::unique_ptr<Frame> newFrame();
+        void readFrames();
+        void appendSeekTable();
+
+        DataProvider *m_forward;
+        int m_level;
+        unsigned m_workers;
+
+        // accessed by the getData() thread only
+        bool m_eof;
+        bool m_tableDone;
+        ChunkAdapter m_chunks;
+        std::unique_ptr<Frame> m_current;
+        std::string m_table;
+        const char *m_out;
+        size_t m_outLen;
+        std::vector<std::unique_ptr<Frame>> m_free;
+        std::vector<std::pair<uint32_t, uint32_t>> m_entries;
+
+        // shared with the worker threads
+        std::deque<std::unique_ptr<Frame>> m_frames;
+        bool m_stop;
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::vector<std::thread> m_threads;
+};
+
+//}}}
+
+#endif // HAVE_ZSTD
+
+#endif /* ZSTDDATAPROVIDER_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
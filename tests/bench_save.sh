@@ -0,0 +1,156 @@
+#!/bin/bash
+#
+# Copyright (c) 2026 SUSE LLC
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, see <https://www.gnu.org/licenses>.
+#
+
+#
+# Saves a synthetic dump with "kdumptool save_dump" for each combination of
+# dump format, KDUMP_CPUS and target, and collects the stats.json files.
+#
+# The environment selects what is measured:
+#
+#   BENCH_SIZE      memory of the synthetic dump in MiB (1024)
+#   BENCH_ZERO      percentage of zero pages (50)
+#   BENCH_FORMATS   values of KDUMP_DUMPFORMAT ("ELF compressed lzo")
+#   BENCH_LEVEL     KDUMP_DUMPLEVEL (0; makedumpfile cannot filter the
+#                   synthetic dump, it has no real kernel data structures)
+#   BENCH_CPUS      values of KDUMP_CPUS ("1 4")
+#   BENCH_TARGETS   values of KDUMP_SAVEDIR (a local directory); separate
+#                   several targets of one run with commas
+#   BENCH_FLAGS     KDUMPTOOL_FLAGS ("")
+#
+# stats.json stays on remote targets; only the wall-clock time is recorded
+# for them.
+#
+
+#
+# Value of a number in the top level or the "dump" phase of stats.json
+#									     {{{
+function total_seconds()
+{
+    sed -n 's/^  "seconds": \([0-9.]*\),$/\1/p' "$1"
+}
+
+function dump_phase()
+{
+    sed -n 's/.*{ "name": "dump",.* "seconds": \([0-9.]*\), "bytes": \([0-9]*\),.*/\1 \2/p' "$1"
+}									   # }}}
+
+#
+# Program								     {{{
+#
+
+KDUMPTOOL=$1
+GENVMCORE=$2
+OUTDIR=${3:-bench-results}
+
+if [ -z "$KDUMPTOOL" ] || [ -z "$GENVMCORE" ] ; then
+    echo "Usage: $0 kdumptool genvmcore [output-directory]"
+    exit 1
+fi
+
+: ${BENCH_SIZE:=1024}
+: ${BENCH_ZERO:=50}
+: ${BENCH_FORMATS:=ELF compressed lzo}
+: ${BENCH_LEVEL:=0}
+: ${BENCH_CPUS:=1 4}
+
+mkdir -p "$OUTDIR" || exit 1
+OUTDIR=$(cd "$OUTDIR" && pwd)
+: ${BENCH_TARGETS:=file://$OUTDIR/dumps}
+
+VMCORE="$OUTDIR/vmcore"
+echo "Generating a $BENCH_SIZE MiB dump in $VMCORE"
+"$GENVMCORE" --size "$BENCH_SIZE" --zero "$BENCH_ZERO" "$VMCORE" || exit 1
+
+RESULTS="$OUTDIR/results.txt"
+printf "%-12s %4s %-8s %9s %9s %9s  %s\n" \
+    format cpus status total dump 'MiB/s' target | tee "$RESULTS"
+
+errors=0
+run=0
+for format in $BENCH_FORMATS ; do
+    for cpus in $BENCH_CPUS ; do
+	for target in $BENCH_TARGETS ; do
+	    run=$(( $run + 1 ))
+	    savedir="${target//,/ }"
+	    conf="$OUTDIR/run$run.conf"
+	    cat > "$conf" <<-EOF2
+		KDUMP_SAVEDIR="$savedir"
+		KDUMP_DUMPFORMAT="$format"
+		KDUMP_DUMPLEVEL="$BENCH_LEVEL"
+		KDUMP_CPUS="$cpus"
+		KDUMPTOOL_FLAGS="$BENCH_FLAGS"
+		KDUMP_COPY_KERNEL="no"
+		KDUMP_FREE_DISK_SIZE="0"
+		KDUMP_KEEP_OLD_DUMPS="0"
+		KDUMP_VERBOSE="0"
+		KDUMP_CONTINUE_ON_ERROR="false"
+		EOF2
+
+	    # only local targets can be looked at and cleaned up
+	    local=
+	    case "$target" in
+		/*|file://*)
+		    local="${target%%,*}"
+		    local="${local#file://}"
+		    rm -rf "$local"
+		    mkdir -p "$local"
+		    ;;
+	    esac
+
+	    start=$(date +%s.%N)
+	    "$KDUMPTOOL" -F "$conf" save_dump --dump "$VMCORE" --nomail \
+		> "$OUTDIR/run$run.log" 2>&1
+	    status=$?
+	    end=$(date +%s.%N)
+
+	    total=$(awk "BEGIN { printf \"%.3f\", $end - $start }")
+	    dump=- rate=-
+	    stats=
+	    if [ -n "$local" ] ; then
+		stats=$(find "$local" -name stats.json | head -n 1)
+	    fi
+	    if [ -n "$stats" ] ; then
+		cp "$stats" "$OUTDIR/run$run.json"
+		total=$(total_seconds "$stats")
+		read dump bytes <<< "$(dump_phase "$stats")"
+		if [ -n "$dump" ] && [ "$dump" != "0.000" ] ; then
+		    rate=$(awk "BEGIN { printf \"%.1f\", $bytes / 1048576 / $dump }")
+		fi
+	    fi
+
+	    result=ok
+	    if [ $status -ne 0 ] ; then
+		result=failed
+		errors=$(( $errors + 1 ))
+	    fi
+	    printf "%-12s %4s %-8s %9s %9s %9s  %s\n" \
+		"$format" "$cpus" "$result" "$total" "${dump:--}" \
+		"$rate" "$target" | tee -a "$RESULTS"
+
+	    test -n "$local" && rm -rf "$local"
+	done
+    done
+done
+
+rm -f "$VMCORE"
+echo "Logs and stats.json files are in $OUTDIR"
+exit $errors
+
+# }}}
+
+# vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -171,6 +171,31 @@ for f in "${TESTKDUMP[@]}"; do
     fi
 done
 
+echo "Delete dumps older than a day"
+
+setup_testdir "$DIR/tmp-delete_dumps" || exit 1
+cat <<EOF >"$CONF"
+KDUMP_SAVEDIR="file:///$DIR/tmp-delete_dumps"
+KDUMP_KEEP_OLD_DUMPS=5
+KDUMP_OLD_DUMPS_MAX_AGE=1
+EOF
+
+"$KDUMPTOOL" -F "$CONF" delete_dumps || exit 1
+
+for f in "${TESTDIRS[@]}" "${TESTFILES[@]}"; do
+    if ! test -e "$DIR/tmp-delete_dumps/$f"; then
+	echo "$f incorrectly deleted!" >&2
+	errors=$(( $errors+1 ))
+    fi
+done
+
+for f in "${TESTKDUMP[@]}"; do
+    if test -e "$DIR/tmp-delete_dumps/$f"; then
+	echo "$f incorrectly kept!" >&2
+	errors=$(( $errors+1 ))
+    fi
+done
+
 exit $errors
 
 # }}}
@@ -0,0 +1,62 @@
+#!/bin/bash
+#
+# Copyright (c) 2026 SUSE LLC
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, see <https://www.gnu.org/licenses>.
+#
+
+#
+# Program								     {{{
+#
+
+KDUMPTOOL=$1
+GENVMCORE=$2
+
+if [ -z "$KDUMPTOOL" ] || [ -z "$GENVMCORE" ] ; then
+    echo "Usage: $0 kdumptool genvmcore"
+    exit 1
+fi
+
+errors=0
+VMCORE=$(mktemp)
+CONF=$(mktemp)
+trap 'rm -f "$VMCORE" "$CONF"' EXIT
+
+# do not depend on /etc/sysconfig/kdump of the build host
+cat <<EOF >"$CONF"
+KDUMP_VERBOSE="0"
+EOF
+
+"$GENVMCORE" --size 64 --zero 50 --release 6.4.0-test "$VMCORE" || exit 1
+
+# the VMCOREINFO note can be read back
+RELEASE=$("$KDUMPTOOL" -F "$CONF" read_vmcoreinfo --dump "$VMCORE" OSRELEASE)
+if [ "$RELEASE" != "6.4.0-test" ] ; then
+    echo "Expected OSRELEASE 6.4.0-test, got '$RELEASE'"
+    errors=$(( $errors + 1 ))
+fi
+
+# zero pages are holes
+SIZE=$(stat -c %s "$VMCORE")
+ALLOCATED=$(( $(stat -c %b "$VMCORE") * $(stat -c %B "$VMCORE") ))
+if [ "$ALLOCATED" -ge "$SIZE" ] ; then
+    echo "The dump is not sparse: $ALLOCATED of $SIZE bytes allocated"
+    errors=$(( $errors + 1 ))
+fi
+
+exit $errors
+
+# }}}
+
+# vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -174,6 +174,12 @@ EXPECT="00 00 00 08 01 23 45 67 89 ab cd ef"
 RESULT=$( "$TESTPACKET" $ARG )
 check "$ARG" "$EXPECT" "$RESULT"
 
+# TEST #14: Header for an external payload
+ARG="b06 w00000001 p100"
+EXPECT="00 00 01 05 06 00 00 00 01"
+RESULT=$( "$TESTPACKET" $ARG )
+check "$ARG" "$EXPECT" "$RESULT"
+
 exit $errornumber
 
 # }}}